@@ -0,0 +1,677 @@
+/*! \file guidedFilter_batch.cpp
+ *  \brief A headless tool that applies the `Guided Filter` algorithm on a batch of images.
+ *  \details The tool takes a list of image files (or directories), filters every
+ *           image, and writes the results in an output directory. PGM (P5),
+ *           PPM (P6), and raw 8-bit files are handled natively. Other formats
+ *           are decoded with OpenCV, when it is available at compile time.
+ *
+ *           The work is organized as a pipeline. A pool of threads decodes
+ *           the input files ahead of the device. Several images are kept in
+ *           flight, each in its own filter instance, so that the transfers
+ *           and kernel executions of one image overlap with the host side
+ *           work of the others. The results are encoded and written to disk
+ *           by a second pool of threads. At the end, the throughput and the
+ *           utilization of every stage are reported.
+ *
+ *           Usage: `guided_filter_batch [options] -o <dir> <file|dir|@list>...`
+ *           - `-o <dir>`: output directory (required).
+ *           - `-r <int>`: filter window radius (default: 7).
+ *           - `-e <float>`: regularization parameter \f$\epsilon\f$ (default: 0.0144).
+ *           - `-j <int>`: number of decoding/encoding threads (default: hardware concurrency).
+ *           - `-d <int>`: number of images in flight on the device (default: 3).
+ *           - `--raw <W>x<H>[x<C>]`: dimensions of `.raw` files (C is 1 or 3, default: 1).
+ *           - `@list`: a file with one input path per line.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <cmath>
+#include <cctype>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef GF_BATCH_OPENCV
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#endif
+#include <CLUtils.hpp>
+#include <GuidedFilter/algorithms.hpp>
+
+
+// Kernel filenames
+const std::vector<std::string> kernel_files = { "kernels/imageSupport_kernels.cl",
+                                                "kernels/scan_kernels.cl",
+                                                "kernels/transpose_kernels.cl",
+                                                "kernels/boxFilter_kernels.cl",
+                                                "kernels/math_kernels.cl",
+                                                "kernels/guidedFilter_kernels.cl" };
+
+typedef cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF::Kinect::GuidedFilterRGBConfig::INTERLEAVED_FLOAT> RGBFilter;
+typedef cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_EQ_P> GrayFilter;
+
+// The filters are sized to multiples of this value, and the images are padded accordingly
+const unsigned int alignment = 16;
+
+
+/*! \brief Enumerates the image file formats handled by the tool. */
+enum class Format : uint8_t
+{
+    PGM,   /*!< Binary portable graymap (P5). */
+    PPM,   /*!< Binary portable pixmap (P6). */
+    RAW,   /*!< Headerless 8-bit data with user-specified dimensions. */
+    OTHER  /*!< Any other format (requires OpenCV). */
+};
+
+
+/*! \brief An 8-bit image with interleaved channels. */
+struct Image
+{
+    std::string path;
+    Format format;
+    unsigned int width, height, channels;
+    std::vector<cl_uchar> data;
+};
+
+
+/*! \brief The command line options. */
+struct Options
+{
+    Options () : radius (7), eps (0.0144f), threads (std::max (std::thread::hardware_concurrency (), 1u)),
+                 inFlight (3), rawWidth (0), rawHeight (0), rawChannels (1)
+    {
+    }
+
+    std::vector<std::string> inputs;
+    std::string outDir;
+    int radius; float eps;
+    unsigned int threads, inFlight;
+    unsigned int rawWidth, rawHeight, rawChannels;
+};
+
+
+/*! \brief Busy time (in ms) accumulated by each pipeline stage. */
+struct Stats
+{
+    Stats () : decode (0.0), upload (0.0), compute (0.0), download (0.0), encode (0.0)
+    {
+    }
+
+    double decode, upload, compute, download, encode;
+    std::mutex mutex;
+};
+
+
+/*! \brief A fixed-size pool of threads executing tasks in FIFO order. */
+class ThreadPool
+{
+public:
+    ThreadPool (unsigned int n) : stop (false)
+    {
+        for (unsigned int i = 0; i < n; ++i)
+            workers.emplace_back ([this] { loop (); });
+    }
+
+    ~ThreadPool ()
+    {
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            stop = true;
+        }
+        cv.notify_all ();
+        for (auto &worker : workers) worker.join ();
+    }
+
+    /*! \brief Queues a task, and returns a future for its result. */
+    template <typename F>
+    std::future<typename std::result_of<F ()>::type> submit (F f)
+    {
+        typedef typename std::result_of<F ()>::type R;
+        auto task = std::make_shared<std::packaged_task<R ()>> (f);
+        std::future<R> result = task->get_future ();
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            tasks.emplace ([task] { (*task) (); });
+        }
+        cv.notify_one ();
+        return result;
+    }
+
+private:
+    void loop ()
+    {
+        for (;;)
+        {
+            std::function<void ()> task;
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                cv.wait (lock, [this] { return stop || !tasks.empty (); });
+                if (stop && tasks.empty ()) return;
+                task = std::move (tasks.front ());
+                tasks.pop ();
+            }
+            task ();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void ()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop;
+};
+
+
+/*! \brief A filter instance, together with the image it currently processes. */
+struct Slot
+{
+    Slot (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) :
+        env (_env), info (_info), width (0), height (0), busy (false), waitList (1)
+    {
+    }
+
+    clutils::CLEnv &env;
+    clutils::CLEnvInfo<2> info;
+    std::unique_ptr<RGBFilter> rgb;
+    std::unique_ptr<GrayFilter> gray;
+    unsigned int width, height;  // Padded dimensions of the active filter
+    bool busy;
+    Image image;
+    cl::Event writeEvent, runEvent, readEvent;
+    std::vector<cl::Event> waitList;
+};
+
+
+/*! \brief Returns the lowercase extension of a path. */
+std::string extension (const std::string &path)
+{
+    size_t dot = path.find_last_of ('.');
+    if (dot == std::string::npos || path.find ('/', dot) != std::string::npos) return "";
+    std::string ext = path.substr (dot + 1);
+    std::transform (ext.begin (), ext.end (), ext.begin (), ::tolower);
+    return ext;
+}
+
+
+/*! \brief Returns the file name component of a path. */
+std::string basename (const std::string &path)
+{
+    size_t slash = path.find_last_of ('/');
+    return (slash == std::string::npos) ? path : path.substr (slash + 1);
+}
+
+
+/*! \brief Reads the next token of a PNM header, skipping whitespace and comments. */
+unsigned int pnmToken (std::istream &is)
+{
+    int c;
+    while ((c = is.peek ()) != EOF)
+    {
+        if (std::isspace (c)) is.get ();
+        else if (c == '#') is.ignore (std::numeric_limits<std::streamsize>::max (), '\n');
+        else break;
+    }
+
+    unsigned int value;
+    if (!(is >> value)) throw std::runtime_error ("Malformed PNM header");
+    return value;
+}
+
+
+/*! \brief Decodes an image file. Failures are reported with an exception. */
+Image decode (const std::string &path, const Options &opt)
+{
+    Image image;
+    image.path = path;
+
+    std::string ext = extension (path);
+    if (ext == "pgm" || ext == "ppm" || ext == "pnm")
+    {
+        std::ifstream fs (path, std::ios::binary);
+        if (!fs) throw std::runtime_error ("Cannot open file");
+
+        char magic[2];
+        fs.read (magic, 2);
+        if (!fs || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6'))
+            throw std::runtime_error ("Only binary PGM (P5) and PPM (P6) files are supported");
+
+        image.format = (magic[1] == '5') ? Format::PGM : Format::PPM;
+        image.channels = (magic[1] == '5') ? 1 : 3;
+        image.width = pnmToken (fs);
+        image.height = pnmToken (fs);
+        unsigned int maxval = pnmToken (fs);
+        if (maxval == 0 || maxval > 255) throw std::runtime_error ("Only 8-bit PNM files are supported");
+        fs.get ();  // Single whitespace before the raster
+
+        image.data.resize (image.width * image.height * image.channels);
+        fs.read ((char *) image.data.data (), image.data.size ());
+        if (!fs) throw std::runtime_error ("Truncated PNM raster");
+
+        if (maxval != 255)
+            for (auto &v : image.data) v = (cl_uchar) std::min (255u, (v * 255u + maxval / 2) / maxval);
+    }
+    else if (ext == "raw")
+    {
+        if (opt.rawWidth == 0 || opt.rawHeight == 0)
+            throw std::runtime_error ("The dimensions of raw files have to be given with --raw");
+
+        image.format = Format::RAW;
+        image.width = opt.rawWidth; image.height = opt.rawHeight; image.channels = opt.rawChannels;
+        image.data.resize (image.width * image.height * image.channels);
+
+        std::ifstream fs (path, std::ios::binary);
+        if (!fs) throw std::runtime_error ("Cannot open file");
+        fs.read ((char *) image.data.data (), image.data.size ());
+        if (!fs) throw std::runtime_error ("The file is smaller than the given dimensions");
+    }
+    else
+    {
+#ifdef GF_BATCH_OPENCV
+        cv::Mat mat = cv::imread (path, CV_LOAD_IMAGE_ANYCOLOR);
+        if (mat.empty ()) throw std::runtime_error ("Cannot decode file");
+        if (mat.channels () == 3) cv::cvtColor (mat, mat, CV_BGR2RGB);
+        else if (mat.channels () == 4) cv::cvtColor (mat, mat, CV_BGRA2RGB);
+
+        image.format = Format::OTHER;
+        image.width = mat.cols; image.height = mat.rows; image.channels = mat.channels ();
+        image.data.resize (image.width * image.height * image.channels);
+        for (unsigned int y = 0; y < image.height; ++y)
+            std::memcpy (&image.data[y * image.width * image.channels], mat.ptr (y), image.width * image.channels);
+#else
+        throw std::runtime_error ("Unsupported format (built without OpenCV)");
+#endif
+    }
+
+    return image;
+}
+
+
+/*! \brief Encodes an image file in the format it was decoded from. */
+void encode (const Image &image, const std::string &path)
+{
+    if (image.format == Format::OTHER)
+    {
+#ifdef GF_BATCH_OPENCV
+        cv::Mat mat (image.height, image.width, (image.channels == 1) ? CV_8UC1 : CV_8UC3, (void *) image.data.data ());
+        if (image.channels == 3) cv::cvtColor (mat, mat, CV_RGB2BGR);
+        if (!cv::imwrite (path, mat)) throw std::runtime_error ("Cannot encode file");
+        return;
+#endif
+    }
+
+    std::ofstream fs (path, std::ios::binary);
+    if (!fs) throw std::runtime_error ("Cannot create file");
+
+    if (image.format != Format::RAW)
+        fs << ((image.channels == 1) ? "P5\n" : "P6\n") << image.width << " " << image.height << "\n255\n";
+
+    fs.write ((const char *) image.data.data (), image.data.size ());
+    if (!fs) throw std::runtime_error ("Cannot write file");
+}
+
+
+/*! \brief Copies an image into a buffer of padded dimensions, replicating the border pixels. */
+template <typename T, typename F>
+void pad (const Image &image, T *dst, unsigned int width, unsigned int height, F convert)
+{
+    const unsigned int c = image.channels;
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const cl_uchar *src = &image.data[std::min (y, image.height - 1) * image.width * c];
+        T *row = dst + y * width * c;
+        for (unsigned int x = 0; x < width * c; ++x)
+            row[x] = convert (src[std::min (x, (image.width - 1) * c + x % c)]);
+    }
+}
+
+
+/*! \brief Copies the valid region of a padded result back into an image. */
+void crop (const cl_float *src, unsigned int width, Image &image)
+{
+    const unsigned int c = image.channels;
+    for (unsigned int y = 0; y < image.height; ++y)
+    {
+        const cl_float *row = src + y * width * c;
+        cl_uchar *dst = &image.data[y * image.width * c];
+        for (unsigned int x = 0; x < image.width * c; ++x)
+            dst[x] = (cl_uchar) std::min (std::max (row[x] * 255.f + 0.5f, 0.f), 255.f);
+    }
+}
+
+
+/*! \brief Returns the duration (in ms) between two profiling points of the given events. */
+double elapsed (const cl::Event &from, cl_profiling_info fromInfo, const cl::Event &to, cl_profiling_info toInfo)
+{
+    cl_ulong start, end;
+    from.getProfilingInfo (fromInfo, &start);
+    to.getProfilingInfo (toInfo, &end);
+    return (end > start) ? (end - start) * 1e-6 : 0.0;
+}
+
+
+/*! \brief Enqueues the processing of an image on a slot, without blocking. */
+void submit (Slot &slot, Image &&image, const Options &opt)
+{
+    const unsigned int width = (image.width + alignment - 1) / alignment * alignment;
+    const unsigned int height = (image.height + alignment - 1) / alignment * alignment;
+    const bool color = (image.channels == 3);
+
+    // Filters are only rebuilt when the image geometry changes
+    if ((color && !slot.rgb) || (!color && !slot.gray) || slot.width != width || slot.height != height)
+    {
+        slot.rgb.reset (); slot.gray.reset ();
+        if (color)
+        {
+            slot.rgb.reset (new RGBFilter (slot.env, slot.info));
+            slot.rgb->init (width, height, opt.radius, opt.eps, cl_algo::GF::Staging::IO);
+        }
+        else
+        {
+            slot.gray.reset (new GrayFilter (slot.env, slot.info));
+            slot.gray->init (width, height, opt.radius, opt.eps, 0, 0.0001f, 1.f, cl_algo::GF::Staging::IO);
+        }
+        slot.width = width; slot.height = height;
+    }
+
+    if (color)
+    {
+        pad (image, slot.rgb->hPtrIn, width, height, [] (cl_uchar v) { return v; });
+        slot.rgb->write (RGBFilter::Memory::D_IN, nullptr, CL_FALSE, nullptr, &slot.writeEvent);
+        slot.waitList[0] = slot.writeEvent;
+        slot.rgb->run (&slot.waitList, &slot.runEvent);
+        slot.waitList[0] = slot.runEvent;
+        slot.rgb->read (RGBFilter::Memory::H_OUT, CL_FALSE, &slot.waitList, &slot.readEvent);
+    }
+    else
+    {
+        pad (image, slot.gray->hPtrIn, width, height, [] (cl_uchar v) { return v / 255.f; });
+        slot.gray->write (GrayFilter::Memory::D_IN, nullptr, CL_FALSE, nullptr, &slot.writeEvent);
+        slot.waitList[0] = slot.writeEvent;
+        slot.gray->run (&slot.waitList, &slot.runEvent);
+        slot.waitList[0] = slot.runEvent;
+        slot.gray->read (GrayFilter::Memory::H_OUT, CL_FALSE, &slot.waitList, &slot.readEvent);
+    }
+
+    slot.env.getQueue (slot.info.ctxIdx, slot.info.qIdx[0]).flush ();
+    slot.env.getQueue (slot.info.ctxIdx, slot.info.qIdx[1]).flush ();
+
+    slot.image = std::move (image);
+    slot.busy = true;
+}
+
+
+/*! \brief Waits for the image on a slot, and returns it with the filtered data. */
+Image complete (Slot &slot, Stats &stats)
+{
+    slot.readEvent.wait ();
+
+    Image image = std::move (slot.image);
+    const cl_float *results = (image.channels == 3) ? slot.rgb->hPtrOut : slot.gray->hPtrOut;
+    crop (results, slot.width, image);
+
+    {
+        std::lock_guard<std::mutex> lock (stats.mutex);
+        stats.upload += elapsed (slot.writeEvent, CL_PROFILING_COMMAND_START, slot.writeEvent, CL_PROFILING_COMMAND_END);
+        stats.compute += elapsed (slot.writeEvent, CL_PROFILING_COMMAND_END, slot.runEvent, CL_PROFILING_COMMAND_END);
+        stats.download += elapsed (slot.readEvent, CL_PROFILING_COMMAND_START, slot.readEvent, CL_PROFILING_COMMAND_END);
+    }
+
+    slot.busy = false;
+    return image;
+}
+
+
+/*! \brief Expands directories and list files into a list of image paths. */
+std::vector<std::string> collect (const std::vector<std::string> &inputs)
+{
+    std::vector<std::string> files;
+    for (const auto &input : inputs)
+    {
+        if (input[0] == '@')
+        {
+            std::ifstream fs (input.substr (1));
+            if (!fs) throw std::runtime_error ("Cannot open list file " + input.substr (1));
+            std::string line;
+            while (std::getline (fs, line))
+                if (!line.empty () && line[0] != '#') files.push_back (line);
+            continue;
+        }
+
+        struct stat st;
+        if (stat (input.c_str (), &st) == 0 && S_ISDIR (st.st_mode))
+        {
+            DIR *dir = opendir (input.c_str ());
+            if (dir == nullptr) throw std::runtime_error ("Cannot open directory " + input);
+            std::vector<std::string> entries;
+            while (struct dirent *entry = readdir (dir))
+            {
+                std::string path = input + "/" + entry->d_name;
+                if (entry->d_name[0] != '.' && stat (path.c_str (), &st) == 0 && S_ISREG (st.st_mode))
+                    entries.push_back (path);
+            }
+            closedir (dir);
+            std::sort (entries.begin (), entries.end ());
+            files.insert (files.end (), entries.begin (), entries.end ());
+        }
+        else
+            files.push_back (input);
+    }
+
+    return files;
+}
+
+
+/*! \brief Parses the command line. Invalid options are reported with an exception. */
+Options parse (int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&] () -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error ("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "-o") opt.outDir = value ();
+        else if (arg == "-r") opt.radius = std::stoi (value ());
+        else if (arg == "-e") opt.eps = std::stof (value ());
+        else if (arg == "-j") opt.threads = std::max (std::stoi (value ()), 1);
+        else if (arg == "-d") opt.inFlight = std::max (std::stoi (value ()), 1);
+        else if (arg == "--raw")
+        {
+            std::string dims = value ();
+            std::replace (dims.begin (), dims.end (), 'x', ' ');
+            std::istringstream ss (dims);
+            ss >> opt.rawWidth >> opt.rawHeight;
+            if (!(ss >> opt.rawChannels)) opt.rawChannels = 1;
+            if (opt.rawWidth == 0 || opt.rawHeight == 0 || (opt.rawChannels != 1 && opt.rawChannels != 3))
+                throw std::runtime_error ("Invalid raw dimensions " + dims);
+        }
+        else if (arg[0] == '-' && arg.size () > 1) throw std::runtime_error ("Unknown option " + arg);
+        else opt.inputs.push_back (arg);
+    }
+
+    if (opt.outDir.empty () || opt.inputs.empty ())
+        throw std::runtime_error ("Usage: guided_filter_batch [-r radius] [-e eps] [-j threads] "
+                                  "[-d in-flight] [--raw WxH[xC]] -o <dir> <file|dir|@list>...");
+    if (opt.radius < 1) throw std::runtime_error ("The radius has to be a positive number");
+
+    return opt;
+}
+
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        Options opt = parse (argc, argv);
+        std::vector<std::string> files = collect (opt.inputs);
+        mkdir (opt.outDir.c_str (), 0755);
+
+        // Setup the OpenCL environment (2 profiling queues per slot)
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        for (unsigned int i = 0; i < 2 * opt.inFlight; ++i)
+            clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        std::vector<std::unique_ptr<Slot>> slots;
+        for (unsigned int i = 0; i < opt.inFlight; ++i)
+            slots.emplace_back (new Slot (clEnv, clutils::CLEnvInfo<2> (0, 0, 0, { 2 * i, 2 * i + 1 }, 0)));
+
+        Stats stats;
+        ThreadPool decoders (opt.threads), encoders (opt.threads);
+        std::deque<std::future<Image>> decoded;
+        std::vector<std::future<void>> encoded;
+        std::atomic<unsigned int> failed (0);
+        size_t next = 0, processed = 0;
+
+        // Keeps the decoders ahead of the device, without loading the whole batch in memory
+        auto prefetch = [&] () {
+            while (next < files.size () && decoded.size () < opt.threads + opt.inFlight)
+            {
+                std::string path = files[next++];
+                decoded.push_back (decoders.submit ([path, &opt, &stats] {
+                    auto t0 = std::chrono::high_resolution_clock::now ();
+                    Image image = decode (path, opt);
+                    std::chrono::duration<double, std::milli> t = std::chrono::high_resolution_clock::now () - t0;
+                    std::lock_guard<std::mutex> lock (stats.mutex);
+                    stats.decode += t.count ();
+                    return image;
+                }));
+            }
+        };
+
+        auto write = [&] (Image &&result) {
+            auto image = std::make_shared<Image> (std::move (result));
+            std::string path = opt.outDir + "/" + basename (image->path);
+            encoded.push_back (encoders.submit ([image, path, &stats, &failed] {
+                auto t0 = std::chrono::high_resolution_clock::now ();
+                try
+                {
+                    encode (*image, path);
+                }
+                catch (const std::exception &error)
+                {
+                    std::cerr << "Error[" << path << "]: " << error.what () << std::endl;
+                    ++failed;
+                }
+                std::chrono::duration<double, std::milli> t = std::chrono::high_resolution_clock::now () - t0;
+                std::lock_guard<std::mutex> lock (stats.mutex);
+                stats.encode += t.count ();
+            }));
+            ++processed;
+        };
+
+        auto t0 = std::chrono::high_resolution_clock::now ();
+
+        prefetch ();
+        for (unsigned int k = 0; !decoded.empty (); )
+        {
+            Image image;
+            try
+            {
+                image = decoded.front ().get ();
+            }
+            catch (const std::exception &error)
+            {
+                std::cerr << "Error[" << files[next - decoded.size ()] << "]: " << error.what () << std::endl;
+                ++failed;
+                decoded.pop_front ();
+                prefetch ();
+                continue;
+            }
+            decoded.pop_front ();
+            prefetch ();
+
+            // Slots are used round-robin, so the one to reuse holds the oldest image
+            Slot &slot = *slots[k++ % slots.size ()];
+            if (slot.busy) write (complete (slot, stats));
+            submit (slot, std::move (image), opt);
+        }
+
+        for (auto &slot : slots)
+            if (slot->busy) write (complete (*slot, stats));
+        for (auto &f : encoded) f.wait ();
+
+        std::chrono::duration<double, std::milli> wall = std::chrono::high_resolution_clock::now () - t0;
+
+        // Report throughput and stage utilization
+        const double ms = std::max (wall.count (), 1e-3);
+        auto report = [ms] (const char *stage, double busy, unsigned int workers) {
+            std::cout << "  " << std::left << std::setw (10) << stage << std::right
+                      << std::setw (12) << std::fixed << std::setprecision (1) << busy << " ms"
+                      << std::setw (9) << std::setprecision (1) << 100.0 * busy / (ms * workers) << " %"
+                      << "  (" << workers << ((workers == 1) ? " worker)" : " workers)") << std::endl;
+        };
+
+        std::cout << std::endl << "Processed " << processed << " images (" << failed << " failed) in "
+                  << std::fixed << std::setprecision (3) << ms * 1e-3 << " s: "
+                  << std::setprecision (2) << processed / (ms * 1e-3) << " images/s" << std::endl;
+        std::cout << "Stage utilization (busy time / wall time):" << std::endl;
+        report ("decode", stats.decode, opt.threads);
+        report ("upload", stats.upload, 1);
+        report ("compute", stats.compute, 1);
+        report ("download", stats.download, 1);
+        report ("encode", stats.encode, opt.threads);
+
+        return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ())
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what () << std::endl;
+        exit (EXIT_FAILURE);
+    }
+
+    return 0;
+}
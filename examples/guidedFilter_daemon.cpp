@@ -0,0 +1,608 @@
+/*! \file guidedFilter_daemon.cpp
+ *  \brief A local service that applies the `Guided Filter` algorithm on frames
+ *         of other processes.
+ *  \details Every process that filters a few frames on its own pays for an OpenCL
+ *           context, the compilation of the kernels, and its own device buffers.
+ *           The daemon keeps a warm `GuidedFilterPool` instead, and serves frames
+ *           to any number of local clients (look at `GuidedFilterClient`).
+ *
+ *           The clients connect to a Unix domain socket, which carries only small,
+ *           fixed-size control messages. Each client shares a POSIX shared memory
+ *           segment with the daemon, and the frames are transferred to the device
+ *           straight from the segment, and the results back into it, without any
+ *           intermediate copies. The requests are grouped by shape (resolution and
+ *           parameters), and a worker takes up to `-b` pending requests of the same
+ *           shape at once, and processes them back-to-back on one filter instance,
+ *           with a single synchronization. Statistics are printed on exit.
+ *
+ *           Usage: `guided_filter_daemon [options]` (stop it with Ctrl-C)
+ *           - `-s <path>`: path of the control socket (default: `/tmp/guided_filter.sock`).
+ *           - `-n <int>`: number of filter instances, and workers (default: 4).
+ *           - `-b <int>`: maximum number of requests in a batch (default: 8).
+ *           - `--idle <s>`: idle time after which an instance is released (default: 60).
+ *  \note The frames are `float` gray images, and their dimensions have to be
+ *        multiples of `16` (`serviceAlignment`), up to `8192` (`serviceMaxSide`).
+ *        The radius can be up to `64` (`serviceMaxRadius`), and the window has
+ *        to fit in the frame.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <CLUtils.hpp>
+#include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/pool.hpp>
+#include <GuidedFilter/service.hpp>
+
+
+using cl_algo::GF::ServiceOp;
+using cl_algo::GF::ServiceStatus;
+using cl_algo::GF::ServiceRequest;
+using cl_algo::GF::ServiceReply;
+
+// Kernel filenames
+const std::vector<std::string> kernel_files = { "kernels/imageSupport_kernels.cl",
+                                                "kernels/scan_kernels.cl",
+                                                "kernels/transpose_kernels.cl",
+                                                "kernels/boxFilter_kernels.cl",
+                                                "kernels/math_kernels.cl",
+                                                "kernels/guidedFilter_kernels.cl" };
+
+typedef cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_EQ_P> GrayFilter;
+typedef std::chrono::high_resolution_clock Clock;
+
+std::atomic<bool> running (true);
+
+
+/*! \brief The command line options. */
+struct Options
+{
+    Options () : socketPath (cl_algo::GF::serviceSocketPath), instances (4), batch (8), idle (60)
+    {
+    }
+
+    std::string socketPath;
+    unsigned int instances, batch, idle;
+};
+
+
+/*! \brief Request and batch counters. */
+struct Stats
+{
+    Stats () : requests (0), batches (0), rejected (0), failed (0), clients (0)
+    {
+    }
+
+    std::atomic<size_t> requests, batches, rejected, failed, clients;
+};
+
+
+/*! \brief A connected client, and its shared memory segment.
+ *  \details The object is shared by the pending requests of the client,
+ *           so the segment stays mapped until the last of them has completed,
+ *           even if the client disconnects.
+ */
+struct Client
+{
+    Client (int _fd) : fd (_fd), ptr (nullptr), size (0)
+    {
+    }
+
+    ~Client ()
+    {
+        if (ptr != nullptr) munmap (ptr, size);
+        close (fd);
+    }
+
+    /*! \brief Maps the segment of the client. */
+    bool attach (const char *name, size_t _size)
+    {
+        if (ptr != nullptr || name[0] != '/') return false;
+
+        int shm = shm_open (name, O_RDWR, 0);
+        if (shm < 0) return false;
+
+        struct stat st;
+        if (fstat (shm, &st) != 0 || (size_t) st.st_size < _size || _size == 0)
+        {
+            close (shm);
+            return false;
+        }
+
+        void *p = mmap (nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+        close (shm);
+        if (p == MAP_FAILED) return false;
+
+        ptr = p; size = _size;
+        return true;
+    }
+
+    /*! \brief Sends a reply. Called by the workers and the IO loop. */
+    void reply (const ServiceReply &reply)
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        const char *p = (const char *) &reply;
+        size_t n = sizeof (reply);
+        while (n > 0)
+        {
+            ssize_t k = send (fd, p, n, MSG_NOSIGNAL);
+            if (k < 0 && errno == EINTR) continue;
+            if (k <= 0) return;  // The client is gone
+            p += k; n -= k;
+        }
+    }
+
+    int fd;
+    void *ptr;
+    size_t size;
+    std::mutex mutex;
+    std::vector<char> inbox;  // Partially received request
+};
+
+
+/*! \brief A pending `FILTER` request. */
+struct Request
+{
+    std::shared_ptr<Client> client;
+    ServiceRequest req;
+    Clock::time_point arrival;
+    cl::Event done;
+};
+
+
+/*! \brief The shape of a request (resolution and parameters). */
+typedef std::tuple<uint32_t, uint32_t, int32_t, float> Shape;
+
+
+/*! \brief Groups the pending requests by shape, and hands them out in batches. */
+class Scheduler
+{
+public:
+    Scheduler () : closed (false)
+    {
+    }
+
+    void push (Request &&request)
+    {
+        const ServiceRequest &r = request.req;
+        std::lock_guard<std::mutex> lock (mutex);
+        pending[Shape (r.width, r.height, r.radius, r.eps)].push_back (std::move (request));
+        cv.notify_one ();
+    }
+
+    /*! \brief Takes up to `maxBatch` requests of the shape whose oldest request has waited the longest.
+     *  \return false, if the scheduler has been closed and drained.
+     */
+    bool pop (std::vector<Request> &batch, size_t maxBatch)
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        cv.wait (lock, [this] { return closed || !pending.empty (); });
+        if (pending.empty ()) return false;
+
+        auto oldest = pending.begin ();
+        for (auto it = pending.begin (); it != pending.end (); ++it)
+            if (it->second.front ().arrival < oldest->second.front ().arrival) oldest = it;
+
+        batch.clear ();
+        std::deque<Request> &queue = oldest->second;
+        while (!queue.empty () && batch.size () < maxBatch)
+        {
+            batch.push_back (std::move (queue.front ()));
+            queue.pop_front ();
+        }
+        if (queue.empty ()) pending.erase (oldest);
+
+        return true;
+    }
+
+    /*! \brief Wakes up the workers, which exit when there are no pending requests. */
+    void close ()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        closed = true;
+        cv.notify_all ();
+    }
+
+private:
+    bool closed;
+    std::map<Shape, std::deque<Request>> pending;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+
+/*! \brief Returns the milliseconds elapsed from `t0` to `t1`. */
+double ms (Clock::time_point t0, Clock::time_point t1)
+{
+    return std::chrono::duration<double, std::milli> (t1 - t0).count ();
+}
+
+
+/*! \brief Sends a reply without a payload. */
+void replyStatus (Client &client, uint32_t id, ServiceStatus status)
+{
+    ServiceReply reply;
+    std::memset (&reply, 0, sizeof (reply));
+    reply.id = id;
+    reply.status = (uint32_t) status;
+    client.reply (reply);
+}
+
+
+/*! \brief Processes batches of requests until the scheduler is closed.
+ *  \details The requests of a batch share a filter instance. Their transfers and kernels
+ *           are enqueued back-to-back, each upload waiting for the previous download,
+ *           since they share the device buffers. The replies are sent in order,
+ *           as soon as each download completes. If no instance can be set up
+ *           for the shape, or the pool can't hold another parameter set (all of 
+ *           its keys are in use), the requests of the batch are failed.
+ */
+void serve (cl_algo::GF::GuidedFilterPool &pool, Scheduler &scheduler, Stats &stats, size_t maxBatch)
+{
+    std::vector<Request> batch;
+    while (scheduler.pop (batch, maxBatch))
+    {
+        const ServiceRequest &first = batch[0].req;
+        const size_t bytes = first.width * first.height * sizeof (cl_float);
+        auto dispatch = Clock::now ();
+
+        ServiceStatus status = ServiceStatus::OK;
+        size_t enqueued = 0;
+        cl_algo::GF::GuidedFilterPool::Lease gf;
+
+        try
+        {
+            gf = pool.checkout (first.width, first.height, first.radius, first.eps);
+            if (!gf) throw std::runtime_error ("The pool can't hold any more parameter sets");
+            cl::CommandQueue &queue = gf.queue ();
+            cl::Buffer &dIn = (cl::Buffer &) gf->get (GrayFilter::Memory::D_IN);
+            cl::Buffer &dOut = (cl::Buffer &) gf->get (GrayFilter::Memory::D_OUT);
+
+            std::vector<cl::Event> waitList, writeEvents (1), runEvents (1);
+            for (Request &r : batch)
+            {
+                char *base = (char *) r.client->ptr;
+                queue.enqueueWriteBuffer (dIn, CL_FALSE, 0, bytes, base + r.req.inOffset,
+                                          waitList.empty () ? nullptr : &waitList, &writeEvents[0]);
+                gf->run (&writeEvents, &runEvents[0]);
+                queue.enqueueReadBuffer (dOut, CL_FALSE, 0, bytes, base + r.req.outOffset, &runEvents, &r.done);
+                waitList.assign (1, r.done);
+                ++enqueued;
+            }
+            gf.queue (1).flush ();
+            queue.flush ();
+        }
+        catch (const cl::Error &error)
+        {
+            std::cerr << "Error[worker]: " << error.what () << " ("
+                      << clutils::getOpenCLErrorCodeString (error.err ()) << ")" << std::endl;
+            status = ServiceStatus::FAILED;
+        }
+        catch (const std::exception &error)
+        {
+            std::cerr << "Error[worker]: " << error.what () << std::endl;
+            status = ServiceStatus::FAILED;
+        }
+
+        for (size_t i = 0; i < batch.size (); ++i)
+        {
+            Request &r = batch[i];
+            ServiceReply reply;
+            std::memset (&reply, 0, sizeof (reply));
+            reply.id = r.req.id;
+            reply.batch = batch.size ();
+            reply.status = (uint32_t) status;
+
+            if (i >= enqueued)
+                reply.status = (uint32_t) ServiceStatus::FAILED;
+            else
+            {
+                try { r.done.wait (); }
+                catch (const cl::Error &) { reply.status = (uint32_t) ServiceStatus::FAILED; }
+            }
+
+            // The device is done with the segment, so the client can reuse it
+            auto now = Clock::now ();
+            reply.queueTime = ms (r.arrival, dispatch);
+            reply.serviceTime = ms (dispatch, now);
+            if (reply.status != (uint32_t) ServiceStatus::OK) ++stats.failed;
+            r.client->reply (reply);
+        }
+
+        // Nothing may still be writing to the segments before their requests are released
+        if (status != ServiceStatus::OK && gf) gf.queue ().finish ();
+        batch.clear ();
+
+        stats.requests += enqueued;
+        ++stats.batches;
+    }
+}
+
+
+/*! \brief Validates a request, and either answers it or passes it to the scheduler. */
+void handle (const std::shared_ptr<Client> &client, const ServiceRequest &req,
+             Scheduler &scheduler, Stats &stats)
+{
+    switch ((ServiceOp) req.op)
+    {
+        case ServiceOp::ATTACH:
+        {
+            char name[sizeof (req.name) + 1] = {};
+            std::memcpy (name, req.name, sizeof (req.name));
+            bool ok = client->attach (name, req.size);
+            replyStatus (*client, req.id, ok ? ServiceStatus::OK : ServiceStatus::BAD_SEGMENT);
+            return;
+        }
+
+        case ServiceOp::FILTER:
+        {
+            const uint32_t a = cl_algo::GF::serviceAlignment;
+            const uint64_t bytes = (uint64_t) req.width * req.height * sizeof (cl_float);
+            ServiceStatus status = ServiceStatus::OK;
+
+            if (req.width == 0 || req.height == 0 || req.width % a != 0 || req.height % a != 0)
+                status = ServiceStatus::BAD_SHAPE;
+            else if (req.width > cl_algo::GF::serviceMaxSide || req.height > cl_algo::GF::serviceMaxSide)
+                status = ServiceStatus::BAD_SHAPE;
+            else if (req.radius < 1 || req.radius > cl_algo::GF::serviceMaxRadius ||
+                     2 * (uint32_t) req.radius >= std::min (req.width, req.height) || !(req.eps > 0.f))
+                status = ServiceStatus::BAD_REQUEST;
+            else if (client->ptr == nullptr ||
+                     req.inOffset > client->size || bytes > client->size - req.inOffset ||
+                     req.outOffset > client->size || bytes > client->size - req.outOffset)
+                status = ServiceStatus::BAD_SEGMENT;
+
+            if (status != ServiceStatus::OK)
+            {
+                ++stats.rejected;
+                replyStatus (*client, req.id, status);
+                return;
+            }
+
+            Request request;
+            request.client = client;
+            request.req = req;
+            request.arrival = Clock::now ();
+            scheduler.push (std::move (request));
+            return;
+        }
+
+        default:
+            ++stats.rejected;
+            replyStatus (*client, req.id, ServiceStatus::BAD_REQUEST);
+            return;
+    }
+}
+
+
+/*! \brief Reads the available bytes of a client, and handles the complete requests.
+ *  \return false, if the client has disconnected.
+ */
+bool receive (const std::shared_ptr<Client> &client, Scheduler &scheduler, Stats &stats)
+{
+    char buf[4096];
+    while (true)
+    {
+        ssize_t n = recv (client->fd, buf, sizeof (buf), MSG_DONTWAIT);
+        if (n == 0) return false;
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        std::vector<char> &inbox = client->inbox;
+        inbox.insert (inbox.end (), buf, buf + n);
+        size_t offset = 0;
+        for (; inbox.size () - offset >= sizeof (ServiceRequest); offset += sizeof (ServiceRequest))
+        {
+            ServiceRequest req;
+            std::memcpy (&req, inbox.data () + offset, sizeof (req));
+            handle (client, req, scheduler, stats);
+        }
+        inbox.erase (inbox.begin (), inbox.begin () + offset);
+    }
+}
+
+
+/*! \brief Creates the listening socket. Refuses to replace the socket of a running daemon.
+ *  \details The socket is created with mode `0600`, so that only the owner's processes
+ *           may connect. There is no window in which it's open to others.
+ */
+int listenOn (const std::string &path)
+{
+    sockaddr_un addr;
+    std::memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size () >= sizeof (addr.sun_path))
+        throw std::runtime_error ("The socket path is too long");
+    std::strcpy (addr.sun_path, path.c_str ());
+
+    int probe = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect (probe, (sockaddr *) &addr, sizeof (addr)) == 0)
+    {
+        close (probe);
+        throw std::runtime_error ("Another daemon is listening on " + path);
+    }
+    if (probe >= 0) close (probe);
+    unlink (path.c_str ());  // Stale socket
+
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw std::runtime_error (std::string ("socket: ") + std::strerror (errno));
+    mode_t mask = umask (0177);
+    int bound = bind (fd, (sockaddr *) &addr, sizeof (addr));
+    umask (mask);
+    if (bound != 0 || listen (fd, 64) != 0)
+    {
+        close (fd);
+        throw std::runtime_error ("Cannot listen on " + path + ": " + std::strerror (errno));
+    }
+
+    return fd;
+}
+
+
+/*! \brief Parses the command line. Invalid options are reported with an exception. */
+Options parse (int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&] () -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error ("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "-s") opt.socketPath = value ();
+        else if (arg == "-n") opt.instances = std::max (std::stoi (value ()), 1);
+        else if (arg == "-b") opt.batch = std::max (std::stoi (value ()), 1);
+        else if (arg == "--idle") opt.idle = std::max (std::stoi (value ()), 0);
+        else throw std::runtime_error ("Usage: guided_filter_daemon [-s socket] [-n instances] "
+                                       "[-b batch] [--idle s]");
+    }
+
+    return opt;
+}
+
+
+void onSignal (int)
+{
+    running = false;
+}
+
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        Options opt = parse (argc, argv);
+
+        // Compile the kernels, and create the command queues, once
+        cl_algo::GF::GuidedFilterPool pool (kernel_files, opt.instances);
+        pool.setIdleTimeout (std::chrono::seconds (opt.idle));
+
+        int listenFd = listenOn (opt.socketPath);
+        std::signal (SIGINT, onSignal);
+        std::signal (SIGTERM, onSignal);
+        std::signal (SIGPIPE, SIG_IGN);
+        std::cerr << "Listening on " << opt.socketPath << " with " << opt.instances
+                  << " instances" << std::endl;
+
+        Stats stats;
+        Scheduler scheduler;
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < opt.instances; ++i)
+            workers.emplace_back (serve, std::ref (pool), std::ref (scheduler), std::ref (stats), opt.batch);
+
+        // IO loop
+        auto t0 = Clock::now ();
+        std::vector<std::shared_ptr<Client>> clients;
+        std::vector<pollfd> fds;
+        while (running)
+        {
+            fds.assign (1, pollfd { listenFd, POLLIN, 0 });
+            for (auto &client : clients)
+                fds.push_back (pollfd { client->fd, POLLIN, 0 });
+
+            if (poll (fds.data (), fds.size (), 200) < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::runtime_error (std::string ("poll: ") + std::strerror (errno));
+            }
+
+            for (size_t i = clients.size (); i > 0; --i)
+            {
+                if (fds[i].revents == 0) continue;
+                if (!receive (clients[i - 1], scheduler, stats))
+                    clients.erase (clients.begin () + (i - 1));
+            }
+
+            if (fds[0].revents & POLLIN)
+            {
+                int fd = accept (listenFd, nullptr, nullptr);
+                if (fd >= 0)
+                {
+                    clients.push_back (std::make_shared<Client> (fd));
+                    ++stats.clients;
+                }
+            }
+        }
+
+        // Serve what's pending, and shut down
+        scheduler.close ();
+        for (auto &worker : workers) worker.join ();
+        clients.clear ();
+        close (listenFd);
+        unlink (opt.socketPath.c_str ());
+
+        const double s = std::max (ms (t0, Clock::now ()), 1e-3) * 1e-3;
+        std::cerr << std::endl << "Served " << stats.requests << " requests from " << stats.clients
+                  << " clients in " << std::fixed << std::setprecision (1) << s << " s ("
+                  << std::setprecision (2) << stats.requests / s << " requests/s)" << std::endl;
+        std::cerr << "Batches: " << stats.batches << " (mean size "
+                  << (stats.batches ? (double) stats.requests / stats.batches : 0.0) << ")" << std::endl;
+        std::cerr << "Rejected: " << stats.rejected << ", failed: " << stats.failed << std::endl;
+        std::cerr << "Instances at exit: " << pool.size () << std::endl;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ())
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what () << std::endl;
+        exit (EXIT_FAILURE);
+    }
+
+    return 0;
+}
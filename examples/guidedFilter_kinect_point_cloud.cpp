@@ -5,6 +5,14 @@
  *           algorithm on a live video stream. It processes the Kinect RGB 
  *           and Depth streams in OpenCL with the `GuidedFilter` pipeline. Then,
  *           it creates a point cloud and displays it in an OpenGL window.
+ *
+ *           Usage: `guided_filter_kinect_point_cloud [--record <file> | --replay <file> [--max-rate]]
+ *           [--headless [--frames <n>]]`
+ *           - `--record`: records the RGB and Depth streams while they're being displayed.
+ *           - `--replay`: plays a recording back instead of using a Kinect
+ *             (at the recorded rate, or as fast as possible with `--max-rate`).
+ *           - `--headless`: processes frames without a window, and reports the
+ *             end-to-end latency of every frame pair (from delivery to completion).
  *  \author Nick Lamprianidis
  *  \version 1.2.0
  *  \date 2015
@@ -37,10 +45,11 @@
 #include <vector>
 #include <string>
 #include <chrono>
-#include <mutex>
+#include <thread>
 #include <GL/glew.h>  // Add before CLUtils.hpp
 #include <CLUtils.hpp>
 #include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/tripleBuffer.hpp>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include <GLUT/glut.h>
@@ -49,6 +58,7 @@
 #endif
 
 #include <libfreenect.hpp>
+#include "kinectRecording.hpp"
 
 
 // Window parameters
@@ -65,10 +75,14 @@ float zoom = 1.f;
 GLuint glRGBBuf, glDepthBuf;
 
 // Freenect
+template <typename Device>
 class MyFreenectDevice;
 Freenect::Freenect freenect;
-MyFreenectDevice *device;
+MyFreenectDevice<Freenect::FreenectDevice> *device = nullptr;
+MyFreenectDevice<KinectReplayDevice> *replayDevice = nullptr;
+KinectRecorder *recorder = nullptr;
 double freenectAngle = 0;
+bool headless = false;
 float focalLength = 595.f;
 
 // OpenCL
@@ -94,12 +108,24 @@ enum class Stream : uint8_t { RGB, DEPTH };
 class CLEnvGL : public clutils::CLEnv
 {
 public:
-    /*! \brief Initializes the OpenCL environment. */
-    CLEnvGL () : CLEnv ()
+    /*! \brief Initializes the OpenCL environment.
+     *
+     *  \param[in] gl flag to indicate whether to share the context with OpenGL.
+     */
+    CLEnvGL (bool gl = true) : CLEnv ()
     {
-        addContext (0, true);
-        addQueueGL (0);
-        addQueueGL (0);
+        if (gl)
+        {
+            addContext (0, true);
+            addQueueGL (0);
+            addQueueGL (0);
+        }
+        else
+        {
+            addContext (0);
+            addQueue (0, 0);
+            addQueue (0, 0);
+        }
         addProgram (0, kernel_files);
     }
 
@@ -128,14 +154,18 @@ private:
 class GFilterPC
 {
 public:
-    GFilterPC () : 
-        env (), context (env.getContext (0)), 
+    /*! \param[in] _headless flag to indicate that there is no OpenGL context, 
+     *                       in which case the results stay in plain device buffers.
+     */
+    GFilterPC (bool _headless = false) : 
+        env (!_headless), context (env.getContext (0)), 
         queue0 (env.getQueue (0, 0)), queue1 (env.getQueue (0, 1)), 
         kernelRGBGL (env.getProgram (0), "combineRGBGL_PC"), 
         global (imgWidth * imgHeight), info (0, 0, 0, { 0, 1 }, 0), 
         kGFRGB (env, info), kGFDepth (env, info), to3D (env, info.getCLEnvInfo (0)), 
         bufferSize (imgWidth * imgHeight * sizeof (cl_float)), 
-        waitList (1), normalizeRGB (0)
+        waitList (1), normalizeRGB (0), headless (_headless), 
+        rgbFrames (queue0, 3 * imgWidth * imgHeight), depthFrames (queue0, imgWidth * imgHeight)
     {
         size_t wgMultiple = kernelRGBGL.getWorkGroupInfo
             <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[0][0]);
@@ -146,9 +176,17 @@ public:
         while (pixels % (3 * wgM) != 0) wgM >>= 1;
         local = cl::NDRange (3 * wgM);
 
-        // Create GL-shared buffers
-        buffersGL.emplace_back (context, CL_MEM_WRITE_ONLY, glRGBBuf);
-        buffersGL.emplace_back (context, CL_MEM_WRITE_ONLY, glDepthBuf);
+        // Create GL-shared buffers (or plain buffers, when there is no OpenGL context)
+        if (headless)
+        {
+            buffersCL.emplace_back (context, CL_MEM_WRITE_ONLY, 4 * bufferSize);
+            buffersCL.emplace_back (context, CL_MEM_WRITE_ONLY, 4 * bufferSize);
+        }
+        else
+        {
+            buffersGL.emplace_back (context, CL_MEM_WRITE_ONLY, glRGBBuf);
+            buffersGL.emplace_back (context, CL_MEM_WRITE_ONLY, glDepthBuf);
+        }
 
         // Initialize the Guided Image Filtering pipeline
         kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF::Kinect::GuidedFilterRGBConfig::SEPARATED>
@@ -157,7 +195,7 @@ public:
             ::Memory::D_OUT_G) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
         kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF::Kinect::GuidedFilterRGBConfig::SEPARATED>
             ::Memory::D_OUT_B) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        kGFRGB.init (imgWidth, imgHeight, dRadius, dEps, cl_algo::GF::Staging::I);
+        kGFRGB.init (imgWidth, imgHeight, dRadius, dEps, cl_algo::GF::Staging::NONE);
 
         // Set arguments for the kernel responsible for handling the filtered RGB frame
         kernelRGBGL.setArg (0, kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF
@@ -166,7 +204,7 @@ public:
             ::Kinect::GuidedFilterRGBConfig::SEPARATED>::Memory::D_OUT_G));
         kernelRGBGL.setArg (2, kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF
             ::Kinect::GuidedFilterRGBConfig::SEPARATED>::Memory::D_OUT_B));
-        kernelRGBGL.setArg (3, buffersGL[0]);
+        kernelRGBGL.setArg (3, headless ? (cl::Memory &) buffersCL[0] : (cl::Memory &) buffersGL[0]);
         kernelRGBGL.setArg (4, cl::Local (3 * local[0] * sizeof (cl_float)));
         kernelRGBGL.setArg (5, imgWidth);
         kernelRGBGL.setArg (6, normalizeRGB);
@@ -177,26 +215,41 @@ public:
         // a strong effect on the resulting point cloud.
         kGFDepth.get (cl_algo::GF::Kinect::GuidedFilterDepth::Memory::D_OUT) = 
             cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        kGFDepth.init (imgWidth, imgHeight, dRadius, dEps, dScaling, cl_algo::GF::Staging::I);
+        kGFDepth.init (imgWidth, imgHeight, dRadius, dEps, dScaling, cl_algo::GF::Staging::NONE);
 
         to3D.get (cl_algo::GF::DepthTo3D::Memory::D_IN) = 
             kGFDepth.get (cl_algo::GF::Kinect::GuidedFilterDepth::Memory::D_OUT);
-        to3D.get (cl_algo::GF::DepthTo3D::Memory::D_OUT) = buffersGL[1];
+        to3D.get (cl_algo::GF::DepthTo3D::Memory::D_OUT) = 
+            headless ? (cl::Memory &) buffersCL[1] : (cl::Memory &) buffersGL[1];
         to3D.init (imgWidth, imgHeight, focalLength, 1.f, cl_algo::GF::Staging::NONE);
     }
 
     /*! \brief Processes RGB and Depth frames on the GPU.
      *  \details The processed frame is delivered directly to OpenGL from the GPU.
      *  
-     *  \param[in] rgb RGB frame to be processed.
-     *  \param[in] depth depth frame to be processed.
+     *  \param[in] rgb RGB frame to be processed (a slot of `rgbFrames`).
+     *  \param[in] depth depth frame to be processed (a slot of `depthFrames`).
+     *  \note The frames live in pinned memory, so they're transferred to the device without staging.
      */
     void process (cl_uchar *rgb, cl_ushort *depth)
     {
         // Transfer data to device
-        kGFRGB.write (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF
-            ::Kinect::GuidedFilterRGBConfig::SEPARATED>::Memory::D_IN, rgb);
-        kGFDepth.write (cl_algo::GF::Kinect::GuidedFilterDepth::Memory::D_IN, depth);
+        queue0.enqueueWriteBuffer ((cl::Buffer &) kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF
+            ::Kinect::GuidedFilterRGBConfig::SEPARATED>::Memory::D_IN), CL_FALSE, 0, 
+            3 * imgWidth * imgHeight * sizeof (cl_uchar), rgb);
+        queue0.enqueueWriteBuffer ((cl::Buffer &) kGFDepth.get (cl_algo::GF::Kinect::GuidedFilterDepth::Memory::D_IN), 
+            CL_FALSE, 0, imgWidth * imgHeight * sizeof (cl_ushort), depth);
+
+        if (headless)
+        {
+            kGFRGB.run ();
+            kGFDepth.run ();
+            queue1.enqueueNDRangeKernel (kernelRGBGL, cl::NullRange, global, local);
+            to3D.run ();
+            queue1.finish ();
+            queue0.finish ();
+            return;
+        }
 
         glFinish ();  // Wait for OpenGL pending operations on buffers to finish
 
@@ -306,6 +359,7 @@ private:
     cl::CommandQueue &queue0, &queue1;
     cl::Kernel kernelRGBGL;
     std::vector<cl::BufferGL> buffersGL;  /*!< GL-shared buffers */
+    std::vector<cl::Buffer> buffersCL;  /*!< Output buffers in headless mode */
     cl::NDRange global, local;
     cl::Event event;
     std::vector<cl::Event> waitList;
@@ -315,6 +369,14 @@ private:
     cl_algo::GF::DepthTo3D to3D;
     unsigned int bufferSize;
     int normalizeRGB;
+    bool headless;
+
+public:
+    /*! \brief Pinned frame slots for handing the frames from the callbacks to `process`.
+     *  \note Declared after `queue0`, which they're initialized with.
+     */
+    cl_algo::GF::PinnedTripleBuffer<cl_uchar> rgbFrames;
+    cl_algo::GF::PinnedTripleBuffer<cl_ushort> depthFrames;
 
 };
 
@@ -322,34 +384,41 @@ private:
 /*! \brief A class that extends Freenect::FreenectDevice by defining 
  *         the VideoCallback function so we can be getting updates 
  *         with the latest RGB frame.
+ *  \note `Device` is either `Freenect::FreenectDevice`, for a live Kinect, 
+ *        or `KinectReplayDevice`, for playing back a recording.
  */
-class MyFreenectDevice : public Freenect::FreenectDevice
+template <typename Device>
+class MyFreenectDevice : public Device
 {
 public:
-    /*! \note The creation of the device is done through the Freenect class.
+    /*! \note The creation of a live device is done through the Freenect class.
      *
-     *  \param[in] ctx context to open device through (handled by the library).
-     *  \param[in] idx index of the device on the bus.
+     *  \param[in] args arguments forwarded to the `Device` constructor.
      */
-    MyFreenectDevice (freenect_context *ctx, int idx) : 
-        Freenect::FreenectDevice (ctx, idx), newRGBFrame (false), newDepthFrame (false)
+    template <typename... Args>
+    MyFreenectDevice (Args &&... args) : 
+        Device (std::forward<Args> (args)...), rgbFrames (nullptr), depthFrames (nullptr), 
+        newRGBFrame (false), newDepthFrame (false), replaced (0)
     {
         // setVideoFormat (FREENECT_VIDEO_YUV_RGB, FREENECT_RESOLUTION_MEDIUM);
-        setDepthFormat (FREENECT_DEPTH_REGISTERED);
-
-        rgbBuffer = new cl_uchar[freenect_find_video_mode (
-            FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB).bytes];
-        depthBuffer = new cl_ushort[freenect_find_depth_mode (
-            FREENECT_RESOLUTION_MEDIUM, FREENECT_DEPTH_REGISTERED).bytes / 2];
+        this->setDepthFormat (FREENECT_DEPTH_REGISTERED);
     }
 
-    virtual ~MyFreenectDevice ()
+    /*! \brief Sets the slots the frames are delivered in. Call before starting the streams.
+     *
+     *  \param[in] rgb triple buffer with slots of `getVideoBufferSize ()` bytes.
+     *  \param[in] depth triple buffer with slots of `getDepthBufferSize ()` bytes.
+     */
+    void setFrameBuffers (cl_algo::GF::TripleBuffer<cl_uchar> *rgb, cl_algo::GF::TripleBuffer<cl_ushort> *depth)
     {
-        delete[] rgbBuffer;
-        delete[] depthBuffer;
+        rgbFrames = rgb;
+        depthFrames = depth;
     }
 
     /*! \brief Delivers the latest RGB frame.
+     *  \details The frame is written in the back slot of the triple buffer, and 
+     *           published along with its arrival time. There are no locks 
+     *           between the callback and the rendering thread.
      *  \note Do not call directly, it's only used by the library.
      *  
      *  \param[in] rgb an array holding the rgb frame.
@@ -357,14 +426,16 @@ public:
      */
     void VideoCallback (void *rgb, uint32_t timestamp)
     {
-        std::lock_guard<std::mutex> lock (rgbMutex);
-        
-        std::copy ((cl_uchar *) rgb, (cl_uchar *) rgb + getVideoBufferSize (), rgbBuffer);
-        newRGBFrame = true;
+        if (recorder)
+            recorder->write (KinectStream::RGB, timestamp, rgb, this->getVideoBufferSize ());
+
+        std::copy ((cl_uchar *) rgb, (cl_uchar *) rgb + this->getVideoBufferSize (), rgbFrames->back ());
+        rgbFrames->publish (std::chrono::steady_clock::now ().time_since_epoch ().count ());
     }
 
 
     /*! \brief Delivers the latest Depth frame.
+     *  \details The frame is handed over like the RGB frames.
      *  \note Do not call directly, it's only used by the library.
      *  
      *  \param[in] depth an array holding the depth frame.
@@ -372,27 +443,44 @@ public:
      */
     void DepthCallback (void *depth, uint32_t timestamp)
     {
-        std::lock_guard<std::mutex> lock (depthMutex);
-        
-        std::copy ((cl_ushort *) depth, (cl_ushort *) depth + getDepthBufferSize () / 2, depthBuffer);
-        newDepthFrame = true;
+        if (recorder)
+            recorder->write (KinectStream::DEPTH, timestamp, depth, this->getDepthBufferSize ());
+
+        std::copy ((cl_ushort *) depth, (cl_ushort *) depth + this->getDepthBufferSize () / 2, depthFrames->back ());
+        depthFrames->publish (std::chrono::steady_clock::now ().time_since_epoch ().count ());
     }
 
 
     /*! \brief Processes the most recently received RGB and Depth frames.
+     *  \details A frame that arrives while waiting for the other stream 
+     *           replaces its predecessor, which counts as dropped.
      *  \note The frames are left on the GPU to be handled by OpenGL.
      *
      *  \return A flag to indicate whether new frames were present.
      */
     bool updateFrames ()
     {
-        std::lock_guard<std::mutex> lockRGB (rgbMutex);
-        std::lock_guard<std::mutex> lockDepth (depthMutex);
+        if (rgbFrames->acquire ())
+        {
+            if (newRGBFrame) ++replaced;
+            newRGBFrame = true;
+        }
+        if (depthFrames->acquire ())
+        {
+            if (newDepthFrame) ++replaced;
+            newDepthFrame = true;
+        }
         
         if (!newRGBFrame || !newDepthFrame)
             return false;
 
-        gFilter->process (rgbBuffer, depthBuffer);
+        gFilter->process (rgbFrames->front (), depthFrames->front ());
+
+        // The latency is measured from the older frame of the pair
+        std::chrono::steady_clock::time_point arrival (std::chrono::steady_clock::duration (
+            std::min (rgbFrames->frontStamp (), depthFrames->frontStamp ())));
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now () - arrival;
+        latencies.push_back (latency.count ());
 
         newRGBFrame = false;
         newDepthFrame = false;
@@ -400,11 +488,19 @@ public:
         return true;
     }
 
+    /*! \brief Returns the number of frames that were replaced before being processed. */
+    size_t dropped ()
+    {
+        return rgbFrames->dropped () + depthFrames->dropped () + replaced;
+    }
+
+    std::vector<double> latencies;  /*!< End-to-end latency (in ms) of every processed frame pair. */
+
 private:
-    std::mutex rgbMutex, depthMutex;
-    cl_uchar *rgbBuffer;
-    cl_ushort *depthBuffer;
+    cl_algo::GF::TripleBuffer<cl_uchar> *rgbFrames;
+    cl_algo::GF::TripleBuffer<cl_ushort> *depthFrames;
     bool newRGBFrame, newDepthFrame;
+    size_t replaced;
 
 };
 
@@ -414,7 +510,7 @@ void drawGLScene ()
 {
     static uint8_t frameCount = 0;
 
-    if (device->updateFrames ())
+    if (device ? device->updateFrames () : replayDevice->updateFrames ())
         frameCount++;
 
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -506,6 +602,12 @@ void drawGLScene ()
     paramStr.clear ();
     paramStr << "D.Eps: " << std::fixed << std::setprecision (3) << gFilter->getEps (Stream::DEPTH);
     glRasterPos3f (20.f, 150.f, -20.f);
+    for (auto c : paramStr.str ())
+        glutBitmapCharacter (GLUT_BITMAP_HELVETICA_12, c);
+    paramStr.str (std::string ());
+    paramStr.clear ();
+    paramStr << "Dropped: " << (device ? device->dropped () : replayDevice->dropped ());
+    glRasterPos3f (20.f, 180.f, -20.f);
     for (auto c : paramStr.str ())
         glutBitmapCharacter (GLUT_BITMAP_HELVETICA_12, c);
 
@@ -534,6 +636,9 @@ void resizeGLScene (int width, int height)
 /*! \brief Keyboard callback for the window. */
 void keyPressed (unsigned char key, int x, int y)
 {
+    if (device == nullptr && std::string ("WwSsRr0123456").find (key) != std::string::npos)
+        return;  // No motor or LED on a replayed stream
+
     switch (key)
     {
         case 0x1B:  // ESC
@@ -721,26 +826,102 @@ void printInfo ()
 }
 
 
+/*! \brief Processes frames without a window, and reports the latency of every frame pair.
+ *
+ *  \param[in] maxFrames number of frame pairs to process (0 for no limit).
+ */
+void runHeadless (unsigned int maxFrames)
+{
+    const std::vector<double> &latencies = device ? device->latencies : replayDevice->latencies;
+    auto t0 = std::chrono::steady_clock::now ();
+
+    while (maxFrames == 0 || latencies.size () < maxFrames)
+    {
+        // Checked before the update, so that the last replayed frames are not missed
+        bool last = replayDevice && replayDevice->finished ();
+
+        if (device ? device->updateFrames () : replayDevice->updateFrames ())
+            std::cout << "Frame " << latencies.size () << ": " << std::fixed 
+                      << std::setprecision (3) << latencies.back () << " ms" << std::endl;
+        else if (last)
+            break;
+        else
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - t0;
+    reportLatency (latencies, elapsed.count ());
+    std::cout << "Dropped frames: " << (device ? device->dropped () : replayDevice->dropped ()) << std::endl;
+}
+
+
 int main (int argc, char **argv)
 {
     try
     {
-        printInfo ();
+        std::string recordPath, replayPath;
+        KinectReplayDevice::Rate rate = KinectReplayDevice::Rate::RECORDED;
+        unsigned int maxFrames = 0;
+
+        // Unrecognized arguments are left for GLUT
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+            else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+            else if (arg == "--max-rate") rate = KinectReplayDevice::Rate::MAXIMUM;
+            else if (arg == "--headless") headless = true;
+            else if (arg == "--frames" && i + 1 < argc) maxFrames = std::stoi (argv[++i]);
+        }
+
+        if (!headless) printInfo ();
 
-        device = &freenect.createDevice<MyFreenectDevice> (0);
-        device->startVideo ();
-        device->startDepth ();
+        if (!recordPath.empty ())
+            recorder = new KinectRecorder (recordPath, FREENECT_DEPTH_REGISTERED);
 
-        initGL (argc, argv);
+        if (replayPath.empty ())
+            device = &freenect.createDevice<MyFreenectDevice<Freenect::FreenectDevice>> (0);
+        else
+            replayDevice = new MyFreenectDevice<KinectReplayDevice> (replayPath, rate);
+
+        if (!headless)
+            initGL (argc, argv);
 
         // The OpenCL environment must be created after the OpenGL environment 
         // has been initialized and before OpenGL starts rendering
-        gFilter = new GFilterPC ();
-        
-        glutMainLoop ();
+        gFilter = new GFilterPC (headless);
+
+        // The streams start once the frame slots are in place
+        if (device)
+        {
+            device->setFrameBuffers (&gFilter->rgbFrames, &gFilter->depthFrames);
+            device->startVideo ();
+            device->startDepth ();
+        }
+        else
+        {
+            replayDevice->setFrameBuffers (&gFilter->rgbFrames, &gFilter->depthFrames);
+            replayDevice->startVideo ();
+            replayDevice->startDepth ();
+        }
 
-        device->stopVideo ();
-        device->stopDepth ();
+        if (headless)
+            runHeadless (maxFrames);
+        else
+            glutMainLoop ();
+
+        if (device)
+        {
+            device->stopVideo ();
+            device->stopDepth ();
+        }
+        else
+        {
+            replayDevice->stopVideo ();
+            replayDevice->stopDepth ();
+        }
+        delete replayDevice;
+        delete recorder;
         delete gFilter;
 
         return 0;
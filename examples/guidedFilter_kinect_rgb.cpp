@@ -4,6 +4,14 @@
  *           (http://research.microsoft.com/en-us/um/people/kahe/eccv10/) 
  *           algorithm on a live video stream. It processes the Kinect RGB  
  *           stream in OpenCL with the `GuidedFilter` pipeline.
+ *
+ *           Usage: `guided_filter_kinect_rgb [--record <file> | --replay <file> [--max-rate]]
+ *           [--headless [--frames <n>]]`
+ *           - `--record`: records the RGB stream while it's being displayed.
+ *           - `--replay`: plays a recording back instead of using a Kinect
+ *             (at the recorded rate, or as fast as possible with `--max-rate`).
+ *           - `--headless`: processes frames without a window, and reports the
+ *             end-to-end latency of every frame (from delivery to completion).
  *  \author Nick Lamprianidis
  *  \version 1.2.0
  *  \date 2015
@@ -36,10 +44,11 @@
 #include <vector>
 #include <string>
 #include <chrono>
-#include <mutex>
+#include <thread>
 #include <GL/glew.h>  // Add before CLUtils.hpp
 #include <CLUtils.hpp>
 #include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/tripleBuffer.hpp>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include <GLUT/glut.h>
@@ -48,6 +57,7 @@
 #endif
 
 #include <libfreenect.hpp>
+#include "kinectRecording.hpp"
 
 
 // Window parameters
@@ -59,10 +69,14 @@ int glWinId;
 GLuint glRGBTex, glRGBTexFilt;
 
 // Freenect
+template <typename Device>
 class MyFreenectDevice;
 Freenect::Freenect freenect;
-MyFreenectDevice *device;
+MyFreenectDevice<Freenect::FreenectDevice> *device = nullptr;
+MyFreenectDevice<KinectReplayDevice> *replayDevice = nullptr;
+KinectRecorder *recorder = nullptr;
 double freenectAngle = 0;
+bool headless = false;
 
 // OpenCL
 const std::vector<std::string> kernel_files = { "kernels/imageSupport_kernels.cl", 
@@ -84,12 +98,24 @@ GFilterRGB *gFilter;
 class CLEnvGL : public clutils::CLEnv
 {
 public:
-    /*! \brief Initializes the OpenCL environment. */
-    CLEnvGL () : CLEnv ()
+    /*! \brief Initializes the OpenCL environment.
+     *
+     *  \param[in] gl flag to indicate whether to share the context with OpenGL.
+     */
+    CLEnvGL (bool gl = true) : CLEnv ()
     {
-        addContext (0, true);
-        addQueueGL (0);
-        addQueueGL (0);
+        if (gl)
+        {
+            addContext (0, true);
+            addQueueGL (0);
+            addQueueGL (0);
+        }
+        else
+        {
+            addContext (0);
+            addQueue (0, 0);
+            addQueue (0, 0);
+        }
         addProgram (0, kernel_files);
     }
 
@@ -126,14 +152,18 @@ private:
 class GFilterRGB
 {
 public:
-    GFilterRGB () : 
-        env (), context (env.getContext (0)), 
+    /*! \param[in] _headless flag to indicate that there is no OpenGL context, 
+     *                       in which case the frames are only processed.
+     */
+    GFilterRGB (bool _headless = false) : 
+        env (!_headless), context (env.getContext (0)), 
         queue0 (env.getQueue (0, 0)), queue1 (env.getQueue (0, 1)), 
         kernelGLIn (env.getProgram (0), "combineRGBGL"), 
         kernelGLOut (env.getProgram (0), "combineRGBGL"), 
         global (imgWidth * imgHeight), info (0, 0, 0, { 0, 1 }, 0), 
         kGFRGB (env, info), bufferSize (imgWidth * imgHeight * sizeof (cl_float)), 
-        waitListGLIn (1), waitListGLObj (1), normalizeRGB (0)
+        waitListGLIn (1), waitListGLObj (1), normalizeRGB (0), headless (_headless), 
+        frames (queue0, 3 * imgWidth * imgHeight)
     {
         size_t wgMultiple = kernelGLIn.getWorkGroupInfo
             <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[0][0]);
@@ -151,7 +181,9 @@ public:
             ::Memory::D_OUT_G) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
         kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF::Kinect::GuidedFilterRGBConfig::SEPARATED>
             ::Memory::D_OUT_B) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        kGFRGB.init (imgWidth, imgHeight, dRadius, dEps, cl_algo::GF::Staging::I);
+        kGFRGB.init (imgWidth, imgHeight, dRadius, dEps, cl_algo::GF::Staging::NONE);
+
+        if (headless) return;
 
         // Create GL-shared images
         imagesGL.emplace_back (context, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, glRGBTex);
@@ -185,13 +217,22 @@ public:
     /*! \brief Processes an RGB frame on the GPU.
      *  \details The processed frame is delivered directly to OpenGL from the GPU.
      *  
-     *  \param[in] rgb frame to be processed.
+     *  \param[in] rgb frame to be processed. It's a slot of `frames`, 
+     *                 so it's transferred to the device without staging.
      */
     void process (cl_uchar *rgb)
     {
         // Transfer data to device
-        kGFRGB.write (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF
-            ::Kinect::GuidedFilterRGBConfig::SEPARATED>::Memory::D_IN, rgb);
+        queue0.enqueueWriteBuffer ((cl::Buffer &) kGFRGB.get (cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF
+            ::Kinect::GuidedFilterRGBConfig::SEPARATED>::Memory::D_IN), CL_FALSE, 0, 
+            3 * imgWidth * imgHeight * sizeof (cl_uchar), rgb);
+
+        if (headless)
+        {
+            kGFRGB.run ();
+            queue0.finish ();
+            return;
+        }
 
         glFinish ();  // Wait for OpenGL pending operations on buffers to finish
 
@@ -256,6 +297,7 @@ public:
     void toggleRGBNorm ()
     {
         normalizeRGB = !normalizeRGB;
+        if (headless) return;
         kernelGLIn.setArg (6, normalizeRGB);
         kernelGLOut.setArg (6, normalizeRGB);
     }
@@ -273,6 +315,13 @@ private:
     cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF::Kinect::GuidedFilterRGBConfig::SEPARATED> kGFRGB;
     unsigned int bufferSize;
     int normalizeRGB;
+    bool headless;
+
+public:
+    /*! \brief Pinned frame slots for handing the RGB frames from the callbacks to `process`.
+     *  \note Declared after `queue0`, which it's initialized with.
+     */
+    cl_algo::GF::PinnedTripleBuffer<cl_uchar> frames;
 
 };
 
@@ -280,29 +329,37 @@ private:
 /*! \brief A class that extends Freenect::FreenectDevice by defining 
  *         the VideoCallback function so we can be getting updates 
  *         with the latest RGB frame.
+ *  \note `Device` is either `Freenect::FreenectDevice`, for a live Kinect, 
+ *        or `KinectReplayDevice`, for playing back a recording.
  */
-class MyFreenectDevice : public Freenect::FreenectDevice
+template <typename Device>
+class MyFreenectDevice : public Device
 {
 public:
-    /*! \note The creation of the device is done through the Freenect class.
+    /*! \note The creation of a live device is done through the Freenect class.
      *
-     *  \param[in] ctx context to open device through (handled by the library).
-     *  \param[in] idx index of the device on the bus.
+     *  \param[in] args arguments forwarded to the `Device` constructor.
      */
-    MyFreenectDevice (freenect_context *ctx, int idx) : 
-        Freenect::FreenectDevice (ctx, idx), newRGBFrame (false)
+    template <typename... Args>
+    MyFreenectDevice (Args &&... args) : 
+        Device (std::forward<Args> (args)...), rgbFrames (nullptr)
     {
         // setVideoFormat (FREENECT_VIDEO_YUV_RGB, FREENECT_RESOLUTION_MEDIUM);
-        rgbBuffer = new cl_uchar[freenect_find_video_mode (
-            FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB).bytes];
     }
 
-    virtual ~MyFreenectDevice ()
+    /*! \brief Sets the slots the frames are delivered in. Call before starting the stream.
+     *
+     *  \param[in] frames triple buffer with slots of `getVideoBufferSize ()` bytes.
+     */
+    void setFrameBuffer (cl_algo::GF::TripleBuffer<cl_uchar> *frames)
     {
-        delete[] rgbBuffer;
+        rgbFrames = frames;
     }
 
     /*! \brief Delivers the latest RGB frame.
+     *  \details The frame is written in the back slot of the triple buffer, and 
+     *           published along with its arrival time. There are no locks 
+     *           between the callback and the rendering thread.
      *  \note Do not call directly, it's only used by the library.
      *  
      *  \param[in] rgb an array holding the rgb frame.
@@ -310,10 +367,11 @@ public:
      */
     void VideoCallback (void *rgb, uint32_t timestamp)
     {
-        std::lock_guard<std::mutex> lock (rgbMutex);
-        
-        std::copy ((cl_uchar *) rgb, (cl_uchar *) rgb + getVideoBufferSize (), rgbBuffer);
-        newRGBFrame = true;
+        if (recorder)
+            recorder->write (KinectStream::RGB, timestamp, rgb, this->getVideoBufferSize ());
+
+        std::copy ((cl_uchar *) rgb, (cl_uchar *) rgb + this->getVideoBufferSize (), rgbFrames->back ());
+        rgbFrames->publish (std::chrono::steady_clock::now ().time_since_epoch ().count ());
     }
 
     /*! \brief Processes the most recently received RGB frame.
@@ -323,22 +381,30 @@ public:
      */
     bool updateFrame ()
     {
-        std::lock_guard<std::mutex> lock (rgbMutex);
-        
-        if (!newRGBFrame)
+        cl_uchar *rgb = rgbFrames->acquire ();
+        if (rgb == nullptr)
             return false;
 
-        gFilter->process (rgbBuffer);
+        gFilter->process (rgb);
 
-        newRGBFrame = false;
+        std::chrono::steady_clock::time_point arrival (
+            std::chrono::steady_clock::duration (rgbFrames->frontStamp ()));
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now () - arrival;
+        latencies.push_back (latency.count ());
 
         return true;
     }
 
+    /*! \brief Returns the number of frames that were replaced before being processed. */
+    size_t dropped ()
+    {
+        return rgbFrames->dropped ();
+    }
+
+    std::vector<double> latencies;  /*!< End-to-end latency (in ms) of every processed frame. */
+
 private:
-    std::mutex rgbMutex;
-    cl_uchar *rgbBuffer;
-    bool newRGBFrame;
+    cl_algo::GF::TripleBuffer<cl_uchar> *rgbFrames;
 
 };
 
@@ -348,7 +414,7 @@ void drawGLScene ()
 {
     static uint8_t frameCount = 0;
 
-    if (device->updateFrame ())
+    if (device ? device->updateFrame () : replayDevice->updateFrame ())
         frameCount++;
 
     glClear (GL_COLOR_BUFFER_BIT);
@@ -413,6 +479,14 @@ void drawGLScene ()
     for (auto c : paramStr.str ())
         glutBitmapCharacter (GLUT_BITMAP_HELVETICA_12, c);
 
+    // Display the number of frames that were never processed
+    paramStr.str (std::string ());
+    paramStr.clear ();
+    paramStr << "Dropped: " << (device ? device->dropped () : replayDevice->dropped ());
+    glRasterPos2f (1190.f, 460.f);
+    for (auto c : paramStr.str ())
+        glutBitmapCharacter (GLUT_BITMAP_HELVETICA_12, c);
+
     glutSwapBuffers ();
 }
 
@@ -438,6 +512,9 @@ void resizeGLScene (int width, int height)
 /*! \brief Keyboard callback for the window. */
 void keyPressed (unsigned char key, int x, int y)
 {
+    if (device == nullptr && std::string ("WwSsRr0123456").find (key) != std::string::npos)
+        return;  // No motor or LED on a replayed stream
+
     switch (key)
     {
         case 0x1B:  // ESC
@@ -549,24 +626,92 @@ void printInfo ()
 }
 
 
-int main (int argc, char **argv)
+/*! \brief Processes frames without a window, and reports the latency of every frame.
+ *
+ *  \param[in] maxFrames number of frames to process (0 for no limit).
+ */
+void runHeadless (unsigned int maxFrames)
 {
-    try
+    const std::vector<double> &latencies = device ? device->latencies : replayDevice->latencies;
+    auto t0 = std::chrono::steady_clock::now ();
+
+    while (maxFrames == 0 || latencies.size () < maxFrames)
     {
-        printInfo ();
+        // Checked before the update, so that the last replayed frame is not missed
+        bool last = replayDevice && replayDevice->finished ();
 
-        device = &freenect.createDevice<MyFreenectDevice> (0);
-        device->startVideo ();
+        if (device ? device->updateFrame () : replayDevice->updateFrame ())
+            std::cout << "Frame " << latencies.size () << ": " << std::fixed 
+                      << std::setprecision (3) << latencies.back () << " ms" << std::endl;
+        else if (last)
+            break;
+        else
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - t0;
+    reportLatency (latencies, elapsed.count ());
+    std::cout << "Dropped frames: " << (device ? device->dropped () : replayDevice->dropped ()) << std::endl;
+}
 
-        initGL (argc, argv);
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        std::string recordPath, replayPath;
+        KinectReplayDevice::Rate rate = KinectReplayDevice::Rate::RECORDED;
+        unsigned int maxFrames = 0;
+
+        // Unrecognized arguments are left for GLUT
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+            else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+            else if (arg == "--max-rate") rate = KinectReplayDevice::Rate::MAXIMUM;
+            else if (arg == "--headless") headless = true;
+            else if (arg == "--frames" && i + 1 < argc) maxFrames = std::stoi (argv[++i]);
+        }
+
+        if (!headless) printInfo ();
+
+        if (!recordPath.empty ())
+            recorder = new KinectRecorder (recordPath);
+
+        if (replayPath.empty ())
+            device = &freenect.createDevice<MyFreenectDevice<Freenect::FreenectDevice>> (0);
+        else
+            replayDevice = new MyFreenectDevice<KinectReplayDevice> (replayPath, rate);
+
+        if (!headless)
+            initGL (argc, argv);
 
         // The OpenCL environment must be created after the OpenGL environment 
         // has been initialized and before OpenGL starts rendering
-        gFilter = new GFilterRGB ();
-        
-        glutMainLoop ();
-
-        device->stopVideo ();
+        gFilter = new GFilterRGB (headless);
+
+        // The stream starts once the frame slots are in place
+        if (device)
+        {
+            device->setFrameBuffer (&gFilter->frames);
+            device->startVideo ();
+        }
+        else
+        {
+            replayDevice->setFrameBuffer (&gFilter->frames);
+            replayDevice->startVideo ();
+        }
+
+        if (headless)
+            runHeadless (maxFrames);
+        else
+            glutMainLoop ();
+
+        if (device) device->stopVideo ();
+        else replayDevice->stopVideo ();
+        delete replayDevice;
+        delete recorder;
         delete gFilter;
 
         return 0;
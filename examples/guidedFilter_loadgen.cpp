@@ -0,0 +1,284 @@
+/*! \file guidedFilter_loadgen.cpp
+ *  \brief Generates load for the local `Guided Filter` service, and reports
+ *         its throughput and latency.
+ *  \details Every client thread owns a `GuidedFilterClient`, with its own shared
+ *           segment, and keeps up to `-p` requests in flight. The latency of a
+ *           request is measured from its submission to the arrival of its reply.
+ *           With `--shapes k`, the clients cycle through `k` resolutions (the base
+ *           one, halved, quartered, ...), so the batching of the service can be
+ *           observed under a mixed load. With `--rate`, each client submits at
+ *           a fixed rate (open loop), instead of as fast as possible.
+ *
+ *           Usage: `guided_filter_loadgen [options]`
+ *           - `-s <path>`: path of the control socket (default: `/tmp/guided_filter.sock`).
+ *           - `-c <int>`: number of clients (default: 4).
+ *           - `-n <int>`: number of requests per client (default: 500).
+ *           - `-p <int>`: requests in flight per client (default: 2).
+ *           - `--size <WxH>`: resolution of the frames (default: 640x480).
+ *           - `--shapes <int>`: number of different resolutions (default: 1).
+ *           - `-r <int>`: radius of the filter window (default: 5).
+ *           - `-e <float>`: regularization parameter (default: 0.01).
+ *           - `--rate <fps>`: requests per second per client (default: 0, as fast as possible).
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <cstdio>
+#include <cmath>
+#include <GuidedFilter/service.hpp>
+
+
+using cl_algo::GF::ServiceReply;
+using cl_algo::GF::ServiceStatus;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+
+/*! \brief The command line options. */
+struct Options
+{
+    Options () : socketPath (cl_algo::GF::serviceSocketPath), clients (4), requests (500), depth (2),
+                 width (640), height (480), shapes (1), radius (5), eps (0.01f), rate (0.0)
+    {
+    }
+
+    std::string socketPath;
+    unsigned int clients, requests, depth;
+    unsigned int width, height, shapes;
+    int radius;
+    float eps;
+    double rate;
+};
+
+
+/*! \brief The measurements of a client. */
+struct Results
+{
+    Results () : errors (0), invalid (0), batchSum (0), pixels (0), queueTime (0.0)
+    {
+    }
+
+    std::vector<double> latencies;  // In ms
+    size_t errors, invalid, batchSum, pixels;
+    double queueTime;
+};
+
+
+/*! \brief Returns the `k`-th resolution, i.e. the base one halved `k` times, aligned to the service. */
+std::pair<unsigned int, unsigned int> shape (const Options &opt, unsigned int k)
+{
+    const unsigned int a = cl_algo::GF::serviceAlignment;
+    unsigned int w = std::max (((opt.width >> k) + a - 1) / a * a, a);
+    unsigned int h = std::max (((opt.height >> k) + a - 1) / a * a, a);
+    return std::make_pair (w, h);
+}
+
+
+/*! \brief Runs a client. */
+void run (const Options &opt, unsigned int seed, Results &results)
+{
+    const size_t frameBytes = (size_t) shape (opt, 0).first * shape (opt, 0).second * sizeof (float);
+    cl_algo::GF::GuidedFilterClient client (2 * opt.depth * frameBytes, opt.socketPath);
+    float *base = (float *) client.data ();
+
+    // Every slot holds an input and an output frame
+    std::mt19937 gen (seed);
+    std::uniform_real_distribution<float> dist (0.f, 1.f);
+    std::generate (base, base + client.size () / sizeof (float), [&] { return dist (gen); });
+
+    struct Slot { uint32_t id; unsigned int shape; Clock::time_point sent; };
+    std::vector<Slot> slots (opt.depth);
+    std::vector<bool> busy (opt.depth, false);
+    results.latencies.reserve (opt.requests);
+
+    auto interval = std::chrono::duration<double> (opt.rate > 0.0 ? 1.0 / opt.rate : 0.0);
+    auto next = Clock::now ();
+    unsigned int sent = 0, received = 0;
+
+    auto submit = [&] (unsigned int s) {
+        if (opt.rate > 0.0)
+        {
+            std::this_thread::sleep_until (next);
+            next += std::chrono::duration_cast<Clock::duration> (interval);
+        }
+        unsigned int k = sent % opt.shapes;
+        auto wh = shape (opt, k);
+        slots[s].shape = k;
+        slots[s].sent = Clock::now ();
+        slots[s].id = client.send (wh.first, wh.second, opt.radius, opt.eps,
+                                   2 * s * frameBytes, (2 * s + 1) * frameBytes);
+        busy[s] = true;
+        ++sent;
+    };
+
+    for (unsigned int s = 0; s < opt.depth && sent < opt.requests; ++s)
+        submit (s);
+
+    while (received < sent)
+    {
+        ServiceReply reply = client.receive ();
+        auto now = Clock::now ();
+        ++received;
+
+        unsigned int s = 0;
+        while (s < opt.depth && !(busy[s] && slots[s].id == reply.id)) ++s;
+        if (s == opt.depth) throw std::runtime_error ("Unexpected reply");
+        busy[s] = false;
+
+        if (reply.status != (uint32_t) ServiceStatus::OK)
+            ++results.errors;
+        else
+        {
+            auto wh = shape (opt, slots[s].shape);
+            const float *out = base + (2 * s + 1) * frameBytes / sizeof (float);
+            if (!std::all_of (out, out + wh.first * wh.second, [] (float v) { return std::isfinite (v); }))
+                ++results.invalid;
+
+            results.latencies.push_back (std::chrono::duration<double, std::milli> (now - slots[s].sent).count ());
+            results.batchSum += reply.batch;
+            results.queueTime += reply.queueTime;
+            results.pixels += wh.first * wh.second;
+        }
+
+        if (sent < opt.requests) submit (s);
+    }
+}
+
+
+/*! \brief Returns the `p`-th percentile of sorted values. */
+double percentile (const std::vector<double> &values, double p)
+{
+    if (values.empty ()) return 0.0;
+    size_t rank = std::min ((size_t) std::ceil (p / 100.0 * values.size ()), values.size ());
+    return values[std::max (rank, (size_t) 1) - 1];
+}
+
+
+/*! \brief Parses the command line. Invalid options are reported with an exception. */
+Options parse (int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&] () -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error ("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "-s") opt.socketPath = value ();
+        else if (arg == "-c") opt.clients = std::max (std::stoi (value ()), 1);
+        else if (arg == "-n") opt.requests = std::max (std::stoi (value ()), 1);
+        else if (arg == "-p") opt.depth = std::max (std::stoi (value ()), 1);
+        else if (arg == "--shapes") opt.shapes = std::max (std::stoi (value ()), 1);
+        else if (arg == "-r") opt.radius = std::stoi (value ());
+        else if (arg == "-e") opt.eps = std::stof (value ());
+        else if (arg == "--rate") opt.rate = std::stod (value ());
+        else if (arg == "--size")
+        {
+            std::string v = value ();
+            if (std::sscanf (v.c_str (), "%ux%u", &opt.width, &opt.height) != 2 ||
+                opt.width == 0 || opt.height == 0)
+                throw std::runtime_error ("Invalid size " + v);
+        }
+        else throw std::runtime_error ("Usage: guided_filter_loadgen [-s socket] [-c clients] [-n requests] "
+                                       "[-p depth] [--size WxH] [--shapes k] [-r radius] [-e eps] [--rate fps]");
+    }
+
+    return opt;
+}
+
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        Options opt = parse (argc, argv);
+
+        std::vector<Results> results (opt.clients);
+        std::vector<std::thread> threads;
+        std::mutex mtx;
+        std::string failure;
+
+        auto t0 = Clock::now ();
+        for (unsigned int c = 0; c < opt.clients; ++c)
+            threads.emplace_back ([&, c] {
+                try { run (opt, c + 1, results[c]); }
+                catch (const std::exception &error)
+                {
+                    std::lock_guard<std::mutex> lock (mtx);
+                    failure = error.what ();
+                }
+            });
+        for (auto &thread : threads) thread.join ();
+        const double s = std::chrono::duration<double> (Clock::now () - t0).count ();
+
+        if (!failure.empty ()) throw std::runtime_error (failure);
+
+        // Merge the measurements
+        Results total;
+        for (const Results &r : results)
+        {
+            total.latencies.insert (total.latencies.end (), r.latencies.begin (), r.latencies.end ());
+            total.errors += r.errors; total.invalid += r.invalid;
+            total.batchSum += r.batchSum; total.queueTime += r.queueTime;
+            total.pixels += r.pixels;
+        }
+        std::sort (total.latencies.begin (), total.latencies.end ());
+        const size_t n = total.latencies.size ();
+
+        std::cout << std::fixed << std::setprecision (2);
+        std::cout << "Requests: " << n << " in " << s << " s, "
+                  << "errors: " << total.errors << ", invalid outputs: " << total.invalid << std::endl;
+        std::cout << "Throughput: " << n / s << " frames/s, " << total.pixels / s * 1e-6 << " Mpixels/s" << std::endl;
+        std::cout << "Latency (ms): p50 " << percentile (total.latencies, 50)
+                  << ", p90 " << percentile (total.latencies, 90)
+                  << ", p99 " << percentile (total.latencies, 99)
+                  << ", max " << (n ? total.latencies.back () : 0.0) << std::endl;
+        std::cout << "Mean batch size: " << (n ? (double) total.batchSum / n : 0.0)
+                  << ", mean queueing time in the service: " << (n ? total.queueTime / n : 0.0)
+                  << " ms" << std::endl;
+
+        if (total.errors || total.invalid) return EXIT_FAILURE;
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what () << std::endl;
+        exit (EXIT_FAILURE);
+    }
+
+    return 0;
+}
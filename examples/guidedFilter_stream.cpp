@@ -0,0 +1,582 @@
+/*! \file guidedFilter_stream.cpp
+ *  \brief A filter that applies the `Guided Filter` algorithm on a stream of video frames.
+ *  \details The filter reads Y4M or raw frames from `stdin` (or a file/FIFO),
+ *           performs guided filtering on them, and writes them to `stdout`
+ *           (or a file/FIFO), in the same format. For Y4M streams, only the
+ *           luma plane is filtered, and the chroma planes are passed through.
+ *           Raw streams can hold either gray or interleaved RGB frames.
+ *
+ *           Reading, device upload, compute, download, and writing run
+ *           concurrently. The reader and the writer are separate threads that
+ *           are connected to the device stage through bounded frame queues.
+ *           The device stage keeps several frames in flight, each in its own
+ *           filter instance. When a queue is full, the upstream stage blocks
+ *           (backpressure), or, with `--drop`, the reader discards the frame.
+ *           Dropped frames, and frames whose latency exceeds a deadline, are
+ *           reported at the end, together with the throughput and the
+ *           utilization of every stage. The report goes to `stderr`.
+ *
+ *           Usage: `guided_filter_stream [options] < in.y4m > out.y4m`
+ *           - `-i <path>`, `-o <path>`: input/output file or FIFO (default: `-`, i.e., stdin/stdout).
+ *           - `-r <int>`: filter window radius (default: 7).
+ *           - `-e <float>`: regularization parameter \f$\epsilon\f$ (default: 0.0144).
+ *           - `-d <int>`: number of frames in flight on the device (default: 3).
+ *           - `-q <int>`: capacity of the frame queues (default: 4).
+ *           - `--raw <W>x<H>[x<C>]`: read raw frames (C is 1 or 3, default: 3) instead of Y4M.
+ *           - `--drop`: drop incoming frames, instead of blocking the reader, when the queue is full.
+ *           - `--deadline <ms>`: latency above which a frame counts as late
+ *             (default: 2 frame intervals for Y4M, disabled for raw).
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <CLUtils.hpp>
+#include <GuidedFilter/algorithms.hpp>
+
+
+// Kernel filenames
+const std::vector<std::string> kernel_files = { "kernels/imageSupport_kernels.cl",
+                                                "kernels/scan_kernels.cl",
+                                                "kernels/transpose_kernels.cl",
+                                                "kernels/boxFilter_kernels.cl",
+                                                "kernels/math_kernels.cl",
+                                                "kernels/guidedFilter_kernels.cl" };
+
+typedef cl_algo::GF::Kinect::GuidedFilterRGB<cl_algo::GF::Kinect::GuidedFilterRGBConfig::INTERLEAVED_FLOAT> RGBFilter;
+typedef cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_EQ_P> GrayFilter;
+typedef std::chrono::high_resolution_clock Clock;
+
+// The filters are sized to multiples of this value, and the frames are padded accordingly
+const unsigned int alignment = 16;
+
+
+/*! \brief The command line options. */
+struct Options
+{
+    Options () : input ("-"), output ("-"), radius (7), eps (0.0144f), inFlight (3), capacity (4),
+                 raw (false), rawWidth (0), rawHeight (0), rawChannels (3), drop (false), deadline (-1.0)
+    {
+    }
+
+    std::string input, output;
+    int radius; float eps;
+    unsigned int inFlight, capacity;
+    bool raw; unsigned int rawWidth, rawHeight, rawChannels;
+    bool drop; double deadline;
+};
+
+
+/*! \brief The geometry of the stream. */
+struct StreamInfo
+{
+    unsigned int width, height;
+    unsigned int channels;   // Channels of the filtered plane
+    unsigned int frameSize;  // Bytes per frame (all planes)
+    std::string header;      // Y4M stream header (empty for raw streams)
+    double interval;         // Frame interval in ms (0 if unknown)
+};
+
+
+/*! \brief A frame and its bookkeeping. */
+struct Frame
+{
+    size_t index;
+    std::string tag;  // Y4M frame header
+    std::vector<cl_uchar> data;
+    Clock::time_point arrival;
+};
+
+
+/*! \brief Busy time (in ms) accumulated by each pipeline stage, and frame counters. */
+struct Stats
+{
+    Stats () : read (0.0), upload (0.0), compute (0.0), download (0.0), write (0.0),
+               frames (0), dropped (0), late (0), maxLatency (0.0)
+    {
+    }
+
+    double read, upload, compute, download, write;
+    std::atomic<size_t> frames, dropped, late;
+    double maxLatency;
+};
+
+
+/*! \brief A FIFO queue of bounded capacity that connects two pipeline stages. */
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue (size_t _capacity) : capacity (_capacity), closed (false)
+    {
+    }
+
+    /*! \brief Inserts an item, blocking while the queue is full. */
+    void push (T &&item)
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        notFull.wait (lock, [this] { return items.size () < capacity; });
+        items.push_back (std::move (item));
+        notEmpty.notify_one ();
+    }
+
+    /*! \brief Inserts an item, unless the queue is full. */
+    bool tryPush (T &&item)
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        if (items.size () >= capacity) return false;
+        items.push_back (std::move (item));
+        notEmpty.notify_one ();
+        return true;
+    }
+
+    /*! \brief Removes an item, blocking while the queue is empty.
+     *  \return false, if the queue has been closed and drained.
+     */
+    bool pop (T &item)
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        notEmpty.wait (lock, [this] { return closed || !items.empty (); });
+        if (items.empty ()) return false;
+        item = std::move (items.front ());
+        items.pop_front ();
+        notFull.notify_one ();
+        return true;
+    }
+
+    /*! \brief Signals that no more items will be inserted. */
+    void close ()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        closed = true;
+        notEmpty.notify_all ();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+};
+
+
+/*! \brief A filter instance, together with the frame it currently processes. */
+struct Slot
+{
+    Slot (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) :
+        env (_env), info (_info), busy (false), waitList (1)
+    {
+    }
+
+    clutils::CLEnv &env;
+    clutils::CLEnvInfo<2> info;
+    std::unique_ptr<RGBFilter> rgb;
+    std::unique_ptr<GrayFilter> gray;
+    bool busy;
+    Frame frame;
+    cl::Event writeEvent, runEvent, readEvent;
+    std::vector<cl::Event> waitList;
+};
+
+
+/*! \brief Returns the milliseconds elapsed since `t0`. */
+double since (Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli> (Clock::now () - t0).count ();
+}
+
+
+/*! \brief Returns the duration (in ms) between two profiling points of the given events. */
+double elapsed (const cl::Event &from, cl_profiling_info fromInfo, const cl::Event &to, cl_profiling_info toInfo)
+{
+    cl_ulong start, end;
+    from.getProfilingInfo (fromInfo, &start);
+    to.getProfilingInfo (toInfo, &end);
+    return (end > start) ? (end - start) * 1e-6 : 0.0;
+}
+
+
+/*! \brief Reads a line (without the newline) from a stream. */
+bool readLine (FILE *fs, std::string &line)
+{
+    line.clear ();
+    int c;
+    while ((c = std::fgetc (fs)) != EOF && c != '\n') line.push_back ((char) c);
+    return c != EOF || !line.empty ();
+}
+
+
+/*! \brief Reads the stream header, and determines the frame geometry. */
+StreamInfo readHeader (FILE *fs, const Options &opt)
+{
+    StreamInfo info;
+    info.interval = 0.0;
+
+    if (opt.raw)
+    {
+        info.width = opt.rawWidth; info.height = opt.rawHeight; info.channels = opt.rawChannels;
+        info.frameSize = info.width * info.height * info.channels;
+        return info;
+    }
+
+    if (!readLine (fs, info.header) || info.header.compare (0, 10, "YUV4MPEG2 ") != 0)
+        throw std::runtime_error ("The input is not a Y4M stream (use --raw for raw frames)");
+
+    std::string colorspace = "420";
+    info.width = info.height = 0;
+    std::istringstream ss (info.header.substr (10));
+    std::string param;
+    while (ss >> param)
+    {
+        switch (param[0])
+        {
+            case 'W': info.width = std::stoi (param.substr (1)); break;
+            case 'H': info.height = std::stoi (param.substr (1)); break;
+            case 'C': colorspace = param.substr (1); break;
+            case 'F':
+            {
+                size_t colon = param.find (':');
+                if (colon != std::string::npos)
+                {
+                    double n = std::stod (param.substr (1, colon - 1)), d = std::stod (param.substr (colon + 1));
+                    if (n > 0) info.interval = 1000.0 * d / n;
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+
+    if (info.width == 0 || info.height == 0) throw std::runtime_error ("The Y4M header lacks the frame dimensions");
+
+    const unsigned int w = info.width, h = info.height, cw = (w + 1) / 2, ch = (h + 1) / 2;
+    // Suffixes like p10 denote more than 8 bits per sample
+    const bool deep = colorspace.size () > 4 && colorspace[3] == 'p' && std::isdigit (colorspace[4]);
+    unsigned int chroma;
+    if (deep) chroma = 0;
+    else if (colorspace.compare (0, 3, "420") == 0) chroma = 2 * cw * ch;
+    else if (colorspace == "422") chroma = 2 * cw * h;
+    else if (colorspace == "444") chroma = 2 * w * h;
+    else if (colorspace == "mono") chroma = 0;
+    if (deep || (chroma == 0 && colorspace != "mono"))
+        throw std::runtime_error ("Unsupported Y4M colorspace C" + colorspace + " (only 8-bit is supported)");
+
+    info.channels = 1;  // Only the luma plane is filtered
+    info.frameSize = w * h + chroma;
+    return info;
+}
+
+
+/*! \brief Copies a plane into a buffer of padded dimensions, replicating the border pixels. */
+template <typename T, typename F>
+void pad (const cl_uchar *src, const StreamInfo &info, T *dst, unsigned int width, unsigned int height, F convert)
+{
+    const unsigned int c = info.channels;
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const cl_uchar *row = src + std::min (y, info.height - 1) * info.width * c;
+        T *out = dst + y * width * c;
+        for (unsigned int x = 0; x < width * c; ++x)
+            out[x] = convert (row[std::min (x, (info.width - 1) * c + x % c)]);
+    }
+}
+
+
+/*! \brief Copies the valid region of a padded result back into a plane. */
+void crop (const cl_float *src, unsigned int width, const StreamInfo &info, cl_uchar *dst)
+{
+    const unsigned int c = info.channels;
+    for (unsigned int y = 0; y < info.height; ++y)
+    {
+        const cl_float *row = src + y * width * c;
+        cl_uchar *out = dst + y * info.width * c;
+        for (unsigned int x = 0; x < info.width * c; ++x)
+            out[x] = (cl_uchar) std::min (std::max (row[x] * 255.f + 0.5f, 0.f), 255.f);
+    }
+}
+
+
+/*! \brief Parses the command line. Invalid options are reported with an exception. */
+Options parse (int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&] () -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error ("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "-i") opt.input = value ();
+        else if (arg == "-o") opt.output = value ();
+        else if (arg == "-r") opt.radius = std::stoi (value ());
+        else if (arg == "-e") opt.eps = std::stof (value ());
+        else if (arg == "-d") opt.inFlight = std::max (std::stoi (value ()), 1);
+        else if (arg == "-q") opt.capacity = std::max (std::stoi (value ()), 1);
+        else if (arg == "--drop") opt.drop = true;
+        else if (arg == "--deadline") opt.deadline = std::stod (value ());
+        else if (arg == "--raw")
+        {
+            std::string dims = value ();
+            std::replace (dims.begin (), dims.end (), 'x', ' ');
+            std::istringstream ss (dims);
+            ss >> opt.rawWidth >> opt.rawHeight;
+            if (!(ss >> opt.rawChannels)) opt.rawChannels = 3;
+            if (opt.rawWidth == 0 || opt.rawHeight == 0 || (opt.rawChannels != 1 && opt.rawChannels != 3))
+                throw std::runtime_error ("Invalid raw dimensions " + dims);
+            opt.raw = true;
+        }
+        else throw std::runtime_error ("Usage: guided_filter_stream [-i in] [-o out] [-r radius] [-e eps] "
+                                       "[-d in-flight] [-q capacity] [--raw WxH[xC]] [--drop] [--deadline ms]");
+    }
+
+    if (opt.radius < 1) throw std::runtime_error ("The radius has to be a positive number");
+
+    return opt;
+}
+
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        Options opt = parse (argc, argv);
+
+        FILE *in = (opt.input == "-") ? stdin : std::fopen (opt.input.c_str (), "rb");
+        if (in == nullptr) throw std::runtime_error ("Cannot open " + opt.input);
+        FILE *out = (opt.output == "-") ? stdout : std::fopen (opt.output.c_str (), "wb");
+        if (out == nullptr) throw std::runtime_error ("Cannot open " + opt.output);
+
+        const StreamInfo info = readHeader (in, opt);
+        const double deadline = (opt.deadline >= 0.0) ? opt.deadline : 2.0 * info.interval;
+        const unsigned int width = (info.width + alignment - 1) / alignment * alignment;
+        const unsigned int height = (info.height + alignment - 1) / alignment * alignment;
+        const bool color = (info.channels == 3);
+
+        // Setup the OpenCL environment (2 profiling queues per slot)
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        for (unsigned int i = 0; i < 2 * opt.inFlight; ++i)
+            clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        std::vector<std::unique_ptr<Slot>> slots;
+        for (unsigned int i = 0; i < opt.inFlight; ++i)
+        {
+            Slot *slot = new Slot (clEnv, clutils::CLEnvInfo<2> (0, 0, 0, { 2 * i, 2 * i + 1 }, 0));
+            if (color)
+            {
+                slot->rgb.reset (new RGBFilter (clEnv, slot->info));
+                slot->rgb->init (width, height, opt.radius, opt.eps, cl_algo::GF::Staging::IO);
+            }
+            else
+            {
+                slot->gray.reset (new GrayFilter (clEnv, slot->info));
+                slot->gray->init (width, height, opt.radius, opt.eps, 0, 0.0001f, 1.f, cl_algo::GF::Staging::IO);
+            }
+            slots.emplace_back (slot);
+        }
+
+        Stats stats;
+        BoundedQueue<Frame> inQueue (opt.capacity), outQueue (opt.capacity);
+        std::atomic<bool> failed (false);
+        auto t0 = Clock::now ();
+
+        // Reader stage
+        std::thread reader ([&] {
+            for (size_t index = 0; ; ++index)
+            {
+                auto t = Clock::now ();
+                Frame frame;
+                if (!opt.raw)
+                {
+                    if (!readLine (in, frame.tag)) break;
+                    if (frame.tag.compare (0, 5, "FRAME") != 0)
+                    {
+                        std::cerr << "Error[reader]: Malformed Y4M frame header" << std::endl;
+                        failed = true; break;
+                    }
+                }
+                frame.data.resize (info.frameSize);
+                size_t n = std::fread (frame.data.data (), 1, info.frameSize, in);
+                if (n != info.frameSize)
+                {
+                    if (n != 0 || !opt.raw)
+                        std::cerr << "Warning[reader]: Discarded a truncated frame at the end of the stream" << std::endl;
+                    break;
+                }
+                frame.index = index;
+                frame.arrival = Clock::now ();
+                stats.read += since (t);
+
+                if (opt.drop)
+                {
+                    if (!inQueue.tryPush (std::move (frame))) ++stats.dropped;
+                }
+                else
+                    inQueue.push (std::move (frame));
+            }
+            inQueue.close ();
+        });
+
+        // Writer stage
+        std::thread writer ([&] {
+            bool header = info.header.empty ();
+            Frame frame;
+            while (outQueue.pop (frame))
+            {
+                auto t = Clock::now ();
+                if (!header)
+                {
+                    std::fprintf (out, "%s\n", info.header.c_str ());
+                    header = true;
+                }
+                if (!opt.raw) std::fprintf (out, "%s\n", frame.tag.c_str ());
+                if (std::fwrite (frame.data.data (), 1, frame.data.size (), out) != frame.data.size ())
+                {
+                    std::cerr << "Error[writer]: Cannot write to " << opt.output << std::endl;
+                    failed = true;
+                }
+                std::fflush (out);
+                stats.write += since (t);
+
+                double latency = since (frame.arrival);
+                stats.maxLatency = std::max (stats.maxLatency, latency);
+                if (deadline > 0.0 && latency > deadline) ++stats.late;
+                ++stats.frames;
+            }
+        });
+
+        // Device stage: slots are used round-robin, so the one to reuse holds the oldest frame
+        auto complete = [&] (Slot &slot) {
+            slot.readEvent.wait ();
+            const cl_float *results = color ? slot.rgb->hPtrOut : slot.gray->hPtrOut;
+            crop (results, width, info, slot.frame.data.data ());
+            stats.upload += elapsed (slot.writeEvent, CL_PROFILING_COMMAND_START, slot.writeEvent, CL_PROFILING_COMMAND_END);
+            stats.compute += elapsed (slot.writeEvent, CL_PROFILING_COMMAND_END, slot.runEvent, CL_PROFILING_COMMAND_END);
+            stats.download += elapsed (slot.readEvent, CL_PROFILING_COMMAND_START, slot.readEvent, CL_PROFILING_COMMAND_END);
+            slot.busy = false;
+            outQueue.push (std::move (slot.frame));
+        };
+
+        Frame frame;
+        for (unsigned int k = 0; inQueue.pop (frame); ++k)
+        {
+            Slot &slot = *slots[k % slots.size ()];
+            if (slot.busy) complete (slot);
+
+            if (color)
+            {
+                pad (frame.data.data (), info, slot.rgb->hPtrIn, width, height, [] (cl_uchar v) { return v; });
+                slot.rgb->write (RGBFilter::Memory::D_IN, nullptr, CL_FALSE, nullptr, &slot.writeEvent);
+                slot.waitList[0] = slot.writeEvent;
+                slot.rgb->run (&slot.waitList, &slot.runEvent);
+                slot.waitList[0] = slot.runEvent;
+                slot.rgb->read (RGBFilter::Memory::H_OUT, CL_FALSE, &slot.waitList, &slot.readEvent);
+            }
+            else
+            {
+                pad (frame.data.data (), info, slot.gray->hPtrIn, width, height, [] (cl_uchar v) { return v / 255.f; });
+                slot.gray->write (GrayFilter::Memory::D_IN, nullptr, CL_FALSE, nullptr, &slot.writeEvent);
+                slot.waitList[0] = slot.writeEvent;
+                slot.gray->run (&slot.waitList, &slot.runEvent);
+                slot.waitList[0] = slot.runEvent;
+                slot.gray->read (GrayFilter::Memory::H_OUT, CL_FALSE, &slot.waitList, &slot.readEvent);
+            }
+            clEnv.getQueue (0, slot.info.qIdx[0]).flush ();
+            clEnv.getQueue (0, slot.info.qIdx[1]).flush ();
+
+            slot.frame = std::move (frame);
+            slot.busy = true;
+        }
+
+        for (unsigned int k = 0; k < slots.size (); ++k)
+            if (slots[k]->busy) complete (*slots[k]);
+        outQueue.close ();
+
+        reader.join ();
+        writer.join ();
+        if (in != stdin) std::fclose (in);
+        if (out != stdout) std::fclose (out);
+
+        // Report throughput, frame counters, and stage utilization
+        const double ms = std::max (since (t0), 1e-3);
+        auto report = [ms] (const char *stage, double busy) {
+            std::cerr << "  " << std::left << std::setw (10) << stage << std::right
+                      << std::setw (12) << std::fixed << std::setprecision (1) << busy << " ms"
+                      << std::setw (9) << std::setprecision (1) << 100.0 * busy / ms << " %" << std::endl;
+        };
+
+        std::cerr << std::endl << "Filtered " << stats.frames << " frames of " << info.width << "x" << info.height
+                  << " in " << std::fixed << std::setprecision (3) << ms * 1e-3 << " s: "
+                  << std::setprecision (2) << stats.frames / (ms * 1e-3) << " fps" << std::endl;
+        std::cerr << "Dropped frames: " << stats.dropped << std::endl;
+        std::cerr << "Late frames: " << stats.late;
+        if (deadline > 0.0) std::cerr << " (deadline " << std::setprecision (1) << deadline << " ms)";
+        else std::cerr << " (no deadline)";
+        std::cerr << ", max latency " << std::setprecision (1) << stats.maxLatency << " ms" << std::endl;
+        std::cerr << "Stage utilization (busy time / wall time):" << std::endl;
+        report ("read", stats.read);
+        report ("upload", stats.upload);
+        report ("compute", stats.compute);
+        report ("download", stats.download);
+        report ("write", stats.write);
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ())
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what () << std::endl;
+        exit (EXIT_FAILURE);
+    }
+
+    return 0;
+}
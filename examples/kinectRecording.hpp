@@ -0,0 +1,419 @@
+/*! \file kinectRecording.hpp
+ *  \brief Recording and replay of `Kinect` RGB and Depth streams.
+ *  \details A recording is a single file that holds timestamped frames
+ *           in the order they were delivered by libfreenect. The file
+ *           starts with a `KinectRecordingHeader`, and every frame is
+ *           stored as a `KinectRecordHeader` followed by the raw frame
+ *           data. Records are 64-byte aligned, so a recording can be
+ *           memory-mapped and its frames handed out without copies.
+ *           `KinectReplayDevice` plays a recording back through the same
+ *           `VideoCallback`/`DepthCallback` interface that
+ *           `Freenect::FreenectDevice` offers, at the recorded rate or
+ *           as fast as possible, so the examples can run without a `Kinect`.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_KINECTRECORDING_HPP
+#define GF_KINECTRECORDING_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libfreenect.h>
+
+
+/*! \brief Identifies the stream a recorded frame belongs to. */
+enum class KinectStream : uint32_t
+{
+    RGB = 0,   /*!< RGB frame, `FREENECT_VIDEO_RGB`. */
+    DEPTH = 1  /*!< Depth frame, in the recorded depth format. */
+};
+
+
+/*! \brief The header at the beginning of a recording (64 bytes). */
+struct KinectRecordingHeader
+{
+    char magic[8];         /*!< "GFKINECT". */
+    uint32_t version;      /*!< Format version. */
+    uint32_t width;        /*!< Frame width. */
+    uint32_t height;       /*!< Frame height. */
+    uint32_t rgbBytes;     /*!< Size of an RGB frame in bytes. */
+    uint32_t depthBytes;   /*!< Size of a Depth frame in bytes. */
+    uint32_t depthFormat;  /*!< The `freenect_depth_format` of the Depth frames. */
+    uint32_t frames;       /*!< Number of records (0, if the recording was not closed properly). */
+    uint32_t reserved[7];
+};
+
+
+/*! \brief The header in front of every recorded frame (64 bytes). */
+struct KinectRecordHeader
+{
+    uint32_t stream;     /*!< A `KinectStream` value. */
+    uint32_t timestamp;  /*!< Device timestamp delivered by libfreenect. */
+    uint64_t hostTime;   /*!< Host arrival time, in ns since the start of the recording. */
+    uint32_t bytes;      /*!< Size of the frame data. */
+    uint32_t reserved[11];
+};
+
+
+/*! \brief Appends timestamped `Kinect` frames to a recording.
+ *  \details Frames can be written from the libfreenect callbacks.
+ *           Writes are serialized, so both streams can share a recorder.
+ */
+class KinectRecorder
+{
+public:
+    /*! \brief Creates a recording.
+     *
+     *  \param[in] path file name of the recording.
+     *  \param[in] depthFormat format of the Depth frames that will be recorded.
+     */
+    KinectRecorder (const std::string &path, freenect_depth_format depthFormat = FREENECT_DEPTH_REGISTERED) :
+        start (std::chrono::steady_clock::now ())
+    {
+        fs = std::fopen (path.c_str (), "wb");
+        if (fs == nullptr)
+            throw std::runtime_error ("Cannot create recording " + path);
+
+        std::memset (&header, 0, sizeof (header));
+        std::memcpy (header.magic, "GFKINECT", 8);
+        header.version = 1;
+        header.width = 640; header.height = 480;
+        header.rgbBytes = freenect_find_video_mode (FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB).bytes;
+        header.depthBytes = freenect_find_depth_mode (FREENECT_RESOLUTION_MEDIUM, depthFormat).bytes;
+        header.depthFormat = depthFormat;
+        std::fwrite (&header, sizeof (header), 1, fs);
+    }
+
+    /*! \brief Finalizes the recording. */
+    ~KinectRecorder ()
+    {
+        std::fseek (fs, 0, SEEK_SET);
+        std::fwrite (&header, sizeof (header), 1, fs);
+        std::fclose (fs);
+    }
+
+    /*! \brief Appends a frame to the recording.
+     *
+     *  \param[in] stream stream the frame belongs to.
+     *  \param[in] timestamp device timestamp of the frame.
+     *  \param[in] data frame data.
+     *  \param[in] bytes size of the frame data.
+     */
+    void write (KinectStream stream, uint32_t timestamp, const void *data, uint32_t bytes)
+    {
+        KinectRecordHeader record;
+        std::memset (&record, 0, sizeof (record));
+        record.stream = (uint32_t) stream;
+        record.timestamp = timestamp;
+        record.hostTime = std::chrono::duration_cast<std::chrono::nanoseconds> (
+            std::chrono::steady_clock::now () - start).count ();
+        record.bytes = bytes;
+
+        static const char padding[64] = { 0 };
+        std::lock_guard<std::mutex> lock (mutex);
+        std::fwrite (&record, sizeof (record), 1, fs);
+        std::fwrite (data, 1, bytes, fs);
+        std::fwrite (padding, 1, (64 - bytes % 64) % 64, fs);
+        header.frames++;
+    }
+
+    /*! \brief Returns the number of frames written so far. */
+    uint32_t frames ()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        return header.frames;
+    }
+
+private:
+    std::FILE *fs;
+    KinectRecordingHeader header;
+    std::chrono::steady_clock::time_point start;
+    std::mutex mutex;
+
+};
+
+
+/*! \brief A memory-mapped, read-only view of a recording. */
+class KinectRecording
+{
+public:
+    /*! \brief A recorded frame. `data` points into the mapping. */
+    struct Frame
+    {
+        KinectStream stream;
+        uint32_t timestamp;
+        uint64_t hostTime;
+        void *data;
+        uint32_t bytes;
+    };
+
+    /*! \brief Maps a recording, and indexes its frames.
+     *  \note A recording that was cut short is read up to its last complete frame.
+     *
+     *  \param[in] path file name of the recording.
+     */
+    KinectRecording (const std::string &path)
+    {
+        int fd = open (path.c_str (), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error ("Cannot open recording " + path);
+
+        struct stat st;
+        fstat (fd, &st);
+        size = st.st_size;
+        if (size < sizeof (KinectRecordingHeader))
+        {
+            close (fd);
+            throw std::runtime_error ("The recording " + path + " is empty");
+        }
+
+        // A private writable mapping lets the callbacks receive non-const
+        // pointers, like the ones libfreenect delivers, without touching the file
+        base = (uint8_t *) mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close (fd);
+        if (base == MAP_FAILED)
+            throw std::runtime_error ("Cannot map recording " + path);
+
+        std::memcpy (&hdr, base, sizeof (hdr));
+        if (std::memcmp (hdr.magic, "GFKINECT", 8) != 0 || hdr.version != 1)
+        {
+            munmap (base, size);
+            throw std::runtime_error (path + " is not a Kinect recording");
+        }
+
+        size_t offset = sizeof (KinectRecordingHeader);
+        while (offset + sizeof (KinectRecordHeader) <= size)
+        {
+            const KinectRecordHeader *record = (const KinectRecordHeader *) (base + offset);
+            offset += sizeof (KinectRecordHeader);
+            if (offset + record->bytes > size) break;
+
+            frames.push_back ({ (KinectStream) record->stream, record->timestamp,
+                                record->hostTime, base + offset, record->bytes });
+            offset += (record->bytes + 63) / 64 * 64;
+        }
+    }
+
+    ~KinectRecording ()
+    {
+        munmap (base, size);
+    }
+
+    /*! \brief Returns the recording header. */
+    const KinectRecordingHeader& header () const
+    {
+        return hdr;
+    }
+
+    std::vector<Frame> frames;  /*!< The recorded frames in delivery order. */
+
+private:
+    uint8_t *base;
+    size_t size;
+    KinectRecordingHeader hdr;
+
+};
+
+
+/*! \brief Plays a recording back through the `Freenect::FreenectDevice` callback interface.
+ *  \details The class offers the subset of the `Freenect::FreenectDevice` interface
+ *           that the examples use, so a device class can derive from either one.
+ *           Playback runs on a separate thread, like the libfreenect event thread,
+ *           and starts as soon as one of the streams is started.
+ *  \note Stop the streams before destroying a derived object, so that no
+ *        callbacks are in progress while its members are being destroyed.
+ */
+class KinectReplayDevice
+{
+public:
+    /*! \brief Enumerates the playback rates. */
+    enum class Rate : uint8_t
+    {
+        RECORDED,  /*!< Frames are delivered with their recorded timing. */
+        MAXIMUM    /*!< Frames are delivered back-to-back. */
+    };
+
+    /*! \brief Opens a recording for playback.
+     *
+     *  \param[in] path file name of the recording.
+     *  \param[in] _rate playback rate.
+     */
+    KinectReplayDevice (const std::string &path, Rate _rate = Rate::RECORDED) :
+        recording (path), rate (_rate), video (false), depth (false), running (false), done (false)
+    {
+    }
+
+    virtual ~KinectReplayDevice ()
+    {
+        halt ();
+    }
+
+    /*! \brief Delivers an RGB frame. Override, as with `Freenect::FreenectDevice`. */
+    virtual void VideoCallback (void *rgb, uint32_t timestamp)
+    {
+    }
+
+    /*! \brief Delivers a Depth frame. Override, as with `Freenect::FreenectDevice`. */
+    virtual void DepthCallback (void *depth, uint32_t timestamp)
+    {
+    }
+
+    void startVideo ()
+    {
+        video = true; launch ();
+    }
+
+    void stopVideo ()
+    {
+        video = false;
+        if (!depth) halt ();
+    }
+
+    void startDepth ()
+    {
+        depth = true; launch ();
+    }
+
+    void stopDepth ()
+    {
+        depth = false;
+        if (!video) halt ();
+    }
+
+    /*! \brief Verifies that the recording holds frames of the requested format. */
+    void setDepthFormat (freenect_depth_format format,
+                         freenect_resolution resolution = FREENECT_RESOLUTION_MEDIUM)
+    {
+        if ((uint32_t) format != recording.header ().depthFormat || resolution != FREENECT_RESOLUTION_MEDIUM)
+            throw std::runtime_error ("The requested depth format does not match the recording");
+    }
+
+    void setTiltDegrees (double angle)
+    {
+    }
+
+    void setLed (freenect_led_options option)
+    {
+    }
+
+    int getVideoBufferSize ()
+    {
+        return recording.header ().rgbBytes;
+    }
+
+    int getDepthBufferSize ()
+    {
+        return recording.header ().depthBytes;
+    }
+
+    /*! \brief Returns whether all the recorded frames have been delivered. */
+    bool finished ()
+    {
+        return done;
+    }
+
+private:
+    void launch ()
+    {
+        if (running.exchange (true)) return;
+        player = std::thread ([this] { play (); });
+    }
+
+    void halt ()
+    {
+        running = false;
+        if (player.joinable ()) player.join ();
+    }
+
+    void play ()
+    {
+        if (recording.frames.empty ()) { done = true; return; }
+
+        const uint64_t first = recording.frames.front ().hostTime;
+        const auto t0 = std::chrono::steady_clock::now ();
+
+        for (const auto &frame : recording.frames)
+        {
+            if (!running) return;
+
+            if (rate == Rate::RECORDED)
+                std::this_thread::sleep_until (t0 + std::chrono::nanoseconds (frame.hostTime - first));
+
+            if (frame.stream == KinectStream::RGB && video)
+                VideoCallback (frame.data, frame.timestamp);
+            else if (frame.stream == KinectStream::DEPTH && depth)
+                DepthCallback (frame.data, frame.timestamp);
+        }
+
+        done = true;
+    }
+
+    KinectRecording recording;
+    Rate rate;
+    std::atomic<bool> video, depth, running, done;
+    std::thread player;
+
+};
+
+
+/*! \brief Prints statistics of per-frame end-to-end latencies (in ms). */
+inline void reportLatency (std::vector<double> latencies, double seconds)
+{
+    if (latencies.empty ())
+    {
+        std::cout << "No frames were processed" << std::endl;
+        return;
+    }
+
+    std::sort (latencies.begin (), latencies.end ());
+    const size_t n = latencies.size ();
+    double mean = std::accumulate (latencies.begin (), latencies.end (), 0.0) / n;
+
+    std::cout << std::fixed << std::setprecision (3)
+              << "Frames: " << n << ", " << n / seconds << " fps" << std::endl
+              << "Latency [ms]: mean " << mean
+              << ", median " << latencies[n / 2]
+              << ", p95 " << latencies[std::min (n - 1, (size_t) (0.95 * n))]
+              << ", max " << latencies.back () << std::endl;
+}
+
+#endif  // GF_KINECTRECORDING_HPP
@@ -32,8 +32,14 @@
 #ifndef GF_ALGORITHMS_HPP
 #define GF_ALGORITHMS_HPP
 
+#include <vector>
+#include <memory>
+#include <chrono>
 #include <CLUtils.hpp>
 #include <GuidedFilter/common.hpp>
+#include <GuidedFilter/graph.hpp>
+#include <GuidedFilter/metrics.hpp>
+#include <GuidedFilter/async.hpp>
 #include <GuidedFilter/math.hpp>
 
 
@@ -51,7 +57,8 @@ namespace GF
     enum class SeparateRGBConfig : uint8_t
     {
         FLOAT_FLOAT,  /*!< Identifies the case of `float` input data and `float` output data. */
-        UCHAR_FLOAT   /*!< Identifies the case of `uchar` input data and `float` output data. */
+        UCHAR_FLOAT,  /*!< Identifies the case of `uchar` input data and `float` output data. */
+        USHORT_FLOAT  /*!< Identifies the case of `ushort` input data and `float` output data. */
     };
 
 
@@ -134,12 +141,13 @@ namespace GF
         cl_float *hPtrOutR;  /*!< Mapping of the output staging buffer for channel R. */
         cl_float *hPtrOutG;  /*!< Mapping of the output staging buffer for channel G. */
         cl_float *hPtrOutB;  /*!< Mapping of the output staging buffer for channel B. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global, local;
         Staging staging;
@@ -231,17 +239,127 @@ namespace GF
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
 
         cl_uchar *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOutR;  /*!< Mapping of the output staging buffer for channel R. */
         cl_float *hPtrOutG;  /*!< Mapping of the output staging buffer for channel G. */
         cl_float *hPtrOutB;  /*!< Mapping of the output staging buffer for channel B. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernel;
+        cl::NDRange global, local;
+        Staging staging;
+        size_t wgMultiple;
+        unsigned int width, height;
+        unsigned int bufferInSize, bufferOutSize;
+        cl::Buffer hBufferIn, hBufferOutR, hBufferOutG, hBufferOutB;
+        cl::Buffer dBufferIn, dBufferOutR, dBufferOutG, dBufferOutB;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, &timer.event ());
+            queue.flush (); timer.wait ();
+
+            return timer.duration ();
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `separateRGBChannels_Ushort2Float` kernel.
+     *  \details `separateRGBChannels_Ushort2Float` performs array transposition on an RGB image,
+     *           while promoting its `ushort` type to `float` and normalizing its values to one.
+     *           For more details, look at the kernel's documentation.
+     *  \note The `separateRGBChannels_Ushort2Float` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note This is a specialization for the case of `ushort` input data and
+     *        `float` output data. The data are also normalized to one (1).
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>` instance:<br>
+     *        |  Name  | Type | Placement | I/O | Use | Properties | Size |
+     *        |  ---   |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN   | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+     *        | H_OUT_R| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT_G| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT_B| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+     *        | D_OUT_R| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT_G| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT_B| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     */
+    template <>
+    class SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,     /*!< Input staging buffer. */
+            H_OUT_R,  /*!< Output staging buffer for channel R. */
+            H_OUT_G,  /*!< Output staging buffer for channel G. */
+            H_OUT_B,  /*!< Output staging buffer for channel B. */
+            D_IN,     /*!< Input buffer. */
+            D_OUT_R,  /*!< Output buffer for channel R. */
+            D_OUT_G,  /*!< Output buffer for channel G. */
+            D_OUT_B   /*!< Output buffer for channel B. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        SeparateRGB (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (SeparateRGB::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (SeparateRGB::Memory mem = SeparateRGB::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (SeparateRGB::Memory mem = SeparateRGB::Memory::H_OUT_R, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+
+        cl_ushort *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOutR;  /*!< Mapping of the output staging buffer for channel R. */
+        cl_float *hPtrOutG;  /*!< Mapping of the output staging buffer for channel G. */
+        cl_float *hPtrOutB;  /*!< Mapping of the output staging buffer for channel B. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global, local;
         Staging staging;
@@ -275,7 +393,8 @@ namespace GF
     enum class CombineRGBConfig : uint8_t
     {
         FLOAT_FLOAT,  /*!< Identifies the case of `float` input data and `float` output data. */
-        FLOAT_UCHAR   /*!< Identifies the case of `float` input data and `uchar` output data. */
+        FLOAT_UCHAR,  /*!< Identifies the case of `float` input data and `uchar` output data. */
+        FLOAT_USHORT  /*!< Identifies the case of `float` input data and `ushort` output data. */
     };
 
 
@@ -352,17 +471,21 @@ namespace GF
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
 
         cl_float *hPtrInR;  /*!< Mapping of the input staging buffer for channel R. */
         cl_float *hPtrInG;  /*!< Mapping of the input staging buffer for channel G. */
         cl_float *hPtrInB;  /*!< Mapping of the input staging buffer for channel B. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global, local;
         Staging staging;
@@ -460,12 +583,120 @@ namespace GF
         cl_float *hPtrInG;  /*!< Mapping of the input staging buffer for channel G. */
         cl_float *hPtrInB;  /*!< Mapping of the input staging buffer for channel B. */
         cl_uchar *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernel;
+        cl::NDRange global, local;
+        Staging staging;
+        size_t wgMultiple;
+        unsigned int width, height;
+        unsigned int bufferInSize, bufferOutSize;
+        cl::Buffer hBufferInR, hBufferInG, hBufferInB, hBufferOut;
+        cl::Buffer dBufferInR, dBufferInG, dBufferInB, dBufferOut;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, &timer.event ());
+            queue.flush (); timer.wait ();
+
+            return timer.duration ();
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `combineRGBChannels_Float2Ushort` kernel.
+     *  \details `combineRGBChannels_Float2Ushort` performs array transposition on three, R, G, and B, images,
+     *           while demoting their `float` type to `ushort`, and scaling the data to `65535`.
+     *           For more details, look at the kernel's documentation.
+     *  \note The `combineRGBChannels_Float2Ushort` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note This is a specialization for the case of `float` input data and
+     *        `ushort` output data. The data are also scaled to `65535`, and saturated.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `CombineRGB<CombineRGBConfig::FLOAT_USHORT>` instance:<br>
+     *        |  Name  | Type | Placement | I/O | Use | Properties | Size |
+     *        |  ---   |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_R | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_G | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_B | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+     *        | D_IN_R | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_G | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_B | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$  width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+     */
+    template <>
+    class CombineRGB<CombineRGBConfig::FLOAT_USHORT>
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_R,  /*!< Input staging buffer for channel R. */
+            H_IN_G,  /*!< Input staging buffer for channel G. */
+            H_IN_B,  /*!< Input staging buffer for channel B. */
+            H_OUT,   /*!< Output staging buffer. */
+            D_IN_R,  /*!< Input buffer for channel R. */
+            D_IN_G,  /*!< Input buffer for channel G. */
+            D_IN_B,  /*!< Input buffer for channel B. */
+            D_OUT    /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        CombineRGB (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (CombineRGB::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (CombineRGB::Memory mem = CombineRGB::Memory::D_IN_R, 
+                    void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (CombineRGB::Memory mem = CombineRGB::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+
+        cl_float *hPtrInR;  /*!< Mapping of the input staging buffer for channel R. */
+        cl_float *hPtrInG;  /*!< Mapping of the input staging buffer for channel G. */
+        cl_float *hPtrInB;  /*!< Mapping of the input staging buffer for channel B. */
+        cl_ushort *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global, local;
         Staging staging;
@@ -498,7 +729,8 @@ namespace GF
     /*! \brief Enumerates configurations for the `Depth` class. */
     enum class DepthConfig : uint8_t
     {
-        USHORT_FLOAT  /*!< Identifies the case of `ushort` input data and `float` output data. */
+        USHORT_FLOAT,  /*!< Identifies the case of `ushort` input data and `float` output data. */
+        FLOAT_USHORT   /*!< Identifies the case of `float` input data and `ushort` output data. */
     };
 
 
@@ -568,6 +800,9 @@ namespace GF
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
         /*! \brief Gets the scaling factor. */
         float getScaling ();
         /*! \brief Sets the scaling factor. */
@@ -575,12 +810,13 @@ namespace GF
 
         cl_ushort *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global;
         Staging staging;
@@ -610,11 +846,12 @@ namespace GF
     };
 
 
-    /*! \brief Interface class for the `depthTo3D` kernel.
-     *  \details `depthTo3D` performs a transformation from 2D image coordinates 
-     *           to 3D world coordinates (it forms a point cloud).
+    /*! \brief Interface class for the `depth_Float2Ushort` kernel.
+     *  \details `depth_Float2Ushort` demotes the `float` type of an image 
+     *           to `unsigned short`, rounding and saturating the scaled values.
      *           For more details, look at the kernel's documentation.
-     *  \note The `depthTo3D` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note The `depth_Float2Ushort` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note This is a specialization for the case of `float` input data and `ushort` output data.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -623,15 +860,17 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by a `DepthTo3D` instance:<br>
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `Depth<DepthConfig::FLOAT_USHORT>` instance:<br>
      *        | Name | Type | Placement | I/O | Use | Properties | Size |
      *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
      *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_ushort)\f$ |
      *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_ushort)\f$ |
      */
-    class DepthTo3D
+    template <>
+    class Depth<DepthConfig::FLOAT_USHORT>
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -647,43 +886,42 @@ namespace GF
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        DepthTo3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        Depth (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (DepthTo3D::Memory mem);
+        cl::Memory& get (Depth::Memory mem);
         /*! \brief Configures kernel execution parameters. */
-        void init (unsigned int _width, unsigned int _height, 
-                   float _f, float _scaling = 1.f, Staging _staging = Staging::IO);
+        void init (unsigned int _width, unsigned int _height, float _scaling = 1.f, Staging _staging = Staging::IO);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (DepthTo3D::Memory mem = DepthTo3D::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+        void write (Depth::Memory mem = Depth::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (DepthTo3D::Memory mem = DepthTo3D::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (Depth::Memory mem = Depth::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
-        /*! \brief Gets the focal length. */
-        float getFocalLength ();
-        /*! \brief Sets the focal length. */
-        void setFocalLength (float _f);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
         /*! \brief Gets the scaling factor. */
         float getScaling ();
         /*! \brief Sets the scaling factor. */
         void setScaling (float _scaling);
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
-        cl_float4 *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        cl_ushort *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global;
         Staging staging;
-        unsigned int width, height;
+        unsigned int length;
         unsigned int bufferInSize, bufferOutSize;
-        float f, scaling;
+        float scaling;
         cl::Buffer hBufferIn, hBufferOut;
         cl::Buffer dBufferIn, dBufferOut;
 
@@ -707,11 +945,11 @@ namespace GF
     };
 
 
-    /*! \brief Interface class for the `rgbdTo8D` kernel.
-     *  \details `rgbdTo8D` transforms and fuses together geometry and color 
-     *           information into 8D feature points.
+    /*! \brief Interface class for the `depthTo3D` kernel.
+     *  \details `depthTo3D` performs a transformation from 2D image coordinates 
+     *           to 3D world coordinates (it forms a point cloud).
      *           For more details, look at the kernel's documentation.
-     *  \note The `rgbdTo8D` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note The `depthTo3D` kernel is available in `kernels/imageSupport_kernels.cl`.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -720,21 +958,15 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by a `RGBDTo8D` instance:<br>
+     *        The following input/output `OpenCL` memory objects are created by a `DepthTo3D` instance:<br>
      *        | Name | Type | Placement | I/O | Use | Properties | Size |
      *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
-     *        | H_IN_D| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | H_IN_R| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | H_IN_G| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | H_IN_B| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | H_OUT | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float8)\f$ |
-     *        | D_IN_D| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | D_IN_R| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | D_IN_G| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | D_IN_B| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
-     *        | D_OUT | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float4)\f$ |
      */
-    class RGBDTo8D
+    class DepthTo3D
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -743,16 +975,120 @@ namespace GF
          */
         enum class Memory : uint8_t
         {
-            H_IN_D,  /*!< Input staging buffer for the %Depth image. */
-            H_IN_R,  /*!< Input staging buffer for channel R of the RGB image. */
-            H_IN_G,  /*!< Input staging buffer for channel G of the RGB image. */
-            H_IN_B,  /*!< Input staging buffer for channel B of the RGB image. */
-            H_OUT,   /*!< Output staging buffer. */
-            D_IN_D,  /*!< Input buffer for the %Depth image. */
-            D_IN_R,  /*!< Input buffer for channel R of the RGB image. */
-            D_IN_G,  /*!< Input buffer for channel G of the RGB image. */
-            D_IN_B,  /*!< Input buffer for channel B of the RGB image. */
-            D_OUT    /*!< Output buffer. */
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        DepthTo3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (DepthTo3D::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, 
+                   float _f, float _scaling = 1.f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (DepthTo3D::Memory mem = DepthTo3D::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (DepthTo3D::Memory mem = DepthTo3D::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Gets the focal length. */
+        float getFocalLength ();
+        /*! \brief Sets the focal length. */
+        void setFocalLength (float _f);
+        /*! \brief Gets the scaling factor. */
+        float getScaling ();
+        /*! \brief Sets the scaling factor. */
+        void setScaling (float _scaling);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float4 *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernel;
+        cl::NDRange global;
+        Staging staging;
+        unsigned int width, height;
+        unsigned int bufferInSize, bufferOutSize;
+        float f, scaling;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, &timer.event ());
+            queue.flush (); timer.wait ();
+
+            return timer.duration ();
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `rgbdTo8D` kernel.
+     *  \details `rgbdTo8D` transforms and fuses together geometry and color 
+     *           information into 8D feature points.
+     *           For more details, look at the kernel's documentation.
+     *  \note The `rgbdTo8D` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `RGBDTo8D` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_D| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | H_IN_R| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | H_IN_G| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | H_IN_B| Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | H_OUT | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     *        | D_IN_D| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | D_IN_R| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | D_IN_G| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | D_IN_B| Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float) \f$ |
+     *        | D_OUT | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     */
+    class RGBDTo8D
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_D,  /*!< Input staging buffer for the %Depth image. */
+            H_IN_R,  /*!< Input staging buffer for channel R of the RGB image. */
+            H_IN_G,  /*!< Input staging buffer for channel G of the RGB image. */
+            H_IN_B,  /*!< Input staging buffer for channel B of the RGB image. */
+            H_OUT,   /*!< Output staging buffer. */
+            D_IN_D,  /*!< Input buffer for the %Depth image. */
+            D_IN_R,  /*!< Input buffer for channel R of the RGB image. */
+            D_IN_G,  /*!< Input buffer for channel G of the RGB image. */
+            D_IN_B,  /*!< Input buffer for channel B of the RGB image. */
+            D_OUT    /*!< Output buffer. */
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
@@ -788,12 +1124,13 @@ namespace GF
         cl_float *hPtrInG;  /*!< Mapping of the input staging buffer for channel G of the RGB image. */
         cl_float *hPtrInB;  /*!< Mapping of the input staging buffer for channel B of the RGB image. */
         cl_float8 *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global, local;
         Staging staging;
@@ -829,6 +1166,9 @@ namespace GF
      *  \details `splitPC8D` splits an 8-D point cloud into 4-D geometry points and RGBA color points.
      *           For more details, look at the kernel's documentation.
      *  \note The `splitPC8D` kernel is available in `kernels/imageSupport_kernels.cl`.
+     *  \note To split a point cloud compacted by `CompactPC<CompactPCConfig::PC8D>`, assign 
+     *        its `D_COUNT` buffer to `D_COUNT` before the call to `init`. The class then 
+     *        uses the `splitPC8D_Compact` kernel, which only processes the valid points.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -846,6 +1186,7 @@ namespace GF
      *        | D_IN      | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float8)\f$ |
      *        | D_OUT_PC4D| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float4)\f$ |
      *        | D_OUT_RGBA| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_COUNT   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$sizeof\ (cl\_uint)\f$ (optional) |
      */
     class SplitPC8D
     {
@@ -861,7 +1202,8 @@ namespace GF
             H_OUT_RGBA,  /*!< Output staging buffer for the RGBA values. */
             D_IN,        /*!< Input buffer for the 8-D point cloud. */
             D_OUT_PC4D,  /*!< Output buffer for the 4-D homogeneous coordinates. */
-            D_OUT_RGBA   /*!< Output buffer for the RGBA values. */
+            D_OUT_RGBA,  /*!< Output buffer for the RGBA values. */
+            D_COUNT      /*!< Input buffer for the number of valid points (compacted input). */
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
@@ -886,19 +1228,20 @@ namespace GF
         cl_float *hPtrIn;       /*!< Mapping of the input staging buffer for the 8-D point cloud. */
         cl_float *hPtrOutPC4D;  /*!< Mapping of the output staging buffer for the 4-D homogeneous coordinates. */
         cl_float *hPtrOutRGBA;  /*!< Mapping of the output staging buffer for the RGBA values. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global;
         Staging staging;
         unsigned int n, offset;
         unsigned int bufferInSize, bufferOutSize;
         cl::Buffer hBufferIn, hBufferOutPC4D, hBufferOutRGBA;
-        cl::Buffer dBufferIn, dBufferOutPC4D, dBufferOutRGBA;
+        cl::Buffer dBufferIn, dBufferOutPC4D, dBufferOutRGBA, dBufferCount;
 
     public:
         /*! \brief Executes the necessary kernels.
@@ -972,12 +1315,13 @@ namespace GF
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global;
         Staging staging;
@@ -1055,24 +1399,31 @@ namespace GF
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
         /*! \brief Gets the scaling factor. */
         float getScaling ();
         /*! \brief Sets the scaling factor. */
         void setScaling (float _scaling);
+        /*! \brief Checks whether a work-group configuration is valid. */
+        bool validConfig (unsigned int _width, unsigned int _height, 
+                          const std::vector<unsigned int> &params);
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernelScan, kernelSumsScan, kernelAddSums;
         cl::NDRange globalScan, globalSumsScan, localScan;
         cl::NDRange globalAddSums, localAddSums, offsetAddSums;
         Staging staging;
-        size_t wgMultiple, wgXdim;
+        size_t wgMultiple, wgXdim, lXdim;
         unsigned int width, height, bufferSize, bufferSumsSize;
         float scaling;
         cl::Buffer hBufferIn, hBufferOut;
@@ -1122,10 +1473,37 @@ namespace GF
     };
 
 
-    /*! \brief Interface class for the `transpose` kernel.
-     *  \details `transpose` performs a matrix transposition. 
-     *           For more details, look at the kernel's documentation.
-     *  \note The `transpose` kernel is available in `kernels/transpose_kernels.cl`.
+    /*! \brief Enumerates configurations for the `CompactPC` class. */
+    enum class CompactPCConfig : uint8_t
+    {
+        PC4D,  /*!< Identifies the case of 4-D points (homogeneous coordinates). */
+        PC8D   /*!< Identifies the case of 8-D points (homogeneous coordinates + RGBA values). */
+    };
+
+
+    /*! \brief Interface class for the point cloud compaction operation.
+     *  \details Removes the invalid points (zero depth) from a point cloud, and 
+     *           packs the valid ones in a dense array, preserving their order.
+     *  \note The class makes use of the `pcValidMask`, `pcRowCounts` and `pcCompact` 
+     *        kernels, available in `kernels/imageSupport_kernels.cl`, and 
+     *        of the `scan` kernels, available in `kernels/scan_kernels.cl`.
+     *  \note This is just a declaration. Look at the explicit template specializations
+     *        for specific instantiations of the class.
+     *        
+     *  \tparam C configures the class to work with different types of points.
+     */
+    template <CompactPCConfig C>
+    class CompactPC;
+
+
+    /*! \brief Interface class for the point cloud compaction operation.
+     *  \details Removes the invalid points (zero depth) from the point cloud 
+     *           of a `DepthTo3D` instance. It marks the valid points, scans the 
+     *           mask along the rows, scans the row counts, and then scatters 
+     *           the valid points to their positions in a dense array. The number 
+     *           of valid points is left on the device, in the `D_COUNT` buffer.
+     *  \note This is a specialization for the case of 4-D points.
+     *  \note The contents of the output array past the number of valid points are undefined.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -1134,15 +1512,19 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by a `Transpose` instance:<br>
-     *        | Name | Type | Placement | I/O | Use | Properties | Size |
-     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
-     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `CompactPC<CompactPCConfig::PC4D>` instance:<br>
+     *        |  Name  | Type | Placement | I/O | Use | Properties | Size |
+     *        |  ---   |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN   | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | H_COUNT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$sizeof\ (cl\_uint)\f$               |
+     *        | D_IN   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_COUNT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$sizeof\ (cl\_uint)\f$               |
      */
-    class Transpose
+    template <>
+    class CompactPC<CompactPCConfig::PC4D>
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -1151,41 +1533,47 @@ namespace GF
          */
         enum class Memory : uint8_t
         {
-            H_IN,   /*!< Input staging buffer. */
-            H_OUT,  /*!< Output staging buffer. */
-            D_IN,   /*!< Input buffer. */
-            D_OUT   /*!< Output buffer. */
+            H_IN,     /*!< Input staging buffer. */
+            H_OUT,    /*!< Output staging buffer. */
+            H_COUNT,  /*!< Output staging buffer for the number of valid points. */
+            D_IN,     /*!< Input buffer. */
+            D_OUT,    /*!< Output buffer. */
+            D_COUNT   /*!< Output buffer for the number of valid points. */
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        Transpose (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        CompactPC (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (Transpose::Memory mem);
+        cl::Memory& get (CompactPC::Memory mem);
         /*! \brief Configures kernel execution parameters. */
         void init (unsigned int _width, unsigned int _height, Staging _staging = Staging::IO);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (Transpose::Memory mem = Transpose::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+        void write (CompactPC::Memory mem = CompactPC::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (Transpose::Memory mem = Transpose::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (CompactPC::Memory mem = CompactPC::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
 
-        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
-        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        cl_float4 *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float4 *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        cl_uint *hPtrCount;  /*!< Mapping of the output staging buffer for the number of valid points. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
-        cl::Kernel kernel;
-        cl::NDRange global, local;
+        MeteredQueue queue;
+        cl::Kernel kernelMask, kernelCounts, kernelCompact;
+        cl::NDRange globalMask, globalCounts, globalCompact;
+        Scan scanRows, scanCounts;
         Staging staging;
-        unsigned int width, height, bufferSize;
-        cl::Buffer hBufferIn, hBufferOut;
-        cl::Buffer dBufferIn, dBufferOut;
+        unsigned int width, height, rows;
+        unsigned int bufferSize;
+        cl::Buffer hBufferIn, hBufferOut, hBufferCount;
+        cl::Buffer dBufferIn, dBufferOut, dBufferCount;
 
     public:
         /*! \brief Executes the necessary kernels.
@@ -1198,20 +1586,38 @@ namespace GF
         template <typename period>
         double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
         {
-            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, &timer.event ());
+            double pTime;
+
+            queue.enqueueNDRangeKernel (kernelMask, cl::NullRange, globalMask, cl::NullRange, events, &timer.event ());
             queue.flush (); timer.wait ();
+            pTime = timer.duration ();
 
-            return timer.duration ();
+            pTime += scanRows.run (timer);
+
+            queue.enqueueNDRangeKernel (kernelCounts, cl::NullRange, globalCounts, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            pTime += scanCounts.run (timer);
+
+            queue.enqueueNDRangeKernel (kernelCompact, cl::NullRange, globalCompact, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
         }
 
     };
 
 
-    /*! \brief Interface class for the `Summed Area Table` operation.
-     *  \note The class makes use of the `scan` and `transpose` kernels.
-     *  \note It first scans the rows, then transposes the array, and then 
-     *        scans the columns. Lastly, there is the option to leave the array
-     *        in the transposed configuration, or transpose it again.
+    /*! \brief Interface class for the point cloud compaction operation.
+     *  \details Removes the invalid points (zero depth) from the point cloud 
+     *           of a `RGBDTo8D` instance. It marks the valid points, scans the 
+     *           mask along the rows, scans the row counts, and then scatters 
+     *           the valid points to their positions in a dense array. The number 
+     *           of valid points is left on the device, in the `D_COUNT` buffer.
+     *  \note This is a specialization for the case of 8-D points.
+     *  \note The contents of the output array past the number of valid points are undefined.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -1220,15 +1626,19 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by a `SAT` instance:<br>
-     *        | Name | Type | Placement | I/O | Use | Properties | Size |
-     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
-     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE `(transposed)`<br>CL_MEM_WRITE_ONLY `(!transposed)` | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `CompactPC<CompactPCConfig::PC8D>` instance:<br>
+     *        |  Name  | Type | Placement | I/O | Use | Properties | Size |
+     *        |  ---   |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN   | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     *        | H_COUNT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$sizeof\ (cl\_uint)\f$               |
+     *        | D_IN   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float8)\f$ |
+     *        | D_COUNT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$sizeof\ (cl\_uint)\f$               |
      */
-    class SAT
+    template <>
+    class CompactPC<CompactPCConfig::PC8D>
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -1237,46 +1647,47 @@ namespace GF
          */
         enum class Memory : uint8_t
         {
-            H_IN,   /*!< Input staging buffer. */
-            H_OUT,  /*!< Output staging buffer. */
-            D_IN,   /*!< Input buffer. */
-            D_OUT   /*!< Output buffer. */
+            H_IN,     /*!< Input staging buffer. */
+            H_OUT,    /*!< Output staging buffer. */
+            H_COUNT,  /*!< Output staging buffer for the number of valid points. */
+            D_IN,     /*!< Input buffer. */
+            D_OUT,    /*!< Output buffer. */
+            D_COUNT   /*!< Output buffer for the number of valid points. */
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        SAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info, bool _transposed = true);
+        CompactPC (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (SAT::Memory mem);
+        cl::Memory& get (CompactPC::Memory mem);
         /*! \brief Configures kernel execution parameters. */
-        void init (unsigned int _width, unsigned int _height, float _scaling = 1.f, Staging _staging = Staging::IO);
+        void init (unsigned int _width, unsigned int _height, Staging _staging = Staging::IO);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (SAT::Memory mem = SAT::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+        void write (CompactPC::Memory mem = CompactPC::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (SAT::Memory mem = SAT::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (CompactPC::Memory mem = CompactPC::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
-        /*! \brief Gets the scaling factor. */
-        float getScaling ();
-        /*! \brief Sets the scaling factor. */
-        void setScaling (float _scaling);
 
-        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
-        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        cl_float8 *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float8 *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        cl_uint *hPtrCount;  /*!< Mapping of the output staging buffer for the number of valid points. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
-        Scan scanRows, scanColumns;
-        Transpose transpose1, transpose2;
+        MeteredQueue queue;
+        cl::Kernel kernelMask, kernelCounts, kernelCompact;
+        cl::NDRange globalMask, globalCounts, globalCompact;
+        Scan scanRows, scanCounts;
         Staging staging;
-        unsigned int width, height, bufferSize;
-        float scaling;
-        bool transposed;
-        cl::Buffer hBufferIn, hBufferOut;
+        unsigned int width, height, rows;
+        unsigned int bufferSize;
+        cl::Buffer hBufferIn, hBufferOut, hBufferCount;
+        cl::Buffer dBufferIn, dBufferOut, dBufferCount;
 
     public:
         /*! \brief Executes the necessary kernels.
@@ -1291,12 +1702,21 @@ namespace GF
         {
             double pTime;
 
-            pTime = scanRows.run (timer, events);
-            pTime += transpose1.run (timer);
-            pTime += scanColumns.run (timer);
-            
-            if (!transposed)
-                pTime += transpose2.run (timer);
+            queue.enqueueNDRangeKernel (kernelMask, cl::NullRange, globalMask, cl::NullRange, events, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            pTime += scanRows.run (timer);
+
+            queue.enqueueNDRangeKernel (kernelCounts, cl::NullRange, globalCounts, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            pTime += scanCounts.run (timer);
+
+            queue.enqueueNDRangeKernel (kernelCompact, cl::NullRange, globalCompact, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
 
             return pTime;
         }
@@ -1304,10 +1724,10 @@ namespace GF
     };
 
 
-    /*! \brief Interface class for the `boxFilterSAT{_Tr}` kernel.
-     *  \details `boxFilterSAT{_Tr}` performs a mean filtering operation. 
+    /*! \brief Interface class for the `transpose` kernel.
+     *  \details `transpose` performs a matrix transposition. 
      *           For more details, look at the kernel's documentation.
-     *  \note The `boxFilterSAT{_Tr}` kernel is available in `kernels/boxFilter_kernels.cl`.
+     *  \note The `transpose` kernel is available in `kernels/transpose_kernels.cl`.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -1316,7 +1736,7 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by a `BoxFilterSAT` instance:<br>
+     *        The following input/output `OpenCL` memory objects are created by a `Transpose` instance:<br>
      *        | Name | Type | Placement | I/O | Use | Properties | Size |
      *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
      *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
@@ -1324,7 +1744,7 @@ namespace GF
      *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
      */
-    class BoxFilterSAT
+    class Transpose
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -1340,48 +1760,41 @@ namespace GF
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        BoxFilterSAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        Transpose (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (BoxFilterSAT::Memory mem);
+        cl::Memory& get (Transpose::Memory mem);
         /*! \brief Configures kernel execution parameters. */
-        void init (unsigned int _width, unsigned int _height, 
-                   int _radius, float _scaling = 1e-4f, Staging _staging = Staging::IO);
+        void init (unsigned int _width, unsigned int _height, Staging _staging = Staging::IO);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (BoxFilterSAT::Memory mem = BoxFilterSAT::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+        void write (Transpose::Memory mem = Transpose::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (BoxFilterSAT::Memory mem = BoxFilterSAT::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (Transpose::Memory mem = Transpose::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
-        /*! \brief Gets the filter window radius. */
-        int getRadius ();
-        /*! \brief Sets the filter window radius. */
-        void setRadius (int _radius);
-        /*! \brief Gets the scaling factor. */
-        float getScaling ();
-        /*! \brief Sets the scaling factor. */
-        void setScaling (float _scaling);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Checks whether a work-group configuration is valid. */
+        bool validConfig (unsigned int _width, unsigned int _height, 
+                          const std::vector<unsigned int> &params);
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
-        static const unsigned int lXdim = 16;
-        static const unsigned int lYdim = 16;
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global, local;
         Staging staging;
         unsigned int width, height, bufferSize;
-        int radius;
-        float scaling;
-        SAT sat;
         cl::Buffer hBufferIn, hBufferOut;
-        cl::Buffer dBufferOut;
+        cl::Buffer dBufferIn, dBufferOut;
 
     public:
         /*! \brief Executes the necessary kernels.
@@ -1394,25 +1807,24 @@ namespace GF
         template <typename period>
         double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
         {
-            double pTime;
-
-            pTime = sat.run (timer, events);
-            
-            queue.enqueueNDRangeKernel (
-                kernel, cl::NullRange, global, local, nullptr, &timer.event ());
+            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, &timer.event ());
             queue.flush (); timer.wait ();
-            pTime += timer.duration ();
 
-            return pTime;
+            return timer.duration ();
         }
 
     };
 
 
-    /*! \brief Interface class for the `boxFilter` kernel.
-     *  \details `boxFilter` performs a mean filtering operation. 
-     *           For more details, look at the kernel's documentation.
-     *  \note The `boxFilter` kernel is available in `kernels/boxFilter_kernels.cl`.
+    /*! \brief Interface class for the `Summed Area Table` operation.
+     *  \note The class makes use of the `scan` and `transpose` kernels.
+     *  \note It first scans the rows, then transposes the array, and then 
+     *        scans the columns. Lastly, there is the option to leave the array
+     *        in the transposed configuration, or transpose it again.
+     *  \note When a `tile` side is given to `init`, the array is treated as a grid of 
+     *        independent `tile x tile` blocks, and a separate SAT is built on each. The 
+     *        partial sums stay bounded by the tile area, which keeps `float` accuracy 
+     *        for quantities that would otherwise cancel out (e.g. second-order moments).
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -1421,15 +1833,15 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by a `BoxFilter` instance:<br>
+     *        The following input/output `OpenCL` memory objects are created by a `SAT` instance:<br>
      *        | Name | Type | Placement | I/O | Use | Properties | Size |
      *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
      *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE `(transposed)`<br>CL_MEM_WRITE_ONLY `(!transposed)` | \f$width*height*sizeof\ (cl\_float)\f$ |
      */
-    class BoxFilter
+    class SAT
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -1445,41 +1857,44 @@ namespace GF
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        BoxFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        SAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info, bool _transposed = true);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (BoxFilter::Memory mem);
+        cl::Memory& get (SAT::Memory mem);
         /*! \brief Configures kernel execution parameters. */
-        void init (unsigned int _width, unsigned int _height, int _radius, Staging _staging = Staging::IO);
+        void init (unsigned int _width, unsigned int _height, float _scaling = 1.f, 
+                   Staging _staging = Staging::IO, unsigned int _tile = 0);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (BoxFilter::Memory mem = BoxFilter::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+        void write (SAT::Memory mem = SAT::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (BoxFilter::Memory mem = BoxFilter::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (SAT::Memory mem = SAT::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
-        /*! \brief Gets the filter window radius. */
-        int getRadius ();
-        /*! \brief Sets the filter window radius. */
-        void setRadius (int _radius);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the scaling factor. */
+        float getScaling ();
+        /*! \brief Sets the scaling factor. */
+        void setScaling (float _scaling);
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
-        static const unsigned int lXdim = 16;
-        static const unsigned int lYdim = 16;
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue;
-        cl::Kernel kernel;
-        cl::NDRange global, local;
+        MeteredQueue queue;
+        Scan scanRows, scanColumns;
+        Transpose transpose1, transpose2;
         Staging staging;
-        unsigned int width, height, bufferSize;
-        int radius;
+        unsigned int width, height, tile, bufferSize;
+        float scaling;
+        bool transposed;
         cl::Buffer hBufferIn, hBufferOut;
-        cl::Buffer dBufferIn, dBufferOut;
 
     public:
         /*! \brief Executes the necessary kernels.
@@ -1492,44 +1907,143 @@ namespace GF
         template <typename period>
         double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
         {
-            queue.enqueueNDRangeKernel (
-                kernel, cl::NullRange, global, local, nullptr, &timer.event ());
-            queue.flush (); timer.wait ();
+            double pTime;
 
-            return timer.duration ();
+            pTime = scanRows.run (timer, events);
+            pTime += transpose1.run (timer);
+            pTime += scanColumns.run (timer);
+            
+            if (!transposed)
+                pTime += transpose2.run (timer);
+
+            return pTime;
         }
 
     };
 
 
-    /*! \brief Enumerates configurations for the `Guided Filter` algorithm. */
-    enum class GuidedFilterConfig : uint8_t
+    /*! \brief Interface class for the surface normal estimation on an organized point cloud.
+     *  \details For each point, it computes the covariance matrix of the valid points in 
+     *           a \f$ (2*radius+1)^2 \f$ window, and outputs the eigenvector of its smallest 
+     *           eigenvalue, oriented towards the camera, along with the surface curvature, 
+     *           \f$ \lambda_0 / (\lambda_0 + \lambda_1 + \lambda_2) \f$. The first and second 
+     *           order moments of the points are read from a `SAT`, so the work per point 
+     *           is `O(1)` in the window size.
+     *  \note The class makes use of the `pcMoments` and `pcNormals` kernels, available 
+     *        in `kernels/imageSupport_kernels.cl`, and of the `SAT` class.
+     *  \note The moments are taken relative to a reference point per tile, and accumulated 
+     *        in a tiled `SAT`. The tile side is the smallest multiple of 4 that divides 
+     *        both image dimensions and is at least \f$ max (2*radius+1, 16) \f$.
+     *  \note Points with zero depth, and points with less than 3 valid neighbors, 
+     *        get a zero normal and curvature.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `Normals` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float4)\f$ |
+     */
+    class Normals
     {
-        I_NEQ_P,  /*!< Identifies the general case where \f$ I \neq p \f$. */
-        I_EQ_P    /*!< Identifies the special case where \f$ I == p \f$. */
-    };
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        Normals (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (Normals::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (Normals::Memory mem = Normals::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (Normals::Memory mem = Normals::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Gets the radius of the neighborhood window. */
+        int getRadius ();
+        /*! \brief Sets the radius of the neighborhood window. */
+        void setRadius (int _radius);
 
+        cl_float4 *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float4 *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
-    /*! \brief Interface class for the `Guided Filter` algorithm.
-     *  \details The `Guided Filter` algorithm performs a number of operations,
-     *           one of which is edge preserving smoothing.
-     *  \note Two cases are covered. One where the guidance image `I` 
-     *        is different from the input image `p`, and another where 
-     *        these two are the same.
-     *  \note This is just a declaration. Look at the explicit template specializations
-     *        for specific instantiations of the class.
-     *        
-     *  \tparam Ip enables one of the two cases of `Guided Filter` algorithm, 
-     *             \f$ I \neq p\ \f$ or \f$\ I == p \f$.
-     */
-    template <GuidedFilterConfig Ip>
-    class GuidedFilter;
+    private:
+        static const unsigned int nMoments = 10;
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernelMoments, kernelNormals;
+        cl::NDRange global;
+        SAT sat;
+        Staging staging;
+        unsigned int width, height, tile;
+        unsigned int bufferSize;
+        int radius;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut;
 
+        /*! \brief Returns the tile side for the moments' `SAT`, or 0 if there is none. */
+        unsigned int tileSide (int _radius);
+        /*! \brief Sets up the moments' `SAT` for the current tile side. */
+        void initSAT ();
 
-    /*! \brief Interface class for the `Guided Filter` pipeline.
-     *  \details This instantiation covers the case where \f$ I == p \f$.
-     *  \note The kernels, specific to the `Guided Filter` algorithm, 
-     *        are available in `kernels/guidedFilter_kernels.cl`.
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue.enqueueNDRangeKernel (kernelMoments, cl::NullRange, global, cl::NullRange, events, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            pTime += sat.run (timer);
+
+            queue.enqueueNDRangeKernel (kernelNormals, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `boxFilterSAT{_Tr}` kernel.
+     *  \details `boxFilterSAT{_Tr}` performs a mean filtering operation. 
+     *           For more details, look at the kernel's documentation.
+     *  \note The `boxFilterSAT{_Tr}` kernel is available in `kernels/boxFilter_kernels.cl`.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -1538,17 +2052,20 @@ namespace GF
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
      *  
-     *        The following input/output `OpenCL` memory objects are created by 
-     *        a `GuidedFilter<GuidedFilterConfig::I_EQ_P>` instance:<br>
+     *        The following input/output `OpenCL` memory objects are created by a `BoxFilterSAT` instance:<br>
      *        | Name | Type | Placement | I/O | Use | Properties | Size |
      *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
      *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *  \note Instances that filter the same input with different radii can share the summed 
+     *        area table. Assign the `D_SAT` buffer of one instance to the `D_SAT` placeholder 
+     *        of the others, before their call to `init`. Those instances don't compute the 
+     *        table, so they have to run after the one that owns it, and they have to use 
+     *        the same scaling factor.
      */
-    template <>
-    class GuidedFilter<GuidedFilterConfig::I_EQ_P>
+    class BoxFilterSAT
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -1561,79 +2078,63 @@ namespace GF
             H_OUT,  /*!< Output staging buffer. */
             D_IN,   /*!< Input buffer. */
             D_OUT,  /*!< Output buffer. */
-            D_A,    /*!< Buffer of \f$ a \f$ coefficients. */
-            D_B     /*!< Buffer of \f$ b \f$ coefficients. */
+            D_SAT   /*!< Summed area table of the input. */
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        BoxFilterSAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (GuidedFilter::Memory mem);
+        cl::Memory& get (BoxFilterSAT::Memory mem);
         /*! \brief Configures kernel execution parameters. */
-        void init (unsigned int _width, unsigned int _height, int _radius, float _eps, int _zero_out = 0, 
-                   float _boxScaling = 1e-4f, float _outputScaling = 1.f, Staging _staging = Staging::IO);
+        void init (unsigned int _width, unsigned int _height, 
+                   int _radius, float _scaling = 1e-4f, Staging _staging = Staging::IO);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (GuidedFilter::Memory mem = GuidedFilter::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+        void write (BoxFilterSAT::Memory mem = BoxFilterSAT::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (GuidedFilter::Memory mem = GuidedFilter::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (BoxFilterSAT::Memory mem = BoxFilterSAT::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
         /*! \brief Gets the filter window radius. */
         int getRadius ();
         /*! \brief Sets the filter window radius. */
         void setRadius (int _radius);
-        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
-        float getEps ();
-        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
-        void setEps (float _eps);
-        /*! \brief Gets the scaling factor for the `BoxFilterSAT`. */
-        float getBoxScaling ();
-        /*! \brief Sets the scaling factor for the `BoxFilterSAT`. */
-        void setBoxScaling (float _boxScaling);
-        /*! \brief Gets the scaling factor for the output array. */
-        float getOutputScaling ();
-        /*! \brief Sets the scaling factor for the output array. */
-        void setOutputScaling (float _outputScaling);
-        /*! \brief Gets the `zero_out` flag. */
-        int getZeroing ();
-        /*! \brief Sets the `zero_out` flag. */
-        void setZeroing (int _zero_out);
+        /*! \brief Gets the scaling factor. */
+        float getScaling ();
+        /*! \brief Sets the scaling factor. */
+        void setScaling (float _scaling);
+        /*! \brief Checks whether a work-group configuration is valid. */
+        bool validConfig (unsigned int _width, unsigned int _height, 
+                          const std::vector<unsigned int> &params);
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
+        unsigned int lXdim, lYdim;
         clutils::CLEnv &env;
-        clutils::CLEnvInfo<2> info;
+        clutils::CLEnvInfo<1> info;
         cl::Context context;
-        cl::CommandQueue queue0;
-        BoxFilterSAT mean_p, mean_p2, mean_a, mean_b;
-        Math::Pown squared;
-        cl::Kernel ab, q;
-        cl::NDRange global;
+        MeteredQueue queue;
+        cl::Kernel kernel;
+        cl::NDRange global, local;
         Staging staging;
         unsigned int width, height, bufferSize;
-        int radius; float eps;
-        int zero_out;
-        float boxScaling, outputScaling;
+        int radius;
+        float scaling;
+        SAT sat;
+        bool ownSat;
         cl::Buffer hBufferIn, hBufferOut;
-        cl::Buffer dBufferIn, dBufferOut;
-        cl::Buffer dBufferOutA, dBufferOutB;
-        cl::Event p2Event, abEvent, mbEvent;
-        std::vector<cl::Event> waitListAB, waitListMB, waitListQ;
+        cl::Buffer dBufferOut, dBufferSat;
 
     public:
         /*! \brief Executes the necessary kernels.
          *  \details This `run` instance is used for profiling.
-         *  \note The execution is handled by two separate command queues. The 
-         *        time measured is the flat **execution** time of all the kernels. 
-         *        There is overlap in the execution of the kernels, but there are 
-         *        also gaps between them. As a compromise, and in order to simplify 
-         *        things, the execution times of all the kernels are simply added 
-         *        together. Look at the `Timeline Trace` of `CodeXL` 
-         *        for a more detailed view.
          *  
          *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
          *  \param[in] events a wait-list of events.
@@ -1642,21 +2143,17 @@ namespace GF
         template <typename period>
         double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
         {
-            double pTime;
-
-            pTime = mean_p.run (timer, events);
-            pTime += squared.run (timer);
-            pTime += mean_p2.run (timer);
-            
-            queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
-            queue0.flush (); timer.wait ();
-            pTime += timer.duration ();
+            double pTime = 0.0;
 
-            pTime += mean_a.run (timer);
-            pTime += mean_b.run (timer);
+            if (ownSat)
+            {
+                pTime = sat.run (timer, events);
+                events = nullptr;
+            }
             
-            queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
-            queue0.flush (); timer.wait ();
+            queue.enqueueNDRangeKernel (
+                kernel, cl::NullRange, global, local, events, &timer.event ());
+            queue.flush (); timer.wait ();
             pTime += timer.duration ();
 
             return pTime;
@@ -1665,10 +2162,16 @@ namespace GF
     };
 
 
-    /*! \brief Interface class for the `Guided Filter` pipeline.
-     *  \details This instantiation covers the case where \f$ I \neq p \f$.
-     *  \note The kernels, specific to the `Guided Filter` algorithm, 
-     *        are available in `kernels/guidedFilter_kernels.cl`.
+    /*! \brief Interface class for the `Summed Volume Table` operation.
+     *  \details It extends the `SAT` to volumes, \f$ depth \f$ slices of \f$ width \times height \f$ 
+     *           elements, stored slice by slice. 
+     *  \note The class makes use of the `scan`, `transpose` and `scanSlices` kernels.
+     *  \note It first scans the rows of all slices, then transposes the volume as a 
+     *        \f$ width \times (height*depth) \f$ array, and scans its rows in segments of 
+     *        \f$ height \f$ elements. That gives the summed area tables of the slices. 
+     *        Lastly, `scanSlices` scans them across the slices. The output stays in the 
+     *        transposed configuration, \f$ out[x][z][y] \f$, which is the one 
+     *        `boxFilterSAT3D` reads.
      *  \note The class creates its own buffers. If you would like to provide 
      *        your own buffers, call `get` to get references to the placeholders 
      *        within the class and assign them to your buffers. You will have to 
@@ -1676,20 +2179,2125 @@ namespace GF
      *        (after the call to `init`) to get a reference to a buffer within 
      *        the class and assign it to another kernel class instance further 
      *        down in your task pipeline.
-
-     *        The following input/output `OpenCL` memory objects are created by 
-     *        a `GuidedFilter<GuidedFilterConfig::I_NEQ_P>` instance:<br>
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `SAT3D` instance:<br>
      *        | Name | Type | Placement | I/O | Use | Properties | Size |
      *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
-     *        | H_IN_I | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*depth*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*depth*sizeof\ (cl\_float)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*depth*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$width*height*depth*sizeof\ (cl\_float)\f$ |
+     */
+    class SAT3D
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        SAT3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (SAT3D::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, unsigned int _depth, 
+                   float _scaling = 1.f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (SAT3D::Memory mem = SAT3D::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (SAT3D::Memory mem = SAT3D::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the scaling factor. */
+        float getScaling ();
+        /*! \brief Sets the scaling factor. */
+        void setScaling (float _scaling);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        Scan scanRows, scanColumns;
+        Transpose transpose;
+        cl::Kernel kernel;
+        cl::NDRange global;
+        Staging staging;
+        unsigned int width, height, depth, bufferSize;
+        float scaling;
+        cl::Buffer hBufferIn, hBufferOut;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            pTime = scanRows.run (timer, events);
+            pTime += transpose.run (timer);
+            pTime += scanColumns.run (timer);
+
+            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Enumerates the kinds of window across the slices of a volume. */
+    enum class Window3D : uint8_t
+    {
+        CENTERED,  /*!< The input is a whole volume, and the window is centered on each slice. */
+        CAUSAL     /*!< The input is a frame of a stream, and the window spans the last frames. */
+    };
+
+
+    /*! \brief Interface class for box (mean) filtering on volumes.
+     *  \details The window spans \f$ (2*radius+1)^2 \f$ elements in a slice, and, depending 
+     *           on the `Window3D` given to `init`, either \f$ 2*radiusZ+1 \f$ slices around 
+     *           each slice of a volume (`CENTERED`), or the last \f$ depth \f$ frames of 
+     *           a stream (`CAUSAL`). The windows are clamped at the borders.
+     *  \details In the `CENTERED` case, the input is a whole volume. Its summed volume table 
+     *           is computed by a `SAT3D` instance, and `boxFilterSAT3D` reads 8 elements 
+     *           of it per output element.
+     *  \details In the `CAUSAL` case, the input is one frame, and every `run` outputs the 
+     *           mean of the windows of that frame. The last \f$ depth \f$ frames are held 
+     *           in a ring buffer on the device. `ringUpdate` pushes the new frame, and updates 
+     *           the mean of the frames in the ring incrementally, so the frames aren't summed 
+     *           again every time. A `BoxFilterSAT` instance then filters the mean in 2D. Until 
+     *           the ring is full, the window spans the frames pushed so far. `reset` empties 
+     *           the ring, e.g. at a cut of the stream. 
+     *  \note The kernels are available in `kernels/boxFilter_kernels.cl`.
+     *  \note The width and height of the slices have to be multiples of 4.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `BoxFilterSAT3D` 
+     *        instance (with \f$ n = width*height*depth \f$ for `CENTERED`, and \f$ n = width*height \f$ 
+     *        for `CAUSAL`):<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$n*sizeof\ (cl\_float)\f$ |
+     */
+    class BoxFilterSAT3D
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        BoxFilterSAT3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (BoxFilterSAT3D::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, unsigned int _depth, int _radius, int _radiusZ, 
+                   Window3D _window = Window3D::CENTERED, float _scaling = 1e-4f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (BoxFilterSAT3D::Memory mem = BoxFilterSAT3D::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (BoxFilterSAT3D::Memory mem = BoxFilterSAT3D::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Empties the ring of frames. */
+        void reset ();
+        /*! \brief Gets the kind of window across the slices. */
+        Window3D getWindow ();
+        /*! \brief Gets the radius of the window in a slice. */
+        int getRadius ();
+        /*! \brief Sets the radius of the window in a slice. */
+        void setRadius (int _radius);
+        /*! \brief Gets the radius of the window across the slices. */
+        int getRadiusZ ();
+        /*! \brief Sets the radius of the window across the slices. */
+        void setRadiusZ (int _radiusZ);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernel, ringUpdate, ringAdvance;
+        cl::NDRange global, globalRing;
+        Window3D window;
+        Staging staging;
+        unsigned int width, height, depth, bufferSize;
+        int radius, radiusZ;
+        float scaling;
+        SAT3D sat;
+        BoxFilterSAT box;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut;
+        cl::Buffer dBufferRing, dBufferSum, dBufferState;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            if (window == Window3D::CENTERED)
+            {
+                pTime = sat.run (timer, events);
+
+                queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue.flush (); timer.wait ();
+                pTime += timer.duration ();
+            }
+            else
+            {
+                queue.enqueueNDRangeKernel (
+                    ringUpdate, cl::NullRange, globalRing, cl::NullRange, events, &timer.event ());
+                queue.flush (); timer.wait ();
+                pTime = timer.duration ();
+
+                queue.enqueueNDRangeKernel (
+                    ringAdvance, cl::NullRange, cl::NDRange (1), cl::NullRange, nullptr, &timer.event ());
+                queue.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                pTime += box.run (timer);
+            }
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `boxFilter` kernel.
+     *  \details `boxFilter` performs a mean filtering operation. 
+     *           For more details, look at the kernel's documentation.
+     *  \note The `boxFilter` kernel is available in `kernels/boxFilter_kernels.cl`.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `BoxFilter` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class BoxFilter
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        BoxFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (BoxFilter::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (BoxFilter::Memory mem = BoxFilter::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (BoxFilter::Memory mem = BoxFilter::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius. */
+        void setRadius (int _radius);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        static const unsigned int lXdim = 16;
+        static const unsigned int lYdim = 16;
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernel;
+        cl::NDRange global, local;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        int radius;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            queue.enqueueNDRangeKernel (
+                kernel, cl::NullRange, global, local, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+
+            return timer.duration ();
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `minFilter` kernel.
+     *  \details `minFilter` performs a min filtering operation (grayscale erosion) 
+     *           over a square window. It's applied in two passes, one over the rows 
+     *           and one over the columns, with the van Herk/Gil-Werman algorithm, 
+     *           so the work is `O(1)` per pixel, whatever the radius. 
+     *           For more details, look at the kernel's documentation.
+     *  \note The `minFilter` kernel is available in `kernels/boxFilter_kernels.cl`.
+     *  \note The window is clamped at the borders of the image.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `MinFilter` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class MinFilter
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        MinFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (MinFilter::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (MinFilter::Memory mem = MinFilter::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (MinFilter::Memory mem = MinFilter::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius. */
+        void setRadius (int _radius);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernelRows, kernelCols;
+        cl::NDRange globalRows, globalCols;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        int radius;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut, dBufferTmp;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue.enqueueNDRangeKernel (
+                kernelRows, cl::NullRange, globalRows, cl::NullRange, events, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            queue.enqueueNDRangeKernel (
+                kernelCols, cl::NullRange, globalCols, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `maxFilter` kernel.
+     *  \details `maxFilter` performs a max filtering operation (grayscale dilation) 
+     *           over a square window. It's applied in two passes, one over the rows 
+     *           and one over the columns, with the van Herk/Gil-Werman algorithm, 
+     *           so the work is `O(1)` per pixel, whatever the radius. 
+     *           For more details, look at the kernel's documentation.
+     *  \note The `maxFilter` kernel is available in `kernels/boxFilter_kernels.cl`.
+     *  \note The window is clamped at the borders of the image.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `MaxFilter` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class MaxFilter
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT   /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        MaxFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (MaxFilter::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (MaxFilter::Memory mem = MaxFilter::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (MaxFilter::Memory mem = MaxFilter::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius. */
+        void setRadius (int _radius);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Context context;
+        MeteredQueue queue;
+        cl::Kernel kernelRows, kernelCols;
+        cl::NDRange globalRows, globalCols;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        int radius;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut, dBufferTmp;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue.enqueueNDRangeKernel (
+                kernelRows, cl::NullRange, globalRows, cl::NullRange, events, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            queue.enqueueNDRangeKernel (
+                kernelCols, cl::NullRange, globalCols, cl::NullRange, nullptr, &timer.event ());
+            queue.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Enumerates configurations for the `Guided Filter` algorithm. */
+    enum class GuidedFilterConfig : uint8_t
+    {
+        I_NEQ_P,  /*!< Identifies the general case where \f$ I \neq p \f$. */
+        I_EQ_P    /*!< Identifies the special case where \f$ I == p \f$. */
+    };
+
+
+    /*! \brief Enumerates the engines that can execute the `Guided Filter` pipeline. */
+    enum class GuidedFilterEngine : uint8_t
+    {
+        SAT,   /*!< Box filtering with `BoxFilterSAT`. Works for any radius. */
+        FUSED  /*!< A single tiled kernel that does all the work in local memory. 
+                *   Works for radii up to \f$ 8 \f$. */
+    };
+
+
+    /*! \brief Interface class for the `Guided Filter` algorithm.
+     *  \details The `Guided Filter` algorithm performs a number of operations,
+     *           one of which is edge preserving smoothing.
+     *  \note Two cases are covered. One where the guidance image `I` 
+     *        is different from the input image `p`, and another where 
+     *        these two are the same.
+     *  \note This is just a declaration. Look at the explicit template specializations
+     *        for specific instantiations of the class.
+     *        
+     *  \tparam Ip enables one of the two cases of `Guided Filter` algorithm, 
+     *             \f$ I \neq p\ \f$ or \f$\ I == p \f$.
+     */
+    template <GuidedFilterConfig Ip>
+    class GuidedFilter;
+
+
+    /*! \brief Interface class for the `Guided Filter` pipeline.
+     *  \details This instantiation covers the case where \f$ I == p \f$.
+     *  \note The kernels, specific to the `Guided Filter` algorithm, 
+     *        are available in `kernels/guidedFilter_kernels.cl`.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `GuidedFilter<GuidedFilterConfig::I_EQ_P>` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT| Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT| Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *  \note For radii up to \f$ 8 \f$, `init` selects the `GuidedFilterEngine::FUSED` 
+     *        engine, if the image dimensions and the device's local memory allow it. 
+     *        The engine runs the single `gf_fused` kernel, which reads the input and 
+     *        writes the output only once, and doesn't create any intermediate buffers 
+     *        (`D_*` buffers other than the input and the output are left unallocated). 
+     *        Otherwise, the `GuidedFilterEngine::SAT` engine is selected. 
+     *        Call `setEngine` to override the selection.
+     */
+    template <>
+    class GuidedFilter<GuidedFilterConfig::I_EQ_P>
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT,  /*!< Output buffer. */
+            D_A,    /*!< Buffer of \f$ a \f$ coefficients. */
+            D_B     /*!< Buffer of \f$ b \f$ coefficients. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedFilter::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, float _eps, int _zero_out = 0, 
+                   float _boxScaling = 1e-4f, float _outputScaling = 1.f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (GuidedFilter::Memory mem = GuidedFilter::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (GuidedFilter::Memory mem = GuidedFilter::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Records the kernels once, for `replay`. */
+        void capture ();
+        /*! \brief Executes the recorded kernels. */
+        void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Submits a frame, and calls `callback` when the output is ready. */
+        void submit (const void *ptr, AsyncWindow::Callback callback);
+        /*! \brief Submits a frame, and returns a future that's ready when the output is in `out`. */
+        std::future<void> submit (const void *ptr, void *out);
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius. */
+        void setRadius (int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the scaling factor for the `BoxFilterSAT`. */
+        float getBoxScaling ();
+        /*! \brief Sets the scaling factor for the `BoxFilterSAT`. */
+        void setBoxScaling (float _boxScaling);
+        /*! \brief Gets the scaling factor for the output array. */
+        float getOutputScaling ();
+        /*! \brief Sets the scaling factor for the output array. */
+        void setOutputScaling (float _outputScaling);
+        /*! \brief Gets the `zero_out` flag. */
+        int getZeroing ();
+        /*! \brief Sets the `zero_out` flag. */
+        void setZeroing (int _zero_out);
+        /*! \brief Gets the engine that executes the pipeline. */
+        GuidedFilterEngine getEngine ();
+        /*! \brief Sets the engine that executes the pipeline. */
+        void setEngine (GuidedFilterEngine _engine);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        AsyncWindow async;  /*!< Window of the submissions made with `submit`. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        static const int fusedMaxRadius = 8;
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        BoxFilterSAT mean_p, mean_p2, mean_a, mean_b;
+        Math::Pown squared;
+        cl::Kernel ab, q;
+        cl::Kernel fused;
+        cl::NDRange global, globalFused, localFused;
+        GuidedFilterEngine engine;
+        bool autoEngine, satReady;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        int radius; float eps;
+        int zero_out;
+        float boxScaling, outputScaling;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut;
+        cl::Buffer dBufferOutA, dBufferOutB;
+        cl::Event p2Event, abEvent, mbEvent;
+        std::vector<cl::Event> waitListAB, waitListMB, waitListQ;
+        CommandGraph graph;
+
+        /*! \brief Returns the tile side of the fused kernel, or 0 if it can't be used. */
+        unsigned int fusedSide (int _radius);
+        /*! \brief Sets up the selected engine. */
+        void initEngine ();
+        /*! \brief Sets up the `BoxFilterSAT` based pipeline. */
+        void initSAT ();
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  \note The execution is handled by two separate command queues. The 
+         *        time measured is the flat **execution** time of all the kernels. 
+         *        There is overlap in the execution of the kernels, but there are 
+         *        also gaps between them. As a compromise, and in order to simplify 
+         *        things, the execution times of all the kernels are simply added 
+         *        together. Look at the `Timeline Trace` of `CodeXL` 
+         *        for a more detailed view.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            if (engine == GuidedFilterEngine::FUSED)
+            {
+                queue0.enqueueNDRangeKernel (
+                    fused, cl::NullRange, globalFused, localFused, events, &timer.event ());
+                queue0.flush (); timer.wait ();
+
+                return timer.duration ();
+            }
+
+            double pTime;
+
+            pTime = mean_p.run (timer, events);
+            pTime += squared.run (timer);
+            pTime += mean_p2.run (timer);
+            
+            queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            pTime += mean_a.run (timer);
+            pTime += mean_b.run (timer);
+            
+            queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `Guided Filter` pipeline.
+     *  \details This instantiation covers the case where \f$ I \neq p \f$.
+     *  \note The kernels, specific to the `Guided Filter` algorithm, 
+     *        are available in `kernels/guidedFilter_kernels.cl`.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `GuidedFilter<GuidedFilterConfig::I_NEQ_P>` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_I | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_P | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_I | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_P | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *  \note The computation of the coefficients \f$ a, b \f$ depends on four independent 
+     *        branches, \f$ mean_I, mean_p, corr_I, corr_{Ip} \f$, and their smoothing 
+     *        depends on two more, \f$ mean_a, mean_b \f$. `run` submits these branches 
+     *        as an explicit event graph. When the class is given **two** command queues, 
+     *        the branches are paired up on them. When it is given **four** command queues, 
+     *        each of the first four branches gets its own queue, which lets the device 
+     *        overlap them, and fill up, at small and medium resolutions.
+     *  \note For radii up to \f$ 8 \f$, `init` selects the `GuidedFilterEngine::FUSED` 
+     *        engine, if the image dimensions and the device's local memory allow it. 
+     *        The engine runs the single `gf_fused_Ip` kernel, which reads the inputs and 
+     *        writes the output only once, and doesn't create any intermediate buffers 
+     *        (`D_*` buffers other than the inputs and the output are left unallocated). 
+     *        Otherwise, the `GuidedFilterEngine::SAT` engine is selected. 
+     *        Call `setEngine` to override the selection.
+     */
+    template <>
+    class GuidedFilter<GuidedFilterConfig::I_NEQ_P>
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_I,    /*!< Input staging buffer for the guidance image. */
+            H_IN_P,    /*!< Input staging buffer for the input image. */
+            H_OUT,     /*!< Output staging buffer. */
+            D_IN_I,    /*!< Input buffer for the guidance image. */
+            D_IN_P,    /*!< Input buffer for the input image. */
+            D_OUT,     /*!< Output buffer. */
+            D_VAR_I,   /*!< Buffer of variance values for the guidance image. */
+            D_COV_IP,  /*!< Buffer of covariance values between the guidance and input images. */
+            D_A,       /*!< Buffer of \f$ a \f$ coefficients. */
+            D_B,       /*!< Buffer of \f$ b \f$ coefficients. */
+            D_MEAN_A,  /*!< Buffer of average \f$ a \f$ coefficients in the local windows. */
+            D_MEAN_B   /*!< Buffer of average \f$ b \f$ coefficients in the local windows. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Configures an OpenCL environment as specified by `_info`, 
+         *         with one command queue per independent branch. */
+        GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<4> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedFilter::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, float _eps, 
+                   int _zero_out = 0, float _boxScaling = 1e-4f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (GuidedFilter::Memory mem = GuidedFilter::Memory::D_IN_I, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (GuidedFilter::Memory mem = GuidedFilter::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Records the kernels once, for `replay`. */
+        void capture ();
+        /*! \brief Executes the recorded kernels. */
+        void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Submits a pair of frames, and calls `callback` when the output is ready. */
+        void submit (const void *ptrI, const void *ptrP, AsyncWindow::Callback callback);
+        /*! \brief Submits a pair of frames, and returns a future that's ready when the output is in `out`. */
+        std::future<void> submit (const void *ptrI, const void *ptrP, void *out);
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius. */
+        void setRadius (int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the scaling factor for the `BoxFilterSAT`. */
+        float getBoxScaling ();
+        /*! \brief Sets the scaling factor for the `BoxFilterSAT`. */
+        void setBoxScaling (float _boxScaling);
+        /*! \brief Gets the `zero_out` flag. */
+        int getZeroing ();
+        /*! \brief Sets the `zero_out` flag. */
+        void setZeroing (int _zero_out);
+        /*! \brief Gets the engine that executes the pipeline. */
+        GuidedFilterEngine getEngine ();
+        /*! \brief Sets the engine that executes the pipeline. */
+        void setEngine (GuidedFilterEngine _engine);
+
+        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance image. */
+        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input image. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        AsyncWindow async;  /*!< Window of the submissions made with `submit`. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        static const int fusedMaxRadius = 8;
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<4> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        BoxFilterSAT mean_I, mean_p, corr_I, corr_Ip, mean_a, mean_b;
+        Math::Mult mult_II, mult_Ip;
+        cl::Kernel var, ab, q;
+        cl::Kernel fused;
+        cl::NDRange global, globalFused, localFused;
+        GuidedFilterEngine engine;
+        bool autoEngine, satReady;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        int radius; float eps;
+        int zero_out;
+        float boxScaling;
+        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
+        cl::Buffer dBufferInI, dBufferInP, dBufferOut;
+        cl::Buffer dBufferOutVarI, dBufferOutCovIp;
+        cl::Buffer dBufferOutA, dBufferOutB;
+        cl::Event meanpEvent, corrIEvent, corrIpEvent, abEvent, mbEvent;
+        std::vector<cl::Event> waitListVar, waitListMB, waitListQ;
+        CommandGraph graph;
+
+        /*! \brief Maps the two command queues of `_info` onto the four branches. */
+        static clutils::CLEnvInfo<4> branchInfo (clutils::CLEnvInfo<2> &_info);
+        /*! \brief Returns the tile side of the fused kernel, or 0 if it can't be used. */
+        unsigned int fusedSide (int _radius);
+        /*! \brief Sets up the selected engine. */
+        void initEngine ();
+        /*! \brief Sets up the `BoxFilterSAT` based pipeline. */
+        void initSAT ();
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  \note The execution is handled by separate command queues. The 
+         *        time measured is the flat **execution** time of all the kernels. 
+         *        There is overlap in the execution of the kernels, but there are 
+         *        also gaps between them. As a compromise, and in order to simplify 
+         *        things, the execution times of all the kernels are simply added 
+         *        together. Look at the `Timeline Trace` of `CodeXL` 
+         *        for a more detailed view.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            if (engine == GuidedFilterEngine::FUSED)
+            {
+                queue0.enqueueNDRangeKernel (
+                    fused, cl::NullRange, globalFused, localFused, events, &timer.event ());
+                queue0.flush (); timer.wait ();
+
+                return timer.duration ();
+            }
+
+            double pTime;
+
+            pTime = mean_I.run (timer, events);
+            pTime += mean_p.run (timer, events);
+            pTime += mult_II.run (timer, events);
+            pTime += mult_Ip.run (timer, events);
+            pTime += corr_I.run (timer);
+            pTime += corr_Ip.run (timer);
+            
+            queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            pTime += mean_a.run (timer);
+            pTime += mean_b.run (timer);
+            
+            queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for running the `Guided Filter` pipeline on multiple devices.
+     *  \details The image is partitioned into horizontal bands, one per device. Each band 
+     *           is extended by a halo of \f$ 2*radius \f$ rows on each side that borders 
+     *           another band (the coefficients \f$ a, b \f$ depend on a \f$ radius \f$ 
+     *           neighborhood, and their means on another \f$ radius \f$ one), and it's 
+     *           processed by a `GuidedFilter<Ip>` instance on its device. The halo rows 
+     *           are then dropped, and the band cores are gathered in the output staging buffer.
+     *  \note The devices can belong to the same or to different contexts. All transfers 
+     *        go through host memory, so each device only needs its own command queues.
+     *  \note The band heights are set so that the devices finish together, given the throughput 
+     *        of each device, measured in rows (halos included) per millisecond. Initially, the throughput is estimated from the number 
+     *        of compute units and the clock frequency of the devices. When all command queues 
+     *        have been created with `CL_QUEUE_PROFILING_ENABLE`, every `read` measures the 
+     *        actual throughput (from the start of the first write to the end of the gather), 
+     *        and, when the devices finish more than `10%` apart, the bands are resized. 
+     *        Resizing a band re-creates its `GuidedFilter<Ip>` instance.
+     *  \note The band cores, and the halos, are multiples of \f$ 16 \f$ rows, so the 
+     *        image height has to be a multiple of \f$ 16 \f$, and there can be no more 
+     *        devices than \f$ height / 16 \f$.
+     *  \note For \f$ I == p \f$, `H_IN_I` and `H_IN_P` refer to the same buffer, and 
+     *        `hPtrInI` is equal to `hPtrInP`.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by 
+     *        a `GuidedFilterMultiDevice` instance (on the context of the first device):<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_I | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_P | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        
+     *  \tparam Ip enables one of the two cases of `Guided Filter` algorithm, 
+     *             \f$ I \neq p\ \f$ or \f$\ I == p \f$.
+     */
+    template <GuidedFilterConfig Ip>
+    class GuidedFilterMultiDevice
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_I,  /*!< Input staging buffer for the guidance image. */
+            H_IN_P,  /*!< Input staging buffer for the input image. */
+            H_OUT    /*!< Output staging buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment on each device specified in `_info`. */
+        GuidedFilterMultiDevice (clutils::CLEnv &_env, std::vector<clutils::CLEnvInfo<2>> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedFilterMultiDevice::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, float _eps, 
+                   int _zero_out = 0, float _boxScaling = 1e-4f);
+        /*! \brief Transfers the bands (halos included) to the devices. */
+        void write (void *ptrI = nullptr, void *ptrP = nullptr);
+        /*! \brief Executes the pipelines, and gathers the bands in the output staging buffer. */
+        void run ();
+        /*! \brief Waits for the gathering to complete, and updates the load balancing. */
+        void* read ();
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the number of rows (halos excluded) assigned to each device. */
+        std::vector<unsigned int> getBandHeights ();
+        /*! \brief Gets the measured throughput (rows per ms) of each device. */
+        std::vector<double> getThroughput ();
+        /*! \brief Sets the throughput (rows per ms) of each device, and resizes the bands. */
+        void setThroughput (const std::vector<double> &_throughput);
+
+        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance image. */
+        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input image. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        /*! \brief Holds the state of a band. */
+        struct Band
+        {
+            clutils::CLEnvInfo<2> info;
+            MeteredQueue queue;
+            std::unique_ptr<GuidedFilter<Ip>> gf;
+            unsigned int row, rows;  // Core
+            unsigned int top, bottom;  // Halos
+            std::vector<cl::Event> writeEvents;
+            cl::Event runEvent, readEvent;
+            bool profiling;
+        };
+
+        static const unsigned int rowAlign = 16;
+        static constexpr double rebalanceThreshold = 1.1;
+        clutils::CLEnv &env;
+        cl::Context context;
+        MeteredQueue queue;
+        std::vector<Band> bands;
+        std::vector<double> throughput;
+        unsigned int width, height, bufferSize;
+        int radius; float eps;
+        int zero_out;
+        float boxScaling;
+        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
+        std::chrono::steady_clock::time_point frameStart;
+
+        /*! \brief Partitions the image according to the throughput of the devices. */
+        void partition ();
+        /*! \brief Creates and configures the `GuidedFilter` instance of a band. */
+        void initBand (Band &band);
+        /*! \brief Transfers a band (halos included) to its device. */
+        void writeBand (Band &band);
+    };
+
+
+    /*! \brief Interface class for guided upsampling.
+     *  \details It upsamples a low-resolution input image \f$ p \f$ to the resolution 
+     *           of a high-resolution guidance image \f$ I \f$. The guide is downsampled 
+     *           to the resolution of \f$ p \f$ (`gf_downsample`), the coefficients 
+     *           \f$ \bar{a}, \bar{b} \f$ are computed at the low resolution by 
+     *           `GuidedFilter<GuidedFilterConfig::I_NEQ_P>`, and they are upsampled 
+     *           bilinearly and applied on the high-resolution guide (`gf_q_upsample`). 
+     *           That is, all the `BoxFilterSAT` stages run at the low resolution, 
+     *           and the output is aligned with the guide.
+     *  \note The radius is given in high-resolution pixels. The low-resolution 
+     *        pipeline uses a radius of \f$ max (radius / factor, 1) \f$.
+     *  \note The low-resolution pipeline always runs on the `GuidedFilterEngine::SAT` engine.
+     *  \note When `zero_out` is set, the output pixels whose nearest \f$ p \f$ 
+     *        pixel is zero are zeroed out (e.g. holes in a depth image).
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `GuidedUpsampling` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_I | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_P | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height/factor^2*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_I | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_P | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height/factor^2*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class GuidedUpsampling
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_I,  /*!< Input staging buffer for the (high-resolution) guidance image. */
+            H_IN_P,  /*!< Input staging buffer for the (low-resolution) input image. */
+            H_OUT,   /*!< Output staging buffer. */
+            D_IN_I,  /*!< Input buffer for the (high-resolution) guidance image. */
+            D_IN_P,  /*!< Input buffer for the (low-resolution) input image. */
+            D_OUT    /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        GuidedUpsampling (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedUpsampling::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, unsigned int _factor, int _radius, float _eps, 
+                   int _zero_out = 0, float _boxScaling = 1e-4f, float _outputScaling = 1.f, 
+                   Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (GuidedUpsampling::Memory mem = GuidedUpsampling::Memory::D_IN_I, void *ptr = nullptr, 
+                    bool block = CL_FALSE, const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (GuidedUpsampling::Memory mem = GuidedUpsampling::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the filter window radius (in high-resolution pixels). */
+        int getRadius ();
+        /*! \brief Sets the filter window radius (in high-resolution pixels). */
+        void setRadius (int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the scaling factor of the output. */
+        float getOutputScaling ();
+        /*! \brief Sets the scaling factor of the output. */
+        void setOutputScaling (float _outputScaling);
+
+        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance image. */
+        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input image. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        GuidedFilter<GuidedFilterConfig::I_NEQ_P> gf;
+        cl::Kernel down, up;
+        cl::NDRange globalLow, globalHigh;
+        Staging staging;
+        unsigned int width, height, factor;
+        unsigned int bufferSize, bufferLowSize;
+        int radius; float eps;
+        int zero_out;
+        float outputScaling;
+        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
+        cl::Buffer dBufferInI, dBufferInP, dBufferOut;
+        cl::Event dEvent; std::vector<cl::Event> waitList;
+
+        /*! \brief Returns the radius of the low-resolution pipeline. */
+        int lowRadius (int _radius);
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue0.enqueueNDRangeKernel (down, cl::NullRange, globalLow, cl::NullRange, events, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            pTime += gf.run (timer);
+
+            queue0.enqueueNDRangeKernel (up, cl::NullRange, globalHigh, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the iterated `Guided Filter` (e.g. rolling guidance).
+     *  \details It applies `GuidedFilter<GuidedFilterConfig::I_NEQ_P>` on the input 
+     *           image \f$ p \f$ for a number of iterations, and feeds the output of 
+     *           each iteration back as the guide of the next one, i.e. 
+     *           \f$ I^{t+1} = GF (I^t, p) \f$. The first guide is \f$ I \f$. 
+     *           The iterations stay on the device. The filter, and its `BoxFilterSAT` 
+     *           scratch buffers, are set up once, and the output is fed back by 
+     *           `gf_feedback`, which also computes the change of the guide 
+     *           \f$ max |I^{t+1} - I^t| \f$.
+     *  \details When a tolerance is set, the iterations stop early, once the change 
+     *           drops to or below it. The decision is taken on the device, by `gf_feedback`, 
+     *           so the host never waits in between iterations. All the iterations are 
+     *           still enqueued, but the ones past the converged one leave the guide and 
+     *           the output as they are. The changes are read back once, after the last 
+     *           iteration. Keep in mind that the filter itself still executes in the 
+     *           skipped iterations, so the number of iterations shouldn't be set much 
+     *           higher than it takes to converge.
+     *  \note The function call is non-blocking. `getExecuted` and `getResidual` 
+     *        block until the changes have been read back.
+     *  \note `record` records all the iterations, and ignores the tolerance.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `GuidedFilterIterated` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_I | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | H_IN_P | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | D_IN_I | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
      *        | D_IN_P | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
-     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class GuidedFilterIterated
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_I,  /*!< Input staging buffer for the (first) guidance image. */
+            H_IN_P,  /*!< Input staging buffer for the input image. */
+            H_OUT,   /*!< Output staging buffer. */
+            D_IN_I,  /*!< Input buffer for the (first) guidance image. */
+            D_IN_P,  /*!< Input buffer for the input image. */
+            D_OUT,   /*!< Output buffer. */
+            D_GUIDE  /*!< Buffer of the guidance image of the current iteration. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        GuidedFilterIterated (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedFilterIterated::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _radius, float _eps, 
+                   unsigned int _iterations, float _tolerance = 0.f, float _boxScaling = 1e-4f, 
+                   Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (GuidedFilterIterated::Memory mem = GuidedFilterIterated::Memory::D_IN_I, void *ptr = nullptr, 
+                    bool block = CL_FALSE, const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (GuidedFilterIterated::Memory mem = GuidedFilterIterated::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the filter window radius. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius. */
+        void setRadius (int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the (maximum) number of iterations. */
+        unsigned int getIterations ();
+        /*! \brief Sets the (maximum) number of iterations. */
+        void setIterations (unsigned int _iterations);
+        /*! \brief Gets the tolerance on the change of the guide. */
+        float getTolerance ();
+        /*! \brief Sets the tolerance on the change of the guide. */
+        void setTolerance (float _tolerance);
+        /*! \brief Returns the number of iterations executed by the last `run`. */
+        unsigned int getExecuted ();
+        /*! \brief Returns the change of the guide in an iteration of the last `run`. */
+        float getResidual (unsigned int iteration);
+
+        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance image. */
+        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input image. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        GuidedFilter<GuidedFilterConfig::I_NEQ_P> gf;
+        cl::Kernel seed, feedback, relay;
+        cl::NDRange global, local;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        int radius; float eps;
+        unsigned int iterations, executed;
+        float tolerance;
+        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
+        cl::Buffer dBufferInI, dBufferInP, dBufferOut, dBufferGuide;
+        cl::Buffer hBufferResiduals, dBufferResiduals;
+        cl_uint *hPtrResiduals;
+        std::vector<cl_uint> zeros;
+        cl::Event readEvent;
+        std::vector<cl::Event> waitList;
+
+        /*! \brief Creates the buffers of the changes of the guide. */
+        void initResiduals ();
+        /*! \brief Returns the change of the guide kept in an element of the residuals. */
+        float residualAt (unsigned int slot);
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling. 
+         *           It executes all the iterations, and ignores the tolerance.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue0.enqueueWriteBuffer (dBufferResiduals, CL_FALSE, 0, zeros.size () * sizeof (cl_uint), zeros.data (), events);
+            queue0.enqueueNDRangeKernel (seed, cl::NullRange, global, local, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            for (unsigned int i = 0; i < iterations; ++i)
+            {
+                pTime += gf.run (timer);
+
+                relay.setArg (3, i + 1);
+                queue0.enqueueNDRangeKernel (relay, cl::NullRange, global, local, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+            }
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for multi-scale detail enhancement and tone mapping.
+     *  \details The normalized log-luminance \f$ l \f$ of an `RGB` image (`gf_logLuminance`) 
+     *           is decomposed into a base layer and detail layers, with the `Guided Filter` 
+     *           (\f$ I == p \f$) at several radii. The base layer of scale \f$ k \f$ is 
+     *           \f$ B_k = GF_{r_k} (l) \f$, and its detail layer is \f$ D_k = B_{k-1} - B_k \f$, 
+     *           with \f$ B_{-1} = l \f$. The detail layers are boosted, the coarsest base layer 
+     *           is compressed, and the colors are scaled accordingly, exposed, and gamma encoded 
+     *           (`gf_detailCombine`). For more details, look at the kernels' documentation.
+     *  \details The pipeline is assembled from the building blocks of 
+     *           `GuidedFilter<GuidedFilterConfig::I_EQ_P>` (`BoxFilterSAT`, `gf_ab`). The summed 
+     *           area tables of \f$ l, l^2 \f$ are computed once, and shared by all scales. 
+     *           The base layers are never stored. The last kernel computes them from the 
+     *           \f$ \bar{a}, \bar{b} \f$ coefficients of all scales, and writes the `uchar` output.
+     *  \note The input is an array of interleaved `float` `RGB` values. Values in \f$ [0, 1] \f$ 
+     *        are displayable, and larger values (high dynamic range) are brought into range 
+     *        by the compression. The output is an array of interleaved `uchar` `RGB` values.
+     *  \note There can be up to 4 scales, with radii in increasing order.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `DetailEnhancement` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN  | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_uchar)\f$ |
+     *        | D_IN  | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$3*width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$3*width*height*sizeof\ (cl\_uchar)\f$ |
+     */
+    class DetailEnhancement
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_OUT,  /*!< Output buffer. */
+            D_LUM   /*!< Buffer of the normalized log-luminance. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        DetailEnhancement (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (DetailEnhancement::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, const std::vector<int> &_radii, 
+                   float _eps, float _boxScaling = 1e-4f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (DetailEnhancement::Memory mem = DetailEnhancement::Memory::D_IN, void *ptr = nullptr, 
+                    bool block = CL_FALSE, const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (DetailEnhancement::Memory mem = DetailEnhancement::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the number of scales. */
+        unsigned int getScales ();
+        /*! \brief Gets the filter window radius of a scale. */
+        int getRadius (unsigned int scale);
+        /*! \brief Sets the filter window radius of a scale. */
+        void setRadius (unsigned int scale, int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the boost factor of the detail layer of a scale. */
+        float getBoost (unsigned int scale);
+        /*! \brief Sets the boost factor of the detail layer of a scale. */
+        void setBoost (unsigned int scale, float _boost);
+        /*! \brief Gets the compression factor of the base layer. */
+        float getCompression ();
+        /*! \brief Sets the compression factor of the base layer. */
+        void setCompression (float _compression);
+        /*! \brief Gets the log-luminance that the compression maps to itself. */
+        float getAnchor ();
+        /*! \brief Sets the log-luminance that the compression maps to itself. */
+        void setAnchor (float _anchor);
+        /*! \brief Gets the exposure factor. */
+        float getExposure ();
+        /*! \brief Sets the exposure factor. */
+        void setExposure (float _exposure);
+        /*! \brief Gets the gamma of the output encoding. */
+        float getGamma ();
+        /*! \brief Sets the gamma of the output encoding. */
+        void setGamma (float _gamma);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_uchar *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        /*! \brief Holds the state of a scale. */
+        struct Scale
+        {
+            std::unique_ptr<BoxFilterSAT> mean_l, corr_l, mean_a, mean_b;
+            cl::Kernel ab;
+            int radius;
+            float boost;
+            cl::Event corrEvent, abEvent, mbEvent;
+            std::vector<cl::Event> waitListAB, waitListMB;
+        };
+
+        static const unsigned int maxScales = 4;
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        cl::Kernel lum, combine;
+        cl::NDRange global, globalAB;
+        Staging staging;
+        unsigned int width, height, bufferSize, bufferSizeIn, bufferSizeOut;
+        std::vector<Scale> scales;
+        float eps, boxScaling;
+        float compression, anchor, exposure, gamma;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut, dBufferLum, dBufferLum2;
+        cl::Event lumEvent;
+        std::vector<cl::Event> waitListCorr, waitListCombine;
+
+        /*! \brief Sets the boost factors of all scales on the combining kernel. */
+        void setBoosts ();
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue0.enqueueNDRangeKernel (lum, cl::NullRange, global, cl::NullRange, events, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            for (Scale &scale : scales)
+            {
+                pTime += scale.mean_l->run (timer);
+                pTime += scale.corr_l->run (timer);
+            }
+
+            for (Scale &scale : scales)
+            {
+                queue0.enqueueNDRangeKernel (scale.ab, cl::NullRange, globalAB, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                pTime += scale.mean_a->run (timer);
+                pTime += scale.mean_b->run (timer);
+            }
+
+            queue0.enqueueNDRangeKernel (combine, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for single image dehazing with the dark channel prior.
+     *  \details The pipeline runs entirely on the device:
+     *           - the dark channel, \f$ min_{\Omega} min_c I_c \f$ (`gf_dehazePrepare`, `MinFilter`),
+     *           - the atmospheric light \f$ A \f$, the mean color of the haziest \f$ 0.1\% \f$ 
+     *             of the pixels by the dark channel, found with a histogram and two reductions 
+     *             (`gf_dehazeHistogram`, `gf_dehazeLightSums`, `gf_dehazeLight`),
+     *           - the transmission estimate, \f$ \tilde{t} = 1 - \omega\ min_{\Omega} min_c (I_c / A_c) \f$ 
+     *             (`gf_dehazeTransmission`, `MaxFilter`),
+     *           - its refinement by `GuidedFilter<GuidedFilterConfig::I_NEQ_P>`, 
+     *             with the luminance of the image as the guide,
+     *           - and the recovery, \f$ J = (I - A) / max (t, t_0) + A \f$ (`gf_dehazeRecover`).
+     *           
+     *           For more details, look at the kernels' documentation.
+     *  \note The input and output are arrays of interleaved `float` `RGB` values in \f$ [0, 1] \f$.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `Dehazing` instance:<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN  | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN  | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$3*width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$3*width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class Dehazing
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN,            /*!< Input staging buffer. */
+            H_OUT,           /*!< Output staging buffer. */
+            D_IN,            /*!< Input buffer. */
+            D_OUT,           /*!< Output buffer. */
+            D_DARK,          /*!< Buffer of the dark channel. */
+            D_TRANSMISSION,  /*!< Buffer of the refined transmission. */
+            D_LIGHT          /*!< Buffer of the atmospheric light, \f$ (R, G, B, 0) \f$. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        Dehazing (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (Dehazing::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, int _darkRadius, int _radius, float _eps, 
+                   float _omega = 0.95f, float _t0 = 0.1f, float _boxScaling = 1e-4f, 
+                   Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (Dehazing::Memory mem = Dehazing::Memory::D_IN, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (Dehazing::Memory mem = Dehazing::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Returns the atmospheric light estimated by the last `run`. */
+        cl_float4 getAtmosphericLight ();
+        /*! \brief Gets the radius of the dark channel window. */
+        int getDarkRadius ();
+        /*! \brief Sets the radius of the dark channel window. */
+        void setDarkRadius (int _darkRadius);
+        /*! \brief Gets the filter window radius of the transmission refinement. */
+        int getRadius ();
+        /*! \brief Sets the filter window radius of the transmission refinement. */
+        void setRadius (int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+        /*! \brief Gets the fraction of the haze to remove, \f$ \omega \f$. */
+        float getOmega ();
+        /*! \brief Sets the fraction of the haze to remove, \f$ \omega \f$. */
+        void setOmega (float _omega);
+        /*! \brief Gets the lower bound of the transmission, \f$ t_0 \f$. */
+        float getMinTransmission ();
+        /*! \brief Sets the lower bound of the transmission, \f$ t_0 \f$. */
+        void setMinTransmission (float _t0);
+
+        cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        static const unsigned int histBins = 256;
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        MinFilter dark;
+        MaxFilter trans;
+        GuidedFilter<GuidedFilterConfig::I_NEQ_P> gf;
+        cl::Kernel prepare, histogram, lightSums, light, transmission, recover;
+        cl::NDRange global, globalRed, localRed;
+        Staging staging;
+        unsigned int width, height, bufferSize, bufferSizeRGB;
+        int darkRadius, radius; float eps;
+        float omega, t0;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferOut, dBufferMin, dBufferGray, dBufferRaw;
+        cl::Buffer dBufferHist, dBufferSums, dBufferLight;
+        cl::Event tEvent, gfEvent;
+        std::vector<cl::Event> waitListGF, waitListRecover;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            queue0.enqueueNDRangeKernel (prepare, cl::NullRange, global, cl::NullRange, events, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime = timer.duration ();
+
+            pTime += dark.run (timer);
+
+            queue0.enqueueNDRangeKernel (histogram, cl::NullRange, globalRed, localRed, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            queue0.enqueueNDRangeKernel (lightSums, cl::NullRange, globalRed, localRed, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            queue0.enqueueNDRangeKernel (light, cl::NullRange, localRed, localRed, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            queue0.enqueueNDRangeKernel (transmission, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            pTime += trans.run (timer);
+            pTime += gf.run (timer);
+
+            queue0.enqueueNDRangeKernel (recover, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `Guided Filter` algorithm on volumes and video streams.
+     *  \details It's the \f$ I \neq p \f$ case of the algorithm, with the square windows 
+     *           extended across the slices of a volume (e.g. medical volumes, or whole 
+     *           video clips), or across the last frames of a stream (for temporal stability 
+     *           of filtered video). The means are computed by `BoxFilterSAT3D` instances, 
+     *           and the coefficients by the kernels of `GuidedFilter<GuidedFilterConfig::I_NEQ_P>`.
+     *  \details With a `CENTERED` window, the inputs are whole volumes, \f$ depth \f$ slices 
+     *           of \f$ width \times height \f$ elements stored slice by slice, and the window 
+     *           spans \f$ 2*radiusZ+1 \f$ slices. With a `CAUSAL` window, the inputs are one 
+     *           frame each, and every `run` filters that frame. The windows span the last 
+     *           \f$ depth \f$ frames, in both stages of the algorithm, i.e. the coefficients 
+     *           \f$ \bar{a}, \bar{b} \f$ average the windows of the last frames. The rings of 
+     *           frames are updated incrementally on the device, so the cost of a frame doesn't 
+     *           depend on \f$ depth \f$. `reset` starts a new stream.
+     *  \note The class requires **two** `(2)` **command queues** (on the same device). 
+     *        The `I`, `I*I` and \f$ a \f$ branches run on the first, and the `p`, `I*p` 
+     *        and \f$ b \f$ branches on the second.
+     *  \note The width and height of the slices have to be multiples of 4.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `GuidedFilter3D` 
+     *        instance (with \f$ n = width*height*depth \f$ for `CENTERED`, and \f$ n = width*height \f$ 
+     *        for `CAUSAL`):<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_I | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_P | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT  | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_I | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_P | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$n*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT  | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$n*sizeof\ (cl\_float)\f$ |
+     */
+    class GuidedFilter3D
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_I,  /*!< Input staging buffer for the guidance volume. */
+            H_IN_P,  /*!< Input staging buffer for the input volume. */
+            H_OUT,   /*!< Output staging buffer. */
+            D_IN_I,  /*!< Input buffer for the guidance volume. */
+            D_IN_P,  /*!< Input buffer for the input volume. */
+            D_OUT    /*!< Output buffer. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        GuidedFilter3D (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedFilter3D::Memory mem);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, unsigned int _depth, int _radius, int _radiusZ, 
+                   float _eps, Window3D _window = Window3D::CENTERED, float _boxScaling = 1e-4f, 
+                   Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (GuidedFilter3D::Memory mem = GuidedFilter3D::Memory::D_IN_I, void *ptr = nullptr, bool block = CL_FALSE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (GuidedFilter3D::Memory mem = GuidedFilter3D::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Starts a new stream. */
+        void reset ();
+        /*! \brief Gets the kind of window across the slices. */
+        Window3D getWindow ();
+        /*! \brief Gets the radius of the window in a slice. */
+        int getRadius ();
+        /*! \brief Sets the radius of the window in a slice. */
+        void setRadius (int _radius);
+        /*! \brief Gets the radius of the window across the slices. */
+        int getRadiusZ ();
+        /*! \brief Sets the radius of the window across the slices. */
+        void setRadiusZ (int _radiusZ);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+
+        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance volume. */
+        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input volume. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        BoxFilterSAT3D mean_I, mean_p, corr_I, corr_Ip, mean_a, mean_b;
+        Math::Mult mult_II, mult_Ip;
+        cl::Kernel var, ab, q;
+        cl::NDRange global;
+        Window3D window;
+        Staging staging;
+        unsigned int width, height, depth, bufferSize;
+        int radius, radiusZ;
+        float eps, boxScaling;
+        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
+        cl::Buffer dBufferInI, dBufferInP, dBufferOut;
+        cl::Buffer dBufferVarI, dBufferCovIp, dBufferA, dBufferB;
+        cl::Event corrIpEvent, abEvent, mbEvent;
+        std::vector<cl::Event> waitListVar, waitListMB, waitListQ;
+
+    public:
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  \note The execution is handled by separate command queues. The 
+         *        time measured is the flat **execution** time of all the kernels.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            pTime = mean_I.run (timer, events);
+            pTime += mean_p.run (timer, events);
+            pTime += mult_II.run (timer, events);
+            pTime += mult_Ip.run (timer, events);
+            pTime += corr_I.run (timer);
+            pTime += corr_Ip.run (timer);
+            
+            queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            pTime += mean_a.run (timer);
+            pTime += mean_b.run (timer);
+            
+            queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Interface class for the `Guided Filter` algorithm on many inputs with a shared guide.
+     *  \details It's the \f$ I \neq p \f$ case of the algorithm, for `channels` inputs \f$ p \f$ 
+     *           (e.g. the planes of an `RGB` image, a set of alpha mattes, or feature maps) 
+     *           that are filtered against the same guide \f$ I \f$. The statistics of the guide, 
+     *           \f$ \bar{I} \f$ and \f$ \sigma_I^2+\epsilon \f$, are computed once by `prepare` 
+     *           (`BoxFilterSAT`, `Math::Mult`, `gf_var_I`). Then, every `run` computes, for every 
+     *           channel, only \f$ \bar{p} \f$, \f$ \overline{Ip} \f$ (`BoxFilterSAT`), the coefficients 
+     *           (`gf_ab_shared`), \f$ \bar{a}, \bar{b} \f$ (`BoxFilterSAT`) and the output (`gf_q`). 
+     *           The guide has to be prepared again only when \f$ I \f$, the radius, 
+     *           or \f$ \epsilon \f$ change. The statistics can also be transferred from 
+     *           and to the host (`writeStatistics`, `readStatistics`), so they can be 
+     *           kept across instances and processes (look at `GuideCache`).
+     *  \note The class requires **two** `(2)` **command queues** (on the same device). 
+     *        The guide statistics, the coefficients and the outputs are computed on the first, 
+     *        and the \f$ \bar{p} \f$, \f$ \overline{Ip} \f$ means of the channels on the second. 
+     *        So, the means of the next channels overlap with the coefficients of the current one.
+     *  \note The width and height of the images have to be multiples of 4.
+     *  \note The channels are separate planes. An image with interleaved channels can be 
+     *        split first with `SeparateRGB`, by assigning its outputs to the `D_IN_P` planes.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `GuidedFilterShared` 
+     *        instance (`D_IN_P` and `D_OUT` are one buffer per channel):<br>
+     *        | Name | Type | Placement | I/O | Use | Properties | Size |
+     *        | ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN_I   | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_IN_P   | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$channels*width*height*sizeof\ (cl\_float)\f$ |
+     *        | H_OUT    | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$channels*width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_I   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_IN_P   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT    | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_MEAN_I | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_VAR_I  | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$width*height*sizeof\ (cl\_float)\f$ |
+     */
+    class GuidedFilterShared
+    {
+    public:
+        /*! \brief Enumerates the memory objects handled by the class.
+         *  \note `H_*` names refer to staging buffers on the host.
+         *  \note `D_*` names refer to buffers on the device.
+         */
+        enum class Memory : uint8_t
+        {
+            H_IN_I,    /*!< Input staging buffer for the guidance image. */
+            H_IN_P,    /*!< Input staging buffer for the input planes. */
+            H_OUT,     /*!< Output staging buffer for the output planes. */
+            D_IN_I,    /*!< Input buffer for the guidance image. */
+            D_IN_P,    /*!< Input buffer for an input plane. */
+            D_OUT,     /*!< Output buffer for an output plane. */
+            D_MEAN_I,  /*!< Buffer of the average \f$ I \f$ values, \f$ \bar{I} \f$. */
+            D_VAR_I    /*!< Buffer of the regularized variance of the guide, \f$ \sigma_I^2+\epsilon \f$. */
+        };
+
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        GuidedFilterShared (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        /*! \brief Returns a reference to an internal memory object. */
+        cl::Memory& get (GuidedFilterShared::Memory mem, unsigned int channel = 0);
+        /*! \brief Configures kernel execution parameters. */
+        void init (unsigned int _width, unsigned int _height, unsigned int _channels, int _radius, 
+                   float _eps, float _boxScaling = 1e-4f, Staging _staging = Staging::IO);
+        /*! \brief Performs a data transfer to a device buffer. */
+        void write (GuidedFilterShared::Memory mem = GuidedFilterShared::Memory::D_IN_I, void *ptr = nullptr, 
+                    bool block = CL_FALSE, const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Performs a data transfer to a staging buffer. */
+        void* read (GuidedFilterShared::Memory mem = GuidedFilterShared::Memory::H_OUT, bool block = CL_TRUE, 
+                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Computes the statistics of the guide. */
+        void prepare (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Transfers precomputed statistics of the guide to the device. */
+        void writeStatistics (const cl_float *mean, const cl_float *var, bool block = CL_FALSE, 
+                              const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Transfers the statistics of the guide to the host. */
+        void readStatistics (cl_float *mean, cl_float *var, bool block = CL_TRUE, 
+                             const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Executes the necessary kernels. */
+        void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Gets the number of channels. */
+        unsigned int getChannels ();
+        /*! \brief Gets the radius of the filter window. */
+        int getRadius ();
+        /*! \brief Sets the radius of the filter window. */
+        void setRadius (int _radius);
+        /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+        float getEps ();
+        /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+        void setEps (float _eps);
+
+        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance image. */
+        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input planes. */
+        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer for the output planes. */
+        Counters counters;  /*!< Runtime counters of the instance. */
+
+    private:
+        /*! \brief Holds the state of a channel. */
+        struct Channel
+        {
+            std::unique_ptr<Math::Mult> mult_Ip;
+            std::unique_ptr<BoxFilterSAT> mean_p, corr_Ip;
+            cl::Kernel ab, q;
+            cl::Event corrIpEvent;
+            std::vector<cl::Event> waitListAB;
+        };
+
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<2> info;
+        cl::Context context;
+        MeteredQueue queue0;
+        BoxFilterSAT mean_I, corr_I, mean_a, mean_b;
+        Math::Mult mult_II;
+        cl::Kernel var;
+        cl::NDRange global;
+        Staging staging;
+        unsigned int width, height, bufferSize;
+        std::vector<Channel> channels;
+        int radius;
+        float eps, boxScaling;
+        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
+        cl::Buffer dBufferInI, dBufferMeanI, dBufferVarI, dBufferA, dBufferB;
+        std::vector<cl::Buffer> dBufferInP, dBufferOut;
+
+    public:
+        /*! \brief Computes the statistics of the guide.
+         *  \details This `prepare` instance is used for profiling.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double prepare (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime;
+
+            pTime = mean_I.run (timer, events);
+            pTime += mult_II.run (timer, events);
+            pTime += corr_I.run (timer);
+
+            queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.flush (); timer.wait ();
+            pTime += timer.duration ();
+
+            return pTime;
+        }
+
+        /*! \brief Executes the necessary kernels.
+         *  \details This `run` instance is used for profiling.
+         *  \note The execution is handled by separate command queues. The 
+         *        time measured is the flat **execution** time of all the kernels.
+         *  
+         *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+         *  \param[in] events a wait-list of events.
+         *  \return Τhe total execution time measured by the timer.
+         */
+        template <typename period>
+        double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+        {
+            double pTime = 0.0;
+
+            for (Channel &channel : channels)
+            {
+                pTime += channel.mult_Ip->run (timer, events);
+                pTime += channel.mean_p->run (timer, events);
+                pTime += channel.corr_Ip->run (timer);
+
+                queue0.enqueueNDRangeKernel (channel.ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                pTime += mean_a.run (timer);
+                pTime += mean_b.run (timer);
+
+                queue0.enqueueNDRangeKernel (channel.q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+            }
+
+            return pTime;
+        }
+
+    };
+
+
+    /*! \brief Enumerates the layouts of the `YUV 4:2:0` images handled by `GuidedFilterYUV`. */
+    enum class YUVLayout : uint8_t
+    {
+        NV12,  /*!< Identifies a Y plane followed by a plane with interleaved U, V samples. */
+        I420   /*!< Identifies a Y plane followed by a U plane and a V plane. */
+    };
+
+
+    /*! \brief Interface class for performing `Guided Image Filtering` on a `YUV 4:2:0` image.
+     *  \details The luma plane is converted to `float` on the device (`yuvLuma_Uchar2Float`), 
+     *           filtered by `GuidedFilter<GuidedFilterConfig::I_EQ_P>`, and converted back 
+     *           (`yuvLuma_Float2Uchar`). The chroma planes are passed through (`copyUchar4`). 
+     *           That is, an image is filtered with a single full-resolution filter, 
+     *           and without a conversion to `RGB`.
+     *  \details Optionally, the chroma planes are filtered too, at their own (half) resolution, 
+     *           by `GuidedFilter<GuidedFilterConfig::I_NEQ_P>`, with the luma plane, 
+     *           downsampled to the same resolution, as the guide.
+     *  \note The output has the same layout as the input.
+     *  \note The image dimensions have to be even, and the number of pixels a multiple of 16.
+     *  \note The class creates its own buffers. If you would like to provide 
+     *        your own buffers, call `get` to get references to the placeholders 
+     *        within the class and assign them to your buffers. You will have to 
+     *        do this strictly before the call to `init`. You can also call `get` 
+     *        (after the call to `init`) to get a reference to a buffer within 
+     *        the class and assign it to another kernel class instance further 
+     *        down in your task pipeline.
+     *  
+     *        The following input/output `OpenCL` memory objects are created by a `GuidedFilterYUV` instance:<br>
+     *        | Name  | Type | Placement | I/O | Use | Properties | Size |
+     *        |  ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+     *        | H_IN  | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$3/2*width*height*sizeof\ (cl\_uchar)\f$ |
+     *        | H_OUT | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$3/2*width*height*sizeof\ (cl\_uchar)\f$ |
+     *        | D_IN  | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$3/2*width*height*sizeof\ (cl\_uchar)\f$ |
+     *        | D_Y   | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$    width*height*sizeof\ (cl\_float)\f$ |
+     *        | D_OUT | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$3/2*width*height*sizeof\ (cl\_uchar)\f$ |
      */
-    template <>
-    class GuidedFilter<GuidedFilterConfig::I_NEQ_P>
+    class GuidedFilterYUV
     {
     public:
         /*! \brief Enumerates the memory objects handled by the class.
@@ -1698,33 +4306,36 @@ namespace GF
          */
         enum class Memory : uint8_t
         {
-            H_IN_I,    /*!< Input staging buffer for the guidance image. */
-            H_IN_P,    /*!< Input staging buffer for the input image. */
-            H_OUT,     /*!< Output staging buffer. */
-            D_IN_I,    /*!< Input buffer for the guidance image. */
-            D_IN_P,    /*!< Input buffer for the input image. */
-            D_OUT,     /*!< Output buffer. */
-            D_VAR_I,   /*!< Buffer of variance values for the guidance image. */
-            D_COV_IP,  /*!< Buffer of covariance values between the guidance and input images. */
-            D_A,       /*!< Buffer of \f$ a \f$ coefficients. */
-            D_B        /*!< Buffer of \f$ b \f$ coefficients. */
+            H_IN,   /*!< Input staging buffer. */
+            H_OUT,  /*!< Output staging buffer. */
+            D_IN,   /*!< Input buffer. */
+            D_Y,    /*!< Buffer for the filtered luma plane (type `float`, normalized to 1). */
+            D_OUT   /*!< Output buffer. */
         };
 
         /*! \brief Configures an OpenCL environment as specified by `_info`. */
-        GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+        GuidedFilterYUV (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
         /*! \brief Returns a reference to an internal memory object. */
-        cl::Memory& get (GuidedFilter::Memory mem);
+        cl::Memory& get (GuidedFilterYUV::Memory mem);
         /*! \brief Configures kernel execution parameters. */
         void init (unsigned int _width, unsigned int _height, int _radius, float _eps, 
-                   int _zero_out = 0, float _boxScaling = 1e-4f, Staging _staging = Staging::IO);
+                   YUVLayout _layout = YUVLayout::NV12, bool _filterChroma = false, 
+                   Staging _staging = Staging::IO);
         /*! \brief Performs a data transfer to a device buffer. */
-        void write (GuidedFilter::Memory mem = GuidedFilter::Memory::D_IN_I, void *ptr = nullptr, bool block = CL_FALSE, 
-                    const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        void write (GuidedFilterYUV::Memory mem = GuidedFilterYUV::Memory::D_IN, void *ptr = nullptr, 
+                    bool block = CL_FALSE, const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Performs a data transfer to a staging buffer. */
-        void* read (GuidedFilter::Memory mem = GuidedFilter::Memory::H_OUT, bool block = CL_TRUE, 
+        void* read (GuidedFilterYUV::Memory mem = GuidedFilterYUV::Memory::H_OUT, bool block = CL_TRUE, 
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
+        /*! \brief Records the kernels once, for `replay`. */
+        void capture ();
+        /*! \brief Executes the recorded kernels. */
+        void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Gets the filter window radius. */
         int getRadius ();
         /*! \brief Sets the filter window radius. */
@@ -1733,50 +4344,37 @@ namespace GF
         float getEps ();
         /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
         void setEps (float _eps);
-        /*! \brief Gets the scaling factor for the `BoxFilterSAT`. */
-        float getBoxScaling ();
-        /*! \brief Sets the scaling factor for the `BoxFilterSAT`. */
-        void setBoxScaling (float _boxScaling);
-        /*! \brief Gets the `zero_out` flag. */
-        int getZeroing ();
-        /*! \brief Sets the `zero_out` flag. */
-        void setZeroing (int _zero_out);
 
-        cl_float *hPtrInI;  /*!< Mapping of the input staging buffer for the guidance image. */
-        cl_float *hPtrInP;  /*!< Mapping of the input staging buffer for the input image. */
-        cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        cl_uchar *hPtrIn;  /*!< Mapping of the input staging buffer. */
+        cl_uchar *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<2> info;
         cl::Context context;
-        cl::CommandQueue queue0;
-        BoxFilterSAT mean_I, mean_p, corr_I, corr_Ip, mean_a, mean_b;
-        Math::Mult mult_II, mult_Ip;
-        cl::Kernel var, ab, q;
-        cl::NDRange global;
+        MeteredQueue queue0;
+        GuidedFilter<GuidedFilterConfig::I_EQ_P> gfY;
+        GuidedFilter<GuidedFilterConfig::I_NEQ_P> gfU, gfV;
+        cl::Kernel lumaIn, lumaOut, copy, chromaIn, chromaOut;
+        cl::NDRange globalLuma, offsetChroma, globalChroma, globalChroma2D;
         Staging staging;
-        unsigned int width, height, bufferSize;
+        YUVLayout layout;
+        bool filterChroma;
+        unsigned int width, height;
+        unsigned int bufferSize, bufferLumaSize, bufferChromaSize;
         int radius; float eps;
-        int zero_out;
-        float boxScaling;
-        cl::Buffer hBufferInI, hBufferInP, hBufferOut;
-        cl::Buffer dBufferInI, dBufferInP, dBufferOut;
-        cl::Buffer dBufferOutVarI, dBufferOutCovIp;
-        cl::Buffer dBufferOutA, dBufferOutB;
-        cl::Event corrIpEvent, abEvent, mbEvent;
-        std::vector<cl::Event> waitListVar, waitListMB, waitListQ;
+        cl::Buffer hBufferIn, hBufferOut;
+        cl::Buffer dBufferIn, dBufferY, dBufferOut;
+        cl::Event lEvent, cEvent; std::vector<cl::Event> waitListL, waitListC;
+        CommandGraph graph;
+
+        /*! \brief Returns the radius of the chroma pipeline. */
+        int chromaRadius (int _radius);
 
     public:
         /*! \brief Executes the necessary kernels.
          *  \details This `run` instance is used for profiling.
-         *  \note The execution is handled by two separate command queues. The 
-         *        time measured is the flat **execution** time of all the kernels. 
-         *        There is overlap in the execution of the kernels, but there are 
-         *        also gaps between them. As a compromise, and in order to simplify 
-         *        things, the execution times of all the kernels are simply added 
-         *        together. Look at the `Timeline Trace` of `CodeXL` 
-         *        for a more detailed view.
          *  
          *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
          *  \param[in] events a wait-list of events.
@@ -1787,25 +4385,29 @@ namespace GF
         {
             double pTime;
 
-            pTime = mean_I.run (timer, events);
-            pTime += mean_p.run (timer, events);
-            pTime += mult_II.run (timer, events);
-            pTime += mult_Ip.run (timer, events);
-            pTime += corr_I.run (timer);
-            pTime += corr_Ip.run (timer);
-            
-            queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            queue0.enqueueNDRangeKernel (lumaIn, cl::NullRange, globalLuma, cl::NullRange, events, &timer.event ());
             queue0.flush (); timer.wait ();
-            pTime += timer.duration ();
+            pTime = timer.duration ();
 
-            queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            pTime += gfY.run (timer);
+
+            queue0.enqueueNDRangeKernel (lumaOut, cl::NullRange, globalLuma, cl::NullRange, nullptr, &timer.event ());
             queue0.flush (); timer.wait ();
             pTime += timer.duration ();
 
-            pTime += mean_a.run (timer);
-            pTime += mean_b.run (timer);
-            
-            queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+            if (filterChroma)
+            {
+                queue0.enqueueNDRangeKernel (chromaIn, cl::NullRange, globalChroma2D, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                pTime += gfU.run (timer);
+                pTime += gfV.run (timer);
+
+                queue0.enqueueNDRangeKernel (chromaOut, cl::NullRange, globalChroma2D, cl::NullRange, nullptr, &timer.event ());
+            }
+            else
+                queue0.enqueueNDRangeKernel (copy, offsetChroma, globalChroma, cl::NullRange, nullptr, &timer.event ());
             queue0.flush (); timer.wait ();
             pTime += timer.duration ();
 
@@ -1826,8 +4428,10 @@ namespace GF
         {
             INTERLEAVED_FLOAT,  /*!< Identifies the case where the output channels 
                                  *   are mixed together in an RGB image of type `float`. */
-            SEPARATED           /*!< Identifies the case where the output channels 
+            SEPARATED,          /*!< Identifies the case where the output channels 
                                  *   are left separated in independent images. */
+            INTERLEAVED_USHORT  /*!< Identifies the case of a `ushort` input image, where the output 
+                                 *   channels are mixed together in an RGB image of type `ushort`. */
         };
 
 
@@ -1906,6 +4510,17 @@ namespace GF
                         const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
             /*! \brief Executes the necessary kernels. */
             void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Records the kernels in a `CommandGraph`. */
+            void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                         CommandGraph::Node *node = nullptr);
+            /*! \brief Records the kernels once, for `replay`. */
+            void capture ();
+            /*! \brief Executes the recorded kernels. */
+            void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Submits a frame, and calls `callback` when the output is ready. */
+            void submit (const void *ptr, AsyncWindow::Callback callback);
+            /*! \brief Submits a frame, and returns a future that's ready when the output is in `out`. */
+            std::future<void> submit (const void *ptr, void *out);
             /*! \brief Gets the filter window radius. */
             int getRadius ();
             /*! \brief Sets the filter window radius. */
@@ -1919,12 +4534,14 @@ namespace GF
             cl_float *hPtrOutR;  /*!< Mapping of the output staging buffer for the R channel. */
             cl_float *hPtrOutG;  /*!< Mapping of the output staging buffer for the G channel. */
             cl_float *hPtrOutB;  /*!< Mapping of the output staging buffer for the B channel. */
+            AsyncWindow async;  /*!< Window of the submissions made with `submit`. */
+            Counters counters;  /*!< Runtime counters of the instance. */
 
         private:
             clutils::CLEnv &env;
             clutils::CLEnvInfo<2> info;
             cl::Context context;
-            cl::CommandQueue queue0;
+            MeteredQueue queue0;
             SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT> sRGB;
             GuidedFilter<GuidedFilterConfig::I_EQ_P> gfR, gfG, gfB;
             Staging staging;
@@ -1934,6 +4551,7 @@ namespace GF
             cl::Buffer hBufferIn, hBufferOutR, hBufferOutG, hBufferOutB;
             cl::Buffer dBufferIn, dBufferOutR, dBufferOutG, dBufferOutB;
             cl::Event sEvent; std::vector<cl::Event> waitList;
+            CommandGraph graph;
 
         public:
             /*! \brief Executes the necessary kernels.
@@ -2015,6 +4633,17 @@ namespace GF
                         const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
             /*! \brief Executes the necessary kernels. */
             void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Records the kernels in a `CommandGraph`. */
+            void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                         CommandGraph::Node *node = nullptr);
+            /*! \brief Records the kernels once, for `replay`. */
+            void capture ();
+            /*! \brief Executes the recorded kernels. */
+            void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Submits a frame, and calls `callback` when the output is ready. */
+            void submit (const void *ptr, AsyncWindow::Callback callback);
+            /*! \brief Submits a frame, and returns a future that's ready when the output is in `out`. */
+            std::future<void> submit (const void *ptr, void *out);
             /*! \brief Gets the filter window radius. */
             int getRadius ();
             /*! \brief Sets the filter window radius. */
@@ -2026,12 +4655,14 @@ namespace GF
 
             cl_uchar *hPtrIn;  /*!< Mapping of the input staging buffer. */
             cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+            AsyncWindow async;  /*!< Window of the submissions made with `submit`. */
+            Counters counters;  /*!< Runtime counters of the instance. */
 
         private:
             clutils::CLEnv &env;
             clutils::CLEnvInfo<2> info;
             cl::Context context;
-            cl::CommandQueue queue0;
+            MeteredQueue queue0;
             SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT> sRGB;
             GuidedFilter<GuidedFilterConfig::I_EQ_P> gfR, gfG, gfB;
             CombineRGB<CombineRGBConfig::FLOAT_FLOAT> cRGB;
@@ -2042,6 +4673,7 @@ namespace GF
             cl::Buffer hBufferIn, hBufferOut;
             cl::Buffer dBufferIn, dBufferOut;
             cl::Event sEvent; std::vector<cl::Event> waitList;
+            CommandGraph graph;
 
         public:
             /*! \brief Executes the necessary kernels.
@@ -2068,6 +4700,152 @@ namespace GF
         };
 
 
+        /*! \brief Interface class for performing `Guided Image Filtering` 
+         *         on an `RGB` image from `%Kinect`.
+         *  \details This instantiation covers the case of a 16-bit RGB image, where the processed 
+         *           channels are finally mixed together in an RGB image of type `ushort`.
+         *           The conversions happen on the device, so the data need no host-side passes.
+         *  \details The `float` SAT moments of the other classes aren't accurate to the LSB 
+         *           of 16-bit data. Instead, the box sums are computed in two 
+         *           separable passes in integers, so the moments are exact. The variance numerator, 
+         *           \f$ n S_2 - S_1^2 \f$, is exact in 64 bits, and the \f$ a, b \f$ coefficients 
+         *           are averaged in fixed point (\f$ 2^{24} \f$ as one). Before the final rounding, 
+         *           the output is within ~0.1 LSB of the exact guided filter, so the `ushort` 
+         *           output is off by at most 1 LSB. The work per pixel is `O(radius)`.
+         *  \note The radius can be at most `127` (`maxRadius`), so that the sums fit in 64 bits.
+         *  \note The class creates its own buffers. If you would like to provide 
+         *        your own buffers, call `get` to get references to the placeholders 
+         *        within the class and assign them to your buffers. You will have to 
+         *        do this strictly before the call to `init`. You can also call `get` 
+         *        (after the call to `init`) to get a reference to a buffer within 
+         *        the class and assign it to another kernel class instance further 
+         *        down in your task pipeline.
+         *  
+         *        The following input/output `OpenCL` memory objects are created by 
+         *        a `GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>` instance:<br>
+         *        | Name  | Type | Placement | I/O | Use | Properties | Size |
+         *        |  ---  |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+         *        | H_IN  | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+         *        | H_OUT | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+         *        | D_IN  | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+         *        | D_OUT | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$3*width*height*sizeof\ (cl\_ushort)\f$ |
+         */
+        template <>
+        class GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>
+        {
+        public:
+            /*! \brief Enumerates the memory objects handled by the class.
+             *  \note `H_*` names refer to staging buffers on the host.
+             *  \note `D_*` names refer to buffers on the device.
+             */
+            enum class Memory : uint8_t
+            {
+                H_IN,    /*!< Input staging buffer. */
+                H_OUT,   /*!< Output staging buffer. */
+                D_IN,    /*!< Input buffer. */
+                D_SUM,   /*!< Buffer of row sums of the values, and then of the \f$ a \f$ coefficients. */
+                D_SUM2,  /*!< Buffer of row sums of the squared values, and then of the \f$ b \f$ coefficients. */
+                D_A,     /*!< Buffer of fixed point \f$ a \f$ coefficients. */
+                D_B,     /*!< Buffer of fixed point \f$ b \f$ coefficients. */
+                D_OUT    /*!< Output buffer. */
+            };
+
+            /*! \brief Configures an OpenCL environment as specified by `_info`. */
+            GuidedFilterRGB (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+            /*! \brief Returns a reference to an internal memory object. */
+            cl::Memory& get (GuidedFilterRGB::Memory mem);
+            /*! \brief Configures kernel execution parameters. */
+            void init (unsigned int _width, unsigned int _height, 
+                       int _radius, float _eps, Staging _staging = Staging::IO);
+            /*! \brief Performs a data transfer to a device buffer. */
+            void write (GuidedFilterRGB::Memory mem = GuidedFilterRGB::Memory::D_IN, void *ptr = nullptr, 
+                        bool block = CL_FALSE, const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Performs a data transfer to a staging buffer. */
+            void* read (GuidedFilterRGB::Memory mem = GuidedFilterRGB::Memory::H_OUT, bool block = CL_TRUE, 
+                        const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Executes the necessary kernels. */
+            void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Records the kernels in a `CommandGraph`. */
+            void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                         CommandGraph::Node *node = nullptr);
+            /*! \brief Records the kernels once, for `replay`. */
+            void capture ();
+            /*! \brief Executes the recorded kernels. */
+            void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Submits a frame, and calls `callback` when the output is ready. */
+            void submit (const void *ptr, AsyncWindow::Callback callback);
+            /*! \brief Submits a frame, and returns a future that's ready when the output is in `out`. */
+            std::future<void> submit (const void *ptr, void *out);
+            /*! \brief Gets the filter window radius. */
+            int getRadius ();
+            /*! \brief Sets the filter window radius. */
+            void setRadius (int _radius);
+            /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+            float getEps ();
+            /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+            void setEps (float _eps);
+
+            static const int maxRadius = 127;  /*!< Largest radius for which the sums are exact. */
+
+            cl_ushort *hPtrIn;  /*!< Mapping of the input staging buffer. */
+            cl_ushort *hPtrOut;  /*!< Mapping of the output staging buffer. */
+            AsyncWindow async;  /*!< Window of the submissions made with `submit`. */
+            Counters counters;  /*!< Runtime counters of the instance. */
+
+        private:
+            clutils::CLEnv &env;
+            clutils::CLEnvInfo<2> info;
+            cl::Context context;
+            MeteredQueue queue0;
+            cl::Kernel rowSums, ab, rowSumsAB, q;
+            cl::NDRange global;
+            Staging staging;
+            unsigned int width, height;
+            unsigned int bufferInSize, bufferOutSize;
+            int radius; float eps;
+            cl::Buffer hBufferIn, hBufferOut;
+            cl::Buffer dBufferIn, dBufferOut;
+            cl::Buffer dBufferSum, dBufferSum2, dBufferA, dBufferB;
+            CommandGraph graph;
+
+            /*! \brief Checks that the radius is within `maxRadius`. */
+            void checkRadius (int _radius);
+
+        public:
+            /*! \brief Executes the necessary kernels.
+             *  \details This `run` instance is used for profiling.
+             *  
+             *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+             *  \param[in] events a wait-list of events.
+             *  \return Τhe total execution time measured by the timer.
+             */
+            template <typename period>
+            double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+            {
+                double pTime;
+
+                queue0.enqueueNDRangeKernel (rowSums, cl::NullRange, global, cl::NullRange, events, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime = timer.duration ();
+
+                queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                queue0.enqueueNDRangeKernel (rowSumsAB, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                return pTime;
+            }
+
+        };
+
+
         /*! \brief Interface class for performing `Guided Image Filtering` 
          *         on a `%Depth` image from `%Kinect`.
          *  \note The value \f$ 0.000001\ (10^{-6}) \f$ is used for scaling in `BoxFilterSAT`.
@@ -2118,6 +4896,17 @@ namespace GF
                         const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
             /*! \brief Executes the necessary kernels. */
             void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Records the kernels in a `CommandGraph`. */
+            void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                         CommandGraph::Node *node = nullptr);
+            /*! \brief Records the kernels once, for `replay`. */
+            void capture ();
+            /*! \brief Executes the recorded kernels. */
+            void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Submits a frame, and calls `callback` when the output is ready. */
+            void submit (const void *ptr, AsyncWindow::Callback callback);
+            /*! \brief Submits a frame, and returns a future that's ready when the output is in `out`. */
+            std::future<void> submit (const void *ptr, void *out);
             /*! \brief Gets the filter window radius. */
             int getRadius ();
             /*! \brief Sets the filter window radius. */
@@ -2133,12 +4922,14 @@ namespace GF
 
             cl_ushort *hPtrIn;  /*!< Mapping of the input staging buffer. */
             cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+            AsyncWindow async;  /*!< Window of the submissions made with `submit`. */
+            Counters counters;  /*!< Runtime counters of the instance. */
 
         private:
             clutils::CLEnv &env;
             clutils::CLEnvInfo<2> info;
             cl::Context context;
-            cl::CommandQueue queue0;
+            MeteredQueue queue0;
             Depth<DepthConfig::USHORT_FLOAT> depth;
             GuidedFilter<GuidedFilterConfig::I_EQ_P> gf;
             Staging staging;
@@ -2148,6 +4939,7 @@ namespace GF
             cl::Buffer hBufferIn, hBufferOut;
             cl::Buffer dBufferIn, dBufferOut;
             cl::Event dEvent; std::vector<cl::Event> waitList;
+            CommandGraph graph;
 
         public:
             /*! \brief Executes the necessary kernels.
@@ -2170,6 +4962,152 @@ namespace GF
 
         };
 
+
+        /*! \brief Interface class for performing `Guided Image Filtering` on a `%Depth` 
+         *         image from `%Kinect`, guided by the corresponding `RGB` image.
+         *  \details `GuidedFilterDepth` uses the depth image as its own guide, so 
+         *           the filtered depth edges don't follow the color edges. Here, the 
+         *           `RGB` image is separated into its channels, and their luminance, 
+         *           \f$ 0.299R + 0.587G + 0.114B \f$, is used as the guide \f$ I \f$ 
+         *           for the depth image \f$ p \f$ in `GuidedFilter<GuidedFilterConfig::I_NEQ_P>`.
+         *           The pixels that are zero (invalid) in the depth image are zeroed 
+         *           out in the output, and the output is scaled back to the units of the input.
+         *  \note The `RGB` and depth images should be registered (the same pixel 
+         *        refers to the same point in both images).
+         *  \note The value \f$ 0.000001\ (10^{-6}) \f$ is used for scaling in `BoxFilterSAT`.
+         *  \note The output, `D_OUT`, can be shared with `DepthTo3D::Memory::D_IN`, or, 
+         *        along with the color channels, `D_OUT_{R,G,B}`, with the `D_IN_*` buffers 
+         *        of `RGBDTo8D`, so that the point cloud is built without leaving the device.
+         *  \note The class creates its own buffers. If you would like to provide 
+         *        your own buffers, call `get` to get references to the placeholders 
+         *        within the class and assign them to your buffers. You will have to 
+         *        do this strictly before the call to `init`. You can also call `get` 
+         *        (after the call to `init`) to get a reference to a buffer within 
+         *        the class and assign it to another kernel class instance further 
+         *        down in your task pipeline.
+         *  
+         *        The following input/output `OpenCL` memory objects are created by a `GuidedFilterRGBD` instance:<br>
+         *        |   Name   | Type | Placement | I/O | Use | Properties | Size |
+         *        |   ---    |:---: |   :---:   |:---:|:---:|   :---:    |:---: |
+         *        | H_IN_RGB | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$3*width*height*sizeof\ (cl\_uchar)\f$ |
+         *        | H_IN_D   | Buffer | Host   | I | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_ushort)\f$ |
+         *        | H_OUT    | Buffer | Host   | O | Staging     | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+         *        | D_IN_RGB | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$3*width*height*sizeof\ (cl\_uchar)\f$ |
+         *        | D_IN_D   | Buffer | Device | I | Processing  | CL_MEM_READ_ONLY  | \f$  width*height*sizeof\ (cl\_ushort)\f$ |
+         *        | D_OUT_R  | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+         *        | D_OUT_G  | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+         *        | D_OUT_B  | Buffer | Device | O | Processing  | CL_MEM_READ_WRITE | \f$  width*height*sizeof\ (cl\_float)\f$ |
+         *        | D_OUT    | Buffer | Device | O | Processing  | CL_MEM_WRITE_ONLY | \f$  width*height*sizeof\ (cl\_float)\f$ |
+         */
+        class GuidedFilterRGBD
+        {
+        public:
+            /*! \brief Enumerates the memory objects handled by the class.
+             *  \note `H_*` names refer to staging buffers on the host.
+             *  \note `D_*` names refer to buffers on the device.
+             */
+            enum class Memory : uint8_t
+            {
+                H_IN_RGB,  /*!< Input staging buffer for the RGB image. */
+                H_IN_D,    /*!< Input staging buffer for the depth image. */
+                H_OUT,     /*!< Output staging buffer. */
+                D_IN_RGB,  /*!< Input buffer for the RGB image. */
+                D_IN_D,    /*!< Input buffer for the depth image. */
+                D_OUT_R,   /*!< Buffer for channel R of the RGB image (normalized to 1). */
+                D_OUT_G,   /*!< Buffer for channel G of the RGB image (normalized to 1). */
+                D_OUT_B,   /*!< Buffer for channel B of the RGB image (normalized to 1). */
+                D_GUIDE,   /*!< Buffer for the guidance (luminance) image. */
+                D_OUT      /*!< Output buffer. */
+            };
+
+            /*! \brief Configures an OpenCL environment as specified by `_info`. */
+            GuidedFilterRGBD (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info);
+            /*! \brief Returns a reference to an internal memory object. */
+            cl::Memory& get (GuidedFilterRGBD::Memory mem);
+            /*! \brief Configures kernel execution parameters. */
+            void init (unsigned int _width, unsigned int _height, 
+                       int _radius, float _eps, float _dScaling = 1e-3f, Staging _staging = Staging::IO);
+            /*! \brief Performs a data transfer to a device buffer. */
+            void write (GuidedFilterRGBD::Memory mem = GuidedFilterRGBD::Memory::D_IN_D, 
+                        void *ptr = nullptr, bool block = CL_FALSE, 
+                        const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Performs a data transfer to a staging buffer. */
+            void* read (GuidedFilterRGBD::Memory mem = GuidedFilterRGBD::Memory::H_OUT, bool block = CL_TRUE, 
+                        const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Executes the necessary kernels. */
+            void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Records the kernels in a `CommandGraph`. */
+            void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                         CommandGraph::Node *node = nullptr);
+            /*! \brief Records the kernels once, for `replay`. */
+            void capture ();
+            /*! \brief Executes the recorded kernels. */
+            void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+            /*! \brief Gets the filter window radius. */
+            int getRadius ();
+            /*! \brief Sets the filter window radius. */
+            void setRadius (int _radius);
+            /*! \brief Gets the regularization parameter \f$\epsilon\f$. */
+            float getEps ();
+            /*! \brief Sets the regularization parameter \f$\epsilon\f$. */
+            void setEps (float _eps);
+            /*! \brief Gets the depth scaling factor. */
+            float getDScaling ();
+            /*! \brief Sets the depth scaling factor. */
+            void setDScaling (float _dScaling);
+
+            cl_uchar *hPtrInRGB;  /*!< Mapping of the input staging buffer for the RGB image. */
+            cl_ushort *hPtrInD;  /*!< Mapping of the input staging buffer for the depth image. */
+            cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+            Counters counters;  /*!< Runtime counters of the instance. */
+
+        private:
+            clutils::CLEnv &env;
+            clutils::CLEnvInfo<2> info;
+            cl::Context context;
+            MeteredQueue queue0;
+            SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT> sRGB;
+            Depth<DepthConfig::USHORT_FLOAT> depth;
+            GuidedFilter<GuidedFilterConfig::I_NEQ_P> gf;
+            cl::Kernel gray, mask;
+            cl::NDRange global;
+            Staging staging;
+            unsigned int width, height;
+            unsigned int bufferInRGBSize, bufferInDSize, bufferOutSize;
+            int radius; float eps; float dScaling;
+            cl::Buffer hBufferInRGB, hBufferInD, hBufferOut;
+            cl::Buffer dBufferInRGB, dBufferInD, dBufferGuide, dBufferOut;
+            cl::Event gEvent; std::vector<cl::Event> waitList;
+            CommandGraph graph;
+
+        public:
+            /*! \brief Executes the necessary kernels.
+             *  \details This `run` instance is used for profiling.
+             *  
+             *  \param[in] timer `GPUTimer` that does the profiling of the kernel executions.
+             *  \param[in] events a wait-list of events.
+             *  \return Τhe total execution time measured by the timer.
+             */
+            template <typename period>
+            double run (clutils::GPUTimer<period> &timer, const std::vector<cl::Event> *events = nullptr)
+            {
+                double pTime;
+
+                pTime = sRGB.run (timer, events);
+                queue0.enqueueNDRangeKernel (gray, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+                pTime += depth.run (timer, events);
+                pTime += gf.run (timer);
+                queue0.enqueueNDRangeKernel (mask, cl::NullRange, global, cl::NullRange, nullptr, &timer.event ());
+                queue0.flush (); timer.wait ();
+                pTime += timer.duration ();
+
+                return pTime;
+            }
+
+        };
+
     }
 
 }
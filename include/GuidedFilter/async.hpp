@@ -0,0 +1,126 @@
+/*! \file async.hpp
+ *  \brief Declares a class that manages a bounded window of
+ *         asynchronous submissions to a filter.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_ASYNC_HPP
+#define GF_ASYNC_HPP
+
+#include <vector>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <CLUtils.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief Manages a bounded window of asynchronous submissions to a filter.
+     *  \details The classes that offer `submit` own an `AsyncWindow`. Every submission
+     *           gets a slot with its own pinned input and output staging buffers, which
+     *           stay mapped for the lifetime of the slot. The class transfers the input
+     *           from the slot, executes its kernels, and reads the output into the slot,
+     *           all non-blocking. The completion of the read is reported through an
+     *           event callback (`clSetEventCallback`), so the host thread never waits
+     *           on the device, unless all the slots are in flight.
+     *  \note A submission waits for the previous one on the same filter, since they
+     *        share the device buffers. Submissions to different filter instances
+     *        (on different command queues) overlap on the device.
+     *  \note The callbacks are invoked on a thread of the OpenCL runtime. They should
+     *        return quickly, and they must not call blocking OpenCL functions.
+     */
+    class AsyncWindow
+    {
+    public:
+        /*! \brief Called when a submission completes.
+         *  \details The argument is the mapping of the output staging buffer of the
+         *           slot, which is valid until the callback returns. It is `nullptr`,
+         *           if any of the commands of the submission failed.
+         */
+        typedef std::function<void (void *out)> Callback;
+
+        /*! \brief Holds the staging buffers of a submission. */
+        struct Slot
+        {
+            cl::Buffer hBufferIn, hBufferOut;
+            void *hPtrIn;   /*!< Mapping of the input staging buffer. */
+            void *hPtrOut;  /*!< Mapping of the output staging buffer. */
+            cl::Event event;
+            Callback callback;
+            AsyncWindow *owner;
+            bool busy;
+        };
+
+        AsyncWindow (unsigned int _window = 2);
+        /*! \brief Copies are empty windows (the slots refer to the buffers of the original owner). */
+        AsyncWindow (const AsyncWindow &other);
+        AsyncWindow& operator= (const AsyncWindow &other);
+        ~AsyncWindow ();
+        /*! \brief Gets the maximum number of submissions in flight. */
+        unsigned int getWindow ();
+        /*! \brief Sets the maximum number of submissions in flight. */
+        void setWindow (unsigned int _window);
+        /*! \brief Returns the next slot, blocking while all the slots are in flight. */
+        Slot& acquire (cl::CommandQueue &queue, size_t inSize, size_t outSize);
+        /*! \brief Returns a wait-list with the event of the last submission. */
+        const std::vector<cl::Event>* previous ();
+        /*! \brief Hands a slot, whose commands have been enqueued, to the OpenCL runtime. */
+        void commit (Slot &slot, Callback callback);
+        /*! \brief Blocks until all the submissions have completed. */
+        void drain ();
+        /*! \brief Returns the number of submissions in flight. */
+        unsigned int pending ();
+        /*! \brief Returns a callback that copies the output to `out`, and fulfills `future`. */
+        static Callback deliver (void *out, size_t size, std::future<void> &future);
+
+    private:
+        unsigned int window;
+        std::vector<Slot> slots;
+        size_t next;
+        size_t inSize, outSize;
+        cl::CommandQueue queue;
+        std::vector<cl::Event> waitList;
+        unsigned int nPending;
+        std::mutex mtx;
+        std::condition_variable cv;
+
+        /*! \brief Creates the slots. */
+        void allocate (cl::CommandQueue &_queue, size_t _inSize, size_t _outSize);
+        /*! \brief Releases the slots. */
+        void release ();
+        /*! \brief Invoked by the OpenCL runtime when the last command of a submission completes. */
+        static void CL_CALLBACK complete (cl_event event, cl_int status, void *data);
+    };
+
+}
+}
+
+#endif  // GF_ASYNC_HPP
@@ -0,0 +1,191 @@
+/*! \file cache.hpp
+ *  \brief Declares a persistent cache of the guide statistics of the `Guided Filter`.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_CACHE_HPP
+#define GF_CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief Enumerates the eviction policies of a `GuideCache`. */
+    enum class GuideCacheEviction : uint8_t
+    {
+        LRU,   /*!< Evicts the least recently used entries. */
+        FIFO,  /*!< Evicts the oldest entries. */
+        NONE   /*!< Doesn't evict. New entries are rejected when the cache is full. */
+    };
+
+
+    /*! \brief A cache of the guide statistics, shared by processes through the file system.
+     *  \details Every entry holds the statistics that `GuidedFilterShared::prepare` computes 
+     *           for a guide, \f$ \bar{I} \f$ and \f$ \sigma_I^2+\epsilon \f$, in a file of 
+     *           the cache directory. The entries are keyed by a hash of the contents of the 
+     *           guide, its dimensions, the radius, and \f$ \epsilon \f$. A hit maps the file 
+     *           (read-only), and the statistics are transferred to the device from the mapping, 
+     *           so a guide that has been seen before, by any process, skips the `BoxFilterSAT` 
+     *           stages of the guide entirely (look at `prepareGuide`).
+     *  \details An entry is written to a temporary file, and renamed into place, so other 
+     *           processes never see partial entries. After a store, entries are evicted 
+     *           until the total size of the entries is within `maxBytes`. With `LRU`, 
+     *           a hit updates the modification time of the entry, which the eviction 
+     *           goes by. An evicted entry stays valid for the processes that have it mapped.
+     *           Temporary files left over by stores that didn't finish are removed 
+     *           once they are 10 minutes old, whenever the cache lists its entries.
+     *  \note The cache doesn't depend on OpenCL. It's available on Unix.
+     *  \note The cache is only as trustworthy as its directory. Entries that are truncated, 
+     *        or that don't match their key, are treated as misses.
+     */
+    class GuideCache
+    {
+    public:
+        /*! \brief Identifies a guide and the parameters of its statistics. */
+        struct Key
+        {
+            uint64_t hash;    /*!< Hash of the contents of the guide. */
+            uint32_t width;   /*!< Width of the guide. */
+            uint32_t height;  /*!< Height of the guide. */
+            int32_t radius;   /*!< Radius of the filter window. */
+            float eps;        /*!< Regularization parameter. */
+        };
+
+        /*! \brief A mapping of the statistics of a cached guide. */
+        class Entry
+        {
+        public:
+            Entry ();
+            ~Entry ();
+            Entry (Entry &&other);
+            Entry& operator= (Entry &&other);
+            Entry (const Entry&) = delete;
+            Entry& operator= (const Entry&) = delete;
+            /*! \brief Returns the average \f$ I \f$ values, \f$ \bar{I} \f$. */
+            const float* mean () const;
+            /*! \brief Returns the regularized variance of the guide, \f$ \sigma_I^2+\epsilon \f$. */
+            const float* var () const;
+
+        private:
+            void *ptr;
+            size_t size, n;
+
+            friend class GuideCache;
+        };
+
+        /*! \brief Opens (or creates) the cache in `_directory`. */
+        GuideCache (const std::string &_directory, size_t _maxBytes = 512 << 20, 
+                    GuideCacheEviction _eviction = GuideCacheEviction::LRU);
+        /*! \brief Returns the key of a guide. */
+        static Key key (const float *guide, unsigned int width, unsigned int height, int radius, float eps);
+        /*! \brief Looks up the statistics of a guide. */
+        bool lookup (const Key &key, Entry &entry);
+        /*! \brief Stores the statistics of a guide. */
+        bool store (const Key &key, const float *mean, const float *var);
+        /*! \brief Evicts entries until the cache is within `maxBytes`. */
+        void evict ();
+        /*! \brief Removes all the entries. */
+        void clear ();
+        /*! \brief Returns the total size of the entries in bytes. */
+        size_t size ();
+        /*! \brief Returns the number of entries. */
+        size_t entries ();
+        /*! \brief Gets the size limit in bytes. */
+        size_t getMaxBytes ();
+        /*! \brief Sets the size limit in bytes. */
+        void setMaxBytes (size_t _maxBytes);
+        /*! \brief Gets the eviction policy. */
+        GuideCacheEviction getEviction ();
+        /*! \brief Sets the eviction policy. */
+        void setEviction (GuideCacheEviction _eviction);
+
+    private:
+        /*! \brief Describes an entry file. */
+        struct File
+        {
+            std::string path;
+            size_t size;
+            int64_t time;
+        };
+
+        /*! \brief Returns the path of the entry of a key. */
+        std::string path (const Key &key);
+        /*! \brief Lists the entry files, oldest first. */
+        std::vector<File> list ();
+        /*! \brief Evicts entries, except for `keep`, until the cache is within `maxBytes`. */
+        void trim (const std::string &keep);
+
+        std::string directory;
+        size_t maxBytes;
+        GuideCacheEviction eviction;
+    };
+
+
+    /*! \brief Computes the guide statistics of a filter, or fetches them from a cache.
+     *  \details On a hit, the statistics are transferred from the cache to `D_MEAN_I` 
+     *           and `D_VAR_I`. On a miss, they are computed by `prepare`, read back, and stored. 
+     *           Either way, the filter is ready to `run` when the function returns.
+     *  \note `Filter` is a `GuidedFilterShared`. The guide has to be written to `D_IN_I` 
+     *        beforehand (`run` needs it anyway), and `guide` has to hold the same data.
+     *  
+     *  \param[in] gf filter whose guide statistics to prepare.
+     *  \param[in] cache cache of guide statistics.
+     *  \param[in] guide guidance image on the host.
+     *  \param[in] width width of the guidance image.
+     *  \param[in] height height of the guidance image.
+     *  \return Whether the statistics were found in the cache.
+     */
+    template <typename Filter>
+    bool prepareGuide (Filter &gf, GuideCache &cache, const float *guide, unsigned int width, unsigned int height)
+    {
+        GuideCache::Key key = GuideCache::key (guide, width, height, gf.getRadius (), gf.getEps ());
+
+        GuideCache::Entry entry;
+        if (cache.lookup (key, entry))
+        {
+            gf.writeStatistics (entry.mean (), entry.var (), true);
+            return true;
+        }
+
+        std::vector<float> mean (width * height), var (width * height);
+        gf.prepare ();
+        gf.readStatistics (mean.data (), var.data (), true);
+        cache.store (key, mean.data (), var.data ());
+
+        return false;
+    }
+
+}
+}
+
+#endif  // GF_CACHE_HPP
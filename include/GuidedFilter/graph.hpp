@@ -0,0 +1,122 @@
+/*! \file graph.hpp
+ *  \brief Declares a class that records a sequence of kernel executions 
+ *         once, and replays it many times.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_GRAPH_HPP
+#define GF_GRAPH_HPP
+
+#include <vector>
+#include <CLUtils.hpp>
+
+
+/*! \brief Offers classes which set up kernel execution parameters and 
+ *         provide interfaces for the handling of memory objects.
+ */
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief Records a sequence of kernel executions once, and replays it many times.
+     *  \details The classes record their kernels with `record`, which mirrors `run`, 
+     *           but takes node handles instead of events. Every node is a kernel 
+     *           execution on a command queue. Nodes on the same command queue are 
+     *           ordered by recording order, and nodes on different command queues 
+     *           are ordered by the dependencies given at recording.
+     *  \note After `finalize`, the graph is replayed in one of two ways. If the device 
+     *        supports `cl_khr_command_buffer` (and the OpenCL headers declare it), the 
+     *        nodes are recorded in a command-buffer, and a replay is a single 
+     *        `clEnqueueCommandBufferKHR` call. Otherwise, a replay goes through a 
+     *        pre-built list of `clEnqueueNDRangeKernel` calls, with precomputed 
+     *        wait-lists, and events only for the nodes that other command queues 
+     *        depend on.
+     *  \note A command-buffer captures the kernel arguments at recording. Record the 
+     *        graph again after changing any kernel argument (the classes that own 
+     *        a graph do this by themselves).
+     */
+    class CommandGraph
+    {
+    public:
+        /*! \brief Handle of a recorded kernel execution. */
+        typedef size_t Node;
+
+        CommandGraph ();
+        /*! \brief Copies are empty graphs (the nodes refer to the kernels of the original owner). */
+        CommandGraph (const CommandGraph &other);
+        CommandGraph& operator= (const CommandGraph &other);
+        ~CommandGraph ();
+        /*! \brief Records a kernel execution. */
+        void add (cl::CommandQueue &queue, cl::Kernel &kernel, 
+                  const cl::NDRange &offset, const cl::NDRange &global, const cl::NDRange &local, 
+                  const std::vector<Node> *deps = nullptr, Node *node = nullptr);
+        /*! \brief Prepares the graph for replay. */
+        void finalize ();
+        /*! \brief Replays the graph. */
+        void replay (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Removes all the nodes. */
+        void clear ();
+        /*! \brief Returns whether the graph has no nodes. */
+        bool empty ();
+        /*! \brief Returns the number of nodes. */
+        size_t size ();
+        /*! \brief Returns whether the graph replays through a `cl_khr_command_buffer`. */
+        bool isNative ();
+
+    private:
+        /*! \brief Holds a recorded kernel execution. */
+        struct Command
+        {
+            cl::CommandQueue queue;
+            cl::Kernel kernel;
+            cl_uint dims;
+            size_t offset[3], global[3], local[3];
+            bool hasOffset, hasLocal;
+            std::vector<Node> deps;
+            bool first;   // First node on its command queue
+            bool signal;  // Other command queues depend on it
+            std::vector<Node> waitNodes;
+            std::vector<cl_event> waitList;
+        };
+
+        struct Native;
+
+        std::vector<Command> commands;
+        std::vector<cl_event> events;
+        bool finalized;
+        Native *native;
+
+        /*! \brief Records the graph in a `cl_khr_command_buffer`. */
+        bool buildNative ();
+        /*! \brief Releases the `cl_khr_command_buffer`. */
+        void releaseNative ();
+    };
+
+}
+}
+
+#endif  // GF_GRAPH_HPP
@@ -34,6 +34,8 @@
 
 #include <CLUtils.hpp>
 #include <GuidedFilter/common.hpp>
+#include <GuidedFilter/graph.hpp>
+#include <GuidedFilter/metrics.hpp>
 
 
 /*! \brief Offers classes which set up kernel execution parameters and 
@@ -101,16 +103,20 @@ namespace Math
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
 
         cl_float *hPtrInA;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrInB;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> &info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global;
         Staging staging;
@@ -186,6 +192,9 @@ namespace Math
                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
         /*! \brief Executes the necessary kernels. */
         void run (const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr);
+        /*! \brief Records the kernels in a `CommandGraph`. */
+        void record (CommandGraph &graph, const std::vector<CommandGraph::Node> *deps = nullptr, 
+                     CommandGraph::Node *node = nullptr);
         /*! \brief Gets the power. */
         int getPower ();
         /*! \brief Sets the power. */
@@ -193,12 +202,13 @@ namespace Math
 
         cl_float *hPtrIn;  /*!< Mapping of the input staging buffer. */
         cl_float *hPtrOut;  /*!< Mapping of the output staging buffer. */
+        Counters counters;  /*!< Runtime counters of the instance. */
 
     private:
         clutils::CLEnv &env;
         clutils::CLEnvInfo<1> &info;
         cl::Context context;
-        cl::CommandQueue queue;
+        MeteredQueue queue;
         cl::Kernel kernel;
         cl::NDRange global;
         Staging staging;
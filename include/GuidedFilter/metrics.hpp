@@ -0,0 +1,179 @@
+/*! \file metrics.hpp
+ *  \brief Declares the runtime counters of the `cl_algo::GF` classes.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_METRICS_HPP
+#define GF_METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <CLUtils.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief Runtime counters of an algorithm instance.
+     *  \details Every class of the `cl_algo::GF` namespace holds a `Counters` object,
+     *           and enqueues its commands through `MeteredQueue`s, which update it.
+     *           The counters are relaxed atomics, so they are cheap enough to stay on,
+     *           and they can be read from any thread. An update is also applied
+     *           on the parent of the instance (a class that contains another one
+     *           adopts its counters), and on the process-wide `global` counters.
+     *  \details The frames are counted by the `run` and `replay` methods of the instances
+     *           that aren't part of another one. The wall time of a frame is measured from
+     *           the call to the completion of its last command. The device time is the sum
+     *           of the kernel execution times, and it's only measured on command queues
+     *           created with `CL_QUEUE_PROFILING_ENABLE`. Timing a kernel costs an event
+     *           and a callback, so only the kernels of every `timingPeriod`-th frame are
+     *           timed, and `DEVICE_TIME / TIMED_FRAMES` estimates the device time of a frame.
+     *           Timing every kernel is opt-in, with `setTimingPeriod (1)`.
+     *  \note `dump` writes the counters of the process, and of every top-level instance,
+     *        in the Prometheus text exposition format.
+     *  \note The memory counters account for the buffers that an instance allocates itself, 
+     *        from their allocation until they are freed (e.g. replaced by a reallocation).
+     *        Buffers given to an instance through `get` are accounted by their creator.
+     *  \note Copies of an instance share its counters.
+     */
+    class Counters
+    {
+    public:
+        /*! \brief Enumerates the counters. */
+        enum class Counter : uint8_t
+        {
+            KERNELS,        /*!< Kernels enqueued (replays included). */
+            WRITES,         /*!< Host to device transfers. */
+            WRITE_BYTES,    /*!< Bytes transferred from the host to the device. */
+            READS,          /*!< Device to host transfers. */
+            READ_BYTES,     /*!< Bytes transferred from the device to the host. */
+            MAPS,           /*!< Buffer mappings. */
+            UNMAPS,         /*!< Buffer unmappings. */
+            DEVICE_MEMORY,  /*!< Bytes of device buffers currently allocated (gauge). */
+            HOST_MEMORY,    /*!< Bytes of host (`CL_MEM_ALLOC_HOST_PTR`) buffers currently allocated (gauge). */
+            FRAMES,         /*!< Completed frames. */
+            WALL_TIME,      /*!< Wall time of the completed frames in ns. */
+            DEVICE_TIME,    /*!< Kernel execution time of the timed frames in ns. */
+            TIMED_FRAMES,   /*!< Frames whose kernels were timed. */
+            COUNT
+        };
+
+        /*! \brief Holds the counters, and outlives the instance for as long as commands refer to it. */
+        struct Block;
+
+        /*! \brief Accounts a frame, i.e. a `run` or `replay` call.
+         *  \details Create one at the top of the method. For a top-level instance, it makes
+         *           sure the method produces an event (substituting its own, if `event`
+         *           is `nullptr`), and on destruction registers a callback on it.
+         */
+        class Frame
+        {
+        public:
+            Frame (Counters &counters, cl::Event *&event);
+            ~Frame ();
+            Frame (const Frame&) = delete;
+            Frame& operator= (const Frame&) = delete;
+
+        private:
+            std::shared_ptr<Block> block;
+            std::chrono::steady_clock::time_point start;
+            cl::Event local;
+            cl::Event *event;
+        };
+
+        /*! \brief Creates the counters of an instance of the class `_name`. */
+        Counters (const char *_name);
+        ~Counters ();
+        /*! \brief Makes the counters of the instance part of those of `parent`. */
+        void setParent (Counters &parent);
+        /*! \brief Returns the value of a counter. */
+        uint64_t get (Counter counter) const;
+        /*! \brief Adds to a counter (and to the ones of the ancestors). */
+        void add (Counter counter, uint64_t value);
+        /*! \brief Creates a buffer, and accounts for its memory. */
+        cl::Buffer allocate (const cl::Context &context, cl_mem_flags flags, size_t size);
+        /*! \brief Sets how often the kernels of a frame are timed. */
+        void setTimingPeriod (unsigned int period);
+        /*! \brief Returns the class name of the instance. */
+        const std::string& getName () const;
+        /*! \brief Returns the unique id of the instance. */
+        unsigned int getId () const;
+        /*! \brief Returns the process-wide counters. */
+        static Counters& global ();
+        /*! \brief Writes all counters in the Prometheus text format. */
+        static void dump (std::ostream &os);
+        /*! \brief Returns all counters in the Prometheus text format. */
+        static std::string dump ();
+
+        static const unsigned int defaultTimingPeriod = 16;  /*!< Default period of the timed frames. */
+
+    private:
+        struct Root {};
+        Counters (Root);
+
+        std::shared_ptr<Block> block;
+
+        friend class MeteredQueue;
+    };
+
+
+    /*! \brief A command queue that updates the `Counters` of an instance.
+     *  \details It hides the `cl::CommandQueue` methods used by the classes.
+     *           Calls through a plain `cl::CommandQueue` reference aren't counted.
+     */
+    class MeteredQueue : public cl::CommandQueue
+    {
+    public:
+        MeteredQueue ();
+        MeteredQueue (const cl::CommandQueue &queue, Counters &counters);
+        cl_int enqueueNDRangeKernel (const cl::Kernel &kernel, const cl::NDRange &offset,
+                                     const cl::NDRange &global, const cl::NDRange &local = cl::NullRange,
+                                     const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr) const;
+        cl_int enqueueWriteBuffer (const cl::Buffer &buffer, cl_bool block, size_t offset, size_t size, const void *ptr,
+                                   const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr) const;
+        cl_int enqueueReadBuffer (const cl::Buffer &buffer, cl_bool block, size_t offset, size_t size, void *ptr,
+                                  const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr) const;
+        void* enqueueMapBuffer (const cl::Buffer &buffer, cl_bool block, cl_map_flags flags, size_t offset, size_t size,
+                                const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr,
+                                cl_int *err = nullptr) const;
+        cl_int enqueueUnmapMemObject (const cl::Memory &memory, void *ptr,
+                                      const std::vector<cl::Event> *events = nullptr, cl::Event *event = nullptr) const;
+
+    private:
+        std::shared_ptr<Counters::Block> block;
+        bool profiling;
+    };
+
+}
+}
+
+#endif  // GF_METRICS_HPP
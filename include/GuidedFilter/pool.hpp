@@ -0,0 +1,178 @@
+/*! \file pool.hpp
+ *  \brief Declares a pool of `GuidedFilter` instances that
+ *         serves many concurrent host threads.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_POOL_HPP
+#define GF_POOL_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <CLUtils.hpp>
+#include <GuidedFilter/algorithms.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief A pool of `GuidedFilter<GuidedFilterConfig::I_EQ_P>` instances
+     *         that serves many concurrent host threads.
+     *  \details A filter instance holds mutable state (staging buffer mappings, events,
+     *           recorded graphs), so it can't be shared between threads. The pool owns
+     *           its own `CLEnv`, with a single context and program, and gives every
+     *           instance its own pair of command queues. The instances are kept per
+     *           key, i.e. per resolution and parameter set, and `checkout` hands out
+     *           an idle instance of the requested key through a `Lease`.
+     *  \details Checking out and returning an idle instance are lock-free (an atomic
+     *           exchange on an array of idle slots). The pool grows when a key has no
+     *           idle instances, up to `maxInstances` in total. At the limit, an idle
+     *           instance of another key is recycled, and if there is none, `checkout`
+     *           waits for an instance to be returned. Instances that stay idle longer
+     *           than the idle timeout are released when instances are returned
+     *           (or when `trim` is called), so the pool shrinks when the load drops.
+     *  \details The pool keeps up to `maxKeys` keys. When they are all taken, a key 
+     *           without instances (after its idle ones are released) is replaced, so 
+     *           a stream of new parameter sets doesn't exhaust the pool. Only when all 
+     *           the keys have leased instances, `checkout` fails (with an empty `Lease`).
+     *  \note All command queues are created in the constructor, so that the `CLEnv`
+     *        is never modified while the instances are in use.
+     *  \note Don't change the parameters of a leased instance (e.g. with `setRadius`),
+     *        since it's returned to the pool under the key it was checked out with.
+     */
+    class GuidedFilterPool
+    {
+    private:
+        struct Bucket;
+
+        /*! \brief Holds a pooled filter instance. */
+        struct Entry
+        {
+            std::unique_ptr<GuidedFilter<GuidedFilterConfig::I_EQ_P>> filter;
+            unsigned int pair;  // Index of the queue pair
+            Bucket *bucket;
+            unsigned int width, height;  // The key the instance was set up for
+            int radius; float eps;
+            std::chrono::steady_clock::time_point lastUse;
+        };
+
+    public:
+        /*! \brief Grants exclusive use of a filter instance until it's destroyed or released. */
+        class Lease
+        {
+        public:
+            Lease ();
+            Lease (GuidedFilterPool *_pool, Entry *_entry);
+            Lease (Lease &&other);
+            Lease& operator= (Lease &&other);
+            Lease (const Lease&) = delete;
+            Lease& operator= (const Lease&) = delete;
+            ~Lease ();
+            /*! \brief Returns the instance to the pool. */
+            void release ();
+            /*! \brief Returns whether the lease holds an instance. */
+            explicit operator bool () const { return entry != nullptr; }
+            GuidedFilter<GuidedFilterConfig::I_EQ_P>* operator-> () { return entry->filter.get (); }
+            GuidedFilter<GuidedFilterConfig::I_EQ_P>& operator* () { return *entry->filter; }
+            /*! \brief Returns one of the two command queues of the instance. */
+            cl::CommandQueue& queue (unsigned int idx = 0);
+
+        private:
+            GuidedFilterPool *pool;
+            Entry *entry;
+        };
+
+        /*! \brief Creates the OpenCL environment of the pool. */
+        GuidedFilterPool (const std::vector<std::string> &kernel_files,
+                          unsigned int _maxInstances = 8, unsigned int pIdx = 0, unsigned int dIdx = 0);
+        ~GuidedFilterPool ();
+        /*! \brief Hands out an instance configured for the given resolution and parameters. */
+        Lease checkout (unsigned int width, unsigned int height, int radius, float eps);
+        /*! \brief Releases the instances that have been idle longer than `idle`. */
+        unsigned int trim (std::chrono::milliseconds idle);
+        /*! \brief Sets the idle time after which returned instances are released. */
+        void setIdleTimeout (std::chrono::milliseconds _idleTimeout);
+        /*! \brief Returns the number of instances in the pool (leased or idle). */
+        unsigned int size ();
+        /*! \brief Returns the number of leased instances. */
+        unsigned int leased ();
+        /*! \brief Returns the environment of the pool. */
+        clutils::CLEnv& getEnv ();
+
+    private:
+        static const unsigned int maxKeys = 64;
+
+        /*! \brief Holds the idle instances of a key.
+         *  \note The key is only changed (with `mtx` locked) when the bucket has no 
+         *        instances, but it's read without locking, hence the atomics.
+         */
+        struct Bucket
+        {
+            std::atomic<unsigned int> width, height;
+            std::atomic<int> radius; std::atomic<float> eps;
+            unsigned int nEntries;  // Instances of the key, leased or idle. Guarded by `mtx`
+            std::unique_ptr<std::atomic<Entry *>[]> idle;
+        };
+
+        clutils::CLEnv env;
+        unsigned int device;
+        unsigned int maxInstances;
+        std::atomic<Bucket *> buckets[maxKeys];
+        std::atomic<unsigned int> nInstances, nLeased, nWaiting;
+        std::atomic<int64_t> idleTimeout, lastTrim;  // In steady_clock ticks
+        std::vector<unsigned int> freePairs;
+        std::mutex mtx;
+        std::condition_variable cv;
+
+        /*! \brief Finds (or adds) the bucket of a key. */
+        Bucket* find (unsigned int width, unsigned int height, int radius, float eps);
+        /*! \brief Finds (or adds, or replaces) the bucket of a key. Called with `mtx` locked. */
+        Bucket* findLocked (unsigned int width, unsigned int height, int radius, float eps);
+        /*! \brief Returns whether a bucket holds a key. */
+        static bool holds (Bucket *bucket, unsigned int width, unsigned int height, int radius, float eps);
+        /*! \brief Takes an idle instance out of a bucket. */
+        Entry* take (Bucket *bucket);
+        /*! \brief Puts an instance in an idle slot of its bucket. */
+        void give (Entry *entry);
+        /*! \brief Creates an instance for a bucket. Called with `mtx` locked. */
+        Entry* create (Bucket *bucket);
+        /*! \brief Destroys an instance. Called with `mtx` locked. */
+        void destroy (Entry *entry);
+        /*! \brief Returns a leased instance to the pool. */
+        void checkin (Entry *entry);
+    };
+
+}
+}
+
+#endif  // GF_POOL_HPP
@@ -0,0 +1,150 @@
+/*! \file service.hpp
+ *  \brief Declares the protocol of the local `Guided Filter` service,
+ *         and a client for it.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_SERVICE_HPP
+#define GF_SERVICE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief Default path of the control socket of the service. */
+    const char * const serviceSocketPath = "/tmp/guided_filter.sock";
+
+    /*! \brief The frame dimensions accepted by the service have to be multiples of this value. */
+    const unsigned int serviceAlignment = 16;
+
+    /*! \brief The largest frame dimension accepted by the service. */
+    const unsigned int serviceMaxSide = 8192;
+
+    /*! \brief The largest filter window radius accepted by the service. */
+    const int serviceMaxRadius = 64;
+
+    /*! \brief Enumerates the operations of the service protocol. */
+    enum class ServiceOp : uint32_t
+    {
+        ATTACH,  /*!< Maps the client's shared memory segment in the service. */
+        FILTER   /*!< Filters a frame that lies in the segment. */
+    };
+
+    /*! \brief Enumerates the status codes of the service replies. */
+    enum class ServiceStatus : uint32_t
+    {
+        OK,           /*!< The request completed. */
+        BAD_REQUEST,  /*!< The request is malformed. */
+        BAD_SEGMENT,  /*!< The segment can't be mapped, or the frame doesn't fit in it. */
+        BAD_SHAPE,    /*!< The frame dimensions aren't supported. */
+        FAILED        /*!< The device commands failed. */
+    };
+
+    /*! \brief A request to the service.
+     *  \details The messages have a fixed size, and travel over the control socket.
+     *           The frames themselves stay in the shared memory segment of the client.
+     *           A `FILTER` request refers to a `width*height` `cl_float` input array
+     *           at `inOffset`, and to the output array, of the same size, at `outOffset`.
+     */
+    struct ServiceRequest
+    {
+        uint32_t op;         /*!< A `ServiceOp`. */
+        uint32_t id;         /*!< Identifier echoed in the reply. */
+        uint32_t width;      /*!< Width of the frame. */
+        uint32_t height;     /*!< Height of the frame. */
+        int32_t radius;      /*!< Radius of the filter window. */
+        float eps;           /*!< Regularization parameter. */
+        uint64_t inOffset;   /*!< Offset of the input in the segment, in bytes. */
+        uint64_t outOffset;  /*!< Offset of the output in the segment, in bytes. */
+        uint64_t size;       /*!< Size of the segment (`ATTACH`). */
+        char name[40];       /*!< Name of the segment (`ATTACH`). */
+    };
+
+    /*! \brief A reply from the service. */
+    struct ServiceReply
+    {
+        uint32_t id;         /*!< Identifier of the request. */
+        uint32_t status;     /*!< A `ServiceStatus`. */
+        uint32_t batch;      /*!< Number of same-shape requests processed together with this one. */
+        uint32_t reserved;
+        double queueTime;    /*!< Time the request waited in the service, in ms. */
+        double serviceTime;  /*!< Time from dispatch to completion, in ms. */
+    };
+
+    static_assert (sizeof (ServiceRequest) == 88, "Unexpected ServiceRequest layout");
+    static_assert (sizeof (ServiceReply) == 32, "Unexpected ServiceReply layout");
+
+
+    /*! \brief A client of the local `Guided Filter` service.
+     *  \details The client creates a POSIX shared memory segment, and the service maps
+     *           it too. The caller places the input frames in the segment, through
+     *           `data`, and the service transfers them to the device, and the outputs
+     *           back to the segment, without any intermediate copies. The segment name
+     *           is unlinked as soon as the service has mapped it.
+     *  \details `filter` sends a request and waits for its reply. `send` and `receive`
+     *           allow several requests to be in flight, for pipelining. Replies may
+     *           arrive out of order, when the requests have different shapes.
+     *  \note The client doesn't depend on OpenCL. An instance isn't thread-safe;
+     *        use one per thread.
+     */
+    class GuidedFilterClient
+    {
+    public:
+        /*! \brief Connects to the service, and shares a segment of `_size` bytes with it. */
+        GuidedFilterClient (size_t _size, const std::string &socketPath = serviceSocketPath);
+        ~GuidedFilterClient ();
+        GuidedFilterClient (const GuidedFilterClient&) = delete;
+        GuidedFilterClient& operator= (const GuidedFilterClient&) = delete;
+        /*! \brief Returns the mapping of the shared segment. */
+        void* data ();
+        /*! \brief Returns the size of the shared segment in bytes. */
+        size_t size ();
+        /*! \brief Sends a `FILTER` request. */
+        uint32_t send (unsigned int width, unsigned int height, int radius, float eps,
+                       size_t inOffset, size_t outOffset);
+        /*! \brief Waits for the next reply. */
+        ServiceReply receive ();
+        /*! \brief Sends a `FILTER` request, and waits for its reply. */
+        ServiceReply filter (unsigned int width, unsigned int height, int radius, float eps,
+                             size_t inOffset, size_t outOffset);
+
+    private:
+        int fd;
+        void *ptr;
+        size_t segmentSize;
+        uint32_t nextId;
+    };
+
+}
+}
+
+#endif  // GF_SERVICE_HPP
@@ -30,6 +30,9 @@
 #define GF_HELPERFUNCS_HPP
 
 #include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <vector>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include <OpenCL/cl.hpp>
@@ -177,6 +180,27 @@ namespace GF
     }
 
 
+    /*! \brief Performs a matrix transposition.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \param[in] in input image.
+     *  \param[out] r output image with channel r.
+     *  \param[out] g output image with channel g.
+     *  \param[out] b output image with channel b.
+     *  \param[in] pixels number of pixels in the input array.
+     */
+    template <typename T2>
+    void cpuSeparateRGB_N_Norm (unsigned short *in, T2 *r, T2 *g, T2 *b, uint32_t pixels)
+    {
+        for (uint i = 0; i < pixels; ++i)
+        {
+            r[i] = (T2) in[i * 3] / 65535.f;
+            g[i] = (T2) in[i * 3 + 1] / 65535.f;
+            b[i] = (T2) in[i * 3 + 2] / 65535.f;
+        }
+    }
+
+
     /*! \brief Performs a matrix transposition.
      *  \details It is just a naive serial implementation.
      *
@@ -219,6 +243,36 @@ namespace GF
     }
 
 
+    /*! \brief Scales a value to `65535`, rounds it to the nearest 
+     *         (even) integer, and saturates it to the range of `ushort`.
+     */
+    inline unsigned short cpuScaleUshort (float v)
+    {
+        return (unsigned short) std::min (std::max (std::nearbyint (v * 65535.f), 0.f), 65535.f);
+    }
+
+
+    /*! \brief Performs a matrix transpose.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \param[in] r input image with channel r.
+     *  \param[in] g input image with channel g.
+     *  \param[in] b input image with channel b.
+     *  \param[out] out output (transpose) image.
+     *  \param[in] pixels number of pixels in the input array.
+     */
+    template <typename T1>
+    void cpuTranspose_N_Scale (T1 *r, T1 *g, T1 *b, unsigned short *out, uint32_t pixels)
+    {
+        for (uint i = 0; i < pixels; ++i)
+        {
+            out[i * 3]     = cpuScaleUshort (r[i]);
+            out[i * 3 + 1] = cpuScaleUshort (g[i]);
+            out[i * 3 + 2] = cpuScaleUshort (b[i]);
+        }
+    }
+
+
     /*! \brief Transforms a depth image to a point cloud.
      *  \details It is just a naive serial implementation.
      *
@@ -312,6 +366,120 @@ namespace GF
     }
 
 
+    /*! \brief Removes the invalid points (zero depth) from a point cloud.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \tparam T type of the points (`cl_float4` or `cl_float8`).
+     *  \param[in] in array with the points of the point cloud.
+     *  \param[out] out array with the valid points.
+     *  \param[in] n number of points in the point cloud.
+     *  \return The number of valid points.
+     */
+    template <typename T>
+    uint32_t cpuCompactPC (T *in, T *out, uint32_t n)
+    {
+        uint32_t count = 0;
+        for (uint k = 0; k < n; ++k)
+            if (((cl_float *) &in[k])[2] != 0.f)
+                out[count++] = in[k];
+
+        return count;
+    }
+
+
+    /*! \brief Estimates the surface normals of an organized point cloud.
+     *  \details It is just a naive serial implementation. The covariance matrix 
+     *           of the valid points in the window is computed directly, in double precision.
+     *
+     *  \tparam T type of the points (`cl_float4`).
+     *  \param[in] pc organized point cloud.
+     *  \param[out] normals array with the normals (+ curvature in the **w** component).
+     *  \param[in] width width of the point cloud.
+     *  \param[in] height height of the point cloud.
+     *  \param[in] radius radius of the neighborhood window.
+     */
+    template <typename T>
+    void cpuNormals (T *pc, T *normals, int width, int height, int radius)
+    {
+        for (int row = 0; row < height; ++row)
+        {
+            for (int col = 0; col < width; ++col)
+            {
+                T &out = normals[row * width + col];
+                T &p = pc[row * width + col];
+                out = { 0.f, 0.f, 0.f, 0.f };
+                if (p.s[2] == 0.f) continue;
+
+                int x0 = std::max (col - radius, 0), x1 = std::min (col + radius, width - 1);
+                int y0 = std::max (row - radius, 0), y1 = std::min (row + radius, height - 1);
+
+                double n = 0, m[3] = { 0, 0, 0 };
+                for (int y = y0; y <= y1; ++y)
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        T &q = pc[y * width + x];
+                        if (q.s[2] == 0.f) continue;
+                        for (int i = 0; i < 3; ++i) m[i] += q.s[i];
+                        n += 1;
+                    }
+                if (n < 3) continue;
+                for (int i = 0; i < 3; ++i) m[i] /= n;
+
+                double A[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+                for (int y = y0; y <= y1; ++y)
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        T &q = pc[y * width + x];
+                        if (q.s[2] == 0.f) continue;
+                        for (int i = 0; i < 3; ++i)
+                            for (int j = 0; j < 3; ++j)
+                                A[i][j] += (q.s[i] - m[i]) * (q.s[j] - m[j]) / n;
+                    }
+
+                double p1 = A[0][1] * A[0][1] + A[0][2] * A[0][2] + A[1][2] * A[1][2];
+                double qt = (A[0][0] + A[1][1] + A[2][2]) / 3.0;
+                double p2 = 2.0 * p1;
+                for (int i = 0; i < 3; ++i) p2 += (A[i][i] - qt) * (A[i][i] - qt);
+                double pp = std::sqrt (p2 / 6.0);
+                if (pp == 0) continue;
+
+                double B[3][3];
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                        B[i][j] = (A[i][j] - (i == j ? qt : 0.0)) / pp;
+                double det = B[0][0] * (B[1][1] * B[2][2] - B[1][2] * B[2][1])
+                           - B[0][1] * (B[1][0] * B[2][2] - B[1][2] * B[2][0])
+                           + B[0][2] * (B[1][0] * B[2][1] - B[1][1] * B[2][0]);
+                double phi = std::acos (std::min (std::max (det / 2.0, -1.0), 1.0)) / 3.0;
+                double l0 = qt + 2.0 * pp * std::cos (phi + 2.0 * M_PI / 3.0);
+                double l2 = qt + 2.0 * pp * std::cos (phi);
+                double l1 = 3.0 * qt - l0 - l2;
+
+                // Eigenvector of the smallest eigenvalue: the largest cross product of the rows of A - l0*I
+                double v[3] = { 0, 0, 0 }, vNorm = 0;
+                for (int a = 0; a < 2; ++a)
+                    for (int b = a + 1; b < 3; ++b)
+                    {
+                        double ra[3] = { A[a][0], A[a][1], A[a][2] }; ra[a] -= l0;
+                        double rb[3] = { A[b][0], A[b][1], A[b][2] }; rb[b] -= l0;
+                        double c[3] = { ra[1] * rb[2] - ra[2] * rb[1], 
+                                        ra[2] * rb[0] - ra[0] * rb[2], 
+                                        ra[0] * rb[1] - ra[1] * rb[0] };
+                        double cNorm = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+                        if (cNorm > vNorm) { vNorm = cNorm; std::copy (c, c + 3, v); }
+                    }
+                if (vNorm == 0) continue;
+
+                vNorm = std::sqrt (vNorm);
+                double sign = (v[0] * p.s[0] + v[1] * p.s[1] + v[2] * p.s[2] > 0) ? -1.0 : 1.0;
+                double sum = l0 + l1 + l2;
+                out = { (float) (sign * v[0] / vNorm), (float) (sign * v[1] / vNorm), 
+                        (float) (sign * v[2] / vNorm), (float) ((sum > 0) ? std::max (l0, 0.0) / sum : 0.0) };
+            }
+        }
+    }
+
+
     /*! \brief Performs RGB color normalization.
      *  \details That is $$ \\hat{p}.i = \\frac{p.i}{p.r + p.g + p.b},\\ \\ i=\\{r,g,b\\} $$
      *
@@ -427,6 +595,104 @@ namespace GF
         }
     }
 
+    /*! \brief Performs box (mean) filtering on a volume.
+     *  \details It is just a naive serial implementation. The window spans 
+     *           \f$ 2*radius+1 \f$ elements in each direction of a slice, and 
+     *           \f$ 2*radiusZ+1 \f$ slices. With a nonzero `frames`, the window 
+     *           spans the last `frames` slices instead (causal), and `radiusZ` 
+     *           is not used. The windows are clamped at the borders.
+     *
+     *  \param[in] in input array of `depth` slices.
+     *  \param[out] out output (blurred) array.
+     *  \param[in] width width of the slices.
+     *  \param[in] height height of the slices.
+     *  \param[in] depth number of slices.
+     *  \param[in] radius radius of the window in a slice.
+     *  \param[in] radiusZ radius of the window across the slices.
+     *  \param[in] frames number of slices in a causal window.
+     */
+    template <typename T>
+    void cpuBoxFilter3D (T *in, T *out, int width, int height, int depth, 
+                         int radius, int radiusZ, int frames = 0)
+    {
+        int pixels = width * height;
+        T *box = new T[pixels * depth];
+
+        // The mean over the window is the mean of the 2D means of its slices
+        for (int z = 0; z < depth; ++z)
+            cpuBoxFilter (in + z * pixels, box + z * pixels, width, height, radius);
+
+        for (int z = 0; z < depth; ++z)
+        {
+            int z0 = frames ? std::max (z - frames + 1, 0) : std::max (z - radiusZ, 0);
+            int z1 = frames ? z : std::min (z + radiusZ, depth - 1);
+
+            for (int idx = 0; idx < pixels; ++idx)
+            {
+                T sum = 0.f;
+                for (int iz = z0; iz <= z1; ++iz)
+                    sum += box[iz * pixels + idx];
+                out[z * pixels + idx] = sum / (T) (z1 - z0 + 1);
+            }
+        }
+
+        delete[] box;
+    }
+
+
+    /*! \brief Performs min filtering (grayscale erosion) on an array.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \param[in] in input array.
+     *  \param[out] out output array.
+     *  \param[in] width width of the array.
+     *  \param[in] height height of the array.
+     *  \param[in] radius radius of the square filter window.
+     */
+    template <typename T>
+    void cpuMinFilter (T *in, T *out, int width, int height, int radius)
+    {
+        for (int row = 0; row < height; ++row)
+        {
+            for (int col = 0; col < width; ++col)
+            {
+                T m = in[row * width + col];
+                for (int iy = std::max (row - radius, 0); iy <= std::min (row + radius, height - 1); ++iy)
+                    for (int ix = std::max (col - radius, 0); ix <= std::min (col + radius, width - 1); ++ix)
+                        m = std::min (m, in[iy * width + ix]);
+
+                out[row * width + col] = m;
+            }
+        }
+    }
+
+
+    /*! \brief Performs max filtering (grayscale dilation) on an array.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \param[in] in input array.
+     *  \param[out] out output array.
+     *  \param[in] width width of the array.
+     *  \param[in] height height of the array.
+     *  \param[in] radius radius of the square filter window.
+     */
+    template <typename T>
+    void cpuMaxFilter (T *in, T *out, int width, int height, int radius)
+    {
+        for (int row = 0; row < height; ++row)
+        {
+            for (int col = 0; col < width; ++col)
+            {
+                T m = in[row * width + col];
+                for (int iy = std::max (row - radius, 0); iy <= std::min (row + radius, height - 1); ++iy)
+                    for (int ix = std::max (col - radius, 0); ix <= std::min (col + radius, width - 1); ++ix)
+                        m = std::max (m, in[iy * width + ix]);
+
+                out[row * width + col] = m;
+            }
+        }
+    }
+
 
     /*! \brief Performs an element-wise array multiplication.
      *  \details It is just a naive serial implementation.
@@ -522,6 +788,331 @@ namespace GF
                 q[idx] = mean_a[idx] * p[idx] + mean_b[idx];
             }
         }
+
+        delete[] mean_p; delete[] p2; delete[] mean_p2;
+        delete[] a; delete[] b; delete[] mean_a; delete[] mean_b;
+    }
+
+
+    /*! \brief Performs guided filtering of an array with a separate guidance array.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \param[in] I guidance array.
+     *  \param[in] p input array.
+     *  \param[out] q output (filtered) array.
+     *  \param[in] width width of the arrays.
+     *  \param[in] height height of the arrays.
+     *  \param[in] radius radius of the square filter window.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     */
+    template <typename T>
+    void cpuGuidedFilter (T *I, T *p, T *q, int width, int height, int radius, float eps)
+    {
+        int pixels = width * height;
+        T *mean_I = new T[pixels];
+        T *mean_p = new T[pixels];
+        T *II = new T[pixels];
+        T *Ip = new T[pixels];
+        T *corr_I = new T[pixels];
+        T *corr_Ip = new T[pixels];
+        T *a = new T[pixels];
+        T *b = new T[pixels];
+        T *mean_a = new T[pixels];
+        T *mean_b = new T[pixels];
+
+        cpuBoxFilter (I, mean_I, width, height, radius);
+        cpuBoxFilter (p, mean_p, width, height, radius);
+        cpuMult (I, I, II, width, height);
+        cpuMult (I, p, Ip, width, height);
+        cpuBoxFilter (II, corr_I, width, height, radius);
+        cpuBoxFilter (Ip, corr_Ip, width, height, radius);
+
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            T var_I = corr_I[idx] - mean_I[idx] * mean_I[idx];
+            T cov_Ip = corr_Ip[idx] - mean_I[idx] * mean_p[idx];
+            a[idx] = cov_Ip / (var_I + eps);
+            b[idx] = mean_p[idx] - a[idx] * mean_I[idx];
+        }
+
+        cpuBoxFilter (a, mean_a, width, height, radius);
+        cpuBoxFilter (b, mean_b, width, height, radius);
+
+        for (int idx = 0; idx < pixels; ++idx)
+            q[idx] = mean_a[idx] * I[idx] + mean_b[idx];
+
+        delete[] mean_I; delete[] mean_p; delete[] II; delete[] Ip; delete[] corr_I; 
+        delete[] corr_Ip; delete[] a; delete[] b; delete[] mean_a; delete[] mean_b;
+    }
+
+    /*! \brief Performs guided filtering of a volume with a separate guidance volume.
+     *  \details It is just a naive serial implementation. The windows are the ones 
+     *           of `cpuBoxFilter3D`. With a nonzero `frames`, the slices are the frames 
+     *           of a stream, and the windows span the last `frames` frames.
+     *
+     *  \param[in] I guidance volume.
+     *  \param[in] p input volume.
+     *  \param[out] q output (filtered) volume.
+     *  \param[in] width width of the slices.
+     *  \param[in] height height of the slices.
+     *  \param[in] depth number of slices.
+     *  \param[in] radius radius of the window in a slice.
+     *  \param[in] radiusZ radius of the window across the slices.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] frames number of slices in a causal window.
+     */
+    template <typename T>
+    void cpuGuidedFilter3D (T *I, T *p, T *q, int width, int height, int depth, 
+                            int radius, int radiusZ, float eps, int frames = 0)
+    {
+        int n = width * height * depth;
+        std::vector<T> II (n), Ip (n), mean_I (n), mean_p (n), corr_I (n), corr_Ip (n);
+        std::vector<T> a (n), b (n), mean_a (n), mean_b (n);
+
+        for (int idx = 0; idx < n; ++idx)
+        {
+            II[idx] = I[idx] * I[idx];
+            Ip[idx] = I[idx] * p[idx];
+        }
+
+        cpuBoxFilter3D (I, mean_I.data (), width, height, depth, radius, radiusZ, frames);
+        cpuBoxFilter3D (p, mean_p.data (), width, height, depth, radius, radiusZ, frames);
+        cpuBoxFilter3D (II.data (), corr_I.data (), width, height, depth, radius, radiusZ, frames);
+        cpuBoxFilter3D (Ip.data (), corr_Ip.data (), width, height, depth, radius, radiusZ, frames);
+
+        for (int idx = 0; idx < n; ++idx)
+        {
+            T var_I = corr_I[idx] - mean_I[idx] * mean_I[idx];
+            T cov_Ip = corr_Ip[idx] - mean_I[idx] * mean_p[idx];
+            a[idx] = cov_Ip / (var_I + eps);
+            b[idx] = mean_p[idx] - a[idx] * mean_I[idx];
+        }
+
+        cpuBoxFilter3D (a.data (), mean_a.data (), width, height, depth, radius, radiusZ, frames);
+        cpuBoxFilter3D (b.data (), mean_b.data (), width, height, depth, radius, radiusZ, frames);
+
+        for (int idx = 0; idx < n; ++idx)
+            q[idx] = mean_a[idx] * I[idx] + mean_b[idx];
+    }
+
+
+    /*! \brief Performs guided upsampling of a low-resolution array with a high-resolution guidance array.
+     *  \details It is just a naive serial implementation.
+     *
+     *  \param[in] I guidance (high-resolution) array.
+     *  \param[in] p input (low-resolution) array.
+     *  \param[out] q output (high-resolution) array.
+     *  \param[in] width width of the guidance array.
+     *  \param[in] height height of the guidance array.
+     *  \param[in] factor upsampling factor.
+     *  \param[in] radius radius of the square filter window (at the low resolution).
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] zero_out flag to indicate whether to zero out the pixels 
+     *                      whose nearest pixel in the input array is zero.
+     */
+    template <typename T>
+    void cpuGuidedUpsampling (T *I, T *p, T *q, int width, int height, 
+                              int factor, int radius, float eps, bool zero_out)
+    {
+        int lWidth = width / factor, lHeight = height / factor;
+        int pixels = lWidth * lHeight;
+        T *lI = new T[pixels];
+        T *mean_I = new T[pixels];
+        T *mean_p = new T[pixels];
+        T *II = new T[pixels];
+        T *Ip = new T[pixels];
+        T *corr_I = new T[pixels];
+        T *corr_Ip = new T[pixels];
+        T *a = new T[pixels];
+        T *b = new T[pixels];
+        T *mean_a = new T[pixels];
+        T *mean_b = new T[pixels];
+
+        for (int row = 0; row < lHeight; ++row)
+        {
+            for (int col = 0; col < lWidth; ++col)
+            {
+                T sum = 0;
+                for (int y = 0; y < factor; ++y)
+                    for (int x = 0; x < factor; ++x)
+                        sum += I[(row * factor + y) * width + col * factor + x];
+                lI[row * lWidth + col] = sum / (factor * factor);
+            }
+        }
+
+        cpuBoxFilter (lI, mean_I, lWidth, lHeight, radius);
+        cpuBoxFilter (p, mean_p, lWidth, lHeight, radius);
+        cpuMult (lI, lI, II, lWidth, lHeight);
+        cpuMult (lI, p, Ip, lWidth, lHeight);
+        cpuBoxFilter (II, corr_I, lWidth, lHeight, radius);
+        cpuBoxFilter (Ip, corr_Ip, lWidth, lHeight, radius);
+
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            T var_I = corr_I[idx] - mean_I[idx] * mean_I[idx];
+            T cov_Ip = corr_Ip[idx] - mean_I[idx] * mean_p[idx];
+            a[idx] = cov_Ip / (var_I + eps);
+            b[idx] = mean_p[idx] - a[idx] * mean_I[idx];
+        }
+
+        cpuBoxFilter (a, mean_a, lWidth, lHeight, radius);
+        cpuBoxFilter (b, mean_b, lWidth, lHeight, radius);
+
+        for (int row = 0; row < height; ++row)
+        {
+            for (int col = 0; col < width; ++col)
+            {
+                float u = std::min (std::max ((col + 0.5f) / factor - 0.5f, 0.f), (float) (lWidth - 1));
+                float v = std::min (std::max ((row + 0.5f) / factor - 0.5f, 0.f), (float) (lHeight - 1));
+                int x0 = (int) u, y0 = (int) v;
+                int x1 = std::min (x0 + 1, lWidth - 1), y1 = std::min (y0 + 1, lHeight - 1);
+                float fx = u - x0, fy = v - y0;
+
+                T a_ = (1 - fy) * ((1 - fx) * mean_a[y0 * lWidth + x0] + fx * mean_a[y0 * lWidth + x1]) + 
+                            fy  * ((1 - fx) * mean_a[y1 * lWidth + x0] + fx * mean_a[y1 * lWidth + x1]);
+                T b_ = (1 - fy) * ((1 - fx) * mean_b[y0 * lWidth + x0] + fx * mean_b[y0 * lWidth + x1]) + 
+                            fy  * ((1 - fx) * mean_b[y1 * lWidth + x0] + fx * mean_b[y1 * lWidth + x1]);
+
+                T p_ = p[(row / factor) * lWidth + col / factor];
+                q[row * width + col] = (zero_out && p_ == 0) ? 0 : a_ * I[row * width + col] + b_;
+            }
+        }
+
+        delete[] lI; delete[] mean_I; delete[] mean_p; delete[] II; delete[] Ip; delete[] corr_I; 
+        delete[] corr_Ip; delete[] a; delete[] b; delete[] mean_a; delete[] mean_b;
+    }
+
+    /*! \brief Performs multi-scale detail enhancement and tone mapping on an `RGB` image.
+     *  \details It is just a naive serial implementation. The normalized log-luminance 
+     *           is decomposed with the guided filter at every radius, the detail layers 
+     *           are boosted, the coarsest base layer is compressed around the anchor, 
+     *           and the colors are scaled, exposed and gamma encoded.
+     *
+     *  \param[in] in input array of interleaved `RGB` values.
+     *  \param[out] out output array of interleaved `RGB` values.
+     *  \param[in] width width of the image.
+     *  \param[in] height height of the image.
+     *  \param[in] radii radii of the square filter windows of the scales.
+     *  \param[in] boost boost factors of the detail layers of the scales.
+     *  \param[in] scales number of scales.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] compression factor by which to scale the (coarsest) base layer.
+     *  \param[in] anchor log-luminance that the compression maps to itself.
+     *  \param[in] exposure factor by which to scale the colors.
+     *  \param[in] gamma gamma of the output encoding.
+     */
+    template <typename T>
+    void cpuDetailEnhancement (T *in, unsigned char *out, int width, int height, 
+                               const int *radii, const float *boost, int scales, float eps, 
+                               float compression, float anchor, float exposure, float gamma)
+    {
+        int pixels = width * height;
+        const T delta = 1.f / 1024.f;
+        const T range = std::log1p (1 / delta);
+        T *l = new T[pixels];
+        T *base = new T[pixels];
+        T *lOut = new T[pixels];
+
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            T Y = 0.299f * in[3 * idx] + 0.587f * in[3 * idx + 1] + 0.114f * in[3 * idx + 2];
+            l[idx] = std::log1p (std::max (Y, (T) 0) / delta) / range;
+            lOut[idx] = 0;
+        }
+
+        // Accumulate the boosted detail layers
+        T *prev = l;
+        for (int k = 0; k < scales; ++k)
+        {
+            cpuGuidedFilter (l, base, width, height, radii[k], eps);
+            for (int idx = 0; idx < pixels; ++idx)
+                lOut[idx] += boost[k] * (prev[idx] - base[idx]);
+            if (prev == l) prev = new T[pixels];
+            std::copy (base, base + pixels, prev);
+        }
+
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            lOut[idx] += anchor + compression * (prev[idx] - anchor);
+            T ratio = std::exp ((lOut[idx] - l[idx]) * range);
+            for (int c = 0; c < 3; ++c)
+            {
+                T v = std::min (std::max (exposure * ratio * in[3 * idx + c], (T) 0), (T) 1);
+                out[3 * idx + c] = (unsigned char) std::nearbyint (255 * std::pow (v, 1 / gamma));
+            }
+        }
+
+        if (prev != l) delete[] prev;
+        delete[] l; delete[] base; delete[] lOut;
+    }
+
+    /*! \brief Estimates the dark channel, the atmospheric light, and the refined 
+     *         transmission of a hazy `RGB` image.
+     *  \details It is just a naive serial implementation. The atmospheric light is 
+     *           the mean color of the pixels in the highest bins of the `256` bin 
+     *           dark channel histogram that hold at least \f$ 0.1\% \f$ of the pixels.
+     *
+     *  \param[in] in input array of interleaved `RGB` values.
+     *  \param[out] dark array of dark channel values.
+     *  \param[out] light array of the `3` components of the atmospheric light.
+     *  \param[out] t array of refined transmission values.
+     *  \param[in] width width of the image.
+     *  \param[in] height height of the image.
+     *  \param[in] darkRadius radius of the dark channel window.
+     *  \param[in] radius radius of the filter window of the transmission refinement.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] omega fraction of the haze to remove, \f$ \omega \f$.
+     */
+    template <typename T>
+    void cpuDehazing (T *in, T *dark, T *light, T *t, int width, int height, 
+                      int darkRadius, int radius, float eps, float omega)
+    {
+        int pixels = width * height;
+        T *minRGB = new T[pixels];
+        T *gray = new T[pixels];
+        T *raw = new T[pixels];
+        T *tRaw = new T[pixels];
+
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            T *c = in + 3 * idx;
+            minRGB[idx] = std::min (c[0], std::min (c[1], c[2]));
+            gray[idx] = 0.299f * c[0] + 0.587f * c[1] + 0.114f * c[2];
+        }
+        cpuMinFilter (minRGB, dark, width, height, darkRadius);
+
+        // Find the threshold bin of the haziest pixels
+        auto bin = [] (T v) { return (int) std::min (std::max (v * 256.f, 0.f), 255.f); };
+        std::vector<int> hist (256, 0);
+        for (int idx = 0; idx < pixels; ++idx)
+            hist[bin (dark[idx])]++;
+        int top = std::max (pixels / 1000, 1), count = 0, threshold = 255;
+        for ( ; threshold > 0; --threshold)
+        {
+            count += hist[threshold];
+            if (count >= top) break;
+        }
+
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        int n = 0;
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            if (bin (dark[idx]) < threshold) continue;
+            for (int c = 0; c < 3; ++c) sum[c] += in[3 * idx + c];
+            n++;
+        }
+        for (int c = 0; c < 3; ++c)
+            light[c] = std::max ((T) (sum[c] / std::max (n, 1)), (T) 1e-3f);
+
+        for (int idx = 0; idx < pixels; ++idx)
+        {
+            T *c = in + 3 * idx;
+            raw[idx] = 1 - omega * std::min (c[0] / light[0], std::min (c[1] / light[1], c[2] / light[2]));
+        }
+        cpuMaxFilter (raw, tRaw, width, height, darkRadius);
+        cpuGuidedFilter (gray, tRaw, t, width, height, radius, eps);
+
+        delete[] minRGB; delete[] gray; delete[] raw; delete[] tRaw;
     }
 
 }
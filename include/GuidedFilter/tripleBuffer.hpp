@@ -0,0 +1,195 @@
+/*! \file tripleBuffer.hpp
+ *  \brief Declares a lock-free triple buffer for handing frames
+ *         from a producer thread to a consumer thread.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_TRIPLEBUFFER_HPP
+#define GF_TRIPLEBUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <CLUtils.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief A single-producer/single-consumer triple buffer.
+     *  \details The producer always has a slot to write in (`back`), and the
+     *           consumer always has a slot to read from (`front`). The third
+     *           slot holds the most recently published frame. `publish` and
+     *           `acquire` swap a slot with the middle one through a single
+     *           atomic exchange, so neither side ever blocks or copies.
+     *           When the producer publishes a frame before the consumer
+     *           acquired the previous one, the previous frame is dropped.
+     *  \note The class doesn't own the slots. Any memory will do, but pinned
+     *        staging memory (e.g., a `PinnedTripleBuffer`) allows the consumer
+     *        to transfer a frame to the device straight from its slot.
+     *
+     *  \tparam T type of the slot elements.
+     */
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        /*! \param[in] slot0 first slot.
+         *  \param[in] slot1 second slot.
+         *  \param[in] slot2 third slot.
+         */
+        TripleBuffer (T *slot0 = nullptr, T *slot1 = nullptr, T *slot2 = nullptr) :
+            stamps (), middle (1), backIdx (0), frontIdx (2), nPublished (0), nDropped (0)
+        {
+            setSlots (slot0, slot1, slot2);
+        }
+
+        /*! \brief Sets the slots. Only call when neither side is active. */
+        void setSlots (T *slot0, T *slot1, T *slot2)
+        {
+            slots[0] = slot0; slots[1] = slot1; slots[2] = slot2;
+        }
+
+        /*! \brief Returns the slot the producer writes in. */
+        T* back ()
+        {
+            return slots[backIdx];
+        }
+
+        /*! \brief Publishes the frame in the back slot, and gives the producer a new back slot.
+         *  \note Called only by the producer.
+         *
+         *  \param[in] stamp a value that travels with the frame (e.g., its arrival time).
+         */
+        void publish (uint64_t stamp = 0)
+        {
+            stamps[backIdx] = stamp;
+            uint8_t prev = middle.exchange (backIdx | fresh, std::memory_order_acq_rel);
+            backIdx = prev & mask;
+            nPublished.fetch_add (1, std::memory_order_relaxed);
+            if (prev & fresh) nDropped.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        /*! \brief Moves the most recently published frame to the front slot.
+         *  \note Called only by the consumer. The front slot stays
+         *        valid until the next successful `acquire`.
+         *
+         *  \return The front slot, or `nullptr` if no new frame has been published.
+         */
+        T* acquire ()
+        {
+            if (!(middle.load (std::memory_order_relaxed) & fresh))
+                return nullptr;
+
+            uint8_t prev = middle.exchange (frontIdx, std::memory_order_acq_rel);
+            frontIdx = prev & mask;
+            return slots[frontIdx];
+        }
+
+        /*! \brief Returns the slot the consumer reads from. */
+        T* front ()
+        {
+            return slots[frontIdx];
+        }
+
+        /*! \brief Returns the value published with the frame in the front slot. */
+        uint64_t frontStamp () const
+        {
+            return stamps[frontIdx];
+        }
+
+        /*! \brief Returns the number of published frames. */
+        size_t published () const
+        {
+            return nPublished.load (std::memory_order_relaxed);
+        }
+
+        /*! \brief Returns the number of frames that were overwritten before being acquired. */
+        size_t dropped () const
+        {
+            return nDropped.load (std::memory_order_relaxed);
+        }
+
+    private:
+        static const uint8_t mask = 0x3;   // Slot index bits of `middle`
+        static const uint8_t fresh = 0x4;  // Set, while `middle` holds an unacquired frame
+
+        T *slots[3];
+        uint64_t stamps[3];
+        std::atomic<uint8_t> middle;
+        uint8_t backIdx;   // Owned by the producer
+        uint8_t frontIdx;  // Owned by the consumer
+        std::atomic<size_t> nPublished, nDropped;
+
+    };
+
+
+    /*! \brief A `TripleBuffer` whose slots are pinned staging buffers.
+     *  \details The slots are allocated with `CL_MEM_ALLOC_HOST_PTR`, and stay
+     *           mapped for the lifetime of the object. The consumer can pass
+     *           the front slot directly to `enqueueWriteBuffer`.
+     *
+     *  \tparam T type of the slot elements.
+     */
+    template <typename T>
+    class PinnedTripleBuffer : public TripleBuffer<T>
+    {
+    public:
+        /*! \param[in] _queue command queue used for the mappings.
+         *  \param[in] n number of elements in each slot.
+         */
+        PinnedTripleBuffer (cl::CommandQueue &_queue, size_t n) : queue (_queue)
+        {
+            cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT> ();
+            for (int i = 0; i < 3; ++i)
+            {
+                buffers[i] = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, n * sizeof (T));
+                mapped[i] = (T *) queue.enqueueMapBuffer (
+                    buffers[i], CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, n * sizeof (T));
+            }
+            this->setSlots (mapped[0], mapped[1], mapped[2]);
+        }
+
+        ~PinnedTripleBuffer ()
+        {
+            for (int i = 0; i < 3; ++i)
+                queue.enqueueUnmapMemObject (buffers[i], mapped[i]);
+            queue.finish ();
+        }
+
+    private:
+        cl::CommandQueue queue;
+        cl::Buffer buffers[3];
+        T *mapped[3];
+
+    };
+
+}
+}
+
+#endif  // GF_TRIPLEBUFFER_HPP
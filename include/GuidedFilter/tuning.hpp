@@ -0,0 +1,146 @@
+/*! \file tuning.hpp
+ *  \brief Declares classes that measure, and persist, the best 
+ *         work-group configurations of the kernels on a device.
+ *  \details The `Tuner` benchmarks candidate configurations for the 
+ *           `Scan`, `Transpose` and `BoxFilterSAT` classes, and stores 
+ *           the winners in a `TuningProfile`. The classes look up 
+ *           the profile in their `init` methods.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#ifndef GF_TUNING_HPP
+#define GF_TUNING_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <CLUtils.hpp>
+
+
+/*! \brief Offers classes which set up kernel execution parameters and 
+ *         provide interfaces for the handling of memory objects.
+ */
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \brief Holds the tuned work-group configurations of the kernels.
+     *  \details Entries are keyed by device, class name, and array dimensions. 
+     *           Each entry holds a list of parameters, the meaning of which 
+     *           is defined by the class that owns it:<br>
+     *           | Class | Parameters |
+     *           | ---   |   :---:    |
+     *           | Scan         | \f$ lXdim \f$ |
+     *           | Transpose    | \f$ lSide \f$ |
+     *           | BoxFilterSAT | \f$ lXdim, lYdim \f$ |
+     *  \note The profile is a plain text file with one entry per line, 
+     *        `<device> <class> <width>x<height> <param>...`. Lines 
+     *        starting with `#` are ignored.
+     *  \note There is a single, process-wide, profile. It's loaded lazily, 
+     *        on the first lookup, from the path in the `GF_TUNING_PROFILE` 
+     *        environment variable, or from `guided_filter.tuning` in the 
+     *        working directory. A missing file is an empty profile. 
+     *        The methods are thread-safe.
+     */
+    class TuningProfile
+    {
+    public:
+        /*! \brief Returns the process-wide profile. */
+        static TuningProfile& instance ();
+        /*! \brief Returns a key that identifies a device. */
+        static std::string deviceKey (cl::Device &device);
+        /*! \brief Looks up the parameters for a class on a device. */
+        bool lookup (cl::Device &device, const std::string &name, 
+                     unsigned int width, unsigned int height, std::vector<unsigned int> &params);
+        /*! \brief Stores the parameters for a class on a device. */
+        void store (cl::Device &device, const std::string &name, 
+                    unsigned int width, unsigned int height, const std::vector<unsigned int> &params);
+        /*! \brief Loads the profile from a file. */
+        bool load (const std::string &_path);
+        /*! \brief Saves the profile to a file. */
+        bool save (const std::string &_path = "");
+        /*! \brief Removes all entries. */
+        void clear ();
+        /*! \brief Gets the path of the profile file. */
+        std::string getPath ();
+
+    private:
+        TuningProfile ();
+        TuningProfile (const TuningProfile&);
+        TuningProfile& operator= (const TuningProfile&);
+        bool loadUnlocked (const std::string &_path);
+        std::string key (cl::Device &device, const std::string &name, 
+                         unsigned int width, unsigned int height);
+
+        std::mutex mtx;
+        std::string path;
+        bool loaded;
+        std::map<std::string, std::vector<unsigned int>> entries;
+    };
+
+
+    /*! \brief Benchmarks candidate work-group configurations.
+     *  \details For each class, every configuration that is valid on the device 
+     *           and for the array dimensions is timed (the minimum of `nRepeat` 
+     *           runs is kept), and the fastest one is stored in the `TuningProfile`.
+     *  \note The command queue specified by `_info` has to be created 
+     *        with the `CL_QUEUE_PROFILING_ENABLE` property. The program has to 
+     *        include the `scan`, `transpose` and `boxFilter` kernels.
+     */
+    class Tuner
+    {
+    public:
+        /*! \brief Configures an OpenCL environment as specified by `_info`. */
+        Tuner (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info, unsigned int _nRepeat = 10);
+        /*! \brief Tunes the classes for the `SAT` based `Guided Filter` pipeline. */
+        void tune (unsigned int width, unsigned int height, int radius = 5);
+        /*! \brief Tunes the `Scan` class. */
+        double tuneScan (unsigned int width, unsigned int height);
+        /*! \brief Tunes the `Transpose` class. */
+        double tuneTranspose (unsigned int width, unsigned int height);
+        /*! \brief Tunes the `BoxFilterSAT` class. */
+        double tuneBoxFilterSAT (unsigned int width, unsigned int height, int radius = 5);
+
+    private:
+        template <typename T>
+        double measure (T &algo);
+        double search (const std::string &name, unsigned int width, unsigned int height, 
+                       const std::vector<std::vector<unsigned int>> &candidates, 
+                       const std::function<double ()> &bench);
+
+        clutils::CLEnv &env;
+        clutils::CLEnvInfo<1> info;
+        cl::Device device;
+        unsigned int nRepeat;
+    };
+
+}
+}
+
+#endif  // GF_TUNING_HPP
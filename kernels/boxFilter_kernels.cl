@@ -72,8 +72,6 @@ void boxFilterSAT (global float *sat, global float *out, int radius)
 }
 
 
-#define NUM_BF_STORING_WORK_ITEMS 16 * 16 / 4  // 64
-
 /*! \brief Performs box (mean) filtering.
  *  \details Accepts a transposed SAT array, \f$ sat_{N \times M} \f$, performs 
  *           the filtering, and outputs the result, \f$ out_{M \times N} \f$.
@@ -86,10 +84,11 @@ void boxFilterSAT (global float *sat, global float *out, int radius)
  *        equal to the number of columns, `M`, in the SAT array. That is, 
  *        \f$ \ gXdim = M \f$. The **y** dimension of the global workspace, 
  *        \f$ gYdim \f$, should be equal to the number of rows, `N`, in the SAT
- *        array. That is, \f$ \ gYdim = N \f$. The local workspace should be 
- *        `16x16`. That is, \f$ \ lXdim = lYdim = 16 \f$.
- *  \note Each work-item filters one pixel, and then the first 64 work-items in 
- *        each work-group store a transposed 4 pixel block in global memory.
+ *        array. That is, \f$ \ gYdim = N \f$. The **y** dimension of the local 
+ *        workspace, \f$ lYdim \f$, should be a multiple of 4. `16x16` work-groups 
+ *        are used by default. That is, \f$ \ lXdim = lYdim = 16 \f$.
+ *  \note Each work-item filters one pixel, and then the first \f$ lXdim*lYdim/4 \f$ 
+ *        work-items in each work-group store a transposed 4 pixel block in global memory.
 
  *  \param[in] sat input array of `float` elements.
  *  \param[out] out output (blurred) array of `float` elements.
@@ -136,12 +135,12 @@ void boxFilterSAT_Tr (global float *sat, global float4 *out, local float *data,
     data[idx] = scaling * sum / n;
     barrier (CLK_LOCAL_MEM_FENCE);
 
-    if (idx < NUM_BF_STORING_WORK_ITEMS)
+    if (idx < lXdim * lYdim / 4)
     {
         // Read a transposed float4 element
         //* Elements are processed in column order
-        int iy = idx % 4;
-        int ix = idx / 4;
+        int iy = idx % (lYdim / 4);
+        int ix = idx / (lYdim / 4);
         int base = 4 * iy * lXdim + ix;
         float4 pixels = { data[base], 
                           data[base + lXdim], 
@@ -222,3 +221,286 @@ void boxFilter (global float *in, global float *out, local float *data, int radi
     // Store mean value
     out[gY * gXdim + gX] = sum / n;
 }
+
+
+/*! \brief Performs a one-dimensional min or max filtering pass with the 
+ *         van Herk/Gil-Werman algorithm.
+ *  \details The lines are split in blocks of \f$ k = 2r+1 \f$ elements. With \f$ h \f$ 
+ *           the suffix extrema and \f$ g \f$ the prefix extrema within each block, 
+ *           the extremum of the window centered at \f$ x \f$ is 
+ *           \f$ op (h[x-r], g[x+r]) \f$. A work-item handles the outputs 
+ *           \f$ x \in [jk+r, jk+r+k) \f$, for which \f$ x-r \f$ falls in block 
+ *           \f$ j \f$, and \f$ x+r \f$ in block \f$ j+1 \f$ (or at the end of block 
+ *           \f$ j \f$). It scans block \f$ j \f$ backward, and block \f$ j+1 \f$ 
+ *           forward, so the work is `O(1)` per element, whatever the radius.
+ *  \note The window is clamped at the borders of the line.
+ *
+ *  \param[in] in input array.
+ *  \param[out] out output array.
+ *  \param[in] n number of elements in a line.
+ *  \param[in] lineStride distance between the first elements of consecutive lines.
+ *  \param[in] elemStride distance between consecutive elements of a line.
+ *  \param[in] radius radius of the filter window.
+ *  \param[in] maxOp flag to select a max (instead of a min) filter.
+ */
+inline
+void vanHerkGilWerman (global float *in, global float *out, 
+                       int n, int lineStride, int elemStride, int radius, int maxOp)
+{
+    int line = get_global_id (0);
+    int block = get_global_id (1) - 1;
+
+    int k = 2 * radius + 1;
+    int b0 = block * k;
+    in += line * lineStride;
+    out += line * lineStride;
+    float id = maxOp ? -INFINITY : INFINITY;
+
+    // Suffix extrema of block j, h[x-r], stored in out[x]
+    float acc = id;
+    for (int i = k - 1; i >= 0; --i)
+    {
+        int s = b0 + i;
+        if (s >= 0 && s < n) 
+            acc = maxOp ? fmax (acc, in[s * elemStride]) : fmin (acc, in[s * elemStride]);
+        int x = s + radius;
+        if (x >= 0 && x < n) out[x * elemStride] = acc;
+    }
+
+    // Prefix extrema of block j+1, g[x+r], combined with out[x]
+    acc = id;
+    for (int i = 1; i < k; ++i)
+    {
+        int s = b0 + k + i - 1;
+        if (s < n) 
+            acc = maxOp ? fmax (acc, in[s * elemStride]) : fmin (acc, in[s * elemStride]);
+        int x = b0 + radius + i;
+        if (x >= 0 && x < n) 
+            out[x * elemStride] = maxOp ? fmax (out[x * elemStride], acc) : fmin (out[x * elemStride], acc);
+    }
+}
+
+
+/*! \brief Performs a one-dimensional pass of min filtering.
+ *  \details The work complexity is `O(1)` in the window size (van Herk/Gil-Werman). 
+ *           A square window is filtered with a pass over the rows and a pass over 
+ *           the columns. For more details, look at `vanHerkGilWerman`.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of lines. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to \f$ \lfloor (n+r)/(2r+1) \rfloor + 1 \f$. 
+ *        The local workspace is irrelevant.
+ *  \note For the pass over the rows, `lineStride = N` and `elemStride = 1`. For the 
+ *        pass over the columns, `lineStride = 1` and `elemStride = N`, where `N` is 
+ *        the number of columns. In the latter case, consecutive work-items access 
+ *        consecutive elements.
+ *
+ *  \param[in] in input array of `float` elements.
+ *  \param[out] out output array of `float` elements.
+ *  \param[in] n number of elements in a line.
+ *  \param[in] lineStride distance between the first elements of consecutive lines.
+ *  \param[in] elemStride distance between consecutive elements of a line.
+ *  \param[in] radius radius of the filter window.
+ */
+kernel
+void minFilter (global float *in, global float *out, 
+                int n, int lineStride, int elemStride, int radius)
+{
+    vanHerkGilWerman (in, out, n, lineStride, elemStride, radius, 0);
+}
+
+
+/*! \brief Performs a one-dimensional pass of max filtering.
+ *  \details The work complexity is `O(1)` in the window size (van Herk/Gil-Werman). 
+ *           For more details, look at `minFilter` and `vanHerkGilWerman`.
+ *
+ *  \param[in] in input array of `float` elements.
+ *  \param[out] out output array of `float` elements.
+ *  \param[in] n number of elements in a line.
+ *  \param[in] lineStride distance between the first elements of consecutive lines.
+ *  \param[in] elemStride distance between consecutive elements of a line.
+ *  \param[in] radius radius of the filter window.
+ */
+kernel
+void maxFilter (global float *in, global float *out, 
+                int n, int lineStride, int elemStride, int radius)
+{
+    vanHerkGilWerman (in, out, n, lineStride, elemStride, radius, 1);
+}
+
+
+/*! \brief Performs an inclusive scan along the slices of a volume.
+ *  \details Accepts the summed area tables of the slices of a volume, 
+ *           \f$ D \f$ slices of \f$ M \times N \f$ elements, in the layout 
+ *           produced by `SAT3D`, and turns them, in place, into a summed 
+ *           volume table. That is, \f$ sat[x][z][y] \f$, with \f$ y \f$ being 
+ *           the fastest varying index.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of rows, `M`, in a slice. The **y** dimension of the 
+ *        global workspace, \f$ gYdim \f$, should be equal to the number of columns, 
+ *        `N`, in a slice. The local workspace is irrelevant. Each work-item scans 
+ *        one line of \f$ D \f$ elements, and consecutive work-items access 
+ *        consecutive elements.
+ *
+ *  \param[in,out] sat array of `float` elements.
+ *  \param[in] depth number of slices, `D`, in the volume.
+ */
+kernel
+void scanSlices (global float *sat, int depth)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    global float *line = sat + gY * gXdim * depth + gX;
+
+    float sum = 0.f;
+    for (int z = 0; z < depth; ++z)
+    {
+        sum += line[z * gXdim];
+        line[z * gXdim] = sum;
+    }
+}
+
+
+/*! \brief Reads an element of a summed volume table.
+ *  \details Elements with a negative index are the identity operand, `0`.
+ *
+ *  \param[in] sat summed volume table in the layout produced by `SAT3D`.
+ *  \param[in] c indices of the element, \f$ (x, y, z) \f$.
+ *  \param[in] height number of rows in a slice.
+ *  \param[in] depth number of slices.
+ *  \return The element of the table.
+ */
+inline
+float satVolume (global float *sat, int4 c, int height, int depth)
+{
+    if (c.x < 0 || c.y < 0 || c.z < 0) return 0.f;
+    return sat[(c.x * depth + c.z) * height + c.y];
+}
+
+
+/*! \brief Performs box (mean) filtering on a volume.
+ *  \details Accepts a summed volume table, \f$ sat[x][z][y] \f$, performs the 
+ *           filtering, and outputs the result, \f$ out[z][y][x] \f$, in the 
+ *           usual slice by slice layout. The work complexity is `O(1)` in the 
+ *           window size, 8 table elements per output element.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of rows, `M`, in a slice. The **y** dimension, 
+ *        \f$ gYdim \f$, should be equal to the number of columns, `N`, in a slice. 
+ *        The **z** dimension, \f$ gZdim \f$, should be equal to the number of slices, 
+ *        `D`. The local workspace is irrelevant.
+ *
+ *  \param[in] sat input array of `float` elements.
+ *  \param[out] out output (blurred) array of `float` elements.
+ *  \param[in] radius radius of the window in a slice.
+ *  \param[in] radiusZ radius of the window across the slices.
+ *  \param[in] scaling factor by which to scale the array elements after processing.
+ */
+kernel
+void boxFilterSAT3D (global float *sat, global float *out, int radius, int radiusZ, float scaling)
+{
+    // Workspace dimensions
+    int height = get_global_size (0);
+    int width = get_global_size (1);
+    int depth = get_global_size (2);
+
+    // Workspace indices
+    int y = get_global_id (0);
+    int x = get_global_id (1);
+    int z = get_global_id (2);
+
+    // Filter window coordinates
+    int4 c0 = { x - radius - 1, y - radius - 1, z - radiusZ - 1, 0 };  // Near corner indices
+    int4 c1 = { min (x + radius, width - 1), 
+                min (y + radius, height - 1), 
+                min (z + radiusZ, depth - 1), 0 };                      // Far corner indices
+
+    float sum = 0.f;
+    sum += satVolume (sat, (int4) (c1.x, c1.y, c1.z, 0), height, depth);
+    sum -= satVolume (sat, (int4) (c0.x, c1.y, c1.z, 0), height, depth);
+    sum -= satVolume (sat, (int4) (c1.x, c0.y, c1.z, 0), height, depth);
+    sum -= satVolume (sat, (int4) (c1.x, c1.y, c0.z, 0), height, depth);
+    sum += satVolume (sat, (int4) (c0.x, c0.y, c1.z, 0), height, depth);
+    sum += satVolume (sat, (int4) (c0.x, c1.y, c0.z, 0), height, depth);
+    sum += satVolume (sat, (int4) (c1.x, c0.y, c0.z, 0), height, depth);
+    sum -= satVolume (sat, (int4) (c0.x, c0.y, c0.z, 0), height, depth);
+
+    // Number of elements in the filter window
+    int4 d = c1 - max (c0, -1);
+    float n = d.x * d.y * d.z;
+
+    // Store mean value
+    out[(z * height + y) * width + x] = sum / n * scaling;
+}
+
+
+/*! \brief Pushes a frame in a ring buffer of frames, and updates their mean.
+ *  \details The ring holds the last \f$ T \f$ frames of a stream. The sum of the 
+ *           frames in the ring is updated incrementally, by adding the new frame and 
+ *           subtracting the one it replaces, so the work is `O(1)` per element, 
+ *           whatever the number of frames. Every time the ring wraps around, the sum 
+ *           is computed anew, so the rounding errors don't accumulate over the stream.
+ *  \note `state` holds the slot for the new frame, and the number of frames pushed 
+ *        so far (up to \f$ T \f$). It's advanced by `ringAdvance`, after all the 
+ *        work-items have read it. Both fields should start at `0`.
+ *  \note The global workspace should be one-dimensional, and equal to the number 
+ *        of elements in a frame divided by 4. The local workspace is irrelevant.
+ *
+ *  \param[in] in input frame of `float` elements.
+ *  \param[in,out] ring array of \f$ T \f$ frames.
+ *  \param[in,out] sum sum of the frames in the ring.
+ *  \param[out] mean mean of the frames in the ring.
+ *  \param[in] state slot for the new frame, and number of frames in the ring.
+ *  \param[in] frames number of frames, \f$ T \f$, in the ring.
+ */
+kernel
+void ringUpdate (global float4 *in, global float4 *ring, global float4 *sum, 
+                 global float4 *mean, global uint *state, uint frames)
+{
+    // Workspace dimensions
+    uint n = get_global_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+
+    uint slot = state[0];
+    uint count = min (state[1] + 1, frames);
+
+    float4 x = in[gX];
+    float4 old = ring[slot * n + gX];
+    ring[slot * n + gX] = x;
+
+    float4 s;
+    if (slot == 0)
+    {
+        s = 0.f;
+        for (uint k = 0; k < count; ++k)
+            s += ring[k * n + gX];
+    }
+    else
+    {
+        s = sum[gX] + x;
+        if (state[1] == frames) s -= old;
+    }
+
+    sum[gX] = s;
+    mean[gX] = s / (float) count;
+}
+
+
+/*! \brief Advances the state of a ring buffer of frames.
+ *  \details For more details, look at `ringUpdate`.
+ *  \note The global workspace should be `1`.
+ *
+ *  \param[in,out] state slot for the new frame, and number of frames in the ring.
+ *  \param[in] frames number of frames, \f$ T \f$, in the ring.
+ */
+kernel
+void ringAdvance (global uint *state, uint frames)
+{
+    state[0] = (state[0] + 1) % frames;
+    state[1] = min (state[1] + 1, frames);
+}
@@ -146,3 +146,1042 @@ void gf_ab_Ip (global float4 *var_I, global float4 *cov_Ip,
     a[gX] = a_;
     b[gX] = mean_p[gX] - a_ * mean_I[gX];
 }
+
+
+/*! \brief Computes the regularized variance of the guide in the Guided Filter algorithm.
+ *  \details It's the part of `gf_var_Ip` and `gf_ab_Ip` that depends only on \f$ I \f$. 
+ *           It's computed once, and then used by `gf_ab_shared` for any number 
+ *           of inputs \f$ p \f$ filtered with the same guide.
+ *  \note The global workspace should be one-dimensional. The **x** dimension 
+ *        of the global workspace, \f$ gXdim \f$, should be equal to the 
+ *        number of elements in the arrays, `M x N`, divided by 4. That is, 
+ *        \f$ \ gXdim = M*N/4 \f$. The local workspace is irrelevant.
+ *
+ *  \param[in] corr_I array of average \f$ I*I \f$ values in the local windows.
+ *  \param[in] mean_I array of average \f$ I \f$ values in the local windows.
+ *  \param[out] var_I array of variance values for \f$ I \f$ in the local windows, 
+ *                    with the regularization parameter added, \f$ \sigma_I^2+\epsilon \f$.
+ *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+ */
+kernel
+void gf_var_I (global float4 *corr_I, global float4 *mean_I, 
+               global float4 *var_I, float eps)
+{
+    int gX = get_global_id (0);
+    
+    float4 m_I = mean_I[gX];
+
+    var_I[gX] = corr_I[gX] - m_I * m_I + eps;
+}
+
+
+/*! \brief Computes the `a` and `b` coefficients in the Guided Filter algorithm, 
+ *         given the regularized variance of the guide.
+ *  \details It fuses the covariance of `gf_var_Ip` with `gf_ab_Ip`, 
+ *           since the variance comes from `gf_var_I`.
+ *  \note The global workspace should be one-dimensional. The **x** dimension 
+ *        of the global workspace, \f$ gXdim \f$, should be equal to the 
+ *        number of elements in the arrays, `M x N`, divided by 4. That is, 
+ *        \f$ \ gXdim = M*N/4 \f$. The local workspace is irrelevant.
+ *
+ *  \param[in] var_I array of variance values for \f$ I \f$ in the local windows, 
+ *                   with the regularization parameter added.
+ *  \param[in] corr_Ip array of average \f$ I*p \f$ values in the local windows.
+ *  \param[in] mean_I array of average \f$ I \f$ values in the local windows.
+ *  \param[in] mean_p array of average \f$ p \f$ values in the local windows.
+ *  \param[out] a array of \f$ a \f$ coefficients for the local models.
+ *  \param[out] b array of \f$ b \f$ coefficients for the local models.
+ */
+kernel
+void gf_ab_shared (global float4 *var_I, global float4 *corr_Ip, 
+                   global float4 *mean_I, global float4 *mean_p, 
+                   global float4 *a, global float4 *b)
+{
+    int gX = get_global_id (0);
+    
+    float4 m_I = mean_I[gX];
+    float4 m_p = mean_p[gX];
+    float4 a_ = (corr_Ip[gX] - m_I * m_p) / var_I[gX];
+    
+    a[gX] = a_;
+    b[gX] = m_p - a_ * m_I;
+}
+
+
+/*! \brief Returns the number of pixels in a filter window that fall within the image.
+ *
+ *  \param[in] x column of the window center.
+ *  \param[in] y row of the window center.
+ *  \param[in] width number of columns in the image.
+ *  \param[in] height number of rows in the image.
+ *  \param[in] radius radius of the square filter window.
+ *  \return The number of pixels in the clamped window.
+ */
+inline
+float gf_windowSize (int x, int y, int width, int height, int radius)
+{
+    int dx = min (x + radius, width - 1) - max (x - radius, 0) + 1;
+    int dy = min (y + radius, height - 1) - max (y - radius, 0) + 1;
+
+    return dx * dy;
+}
+
+
+/*! \brief Performs the whole Guided Filter algorithm, for the case \f$ I == p \f$, 
+ *         in a single pass.
+ *  \details Each work-group loads a tile of \f$ p \f$ with a \f$ 2r \f$ halo 
+ *           in local memory. It computes \f$ mean_p, mean_{p^2} \f$ with separable 
+ *           box filters and the \f$ a, b \f$ coefficients over the tile plus 
+ *           an \f$ r \f$ halo. It then box filters those, and outputs \f$ q \f$. 
+ *           \f$ p \f$ is read, and \f$ q \f$ is written, only once. There are 
+ *           no intermediate arrays in global memory.
+ *  \note Filter windows are clamped at the image borders, which is the same 
+ *        as what `boxFilterSAT` does.
+ *  \note The work complexity is `O(r)` in the window size, so the kernel 
+ *        is meant for small radii, \f$ r \leq 8 \f$.
+ *  \note The global workspace should be two-dimensional. The **x** dimension 
+ *        of the global workspace, \f$ gXdim \f$, should be equal to the number 
+ *        of columns, `N`, in the image. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to the number of rows, `M`, in the image. 
+ *        The local workspace should be square, \f$ lXdim = lYdim = T \f$, and 
+ *        both image dimensions should be **multiples of** \f$ T \f$.
+ *
+ *  \param[in] p input array \f$ p \f$.
+ *  \param[out] q output array \f$ q \f$.
+ *  \param[in] data local buffer. Its size should be 
+ *                  \f$ [(T+4r)^2+2(T+4r)(T+2r)+2(T+2r)^2]*sizeof\ (float) \f$.
+ *  \param[in] radius radius of the square filter window.
+ *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+ *  \param[in] zero_out flag to indicate whether to zero out invalid pixels. 
+ *                      For more information, look at `gf_q`'s documentation.
+ *  \param[in] scaling factor by which to scale the pixel values in the output array.
+ */
+kernel
+void gf_fused (global float *p, global float *q, local float *data, 
+               int radius, float eps, int zero_out, float scaling)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+    int gYdim = get_global_size (1);
+    int lXdim = get_local_size (0);
+    int lYdim = get_local_size (1);
+    int lSize = lXdim * lYdim;
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+    int lX = get_local_id (0);
+    int lY = get_local_id (1);
+    int lIdx = lY * lXdim + lX;
+    int wgX = get_group_id (0) * lXdim;
+    int wgY = get_group_id (1) * lYdim;
+
+    // Region dimensions (p region: tile + 2r halo, ab region: tile + r halo)
+    int pWidth = lXdim + 4 * radius, pHeight = lYdim + 4 * radius;
+    int mWidth = lXdim + 2 * radius, mHeight = lYdim + 2 * radius;
+
+    local float *l_p = data;
+    local float *h_0 = l_p + pWidth * pHeight;
+    local float *h_1 = h_0 + pHeight * mWidth;
+    local float *l_a = h_1 + pHeight * mWidth;
+    local float *l_b = l_a + mWidth * mHeight;
+
+    // Load p in local memory (zero outside the image)
+    for (int i = lIdx; i < pWidth * pHeight; i += lSize)
+    {
+        int ix = wgX - 2 * radius + i % pWidth;
+        int iy = wgY - 2 * radius + i / pWidth;
+        bool in = (ix >= 0 && iy >= 0 && ix < gXdim && iy < gYdim);
+        l_p[i] = in ? p[iy * gXdim + ix] : 0.f;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Horizontal sums of p, p^2
+    for (int i = lIdx; i < pHeight * mWidth; i += lSize)
+    {
+        int y = i / mWidth, x = i % mWidth;
+        float s = 0.f, s2 = 0.f;
+        for (int k = 0; k <= 2 * radius; ++k)
+        {
+            float v = l_p[y * pWidth + x + k];
+            s += v; s2 += v * v;
+        }
+        h_0[i] = s; h_1[i] = s2;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Vertical sums of p, p^2, and a, b coefficients (zero outside the image)
+    for (int i = lIdx; i < mWidth * mHeight; i += lSize)
+    {
+        int y = i / mWidth, x = i % mWidth;
+        float s = 0.f, s2 = 0.f;
+        for (int k = 0; k <= 2 * radius; ++k)
+        {
+            s += h_0[(y + k) * mWidth + x];
+            s2 += h_1[(y + k) * mWidth + x];
+        }
+
+        int ix = wgX - radius + x;
+        int iy = wgY - radius + y;
+        bool in = (ix >= 0 && iy >= 0 && ix < gXdim && iy < gYdim);
+        float n = gf_windowSize (ix, iy, gXdim, gYdim, radius);
+
+        float m_p = s / n;
+        float var_p = s2 / n - m_p * m_p;
+        float a_ = var_p / (var_p + eps);
+        l_a[i] = in ? a_ : 0.f;
+        l_b[i] = in ? (1.f - a_) * m_p : 0.f;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Horizontal sums of a, b
+    for (int i = lIdx; i < mHeight * lXdim; i += lSize)
+    {
+        int y = i / lXdim, x = i % lXdim;
+        float sa = 0.f, sb = 0.f;
+        for (int k = 0; k <= 2 * radius; ++k)
+        {
+            sa += l_a[y * mWidth + x + k];
+            sb += l_b[y * mWidth + x + k];
+        }
+        h_0[i] = sa; h_1[i] = sb;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Vertical sums of a, b, and q
+    float sa = 0.f, sb = 0.f;
+    for (int k = 0; k <= 2 * radius; ++k)
+    {
+        sa += h_0[(lY + k) * lXdim + lX];
+        sb += h_1[(lY + k) * lXdim + lX];
+    }
+    float n = gf_windowSize (gX, gY, gXdim, gYdim, radius);
+
+    float p_ = l_p[(lY + 2 * radius) * pWidth + lX + 2 * radius];
+    float q_ = (sa * p_ + sb) / n;
+
+    q[gY * gXdim + gX] = (zero_out && p_ == 0.f) ? 0.f : scaling * q_;
+}
+
+
+/*! \brief Performs the whole Guided Filter algorithm, for the case \f$ I \neq p \f$, 
+ *         in a single pass.
+ *  \details Each work-group loads a tile of \f$ I, p \f$ with a \f$ 2r \f$ halo 
+ *           in local memory. It computes \f$ mean_I, mean_p, corr_I, corr_{Ip} \f$ 
+ *           with separable box filters and the \f$ a, b \f$ coefficients over the 
+ *           tile plus an \f$ r \f$ halo. It then box filters those, and outputs 
+ *           \f$ q \f$. \f$ I, p \f$ are read, and \f$ q \f$ is written, only once. 
+ *           There are no intermediate arrays in global memory.
+ *  \note Filter windows are clamped at the image borders, which is the same 
+ *        as what `boxFilterSAT` does.
+ *  \note The work complexity is `O(r)` in the window size, so the kernel 
+ *        is meant for small radii, \f$ r \leq 8 \f$.
+ *  \note The global workspace should be two-dimensional. The **x** dimension 
+ *        of the global workspace, \f$ gXdim \f$, should be equal to the number 
+ *        of columns, `N`, in the image. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to the number of rows, `M`, in the image. 
+ *        The local workspace should be square, \f$ lXdim = lYdim = T \f$, and 
+ *        both image dimensions should be **multiples of** \f$ T \f$.
+ *
+ *  \param[in] I guidance array \f$ I \f$.
+ *  \param[in] p input array \f$ p \f$.
+ *  \param[out] q output array \f$ q \f$.
+ *  \param[in] data local buffer. Its size should be 
+ *                  \f$ [2(T+4r)^2+4(T+4r)(T+2r)+2(T+2r)^2]*sizeof\ (float) \f$.
+ *  \param[in] radius radius of the square filter window.
+ *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+ *  \param[in] zero_out flag to indicate whether to zero out the pixels in 
+ *                      \f$ q \f$ that are zero in \f$ I \f$.
+ *  \param[in] scaling factor by which to scale the pixel values in the output array.
+ */
+kernel
+void gf_fused_Ip (global float *I, global float *p, global float *q, local float *data, 
+                  int radius, float eps, int zero_out, float scaling)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+    int gYdim = get_global_size (1);
+    int lXdim = get_local_size (0);
+    int lYdim = get_local_size (1);
+    int lSize = lXdim * lYdim;
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+    int lX = get_local_id (0);
+    int lY = get_local_id (1);
+    int lIdx = lY * lXdim + lX;
+    int wgX = get_group_id (0) * lXdim;
+    int wgY = get_group_id (1) * lYdim;
+
+    // Region dimensions (I,p region: tile + 2r halo, ab region: tile + r halo)
+    int pWidth = lXdim + 4 * radius, pHeight = lYdim + 4 * radius;
+    int mWidth = lXdim + 2 * radius, mHeight = lYdim + 2 * radius;
+
+    local float *l_I = data;
+    local float *l_p = l_I + pWidth * pHeight;
+    local float *h_0 = l_p + pWidth * pHeight;
+    local float *h_1 = h_0 + pHeight * mWidth;
+    local float *h_2 = h_1 + pHeight * mWidth;
+    local float *h_3 = h_2 + pHeight * mWidth;
+    local float *l_a = h_3 + pHeight * mWidth;
+    local float *l_b = l_a + mWidth * mHeight;
+
+    // Load I, p in local memory (zero outside the image)
+    for (int i = lIdx; i < pWidth * pHeight; i += lSize)
+    {
+        int ix = wgX - 2 * radius + i % pWidth;
+        int iy = wgY - 2 * radius + i / pWidth;
+        bool in = (ix >= 0 && iy >= 0 && ix < gXdim && iy < gYdim);
+        l_I[i] = in ? I[iy * gXdim + ix] : 0.f;
+        l_p[i] = in ? p[iy * gXdim + ix] : 0.f;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Horizontal sums of I, p, I*I, I*p
+    for (int i = lIdx; i < pHeight * mWidth; i += lSize)
+    {
+        int y = i / mWidth, x = i % mWidth;
+        float sI = 0.f, sp = 0.f, sII = 0.f, sIp = 0.f;
+        for (int k = 0; k <= 2 * radius; ++k)
+        {
+            float vI = l_I[y * pWidth + x + k];
+            float vp = l_p[y * pWidth + x + k];
+            sI += vI; sp += vp; sII += vI * vI; sIp += vI * vp;
+        }
+        h_0[i] = sI; h_1[i] = sp; h_2[i] = sII; h_3[i] = sIp;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Vertical sums of I, p, I*I, I*p, and a, b coefficients (zero outside the image)
+    for (int i = lIdx; i < mWidth * mHeight; i += lSize)
+    {
+        int y = i / mWidth, x = i % mWidth;
+        float sI = 0.f, sp = 0.f, sII = 0.f, sIp = 0.f;
+        for (int k = 0; k <= 2 * radius; ++k)
+        {
+            int idx = (y + k) * mWidth + x;
+            sI += h_0[idx]; sp += h_1[idx]; sII += h_2[idx]; sIp += h_3[idx];
+        }
+
+        int ix = wgX - radius + x;
+        int iy = wgY - radius + y;
+        bool in = (ix >= 0 && iy >= 0 && ix < gXdim && iy < gYdim);
+        float n = gf_windowSize (ix, iy, gXdim, gYdim, radius);
+
+        float m_I = sI / n, m_p = sp / n;
+        float var_I = sII / n - m_I * m_I;
+        float cov_Ip = sIp / n - m_I * m_p;
+        float a_ = cov_Ip / (var_I + eps);
+        l_a[i] = in ? a_ : 0.f;
+        l_b[i] = in ? m_p - a_ * m_I : 0.f;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Horizontal sums of a, b
+    for (int i = lIdx; i < mHeight * lXdim; i += lSize)
+    {
+        int y = i / lXdim, x = i % lXdim;
+        float sa = 0.f, sb = 0.f;
+        for (int k = 0; k <= 2 * radius; ++k)
+        {
+            sa += l_a[y * mWidth + x + k];
+            sb += l_b[y * mWidth + x + k];
+        }
+        h_0[i] = sa; h_1[i] = sb;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Vertical sums of a, b, and q
+    float sa = 0.f, sb = 0.f;
+    for (int k = 0; k <= 2 * radius; ++k)
+    {
+        sa += h_0[(lY + k) * lXdim + lX];
+        sb += h_1[(lY + k) * lXdim + lX];
+    }
+    float n = gf_windowSize (gX, gY, gXdim, gYdim, radius);
+
+    float I_ = l_I[(lY + 2 * radius) * pWidth + lX + 2 * radius];
+    float q_ = (sa * I_ + sb) / n;
+
+    q[gY * gXdim + gX] = (zero_out && I_ == 0.f) ? 0.f : scaling * q_;
+}
+
+
+/*! \brief Downsamples an image by averaging `factor x factor` blocks of pixels.
+ *  \details It's used by guided upsampling to bring the guidance image 
+ *           to the resolution of the input image.
+ *  \note The global workspace should be two-dimensional and equal to the 
+ *        dimensions of the **output** (downsampled) image.
+ *
+ *  \param[in] in input (high-resolution) image.
+ *  \param[out] out output (low-resolution) image.
+ *  \param[in] factor downsampling factor.
+ */
+kernel
+void gf_downsample (global float *in, global float *out, uint factor)
+{
+    // Workspace dimensions
+    uint cols = get_global_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint gY = get_global_id (1);
+
+    uint inCols = cols * factor;
+    global float *block = in + gY * factor * inCols + gX * factor;
+
+    float sum = 0.f;
+    for (uint y = 0; y < factor; ++y)
+        for (uint x = 0; x < factor; ++x)
+            sum += block[y * inCols + x];
+
+    out[gY * cols + gX] = sum / (factor * factor);
+}
+
+
+/*! \brief Computes the output in guided upsampling.
+ *  \details The average coefficients \f$ \bar{a}, \bar{b} \f$, computed at the low 
+ *           resolution, are upsampled bilinearly (pixel centers are aligned, and the 
+ *           samples are clamped at the borders), and the output is 
+ *           \f$ q = \bar{a} I + \bar{b} \f$ at the resolution of the guidance image.
+ *  \note The global workspace should be two-dimensional and equal to the 
+ *        dimensions of the (high-resolution) guidance image.
+ *
+ *  \param[in] I guidance (high-resolution) array \f$ I \f$.
+ *  \param[in] mean_a array of average \f$ a \f$ values (low resolution).
+ *  \param[in] mean_b array of average \f$ b \f$ values (low resolution).
+ *  \param[in] p input (low-resolution) array \f$ p \f$.
+ *  \param[out] q output (high-resolution) array \f$ q \f$.
+ *  \param[in] factor upsampling factor.
+ *  \param[in] zero_out flag to indicate whether to zero out the pixels 
+ *                      in \f$ q \f$ whose nearest pixel in \f$ p \f$ is zero.
+ *  \param[in] scaling factor by which to scale the pixel values in the output array.
+ */
+kernel
+void gf_q_upsample (global float *I, global float *mean_a, global float *mean_b, 
+                    global float *p, global float *q, uint factor, int zero_out, float scaling)
+{
+    // Workspace dimensions
+    int cols = get_global_size (0);
+    int rows = get_global_size (1);
+    int lCols = cols / factor;
+    int lRows = rows / factor;
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    // Sampling position in the low resolution grid
+    float u = clamp ((gX + 0.5f) / factor - 0.5f, 0.f, (float) (lCols - 1));
+    float v = clamp ((gY + 0.5f) / factor - 0.5f, 0.f, (float) (lRows - 1));
+    int x0 = (int) u, y0 = (int) v;
+    int x1 = min (x0 + 1, lCols - 1), y1 = min (y0 + 1, lRows - 1);
+    float fx = u - x0, fy = v - y0;
+
+    float a_ = mix (mix (mean_a[y0 * lCols + x0], mean_a[y0 * lCols + x1], fx), 
+                    mix (mean_a[y1 * lCols + x0], mean_a[y1 * lCols + x1], fx), fy);
+    float b_ = mix (mix (mean_b[y0 * lCols + x0], mean_b[y0 * lCols + x1], fx), 
+                    mix (mean_b[y1 * lCols + x0], mean_b[y1 * lCols + x1], fx), fy);
+
+    float p_ = p[(gY / factor) * lCols + gX / factor];
+    float q_ = a_ * I[gY * cols + gX] + b_;
+
+    q[gY * cols + gX] = (zero_out && p_ == 0.f) ? 0.f : scaling * q_;
+}
+
+
+/*! \brief Feeds the output of an iteration back as the guide of the next one.
+ *  \details Copies \f$ q \f$ to the guide, and computes the maximum absolute 
+ *           change of the guide, \f$ max |q - I| \f$. The change is reduced in 
+ *           each work-group, and the work-groups combine their results with 
+ *           an atomic maximum on the bit patterns of the (non-negative) values.
+ *  \details When a tolerance is given, the iterations stop on the device. Once the 
+ *           change of the previous iteration is within the tolerance, the `done` element 
+ *           is set to `slot`, and from then on, the kernel only copies the guide back to 
+ *           \f$ q \f$, so that \f$ q \f$ keeps the output of the converged iteration.
+ *  \note The global workspace should be one-dimensional and a multiple of the 
+ *        local workspace, which should be a power of 2. The first `n` work-items 
+ *        process the arrays, where `n` is the number of elements divided by 4.
+ *  \note The residual slots, and the `done` element, have to be zeroed before 
+ *        the first kernel executes.
+ *
+ *  \param[in,out] q output array \f$ q \f$ of the iteration.
+ *  \param[in,out] I guidance array \f$ I \f$, which is overwritten by \f$ q \f$.
+ *  \param[in,out] residuals array of the changes (`float` bit patterns) of all iterations, 
+ *                           followed by the `done` element.
+ *  \param[in] slot index of the element of `residuals` to update.
+ *  \param[in] done index of the element of `residuals` that keeps the slot at which 
+ *                  the iterations stopped (`0` while they are still running).
+ *  \param[in] tolerance tolerance on the change of the guide. If it's not positive, 
+ *                       the iterations never stop.
+ *  \param[in] n number of elements in the arrays divided by 4.
+ *  \param[in] data local buffer with size `(# work-items in work-group) x sizeof (float)` bytes.
+ */
+kernel
+void gf_feedback (global float4 *q, global float4 *I, global uint *residuals, 
+                  uint slot, uint done, float tolerance, uint n, local float *data)
+{
+    // Workspace dimensions
+    uint lXdim = get_local_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint lX = get_local_id (0);
+
+    // The decision is the same for all work-items, 
+    // so the early return doesn't split any work-group
+    bool stop = residuals[done] != 0u || 
+        (tolerance > 0.f && slot > 1u && as_float (residuals[slot - 1u]) <= tolerance);
+    if (stop)
+    {
+        if (gX < n) q[gX] = I[gX];
+        if (gX == 0 && residuals[done] == 0u) residuals[done] = slot;
+        return;
+    }
+
+    float change = 0.f;
+    if (gX < n)
+    {
+        float4 q_ = q[gX];
+        float4 d = fabs (q_ - I[gX]);
+        change = fmax (fmax (d.x, d.y), fmax (d.z, d.w));
+        I[gX] = q_;
+    }
+    data[lX] = change;
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Reduce the changes in the work-group
+    for (uint s = lXdim >> 1; s > 0; s >>= 1)
+    {
+        if (lX < s) data[lX] = fmax (data[lX], data[lX + s]);
+        barrier (CLK_LOCAL_MEM_FENCE);
+    }
+
+    // Non-negative floats are ordered like their bit patterns
+    if (lX == 0) atomic_max (&residuals[slot], as_uint (data[0]));
+}
+
+
+/*! \brief Returns the floor \f$ \delta \f$ added to the luminance before taking its logarithm.
+ *
+ *  \return The floor \f$ \delta \f$.
+ */
+inline
+float gf_lumFloor ()
+{
+    return 1.f / 1024.f;
+}
+
+
+/*! \brief Computes the normalized log-luminance of an `RGB` image, and its square.
+ *  \details The luminance is \f$ Y = 0.299R + 0.587G + 0.114B \f$, and its normalized 
+ *           logarithm is \f$ l = log (1 + Y / \delta) / log (1 + 1 / \delta) \f$, 
+ *           which maps \f$ Y \in [0, 1] \f$ to \f$ l \in [0, 1] \f$. 
+ *           \f$ Y > 1 \f$ (high dynamic range) maps to \f$ l > 1 \f$.
+ *  \note The global workspace should be one-dimensional and equal to 
+ *        the number of pixels. The local workspace is irrelevant.
+ *
+ *  \param[in] rgb input array of interleaved `RGB` values.
+ *  \param[out] l array of \f$ l \f$ values.
+ *  \param[out] l2 array of \f$ l^2 \f$ values.
+ */
+kernel
+void gf_logLuminance (global float *rgb, global float *l, global float *l2)
+{
+    uint gX = get_global_id (0);
+
+    float3 c = vload3 (gX, rgb);
+    float Y = dot (c, (float3) (0.299f, 0.587f, 0.114f));
+    float l_ = log1p (fmax (Y, 0.f) / gf_lumFloor ()) / log1p (1.f / gf_lumFloor ());
+
+    l[gX] = l_;
+    l2[gX] = l_ * l_;
+}
+
+
+/*! \brief Recombines the base and detail layers of a multi-scale decomposition, 
+ *         and tone-maps the result to `uchar` `RGB` values.
+ *  \details The base layer of scale \f$ k \f$ is \f$ B_k = \bar{a}_k l + \bar{b}_k \f$ 
+ *           (the guided filter output with radius \f$ r_k \f$), and its detail layer is 
+ *           \f$ D_k = B_{k-1} - B_k \f$, with \f$ B_{-1} = l \f$. The output 
+ *           log-luminance is \f$ l' = anchor + compression * (B_{K-1} - anchor) + 
+ *           \sum_k boost_k D_k \f$. The colors are scaled by the change in luminance, 
+ *           and by the exposure, and are gamma encoded, 
+ *           \f$ out = 255 * clamp (exposure * \frac{Y' + \delta}{Y + \delta} * rgb, 0, 1)^{1/\gamma} \f$.
+ *  \note The global workspace should be one-dimensional and equal to 
+ *        the number of pixels. The local workspace is irrelevant.
+ *  \note There can be up to 4 scales. The coefficient arrays of unused scales are ignored.
+ *
+ *  \param[in] rgb input array of interleaved `RGB` values.
+ *  \param[in] l array of normalized log-luminance values \f$ l \f$.
+ *  \param[in] ma0 array of average \f$ a \f$ values of scale 0.
+ *  \param[in] mb0 array of average \f$ b \f$ values of scale 0.
+ *  \param[in] ma1 array of average \f$ a \f$ values of scale 1.
+ *  \param[in] mb1 array of average \f$ b \f$ values of scale 1.
+ *  \param[in] ma2 array of average \f$ a \f$ values of scale 2.
+ *  \param[in] mb2 array of average \f$ b \f$ values of scale 2.
+ *  \param[in] ma3 array of average \f$ a \f$ values of scale 3.
+ *  \param[in] mb3 array of average \f$ b \f$ values of scale 3.
+ *  \param[out] out output array of interleaved `uchar` `RGB` values.
+ *  \param[in] scales number of scales.
+ *  \param[in] boost boost factors of the detail layers.
+ *  \param[in] compression factor by which to scale the (coarsest) base layer.
+ *  \param[in] anchor log-luminance that the compression maps to itself.
+ *  \param[in] exposure factor by which to scale the colors.
+ *  \param[in] invGamma inverse of the gamma \f$ \gamma \f$ of the encoding.
+ */
+kernel
+void gf_detailCombine (global float *rgb, global float *l, 
+                       global float *ma0, global float *mb0, global float *ma1, global float *mb1, 
+                       global float *ma2, global float *mb2, global float *ma3, global float *mb3, 
+                       global uchar *out, uint scales, float4 boost, 
+                       float compression, float anchor, float exposure, float invGamma)
+{
+    uint gX = get_global_id (0);
+
+    global float *ma[4] = { ma0, ma1, ma2, ma3 };
+    global float *mb[4] = { mb0, mb1, mb2, mb3 };
+    float boost_[4] = { boost.x, boost.y, boost.z, boost.w };
+
+    float l_ = l[gX];
+    float base = l_, detail = 0.f;
+    for (uint k = 0; k < scales; ++k)
+    {
+        float b_ = ma[k][gX] * l_ + mb[k][gX];
+        detail += boost_[k] * (base - b_);
+        base = b_;
+    }
+    float lOut = anchor + compression * (base - anchor) + detail;
+
+    // Ratio of the output to the input luminance (both offset by the floor)
+    float ratio = exp ((lOut - l_) * log1p (1.f / gf_lumFloor ()));
+
+    float3 c = clamp (exposure * ratio * vload3 (gX, rgb), 0.f, 1.f);
+    c = 255.f * pow (c, invGamma);
+
+    vstore3 (convert_uchar3_sat_rte (c), gX, out);
+}
+
+
+/*! \brief Prepares an `RGB` image for dehazing.
+ *  \details Computes the minimum of the color channels of every pixel (the input 
+ *           of the dark channel), and the luminance \f$ Y = 0.299R + 0.587G + 0.114B \f$ 
+ *           (the guide of the transmission refinement).
+ *  \note The global workspace should be one-dimensional and equal to 
+ *        the number of pixels. The local workspace is irrelevant.
+ *
+ *  \param[in] rgb input array of interleaved `RGB` values.
+ *  \param[out] minRGB array of the minimum channel values.
+ *  \param[out] gray array of luminance values.
+ */
+kernel
+void gf_dehazePrepare (global float *rgb, global float *minRGB, global float *gray)
+{
+    uint gX = get_global_id (0);
+
+    float3 c = vload3 (gX, rgb);
+
+    minRGB[gX] = fmin (c.x, fmin (c.y, c.z));
+    gray[gX] = dot (c, (float3) (0.299f, 0.587f, 0.114f));
+}
+
+
+/*! \brief Returns the bin of a dark channel value in the `256` bin histogram over \f$ [0, 1] \f$.
+ *
+ *  \param[in] v dark channel value.
+ *  \return The histogram bin.
+ */
+inline
+uint gf_darkBin (float v)
+{
+    return (uint) clamp (v * 256.f, 0.f, 255.f);
+}
+
+
+/*! \brief Computes the histogram of the dark channel.
+ *  \details Every work-group builds a `256` bin histogram in local memory, 
+ *           and adds it to the global one.
+ *  \note The global workspace should be one-dimensional and a multiple of the 
+ *        local workspace. The first `n` work-items process the array.
+ *  \note The histogram has to be zeroed before the kernel executes.
+ *
+ *  \param[in] dark array of dark channel values.
+ *  \param[in,out] hist histogram with `256` bins.
+ *  \param[in] n number of elements in the array.
+ *  \param[in] lHist local buffer with size `256 x sizeof (uint)` bytes.
+ */
+kernel
+void gf_dehazeHistogram (global float *dark, global uint *hist, uint n, local uint *lHist)
+{
+    // Workspace dimensions
+    uint lXdim = get_local_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint lX = get_local_id (0);
+
+    for (uint b = lX; b < 256; b += lXdim)
+        lHist[b] = 0;
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    if (gX < n) atomic_inc (&lHist[gf_darkBin (dark[gX])]);
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    for (uint b = lX; b < 256; b += lXdim)
+        if (lHist[b]) atomic_add (&hist[b], lHist[b]);
+}
+
+
+/*! \brief Sums the colors of the haziest pixels, per work-group.
+ *  \details The haziest pixels are those in the highest bins of the dark channel 
+ *           histogram that hold at least `top` pixels. Every work-group finds the 
+ *           threshold bin, and reduces the colors (and the count) of its candidates.
+ *  \note The global workspace should be one-dimensional and a multiple of the 
+ *        local workspace, which should be a power of 2. The first `n` work-items 
+ *        process the arrays.
+ *
+ *  \param[in] rgb input array of interleaved `RGB` values.
+ *  \param[in] dark array of dark channel values.
+ *  \param[in] hist histogram of the dark channel with `256` bins.
+ *  \param[out] sums array of per work-group sums, \f$ (R, G, B, count) \f$.
+ *  \param[in] n number of pixels.
+ *  \param[in] top minimum number of candidate pixels.
+ *  \param[in] data local buffer with size `(# work-items in work-group) x sizeof (float4)` bytes.
+ */
+kernel
+void gf_dehazeLightSums (global float *rgb, global float *dark, global uint *hist, 
+                         global float4 *sums, uint n, uint top, local float4 *data)
+{
+    // Workspace dimensions
+    uint lXdim = get_local_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint lX = get_local_id (0);
+
+    // Find the threshold bin
+    local uint threshold;
+    if (lX == 0)
+    {
+        uint count = 0, b = 255;
+        for ( ; b > 0; --b)
+        {
+            count += hist[b];
+            if (count >= top) break;
+        }
+        threshold = b;
+    }
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    float4 s = 0.f;
+    if (gX < n && gf_darkBin (dark[gX]) >= threshold)
+        s = (float4) (vload3 (gX, rgb), 1.f);
+    data[lX] = s;
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Reduce the sums in the work-group
+    for (uint k = lXdim >> 1; k > 0; k >>= 1)
+    {
+        if (lX < k) data[lX] += data[lX + k];
+        barrier (CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (lX == 0) sums[get_group_id (0)] = data[0];
+}
+
+
+/*! \brief Computes the atmospheric light as the mean color of the haziest pixels.
+ *  \details Reduces the per work-group sums of `gf_dehazeLightSums`. It's the last 
+ *           kernel that reads the dark channel histogram, so it also zeroes it 
+ *           for the next frame.
+ *  \note The kernel should be executed by a single work-group, 
+ *        with a power of 2 number of work-items.
+ *
+ *  \param[in] sums array of per work-group sums, \f$ (R, G, B, count) \f$.
+ *  \param[in] groups number of elements in `sums`.
+ *  \param[out] light atmospheric light \f$ A \f$, \f$ (R, G, B, 0) \f$.
+ *  \param[out] hist histogram of the dark channel with `256` bins, which is zeroed.
+ *  \param[in] data local buffer with size `(# work-items in work-group) x sizeof (float4)` bytes.
+ */
+kernel
+void gf_dehazeLight (global float4 *sums, uint groups, global float4 *light, 
+                     global uint *hist, local float4 *data)
+{
+    // Workspace dimensions
+    uint lXdim = get_local_size (0);
+
+    // Workspace indices
+    uint lX = get_local_id (0);
+
+    float4 s = 0.f;
+    for (uint i = lX; i < groups; i += lXdim)
+        s += sums[i];
+    data[lX] = s;
+
+    for (uint b = lX; b < 256; b += lXdim)
+        hist[b] = 0;
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Reduce the sums in the work-group
+    for (uint k = lXdim >> 1; k > 0; k >>= 1)
+    {
+        if (lX < k) data[lX] += data[lX + k];
+        barrier (CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (lX == 0)
+    {
+        float4 total = data[0];
+        float3 A = fmax (total.xyz / fmax (total.w, 1.f), 1e-3f);
+        light[0] = (float4) (A, 0.f);
+    }
+}
+
+
+/*! \brief Computes the per pixel (unfiltered) transmission estimate.
+ *  \details Computes \f$ 1 - \omega\ min_c (I_c / A_c) \f$. A max filter over the 
+ *           window then gives the transmission estimate of the dark channel prior, 
+ *           \f$ \tilde{t} = 1 - \omega\ min_{\Omega} min_c (I_c / A_c) \f$.
+ *  \note The global workspace should be one-dimensional and equal to 
+ *        the number of pixels. The local workspace is irrelevant.
+ *
+ *  \param[in] rgb input array of interleaved `RGB` values.
+ *  \param[in] light atmospheric light \f$ A \f$.
+ *  \param[out] t array of transmission values.
+ *  \param[in] omega fraction of the haze to remove, \f$ \omega \f$.
+ */
+kernel
+void gf_dehazeTransmission (global float *rgb, global float4 *light, global float *t, float omega)
+{
+    uint gX = get_global_id (0);
+
+    float3 c = vload3 (gX, rgb) / light[0].xyz;
+
+    t[gX] = 1.f - omega * fmin (c.x, fmin (c.y, c.z));
+}
+
+
+/*! \brief Recovers the scene radiance.
+ *  \details Computes \f$ J = (I - A) / max (t, t_0) + A \f$, clamped to \f$ [0, 1] \f$.
+ *  \note The global workspace should be one-dimensional and equal to 
+ *        the number of pixels. The local workspace is irrelevant.
+ *
+ *  \param[in] rgb input array of interleaved `RGB` values.
+ *  \param[in] light atmospheric light \f$ A \f$.
+ *  \param[in] t array of (refined) transmission values.
+ *  \param[out] out output array of interleaved `RGB` values.
+ *  \param[in] t0 lower bound of the transmission, \f$ t_0 \f$.
+ */
+kernel
+void gf_dehazeRecover (global float *rgb, global float4 *light, global float *t, 
+                       global float *out, float t0)
+{
+    uint gX = get_global_id (0);
+
+    float3 A = light[0].xyz;
+    float3 J = (vload3 (gX, rgb) - A) / fmax (t[gX], t0) + A;
+
+    vstore3 (clamp (J, 0.f, 1.f), gX, out);
+}
+
+
+/*! \brief Computes the row sums of the pixel values, and of their squares, 
+ *         of a 16-bit `RGB` image, for the Guided Filter algorithm.
+ *  \details It's the horizontal pass of the box sums of `gf_ab_Ushort`. The sums 
+ *           are accumulated in integers, so they are exact. The windows are 
+ *           clamped at the borders.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of columns, `N`, in the image. That is, 
+ *        \f$ \ gXdim = N \f$. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to the number of rows, `M`, in the 
+ *        image. That is, \f$ \ gYdim = M \f$. The local workspace is irrelevant.
+ *  \note The radius should be at most `127`, so that `gf_ab_Ushort` can't overflow.
+ *
+ *  \param[in] in input array of interleaved `RGB` `ushort` values.
+ *  \param[out] sum array of the row sums of the values, with the channels 
+ *                  in the `x`, `y`, `z` components.
+ *  \param[out] sum2 array of the row sums of the squared values, with the 
+ *                   channels in the `x`, `y`, `z` components.
+ *  \param[in] radius radius of the square filter window.
+ */
+kernel
+void gf_rowSums_Ushort (global ushort *in, global uint4 *sum, global ulong4 *sum2, int radius)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    int x0 = max (gX - radius, 0);
+    int x1 = min (gX + radius, gXdim - 1);
+
+    uint3 s = 0;
+    ulong3 s2 = 0;
+    for (int x = x0; x <= x1; ++x)
+    {
+        uint3 v = convert_uint3 (vload3 (gY * gXdim + x, in));
+        s += v;
+        s2 += convert_ulong3 (v * v);  // 65535^2 fits in 32 bits
+    }
+
+    sum[gY * gXdim + gX] = (uint4) (s, 0u);
+    sum2[gY * gXdim + gX] = (ulong4) (s2, 0ul);
+}
+
+
+/*! \brief Computes the `a` and `b` coefficients in the Guided Filter algorithm 
+ *         for a 16-bit `RGB` image, from exact box sums.
+ *  \details It's the vertical pass of the box sums, on the row sums of `gf_rowSums_Ushort`. 
+ *           With \f$ S_1 \f$, \f$ S_2 \f$ the sums of the values and of their squares 
+ *           in a window of \f$ n \f$ pixels, the variance is \f$ (n S_2 - S_1^2) / n^2 \f$, 
+ *           and its numerator is computed exactly in 64-bit integers. The only roundings 
+ *           are in the conversions to `float`, and the coefficients are within a few 
+ *           `float` ulps of the exact ones. They are stored in fixed point, with 
+ *           \f$ 2^{24} \f$ as one, so that `gf_rowSums_ab` and `gf_q_Ushort` 
+ *           can average them exactly too.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of columns, `N`, in the image. That is, 
+ *        \f$ \ gXdim = N \f$. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to the number of rows, `M`, in the 
+ *        image. That is, \f$ \ gYdim = M \f$. The local workspace is irrelevant.
+ *  \note The radius should be at most `127`, so that \f$ n S_2 \f$ fits in 64 bits.
+ *
+ *  \param[in] sum array of the row sums of the values.
+ *  \param[in] sum2 array of the row sums of the squared values.
+ *  \param[out] a array of \f$ a \f$ coefficients in fixed point.
+ *  \param[out] b array of \f$ b \f$ coefficients in fixed point, for values normalized to one.
+ *  \param[in] radius radius of the square filter window.
+ *  \param[in] eps regularization parameter \f$ \epsilon \f$, for values normalized to one.
+ */
+kernel
+void gf_ab_Ushort (global uint4 *sum, global ulong4 *sum2, 
+                   global uint4 *a, global uint4 *b, int radius, float eps)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+    int gYdim = get_global_size (1);
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    int y0 = max (gY - radius, 0);
+    int y1 = min (gY + radius, gYdim - 1);
+
+    ulong4 s = 0, s2 = 0;
+    for (int y = y0; y <= y1; ++y)
+    {
+        s += convert_ulong4 (sum[y * gXdim + gX]);
+        s2 += sum2[y * gXdim + gX];
+    }
+
+    // Number of elements in the filter window
+    ulong n = (ulong) (min (gX + radius, gXdim - 1) - max (gX - radius, 0) + 1) * (y1 - y0 + 1);
+
+    float scale = 65535.f * n;
+    float4 mean = convert_float4 (s) / scale;
+    float4 var = convert_float4 (n * s2 - s * s) / (scale * scale);
+    float4 a_ = var / (var + eps);
+
+    a[gY * gXdim + gX] = convert_uint4_sat_rte (a_ * 16777216.f);
+    b[gY * gXdim + gX] = convert_uint4_sat_rte ((1.f - a_) * mean * 16777216.f);
+}
+
+
+/*! \brief Computes the row sums of the fixed point `a` and `b` coefficients 
+ *         of `gf_ab_Ushort`.
+ *  \details It's the horizontal pass of the box sums of `gf_q_Ushort`. The sums 
+ *           are accumulated in integers, so they are exact. The windows are 
+ *           clamped at the borders.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of columns, `N`, in the image. That is, 
+ *        \f$ \ gXdim = N \f$. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to the number of rows, `M`, in the 
+ *        image. That is, \f$ \ gYdim = M \f$. The local workspace is irrelevant.
+ *  \note The radius should be at most `127`, so that the sums fit in 32 bits.
+ *
+ *  \param[in] a array of \f$ a \f$ coefficients in fixed point.
+ *  \param[in] b array of \f$ b \f$ coefficients in fixed point.
+ *  \param[out] sumA array of the row sums of the \f$ a \f$ coefficients.
+ *  \param[out] sumB array of the row sums of the \f$ b \f$ coefficients.
+ *  \param[in] radius radius of the square filter window.
+ */
+kernel
+void gf_rowSums_ab (global uint4 *a, global uint4 *b, 
+                    global uint4 *sumA, global uint4 *sumB, int radius)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    int x0 = max (gX - radius, 0);
+    int x1 = min (gX + radius, gXdim - 1);
+
+    uint4 sA = 0, sB = 0;
+    for (int x = x0; x <= x1; ++x)
+    {
+        sA += a[gY * gXdim + x];
+        sB += b[gY * gXdim + x];
+    }
+
+    sumA[gY * gXdim + gX] = sA;
+    sumB[gY * gXdim + gX] = sB;
+}
+
+
+/*! \brief Computes the filtered output `q` in the Guided Filter algorithm 
+ *         for a 16-bit `RGB` image.
+ *  \details It's the vertical pass of the box sums, on the row sums of `gf_rowSums_ab`. 
+ *           The average coefficients are exact up to their conversion to `float`. 
+ *           The output is scaled to `65535`, rounded to the nearest (even) integer, 
+ *           and saturated to the range of `ushort`.
+ *  \note The **x** dimension of the global workspace, \f$ gXdim \f$, should be 
+ *        equal to the number of columns, `N`, in the image. That is, 
+ *        \f$ \ gXdim = N \f$. The **y** dimension of the global workspace, 
+ *        \f$ gYdim \f$, should be equal to the number of rows, `M`, in the 
+ *        image. That is, \f$ \ gYdim = M \f$. The local workspace is irrelevant.
+ *
+ *  \param[in] in input array of interleaved `RGB` `ushort` values.
+ *  \param[in] sumA array of the row sums of the \f$ a \f$ coefficients.
+ *  \param[in] sumB array of the row sums of the \f$ b \f$ coefficients.
+ *  \param[out] out output array of interleaved `RGB` `ushort` values.
+ *  \param[in] radius radius of the square filter window.
+ */
+kernel
+void gf_q_Ushort (global ushort *in, global uint4 *sumA, global uint4 *sumB, 
+                  global ushort *out, int radius)
+{
+    // Workspace dimensions
+    int gXdim = get_global_size (0);
+    int gYdim = get_global_size (1);
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    int y0 = max (gY - radius, 0);
+    int y1 = min (gY + radius, gYdim - 1);
+
+    ulong4 sA = 0, sB = 0;
+    for (int y = y0; y <= y1; ++y)
+    {
+        sA += convert_ulong4 (sumA[y * gXdim + gX]);
+        sB += convert_ulong4 (sumB[y * gXdim + gX]);
+    }
+
+    // Number of elements in the filter window
+    ulong n = (ulong) (min (gX + radius, gXdim - 1) - max (gX - radius, 0) + 1) * (y1 - y0 + 1);
+
+    float scale = 16777216.f * n;
+    float3 mean_a = convert_float4 (sA).xyz / scale;
+    float3 mean_b = convert_float4 (sB).xyz / scale;
+    float3 p = convert_float3 (vload3 (gY * gXdim + gX, in)) / 65535.f;
+
+    vstore3 (convert_ushort3_sat_rte (65535.f * (mean_a * p + mean_b)), gY * gXdim + gX, out);
+}
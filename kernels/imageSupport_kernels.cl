@@ -133,6 +133,61 @@ void separateRGBChannels_Uchar2Float (global uchar *AoS,
 }
 
 
+/*! \brief Separates the 3 channels of an RGB image.
+ *  \details Performs a matrix transposition on an RGB image `(AoS -> SoA)`, 
+ *           and promotes the `ushort` type to `float` while normalizing
+ *           the values to one. For avoiding alignment restrictions, the `SoA`
+ *           structure is broken out to the individual channels, R, G, B.
+ *  \note The global workspace should be one-dimensional `(= # pixels 
+ *        in the input buffer)`. The global and local workspaces 
+ *        should be **multiples of 3**.
+ *
+ *  \param[in] AoS input buffer with the following (logical) arrangement: ushort[total-pixels][3].
+ *                 Each row contains the RGB values of a pixel.
+ *  \param[out] r output buffer with all the pixel values in the first channel, R.
+ *  \param[out] g output buffer with all the pixel values in the second channel, G.
+ *  \param[out] b output buffer with all the pixel values in the third channel, B.
+ *  \param[in] data local buffer with size `3 x (# work-items in work-group) x sizeof (ushort)` bytes.
+ */
+kernel
+void separateRGBChannels_Ushort2Float (global ushort *AoS, 
+                                       global float *r, global float *g, global float *b, 
+                                       local ushort *data)
+{
+    global float *addr[] = { r, g, b };
+
+    // Workspace dimensions
+    uint lXdim = get_local_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint lX = get_local_id (0);
+    uint wgX = get_group_id (0);
+
+    // Each work-item in the work-group reads in a pixel's values
+    vstore3 (vload3 (gX, AoS), lX, data);
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // With each 1/3 work-items in the work-group, indices will offset by one,
+    // handling this way first the R, then the G, and then the B values
+    uint lastIdx = 3 * lXdim - 1;
+    uint baseIdx = (9 * lX) % lastIdx;
+    
+    // A triplet of values on the same channel
+    float3 triplet = { data[baseIdx], data[baseIdx + 3], data[baseIdx + 6] };
+
+    // Normalize the values
+    triplet /= 65535.f;
+    
+    // Each 1/3 work-items in the work-group 
+    // stores the values of one channel
+    uchar channel = (3 * lX) / lXdim;
+    global float *img = addr[channel];
+
+    vstore3 (triplet, lX % (lXdim / 3), &img[wgX * lXdim]);
+}
+
+
 /*! \brief Combines the 3 channels of an RGB Image.
  *  \details Performs a matrix transposition on an RGB image `(SoA -> AoS)`.
  *           For avoiding alignment restrictions, the `SoA` structure 
@@ -228,6 +283,57 @@ void combineRGBChannels_Float2Uchar (global float *r, global float *g, global fl
 }
 
 
+/*! \brief Combines the 3 channels of an RGB Image.
+ *  \details Performs a matrix transposition on an RGB image `(SoA -> AoS)`,
+ *           demotes the `float` type to `ushort`, and scales the data to `65535`.
+ *           For avoiding alignment restrictions, the `SoA` structure is broken 
+ *           out to the individual channels, R, G, B.
+ *  \note The global workspace should be one-dimensional `(= # pixels 
+ *        in the input buffer)`. The global and local workspaces 
+ *        should be **multiples of 3**.
+ *
+ *  \param[in] r input buffer with all the pixel values in channel R.
+ *  \param[in] g input buffer with all the pixel values in channel G.
+ *  \param[in] b input buffer with all the pixel values in channel B.
+ *  \param[out] AoS output buffer with the following (logical) arrangement: ushort[total-pixels][3].
+ *                  Each row contains the RGB values of a pixel.
+ *  \param[in] data local buffer with size `3 x (# work-items in work-group) x sizeof (float)` bytes.
+ */
+kernel
+void combineRGBChannels_Float2Ushort (global float *r, global float *g, global float *b, 
+                                      global ushort *AoS, local float *data)
+{
+    global float *addr[] = { r, g, b };
+
+    // Workspace dimensions
+    uint lXdim = get_local_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint lX = get_local_id (0);
+    uint wgX = get_group_id (0);
+
+    // Each 1/3 work-items in the work-group reads in 
+    // a triplet of values on channel, R, G, B, respectively
+    uchar channel = (3 * lX) / lXdim;
+    uint rank = lX % (lXdim / 3);
+    global float *img = addr[channel];
+    vstore3 (vload3 (rank, &img[wgX * lXdim]), rank, &data[channel * lXdim]);
+    barrier (CLK_LOCAL_MEM_FENCE);
+
+    // Each work-item in the work-group assembles and stores a pixel
+    float3 triplet = { data[lX], data[lXdim + lX], data[2 * lXdim + lX] };
+
+    // Scale the values
+    triplet *= 65535.f;
+
+    // Demote the type (rounding, and saturating out of range values)
+    ushort3 pixel = convert_ushort3_sat_rte (triplet);
+
+    vstore3 (pixel, gX, AoS);
+}
+
+
 /*! \brief Converts a buffer from type `uchort` to `float`.
  *  \note The global workspace should be one dimensional and equal to 
  *        the number of elements in the image divided by 4.
@@ -245,6 +351,195 @@ void depth_Ushort2Float (global ushort4 *depth, global float4 *fDepth, float sca
 }
 
 
+/*! \brief Converts a buffer from type `float` to `ushort`.
+ *  \details The values are scaled, rounded to the nearest integer, 
+ *           and saturated to the range of `ushort`.
+ *  \note The global workspace should be one dimensional and equal to 
+ *        the number of elements in the image divided by 4.
+ *
+ *  \param[in] fDepth image with type `float`.
+ *  \param[out] depth image with type `ushort`.
+ *  \param[in] scaling factor by which to scale the values before the conversion.
+ */
+kernel
+void depth_Float2Ushort (global float4 *fDepth, global ushort4 *depth, float scaling)
+{
+    uint gX = get_global_id (0);
+
+    depth[gX] = convert_ushort4_sat_rte (fDepth[gX] * scaling);
+}
+
+
+/*! \brief Computes the luminance of an RGB image.
+ *  \details That is \f$ Y = 0.299R + 0.587G + 0.114B \f$.
+ *  \note The global workspace should be one dimensional and equal to 
+ *        the number of elements in the image divided by 4.
+ *
+ *  \param[in] r channel R of the RGB image.
+ *  \param[in] g channel G of the RGB image.
+ *  \param[in] b channel B of the RGB image.
+ *  \param[out] gray luminance image.
+ */
+kernel
+void rgbToGray (global float4 *r, global float4 *g, global float4 *b, global float4 *gray)
+{
+    uint gX = get_global_id (0);
+
+    gray[gX] = 0.299f * r[gX] + 0.587f * g[gX] + 0.114f * b[gX];
+}
+
+
+/*! \brief Zeroes out the elements of an array that are zero in a reference array, 
+ *         and scales the rest.
+ *  \details It's used to zero out in a filtered depth image the pixels 
+ *           that are invalid (zero) in the original depth image.
+ *  \note The global workspace should be one dimensional and equal to 
+ *        the number of elements in the arrays divided by 4.
+ *
+ *  \param[in] ref reference array.
+ *  \param[in] in input array.
+ *  \param[out] out output array.
+ *  \param[in] scaling factor by which to scale the nonzero elements in the output array.
+ */
+kernel
+void maskZeros (global float4 *ref, global float4 *in, global float4 *out, float scaling)
+{
+    uint gX = get_global_id (0);
+
+    out[gX] = select (scaling * in[gX], 0.f, isequal (ref[gX], 0.f));
+}
+
+
+/*! \brief Converts the luma plane of a `YUV 4:2:0` image from type `uchar` to `float`.
+ *  \details The values are normalized to one.
+ *  \note The luma plane comes first in both NV12 and I420 images, 
+ *        so the kernel ignores the chroma planes.
+ *  \note The global workspace should be one dimensional and equal to 
+ *        the number of luma samples divided by 4.
+ *
+ *  \param[in] yuv YUV image (only the luma plane is read).
+ *  \param[out] y luma plane with type `float`.
+ */
+kernel
+void yuvLuma_Uchar2Float (global uchar4 *yuv, global float4 *y)
+{
+    uint gX = get_global_id (0);
+
+    y[gX] = convert_float4 (yuv[gX]) / 255.f;
+}
+
+
+/*! \brief Converts a luma plane from type `float` back to `uchar`, 
+ *         and stores it in the luma plane of a `YUV 4:2:0` image.
+ *  \details The values are scaled to `255`, rounded, and saturated.
+ *  \note The global workspace should be one dimensional and equal to 
+ *        the number of luma samples divided by 4.
+ *
+ *  \param[in] y luma plane with type `float` (normalized to one).
+ *  \param[out] yuv YUV image (only the luma plane is written).
+ */
+kernel
+void yuvLuma_Float2Uchar (global float4 *y, global uchar4 *yuv)
+{
+    uint gX = get_global_id (0);
+
+    yuv[gX] = convert_uchar4_sat_rte (y[gX] * 255.f);
+}
+
+
+/*! \brief Copies an array.
+ *  \details It's used to pass the chroma planes of a `YUV` image through 
+ *           to the output, while the luma plane is processed.
+ *  \note The global workspace should be one dimensional. Use a global 
+ *        offset to copy a part of the array.
+ *
+ *  \param[in] in input array.
+ *  \param[out] out output array.
+ */
+kernel
+void copyUchar4 (global uchar4 *in, global uchar4 *out)
+{
+    uint gX = get_global_id (0);
+
+    out[gX] = in[gX];
+}
+
+
+/*! \brief Extracts the chroma planes of a `YUV 4:2:0` image, along with a guide 
+ *         for them, and converts them from type `uchar` to `float`.
+ *  \details The guide is the mean of the 4 luma samples that share a chroma sample. 
+ *           All values are normalized to one.
+ *  \note The global workspace should be equal to the dimensions of the chroma planes, 
+ *        i.e. half the dimensions of the image.
+ *
+ *  \param[in] yuv YUV image.
+ *  \param[out] y luma plane at the resolution of the chroma planes.
+ *  \param[out] u chroma plane U.
+ *  \param[out] v chroma plane V.
+ *  \param[in] interleaved flag to indicate whether the chroma samples are interleaved 
+ *                         in one plane (NV12), or separated in two planes (I420).
+ */
+kernel
+void yuvChroma_Uchar2Float (global uchar *yuv, global float *y, global float *u, global float *v, 
+                            int interleaved)
+{
+    // Workspace dimensions
+    uint cCols = get_global_size (0);
+    uint cRows = get_global_size (1);
+    uint cols = 2 * cCols;
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint gY = get_global_id (1);
+
+    // Flatten indices
+    uint cIdx = gY * cCols + gX;
+    uint lIdx = 2 * (gY * cols + gX);
+
+    float4 luma = convert_float4 ((uchar4) (yuv[lIdx], yuv[lIdx + 1], yuv[lIdx + cols], yuv[lIdx + cols + 1]));
+    y[cIdx] = dot (luma, 1.f) / (4 * 255.f);
+
+    global uchar *chroma = yuv + 4 * cCols * cRows;
+    uchar2 uv = (interleaved) ? vload2 (cIdx, chroma) : (uchar2) (chroma[cIdx], chroma[cCols * cRows + cIdx]);
+    u[cIdx] = uv.x / 255.f;
+    v[cIdx] = uv.y / 255.f;
+}
+
+
+/*! \brief Converts the chroma planes from type `float` back to `uchar`, 
+ *         and stores them in the chroma planes of a `YUV 4:2:0` image.
+ *  \details The values are scaled to `255`, rounded, and saturated.
+ *  \note The global workspace should be equal to the dimensions of the chroma planes, 
+ *        i.e. half the dimensions of the image.
+ *
+ *  \param[in] u chroma plane U (normalized to one).
+ *  \param[in] v chroma plane V (normalized to one).
+ *  \param[out] yuv YUV image (only the chroma planes are written).
+ *  \param[in] interleaved flag to indicate whether the chroma samples are interleaved 
+ *                         in one plane (NV12), or separated in two planes (I420).
+ */
+kernel
+void yuvChroma_Float2Uchar (global float *u, global float *v, global uchar *yuv, int interleaved)
+{
+    // Workspace dimensions
+    uint cCols = get_global_size (0);
+    uint cRows = get_global_size (1);
+
+    // Flatten indices
+    uint cIdx = get_global_id (1) * cCols + get_global_id (0);
+
+    global uchar *chroma = yuv + 4 * cCols * cRows;
+    uchar2 uv = convert_uchar2_sat_rte ((float2) (u[cIdx], v[cIdx]) * 255.f);
+    if (interleaved)
+        vstore2 (uv, cIdx, chroma);
+    else
+    {
+        chroma[cIdx] = uv.x;
+        chroma[cCols * cRows + cIdx] = uv.y;
+    }
+}
+
+
 /*! \brief Transforms a depth image to a point cloud.
  *  \note The global workspace should be equal to the dimensions of the image.
  *
@@ -395,3 +690,339 @@ void splitPC8D (global float8 *pc8d, global float4 *pc4d, global float4 *rgba, u
     pc4d[pos] = point.lo;
     rgba[pos] = point.hi;
 }
+
+
+/*! \brief Splits a compacted 8-D point cloud into 4-D geometry points and RGBA color points.
+ *  \details It's the same as `splitPC8D`, but only the first `count[0]` points are processed.
+ *  \note The global workspace should be one-dimensional. The **x** dimension 
+ *        of the global workspace, \f$ gXdim \f$, should be equal to the maximum 
+ *        number of points in the point cloud. The local workspace is irrelevant.
+ *
+ *  \param[in] pc8d array with 8-D points (homogeneous coordinates + RGBA values).
+ *  \param[out] pc4d array with 4-D geometry points.
+ *  \param[out] rgba array with 4-D color points.
+ *  \param[in] offset number of points to skip in the output arrays. The kernel will 
+ *                    write in the output arrays starting at position `offset`.
+ *  \param[in] count number of valid points in `pc8d` (as produced by `pcCompact`).
+ */
+kernel
+void splitPC8D_Compact (global float8 *pc8d, global float4 *pc4d, global float4 *rgba, 
+                        unsigned int offset, global uint *count)
+{
+    uint gX = get_global_id (0);
+
+    if (gX >= count[0]) return;
+
+    float8 point = pc8d[gX];
+    size_t pos = offset + gX;
+    pc4d[pos] = point.lo;
+    rgba[pos] = point.hi;
+}
+
+
+/*! \brief Marks the valid points in a point cloud.
+ *  \details A point is valid when its depth (z coordinate) is nonzero.
+ *  \note The global workspace should be one-dimensional `(= # points)`.
+ *
+ *  \param[in] pc array of points. Each point consists of `stride` `float4` elements, 
+ *                the first of which holds the homogeneous coordinates.
+ *  \param[out] mask validity mask (1 for valid points, 0 otherwise).
+ *  \param[in] stride number of `float4` elements per point (1 for 4-D points, 2 for 8-D points).
+ */
+kernel
+void pcValidMask (global float4 *pc, global float *mask, uint stride)
+{
+    uint gX = get_global_id (0);
+
+    mask[gX] = (pc[gX * stride].z != 0.f) ? 1.f : 0.f;
+}
+
+
+/*! \brief Gathers the number of valid points on each row of a point cloud.
+ *  \details Picks the last element on each row of the scanned validity mask.
+ *  \note The global workspace should be one-dimensional `(= # rows, 
+ *        rounded up to a multiple of 4)`. The padding elements are set to 0.
+ *
+ *  \param[in] rowScan validity mask scanned along the rows.
+ *  \param[out] counts number of valid points on each row.
+ *  \param[in] cols number of columns in the point cloud.
+ *  \param[in] rows number of rows in the point cloud.
+ */
+kernel
+void pcRowCounts (global float *rowScan, global float *counts, uint cols, uint rows)
+{
+    uint gX = get_global_id (0);
+
+    counts[gX] = (gX < rows) ? rowScan[gX * cols + cols - 1] : 0.f;
+}
+
+
+/*! \brief Scatters the valid points of a point cloud into a dense array.
+ *  \details The position of each valid point is given by the number of valid points 
+ *           before it, so the points maintain their order. The work-item on the last 
+ *           pixel stores the total number of valid points.
+ *  \note The global workspace should be equal to the dimensions of the point cloud.
+ *
+ *  \param[in] pc array of points. Each point consists of `stride` `float4` elements, 
+ *                the first of which holds the homogeneous coordinates.
+ *  \param[in] rowScan validity mask scanned along the rows.
+ *  \param[in] rowOffsets scanned row counts (inclusive).
+ *  \param[out] out array with the valid points.
+ *  \param[out] count number of valid points.
+ *  \param[in] stride number of `float4` elements per point (1 for 4-D points, 2 for 8-D points).
+ */
+kernel
+void pcCompact (global float4 *pc, global float *rowScan, global float *rowOffsets, 
+                global float4 *out, global uint *count, uint stride)
+{
+    // Workspace dimensions
+    uint cols = get_global_size (0);
+    uint rows = get_global_size (1);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint gY = get_global_id (1);
+
+    // Flatten indices
+    uint idx = gY * cols + gX;
+
+    if ((gX == cols - 1) && (gY == rows - 1))
+        count[0] = convert_uint (rowOffsets[rows - 1]);
+
+    global float4 *point = pc + idx * stride;
+    if (point[0].z == 0.f) return;
+
+    uint pos = convert_uint (rowScan[idx]) - 1;
+    if (gY > 0) pos += convert_uint (rowOffsets[gY - 1]);
+
+    for (uint k = 0; k < stride; ++k)
+        out[pos * stride + k] = point[k];
+}
+
+
+/*! \brief Returns the reference point of the tile that contains pixel `(x, y)`.
+ *  \details The reference is the first valid point on the center row of the tile, 
+ *           starting from the center of the tile. If there is none, the reference 
+ *           is the origin (invalid points have zeroed coordinates).
+ *
+ *  \param[in] pc organized point cloud.
+ *  \param[in] x column of the pixel.
+ *  \param[in] y row of the pixel.
+ *  \param[in] cols number of columns in the point cloud.
+ *  \param[in] tile side of the tiles.
+ *  \return The reference point.
+ */
+inline
+float3 tileRef (global float4 *pc, int x, int y, uint cols, uint tile)
+{
+    int tX = (x / tile) * tile;
+    int tY = (y / tile) * tile + tile / 2;
+
+    global float4 *row = pc + tY * cols + tX;
+    for (uint k = 0; k < tile; ++k)
+    {
+        float4 point = row[(k + tile / 2) % tile];
+        if (point.z != 0.f) return point.xyz;
+    }
+
+    return 0.f;
+}
+
+
+/*! \brief Computes the per-point moments that go into the integral images of `pcNormals`.
+ *  \details The point cloud is partitioned in square tiles, and the coordinates 
+ *           of each point are taken relative to the center point of its tile. 
+ *           That keeps the tile-wise partial sums small enough for `float` precision. 
+ *           The 10 moments are \f$ n, x, y, z, xx, yy, zz, xy, xz, yz \f$, where 
+ *           \f$ n \f$ is 1 for valid points (nonzero depth) and 0 otherwise. 
+ *           The moments are stored side by side, i.e. moment \f$ k \f$ of pixel 
+ *           \f$ (x, y) \f$ goes at position \f$ y*10*cols + k*cols + x \f$.
+ *  \note The global workspace should be equal to the dimensions of the point cloud.
+ *
+ *  \param[in] pc organized point cloud.
+ *  \param[out] moments array with the moments \f$ (10*cols \times rows) \f$.
+ *  \param[in] tile side of the tiles.
+ */
+kernel
+void pcMoments (global float4 *pc, global float *moments, uint tile)
+{
+    // Workspace dimensions
+    uint cols = get_global_size (0);
+
+    // Workspace indices
+    uint gX = get_global_id (0);
+    uint gY = get_global_id (1);
+
+    float4 point = pc[gY * cols + gX];
+    float n = (point.z != 0.f) ? 1.f : 0.f;
+    float3 q = n * (point.xyz - tileRef (pc, gX, gY, cols, tile));
+
+    global float *m = moments + gY * 10 * cols + gX;
+    m[0]        = n;
+    m[cols]     = q.x;
+    m[2 * cols] = q.y;
+    m[3 * cols] = q.z;
+    m[4 * cols] = q.x * q.x;
+    m[5 * cols] = q.y * q.y;
+    m[6 * cols] = q.z * q.z;
+    m[7 * cols] = q.x * q.y;
+    m[8 * cols] = q.x * q.z;
+    m[9 * cols] = q.y * q.z;
+}
+
+
+/*! \brief Sums a rectangle of a tiled, transposed integral image.
+ *  \details The rectangle \f$ [x_0, x_1] \times [y_0, y_1] \f$ must lie within a single tile.
+ *
+ *  \param[in] sat the integral image of one moment (transposed, so `sat[x * rows + y]`).
+ *  \param[in] rows number of rows in the point cloud.
+ *  \param[in] tile side of the tiles.
+ *  \return The sum over the rectangle.
+ */
+inline
+float tileRectSum (global float *sat, uint rows, uint tile, int x0, int x1, int y0, int y1)
+{
+    bool left = (x0 % tile) != 0;
+    bool top  = (y0 % tile) != 0;
+
+    float sum = sat[x1 * rows + y1];
+    if (left) sum -= sat[(x0 - 1) * rows + y1];
+    if (top)  sum -= sat[x1 * rows + y0 - 1];
+    if (left && top) sum += sat[(x0 - 1) * rows + y0 - 1];
+
+    return sum;
+}
+
+
+/*! \brief Estimates the surface normals of an organized point cloud.
+ *  \details The normal of a point is the eigenvector of the smallest eigenvalue of 
+ *           the covariance matrix of the valid points in a \f$ (2r+1) \times (2r+1) \f$ 
+ *           window around it. The covariance is assembled in constant time from the 
+ *           (tiled) integral images of the moments produced by `pcMoments`. A window 
+ *           spans at most 2x2 tiles, and the sums of each tile are shifted to the 
+ *           reference of the center tile before they get combined. The eigenproblem 
+ *           is solved in closed form. Normals are oriented towards the viewpoint (origin). 
+ *           The **w** component holds the surface curvature, 
+ *           \f$ \lambda_0 / (\lambda_0 + \lambda_1 + \lambda_2) \f$.
+ *           Invalid points, and points with less than 3 valid neighbors, get a zeroed output.
+ *  \note The global workspace should be equal to the dimensions of the point cloud.
+ *
+ *  \param[in] pc organized point cloud.
+ *  \param[in] sat integral images of the moments (as produced by a transposed, tiled `SAT`).
+ *  \param[out] normals array with the normals (+ curvature).
+ *  \param[in] radius radius of the neighborhood window. It should satisfy \f$ 2r+1 \leq tile \f$.
+ *  \param[in] tile side of the tiles.
+ */
+kernel
+void pcNormals (global float4 *pc, global float *sat, global float4 *normals, int radius, uint tile)
+{
+    // Workspace dimensions
+    int cols = get_global_size (0);
+    int rows = get_global_size (1);
+
+    // Workspace indices
+    int gX = get_global_id (0);
+    int gY = get_global_id (1);
+
+    int idx = gY * cols + gX;
+    float4 point = pc[idx];
+
+    if (point.z == 0.f)
+    {
+        normals[idx] = 0.f;
+        return;
+    }
+
+    // Window limits, split at the tile boundaries
+    int x0 = max (gX - radius, 0), x1 = min (gX + radius, cols - 1);
+    int y0 = max (gY - radius, 0), y1 = min (gY + radius, rows - 1);
+    int xs = (x1 / (int) tile) * tile, ys = (y1 / (int) tile) * tile;
+
+    int2 xr[2] = { (int2) (x0, x1), (int2) (xs, x1) };
+    int2 yr[2] = { (int2) (y0, y1), (int2) (ys, y1) };
+    int nx = 1, ny = 1;
+    if (xs > x0) { xr[0].y = xs - 1; nx = 2; }
+    if (ys > y0) { yr[0].y = ys - 1; ny = 2; }
+
+    float3 ref = tileRef (pc, gX, gY, cols, tile);
+
+    float n = 0.f;
+    float3 s1 = 0.f, s2d = 0.f, s2o = 0.f;
+
+    for (int j = 0; j < ny; ++j)
+    {
+        for (int i = 0; i < nx; ++i)
+        {
+            float m[10];
+            for (int k = 0; k < 10; ++k)
+                m[k] = tileRectSum (sat + k * cols * rows, rows, tile, 
+                                    xr[i].x, xr[i].y, yr[j].x, yr[j].y);
+
+            // Shift the sums to the reference of the center tile
+            float3 d = tileRef (pc, xr[i].x, yr[j].x, cols, tile) - ref;
+            float3 t1 = (float3) (m[1], m[2], m[3]);
+
+            n   += m[0];
+            s1  += t1 + m[0] * d;
+            s2d += (float3) (m[4], m[5], m[6]) + 2.f * d * t1 + m[0] * d * d;
+            s2o += (float3) (m[7], m[8], m[9]) 
+                 + d.xxy * t1.yzz + t1.xxy * d.yzz + m[0] * d.xxy * d.yzz;
+        }
+    }
+
+    if (n < 3.f)
+    {
+        normals[idx] = 0.f;
+        return;
+    }
+
+    // Covariance matrix
+    float3 mean = s1 / n;
+    float3 cd = s2d / n - mean * mean;           // xx, yy, zz
+    float3 co = s2o / n - mean.xxy * mean.yzz;  // xy, xz, yz
+
+    // Eigenvalues (closed form for symmetric 3x3 matrices)
+    float p1 = dot (co, co);
+    float q = (cd.x + cd.y + cd.z) / 3.f;
+    float3 dq = cd - q;
+    float p2 = dot (dq, dq) + 2.f * p1;
+    float p = sqrt (p2 / 6.f);
+
+    if (p == 0.f)
+    {
+        normals[idx] = 0.f;
+        return;
+    }
+
+    float3 b0 = (float3) (dq.x, co.x, co.y) / p;
+    float3 b1 = (float3) (co.x, dq.y, co.z) / p;
+    float3 b2 = (float3) (co.y, co.z, dq.z) / p;
+    float r = clamp (dot (b0, cross (b1, b2)) / 2.f, -1.f, 1.f);
+    float phi = acos (r) / 3.f;
+
+    float l0 = q + 2.f * p * cos (phi + 2.094395102f);  // smallest
+    float l2 = q + 2.f * p * cos (phi);                  // largest
+    float l1 = 3.f * q - l0 - l2;
+
+    // Eigenvector of the smallest eigenvalue
+    float3 r0 = (float3) (cd.x - l0, co.x, co.y);
+    float3 r1 = (float3) (co.x, cd.y - l0, co.z);
+    float3 r2 = (float3) (co.y, co.z, cd.z - l0);
+
+    float3 v = cross (r0, r1);
+    float3 v02 = cross (r0, r2), v12 = cross (r1, r2);
+    if (dot (v02, v02) > dot (v, v)) v = v02;
+    if (dot (v12, v12) > dot (v, v)) v = v12;
+
+    if (dot (v, v) == 0.f)
+    {
+        normals[idx] = 0.f;
+        return;
+    }
+
+    v = normalize (v);
+    if (dot (v, point.xyz) > 0.f) v = -v;
+
+    float sum = l0 + l1 + l2;
+    normals[idx] = (float4) (v, (sum > 0.f) ? max (l0, 0.f) / sum : 0.f);
+}
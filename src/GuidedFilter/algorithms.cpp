@@ -31,10 +31,14 @@
 
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 #include <CLUtils.hpp>
 #include <GuidedFilter/algorithms.hpp>
 #include <GuidedFilter/math.hpp>
+#include <GuidedFilter/tuning.hpp>
 
 
 /*! \note All the classes assume there is a fully configured `clutils::CLEnv` 
@@ -53,9 +57,9 @@ namespace GF
      */
     SeparateRGB<SeparateRGBConfig::FLOAT_FLOAT>::SeparateRGB (
         clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+        counters ("SeparateRGB<SeparateRGBConfig::FLOAT_FLOAT>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
         kernel (env.getProgram (info.pgIdx), "separateRGBChannels_Float2Float")
     {
         wgMultiple = kernel.getWorkGroupInfo
@@ -152,7 +156,7 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
                 hPtrIn = (cl_float *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
@@ -169,11 +173,11 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOutR () == nullptr)
-                    hBufferOutR = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOutR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
                 if (hBufferOutG () == nullptr)
-                    hBufferOutG = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOutG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
                 if (hBufferOutB () == nullptr)
-                    hBufferOutB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOutB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
                 hPtrOutR = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOutR, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
@@ -192,13 +196,13 @@ namespace GF
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOutR () == nullptr)
-            dBufferOutR = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOutR = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
         if (dBufferOutG () == nullptr)
-            dBufferOutG = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOutG = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
         if (dBufferOutB () == nullptr)
-            dBufferOutB = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOutB = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferIn);
@@ -279,6 +283,7 @@ namespace GF
      */
     void SeparateRGB<SeparateRGBConfig::FLOAT_FLOAT>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
     }
 
@@ -288,9 +293,9 @@ namespace GF
      */
     SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::SeparateRGB (
         clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+        counters ("SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
         kernel (env.getProgram (info.pgIdx), "separateRGBChannels_Uchar2Float")
     {
         wgMultiple = kernel.getWorkGroupInfo
@@ -387,7 +392,7 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
                 hPtrIn = (cl_uchar *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
@@ -404,11 +409,11 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOutR () == nullptr)
-                    hBufferOutR = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOutR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
                 if (hBufferOutG () == nullptr)
-                    hBufferOutG = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOutG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
                 if (hBufferOutB () == nullptr)
-                    hBufferOutB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOutB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
                 hPtrOutR = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOutR, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
@@ -427,13 +432,13 @@ namespace GF
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOutR () == nullptr)
-            dBufferOutR = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOutR = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
         if (dBufferOutG () == nullptr)
-            dBufferOutG = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOutG = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
         if (dBufferOutB () == nullptr)
-            dBufferOutB = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOutB = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferIn);
@@ -514,17 +519,280 @@ namespace GF
      */
     void SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
     }
 
 
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernel, cl::NullRange, global, local, deps, node);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::SeparateRGB (
+        clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "separateRGBChannels_Ushort2Float")
+    {
+        wgMultiple = kernel.getWorkGroupInfo
+            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::get (SeparateRGB::Memory mem)
+    {
+        switch (mem)
+        {
+            case SeparateRGB::Memory::H_IN:
+                return hBufferIn;
+            case SeparateRGB::Memory::H_OUT_R:
+                return hBufferOutR;
+            case SeparateRGB::Memory::H_OUT_G:
+                return hBufferOutG;
+            case SeparateRGB::Memory::H_OUT_B:
+                return hBufferOutB;
+            case SeparateRGB::Memory::D_IN:
+                return dBufferIn;
+            case SeparateRGB::Memory::D_OUT_R:
+                return dBufferOutR;
+            case SeparateRGB::Memory::D_OUT_G:
+                return dBufferOutG;
+            case SeparateRGB::Memory::D_OUT_B:
+                return dBufferOutB;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width (\#pixels/row) of the array to be processed.
+     *  \param[in] _height height (\#pixels/column) of the array to be processed.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::init (
+        unsigned int _width, unsigned int _height, Staging _staging)
+    {
+        // Logically rearrange data (pixels)
+        width = 3; height = _width * _height;
+        bufferInSize = width * height * sizeof (cl_ushort);
+        bufferOutSize = width * height * sizeof (cl_float) / 3;
+        staging = _staging;
+
+        try
+        {
+            if (height == 0)
+                throw "The image cannot have zeroed dimensions";
+            if (height % 3 != 0)
+                throw "The number of pixels in the image must be a multiple of 3";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        size_t wgM = wgMultiple;
+        while (height % (3 * wgM) != 0) wgM >>= 1;
+
+        // Set workspaces
+        global = cl::NDRange (height);
+        local = cl::NDRange (3 * wgM);
+
+        if (local[0] % wgMultiple)
+            std::cout << "Warning[SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>]: "
+                      << "The work-group size [" << local[0] 
+                      << "] is not a multiple of the preferred size [" 
+                      << wgMultiple << "] on this device" << std::endl;
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOutR = nullptr;
+                hPtrOutG = nullptr;
+                hPtrOutB = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+
+                hPtrIn = (cl_ushort *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOutR = nullptr;
+                    hPtrOutG = nullptr;
+                    hPtrOutB = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOutR () == nullptr)
+                    hBufferOutR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                if (hBufferOutG () == nullptr)
+                    hBufferOutG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                if (hBufferOutB () == nullptr)
+                    hBufferOutB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+
+                hPtrOutR = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOutR, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                hPtrOutG = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOutG, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                hPtrOutB = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOutB, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                queue.enqueueUnmapMemObject (hBufferOutR, hPtrOutR);
+                queue.enqueueUnmapMemObject (hBufferOutG, hPtrOutG);
+                queue.enqueueUnmapMemObject (hBufferOutB, hPtrOutB);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferOutR () == nullptr)
+            dBufferOutR = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+        if (dBufferOutG () == nullptr)
+            dBufferOutG = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+        if (dBufferOutB () == nullptr)
+            dBufferOutB = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+
+        // Set kernel arguments
+        kernel.setArg (0, dBufferIn);
+        kernel.setArg (1, dBufferOutR);
+        kernel.setArg (2, dBufferOutG);
+        kernel.setArg (3, dBufferOutB);
+        kernel.setArg (4, cl::Local (3 * local[0] * sizeof (cl_ushort)));
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::write (
+        SeparateRGB::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case SeparateRGB::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::read (
+        SeparateRGB::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case SeparateRGB::Memory::H_OUT_R:
+                    queue.enqueueReadBuffer (dBufferOutR, block, 0, bufferOutSize, hPtrOutR, events, event);
+                    return hPtrOutR;
+                case SeparateRGB::Memory::H_OUT_G:
+                    queue.enqueueReadBuffer (dBufferOutG, block, 0, bufferOutSize, hPtrOutG, events, event);
+                    return hPtrOutG;
+                case SeparateRGB::Memory::H_OUT_B:
+                    queue.enqueueReadBuffer (dBufferOutB, block, 0, bufferOutSize, hPtrOutB, events, event);
+                    return hPtrOutB;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernel, cl::NullRange, global, local, deps, node);
+    }
+
+
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
     CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::CombineRGB (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+        counters ("CombineRGB<CombineRGBConfig::FLOAT_FLOAT>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
         kernel (env.getProgram (info.pgIdx), "combineRGBChannels_Float2Float")
     {
         wgMultiple = kernel.getWorkGroupInfo
@@ -621,11 +889,11 @@ namespace GF
 
             case Staging::I:
                 if (hBufferInR () == nullptr)
-                    hBufferInR = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferInR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
                 if (hBufferInG () == nullptr)
-                    hBufferInG = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferInG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
                 if (hBufferInB () == nullptr)
-                    hBufferInB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferInB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
                 hPtrInR = (cl_float *) queue.enqueueMapBuffer (
                     hBufferInR, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
@@ -646,7 +914,7 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
                 hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
@@ -664,13 +932,13 @@ namespace GF
         
         // Create device buffers
         if (dBufferInR () == nullptr)
-            dBufferInR = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferInR = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferInG () == nullptr)
-            dBufferInG = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferInG = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferInB () == nullptr)
-            dBufferInB = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferInB = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferInR);
@@ -755,17 +1023,31 @@ namespace GF
      */
     void CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
     }
 
 
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernel, cl::NullRange, global, local, deps, node);
+    }
+
+
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
     CombineRGB<CombineRGBConfig::FLOAT_UCHAR>::CombineRGB (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+        counters ("CombineRGB<CombineRGBConfig::FLOAT_UCHAR>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
         kernel (env.getProgram (info.pgIdx), "combineRGBChannels_Float2Uchar")
     {
         wgMultiple = kernel.getWorkGroupInfo
@@ -862,11 +1144,11 @@ namespace GF
 
             case Staging::I:
                 if (hBufferInR () == nullptr)
-                    hBufferInR = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferInR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
                 if (hBufferInG () == nullptr)
-                    hBufferInG = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferInG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
                 if (hBufferInB () == nullptr)
-                    hBufferInB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferInB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
                 hPtrInR = (cl_float *) queue.enqueueMapBuffer (
                     hBufferInR, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
@@ -887,7 +1169,7 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
                 hPtrOut = (cl_uchar *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
@@ -905,13 +1187,13 @@ namespace GF
         
         // Create device buffers
         if (dBufferInR () == nullptr)
-            dBufferInR = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferInR = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferInG () == nullptr)
-            dBufferInG = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferInG = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferInB () == nullptr)
-            dBufferInB = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferInB = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferInR);
@@ -996,6 +1278,7 @@ namespace GF
      */
     void CombineRGB<CombineRGBConfig::FLOAT_UCHAR>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
     }
 
@@ -1003,12 +1286,14 @@ namespace GF
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    Depth<DepthConfig::USHORT_FLOAT>::Depth (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    CombineRGB<CombineRGBConfig::FLOAT_USHORT>::CombineRGB (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("CombineRGB<CombineRGBConfig::FLOAT_USHORT>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "depth_Ushort2Float")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "combineRGBChannels_Float2Ushort")
     {
+        wgMultiple = kernel.getWorkGroupInfo
+            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
     }
 
 
@@ -1017,17 +1302,25 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& Depth<DepthConfig::USHORT_FLOAT>::get (Depth::Memory mem)
+    cl::Memory& CombineRGB<CombineRGBConfig::FLOAT_USHORT>::get (CombineRGB::Memory mem)
     {
         switch (mem)
         {
-            case Depth::Memory::H_IN:
-                return hBufferIn;
-            case Depth::Memory::H_OUT:
+            case CombineRGB::Memory::H_IN_R:
+                return hBufferInR;
+            case CombineRGB::Memory::H_IN_G:
+                return hBufferInG;
+            case CombineRGB::Memory::H_IN_B:
+                return hBufferInB;
+            case CombineRGB::Memory::H_OUT:
                 return hBufferOut;
-            case Depth::Memory::D_IN:
-                return dBufferIn;
-            case Depth::Memory::D_OUT:
+            case CombineRGB::Memory::D_IN_R:
+                return dBufferInR;
+            case CombineRGB::Memory::D_IN_G:
+                return dBufferInG;
+            case CombineRGB::Memory::D_IN_B:
+                return dBufferInB;
+            case CombineRGB::Memory::D_OUT:
                 return dBufferOut;
         }
     }
@@ -1038,43 +1331,53 @@ namespace GF
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
      *        
-     *  \param[in] _width width of the array to be processed.
-     *  \param[in] _height height of the array to be processed.
-     *  \param[in] _scaling factor by which to scale the depth values in the output array.
+     *  \param[in] _width width (\#pixels/row) of the array to be processed.
+     *  \param[in] _height height (\#pixels/column) of the array to be processed.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void Depth<DepthConfig::USHORT_FLOAT>::init (unsigned int _width, unsigned int _height, 
-                                                 float _scaling, Staging _staging)
+    void CombineRGB<CombineRGBConfig::FLOAT_USHORT>::init (
+        unsigned int _width, unsigned int _height, Staging _staging)
     {
-        length = _width * _height;
-        bufferInSize = length * sizeof (cl_ushort);
-        bufferOutSize = length * sizeof (cl_float);
-        scaling = _scaling;
+        // Logically rearrange data (pixels)
+        width = _width * _height; height = 3;
+        bufferInSize = width * height * sizeof (cl_float) / 3;
+        bufferOutSize = width * height * sizeof (cl_ushort);
         staging = _staging;
 
         try
         {
-            if (length == 0)
+            if (width == 0)
                 throw "The image cannot have zeroed dimensions";
-
-            if (length % 4 != 0)
-                throw "The number of elements in the array has to be a multiple of 4";
+            if (width % 3 != 0)
+                throw "The number of pixels in the image must be a multiple of 3";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[Depth<DepthConfig::USHORT_FLOAT>]: " << error << std::endl;
+            std::cerr << "Error[CombineRGB<CombineRGBConfig::FLOAT_USHORT>]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
+        size_t wgM = wgMultiple;
+        while (width % (3 * wgM) != 0) wgM >>= 1;
+
         // Set workspaces
-        global = cl::NDRange (length / 4);
+        global = cl::NDRange (width);
+        local = cl::NDRange (3 * wgM);
+
+        if (local[0] % wgMultiple)
+            std::cout << "Warning[CombineRGB<CombineRGBConfig::FLOAT_USHORT>]: "
+                      << "The work-group size [" << local[0] 
+                      << "] is not a multiple of the preferred size [" 
+                      << wgMultiple << "] on this device" << std::endl;
 
         // Create staging buffers
         bool io = false;
         switch (staging)
         {
             case Staging::NONE:
-                hPtrIn = nullptr;
+                hPtrInR = nullptr;
+                hPtrInG = nullptr;
+                hPtrInB = nullptr;
                 hPtrOut = nullptr;
                 break;
 
@@ -1082,12 +1385,22 @@ namespace GF
                 io = true;
 
             case Staging::I:
-                if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferInR () == nullptr)
+                    hBufferInR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferInG () == nullptr)
+                    hBufferInG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferInB () == nullptr)
+                    hBufferInB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
-                hPtrIn = (cl_ushort *) queue.enqueueMapBuffer (
-                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
-                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+                hPtrInR = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInR, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                hPtrInG = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInG, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                hPtrInB = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInB, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                queue.enqueueUnmapMemObject (hBufferInR, hPtrInR);
+                queue.enqueueUnmapMemObject (hBufferInG, hPtrInG);
+                queue.enqueueUnmapMemObject (hBufferInB, hPtrInB);
 
                 if (!io)
                 {
@@ -1098,27 +1411,38 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                hPtrOut = (cl_ushort *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
                 queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                 queue.finish ();
 
-                if (!io) hPtrIn = nullptr;
+                if (!io)
+                {
+                    hPtrInR = nullptr;
+                    hPtrInG = nullptr;
+                    hPtrInB = nullptr;
+                }
                 break;
         }
         
         // Create device buffers
-        if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferInR () == nullptr)
+            dBufferInR = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferInG () == nullptr)
+            dBufferInG = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferInB () == nullptr)
+            dBufferInB = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
-        kernel.setArg (0, dBufferIn);
-        kernel.setArg (1, dBufferOut);
-        kernel.setArg (2, scaling);
+        kernel.setArg (0, dBufferInR);
+        kernel.setArg (1, dBufferInG);
+        kernel.setArg (2, dBufferInB);
+        kernel.setArg (3, dBufferOut);
+        kernel.setArg (4, cl::Local (3 * local[0] * sizeof (cl_float)));
     }
 
 
@@ -1133,17 +1457,27 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void Depth<DepthConfig::USHORT_FLOAT>::write (
-        Depth::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    void CombineRGB<CombineRGBConfig::FLOAT_USHORT>::write (
+        CombineRGB::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case Depth::Memory::D_IN:
+                case CombineRGB::Memory::D_IN_R:
                     if (ptr != nullptr)
-                        std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + length, hPtrIn);
-                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + bufferInSize / sizeof (cl_float), hPtrInR);
+                    queue.enqueueWriteBuffer (dBufferInR, block, 0, bufferInSize, hPtrInR, events, event);
+                    break;
+                case CombineRGB::Memory::D_IN_G:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + bufferInSize / sizeof (cl_float), hPtrInG);
+                    queue.enqueueWriteBuffer (dBufferInG, block, 0, bufferInSize, hPtrInG, events, event);
+                    break;
+                case CombineRGB::Memory::D_IN_B:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + bufferInSize / sizeof (cl_float), hPtrInB);
+                    queue.enqueueWriteBuffer (dBufferInB, block, 0, bufferInSize, hPtrInB, events, event);
                     break;
                 default:
                     break;
@@ -1161,14 +1495,14 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* Depth<DepthConfig::USHORT_FLOAT>::read (
-        Depth::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    void* CombineRGB<CombineRGBConfig::FLOAT_USHORT>::read (
+        CombineRGB::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case Depth::Memory::H_OUT:
+                case CombineRGB::Memory::H_OUT:
                     queue.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
@@ -1184,39 +1518,34 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the last kernel execution.
      */
-    void Depth<DepthConfig::USHORT_FLOAT>::run (const std::vector<cl::Event> *events, cl::Event *event)
-    {
-        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
-    }
-
-
-    /*! \return The scaling factor.
-     */
-    float Depth<DepthConfig::USHORT_FLOAT>::getScaling ()
+    void CombineRGB<CombineRGBConfig::FLOAT_USHORT>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        return scaling;
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
     }
 
 
-    /*! \details Updates the kernel argument for the scaling factor.
+    /*! \details The kernels are recorded as `run` would enqueue them.
      *
-     *  \param[in] _scaling scaling factor.
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
      */
-    void Depth<DepthConfig::USHORT_FLOAT>::setScaling (float _scaling)
+    void CombineRGB<CombineRGBConfig::FLOAT_USHORT>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
     {
-        scaling = _scaling;
-        kernel.setArg (3, scaling);
+        graph.add (queue, kernel, cl::NullRange, global, local, deps, node);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    DepthTo3D::DepthTo3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    Depth<DepthConfig::USHORT_FLOAT>::Depth (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("Depth<DepthConfig::USHORT_FLOAT>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "depthTo3D")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "depth_Ushort2Float")
     {
     }
 
@@ -1226,17 +1555,17 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& DepthTo3D::get (DepthTo3D::Memory mem)
+    cl::Memory& Depth<DepthConfig::USHORT_FLOAT>::get (Depth::Memory mem)
     {
         switch (mem)
         {
-            case DepthTo3D::Memory::H_IN:
+            case Depth::Memory::H_IN:
                 return hBufferIn;
-            case DepthTo3D::Memory::H_OUT:
+            case Depth::Memory::H_OUT:
                 return hBufferOut;
-            case DepthTo3D::Memory::D_IN:
+            case Depth::Memory::D_IN:
                 return dBufferIn;
-            case DepthTo3D::Memory::D_OUT:
+            case Depth::Memory::D_OUT:
                 return dBufferOut;
         }
     }
@@ -1249,31 +1578,34 @@ namespace GF
      *        
      *  \param[in] _width width of the array to be processed.
      *  \param[in] _height height of the array to be processed.
-     *  \param[in] _f focal length.
-     *  \param[in] _scaling factor by which to scale the depth values before building the point cloud.
+     *  \param[in] _scaling factor by which to scale the depth values in the output array.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void DepthTo3D::init (unsigned int _width, unsigned int _height, float _f, float _scaling, Staging _staging)
+    void Depth<DepthConfig::USHORT_FLOAT>::init (unsigned int _width, unsigned int _height, 
+                                                 float _scaling, Staging _staging)
     {
-        width = _width; height = _height; f = _f;
-        bufferInSize = width * height * sizeof (cl_float);
-        bufferOutSize = width * height * sizeof (cl_float4);
+        length = _width * _height;
+        bufferInSize = length * sizeof (cl_ushort);
+        bufferOutSize = length * sizeof (cl_float);
         scaling = _scaling;
         staging = _staging;
 
         try
         {
-            if ((width == 0) || (height == 0))
+            if (length == 0)
                 throw "The image cannot have zeroed dimensions";
+
+            if (length % 4 != 0)
+                throw "The number of elements in the array has to be a multiple of 4";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[DepthTo3D]: " << error << std::endl;
+            std::cerr << "Error[Depth<DepthConfig::USHORT_FLOAT>]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
         // Set workspaces
-        global = cl::NDRange (width, height);
+        global = cl::NDRange (length / 4);
 
         // Create staging buffers
         bool io = false;
@@ -1289,9 +1621,9 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
-                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                hPtrIn = (cl_ushort *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
                 queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
@@ -1304,9 +1636,9 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                hPtrOut = (cl_float4 *) queue.enqueueMapBuffer (
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
                 queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                 queue.finish ();
@@ -1317,15 +1649,14 @@ namespace GF
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferIn);
         kernel.setArg (1, dBufferOut);
-        kernel.setArg (2, f);
-        kernel.setArg (3, scaling);
+        kernel.setArg (2, scaling);
     }
 
 
@@ -1340,16 +1671,16 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void DepthTo3D::write (DepthTo3D::Memory mem, void *ptr, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void Depth<DepthConfig::USHORT_FLOAT>::write (
+        Depth::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case DepthTo3D::Memory::D_IN:
+                case Depth::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                        std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + length, hPtrIn);
                     queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
                     break;
                 default:
@@ -1368,14 +1699,14 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* DepthTo3D::read (DepthTo3D::Memory mem, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void* Depth<DepthConfig::USHORT_FLOAT>::read (
+        Depth::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case DepthTo3D::Memory::H_OUT:
+                case Depth::Memory::H_OUT:
                     queue.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
@@ -1391,34 +1722,29 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the last kernel execution.
      */
-    void DepthTo3D::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void Depth<DepthConfig::USHORT_FLOAT>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
-    /*! \return The focal length of the camera used.
-     */
-    float DepthTo3D::getFocalLength ()
-    {
-        return f;
-    }
-
-
-    /*! \details Updates the kernel argument for the focal length.
+    /*! \details The kernels are recorded as `run` would enqueue them.
      *
-     *  \param[in] _f the focal length.
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
      */
-    void DepthTo3D::setFocalLength (float _f)
+    void Depth<DepthConfig::USHORT_FLOAT>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
     {
-        f = _f;
-        kernel.setArg (2, f);
+        graph.add (queue, kernel, cl::NullRange, global, cl::NullRange, deps, node);
     }
 
 
     /*! \return The scaling factor.
      */
-    float DepthTo3D::getScaling ()
+    float Depth<DepthConfig::USHORT_FLOAT>::getScaling ()
     {
         return scaling;
     }
@@ -1428,24 +1754,22 @@ namespace GF
      *
      *  \param[in] _scaling scaling factor.
      */
-    void DepthTo3D::setScaling (float _scaling)
+    void Depth<DepthConfig::USHORT_FLOAT>::setScaling (float _scaling)
     {
         scaling = _scaling;
-        kernel.setArg (4, scaling);
+        kernel.setArg (2, scaling);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    RGBDTo8D::RGBDTo8D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    Depth<DepthConfig::FLOAT_USHORT>::Depth (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("Depth<DepthConfig::FLOAT_USHORT>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "rgbdTo8D")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "depth_Float2Ushort")
     {
-        wgMultiple = kernel.getWorkGroupInfo
-            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
     }
 
 
@@ -1454,29 +1778,17 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& RGBDTo8D::get (RGBDTo8D::Memory mem)
+    cl::Memory& Depth<DepthConfig::FLOAT_USHORT>::get (Depth::Memory mem)
     {
         switch (mem)
         {
-            case RGBDTo8D::Memory::H_IN_D:
-                return hBufferInD;
-            case RGBDTo8D::Memory::H_IN_R:
-                return hBufferInR;
-            case RGBDTo8D::Memory::H_IN_G:
-                return hBufferInG;
-            case RGBDTo8D::Memory::H_IN_B:
-                return hBufferInB;
-            case RGBDTo8D::Memory::H_OUT:
+            case Depth::Memory::H_IN:
+                return hBufferIn;
+            case Depth::Memory::H_OUT:
                 return hBufferOut;
-            case RGBDTo8D::Memory::D_IN_D:
-                return dBufferInD;
-            case RGBDTo8D::Memory::D_IN_R:
-                return dBufferInR;
-            case RGBDTo8D::Memory::D_IN_G:
-                return dBufferInG;
-            case RGBDTo8D::Memory::D_IN_B:
-                return dBufferInB;
-            case RGBDTo8D::Memory::D_OUT:
+            case Depth::Memory::D_IN:
+                return dBufferIn;
+            case Depth::Memory::D_OUT:
                 return dBufferOut;
         }
     }
@@ -1489,56 +1801,41 @@ namespace GF
      *        
      *  \param[in] _width width of the array to be processed.
      *  \param[in] _height height of the array to be processed.
-     *  \param[in] _f focal length.
-     *  \param[in] _scaling factor by which to scale the depth values before building the point cloud.
-     *  \param[in] _rgbNorm flag to indicate whether to perform RGB normalization.
+     *  \param[in] _scaling factor by which to scale the values before the conversion.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void RGBDTo8D::init (unsigned int _width, unsigned int _height, float _f, float _scaling, int _rgbNorm, Staging _staging)
+    void Depth<DepthConfig::FLOAT_USHORT>::init (unsigned int _width, unsigned int _height, 
+                                                 float _scaling, Staging _staging)
     {
-        width = _width; height = _height; f = _f;
-        points = width * height;
-        bufferInSize = points * sizeof (cl_float);
-        bufferOutSize = points * sizeof (cl_float8);
+        length = _width * _height;
+        bufferInSize = length * sizeof (cl_float);
+        bufferOutSize = length * sizeof (cl_ushort);
         scaling = _scaling;
-        rgbNorm = _rgbNorm;
         staging = _staging;
 
         try
         {
-            if (points == 0)
+            if (length == 0)
                 throw "The image cannot have zeroed dimensions";
-            if (points % 3 != 0)
-                throw "The number of pixels in the images must be a multiple of 3";
+
+            if (length % 4 != 0)
+                throw "The number of elements in the array has to be a multiple of 4";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[RGBDTo8D]: " << error << std::endl;
+            std::cerr << "Error[Depth<DepthConfig::FLOAT_USHORT>]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
-        size_t wgM = wgMultiple;
-        while (points % (3 * wgM) != 0) wgM >>= 1;
-
         // Set workspaces
-        global = cl::NDRange (points);
-        local = cl::NDRange (3 * wgM);
-
-        if (local[0] % wgMultiple)
-            std::cout << "Warning[RGBDTo8D]: "
-                      << "The work-group size [" << local[0] 
-                      << "] is not a multiple of the preferred size [" 
-                      << wgMultiple << "] on this device" << std::endl;
+        global = cl::NDRange (length / 4);
 
         // Create staging buffers
         bool io = false;
         switch (staging)
         {
             case Staging::NONE:
-                hPtrInD = nullptr;
-                hPtrInR = nullptr;
-                hPtrInG = nullptr;
-                hPtrInB = nullptr;
+                hPtrIn = nullptr;
                 hPtrOut = nullptr;
                 break;
 
@@ -1546,27 +1843,12 @@ namespace GF
                 io = true;
 
             case Staging::I:
-                if (hBufferInD () == nullptr)
-                    hBufferInD = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
-                if (hBufferInR () == nullptr)
-                    hBufferInR = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
-                if (hBufferInG () == nullptr)
-                    hBufferInG = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
-                if (hBufferInB () == nullptr)
-                    hBufferInB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
-                hPtrInD = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferInD, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
-                hPtrInR = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferInR, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
-                hPtrInG = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferInG, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
-                hPtrInB = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferInB, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
-                queue.enqueueUnmapMemObject (hBufferInD, hPtrInD);
-                queue.enqueueUnmapMemObject (hBufferInR, hPtrInR);
-                queue.enqueueUnmapMemObject (hBufferInG, hPtrInG);
-                queue.enqueueUnmapMemObject (hBufferInB, hPtrInB);
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
                 if (!io)
                 {
@@ -1577,46 +1859,27 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                hPtrOut = (cl_float8 *) queue.enqueueMapBuffer (
+                hPtrOut = (cl_ushort *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
                 queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                 queue.finish ();
 
-                if (!io)
-                {
-                    hPtrInD = nullptr;
-                    hPtrInR = nullptr;
-                    hPtrInG = nullptr;
-                    hPtrInB = nullptr;
-                }
+                if (!io) hPtrIn = nullptr;
                 break;
         }
         
         // Create device buffers
-        if (dBufferInD () == nullptr)
-            dBufferInD = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
-        if (dBufferInR () == nullptr)
-            dBufferInR = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
-        if (dBufferInG () == nullptr)
-            dBufferInG = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
-        if (dBufferInB () == nullptr)
-            dBufferInB = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
-        kernel.setArg (0, dBufferInD);
-        kernel.setArg (1, dBufferInR);
-        kernel.setArg (2, dBufferInG);
-        kernel.setArg (3, dBufferInB);
-        kernel.setArg (4, dBufferOut);
-        kernel.setArg (5, cl::Local (3 * local[0] * sizeof (cl_float)));
-        kernel.setArg (6, width);
-        kernel.setArg (7, f);
-        kernel.setArg (8, scaling);
-        kernel.setArg (9, rgbNorm);
+        kernel.setArg (0, dBufferIn);
+        kernel.setArg (1, dBufferOut);
+        kernel.setArg (2, scaling);
     }
 
 
@@ -1631,32 +1894,17 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void RGBDTo8D::write (RGBDTo8D::Memory mem, void *ptr, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void Depth<DepthConfig::FLOAT_USHORT>::write (
+        Depth::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case RGBDTo8D::Memory::D_IN_D:
-                    if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInD);
-                    queue.enqueueWriteBuffer (dBufferInD, block, 0, bufferInSize, hPtrInD, events, event);
-                    break;
-                case RGBDTo8D::Memory::D_IN_R:
-                    if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInR);
-                    queue.enqueueWriteBuffer (dBufferInR, block, 0, bufferInSize, hPtrInR, events, event);
-                    break;
-                case RGBDTo8D::Memory::D_IN_G:
-                    if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInG);
-                    queue.enqueueWriteBuffer (dBufferInG, block, 0, bufferInSize, hPtrInG, events, event);
-                    break;
-                case RGBDTo8D::Memory::D_IN_B:
+                case Depth::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInB);
-                    queue.enqueueWriteBuffer (dBufferInB, block, 0, bufferInSize, hPtrInB, events, event);
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + length, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
                     break;
                 default:
                     break;
@@ -1674,14 +1922,14 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* RGBDTo8D::read (RGBDTo8D::Memory mem, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void* Depth<DepthConfig::FLOAT_USHORT>::read (
+        Depth::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case RGBDTo8D::Memory::H_OUT:
+                case Depth::Memory::H_OUT:
                     queue.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
@@ -1697,32 +1945,29 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the last kernel execution.
      */
-    void RGBDTo8D::run (const std::vector<cl::Event> *events, cl::Event *event)
-    {
-        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
-    }
-
-
-    /*! \return The focal length of the camera used. */
-    float RGBDTo8D::getFocalLength ()
+    void Depth<DepthConfig::FLOAT_USHORT>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        return f;
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
-    /*! \details Updates the kernel argument for the focal length.
+    /*! \details The kernels are recorded as `run` would enqueue them.
      *
-     *  \param[in] _f the focal length.
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
      */
-    void RGBDTo8D::setFocalLength (float _f)
+    void Depth<DepthConfig::FLOAT_USHORT>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
     {
-        f = _f;
-        kernel.setArg (7, f);
+        graph.add (queue, kernel, cl::NullRange, global, cl::NullRange, deps, node);
     }
 
 
-    /*! \return The scaling factor. */
-    float RGBDTo8D::getScaling ()
+    /*! \return The scaling factor.
+     */
+    float Depth<DepthConfig::FLOAT_USHORT>::getScaling ()
     {
         return scaling;
     }
@@ -1732,39 +1977,21 @@ namespace GF
      *
      *  \param[in] _scaling scaling factor.
      */
-    void RGBDTo8D::setScaling (float _scaling)
+    void Depth<DepthConfig::FLOAT_USHORT>::setScaling (float _scaling)
     {
         scaling = _scaling;
-        kernel.setArg (8, scaling);
-    }
-
-
-    /*! \return The flag for RGB normalization. */
-    int RGBDTo8D::getRGBNorm ()
-    {
-        return rgbNorm;
-    }
-
-
-    /*! \details Updates the flag for RGB normalization.
-     *
-     *  \param[in] _rgbNorm flag that indicates whether to perform RGB normalization.
-     */
-    void RGBDTo8D::setRGBNorm (int _rgbNorm)
-    {
-        rgbNorm = _rgbNorm;
-        kernel.setArg (9, rgbNorm);
+        kernel.setArg (2, scaling);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    SplitPC8D::SplitPC8D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    DepthTo3D::DepthTo3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("DepthTo3D"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "splitPC8D")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "depthTo3D")
     {
     }
 
@@ -1774,22 +2001,18 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& SplitPC8D::get (SplitPC8D::Memory mem)
+    cl::Memory& DepthTo3D::get (DepthTo3D::Memory mem)
     {
         switch (mem)
         {
-            case SplitPC8D::Memory::H_IN:
+            case DepthTo3D::Memory::H_IN:
                 return hBufferIn;
-            case SplitPC8D::Memory::H_OUT_PC4D:
-                return hBufferOutPC4D;
-            case SplitPC8D::Memory::H_OUT_RGBA:
-                return hBufferOutRGBA;
-            case SplitPC8D::Memory::D_IN:
+            case DepthTo3D::Memory::H_OUT:
+                return hBufferOut;
+            case DepthTo3D::Memory::D_IN:
                 return dBufferIn;
-            case SplitPC8D::Memory::D_OUT_PC4D:
-                return dBufferOutPC4D;
-            case SplitPC8D::Memory::D_OUT_RGBA:
-                return dBufferOutRGBA;
+            case DepthTo3D::Memory::D_OUT:
+                return dBufferOut;
         }
     }
 
@@ -1799,35 +2022,33 @@ namespace GF
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
      *        
-     *  \param[in] _n number of points in the point cloud.
-     *  \param[in] _offset number of points to skip in the output arrays. The kernel will 
-     *                     write in the output arrays starting at position `_offset` (`cl\_float4` 
-     *                     types are considered). Use the maximum offset you expect to need, so 
-     *                     the required memory can be allocated. You can change it afterwards 
-     *                     dynamically to the one required at any moment.
+     *  \param[in] _width width of the array to be processed.
+     *  \param[in] _height height of the array to be processed.
+     *  \param[in] _f focal length.
+     *  \param[in] _scaling factor by which to scale the depth values before building the point cloud.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void SplitPC8D::init (unsigned int _n, unsigned int _offset, Staging _staging)
+    void DepthTo3D::init (unsigned int _width, unsigned int _height, float _f, float _scaling, Staging _staging)
     {
-        n = _n;
-        offset = _offset;
-        bufferInSize = n * sizeof (cl_float8);
-        bufferOutSize = (offset + n) * sizeof (cl_float4);
+        width = _width; height = _height; f = _f;
+        bufferInSize = width * height * sizeof (cl_float);
+        bufferOutSize = width * height * sizeof (cl_float4);
+        scaling = _scaling;
         staging = _staging;
 
         try
         {
-            if (n == 0)
-                throw "The point cloud cannot be empty";
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[SplitPC8D]: " << error << std::endl;
+            std::cerr << "Error[DepthTo3D]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
-        // Set workspace
-        global = cl::NDRange (n);
+        // Set workspaces
+        global = cl::NDRange (width, height);
 
         // Create staging buffers
         bool io = false;
@@ -1835,8 +2056,7 @@ namespace GF
         {
             case Staging::NONE:
                 hPtrIn = nullptr;
-                hPtrOutPC4D = nullptr;
-                hPtrOutRGBA = nullptr;
+                hPtrOut = nullptr;
                 break;
 
             case Staging::IO:
@@ -1844,7 +2064,7 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
                 hPtrIn = (cl_float *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
@@ -1853,23 +2073,17 @@ namespace GF
                 if (!io)
                 {
                     queue.finish ();
-                    hPtrOutPC4D = nullptr;
-                    hPtrOutRGBA = nullptr;
+                    hPtrOut = nullptr;
                     break;
                 }
 
             case Staging::O:
-                if (hBufferOutPC4D () == nullptr)
-                    hBufferOutPC4D = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
-                if (hBufferOutRGBA () == nullptr)
-                    hBufferOutRGBA = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                hPtrOutPC4D = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferOutPC4D, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
-                hPtrOutRGBA = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferOutRGBA, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
-                queue.enqueueUnmapMemObject (hBufferOutPC4D, hPtrOutPC4D);
-                queue.enqueueUnmapMemObject (hBufferOutRGBA, hPtrOutRGBA);
+                hPtrOut = (cl_float4 *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                 queue.finish ();
 
                 if (!io) hPtrIn = nullptr;
@@ -1878,17 +2092,15 @@ namespace GF
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
-        if (dBufferOutPC4D () == nullptr)
-            dBufferOutPC4D = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
-        if (dBufferOutRGBA () == nullptr)
-            dBufferOutRGBA = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferIn);
-        kernel.setArg (1, dBufferOutPC4D);
-        kernel.setArg (2, dBufferOutRGBA);
-        kernel.setArg (3, offset);
+        kernel.setArg (1, dBufferOut);
+        kernel.setArg (2, f);
+        kernel.setArg (3, scaling);
     }
 
 
@@ -1903,16 +2115,16 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void SplitPC8D::write (SplitPC8D::Memory mem, void *ptr, bool block, 
+    void DepthTo3D::write (DepthTo3D::Memory mem, void *ptr, bool block, 
                            const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case SplitPC8D::Memory::D_IN:
+                case DepthTo3D::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float8 *) ptr, (cl_float8 *) ptr + n, (cl_float8 *) hPtrIn);
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
                     queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
                     break;
                 default:
@@ -1931,19 +2143,16 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* SplitPC8D::read (SplitPC8D::Memory mem, bool block, 
+    void* DepthTo3D::read (DepthTo3D::Memory mem, bool block, 
                            const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case SplitPC8D::Memory::H_OUT_PC4D:
-                    queue.enqueueReadBuffer (dBufferOutPC4D, block, 0, bufferOutSize, hPtrOutPC4D, events, event);
-                    return hPtrOutPC4D;
-                case SplitPC8D::Memory::H_OUT_RGBA:
-                    queue.enqueueReadBuffer (dBufferOutRGBA, block, 0, bufferOutSize, hPtrOutRGBA, events, event);
-                    return hPtrOutRGBA;
+                case DepthTo3D::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
+                    return hPtrOut;
                 default:
                     return nullptr;
             }
@@ -1957,40 +2166,62 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the last kernel execution.
      */
-    void SplitPC8D::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void DepthTo3D::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
-    /*! \return The offset.
+    /*! \return The focal length of the camera used.
      */
-    unsigned int SplitPC8D::getOffset ()
+    float DepthTo3D::getFocalLength ()
     {
-        return offset;
+        return f;
     }
 
 
-    /*! \details Updates the kernel argument for the offset.
+    /*! \details Updates the kernel argument for the focal length.
      *
-     *  \param[in] _offset the offset to set.
+     *  \param[in] _f the focal length.
      */
-    void SplitPC8D::setOffset (unsigned int _offset)
+    void DepthTo3D::setFocalLength (float _f)
     {
-        offset = _offset;
-        kernel.setArg (3, offset);
+        f = _f;
+        kernel.setArg (2, f);
+    }
+
+
+    /*! \return The scaling factor.
+     */
+    float DepthTo3D::getScaling ()
+    {
+        return scaling;
+    }
+
+
+    /*! \details Updates the kernel argument for the scaling factor.
+     *
+     *  \param[in] _scaling scaling factor.
+     */
+    void DepthTo3D::setScaling (float _scaling)
+    {
+        scaling = _scaling;
+        kernel.setArg (4, scaling);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    RGBNorm::RGBNorm (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    RGBDTo8D::RGBDTo8D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("RGBDTo8D"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "rgbNorm")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "rgbdTo8D")
     {
+        wgMultiple = kernel.getWorkGroupInfo
+            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
     }
 
 
@@ -1999,17 +2230,29 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& RGBNorm::get (RGBNorm::Memory mem)
+    cl::Memory& RGBDTo8D::get (RGBDTo8D::Memory mem)
     {
         switch (mem)
         {
-            case RGBNorm::Memory::H_IN:
-                return hBufferIn;
-            case RGBNorm::Memory::H_OUT:
+            case RGBDTo8D::Memory::H_IN_D:
+                return hBufferInD;
+            case RGBDTo8D::Memory::H_IN_R:
+                return hBufferInR;
+            case RGBDTo8D::Memory::H_IN_G:
+                return hBufferInG;
+            case RGBDTo8D::Memory::H_IN_B:
+                return hBufferInB;
+            case RGBDTo8D::Memory::H_OUT:
                 return hBufferOut;
-            case RGBNorm::Memory::D_IN:
-                return dBufferIn;
-            case RGBNorm::Memory::D_OUT:
+            case RGBDTo8D::Memory::D_IN_D:
+                return dBufferInD;
+            case RGBDTo8D::Memory::D_IN_R:
+                return dBufferInR;
+            case RGBDTo8D::Memory::D_IN_G:
+                return dBufferInG;
+            case RGBDTo8D::Memory::D_IN_B:
+                return dBufferInB;
+            case RGBDTo8D::Memory::D_OUT:
                 return dBufferOut;
         }
     }
@@ -2020,37 +2263,58 @@ namespace GF
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
      *        
-     *  \param[in] _width width (\#pixels/row) of the array to be processed.
-     *  \param[in] _height height (\#pixels/column) of the array to be processed.
+     *  \param[in] _width width of the array to be processed.
+     *  \param[in] _height height of the array to be processed.
+     *  \param[in] _f focal length.
+     *  \param[in] _scaling factor by which to scale the depth values before building the point cloud.
+     *  \param[in] _rgbNorm flag to indicate whether to perform RGB normalization.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void RGBNorm::init (unsigned int _width, unsigned int _height, Staging _staging)
+    void RGBDTo8D::init (unsigned int _width, unsigned int _height, float _f, float _scaling, int _rgbNorm, Staging _staging)
     {
-        // Logically rearrange data (pixels)
-        width = _width; height = _height;
-        bufferSize = 3 * width * height * sizeof (cl_float);
+        width = _width; height = _height; f = _f;
+        points = width * height;
+        bufferInSize = points * sizeof (cl_float);
+        bufferOutSize = points * sizeof (cl_float8);
+        scaling = _scaling;
+        rgbNorm = _rgbNorm;
         staging = _staging;
 
         try
         {
-            if ((width == 0) || (height == 0))
+            if (points == 0)
                 throw "The image cannot have zeroed dimensions";
+            if (points % 3 != 0)
+                throw "The number of pixels in the images must be a multiple of 3";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[RGBNorm]: " << error << std::endl;
+            std::cerr << "Error[RGBDTo8D]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
+        size_t wgM = wgMultiple;
+        while (points % (3 * wgM) != 0) wgM >>= 1;
+
         // Set workspaces
-        global = cl::NDRange (width * height);
+        global = cl::NDRange (points);
+        local = cl::NDRange (3 * wgM);
+
+        if (local[0] % wgMultiple)
+            std::cout << "Warning[RGBDTo8D]: "
+                      << "The work-group size [" << local[0] 
+                      << "] is not a multiple of the preferred size [" 
+                      << wgMultiple << "] on this device" << std::endl;
 
         // Create staging buffers
         bool io = false;
         switch (staging)
         {
             case Staging::NONE:
-                hPtrIn = nullptr;
+                hPtrInD = nullptr;
+                hPtrInR = nullptr;
+                hPtrInG = nullptr;
+                hPtrInB = nullptr;
                 hPtrOut = nullptr;
                 break;
 
@@ -2058,12 +2322,27 @@ namespace GF
                 io = true;
 
             case Staging::I:
-                if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferInD () == nullptr)
+                    hBufferInD = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferInR () == nullptr)
+                    hBufferInR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferInG () == nullptr)
+                    hBufferInG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                if (hBufferInB () == nullptr)
+                    hBufferInB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
-                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
-                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+                hPtrInD = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInD, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                hPtrInR = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInR, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                hPtrInG = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInG, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                hPtrInB = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferInB, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                queue.enqueueUnmapMemObject (hBufferInD, hPtrInD);
+                queue.enqueueUnmapMemObject (hBufferInR, hPtrInR);
+                queue.enqueueUnmapMemObject (hBufferInG, hPtrInG);
+                queue.enqueueUnmapMemObject (hBufferInB, hPtrInB);
 
                 if (!io)
                 {
@@ -2074,26 +2353,46 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                hPtrOut = (cl_float8 *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
                 queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                 queue.finish ();
 
-                if (!io) hPtrIn = nullptr;
+                if (!io)
+                {
+                    hPtrInD = nullptr;
+                    hPtrInR = nullptr;
+                    hPtrInG = nullptr;
+                    hPtrInB = nullptr;
+                }
                 break;
         }
         
         // Create device buffers
-        if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferInD () == nullptr)
+            dBufferInD = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferInR () == nullptr)
+            dBufferInR = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferInG () == nullptr)
+            dBufferInG = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferInB () == nullptr)
+            dBufferInB = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
         // Set kernel arguments
-        kernel.setArg (0, dBufferIn);
-        kernel.setArg (1, dBufferOut);
+        kernel.setArg (0, dBufferInD);
+        kernel.setArg (1, dBufferInR);
+        kernel.setArg (2, dBufferInG);
+        kernel.setArg (3, dBufferInB);
+        kernel.setArg (4, dBufferOut);
+        kernel.setArg (5, cl::Local (3 * local[0] * sizeof (cl_float)));
+        kernel.setArg (6, width);
+        kernel.setArg (7, f);
+        kernel.setArg (8, scaling);
+        kernel.setArg (9, rgbNorm);
     }
 
 
@@ -2108,17 +2407,32 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void RGBNorm::write (RGBNorm::Memory mem, void *ptr, bool block, 
-                         const std::vector<cl::Event> *events, cl::Event *event)
+    void RGBDTo8D::write (RGBDTo8D::Memory mem, void *ptr, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case RGBNorm::Memory::D_IN:
+                case RGBDTo8D::Memory::D_IN_D:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + 3 * width * height, hPtrIn);
-                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInD);
+                    queue.enqueueWriteBuffer (dBufferInD, block, 0, bufferInSize, hPtrInD, events, event);
+                    break;
+                case RGBDTo8D::Memory::D_IN_R:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInR);
+                    queue.enqueueWriteBuffer (dBufferInR, block, 0, bufferInSize, hPtrInR, events, event);
+                    break;
+                case RGBDTo8D::Memory::D_IN_G:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInG);
+                    queue.enqueueWriteBuffer (dBufferInG, block, 0, bufferInSize, hPtrInG, events, event);
+                    break;
+                case RGBDTo8D::Memory::D_IN_B:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + points, hPtrInB);
+                    queue.enqueueWriteBuffer (dBufferInB, block, 0, bufferInSize, hPtrInB, events, event);
                     break;
                 default:
                     break;
@@ -2136,15 +2450,15 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* RGBNorm::read (RGBNorm::Memory mem, bool block, 
-                         const std::vector<cl::Event> *events, cl::Event *event)
+    void* RGBDTo8D::read (RGBDTo8D::Memory mem, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case RGBNorm::Memory::H_OUT:
-                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                case RGBDTo8D::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
                     return nullptr;
@@ -2159,25 +2473,76 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the last kernel execution.
      */
-    void RGBNorm::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void RGBDTo8D::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
+    }
+
+
+    /*! \return The focal length of the camera used. */
+    float RGBDTo8D::getFocalLength ()
+    {
+        return f;
+    }
+
+
+    /*! \details Updates the kernel argument for the focal length.
+     *
+     *  \param[in] _f the focal length.
+     */
+    void RGBDTo8D::setFocalLength (float _f)
+    {
+        f = _f;
+        kernel.setArg (7, f);
+    }
+
+
+    /*! \return The scaling factor. */
+    float RGBDTo8D::getScaling ()
+    {
+        return scaling;
+    }
+
+
+    /*! \details Updates the kernel argument for the scaling factor.
+     *
+     *  \param[in] _scaling scaling factor.
+     */
+    void RGBDTo8D::setScaling (float _scaling)
+    {
+        scaling = _scaling;
+        kernel.setArg (8, scaling);
+    }
+
+
+    /*! \return The flag for RGB normalization. */
+    int RGBDTo8D::getRGBNorm ()
+    {
+        return rgbNorm;
+    }
+
+
+    /*! \details Updates the flag for RGB normalization.
+     *
+     *  \param[in] _rgbNorm flag that indicates whether to perform RGB normalization.
+     */
+    void RGBDTo8D::setRGBNorm (int _rgbNorm)
+    {
+        rgbNorm = _rgbNorm;
+        kernel.setArg (9, rgbNorm);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    Scan::Scan (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    SplitPC8D::SplitPC8D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("SplitPC8D"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernelScan (env.getProgram (info.pgIdx), "inclusiveScan_f"), 
-        kernelSumsScan (env.getProgram (info.pgIdx), "inclusiveScan_f"), 
-        kernelAddSums (env.getProgram (info.pgIdx), "addGroupSums_f")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "splitPC8D")
     {
-        wgMultiple = kernelScan.getWorkGroupInfo
-            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
     }
 
 
@@ -2186,20 +2551,24 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& Scan::get (Scan::Memory mem)
+    cl::Memory& SplitPC8D::get (SplitPC8D::Memory mem)
     {
         switch (mem)
         {
-            case Scan::Memory::H_IN:
+            case SplitPC8D::Memory::H_IN:
                 return hBufferIn;
-            case Scan::Memory::H_OUT:
-                return hBufferOut;
-            case Scan::Memory::D_IN:
+            case SplitPC8D::Memory::H_OUT_PC4D:
+                return hBufferOutPC4D;
+            case SplitPC8D::Memory::H_OUT_RGBA:
+                return hBufferOutRGBA;
+            case SplitPC8D::Memory::D_IN:
                 return dBufferIn;
-            case Scan::Memory::D_SUMS:
-                return dBufferSums;
-            case Scan::Memory::D_OUT:
-                return dBufferOut;
+            case SplitPC8D::Memory::D_OUT_PC4D:
+                return dBufferOutPC4D;
+            case SplitPC8D::Memory::D_OUT_RGBA:
+                return dBufferOutRGBA;
+            case SplitPC8D::Memory::D_COUNT:
+                return dBufferCount;
         }
     }
 
@@ -2208,58 +2577,39 @@ namespace GF
      *  \note If you have assigned a memory object to one member variable of the class 
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
-     *  \note Working with `float` elements and having large summations can be problematic.
-     *        It is advised that a scaling is applied on the elements for better accuracy.
      *        
-     *  \param[in] _width width of the input array.
-     *  \param[in] _height height of the input array.
-     *  \param[in] _scaling factor by which to scale the array elements before processing.
+     *  \note If `D_COUNT` has been assigned a buffer, `_n` is the maximum number of 
+     *        points in the point cloud, and the actual number is read from `D_COUNT`.
+     *        
+     *  \param[in] _n number of points in the point cloud.
+     *  \param[in] _offset number of points to skip in the output arrays. The kernel will 
+     *                     write in the output arrays starting at position `_offset` (`cl\_float4` 
+     *                     types are considered). Use the maximum offset you expect to need, so 
+     *                     the required memory can be allocated. You can change it afterwards 
+     *                     dynamically to the one required at any moment.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void Scan::init (unsigned int _width, unsigned int _height, float _scaling, Staging _staging)
+    void SplitPC8D::init (unsigned int _n, unsigned int _offset, Staging _staging)
     {
-        width = _width; height = _height;
-        bufferSize = width * height * sizeof (cl_float);
-        scaling = _scaling;
+        n = _n;
+        offset = _offset;
+        bufferInSize = n * sizeof (cl_float8);
+        bufferOutSize = (offset + n) * sizeof (cl_float4);
         staging = _staging;
 
-        // Establish the number of work-groups per row
-        wgXdim = ceil (width / (float) (8 * wgMultiple));
-        // Round up to a multiple of 4 (data are handled as int4)
-        if ((wgXdim != 1) && (wgXdim % 4)) wgXdim += 4 - wgXdim % 4;
-
-        bufferSumsSize = wgXdim * height * sizeof (cl_float);
-
         try
         {
-            if (wgXdim == 0)
-                throw "The array cannot have zero columns";
-
-            if (width % 4 != 0)
-                throw "The number of columns in the array must be a multiple of 4";
-
-            // (8 * wgMultiple) elements per work-group
-            if (width > std::pow (8 * wgMultiple, 2))
-            {
-                std::ostringstream ss;
-                ss << "The current configuration of Scan supports arrays ";
-                ss << "of up to " << std::pow (8 * wgMultiple, 2) << " columns";
-                throw ss.str ().c_str ();
-            }
+            if (n == 0)
+                throw "The point cloud cannot be empty";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[Scan]: " << error << std::endl;
+            std::cerr << "Error[SplitPC8D]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
-        // Set workspaces
-        globalScan = cl::NDRange (wgXdim * wgMultiple, height);
-        localScan = cl::NDRange (wgMultiple, 1);
-        globalSumsScan = cl::NDRange (wgMultiple, height);
-        globalAddSums = cl::NDRange (2 * (wgXdim - 1) * wgMultiple, height);
-        localAddSums = cl::NDRange (2 * wgMultiple, 1);
-        offsetAddSums = cl::NDRange (2 * wgMultiple, 0);
+        // Set workspace
+        global = cl::NDRange (n);
 
         // Create staging buffers
         bool io = false;
@@ -2267,7 +2617,8 @@ namespace GF
         {
             case Staging::NONE:
                 hPtrIn = nullptr;
-                hPtrOut = nullptr;
+                hPtrOutPC4D = nullptr;
+                hPtrOutRGBA = nullptr;
                 break;
 
             case Staging::IO:
@@ -2275,26 +2626,32 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
                 hPtrIn = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
                 queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
                 if (!io)
                 {
                     queue.finish ();
-                    hPtrOut = nullptr;
+                    hPtrOutPC4D = nullptr;
+                    hPtrOutRGBA = nullptr;
                     break;
                 }
 
             case Staging::O:
-                if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferOutPC4D () == nullptr)
+                    hBufferOutPC4D = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                if (hBufferOutRGBA () == nullptr)
+                    hBufferOutRGBA = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
-                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
-                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                hPtrOutPC4D = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOutPC4D, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                hPtrOutRGBA = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOutRGBA, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                queue.enqueueUnmapMemObject (hBufferOutPC4D, hPtrOutPC4D);
+                queue.enqueueUnmapMemObject (hBufferOutRGBA, hPtrOutRGBA);
                 queue.finish ();
 
                 if (!io) hPtrIn = nullptr;
@@ -2303,42 +2660,23 @@ namespace GF
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
-        if (dBufferSums () == nullptr)
-            dBufferSums = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSumsSize);
-        if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-
-        // Set kernel arguments
-        if (wgXdim == 1)
-        {
-            kernelScan.setArg (0, dBufferIn);
-            kernelScan.setArg (1, dBufferOut);
-            kernelScan.setArg (2, cl::Local (2 * localScan[0] * sizeof (cl_float)));
-            kernelScan.setArg (3, dBufferSums);  // Unused
-            kernelScan.setArg (4, width / 4);
-            kernelScan.setArg (5, scaling);
-        }
-        else
-        {
-            kernelScan.setArg (0, dBufferIn);
-            kernelScan.setArg (1, dBufferOut);
-            kernelScan.setArg (2, cl::Local (2 * localScan[0] * sizeof (cl_float)));
-            kernelScan.setArg (3, dBufferSums);
-            kernelScan.setArg (4, width / 4);
-            kernelScan.setArg (5, scaling);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+        if (dBufferOutPC4D () == nullptr)
+            dBufferOutPC4D = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+        if (dBufferOutRGBA () == nullptr)
+            dBufferOutRGBA = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
-            kernelSumsScan.setArg (0, dBufferSums);
-            kernelSumsScan.setArg (1, dBufferSums);
-            kernelSumsScan.setArg (2, cl::Local (2 * localScan[0] * sizeof (cl_float)));
-            kernelSumsScan.setArg (3, dBufferSums);  // Unused
-            kernelSumsScan.setArg (4, (cl_uint) (wgXdim / 4));
-            kernelSumsScan.setArg (5, 1.f);
+        // Compacted input carries its number of points on the device
+        if (dBufferCount () != nullptr)
+            kernel = cl::Kernel (env.getProgram (info.pgIdx), "splitPC8D_Compact");
 
-            kernelAddSums.setArg (0, dBufferSums);
-            kernelAddSums.setArg (1, dBufferOut);
-            kernelAddSums.setArg (2, width / 4);
-        }
+        // Set kernel arguments
+        kernel.setArg (0, dBufferIn);
+        kernel.setArg (1, dBufferOutPC4D);
+        kernel.setArg (2, dBufferOutRGBA);
+        kernel.setArg (3, offset);
+        if (dBufferCount () != nullptr)
+            kernel.setArg (4, dBufferCount);
     }
 
 
@@ -2353,17 +2691,17 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void Scan::write (Scan::Memory mem, void *ptr, bool block, 
-                      const std::vector<cl::Event> *events, cl::Event *event)
+    void SplitPC8D::write (SplitPC8D::Memory mem, void *ptr, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case Scan::Memory::D_IN:
+                case SplitPC8D::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
-                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                        std::copy ((cl_float8 *) ptr, (cl_float8 *) ptr + n, (cl_float8 *) hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
                     break;
                 default:
                     break;
@@ -2381,16 +2719,19 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* Scan::read (Scan::Memory mem, bool block, 
-                      const std::vector<cl::Event> *events, cl::Event *event)
+    void* SplitPC8D::read (SplitPC8D::Memory mem, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case Scan::Memory::H_OUT:
-                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
-                    return hPtrOut;
+                case SplitPC8D::Memory::H_OUT_PC4D:
+                    queue.enqueueReadBuffer (dBufferOutPC4D, block, 0, bufferOutSize, hPtrOutPC4D, events, event);
+                    return hPtrOutPC4D;
+                case SplitPC8D::Memory::H_OUT_RGBA:
+                    queue.enqueueReadBuffer (dBufferOutRGBA, block, 0, bufferOutSize, hPtrOutRGBA, events, event);
+                    return hPtrOutRGBA;
                 default:
                     return nullptr;
             }
@@ -2404,54 +2745,40 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the last kernel execution.
      */
-    void Scan::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void SplitPC8D::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        if (wgXdim == 1)
-        {
-            queue.enqueueNDRangeKernel (
-                kernelScan, cl::NullRange, globalScan, localScan, events, event);
-        }
-        else
-        {
-            queue.enqueueNDRangeKernel (
-                kernelScan, cl::NullRange, globalScan, localScan, events);
-
-            queue.enqueueNDRangeKernel (
-                kernelSumsScan, cl::NullRange, globalSumsScan, localScan);
-
-            queue.enqueueNDRangeKernel (
-                kernelAddSums, offsetAddSums, globalAddSums, localAddSums, nullptr, event);
-        }
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
-    /*! \return The scaling factor.
+    /*! \return The offset.
      */
-    float Scan::getScaling ()
+    unsigned int SplitPC8D::getOffset ()
     {
-        return scaling;
+        return offset;
     }
 
 
-    /*! \details Updates the kernel argument for the scaling factor.
+    /*! \details Updates the kernel argument for the offset.
      *
-     *  \param[in] _scaling scaling factor.
+     *  \param[in] _offset the offset to set.
      */
-    void Scan::setScaling (float _scaling)
+    void SplitPC8D::setOffset (unsigned int _offset)
     {
-        scaling = _scaling;
-        kernelScan.setArg (5, scaling);
+        offset = _offset;
+        kernel.setArg (3, offset);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    Transpose::Transpose (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    RGBNorm::RGBNorm (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("RGBNorm"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "transpose")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "rgbNorm")
     {
     }
 
@@ -2461,17 +2788,17 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& Transpose::get (Transpose::Memory mem)
+    cl::Memory& RGBNorm::get (RGBNorm::Memory mem)
     {
         switch (mem)
         {
-            case Transpose::Memory::H_IN:
+            case RGBNorm::Memory::H_IN:
                 return hBufferIn;
-            case Transpose::Memory::H_OUT:
+            case RGBNorm::Memory::H_OUT:
                 return hBufferOut;
-            case Transpose::Memory::D_IN:
+            case RGBNorm::Memory::D_IN:
                 return dBufferIn;
-            case Transpose::Memory::D_OUT:
+            case RGBNorm::Memory::D_OUT:
                 return dBufferOut;
         }
     }
@@ -2482,54 +2809,30 @@ namespace GF
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
      *        
-     *  \param[in] _width width of the input array to be processed.
-     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _width width (\#pixels/row) of the array to be processed.
+     *  \param[in] _height height (\#pixels/column) of the array to be processed.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void Transpose::init (unsigned int _width, unsigned int _height, Staging _staging)
+    void RGBNorm::init (unsigned int _width, unsigned int _height, Staging _staging)
     {
+        // Logically rearrange data (pixels)
         width = _width; height = _height;
-        bufferSize = width * height * sizeof (cl_float);
-        unsigned int lSide;
+        bufferSize = 3 * width * height * sizeof (cl_float);
         staging = _staging;
 
         try
         {
-            //* Each work-item processes a 4x4 block of data
-            unsigned int xN = width / 4;
-            unsigned int yN = height / 4;
-            unsigned int xR = width % 4;
-            unsigned int yR = height % 4;
-
-            if (xR || yR || (xN == 0) || (yN == 0))
-                throw "The number of rows, and columns, in the array must be "
-                      "a multiple of 4 and a strictly positive number";
-
-            // Choose a side for the local (square) workspace
-            //* At the very least, 1 will always satisfy the conditions (1)
-            // (1) Both input dimensions, after divided by 4, must fit 
-            //     an integer number of work-groups
-            for (lSide = 16; lSide > 0; lSide >>= 1)
-                if ((xN % lSide == 0) && (yN % lSide == 0))
-                    break;
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[Transpose]: " << error << std::endl;
+            std::cerr << "Error[RGBNorm]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
-        size_t localSize = lSide * lSide;
-        size_t wgMultiple = kernel.getWorkGroupInfo
-                <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
-        if (localSize % wgMultiple)
-            std::cout << "Warning[Transpose]: The work-group size [" << localSize 
-                      << "] is not a multiple of the preferred size [" 
-                      << wgMultiple << "] on this device" << std::endl;
-
         // Set workspaces
-        global = cl::NDRange (width / 4, height / 4);
-        local = cl::NDRange (lSide, lSide);
+        global = cl::NDRange (width * height);
 
         // Create staging buffers
         bool io = false;
@@ -2545,7 +2848,7 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrIn = (cl_float *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
@@ -2560,7 +2863,7 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
@@ -2570,17 +2873,16 @@ namespace GF
                 if (!io) hPtrIn = nullptr;
                 break;
         }
-
+        
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferIn);
         kernel.setArg (1, dBufferOut);
-        kernel.setArg (2, cl::Local (4 * 4 * local[0] * local[1] * sizeof (cl_float)));
     }
 
 
@@ -2595,16 +2897,16 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void Transpose::write (Transpose::Memory mem, void *ptr, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void RGBNorm::write (RGBNorm::Memory mem, void *ptr, bool block, 
+                         const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case Transpose::Memory::D_IN:
+                case RGBNorm::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + 3 * width * height, hPtrIn);
                     queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
                     break;
                 default:
@@ -2623,14 +2925,14 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* Transpose::read (Transpose::Memory mem, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void* RGBNorm::read (RGBNorm::Memory mem, bool block, 
+                         const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case Transpose::Memory::H_OUT:
+                case RGBNorm::Memory::H_OUT:
                     queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
@@ -2644,30 +2946,28 @@ namespace GF
     /*! \details The function call is non-blocking.
      *
      *  \param[in] events a wait-list of events.
-     *  \param[out] event event associated with the kernel execution.
+     *  \param[out] event event associated with the last kernel execution.
      */
-    void Transpose::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void RGBNorm::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
-     *  \param[in] _transposed a flag to indicate whether to leave the output 
-     *                         array in a transposed configuration, or not. If 
-     *                         false, a (second) transposition is performed on 
-     *                         the output array to bring the array at the 
-     *                         initial configuration.
      */
-    SAT::SAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info, bool _transposed) : 
-        env (_env), info (_info), 
+    Scan::Scan (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("Scan"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        scanRows    (Scan (env, info)), transpose1 (Transpose (env, info)),
-        scanColumns (Scan (env, info)), transpose2 (Transpose (env, info)), 
-        transposed (_transposed)
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernelScan (env.getProgram (info.pgIdx), "inclusiveScan_f"), 
+        kernelSumsScan (env.getProgram (info.pgIdx), "inclusiveScan_f"), 
+        kernelAddSums (env.getProgram (info.pgIdx), "addGroupSums_f")
     {
+        wgMultiple = kernelScan.getWorkGroupInfo
+            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
     }
 
 
@@ -2676,19 +2976,20 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& SAT::get (SAT::Memory mem)
+    cl::Memory& Scan::get (Scan::Memory mem)
     {
         switch (mem)
         {
-            case SAT::Memory::H_IN:
+            case Scan::Memory::H_IN:
                 return hBufferIn;
-            case SAT::Memory::H_OUT:
+            case Scan::Memory::H_OUT:
                 return hBufferOut;
-            case SAT::Memory::D_IN:
-                return scanRows.get (Scan::Memory::D_IN);
-            case SAT::Memory::D_OUT:
-                if (transposed) return scanColumns.get (Scan::Memory::D_OUT);
-                else return transpose2.get (Transpose::Memory::D_OUT);
+            case Scan::Memory::D_IN:
+                return dBufferIn;
+            case Scan::Memory::D_SUMS:
+                return dBufferSums;
+            case Scan::Memory::D_OUT:
+                return dBufferOut;
         }
     }
 
@@ -2699,30 +3000,73 @@ namespace GF
      *        a new memory object will be created.
      *  \note Working with `float` elements and having large summations can be problematic.
      *        It is advised that a scaling is applied on the elements for better accuracy.
+     *  \note The work-group size is looked up in the `TuningProfile`. If there is 
+     *        no (valid) entry, the preferred work-group size multiple is used, 
+     *        reduced for rows too short to keep it busy.
      *        
-     *  \param[in] _width width of the input array to be processed.
-     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _width width of the input array.
+     *  \param[in] _height height of the input array.
      *  \param[in] _scaling factor by which to scale the array elements before processing.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void SAT::init (unsigned int _width, unsigned int _height, float _scaling, Staging _staging)
+    void Scan::init (unsigned int _width, unsigned int _height, float _scaling, Staging _staging)
     {
         width = _width; height = _height;
         bufferSize = width * height * sizeof (cl_float);
         scaling = _scaling;
         staging = _staging;
 
-        try
+        // Establish the work-group size
+        //* A tuned size takes precedence over the preferred multiple
+        std::vector<unsigned int> params;
+        if (TuningProfile::instance ().lookup (env.devices[info.pIdx][info.dIdx], 
+                "Scan", width, height, params) && validConfig (width, height, params))
+            lXdim = params[0];
+        else
         {
-            if ((width == 0) || (height == 0))
-                throw "The image cannot have zeroed dimensions";
+            lXdim = wgMultiple;
+            // Each work-item handles 8 elements
+            while ((lXdim > 1) && (4 * lXdim >= width)) lXdim >>= 1;
+        }
+
+        // Establish the number of work-groups per row
+        wgXdim = ceil (width / (float) (8 * lXdim));
+        // Round up to a multiple of 4 (data are handled as int4)
+        if ((wgXdim != 1) && (wgXdim % 4)) wgXdim += 4 - wgXdim % 4;
+
+        bufferSumsSize = wgXdim * height * sizeof (cl_float);
+
+        try
+        {
+            if (wgXdim == 0)
+                throw "The array cannot have zero columns";
+
+            if (width % 4 != 0)
+                throw "The number of columns in the array must be a multiple of 4";
+
+            // (8 * lXdim) elements per work-group
+            if (width > std::pow (8 * lXdim, 2))
+            {
+                std::ostringstream ss;
+                ss << "The current configuration of Scan supports arrays ";
+                ss << "of up to " << std::pow (8 * lXdim, 2) << " columns";
+                throw ss.str ().c_str ();
+            }
         }
         catch (const char *error)
         {
-            std::cerr << "Error[SAT]: " << error << std::endl;
+            std::cerr << "Error[Scan]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
+        // Set workspaces
+        globalScan = cl::NDRange (wgXdim * lXdim, height);
+        localScan = cl::NDRange (lXdim, 1);
+        globalSumsScan = cl::NDRange (lXdim, height);
+        globalAddSums = cl::NDRange (2 * (wgXdim - 1) * lXdim, height);
+        localAddSums = cl::NDRange (2 * lXdim, 1);
+        offsetAddSums = cl::NDRange (2 * lXdim, 0);
+
         // Create staging buffers
         bool io = false;
         switch (staging)
@@ -2737,7 +3081,7 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrIn = (cl_float *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
@@ -2752,7 +3096,7 @@ namespace GF
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
@@ -2762,20 +3106,44 @@ namespace GF
                 if (!io) hPtrIn = nullptr;
                 break;
         }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferSums () == nullptr)
+            dBufferSums = counters.allocate (context, CL_MEM_READ_WRITE, bufferSumsSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
 
-        scanRows.init (width, height, scaling, Staging::NONE);
-
-        transpose1.get (Transpose::Memory::D_IN) = scanRows.get (Scan::Memory::D_OUT);
-        transpose1.get (Transpose::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        transpose1.init (width, height, Staging::NONE);
+        // Set kernel arguments
+        if (wgXdim == 1)
+        {
+            kernelScan.setArg (0, dBufferIn);
+            kernelScan.setArg (1, dBufferOut);
+            kernelScan.setArg (2, cl::Local (2 * localScan[0] * sizeof (cl_float)));
+            kernelScan.setArg (3, dBufferSums);  // Unused
+            kernelScan.setArg (4, width / 4);
+            kernelScan.setArg (5, scaling);
+        }
+        else
+        {
+            kernelScan.setArg (0, dBufferIn);
+            kernelScan.setArg (1, dBufferOut);
+            kernelScan.setArg (2, cl::Local (2 * localScan[0] * sizeof (cl_float)));
+            kernelScan.setArg (3, dBufferSums);
+            kernelScan.setArg (4, width / 4);
+            kernelScan.setArg (5, scaling);
 
-        scanColumns.get (Scan::Memory::D_IN) = transpose1.get (Transpose::Memory::D_OUT);
-        scanColumns.init (height, width, 1.f, Staging::NONE);
+            kernelSumsScan.setArg (0, dBufferSums);
+            kernelSumsScan.setArg (1, dBufferSums);
+            kernelSumsScan.setArg (2, cl::Local (2 * localScan[0] * sizeof (cl_float)));
+            kernelSumsScan.setArg (3, dBufferSums);  // Unused
+            kernelSumsScan.setArg (4, (cl_uint) (wgXdim / 4));
+            kernelSumsScan.setArg (5, 1.f);
 
-        if (!transposed)
-        {
-            transpose2.get (Transpose::Memory::D_IN) = scanColumns.get (Scan::Memory::D_OUT);
-            transpose2.init (height, width, Staging::NONE);
+            kernelAddSums.setArg (0, dBufferSums);
+            kernelAddSums.setArg (1, dBufferOut);
+            kernelAddSums.setArg (2, width / 4);
         }
     }
 
@@ -2791,18 +3159,17 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void SAT::write (SAT::Memory mem, void *ptr, bool block, 
-                     const std::vector<cl::Event> *events, cl::Event *event)
+    void Scan::write (Scan::Memory mem, void *ptr, bool block, 
+                      const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case SAT::Memory::D_IN:
+                case Scan::Memory::D_IN:
                     if (ptr != nullptr)
                         std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
-                    queue.enqueueWriteBuffer ((cl::Buffer&) scanRows.get (Scan::Memory::D_IN), 
-                        block, 0, bufferSize, hPtrIn, events, event);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
                     break;
                 default:
                     break;
@@ -2820,20 +3187,15 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* SAT::read (SAT::Memory mem, bool block, 
-                     const std::vector<cl::Event> *events, cl::Event *event)
+    void* Scan::read (Scan::Memory mem, bool block, 
+                      const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case SAT::Memory::H_OUT:
-                    if (transposed)
-                        queue.enqueueReadBuffer ((cl::Buffer&) scanColumns.get (Scan::Memory::D_OUT), 
-                            block, 0, bufferSize, hPtrOut, events, event);
-                    else
-                        queue.enqueueReadBuffer ((cl::Buffer&) transpose2.get (Transpose::Memory::D_OUT), 
-                            block, 0, bufferSize, hPtrOut, events, event);
+                case Scan::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
                     return nullptr;
@@ -2846,93 +3208,116 @@ namespace GF
     /*! \details The function call is non-blocking.
      *
      *  \param[in] events a wait-list of events.
-     *  \param[out] event event associated with the kernel execution.
+     *  \param[out] event event associated with the last kernel execution.
      */
-    void SAT::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void Scan::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        scanRows.run (events);
-        transpose1.run ();
-        scanColumns.run ();
+        Counters::Frame frame (counters, event);
+        if (wgXdim == 1)
+        {
+            queue.enqueueNDRangeKernel (
+                kernelScan, cl::NullRange, globalScan, localScan, events, event);
+        }
+        else
+        {
+            queue.enqueueNDRangeKernel (
+                kernelScan, cl::NullRange, globalScan, localScan, events);
 
-        if (!transposed)
-            transpose2.run (nullptr, event);
+            queue.enqueueNDRangeKernel (
+                kernelSumsScan, cl::NullRange, globalSumsScan, localScan);
+
+            queue.enqueueNDRangeKernel (
+                kernelAddSums, offsetAddSums, globalAddSums, localAddSums, nullptr, event);
+        }
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void Scan::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        if (wgXdim == 1)
+        {
+            graph.add (queue, kernelScan, cl::NullRange, globalScan, localScan, deps, node);
+        }
+        else
+        {
+            graph.add (queue, kernelScan, cl::NullRange, globalScan, localScan, deps);
+
+            graph.add (queue, kernelSumsScan, cl::NullRange, globalSumsScan, localScan);
+
+            graph.add (queue, kernelAddSums, offsetAddSums, globalAddSums, localAddSums, nullptr, node);
+        }
     }
 
 
     /*! \return The scaling factor.
      */
-    float SAT::getScaling ()
+    float Scan::getScaling ()
     {
         return scaling;
     }
 
 
-    /*! \details Updates the kernel argument for the scaling factor of the rows scan.
+    /*! \details Updates the kernel argument for the scaling factor.
      *
      *  \param[in] _scaling scaling factor.
      */
-    void SAT::setScaling (float _scaling)
+    void Scan::setScaling (float _scaling)
     {
         scaling = _scaling;
-        scanRows.setScaling (scaling);
+        kernelScan.setArg (5, scaling);
     }
 
 
-    /*! \param[in] _env opencl environment.
-     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+    /*! \details The work-group size of the `inclusiveScan_f` kernel has to be a power of 2, 
+     *           and the `addGroupSums_f` kernel uses twice as many work-items per work-group. 
+     *           Each work-group scans \f$ 8*lXdim \f$ elements, and the group sums of 
+     *           a row have to be scanned by a single work-group.
+     *
+     *  \note The height of the array doesn't constrain the configuration.
+     *
+     *  \param[in] _width width of the input array.
+     *  \param[in] params work-group configuration, \f$ \{lXdim\} \f$.
+     *  \return Whether the configuration can be used on this device.
      */
-    BoxFilterSAT::BoxFilterSAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
-        context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "boxFilterSAT_Tr"),
-        sat (_env, _info)
+    bool Scan::validConfig (unsigned int _width, unsigned int /* _height */, 
+                            const std::vector<unsigned int> &params)
     {
-        // The class requires 16x16 work-groups (256 work-items per work-group)
-        // The following code checks that this specification is possible
+        if (params.size () != 1) return false;
 
-        cl::Device &device = env.devices[info.pIdx][info.dIdx];
-
-        size_t maxLocalSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE> ();
+        size_t lX = params[0];
+        if ((lX == 0) || (lX & (lX - 1))) return false;
 
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+        size_t maxScanSize = kernelScan.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device);
+        size_t maxAddSumsSize = kernelAddSums.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device);
         std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
 
-        size_t wgMultiple = kernel.getWorkGroupInfo
-            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (device);
-
-        size_t localSize = lXdim * lYdim;
-
-        try
-        {
-            if ((lXdim > maxLocalDim[0]) || (lYdim > maxLocalDim[1]))
-            {
-                std::ostringstream ss;
-                ss << "The maximum work-group dimensions ";
-                ss << "[" << maxLocalDim[0] << "][" << maxLocalDim[1] << "] ";
-                ss << "are not enough (16x16 work-groups are required) on this device";
-                throw ss.str ();
-            }
-
-            if (localSize > maxLocalSize)
-            {
-                std::ostringstream ss;
-                ss << "The maximum work-group size ";
-                ss << "[" << maxLocalSize << "] " << "is not enough ";
-                ss << "(256 work-items per work-group are required) on this device";
-                throw ss.str ();
-            }
+        return (lX <= maxScanSize) && (2 * lX <= maxAddSumsSize) && 
+               (2 * lX <= maxLocalDim[0]) && (_width <= std::pow (8 * lX, 2));
+    }
 
-        }
-        catch (const std::string &error)
-        {
-            std::cerr << "Error[BoxFilterSAT]: " << error << std::endl;
-            exit (EXIT_FAILURE);
-        }
 
-        if (localSize % wgMultiple)
-            std::cout << "Warning[BoxFilterSAT]: The work-group size [" << localSize 
-                      << "] is not a multiple of the preferred size [" 
-                      << wgMultiple << "] on this device" << std::endl;
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    CompactPC<CompactPCConfig::PC4D>::CompactPC (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("CompactPC<CompactPCConfig::PC4D>"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernelMask (env.getProgram (info.pgIdx), "pcValidMask"), 
+        kernelCounts (env.getProgram (info.pgIdx), "pcRowCounts"), 
+        kernelCompact (env.getProgram (info.pgIdx), "pcCompact"), 
+        scanRows (Scan (env, info)), scanCounts (Scan (env, info))
+    {
+        scanRows.counters.setParent (counters);
+        scanCounts.counters.setParent (counters);
     }
 
 
@@ -2941,18 +3326,22 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& BoxFilterSAT::get (BoxFilterSAT::Memory mem)
+    cl::Memory& CompactPC<CompactPCConfig::PC4D>::get (CompactPC::Memory mem)
     {
         switch (mem)
         {
-            case BoxFilterSAT::Memory::H_IN:
+            case CompactPC::Memory::H_IN:
                 return hBufferIn;
-            case BoxFilterSAT::Memory::H_OUT:
+            case CompactPC::Memory::H_OUT:
                 return hBufferOut;
-            case BoxFilterSAT::Memory::D_IN:
-                return sat.get (SAT::Memory::D_IN);
-            case BoxFilterSAT::Memory::D_OUT:
+            case CompactPC::Memory::H_COUNT:
+                return hBufferCount;
+            case CompactPC::Memory::D_IN:
+                return dBufferIn;
+            case CompactPC::Memory::D_OUT:
                 return dBufferOut;
+            case CompactPC::Memory::D_COUNT:
+                return dBufferCount;
         }
     }
 
@@ -2961,49 +3350,42 @@ namespace GF
      *  \note If you have assigned a memory object to one member variable of the class 
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
-     *  \note Working with `float` elements and having large summations can be problematic.
-     *        It is advised that a scaling is applied on the elements for better accuracy.
-     *        A default value of \f$ 0.0001\ (1e-4) \f$ is normally applied. This scaling
-     *        is only internal to the algorithm. No further processing is necessary on the output buffer.
+     *  \note The validity mask is scanned with `Scan`, so the width of the 
+     *        point cloud has to be a multiple of 4.
      *        
-     *  \param[in] _width width of the input array to be processed.
-     *  \param[in] _height height of the input array to be processed.
-     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
-     *  \param[in] _scaling factor by which to scale the array elements before processing.
+     *  \param[in] _width width of the organized point cloud (as produced by `DepthTo3D`).
+     *  \param[in] _height height of the organized point cloud.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void BoxFilterSAT::init (unsigned int _width, unsigned int _height, int _radius, float _scaling, Staging _staging)
+    void CompactPC<CompactPCConfig::PC4D>::init (unsigned int _width, unsigned int _height, Staging _staging)
     {
-        width = _width; height = _height; radius = _radius;
-        bufferSize = width * height * sizeof (cl_float);
-        scaling = _scaling;
+        width = _width; height = _height;
+        bufferSize = width * height * sizeof (cl_float4);
         staging = _staging;
 
+        // The row counts are scanned as a single row of float4 elements
+        rows = height;
+        if (rows % 4) rows += 4 - rows % 4;
+
         try
         {
             if ((width == 0) || (height == 0))
-                throw "The image cannot have zeroed dimensions";
-
-            if (height % lXdim != 0)
-            {
-                std::ostringstream ss;
-                ss << "The image width has to be a multiple of " << lXdim;
-                throw ss.str ().c_str ();
-            }
+                throw "The point cloud cannot have zeroed dimensions";
 
-            if (width % lYdim != 0)
-            {
-                std::ostringstream ss;
-                ss << "The image height has to be a multiple of " << lYdim;
-                throw ss.str ().c_str ();
-            }
+            if (width % 4 != 0)
+                throw "The width of the point cloud must be a multiple of 4";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[BoxFilterSAT]: " << error << std::endl;
+            std::cerr << "Error[CompactPC]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
-        
+
+        // Set workspaces
+        globalMask = cl::NDRange (width * height);
+        globalCounts = cl::NDRange (rows);
+        globalCompact = cl::NDRange (width, height);
+
         // Create staging buffers
         bool io = false;
         switch (staging)
@@ -3011,6 +3393,7 @@ namespace GF
             case Staging::NONE:
                 hPtrIn = nullptr;
                 hPtrOut = nullptr;
+                hPtrCount = nullptr;
                 break;
 
             case Staging::IO:
@@ -3018,9 +3401,9 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
-                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                hPtrIn = (cl_float4 *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
                 queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
@@ -3028,38 +3411,61 @@ namespace GF
                 {
                     queue.finish ();
                     hPtrOut = nullptr;
+                    hPtrCount = nullptr;
                     break;
                 }
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferCount () == nullptr)
+                    hBufferCount = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, sizeof (cl_uint));
 
-                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                hPtrOut = (cl_float4 *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                hPtrCount = (cl_uint *) queue.enqueueMapBuffer (
+                    hBufferCount, CL_FALSE, CL_MAP_READ, 0, sizeof (cl_uint));
                 queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.enqueueUnmapMemObject (hBufferCount, hPtrCount);
                 queue.finish ();
 
                 if (!io) hPtrIn = nullptr;
                 break;
         }
-
-        sat.init (width, height, scaling, Staging::NONE);
-
+        
         // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+        if (dBufferCount () == nullptr)
+            dBufferCount = counters.allocate (context, CL_MEM_READ_WRITE, sizeof (cl_uint));
 
-        // Set workspaces
-        global = cl::NDRange (height, width);
-        local = cl::NDRange (lXdim, lYdim);
+        // Initialize the scans (the mask and the row counts are written by kernels)
+        scanRows.get (Scan::Memory::D_IN) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, width * height * sizeof (cl_float));
+        scanRows.init (width, height, 1.f, Staging::NONE);
+
+        scanCounts.get (Scan::Memory::D_IN) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, rows * sizeof (cl_float));
+        scanCounts.init (rows, 1, 1.f, Staging::NONE);
 
         // Set kernel arguments
-        kernel.setArg (0, sat.get (SAT::Memory::D_OUT));
-        kernel.setArg (1, dBufferOut);
-        kernel.setArg (2, cl::Local (lXdim * lYdim * sizeof (float)));
-        kernel.setArg (3, radius);
-        kernel.setArg (4, 1.f / scaling);
+        kernelMask.setArg (0, dBufferIn);
+        kernelMask.setArg (1, scanRows.get (Scan::Memory::D_IN));
+        kernelMask.setArg (2, (cl_uint) 1);
+
+        kernelCounts.setArg (0, scanRows.get (Scan::Memory::D_OUT));
+        kernelCounts.setArg (1, scanCounts.get (Scan::Memory::D_IN));
+        kernelCounts.setArg (2, width);
+        kernelCounts.setArg (3, height);
+
+        kernelCompact.setArg (0, dBufferIn);
+        kernelCompact.setArg (1, scanRows.get (Scan::Memory::D_OUT));
+        kernelCompact.setArg (2, scanCounts.get (Scan::Memory::D_OUT));
+        kernelCompact.setArg (3, dBufferOut);
+        kernelCompact.setArg (4, dBufferCount);
+        kernelCompact.setArg (5, (cl_uint) 1);
     }
 
 
@@ -3074,18 +3480,17 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void BoxFilterSAT::write (BoxFilterSAT::Memory mem, void *ptr, bool block, 
-                              const std::vector<cl::Event> *events, cl::Event *event)
+    void CompactPC<CompactPCConfig::PC4D>::write (CompactPC::Memory mem, void *ptr, bool block, 
+                                                  const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case BoxFilterSAT::Memory::D_IN:
+                case CompactPC::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
-                    queue.enqueueWriteBuffer ((cl::Buffer&) sat.get (SAT::Memory::D_IN), 
-                        block, 0, bufferSize, hPtrIn, events, event);
+                        std::copy ((cl_float4 *) ptr, (cl_float4 *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
                     break;
                 default:
                     break;
@@ -3096,6 +3501,8 @@ namespace GF
 
     /*! \details The transfer happens from a device buffer to the associated 
      *           (specified) staging buffer on the host.
+     *  \note Reading `H_OUT` first reads (blocking) the number of valid points, 
+     *        and then transfers only those points.
      *  
      *  \param[in] mem enumeration value specifying an output staging buffer.
      *  \param[in] block a flag to indicate whether to perform a blocking 
@@ -3103,16 +3510,22 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* BoxFilterSAT::read (BoxFilterSAT::Memory mem, bool block, 
-                              const std::vector<cl::Event> *events, cl::Event *event)
+    void* CompactPC<CompactPCConfig::PC4D>::read (CompactPC::Memory mem, bool block, 
+                                                  const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case BoxFilterSAT::Memory::H_OUT:
-                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                case CompactPC::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferCount, CL_TRUE, 0, sizeof (cl_uint), hPtrCount, events);
+                    if (*hPtrCount == 0) return hPtrOut;
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, *hPtrCount * sizeof (cl_float4), 
+                                             hPtrOut, nullptr, event);
                     return hPtrOut;
+                case CompactPC::Memory::H_COUNT:
+                    queue.enqueueReadBuffer (dBufferCount, block, 0, sizeof (cl_uint), hPtrCount, events, event);
+                    return hPtrCount;
                 default:
                     return nullptr;
             }
@@ -3124,107 +3537,33 @@ namespace GF
     /*! \details The function call is non-blocking.
      *
      *  \param[in] events a wait-list of events.
-     *  \param[out] event event associated with the kernel execution.
-     */
-    void BoxFilterSAT::run (const std::vector<cl::Event> *events, cl::Event *event)
-    {
-        sat.run (events);
-        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, nullptr, event);
-    }
-
-
-    /*! \return The radius of the square filter window.
-     */
-    int BoxFilterSAT::getRadius ()
-    {
-        return radius;
-    }
-
-
-    /*! \details Updates the kernel argument for the filter window radius.
-     *
-     *  \param[in] _radius the radius of the square filter window.
-     */
-    void BoxFilterSAT::setRadius (int _radius)
-    {
-        radius = _radius;
-        kernel.setArg (3, radius);
-    }
-
-    /*! \return The scaling factor.
-     */
-    float BoxFilterSAT::getScaling ()
-    {
-        return scaling;
-    }
-
-
-    /*! \details Updates the kernel argument for the scaling factor.
-     *
-     *  \param[in] _scaling scaling factor.
+     *  \param[out] event event associated with the last kernel execution.
      */
-    void BoxFilterSAT::setScaling (float _scaling)
+    void CompactPC<CompactPCConfig::PC4D>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        scaling = _scaling;
-        sat.setScaling (scaling);
-        kernel.setArg (4, 1.f / scaling);
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernelMask, cl::NullRange, globalMask, cl::NullRange, events);
+        scanRows.run ();
+        queue.enqueueNDRangeKernel (kernelCounts, cl::NullRange, globalCounts, cl::NullRange);
+        scanCounts.run ();
+        queue.enqueueNDRangeKernel (kernelCompact, cl::NullRange, globalCompact, cl::NullRange, nullptr, event);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
-    BoxFilter::BoxFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+    CompactPC<CompactPCConfig::PC8D>::CompactPC (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("CompactPC<CompactPCConfig::PC8D>"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        kernel (env.getProgram (info.pgIdx), "boxFilter")
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernelMask (env.getProgram (info.pgIdx), "pcValidMask"), 
+        kernelCounts (env.getProgram (info.pgIdx), "pcRowCounts"), 
+        kernelCompact (env.getProgram (info.pgIdx), "pcCompact"), 
+        scanRows (Scan (env, info)), scanCounts (Scan (env, info))
     {
-        // The class requires 16x16 work-groups (256 work-items per work-group)
-        // The following code checks that this specification is possible
-
-        cl::Device &device = env.devices[info.pIdx][info.dIdx];
-
-        size_t maxLocalSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE> ();
-
-        std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
-
-        size_t wgMultiple = kernel.getWorkGroupInfo
-            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (device);
-
-        size_t localSize = lXdim * lYdim;
-
-        try
-        {
-            if ((lXdim > maxLocalDim[0]) || (lYdim > maxLocalDim[1]))
-            {
-                std::ostringstream ss;
-                ss << "The maximum work-group dimensions ";
-                ss << "[" << maxLocalDim[0] << "][" << maxLocalDim[1] << "] ";
-                ss << "are not enough (16x16 work-groups are required) on this device";
-                throw ss.str ();
-            }
-
-            if (localSize > maxLocalSize)
-            {
-                std::ostringstream ss;
-                ss << "The maximum work-group size ";
-                ss << "[" << maxLocalSize << "] " << "is not enough ";
-                ss << "(256 work-items per work-group are required) on this device";
-                throw ss.str ();
-            }
-
-        }
-        catch (const std::string &error)
-        {
-            std::cerr << "Error[BoxFilter]: " << error << std::endl;
-            exit (EXIT_FAILURE);
-        }
-
-        if (localSize % wgMultiple)
-            std::cout << "Warning[BoxFilter]: The work-group size [" << localSize 
-                      << "] is not a multiple of the preferred size [" 
-                      << wgMultiple << "] on this device" << std::endl;
+        scanRows.counters.setParent (counters);
+        scanCounts.counters.setParent (counters);
     }
 
 
@@ -3233,18 +3572,22 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& BoxFilter::get (BoxFilter::Memory mem)
+    cl::Memory& CompactPC<CompactPCConfig::PC8D>::get (CompactPC::Memory mem)
     {
         switch (mem)
         {
-            case BoxFilter::Memory::H_IN:
+            case CompactPC::Memory::H_IN:
                 return hBufferIn;
-            case BoxFilter::Memory::H_OUT:
+            case CompactPC::Memory::H_OUT:
                 return hBufferOut;
-            case BoxFilter::Memory::D_IN:
+            case CompactPC::Memory::H_COUNT:
+                return hBufferCount;
+            case CompactPC::Memory::D_IN:
                 return dBufferIn;
-            case BoxFilter::Memory::D_OUT:
+            case CompactPC::Memory::D_OUT:
                 return dBufferOut;
+            case CompactPC::Memory::D_COUNT:
+                return dBufferCount;
         }
     }
 
@@ -3253,46 +3596,41 @@ namespace GF
      *  \note If you have assigned a memory object to one member variable of the class 
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
+     *  \note The validity mask is scanned with `Scan`, so the width of the 
+     *        point cloud has to be a multiple of 4.
      *        
-     *  \param[in] _width width of the input array to be processed.
-     *  \param[in] _height height of the input array to be processed.
-     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _width width of the organized point cloud (as produced by `RGBDTo8D`).
+     *  \param[in] _height height of the organized point cloud.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void BoxFilter::init (unsigned int _width, unsigned int _height, int _radius, Staging _staging)
+    void CompactPC<CompactPCConfig::PC8D>::init (unsigned int _width, unsigned int _height, Staging _staging)
     {
-        width = _width; height = _height; radius = _radius;
-        bufferSize = width * height * sizeof (cl_float);
+        width = _width; height = _height;
+        bufferSize = width * height * sizeof (cl_float8);
         staging = _staging;
 
+        // The row counts are scanned as a single row of float4 elements
+        rows = height;
+        if (rows % 4) rows += 4 - rows % 4;
+
         try
         {
             if ((width == 0) || (height == 0))
-                throw "The image cannot have zeroed dimensions";
-
-            if (height % lXdim != 0)
-            {
-                std::ostringstream ss;
-                ss << "The image width has to be a multiple of " << lXdim;
-                throw ss.str ().c_str ();
-            }
+                throw "The point cloud cannot have zeroed dimensions";
 
-            if (width % lYdim != 0)
-            {
-                std::ostringstream ss;
-                ss << "The image height has to be a multiple of " << lYdim;
-                throw ss.str ().c_str ();
-            }
+            if (width % 4 != 0)
+                throw "The width of the point cloud must be a multiple of 4";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[BoxFilter]: " << error << std::endl;
+            std::cerr << "Error[CompactPC]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
-        
+
         // Set workspaces
-        global = cl::NDRange (width, height);
-        local = cl::NDRange (lXdim, lYdim);
+        globalMask = cl::NDRange (width * height);
+        globalCounts = cl::NDRange (rows);
+        globalCompact = cl::NDRange (width, height);
 
         // Create staging buffers
         bool io = false;
@@ -3301,6 +3639,7 @@ namespace GF
             case Staging::NONE:
                 hPtrIn = nullptr;
                 hPtrOut = nullptr;
+                hPtrCount = nullptr;
                 break;
 
             case Staging::IO:
@@ -3308,9 +3647,9 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
-                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                hPtrIn = (cl_float8 *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
                 queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
@@ -3318,16 +3657,22 @@ namespace GF
                 {
                     queue.finish ();
                     hPtrOut = nullptr;
+                    hPtrCount = nullptr;
                     break;
                 }
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferCount () == nullptr)
+                    hBufferCount = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, sizeof (cl_uint));
 
-                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                hPtrOut = (cl_float8 *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                hPtrCount = (cl_uint *) queue.enqueueMapBuffer (
+                    hBufferCount, CL_FALSE, CL_MAP_READ, 0, sizeof (cl_uint));
                 queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.enqueueUnmapMemObject (hBufferCount, hPtrCount);
                 queue.finish ();
 
                 if (!io) hPtrIn = nullptr;
@@ -3336,15 +3681,37 @@ namespace GF
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+        if (dBufferCount () == nullptr)
+            dBufferCount = counters.allocate (context, CL_MEM_READ_WRITE, sizeof (cl_uint));
+
+        // Initialize the scans (the mask and the row counts are written by kernels)
+        scanRows.get (Scan::Memory::D_IN) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, width * height * sizeof (cl_float));
+        scanRows.init (width, height, 1.f, Staging::NONE);
+
+        scanCounts.get (Scan::Memory::D_IN) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, rows * sizeof (cl_float));
+        scanCounts.init (rows, 1, 1.f, Staging::NONE);
 
         // Set kernel arguments
-        kernel.setArg (0, dBufferIn);
-        kernel.setArg (1, dBufferOut);
-        kernel.setArg (2, cl::Local ((lXdim + 2 * radius) * (lYdim + 2 * radius) * sizeof (cl_float)));
-        kernel.setArg (3, radius);
+        kernelMask.setArg (0, dBufferIn);
+        kernelMask.setArg (1, scanRows.get (Scan::Memory::D_IN));
+        kernelMask.setArg (2, (cl_uint) 2);
+
+        kernelCounts.setArg (0, scanRows.get (Scan::Memory::D_OUT));
+        kernelCounts.setArg (1, scanCounts.get (Scan::Memory::D_IN));
+        kernelCounts.setArg (2, width);
+        kernelCounts.setArg (3, height);
+
+        kernelCompact.setArg (0, dBufferIn);
+        kernelCompact.setArg (1, scanRows.get (Scan::Memory::D_OUT));
+        kernelCompact.setArg (2, scanCounts.get (Scan::Memory::D_OUT));
+        kernelCompact.setArg (3, dBufferOut);
+        kernelCompact.setArg (4, dBufferCount);
+        kernelCompact.setArg (5, (cl_uint) 2);
     }
 
 
@@ -3359,16 +3726,16 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void BoxFilter::write (BoxFilter::Memory mem, void *ptr, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void CompactPC<CompactPCConfig::PC8D>::write (CompactPC::Memory mem, void *ptr, bool block, 
+                                                  const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case BoxFilter::Memory::D_IN:
+                case CompactPC::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                        std::copy ((cl_float8 *) ptr, (cl_float8 *) ptr + width * height, hPtrIn);
                     queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
                     break;
                 default:
@@ -3380,6 +3747,8 @@ namespace GF
 
     /*! \details The transfer happens from a device buffer to the associated 
      *           (specified) staging buffer on the host.
+     *  \note Reading `H_OUT` first reads (blocking) the number of valid points, 
+     *        and then transfers only those points.
      *  
      *  \param[in] mem enumeration value specifying an output staging buffer.
      *  \param[in] block a flag to indicate whether to perform a blocking 
@@ -3387,16 +3756,22 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* BoxFilter::read (BoxFilter::Memory mem, bool block, 
-                           const std::vector<cl::Event> *events, cl::Event *event)
+    void* CompactPC<CompactPCConfig::PC8D>::read (CompactPC::Memory mem, bool block, 
+                                                  const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case BoxFilter::Memory::H_OUT:
-                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                case CompactPC::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferCount, CL_TRUE, 0, sizeof (cl_uint), hPtrCount, events);
+                    if (*hPtrCount == 0) return hPtrOut;
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, *hPtrCount * sizeof (cl_float8), 
+                                             hPtrOut, nullptr, event);
                     return hPtrOut;
+                case CompactPC::Memory::H_COUNT:
+                    queue.enqueueReadBuffer (dBufferCount, block, 0, sizeof (cl_uint), hPtrCount, events, event);
+                    return hPtrCount;
                 default:
                     return nullptr;
             }
@@ -3408,47 +3783,27 @@ namespace GF
     /*! \details The function call is non-blocking.
      *
      *  \param[in] events a wait-list of events.
-     *  \param[out] event event associated with the kernel execution.
-     */
-    void BoxFilter::run (const std::vector<cl::Event> *events, cl::Event *event)
-    {
-        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
-    }
-
-
-    /*! \return The radius of the square filter window.
-     */
-    int BoxFilter::getRadius ()
-    {
-        return radius;
-    }
-
-
-    /*! \details Updates the kernel argument for the filter radius.
-     *
-     *  \param[in] _radius radius of the square filter window.
+     *  \param[out] event event associated with the last kernel execution.
      */
-    void BoxFilter::setRadius (int _radius)
+    void CompactPC<CompactPCConfig::PC8D>::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        radius = _radius;
-        kernel.setArg (3, radius);
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernelMask, cl::NullRange, globalMask, cl::NullRange, events);
+        scanRows.run ();
+        queue.enqueueNDRangeKernel (kernelCounts, cl::NullRange, globalCounts, cl::NullRange);
+        scanCounts.run ();
+        queue.enqueueNDRangeKernel (kernelCompact, cl::NullRange, globalCompact, cl::NullRange, nullptr, event);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
-     *                   The class requires **two** `(2)` **command queues** (on the same device).
      */
-    GuidedFilter<GuidedFilterConfig::I_EQ_P>::GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
-        env (_env), info (_info), 
+    Transpose::Transpose (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("Transpose"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        mean_p  (env, info.getCLEnvInfo (0)), mean_p2 (env, info.getCLEnvInfo (1)), 
-        mean_a  (env, info.getCLEnvInfo (0)), mean_b  (env, info.getCLEnvInfo (1)), 
-        squared (env, info.getCLEnvInfo (1)), 
-        ab (env.getProgram (info.pgIdx), "gf_ab"), 
-        q (env.getProgram (info.pgIdx), "gf_q"), 
-        waitListAB (1), waitListMB(1), waitListQ (1)
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "transpose")
     {
     }
 
@@ -3458,22 +3813,18 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& GuidedFilter<GuidedFilterConfig::I_EQ_P>::get (GuidedFilter::Memory mem)
+    cl::Memory& Transpose::get (Transpose::Memory mem)
     {
         switch (mem)
         {
-            case GuidedFilter::Memory::H_IN:
+            case Transpose::Memory::H_IN:
                 return hBufferIn;
-            case GuidedFilter::Memory::H_OUT:
+            case Transpose::Memory::H_OUT:
                 return hBufferOut;
-            case GuidedFilter::Memory::D_IN:
+            case Transpose::Memory::D_IN:
                 return dBufferIn;
-            case GuidedFilter::Memory::D_OUT:
+            case Transpose::Memory::D_OUT:
                 return dBufferOut;
-            case GuidedFilter::Memory::D_A:
-                return dBufferOutA;
-            case GuidedFilter::Memory::D_B:
-                return dBufferOutB;
         }
     }
 
@@ -3482,48 +3833,65 @@ namespace GF
      *  \note If you have assigned a memory object to one member variable of the class 
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
-     *  \note For better accuracy control a scaling is applied on the array elements 
-     *        internally in `BoxFilterSAT`. A default value of \f$ 0.0001\ (1e-4) \f$ 
-     *        is normally used. The input data are assumed to be of `uchar` type promoted 
-     *        to `float` and normalized to `1.0`. Configure the scaling for your own data.
+     *  \note The work-group side is looked up in the `TuningProfile`. If there is 
+     *        no (valid) entry, the largest power of 2 (up to 16) that divides 
+     *        both array dimensions (after divided by 4) is used.
      *        
      *  \param[in] _width width of the input array to be processed.
      *  \param[in] _height height of the input array to be processed.
-     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
-     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
-     *  \param[in] _zero_out flag to indicate whether or not to zero out invalid pixels. 
-     *                       For more information, look at `gf_q`'s documentation 
-     *                       in `kernels/guidedFilter_kernels.cl`.
-     *  \param[in] _boxScaling scaling factor applied internally to `BoxFilterSAT`.
-     *  \param[in] _outputScaling scaling factor applied to the output array. Set this to `1/s`, if 
-     *                            you had to apply an `s` scaling to the input array before processing.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
      */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::init (
-        unsigned int _width, unsigned int _height, int _radius, float _eps, 
-        int _zero_out, float _boxScaling, float _outputScaling, Staging _staging)
+    void Transpose::init (unsigned int _width, unsigned int _height, Staging _staging)
     {
-        width = _width; height = _height; radius = _radius; eps = _eps;
+        width = _width; height = _height;
         bufferSize = width * height * sizeof (cl_float);
-        zero_out = _zero_out;
-        boxScaling = _boxScaling;
-        outputScaling = _outputScaling;
+        unsigned int lSide;
         staging = _staging;
 
         try
         {
-            if ((width == 0) || (height == 0))
-                throw "The image cannot have zeroed dimensions";
+            //* Each work-item processes a 4x4 block of data
+            unsigned int xN = width / 4;
+            unsigned int yN = height / 4;
+            unsigned int xR = width % 4;
+            unsigned int yR = height % 4;
 
-            if ((width * height) % 4 != 0)
-                throw "The number of elements in the array has to be a multiple of 4";
+            if (xR || yR || (xN == 0) || (yN == 0))
+                throw "The number of rows, and columns, in the array must be "
+                      "a multiple of 4 and a strictly positive number";
+
+            // Choose a side for the local (square) workspace
+            //* A tuned side takes precedence
+            //* At the very least, 1 will always satisfy the conditions (1)
+            // (1) Both input dimensions, after divided by 4, must fit 
+            //     an integer number of work-groups
+            std::vector<unsigned int> params;
+            if (TuningProfile::instance ().lookup (env.devices[info.pIdx][info.dIdx], 
+                    "Transpose", width, height, params) && validConfig (width, height, params))
+                lSide = params[0];
+            else
+                for (lSide = 16; lSide > 0; lSide >>= 1)
+                    if ((xN % lSide == 0) && (yN % lSide == 0))
+                        break;
         }
         catch (const char *error)
         {
-            std::cerr << "Error[GuidedFilter<GuidedFilterConfig::I_EQ_P>]: " << error << std::endl;
+            std::cerr << "Error[Transpose]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
+        size_t localSize = lSide * lSide;
+        size_t wgMultiple = kernel.getWorkGroupInfo
+                <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
+        if (localSize % wgMultiple)
+            std::cout << "Warning[Transpose]: The work-group size [" << localSize 
+                      << "] is not a multiple of the preferred size [" 
+                      << wgMultiple << "] on this device" << std::endl;
+
+        // Set workspaces
+        global = cl::NDRange (width / 4, height / 4);
+        local = cl::NDRange (lSide, lSide);
+
         // Create staging buffers
         bool io = false;
         switch (staging)
@@ -3538,81 +3906,47 @@ namespace GF
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
-                hPtrIn = (cl_float *) queue0.enqueueMapBuffer (
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
-                queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
                 if (!io)
                 {
-                    queue0.finish ();
+                    queue.finish ();
                     hPtrOut = nullptr;
                     break;
                 }
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
-                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
-                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
-                queue0.finish ();
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
 
                 if (!io) hPtrIn = nullptr;
                 break;
         }
-        
+
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
 
-        mean_p.get (BoxFilterSAT::Memory::D_IN) = dBufferIn;
-        mean_p.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_p.init (width, height, radius, boxScaling, Staging::NONE);
-
-        squared.get (Math::Pown::Memory::D_IN) = dBufferIn;
-        squared.get (Math::Pown::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        squared.init (width, height, 2, Staging::NONE);
-
-        mean_p2.get (BoxFilterSAT::Memory::D_IN) = squared.get (Math::Pown::Memory::D_OUT);
-        mean_p2.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_p2.init (width, height, radius, boxScaling, Staging::NONE);
-
-        dBufferOutA = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        dBufferOutB = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        ab.setArg (0, mean_p.get (BoxFilterSAT::Memory::D_OUT));
-        ab.setArg (1, mean_p2.get (BoxFilterSAT::Memory::D_OUT));
-        ab.setArg (2, dBufferOutA);
-        ab.setArg (3, dBufferOutB);
-        ab.setArg (4, eps);
-
-        mean_a.get (BoxFilterSAT::Memory::D_IN) = dBufferOutA;
-        mean_a.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_a.init (width, height, radius, boxScaling, Staging::NONE);
-
-        mean_b.get (BoxFilterSAT::Memory::D_IN) = dBufferOutB;
-        mean_b.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_b.init (width, height, radius, boxScaling, Staging::NONE);
-
-        q.setArg (0, dBufferIn);
-        q.setArg (1, mean_a.get (BoxFilterSAT::Memory::D_OUT));
-        q.setArg (2, mean_b.get (BoxFilterSAT::Memory::D_OUT));
-        q.setArg (3, dBufferOut);
-        q.setArg (4, zero_out);
-        q.setArg (5, outputScaling);
-        
-        // Set workspaces (common to both own kernels: ab, q)
-        global = cl::NDRange (width * height / 4);
+        // Set kernel arguments
+        kernel.setArg (0, dBufferIn);
+        kernel.setArg (1, dBufferOut);
+        kernel.setArg (2, cl::Local (4 * 4 * local[0] * local[1] * sizeof (cl_float)));
     }
 
 
     /*! \details The transfer happens from a staging buffer on the host to the 
      *           associated (specified) device buffer.
-     *  \note The transfer is handled by the first command queue.
      *  
      *  \param[in] mem enumeration value specifying an input device buffer.
      *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
@@ -3622,17 +3956,17 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::write (
-        GuidedFilter::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    void Transpose::write (Transpose::Memory mem, void *ptr, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case GuidedFilter::Memory::D_IN:
+                case Transpose::Memory::D_IN:
                     if (ptr != nullptr)
                         std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
-                    queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
                     break;
                 default:
                     break;
@@ -3643,7 +3977,6 @@ namespace GF
 
     /*! \details The transfer happens from a device buffer to the associated 
      *           (specified) staging buffer on the host.
-     *  \note The transfer is handled by the first command queue.
      *  
      *  \param[in] mem enumeration value specifying an output staging buffer.
      *  \param[in] block a flag to indicate whether to perform a blocking 
@@ -3651,15 +3984,15 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* GuidedFilter<GuidedFilterConfig::I_EQ_P>::read (
-        GuidedFilter::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    void* Transpose::read (Transpose::Memory mem, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case GuidedFilter::Memory::H_OUT:
-                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                case Transpose::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
                     return nullptr;
@@ -3674,141 +4007,75 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the kernel execution.
      */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::run (const std::vector<cl::Event> *events, cl::Event *event)
-    {
-        mean_p.run (events);
-        squared.run (events);
-        mean_p2.run (nullptr, &p2Event); waitListAB[0] = p2Event;
-        queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, &waitListAB, &abEvent);
-        mean_a.run ();
-        waitListMB[0] = abEvent;
-        mean_b.run (&waitListMB, &mbEvent); waitListQ[0] = mbEvent;
-        queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, &waitListQ, event);
-    }
-
-
-    /*! \return The radius of the square filter window.
-     */
-    int GuidedFilter<GuidedFilterConfig::I_EQ_P>::getRadius ()
-    {
-        return radius;
-    }
-
-
-    /*! \details Updates the kernel argument for the filter window radius.
-     *
-     *  \param[in] _radius radius of the square filter window.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setRadius (int _radius)
-    {
-        radius = _radius;
-        mean_p.setRadius (radius);
-        mean_p2.setRadius (radius);
-        mean_a.setRadius (radius);
-        mean_b.setRadius (radius);
-    }
-
-
-    /*! \return The regularization parameter \f$\epsilon\f$.
-     */
-    float GuidedFilter<GuidedFilterConfig::I_EQ_P>::getEps ()
-    {
-        return eps;
-    }
-
-
-    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
-     *
-     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setEps (float _eps)
-    {
-        eps = _eps;
-        ab.setArg (4, eps);
-    }
-
-
-    /*! \return The scaling factor applied internally to `BoxFilterSAT`.
-     */
-    float GuidedFilter<GuidedFilterConfig::I_EQ_P>::getBoxScaling ()
+    void Transpose::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        return boxScaling;
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
     }
 
 
-    /*! \details Updates the kernel argument for internal scaling 
-     *           of the array elements in `BoxFilterSAT`.
+    /*! \details The kernels are recorded as `run` would enqueue them.
      *
-     *  \param[in] _boxScaling scaling factor for `BoxFilterSAT`.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setBoxScaling (float _boxScaling)
-    {
-        boxScaling = _boxScaling;
-        mean_p.setScaling (boxScaling);
-        mean_p2.setScaling (boxScaling);
-        mean_a.setScaling (boxScaling);
-        mean_b.setScaling (boxScaling);
-    }
-
-
-    /*! \return The scaling factor for the output array.
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
      */
-    float GuidedFilter<GuidedFilterConfig::I_EQ_P>::getOutputScaling ()
+    void Transpose::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
     {
-        return outputScaling;
+        graph.add (queue, kernel, cl::NullRange, global, local, deps, node);
     }
 
 
-    /*! \details Updates the kernel argument for scaling of the output array.
+    /*! \details Each work-item processes a 4x4 block of data, so both array 
+     *           dimensions, after divided by 4, have to be multiples of the 
+     *           side of the (square) work-group.
      *
-     *  \param[in] _outputScaling scaling factor for the output array.
+     *  \param[in] _width width of the input array.
+     *  \param[in] _height height of the input array.
+     *  \param[in] params work-group configuration, \f$ \{lSide\} \f$.
+     *  \return Whether the configuration can be used on this device.
      */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setOutputScaling (float _outputScaling)
+    bool Transpose::validConfig (unsigned int _width, unsigned int _height, 
+                                 const std::vector<unsigned int> &params)
     {
-        outputScaling = _outputScaling;
-        mean_p.setScaling (outputScaling);
-        mean_p2.setScaling (outputScaling);
-        mean_a.setScaling (outputScaling);
-        mean_b.setScaling (outputScaling);
-    }
-
+        if (params.size () != 1) return false;
 
-    /*! \return The `zero_out` flag.
-     */
-    int GuidedFilter<GuidedFilterConfig::I_EQ_P>::getZeroing ()
-    {
-        return zero_out;
-    }
+        size_t lSide = params[0];
+        if ((lSide == 0) || ((_width / 4) % lSide) || ((_height / 4) % lSide)) return false;
 
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+        size_t maxLocalSize = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device);
+        std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
+        cl_ulong localMem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE> () - 
+            kernel.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE> (device);
 
-    /*! \details Updates the kernel argument for the `zero_out` flag.
-     *
-     *  \param[in] _zero_out `zero_out` flag.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setZeroing (int _zero_out)
-    {
-        zero_out = _zero_out;
-        q.setArg (4, zero_out);
+        return (lSide <= maxLocalDim[0]) && (lSide <= maxLocalDim[1]) && 
+               (lSide * lSide <= maxLocalSize) && 
+               (4 * 4 * lSide * lSide * sizeof (cl_float) <= localMem);
     }
 
 
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
-     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     *  \param[in] _transposed a flag to indicate whether to leave the output 
+     *                         array in a transposed configuration, or not. If 
+     *                         false, a (second) transposition is performed on 
+     *                         the output array to bring the array at the 
+     *                         initial configuration.
      */
-    GuidedFilter<GuidedFilterConfig::I_NEQ_P>::GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
-        env (_env), info (_info), 
+    SAT::SAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info, bool _transposed) : 
+        counters ("SAT"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-        mean_I  (env, info.getCLEnvInfo (0)), mean_p  (env, info.getCLEnvInfo (1)), 
-        corr_I  (env, info.getCLEnvInfo (0)), corr_Ip (env, info.getCLEnvInfo (1)), 
-        mean_a  (env, info.getCLEnvInfo (0)), mean_b  (env, info.getCLEnvInfo (1)), 
-        mult_II (env, info.getCLEnvInfo (0)), mult_Ip (env, info.getCLEnvInfo (1)), 
-        var (env.getProgram (info.pgIdx), "gf_var_Ip"), 
-        ab (env.getProgram (info.pgIdx), "gf_ab_Ip"), 
-        q (env.getProgram (info.pgIdx), "gf_q"), 
-        waitListVar (1), waitListMB(1), waitListQ (1)
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        scanRows    (Scan (env, info)), transpose1 (Transpose (env, info)),
+        scanColumns (Scan (env, info)), transpose2 (Transpose (env, info)), 
+        transposed (_transposed)
     {
+        scanRows.counters.setParent (counters);
+        transpose1.counters.setParent (counters);
+        scanColumns.counters.setParent (counters);
+        transpose2.counters.setParent (counters);
     }
 
 
@@ -3817,30 +4084,19 @@ namespace GF
      *  \param[in] mem enumeration value specifying the requested memory object.
      *  \return A reference to the requested memory object.
      */
-    cl::Memory& GuidedFilter<GuidedFilterConfig::I_NEQ_P>::get (GuidedFilter::Memory mem)
+    cl::Memory& SAT::get (SAT::Memory mem)
     {
         switch (mem)
         {
-            case GuidedFilter::Memory::H_IN_I:
-                return hBufferInI;
-            case GuidedFilter::Memory::H_IN_P:
-                return hBufferInP;
-            case GuidedFilter::Memory::H_OUT:
+            case SAT::Memory::H_IN:
+                return hBufferIn;
+            case SAT::Memory::H_OUT:
                 return hBufferOut;
-            case GuidedFilter::Memory::D_IN_I:
-                return dBufferInI;
-            case GuidedFilter::Memory::D_IN_P:
-                return dBufferInP;
-            case GuidedFilter::Memory::D_OUT:
-                return dBufferOut;
-            case GuidedFilter::Memory::D_A:
-                return dBufferOutA;
-            case GuidedFilter::Memory::D_B:
-                return dBufferOutB;
-            case GuidedFilter::Memory::D_VAR_I:
-                return dBufferOutVarI;
-            case GuidedFilter::Memory::D_COV_IP:
-                return dBufferOutCovIp;
+            case SAT::Memory::D_IN:
+                return scanRows.get (Scan::Memory::D_IN);
+            case SAT::Memory::D_OUT:
+                if (transposed) return scanColumns.get (Scan::Memory::D_OUT);
+                else return transpose2.get (Transpose::Memory::D_OUT);
         }
     }
 
@@ -3849,42 +4105,38 @@ namespace GF
      *  \note If you have assigned a memory object to one member variable of the class 
      *        before the call to `init`, then that memory will be maintained. Otherwise, 
      *        a new memory object will be created.
-     *  \note For better accuracy control a scaling is applied on the array elements 
-     *        internally in `BoxFilterSAT`. A default value of \f$ 0.0001\ (1e-4) \f$ 
-     *        is normally used. The input data are assumed to be of `uchar` type promoted 
-     *        to `float` and normalized to `1.0`. Configure the scaling for your own data.
+     *  \note Working with `float` elements and having large summations can be problematic.
+     *        It is advised that a scaling is applied on the elements for better accuracy.
+     *        
+     *  \note With a nonzero `_tile`, the scans are segmented every `_tile` elements, so 
+     *        each `_tile x _tile` block of the output holds the SAT of that block alone.
      *        
      *  \param[in] _width width of the input array to be processed.
      *  \param[in] _height height of the input array to be processed.
-     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
-     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
-     *  \param[in] _zero_out flag to indicate whether or not to zero out invalid pixels. 
-     *                       For more information, look at `gf_q`'s documentation 
-     *                       in `kernels/guidedFilter_kernels.cl`.
-     *  \param[in] _boxScaling scaling factor applied internally to `BoxFilterSAT`.
+     *  \param[in] _scaling factor by which to scale the array elements before processing.
      *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     *  \param[in] _tile side of the independent blocks. It has to be a multiple of 4 that 
+     *                   divides both array dimensions. If 0, the SAT spans the whole array.
      */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::init (
-        unsigned int _width, unsigned int _height, int _radius, float _eps, 
-        int _zero_out, float _boxScaling, Staging _staging)
+    void SAT::init (unsigned int _width, unsigned int _height, float _scaling, Staging _staging, unsigned int _tile)
     {
-        width = _width; height = _height; radius = _radius; eps = _eps;
+        width = _width; height = _height;
         bufferSize = width * height * sizeof (cl_float);
-        zero_out = _zero_out;
-        boxScaling = _boxScaling;
+        scaling = _scaling;
         staging = _staging;
+        tile = _tile;
 
         try
         {
             if ((width == 0) || (height == 0))
                 throw "The image cannot have zeroed dimensions";
 
-            if ((width * height) % 4 != 0)
-                throw "The number of elements in the array has to be a multiple of 4";
+            if (tile && ((tile % 4) || (width % tile) || (height % tile)))
+                throw "The tile side must be a multiple of 4 that divides both array dimensions";
         }
         catch (const char *error)
         {
-            std::cerr << "Error[GuidedFilter<GuidedFilterConfig::I_NEQ_P>]: " << error << std::endl;
+            std::cerr << "Error[SAT]: " << error << std::endl;
             exit (EXIT_FAILURE);
         }
 
@@ -3893,8 +4145,7 @@ namespace GF
         switch (staging)
         {
             case Staging::NONE:
-                hPtrInI = nullptr;
-                hPtrInP = nullptr;
+                hPtrIn = nullptr;
                 hPtrOut = nullptr;
                 break;
 
@@ -3902,114 +4153,59 @@ namespace GF
                 io = true;
 
             case Staging::I:
-                if (hBufferInI () == nullptr)
-                    hBufferInI = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
-                if (hBufferInP () == nullptr)
-                    hBufferInP = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
-                hPtrInI = (cl_float *) queue0.enqueueMapBuffer (
-                    hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
-                hPtrInP = (cl_float *) queue0.enqueueMapBuffer (
-                    hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
-                queue0.enqueueUnmapMemObject (hBufferInI, hPtrInI);
-                queue0.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
                 if (!io)
                 {
-                    queue0.finish ();
+                    queue.finish ();
                     hPtrOut = nullptr;
                     break;
                 }
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
-                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
-                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
-                queue0.finish ();
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
 
-                if (!io) { hPtrInI = nullptr; hPtrInP = nullptr; }
+                if (!io) hPtrIn = nullptr;
                 break;
         }
-        
-        // Create device buffers
-        if (dBufferInI () == nullptr)
-            dBufferInI = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
-        if (dBufferInP () == nullptr)
-            dBufferInP = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
-        if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
 
-        mean_I.get (BoxFilterSAT::Memory::D_IN) = dBufferInI;
-        mean_I.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_I.init (width, height, radius, boxScaling, Staging::NONE);
+        // Segmented scans treat every tile-wide piece of a row as a row of its own
+        if (tile)
+            scanRows.init (tile, width * height / tile, scaling, Staging::NONE);
+        else
+            scanRows.init (width, height, scaling, Staging::NONE);
 
-        mean_p.get (BoxFilterSAT::Memory::D_IN) = dBufferInP;
-        mean_p.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_p.init (width, height, radius, boxScaling, Staging::NONE);
+        transpose1.get (Transpose::Memory::D_IN) = scanRows.get (Scan::Memory::D_OUT);
+        transpose1.get (Transpose::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        transpose1.init (width, height, Staging::NONE);
 
-        mult_II.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
-        mult_II.get (Math::Mult::Memory::D_IN_B) = dBufferInI;
-        mult_II.get (Math::Mult::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mult_II.init (width, height, Staging::NONE);
-
-        mult_Ip.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
-        mult_Ip.get (Math::Mult::Memory::D_IN_B) = dBufferInP;
-        mult_Ip.get (Math::Mult::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mult_Ip.init (width, height, Staging::NONE);
-
-        corr_I.get (BoxFilterSAT::Memory::D_IN) = mult_II.get (Math::Mult::Memory::D_OUT);
-        corr_I.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        corr_I.init (width, height, radius, boxScaling, Staging::NONE);
-
-        corr_Ip.get (BoxFilterSAT::Memory::D_IN) = mult_Ip.get (Math::Mult::Memory::D_OUT);
-        corr_Ip.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        corr_Ip.init (width, height, radius, boxScaling, Staging::NONE);
-
-        dBufferOutVarI = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        dBufferOutCovIp = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        var.setArg (0, corr_I.get (BoxFilterSAT::Memory::D_OUT));
-        var.setArg (1, corr_Ip.get (BoxFilterSAT::Memory::D_OUT));
-        var.setArg (2, mean_I.get (BoxFilterSAT::Memory::D_OUT));
-        var.setArg (3, mean_p.get (BoxFilterSAT::Memory::D_OUT));
-        var.setArg (4, dBufferOutVarI);
-        var.setArg (5, dBufferOutCovIp);
-
-        dBufferOutA = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        dBufferOutB = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        ab.setArg (0, dBufferOutVarI);
-        ab.setArg (1, dBufferOutCovIp);
-        ab.setArg (2, mean_I.get (BoxFilterSAT::Memory::D_OUT));
-        ab.setArg (3, mean_p.get (BoxFilterSAT::Memory::D_OUT));
-        ab.setArg (4, dBufferOutA);
-        ab.setArg (5, dBufferOutB);
-        ab.setArg (6, eps);
-
-        mean_a.get (BoxFilterSAT::Memory::D_IN) = dBufferOutA;
-        mean_a.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_a.init (width, height, radius, boxScaling, Staging::NONE);
-
-        mean_b.get (BoxFilterSAT::Memory::D_IN) = dBufferOutB;
-        mean_b.get (BoxFilterSAT::Memory::D_OUT) = cl::Buffer (context, CL_MEM_READ_WRITE, bufferSize);
-        mean_b.init (width, height, radius, boxScaling, Staging::NONE);
+        scanColumns.get (Scan::Memory::D_IN) = transpose1.get (Transpose::Memory::D_OUT);
+        if (tile)
+            scanColumns.init (tile, width * height / tile, 1.f, Staging::NONE);
+        else
+            scanColumns.init (height, width, 1.f, Staging::NONE);
 
-        q.setArg (0, dBufferInI);
-        q.setArg (1, mean_a.get (BoxFilterSAT::Memory::D_OUT));
-        q.setArg (2, mean_b.get (BoxFilterSAT::Memory::D_OUT));
-        q.setArg (3, dBufferOut);
-        q.setArg (4, zero_out);
-        q.setArg (5, 1.f);
-        
-        // Set workspaces (common to both own kernels: ab, q)
-        global = cl::NDRange (width * height / 4);
+        if (!transposed)
+        {
+            transpose2.get (Transpose::Memory::D_IN) = scanColumns.get (Scan::Memory::D_OUT);
+            transpose2.init (height, width, Staging::NONE);
+        }
     }
 
 
     /*! \details The transfer happens from a staging buffer on the host to the 
      *           associated (specified) device buffer.
-     *  \note The transfer is handled by the first command queue.
      *  
      *  \param[in] mem enumeration value specifying an input device buffer.
      *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
@@ -4019,22 +4215,18 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the write operation to the device buffer.
      */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::write (
-        GuidedFilter::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    void SAT::write (SAT::Memory mem, void *ptr, bool block, 
+                     const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::I || staging == Staging::IO)
         {
             switch (mem)
             {
-                case GuidedFilter::Memory::D_IN_I:
-                    if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInI);
-                    queue0.enqueueWriteBuffer (dBufferInI, block, 0, bufferSize, hPtrInI, events, event);
-                    break;
-                case GuidedFilter::Memory::D_IN_P:
+                case SAT::Memory::D_IN:
                     if (ptr != nullptr)
-                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInP);
-                    queue0.enqueueWriteBuffer (dBufferInP, block, 0, bufferSize, hPtrInP, events, event);
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer ((cl::Buffer&) scanRows.get (Scan::Memory::D_IN), 
+                        block, 0, bufferSize, hPtrIn, events, event);
                     break;
                 default:
                     break;
@@ -4045,7 +4237,6 @@ namespace GF
 
     /*! \details The transfer happens from a device buffer to the associated 
      *           (specified) staging buffer on the host.
-     *  \note The transfer is handled by the first command queue.
      *  
      *  \param[in] mem enumeration value specifying an output staging buffer.
      *  \param[in] block a flag to indicate whether to perform a blocking 
@@ -4053,15 +4244,20 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the read operation to the staging buffer.
      */
-    void* GuidedFilter<GuidedFilterConfig::I_NEQ_P>::read (
-        GuidedFilter::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    void* SAT::read (SAT::Memory mem, bool block, 
+                     const std::vector<cl::Event> *events, cl::Event *event)
     {
         if (staging == Staging::O || staging == Staging::IO)
         {
             switch (mem)
             {
-                case GuidedFilter::Memory::H_OUT:
-                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                case SAT::Memory::H_OUT:
+                    if (transposed)
+                        queue.enqueueReadBuffer ((cl::Buffer&) scanColumns.get (Scan::Memory::D_OUT), 
+                            block, 0, bufferSize, hPtrOut, events, event);
+                    else
+                        queue.enqueueReadBuffer ((cl::Buffer&) transpose2.get (Transpose::Memory::D_OUT), 
+                            block, 0, bufferSize, hPtrOut, events, event);
                     return hPtrOut;
                 default:
                     return nullptr;
@@ -4076,127 +4272,7506 @@ namespace GF
      *  \param[in] events a wait-list of events.
      *  \param[out] event event associated with the kernel execution.
      */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::run (const std::vector<cl::Event> *events, cl::Event *event)
+    void SAT::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
-        mean_I.run (events);
-        mean_p.run (events);
-        
-        mult_II.run (events);
-        corr_I.run ();
-        mult_Ip.run (events);
-        corr_Ip.run (nullptr, &corrIpEvent); waitListVar[0] = corrIpEvent;
+        Counters::Frame frame (counters, event);
+        scanRows.run (events);
+        transpose1.run ();
+        scanColumns.run ();
+
+        if (!transposed)
+            transpose2.run (nullptr, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void SAT::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        scanRows.record (graph, deps);
+        transpose1.record (graph);
+
+        if (transposed)
+        {
+            scanColumns.record (graph, nullptr, node);
+        }
+        else
+        {
+            scanColumns.record (graph);
+            transpose2.record (graph, nullptr, node);
+        }
+    }
+
+
+    /*! \return The scaling factor.
+     */
+    float SAT::getScaling ()
+    {
+        return scaling;
+    }
+
+
+    /*! \details Updates the kernel argument for the scaling factor of the rows scan.
+     *
+     *  \param[in] _scaling scaling factor.
+     */
+    void SAT::setScaling (float _scaling)
+    {
+        scaling = _scaling;
+        scanRows.setScaling (scaling);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    Normals::Normals (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("Normals"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernelMoments (env.getProgram (info.pgIdx), "pcMoments"), 
+        kernelNormals (env.getProgram (info.pgIdx), "pcNormals"), 
+        sat (SAT (env, info)), tile (0)
+    {
+        sat.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& Normals::get (Normals::Memory mem)
+    {
+        switch (mem)
+        {
+            case Normals::Memory::H_IN:
+                return hBufferIn;
+            case Normals::Memory::H_OUT:
+                return hBufferOut;
+            case Normals::Memory::D_IN:
+                return dBufferIn;
+            case Normals::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the organized point cloud (as produced by `DepthTo3D`).
+     *  \param[in] _height height of the organized point cloud.
+     *  \param[in] _radius radius of the neighborhood window.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void Normals::init (unsigned int _width, unsigned int _height, int _radius, Staging _staging)
+    {
+        width = _width; height = _height;
+        bufferSize = width * height * sizeof (cl_float4);
+        radius = _radius;
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The point cloud cannot have zeroed dimensions";
+
+            if (radius <= 0)
+                throw "The radius must be a positive number";
+
+            if (tileSide (radius) == 0)
+                throw "There is no tile side that fits the window and divides both dimensions";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[Normals]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Set workspaces
+        global = cl::NDRange (width, height);
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float4 *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float4 *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
         
-        queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, &waitListVar);
-        queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &abEvent);
-        mean_a.run ();
-        waitListMB[0] = abEvent;
-        mean_b.run (&waitListMB, &mbEvent); waitListQ[0] = mbEvent;
-        queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, &waitListQ, event);
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        // The moments are laid out side by side, in a (nMoments * width) x height array
+        sat.get (SAT::Memory::D_IN) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, nMoments * width * height * sizeof (cl_float));
+
+        tile = 0;
+        initSAT ();
+
+        // Set kernel arguments
+        kernelMoments.setArg (0, dBufferIn);
+        kernelMoments.setArg (1, sat.get (SAT::Memory::D_IN));
+
+        kernelNormals.setArg (0, dBufferIn);
+        kernelNormals.setArg (1, sat.get (SAT::Memory::D_OUT));
+        kernelNormals.setArg (2, dBufferOut);
+        kernelNormals.setArg (3, radius);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void Normals::write (Normals::Memory mem, void *ptr, bool block, 
+                         const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case Normals::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float4 *) ptr, (cl_float4 *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
     }
 
 
-    /*! \return The radius of the square filter window.
-     */
-    int GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getRadius ()
-    {
-        return radius;
-    }
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* Normals::read (Normals::Memory mem, bool block, 
+                         const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case Normals::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void Normals::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernelMoments, cl::NullRange, global, cl::NullRange, events);
+        sat.run ();
+        queue.enqueueNDRangeKernel (kernelNormals, cl::NullRange, global, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \return The radius of the neighborhood window.
+     */
+    int Normals::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the radius, 
+     *           and rebuilds the `SAT` if the tile side changes.
+     *
+     *  \param[in] _radius radius of the neighborhood window.
+     */
+    void Normals::setRadius (int _radius)
+    {
+        try
+        {
+            if ((_radius <= 0) || (tileSide (_radius) == 0))
+                throw "There is no tile side that fits the window and divides both dimensions";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[Normals]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        radius = _radius;
+        initSAT ();
+
+        kernelNormals.setArg (1, sat.get (SAT::Memory::D_OUT));
+        kernelNormals.setArg (3, radius);
+    }
+
+
+    /*! \details A window has to span at most two tiles per dimension, so the 
+     *           tile side has to be at least \f$ 2*radius+1 \f$. Smaller tiles 
+     *           keep the partial sums small, but tiles under 16 leave the 
+     *           scan work-groups mostly idle.
+     *
+     *  \param[in] _radius radius of the neighborhood window.
+     *  \return The tile side, or 0 if no side satisfies the constraints.
+     */
+    unsigned int Normals::tileSide (int _radius)
+    {
+        unsigned int minSide = std::max (2 * _radius + 1, 16);
+        for (unsigned int side = 4; side <= std::min (width, height); side += 4)
+            if ((side >= minSide) && (width % side == 0) && (height % side == 0))
+                return side;
+
+        return 0;
+    }
+
+
+    /*! \details The `SAT` is only rebuilt when the tile side changes. */
+    void Normals::initSAT ()
+    {
+        unsigned int side = tileSide (radius);
+        if (side == tile) return;
+
+        tile = side;
+        sat.init (nMoments * width, height, 1.f, Staging::NONE, tile);
+
+        kernelMoments.setArg (2, tile);
+        kernelNormals.setArg (4, tile);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    BoxFilterSAT::BoxFilterSAT (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("BoxFilterSAT"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "boxFilterSAT_Tr"),
+        sat (_env, _info)
+    {
+        sat.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& BoxFilterSAT::get (BoxFilterSAT::Memory mem)
+    {
+        switch (mem)
+        {
+            case BoxFilterSAT::Memory::H_IN:
+                return hBufferIn;
+            case BoxFilterSAT::Memory::H_OUT:
+                return hBufferOut;
+            case BoxFilterSAT::Memory::D_IN:
+                return sat.get (SAT::Memory::D_IN);
+            case BoxFilterSAT::Memory::D_OUT:
+                return dBufferOut;
+            case BoxFilterSAT::Memory::D_SAT:
+                return dBufferSat;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note Working with `float` elements and having large summations can be problematic.
+     *        It is advised that a scaling is applied on the elements for better accuracy.
+     *        A default value of \f$ 0.0001\ (1e-4) \f$ is normally applied. This scaling
+     *        is only internal to the algorithm. No further processing is necessary on the output buffer.
+     *  \note The work-group dimensions are looked up in the `TuningProfile`. If there is 
+     *        no (valid) entry, `16x16` work-groups are used, or `8x8` and `4x4` ones 
+     *        when the image dimensions are not multiples of 16.
+     *  \note If a summed area table of another instance has been assigned to `D_SAT`, 
+     *        the instance doesn't compute its own, and `D_IN` is not used.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _scaling factor by which to scale the array elements before processing.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void BoxFilterSAT::init (unsigned int _width, unsigned int _height, int _radius, float _scaling, Staging _staging)
+    {
+        width = _width; height = _height; radius = _radius;
+        bufferSize = width * height * sizeof (cl_float);
+        scaling = _scaling;
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            // Choose the work-group dimensions
+            //* A tuned configuration takes precedence
+            //* Otherwise, the largest of 16x16, 8x8, 4x4 that fits
+            std::vector<unsigned int> params;
+            if (!TuningProfile::instance ().lookup (env.devices[info.pIdx][info.dIdx], 
+                    "BoxFilterSAT", width, height, params) || !validConfig (width, height, params))
+            {
+                unsigned int side;
+                for (side = 16; side >= 4; side >>= 1)
+                {
+                    params = { side, side };
+                    if (validConfig (width, height, params)) break;
+                }
+
+                if (side < 4)
+                    throw "The image dimensions have to be multiples of 4, and "
+                          "4x4 work-groups have to be supported on this device";
+            }
+
+            lXdim = params[0]; lYdim = params[1];
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[BoxFilterSAT]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        size_t localSize = lXdim * lYdim;
+        size_t wgMultiple = kernel.getWorkGroupInfo
+            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (env.devices[info.pIdx][info.dIdx]);
+        if (localSize % wgMultiple)
+            std::cout << "Warning[BoxFilterSAT]: The work-group size [" << localSize 
+                      << "] is not a multiple of the preferred size [" 
+                      << wgMultiple << "] on this device" << std::endl;
+        
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+
+        // A table other than the own one is shared by another instance
+        ownSat = (dBufferSat () == nullptr) || (dBufferSat () == sat.get (SAT::Memory::D_OUT) ());
+        if (ownSat)
+        {
+            sat.init (width, height, scaling, Staging::NONE);
+            dBufferSat = (cl::Buffer&) sat.get (SAT::Memory::D_OUT);
+        }
+
+        // Create device buffers
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        // Set workspaces
+        global = cl::NDRange (height, width);
+        local = cl::NDRange (lXdim, lYdim);
+
+        // Set kernel arguments
+        kernel.setArg (0, dBufferSat);
+        kernel.setArg (1, dBufferOut);
+        kernel.setArg (2, cl::Local (lXdim * lYdim * sizeof (float)));
+        kernel.setArg (3, radius);
+        kernel.setArg (4, 1.f / scaling);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void BoxFilterSAT::write (BoxFilterSAT::Memory mem, void *ptr, bool block, 
+                              const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case BoxFilterSAT::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer ((cl::Buffer&) sat.get (SAT::Memory::D_IN), 
+                        block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* BoxFilterSAT::read (BoxFilterSAT::Memory mem, bool block, 
+                              const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case BoxFilterSAT::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void BoxFilterSAT::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (ownSat)
+        {
+            sat.run (events);
+            events = nullptr;
+        }
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void BoxFilterSAT::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        if (ownSat)
+        {
+            sat.record (graph, deps);
+            deps = nullptr;
+        }
+        graph.add (queue, kernel, cl::NullRange, global, local, deps, node);
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int BoxFilterSAT::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the filter window radius.
+     *
+     *  \param[in] _radius the radius of the square filter window.
+     */
+    void BoxFilterSAT::setRadius (int _radius)
+    {
+        radius = _radius;
+        kernel.setArg (3, radius);
+    }
+
+    /*! \return The scaling factor.
+     */
+    float BoxFilterSAT::getScaling ()
+    {
+        return scaling;
+    }
+
+
+    /*! \details Updates the kernel argument for the scaling factor.
+     *
+     *  \param[in] _scaling scaling factor.
+     */
+    void BoxFilterSAT::setScaling (float _scaling)
+    {
+        scaling = _scaling;
+        if (ownSat) sat.setScaling (scaling);
+        kernel.setArg (4, 1.f / scaling);
+    }
+
+
+    /*! \details The `boxFilterSAT_Tr` kernel stores \f$ 4 \f$ pixel blocks, so the **y** 
+     *           dimension of the work-group has to be a multiple of 4. The image height 
+     *           and width have to be multiples of the **x** and **y** dimensions, respectively.
+     *
+     *  \param[in] _width width of the input array.
+     *  \param[in] _height height of the input array.
+     *  \param[in] params work-group configuration, \f$ \{lXdim, lYdim\} \f$.
+     *  \return Whether the configuration can be used on this device.
+     */
+    bool BoxFilterSAT::validConfig (unsigned int _width, unsigned int _height, 
+                                    const std::vector<unsigned int> &params)
+    {
+        if (params.size () != 2) return false;
+
+        size_t lX = params[0], lY = params[1];
+        if ((lX == 0) || (lY == 0) || (lY % 4) || (_height % lX) || (_width % lY)) return false;
+
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+        size_t maxLocalSize = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device);
+        std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
+        cl_ulong localMem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE> () - 
+            kernel.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE> (device);
+
+        return (lX <= maxLocalDim[0]) && (lY <= maxLocalDim[1]) && 
+               (lX * lY <= maxLocalSize) && (lX * lY * sizeof (cl_float) <= localMem);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    SAT3D::SAT3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("SAT3D"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        scanRows (Scan (env, info)), scanColumns (Scan (env, info)), 
+        transpose (Transpose (env, info)), 
+        kernel (env.getProgram (info.pgIdx), "scanSlices")
+    {
+        scanRows.counters.setParent (counters);
+        scanColumns.counters.setParent (counters);
+        transpose.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& SAT3D::get (SAT3D::Memory mem)
+    {
+        switch (mem)
+        {
+            case SAT3D::Memory::H_IN:
+                return hBufferIn;
+            case SAT3D::Memory::H_OUT:
+                return hBufferOut;
+            case SAT3D::Memory::D_IN:
+                return scanRows.get (Scan::Memory::D_IN);
+            case SAT3D::Memory::D_OUT:
+                return scanColumns.get (Scan::Memory::D_OUT);
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note Working with `float` elements and having large summations can be problematic.
+     *        It is advised that a scaling is applied on the elements for better accuracy.
+     *        
+     *  \param[in] _width width of the slices of the volume to be processed.
+     *  \param[in] _height height of the slices of the volume to be processed.
+     *  \param[in] _depth number of slices in the volume to be processed.
+     *  \param[in] _scaling factor by which to scale the elements before processing.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void SAT3D::init (unsigned int _width, unsigned int _height, unsigned int _depth, 
+                      float _scaling, Staging _staging)
+    {
+        width = _width; height = _height; depth = _depth;
+        bufferSize = width * height * depth * sizeof (cl_float);
+        scaling = _scaling;
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0) || (depth == 0))
+                throw "The volume cannot have zeroed dimensions";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[SAT3D]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+
+        // The rows of all slices are scanned at once
+        scanRows.init (width, height * depth, scaling, Staging::NONE);
+
+        transpose.get (Transpose::Memory::D_IN) = scanRows.get (Scan::Memory::D_OUT);
+        transpose.get (Transpose::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        transpose.init (width, height * depth, Staging::NONE);
+
+        // After the transposition, the columns of a slice are height-wide pieces of the rows
+        scanColumns.get (Scan::Memory::D_IN) = transpose.get (Transpose::Memory::D_OUT);
+        scanColumns.init (height, width * depth, 1.f, Staging::NONE);
+
+        // Set workspaces
+        global = cl::NDRange (height, width);
+
+        // Set kernel arguments
+        kernel.setArg (0, scanColumns.get (Scan::Memory::D_OUT));
+        kernel.setArg (1, (int) depth);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void SAT3D::write (SAT3D::Memory mem, void *ptr, bool block, 
+                       const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case SAT3D::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height * depth, hPtrIn);
+                    queue.enqueueWriteBuffer ((cl::Buffer&) scanRows.get (Scan::Memory::D_IN), 
+                        block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* SAT3D::read (SAT3D::Memory mem, bool block, 
+                       const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case SAT3D::Memory::H_OUT:
+                    queue.enqueueReadBuffer ((cl::Buffer&) scanColumns.get (Scan::Memory::D_OUT), 
+                        block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void SAT3D::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        scanRows.run (events);
+        transpose.run ();
+        scanColumns.run ();
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void SAT3D::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        scanRows.record (graph, deps);
+        transpose.record (graph);
+        scanColumns.record (graph);
+        graph.add (queue, kernel, cl::NullRange, global, cl::NullRange, nullptr, node);
+    }
+
+
+    /*! \return The scaling factor.
+     */
+    float SAT3D::getScaling ()
+    {
+        return scaling;
+    }
+
+
+    /*! \details Updates the kernel argument for the scaling factor of the rows scan.
+     *
+     *  \param[in] _scaling scaling factor.
+     */
+    void SAT3D::setScaling (float _scaling)
+    {
+        scaling = _scaling;
+        scanRows.setScaling (scaling);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    BoxFilterSAT3D::BoxFilterSAT3D (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("BoxFilterSAT3D"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "boxFilterSAT3D"), 
+        ringUpdate (env.getProgram (info.pgIdx), "ringUpdate"), 
+        ringAdvance (env.getProgram (info.pgIdx), "ringAdvance"), 
+        sat (_env, _info), box (_env, _info)
+    {
+        sat.counters.setParent (counters);
+        box.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& BoxFilterSAT3D::get (BoxFilterSAT3D::Memory mem)
+    {
+        switch (mem)
+        {
+            case BoxFilterSAT3D::Memory::H_IN:
+                return hBufferIn;
+            case BoxFilterSAT3D::Memory::H_OUT:
+                return hBufferOut;
+            case BoxFilterSAT3D::Memory::D_IN:
+                return dBufferIn;
+            case BoxFilterSAT3D::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note Working with `float` elements and having large summations can be problematic.
+     *        It is advised that a scaling is applied on the elements for better accuracy.
+     *        A default value of \f$ 0.0001\ (1e-4) \f$ is normally applied. This scaling
+     *        is only internal to the algorithm. No further processing is necessary on the output buffer.
+     *  \note In the `CAUSAL` case, the ring holds \f$ depth \f$ frames, and `_radiusZ` is not used.
+     *        
+     *  \param[in] _width width of the slices (frames).
+     *  \param[in] _height height of the slices (frames).
+     *  \param[in] _depth number of slices in the volume (`CENTERED`), or 
+     *                    number of frames in the window (`CAUSAL`).
+     *  \param[in] _radius radius of the window in a slice.
+     *  \param[in] _radiusZ radius of the window across the slices.
+     *  \param[in] _window kind of window across the slices.
+     *  \param[in] _scaling factor by which to scale the array elements before processing.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void BoxFilterSAT3D::init (unsigned int _width, unsigned int _height, unsigned int _depth, 
+                               int _radius, int _radiusZ, Window3D _window, float _scaling, Staging _staging)
+    {
+        width = _width; height = _height; depth = _depth;
+        radius = _radius; radiusZ = _radiusZ;
+        window = _window;
+        scaling = _scaling;
+        staging = _staging;
+
+        unsigned int n = width * height * (window == Window3D::CENTERED ? depth : 1);
+        bufferSize = n * sizeof (cl_float);
+
+        try
+        {
+            if ((width == 0) || (height == 0) || (depth == 0))
+                throw "The volume cannot have zeroed dimensions";
+
+            if ((width % 4) || (height % 4))
+                throw "The width and height of the slices have to be multiples of 4";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[BoxFilterSAT3D]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        if (window == Window3D::CENTERED)
+        {
+            sat.get (SAT3D::Memory::D_IN) = dBufferIn;
+            sat.init (width, height, depth, scaling, Staging::NONE);
+
+            // Set workspaces
+            global = cl::NDRange (height, width, depth);
+
+            // Set kernel arguments
+            kernel.setArg (0, sat.get (SAT3D::Memory::D_OUT));
+            kernel.setArg (1, dBufferOut);
+            kernel.setArg (2, radius);
+            kernel.setArg (3, radiusZ);
+            kernel.setArg (4, 1.f / scaling);
+        }
+        else
+        {
+            // The mean of the frames in the ring is filtered in 2D
+            dBufferRing = counters.allocate (context, CL_MEM_READ_WRITE, depth * bufferSize);
+            dBufferSum = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            dBufferState = counters.allocate (context, CL_MEM_READ_WRITE, 2 * sizeof (cl_uint));
+
+            box.get (BoxFilterSAT::Memory::D_IN) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            box.get (BoxFilterSAT::Memory::D_OUT) = dBufferOut;
+            box.init (width, height, radius, scaling, Staging::NONE);
+
+            // Set workspaces
+            globalRing = cl::NDRange (width * height / 4);
+
+            // Set kernel arguments
+            ringUpdate.setArg (0, dBufferIn);
+            ringUpdate.setArg (1, dBufferRing);
+            ringUpdate.setArg (2, dBufferSum);
+            ringUpdate.setArg (3, box.get (BoxFilterSAT::Memory::D_IN));
+            ringUpdate.setArg (4, dBufferState);
+            ringUpdate.setArg (5, depth);
+
+            ringAdvance.setArg (0, dBufferState);
+            ringAdvance.setArg (1, depth);
+
+            reset ();
+        }
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void BoxFilterSAT3D::write (BoxFilterSAT3D::Memory mem, void *ptr, bool block, 
+                                const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case BoxFilterSAT3D::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + bufferSize / sizeof (cl_float), hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* BoxFilterSAT3D::read (BoxFilterSAT3D::Memory mem, bool block, 
+                                const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case BoxFilterSAT3D::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details In the `CAUSAL` case, every call pushes the frame in `D_IN` in the ring.
+     *  \note The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void BoxFilterSAT3D::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (window == Window3D::CENTERED)
+        {
+            sat.run (events);
+            queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, nullptr, event);
+        }
+        else
+        {
+            queue.enqueueNDRangeKernel (ringUpdate, cl::NullRange, globalRing, cl::NullRange, events);
+            queue.enqueueNDRangeKernel (ringAdvance, cl::NullRange, cl::NDRange (1), cl::NullRange);
+            box.run (nullptr, event);
+        }
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them. The state 
+     *           of the ring is kept on the device, so every replay pushes a frame.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void BoxFilterSAT3D::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        if (window == Window3D::CENTERED)
+        {
+            sat.record (graph, deps);
+            graph.add (queue, kernel, cl::NullRange, global, cl::NullRange, nullptr, node);
+        }
+        else
+        {
+            graph.add (queue, ringUpdate, cl::NullRange, globalRing, cl::NullRange, deps);
+            graph.add (queue, ringAdvance, cl::NullRange, cl::NDRange (1), cl::NullRange);
+            box.record (graph, nullptr, node);
+        }
+    }
+
+
+    /*! \details The next frame starts a new window. The call is blocking. 
+     *           It has no effect in the `CENTERED` case.
+     */
+    void BoxFilterSAT3D::reset ()
+    {
+        if (window != Window3D::CAUSAL) return;
+
+        cl_uint state[2] = { 0, 0 };
+        queue.enqueueWriteBuffer (dBufferState, CL_TRUE, 0, sizeof (state), state);
+    }
+
+
+    /*! \return The kind of window across the slices.
+     */
+    Window3D BoxFilterSAT3D::getWindow ()
+    {
+        return window;
+    }
+
+
+    /*! \return The radius of the window in a slice.
+     */
+    int BoxFilterSAT3D::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the radius of the window in a slice.
+     *
+     *  \param[in] _radius radius of the window in a slice.
+     */
+    void BoxFilterSAT3D::setRadius (int _radius)
+    {
+        radius = _radius;
+        if (window == Window3D::CENTERED) kernel.setArg (2, radius);
+        else box.setRadius (radius);
+    }
+
+
+    /*! \return The radius of the window across the slices.
+     */
+    int BoxFilterSAT3D::getRadiusZ ()
+    {
+        return radiusZ;
+    }
+
+
+    /*! \details Updates the kernel argument for the radius of the window across the slices. 
+     *           In the `CAUSAL` case, the window spans the frames in the ring, whatever the radius.
+     *
+     *  \param[in] _radiusZ radius of the window across the slices.
+     */
+    void BoxFilterSAT3D::setRadiusZ (int _radiusZ)
+    {
+        radiusZ = _radiusZ;
+        if (window == Window3D::CENTERED) kernel.setArg (3, radiusZ);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    BoxFilter::BoxFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("BoxFilter"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernel (env.getProgram (info.pgIdx), "boxFilter")
+    {
+        // The class requires 16x16 work-groups (256 work-items per work-group)
+        // The following code checks that this specification is possible
+
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+
+        size_t maxLocalSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE> ();
+
+        std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
+
+        size_t wgMultiple = kernel.getWorkGroupInfo
+            <CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE> (device);
+
+        size_t localSize = lXdim * lYdim;
+
+        try
+        {
+            if ((lXdim > maxLocalDim[0]) || (lYdim > maxLocalDim[1]))
+            {
+                std::ostringstream ss;
+                ss << "The maximum work-group dimensions ";
+                ss << "[" << maxLocalDim[0] << "][" << maxLocalDim[1] << "] ";
+                ss << "are not enough (16x16 work-groups are required) on this device";
+                throw ss.str ();
+            }
+
+            if (localSize > maxLocalSize)
+            {
+                std::ostringstream ss;
+                ss << "The maximum work-group size ";
+                ss << "[" << maxLocalSize << "] " << "is not enough ";
+                ss << "(256 work-items per work-group are required) on this device";
+                throw ss.str ();
+            }
+
+        }
+        catch (const std::string &error)
+        {
+            std::cerr << "Error[BoxFilter]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        if (localSize % wgMultiple)
+            std::cout << "Warning[BoxFilter]: The work-group size [" << localSize 
+                      << "] is not a multiple of the preferred size [" 
+                      << wgMultiple << "] on this device" << std::endl;
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& BoxFilter::get (BoxFilter::Memory mem)
+    {
+        switch (mem)
+        {
+            case BoxFilter::Memory::H_IN:
+                return hBufferIn;
+            case BoxFilter::Memory::H_OUT:
+                return hBufferOut;
+            case BoxFilter::Memory::D_IN:
+                return dBufferIn;
+            case BoxFilter::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void BoxFilter::init (unsigned int _width, unsigned int _height, int _radius, Staging _staging)
+    {
+        width = _width; height = _height; radius = _radius;
+        bufferSize = width * height * sizeof (cl_float);
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            if (height % lXdim != 0)
+            {
+                std::ostringstream ss;
+                ss << "The image width has to be a multiple of " << lXdim;
+                throw ss.str ().c_str ();
+            }
+
+            if (width % lYdim != 0)
+            {
+                std::ostringstream ss;
+                ss << "The image height has to be a multiple of " << lYdim;
+                throw ss.str ().c_str ();
+            }
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[BoxFilter]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+        
+        // Set workspaces
+        global = cl::NDRange (width, height);
+        local = cl::NDRange (lXdim, lYdim);
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        // Set kernel arguments
+        kernel.setArg (0, dBufferIn);
+        kernel.setArg (1, dBufferOut);
+        kernel.setArg (2, cl::Local ((lXdim + 2 * radius) * (lYdim + 2 * radius) * sizeof (cl_float)));
+        kernel.setArg (3, radius);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void BoxFilter::write (BoxFilter::Memory mem, void *ptr, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case BoxFilter::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* BoxFilter::read (BoxFilter::Memory mem, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case BoxFilter::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void BoxFilter::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, local, events, event);
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int BoxFilter::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the filter radius.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void BoxFilter::setRadius (int _radius)
+    {
+        radius = _radius;
+        kernel.setArg (3, radius);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    MinFilter::MinFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("MinFilter"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernelRows (env.getProgram (info.pgIdx), "minFilter"), 
+        kernelCols (env.getProgram (info.pgIdx), "minFilter")
+    {
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& MinFilter::get (MinFilter::Memory mem)
+    {
+        switch (mem)
+        {
+            case MinFilter::Memory::H_IN:
+                return hBufferIn;
+            case MinFilter::Memory::H_OUT:
+                return hBufferOut;
+            case MinFilter::Memory::D_IN:
+                return dBufferIn;
+            case MinFilter::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void MinFilter::init (unsigned int _width, unsigned int _height, int _radius, Staging _staging)
+    {
+        width = _width; height = _height; radius = _radius;
+        bufferSize = width * height * sizeof (cl_float);
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+            if (radius < 0)
+                throw "The radius cannot be negative";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[MinFilter]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        if (dBufferTmp () == nullptr)
+            dBufferTmp = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+
+        // Set kernel arguments
+        //* The rows are filtered into the temporary buffer, and its columns into the output
+        kernelRows.setArg (0, dBufferIn);
+        kernelRows.setArg (1, dBufferTmp);
+        kernelRows.setArg (2, (cl_int) width);
+        kernelRows.setArg (3, (cl_int) width);
+        kernelRows.setArg (4, (cl_int) 1);
+
+        kernelCols.setArg (0, dBufferTmp);
+        kernelCols.setArg (1, dBufferOut);
+        kernelCols.setArg (2, (cl_int) height);
+        kernelCols.setArg (3, (cl_int) 1);
+        kernelCols.setArg (4, (cl_int) width);
+
+        setRadius (radius);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void MinFilter::write (MinFilter::Memory mem, void *ptr, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case MinFilter::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* MinFilter::read (MinFilter::Memory mem, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case MinFilter::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void MinFilter::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernelRows, cl::NullRange, globalRows, cl::NullRange, events);
+        queue.enqueueNDRangeKernel (kernelCols, cl::NullRange, globalCols, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void MinFilter::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernelRows, cl::NullRange, globalRows, cl::NullRange, deps);
+        graph.add (queue, kernelCols, cl::NullRange, globalCols, cl::NullRange, nullptr, node);
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int MinFilter::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel arguments for the filter radius, and the workspaces. 
+     *           A work-item handles a block of \f$ 2r+1 \f$ elements of a line.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void MinFilter::setRadius (int _radius)
+    {
+        radius = _radius;
+        unsigned int k = 2 * radius + 1;
+
+        globalRows = cl::NDRange (height, (width + radius) / k + 1);
+        globalCols = cl::NDRange (width, (height + radius) / k + 1);
+
+        kernelRows.setArg (5, radius);
+        kernelCols.setArg (5, radius);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     */
+    MaxFilter::MaxFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
+        counters ("MaxFilter"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        kernelRows (env.getProgram (info.pgIdx), "maxFilter"), 
+        kernelCols (env.getProgram (info.pgIdx), "maxFilter")
+    {
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& MaxFilter::get (MaxFilter::Memory mem)
+    {
+        switch (mem)
+        {
+            case MaxFilter::Memory::H_IN:
+                return hBufferIn;
+            case MaxFilter::Memory::H_OUT:
+                return hBufferOut;
+            case MaxFilter::Memory::D_IN:
+                return dBufferIn;
+            case MaxFilter::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void MaxFilter::init (unsigned int _width, unsigned int _height, int _radius, Staging _staging)
+    {
+        width = _width; height = _height; radius = _radius;
+        bufferSize = width * height * sizeof (cl_float);
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+            if (radius < 0)
+                throw "The radius cannot be negative";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[MaxFilter]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        if (dBufferTmp () == nullptr)
+            dBufferTmp = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+
+        // Set kernel arguments
+        //* The rows are filtered into the temporary buffer, and its columns into the output
+        kernelRows.setArg (0, dBufferIn);
+        kernelRows.setArg (1, dBufferTmp);
+        kernelRows.setArg (2, (cl_int) width);
+        kernelRows.setArg (3, (cl_int) width);
+        kernelRows.setArg (4, (cl_int) 1);
+
+        kernelCols.setArg (0, dBufferTmp);
+        kernelCols.setArg (1, dBufferOut);
+        kernelCols.setArg (2, (cl_int) height);
+        kernelCols.setArg (3, (cl_int) 1);
+        kernelCols.setArg (4, (cl_int) width);
+
+        setRadius (radius);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void MaxFilter::write (MaxFilter::Memory mem, void *ptr, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case MaxFilter::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                    queue.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* MaxFilter::read (MaxFilter::Memory mem, bool block, 
+                           const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case MaxFilter::Memory::H_OUT:
+                    queue.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void MaxFilter::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        queue.enqueueNDRangeKernel (kernelRows, cl::NullRange, globalRows, cl::NullRange, events);
+        queue.enqueueNDRangeKernel (kernelCols, cl::NullRange, globalCols, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void MaxFilter::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernelRows, cl::NullRange, globalRows, cl::NullRange, deps);
+        graph.add (queue, kernelCols, cl::NullRange, globalCols, cl::NullRange, nullptr, node);
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int MaxFilter::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel arguments for the filter radius, and the workspaces. 
+     *           A work-item handles a block of \f$ 2r+1 \f$ elements of a line.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void MaxFilter::setRadius (int _radius)
+    {
+        radius = _radius;
+        unsigned int k = 2 * radius + 1;
+
+        globalRows = cl::NDRange (height, (width + radius) / k + 1);
+        globalCols = cl::NDRange (width, (height + radius) / k + 1);
+
+        kernelRows.setArg (5, radius);
+        kernelCols.setArg (5, radius);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    GuidedFilter<GuidedFilterConfig::I_EQ_P>::GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("GuidedFilter<GuidedFilterConfig::I_EQ_P>"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        mean_p  (env, info.getCLEnvInfo (0)), mean_p2 (env, info.getCLEnvInfo (1)), 
+        mean_a  (env, info.getCLEnvInfo (0)), mean_b  (env, info.getCLEnvInfo (1)), 
+        squared (env, info.getCLEnvInfo (1)), 
+        ab (env.getProgram (info.pgIdx), "gf_ab"), 
+        q (env.getProgram (info.pgIdx), "gf_q"), 
+        fused (env.getProgram (info.pgIdx), "gf_fused"), 
+        engine (GuidedFilterEngine::SAT), autoEngine (true), satReady (false), 
+        width (0), height (0), 
+        waitListAB (1), waitListMB(1), waitListQ (1)
+    {
+        mean_p.counters.setParent (counters);
+        mean_p2.counters.setParent (counters);
+        mean_a.counters.setParent (counters);
+        mean_b.counters.setParent (counters);
+        squared.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedFilter<GuidedFilterConfig::I_EQ_P>::get (GuidedFilter::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedFilter::Memory::H_IN:
+                return hBufferIn;
+            case GuidedFilter::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedFilter::Memory::D_IN:
+                return dBufferIn;
+            case GuidedFilter::Memory::D_OUT:
+                return dBufferOut;
+            case GuidedFilter::Memory::D_A:
+                return dBufferOutA;
+            case GuidedFilter::Memory::D_B:
+                return dBufferOutB;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note For better accuracy control a scaling is applied on the array elements 
+     *        internally in `BoxFilterSAT`. A default value of \f$ 0.0001\ (1e-4) \f$ 
+     *        is normally used. The input data are assumed to be of `uchar` type promoted 
+     *        to `float` and normalized to `1.0`. Configure the scaling for your own data.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] _zero_out flag to indicate whether or not to zero out invalid pixels. 
+     *                       For more information, look at `gf_q`'s documentation 
+     *                       in `kernels/guidedFilter_kernels.cl`.
+     *  \param[in] _boxScaling scaling factor applied internally to `BoxFilterSAT`.
+     *  \param[in] _outputScaling scaling factor applied to the output array. Set this to `1/s`, if 
+     *                            you had to apply an `s` scaling to the input array before processing.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::init (
+        unsigned int _width, unsigned int _height, int _radius, float _eps, 
+        int _zero_out, float _boxScaling, float _outputScaling, Staging _staging)
+    {
+        graph.clear ();
+        width = _width; height = _height; radius = _radius; eps = _eps;
+        bufferSize = width * height * sizeof (cl_float);
+        zero_out = _zero_out;
+        boxScaling = _boxScaling;
+        outputScaling = _outputScaling;
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            if ((width * height) % 4 != 0)
+                throw "The number of elements in the array has to be a multiple of 4";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilter<GuidedFilterConfig::I_EQ_P>]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        satReady = false;
+        initEngine ();
+    }
+
+
+    /*! \details The fused kernel works on square tiles of `16x16` or `8x8` pixels. 
+     *           The largest tile that divides both image dimensions, fits in a 
+     *           work-group, and fits its local buffer in the device's local memory, 
+     *           is selected.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     *  \return The side of the tile, or `0` if the fused kernel can't be used.
+     */
+    unsigned int GuidedFilter<GuidedFilterConfig::I_EQ_P>::fusedSide (int _radius)
+    {
+        if ((_radius < 0) || (_radius > fusedMaxRadius))
+            return 0;
+
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+
+        size_t maxLocalSize = std::min (device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE> (), 
+                                        fused.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device));
+        std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
+        cl_ulong localMem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE> () - 
+                            fused.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE> (device);
+
+        for (unsigned int side = 16; side >= 8; side /= 2)
+        {
+            size_t pSide = side + 4 * _radius, mSide = side + 2 * _radius;
+            size_t localSize = (pSide * pSide + 2 * pSide * mSide + 2 * mSide * mSide) * sizeof (cl_float);
+
+            if ((width % side == 0) && (height % side == 0) && 
+                (side <= maxLocalDim[0]) && (side <= maxLocalDim[1]) && 
+                (side * side <= maxLocalSize) && (localSize <= localMem))
+                return side;
+        }
+
+        return 0;
+    }
+
+
+    /*! \details If the engine hasn't been set with `setEngine`, it's selected 
+     *           based on the radius. The `BoxFilterSAT` based pipeline, and its 
+     *           intermediate buffers, are set up only when they're first needed.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::initEngine ()
+    {
+        unsigned int side = fusedSide (radius);
+
+        if (autoEngine)
+            engine = (side > 0) ? GuidedFilterEngine::FUSED : GuidedFilterEngine::SAT;
+
+        try
+        {
+            if ((engine == GuidedFilterEngine::FUSED) && (side == 0))
+                throw "The fused engine cannot be used with this radius, image size, or device";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilter<GuidedFilterConfig::I_EQ_P>]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        if (engine == GuidedFilterEngine::FUSED)
+        {
+            size_t pSide = side + 4 * radius, mSide = side + 2 * radius;
+            size_t localSize = (pSide * pSide + 2 * pSide * mSide + 2 * mSide * mSide) * sizeof (cl_float);
+
+            fused.setArg (0, dBufferIn);
+            fused.setArg (1, dBufferOut);
+            fused.setArg (2, cl::Local (localSize));
+            fused.setArg (3, radius);
+            fused.setArg (4, eps);
+            fused.setArg (5, zero_out);
+            fused.setArg (6, outputScaling);
+
+            globalFused = cl::NDRange (width, height);
+            localFused = cl::NDRange (side, side);
+        }
+        else if (!satReady)
+            initSAT ();
+    }
+
+
+    /*! \details Creates the intermediate buffers, and configures the 
+     *           `BoxFilterSAT` instances and the `gf_ab`, `gf_q` kernels.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::initSAT ()
+    {
+        mean_p.get (BoxFilterSAT::Memory::D_IN) = dBufferIn;
+        mean_p.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_p.init (width, height, radius, boxScaling, Staging::NONE);
+
+        squared.get (Math::Pown::Memory::D_IN) = dBufferIn;
+        squared.get (Math::Pown::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        squared.init (width, height, 2, Staging::NONE);
+
+        mean_p2.get (BoxFilterSAT::Memory::D_IN) = squared.get (Math::Pown::Memory::D_OUT);
+        mean_p2.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_p2.init (width, height, radius, boxScaling, Staging::NONE);
+
+        dBufferOutA = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferOutB = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        ab.setArg (0, mean_p.get (BoxFilterSAT::Memory::D_OUT));
+        ab.setArg (1, mean_p2.get (BoxFilterSAT::Memory::D_OUT));
+        ab.setArg (2, dBufferOutA);
+        ab.setArg (3, dBufferOutB);
+        ab.setArg (4, eps);
+
+        mean_a.get (BoxFilterSAT::Memory::D_IN) = dBufferOutA;
+        mean_a.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_a.init (width, height, radius, boxScaling, Staging::NONE);
+
+        mean_b.get (BoxFilterSAT::Memory::D_IN) = dBufferOutB;
+        mean_b.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_b.init (width, height, radius, boxScaling, Staging::NONE);
+
+        q.setArg (0, dBufferIn);
+        q.setArg (1, mean_a.get (BoxFilterSAT::Memory::D_OUT));
+        q.setArg (2, mean_b.get (BoxFilterSAT::Memory::D_OUT));
+        q.setArg (3, dBufferOut);
+        q.setArg (4, zero_out);
+        q.setArg (5, outputScaling);
+        
+        // Set workspaces (common to both own kernels: ab, q)
+        global = cl::NDRange (width * height / 4);
+
+        satReady = true;
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::write (
+        GuidedFilter::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilter::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrIn);
+                    queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* GuidedFilter<GuidedFilterConfig::I_EQ_P>::read (
+        GuidedFilter::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilter::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (engine == GuidedFilterEngine::FUSED)
+        {
+            queue0.enqueueNDRangeKernel (fused, cl::NullRange, globalFused, localFused, events, event);
+            return;
+        }
+
+        mean_p.run (events);
+        squared.run (events);
+        mean_p2.run (nullptr, &p2Event); waitListAB[0] = p2Event;
+        queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, &waitListAB, &abEvent);
+        mean_a.run ();
+        waitListMB[0] = abEvent;
+        mean_b.run (&waitListMB, &mbEvent); waitListQ[0] = mbEvent;
+        queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, &waitListQ, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        if (engine == GuidedFilterEngine::FUSED)
+        {
+            graph.add (queue0, fused, cl::NullRange, globalFused, localFused, deps, node);
+            return;
+        }
+
+        std::vector<CommandGraph::Node> depsAB (1), depsMB (1), depsQ (1);
+        mean_p.record (graph, deps);
+        squared.record (graph, deps);
+        mean_p2.record (graph, nullptr, &depsAB[0]);
+        graph.add (queue0, ab, cl::NullRange, global, cl::NullRange, &depsAB, &depsMB[0]);
+        mean_a.record (graph);
+        mean_b.record (graph, &depsMB, &depsQ[0]);
+        graph.add (queue0, q, cl::NullRange, global, cl::NullRange, &depsQ, node);
+    }
+
+
+    /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+     *           for replay. It's called by `replay` when there is no recording, and the 
+     *           recording is dropped whenever a parameter changes.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::capture ()
+    {
+        graph.clear ();
+        record (graph);
+        graph.finalize ();
+    }
+
+
+    /*! \details Executes the same kernels as `run`, with less host overhead. 
+     *           The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::replay (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (graph.empty ()) capture ();
+        counters.add (Counters::Counter::KERNELS, graph.size ());
+        graph.replay (events, event);
+    }
+
+
+    /*! \details The input is copied to the input staging buffer of an `AsyncWindow` slot, 
+     *           and the transfers and kernel executions are enqueued without blocking. 
+     *           The call blocks only while the submission window is full.
+     *  \note The staging buffers of `async` are used, so `submit` works with any `Staging` 
+     *        configuration. Don't call `write`, `run` or `read` while submissions are in flight.
+     *  \note The callback is invoked on a thread of the OpenCL runtime. Look at `AsyncWindow`.
+     *
+     *  \param[in] ptr input array of `width*height` `cl_float` elements.
+     *  \param[in] callback function called with the mapping of the output array.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::submit (const void *ptr, AsyncWindow::Callback callback)
+    {
+        AsyncWindow::Slot &slot = async.acquire (queue0, bufferSize, bufferSize);
+        std::copy ((const cl_float *) ptr, (const cl_float *) ptr + width * height, (cl_float *) slot.hPtrIn);
+
+        std::vector<cl::Event> writeEvents (1), runEvents (1);
+        queue0.enqueueWriteBuffer (dBufferIn, CL_FALSE, 0, bufferSize, slot.hPtrIn, async.previous (), &writeEvents[0]);
+        run (&writeEvents, &runEvents[0]);
+        queue0.enqueueReadBuffer (dBufferOut, CL_FALSE, 0, bufferSize, slot.hPtrOut, &runEvents, &slot.event);
+        env.getQueue (info.ctxIdx, info.qIdx[1]).flush ();
+
+        async.commit (slot, callback);
+    }
+
+
+    /*! \details Like `submit` with a callback, but the output is copied to `out`.
+     *
+     *  \param[in] ptr input array of `width*height` `cl_float` elements.
+     *  \param[out] out array of `width*height` `cl_float` elements that receives the output.
+     *  \return A future that becomes ready when `out` has been filled in.
+     */
+    std::future<void> GuidedFilter<GuidedFilterConfig::I_EQ_P>::submit (const void *ptr, void *out)
+    {
+        std::future<void> future;
+        submit (ptr, AsyncWindow::deliver (out, bufferSize, future));
+        return future;
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int GuidedFilter<GuidedFilterConfig::I_EQ_P>::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the filter window radius.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setRadius (int _radius)
+    {
+        graph.clear ();
+        radius = _radius;
+
+        if (satReady)
+        {
+            mean_p.setRadius (radius);
+            mean_p2.setRadius (radius);
+            mean_a.setRadius (radius);
+            mean_b.setRadius (radius);
+        }
+
+        initEngine ();
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedFilter<GuidedFilterConfig::I_EQ_P>::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setEps (float _eps)
+    {
+        graph.clear ();
+        eps = _eps;
+        ab.setArg (4, eps);
+        fused.setArg (4, eps);
+    }
+
+
+    /*! \return The scaling factor applied internally to `BoxFilterSAT`.
+     */
+    float GuidedFilter<GuidedFilterConfig::I_EQ_P>::getBoxScaling ()
+    {
+        return boxScaling;
+    }
+
+
+    /*! \details Updates the kernel argument for internal scaling 
+     *           of the array elements in `BoxFilterSAT`.
+     *
+     *  \param[in] _boxScaling scaling factor for `BoxFilterSAT`.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setBoxScaling (float _boxScaling)
+    {
+        graph.clear ();
+        boxScaling = _boxScaling;
+
+        if (satReady)
+        {
+            mean_p.setScaling (boxScaling);
+            mean_p2.setScaling (boxScaling);
+            mean_a.setScaling (boxScaling);
+            mean_b.setScaling (boxScaling);
+        }
+    }
+
+
+    /*! \return The scaling factor for the output array.
+     */
+    float GuidedFilter<GuidedFilterConfig::I_EQ_P>::getOutputScaling ()
+    {
+        return outputScaling;
+    }
+
+
+    /*! \details Updates the kernel argument for scaling of the output array.
+     *
+     *  \param[in] _outputScaling scaling factor for the output array.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setOutputScaling (float _outputScaling)
+    {
+        graph.clear ();
+        outputScaling = _outputScaling;
+        q.setArg (5, outputScaling);
+        fused.setArg (6, outputScaling);
+    }
+
+
+    /*! \return The `zero_out` flag.
+     */
+    int GuidedFilter<GuidedFilterConfig::I_EQ_P>::getZeroing ()
+    {
+        return zero_out;
+    }
+
+
+    /*! \details Updates the kernel argument for the `zero_out` flag.
+     *
+     *  \param[in] _zero_out `zero_out` flag.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setZeroing (int _zero_out)
+    {
+        graph.clear ();
+        zero_out = _zero_out;
+        q.setArg (4, zero_out);
+        fused.setArg (5, zero_out);
+    }
+
+
+    /*! \return The engine that executes the pipeline.
+     */
+    GuidedFilterEngine GuidedFilter<GuidedFilterConfig::I_EQ_P>::getEngine ()
+    {
+        return engine;
+    }
+
+
+    /*! \details Overrides the automatic selection of the engine. If called after 
+     *           `init`, the engine is set up immediately. Otherwise, it's set up 
+     *           by `init`.
+     *
+     *  \param[in] _engine engine that executes the pipeline.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_EQ_P>::setEngine (GuidedFilterEngine _engine)
+    {
+        graph.clear ();
+        engine = _engine;
+        autoEngine = false;
+
+        if ((width != 0) && (height != 0))
+            initEngine ();
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     *                   The `mean_I`, `corr_I` branches are assigned to the first queue, 
+     *                   and the `mean_p`, `corr_Ip` branches to the second one.
+     */
+    GuidedFilter<GuidedFilterConfig::I_NEQ_P>::GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        GuidedFilter (_env, branchInfo (_info))
+    {
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **four** `(4)` **command queues** (on the same device).
+     *                   The `mean_I`, `mean_p`, `corr_I`, `corr_Ip` branches are assigned 
+     *                   to the four queues, respectively, so that they can run concurrently. 
+     *                   The `mean_a`, `mean_b` branches are assigned to the first two queues.
+     */
+    GuidedFilter<GuidedFilterConfig::I_NEQ_P>::GuidedFilter (clutils::CLEnv &_env, clutils::CLEnvInfo<4> _info) : 
+        counters ("GuidedFilter<GuidedFilterConfig::I_NEQ_P>"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        mean_I  (env, info.getCLEnvInfo (0)), mean_p  (env, info.getCLEnvInfo (1)), 
+        corr_I  (env, info.getCLEnvInfo (2)), corr_Ip (env, info.getCLEnvInfo (3)), 
+        mean_a  (env, info.getCLEnvInfo (0)), mean_b  (env, info.getCLEnvInfo (1)), 
+        mult_II (env, info.getCLEnvInfo (2)), mult_Ip (env, info.getCLEnvInfo (3)), 
+        var (env.getProgram (info.pgIdx), "gf_var_Ip"), 
+        ab (env.getProgram (info.pgIdx), "gf_ab_Ip"), 
+        q (env.getProgram (info.pgIdx), "gf_q"), 
+        fused (env.getProgram (info.pgIdx), "gf_fused_Ip"), 
+        engine (GuidedFilterEngine::SAT), autoEngine (true), satReady (false), 
+        width (0), height (0), 
+        waitListVar (3), waitListMB(1), waitListQ (1)
+    {
+        mean_I.counters.setParent (counters);
+        mean_p.counters.setParent (counters);
+        corr_I.counters.setParent (counters);
+        corr_Ip.counters.setParent (counters);
+        mean_a.counters.setParent (counters);
+        mean_b.counters.setParent (counters);
+        mult_II.counters.setParent (counters);
+        mult_Ip.counters.setParent (counters);
+    }
+
+
+    /*! \details The branches are laid out as `{ mean_I, mean_p, corr_I, corr_Ip }`. 
+     *           The first and third branches share the first queue, and the second 
+     *           and fourth branches share the second queue.
+     *
+     *  \param[in] _info opencl configuration with two command queues.
+     *  \return An opencl configuration with one (possibly repeated) queue per branch.
+     */
+    clutils::CLEnvInfo<4> GuidedFilter<GuidedFilterConfig::I_NEQ_P>::branchInfo (clutils::CLEnvInfo<2> &_info)
+    {
+        return clutils::CLEnvInfo<4> (_info.pIdx, _info.dIdx, _info.ctxIdx, 
+            { _info.qIdx[0], _info.qIdx[1], _info.qIdx[0], _info.qIdx[1] }, _info.pgIdx);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedFilter<GuidedFilterConfig::I_NEQ_P>::get (GuidedFilter::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedFilter::Memory::H_IN_I:
+                return hBufferInI;
+            case GuidedFilter::Memory::H_IN_P:
+                return hBufferInP;
+            case GuidedFilter::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedFilter::Memory::D_IN_I:
+                return dBufferInI;
+            case GuidedFilter::Memory::D_IN_P:
+                return dBufferInP;
+            case GuidedFilter::Memory::D_OUT:
+                return dBufferOut;
+            case GuidedFilter::Memory::D_A:
+                return dBufferOutA;
+            case GuidedFilter::Memory::D_B:
+                return dBufferOutB;
+            case GuidedFilter::Memory::D_VAR_I:
+                return dBufferOutVarI;
+            case GuidedFilter::Memory::D_COV_IP:
+                return dBufferOutCovIp;
+            case GuidedFilter::Memory::D_MEAN_A:
+                return mean_a.get (BoxFilterSAT::Memory::D_OUT);
+            case GuidedFilter::Memory::D_MEAN_B:
+                return mean_b.get (BoxFilterSAT::Memory::D_OUT);
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note For better accuracy control a scaling is applied on the array elements 
+     *        internally in `BoxFilterSAT`. A default value of \f$ 0.0001\ (1e-4) \f$ 
+     *        is normally used. The input data are assumed to be of `uchar` type promoted 
+     *        to `float` and normalized to `1.0`. Configure the scaling for your own data.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] _zero_out flag to indicate whether or not to zero out invalid pixels. 
+     *                       For more information, look at `gf_q`'s documentation 
+     *                       in `kernels/guidedFilter_kernels.cl`.
+     *  \param[in] _boxScaling scaling factor applied internally to `BoxFilterSAT`.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::init (
+        unsigned int _width, unsigned int _height, int _radius, float _eps, 
+        int _zero_out, float _boxScaling, Staging _staging)
+    {
+        graph.clear ();
+        width = _width; height = _height; radius = _radius; eps = _eps;
+        bufferSize = width * height * sizeof (cl_float);
+        zero_out = _zero_out;
+        boxScaling = _boxScaling;
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            if ((width * height) % 4 != 0)
+                throw "The number of elements in the array has to be a multiple of 4";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilter<GuidedFilterConfig::I_NEQ_P>]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrInI = nullptr;
+                hPtrInP = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferInI () == nullptr)
+                    hBufferInI = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferInP () == nullptr)
+                    hBufferInP = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrInI = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                hPtrInP = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferInI, hPtrInI);
+                queue0.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) { hPtrInI = nullptr; hPtrInP = nullptr; }
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferInI () == nullptr)
+            dBufferInI = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferInP () == nullptr)
+            dBufferInP = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        satReady = false;
+        initEngine ();
+    }
+
+
+    /*! \details The fused kernel works on square tiles of `16x16` or `8x8` pixels. 
+     *           The largest tile that divides both image dimensions, fits in a 
+     *           work-group, and fits its local buffer in the device's local memory, 
+     *           is selected.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     *  \return The side of the tile, or `0` if the fused kernel can't be used.
+     */
+    unsigned int GuidedFilter<GuidedFilterConfig::I_NEQ_P>::fusedSide (int _radius)
+    {
+        if ((_radius < 0) || (_radius > fusedMaxRadius))
+            return 0;
+
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+
+        size_t maxLocalSize = std::min (device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE> (), 
+                                        fused.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device));
+        std::vector<size_t> maxLocalDim = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES> ();
+        cl_ulong localMem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE> () - 
+                            fused.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE> (device);
+
+        for (unsigned int side = 16; side >= 8; side /= 2)
+        {
+            size_t pSide = side + 4 * _radius, mSide = side + 2 * _radius;
+            size_t localSize = (2 * pSide * pSide + 4 * pSide * mSide + 2 * mSide * mSide) * sizeof (cl_float);
+
+            if ((width % side == 0) && (height % side == 0) && 
+                (side <= maxLocalDim[0]) && (side <= maxLocalDim[1]) && 
+                (side * side <= maxLocalSize) && (localSize <= localMem))
+                return side;
+        }
+
+        return 0;
+    }
+
+
+    /*! \details If the engine hasn't been set with `setEngine`, it's selected 
+     *           based on the radius. The `BoxFilterSAT` based pipeline, and its 
+     *           intermediate buffers, are set up only when they're first needed.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::initEngine ()
+    {
+        unsigned int side = fusedSide (radius);
+
+        if (autoEngine)
+            engine = (side > 0) ? GuidedFilterEngine::FUSED : GuidedFilterEngine::SAT;
+
+        try
+        {
+            if ((engine == GuidedFilterEngine::FUSED) && (side == 0))
+                throw "The fused engine cannot be used with this radius, image size, or device";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilter<GuidedFilterConfig::I_NEQ_P>]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        if (engine == GuidedFilterEngine::FUSED)
+        {
+            size_t pSide = side + 4 * radius, mSide = side + 2 * radius;
+            size_t localSize = (2 * pSide * pSide + 4 * pSide * mSide + 2 * mSide * mSide) * sizeof (cl_float);
+
+            fused.setArg (0, dBufferInI);
+            fused.setArg (1, dBufferInP);
+            fused.setArg (2, dBufferOut);
+            fused.setArg (3, cl::Local (localSize));
+            fused.setArg (4, radius);
+            fused.setArg (5, eps);
+            fused.setArg (6, zero_out);
+            fused.setArg (7, 1.f);
+
+            globalFused = cl::NDRange (width, height);
+            localFused = cl::NDRange (side, side);
+        }
+        else if (!satReady)
+            initSAT ();
+    }
+
+
+    /*! \details Creates the intermediate buffers, and configures the `BoxFilterSAT`, 
+     *           `Mult` instances and the `gf_var_Ip`, `gf_ab_Ip`, `gf_q` kernels.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::initSAT ()
+    {
+        mean_I.get (BoxFilterSAT::Memory::D_IN) = dBufferInI;
+        mean_I.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_I.init (width, height, radius, boxScaling, Staging::NONE);
+
+        mean_p.get (BoxFilterSAT::Memory::D_IN) = dBufferInP;
+        mean_p.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_p.init (width, height, radius, boxScaling, Staging::NONE);
+
+        mult_II.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
+        mult_II.get (Math::Mult::Memory::D_IN_B) = dBufferInI;
+        mult_II.get (Math::Mult::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mult_II.init (width, height, Staging::NONE);
+
+        mult_Ip.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
+        mult_Ip.get (Math::Mult::Memory::D_IN_B) = dBufferInP;
+        mult_Ip.get (Math::Mult::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mult_Ip.init (width, height, Staging::NONE);
+
+        corr_I.get (BoxFilterSAT::Memory::D_IN) = mult_II.get (Math::Mult::Memory::D_OUT);
+        corr_I.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        corr_I.init (width, height, radius, boxScaling, Staging::NONE);
+
+        corr_Ip.get (BoxFilterSAT::Memory::D_IN) = mult_Ip.get (Math::Mult::Memory::D_OUT);
+        corr_Ip.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        corr_Ip.init (width, height, radius, boxScaling, Staging::NONE);
+
+        dBufferOutVarI = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferOutCovIp = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        var.setArg (0, corr_I.get (BoxFilterSAT::Memory::D_OUT));
+        var.setArg (1, corr_Ip.get (BoxFilterSAT::Memory::D_OUT));
+        var.setArg (2, mean_I.get (BoxFilterSAT::Memory::D_OUT));
+        var.setArg (3, mean_p.get (BoxFilterSAT::Memory::D_OUT));
+        var.setArg (4, dBufferOutVarI);
+        var.setArg (5, dBufferOutCovIp);
+
+        dBufferOutA = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferOutB = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        ab.setArg (0, dBufferOutVarI);
+        ab.setArg (1, dBufferOutCovIp);
+        ab.setArg (2, mean_I.get (BoxFilterSAT::Memory::D_OUT));
+        ab.setArg (3, mean_p.get (BoxFilterSAT::Memory::D_OUT));
+        ab.setArg (4, dBufferOutA);
+        ab.setArg (5, dBufferOutB);
+        ab.setArg (6, eps);
+
+        mean_a.get (BoxFilterSAT::Memory::D_IN) = dBufferOutA;
+        mean_a.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_a.init (width, height, radius, boxScaling, Staging::NONE);
+
+        mean_b.get (BoxFilterSAT::Memory::D_IN) = dBufferOutB;
+        mean_b.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_b.init (width, height, radius, boxScaling, Staging::NONE);
+
+        q.setArg (0, dBufferInI);
+        q.setArg (1, mean_a.get (BoxFilterSAT::Memory::D_OUT));
+        q.setArg (2, mean_b.get (BoxFilterSAT::Memory::D_OUT));
+        q.setArg (3, dBufferOut);
+        q.setArg (4, zero_out);
+        q.setArg (5, 1.f);
+        
+        // Set workspaces (common to both own kernels: ab, q)
+        global = cl::NDRange (width * height / 4);
+
+        satReady = true;
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::write (
+        GuidedFilter::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilter::Memory::D_IN_I:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInI);
+                    queue0.enqueueWriteBuffer (dBufferInI, block, 0, bufferSize, hPtrInI, events, event);
+                    break;
+                case GuidedFilter::Memory::D_IN_P:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInP);
+                    queue0.enqueueWriteBuffer (dBufferInP, block, 0, bufferSize, hPtrInP, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* GuidedFilter<GuidedFilterConfig::I_NEQ_P>::read (
+        GuidedFilter::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilter::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *  \note The kernels are submitted as an explicit event graph. `var` (on the first 
+     *        queue, after `mean_I`) waits for the `mean_p`, `corr_I` and `corr_Ip` 
+     *        branches; `mean_b` waits for `ab`; and `q` waits for `mean_b`. The graph 
+     *        holds for any assignment of the branches to (in-order) queues.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (engine == GuidedFilterEngine::FUSED)
+        {
+            queue0.enqueueNDRangeKernel (fused, cl::NullRange, globalFused, localFused, events, event);
+            return;
+        }
+
+        mean_I.run (events);
+        mean_p.run (events, &meanpEvent); waitListVar[0] = meanpEvent;
+        
+        mult_II.run (events);
+        corr_I.run (nullptr, &corrIEvent); waitListVar[1] = corrIEvent;
+        mult_Ip.run (events);
+        corr_Ip.run (nullptr, &corrIpEvent); waitListVar[2] = corrIpEvent;
+        
+        queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, &waitListVar);
+        queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &abEvent);
+        mean_a.run ();
+        waitListMB[0] = abEvent;
+        mean_b.run (&waitListMB, &mbEvent); waitListQ[0] = mbEvent;
+        queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, &waitListQ, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        if (engine == GuidedFilterEngine::FUSED)
+        {
+            graph.add (queue0, fused, cl::NullRange, globalFused, localFused, deps, node);
+            return;
+        }
+
+        std::vector<CommandGraph::Node> depsVar (3), depsMB (1), depsQ (1);
+        mean_I.record (graph, deps);
+        mean_p.record (graph, deps, &depsVar[0]);
+
+        mult_II.record (graph, deps);
+        corr_I.record (graph, nullptr, &depsVar[1]);
+        mult_Ip.record (graph, deps);
+        corr_Ip.record (graph, nullptr, &depsVar[2]);
+
+        graph.add (queue0, var, cl::NullRange, global, cl::NullRange, &depsVar);
+        graph.add (queue0, ab, cl::NullRange, global, cl::NullRange, nullptr, &depsMB[0]);
+        mean_a.record (graph);
+        mean_b.record (graph, &depsMB, &depsQ[0]);
+        graph.add (queue0, q, cl::NullRange, global, cl::NullRange, &depsQ, node);
+    }
+
+
+    /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+     *           for replay. It's called by `replay` when there is no recording, and the 
+     *           recording is dropped whenever a parameter changes.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::capture ()
+    {
+        graph.clear ();
+        record (graph);
+        graph.finalize ();
+    }
+
+
+    /*! \details Executes the same kernels as `run`, with less host overhead. 
+     *           The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::replay (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (graph.empty ()) capture ();
+        counters.add (Counters::Counter::KERNELS, graph.size ());
+        graph.replay (events, event);
+    }
+
+
+    /*! \details The inputs are copied to the input staging buffer of an `AsyncWindow` slot, 
+     *           and the transfers and kernel executions are enqueued without blocking. 
+     *           The call blocks only while the submission window is full.
+     *  \note The staging buffers of `async` are used, so `submit` works with any `Staging` 
+     *        configuration. Don't call `write`, `run` or `read` while submissions are in flight.
+     *  \note The callback is invoked on a thread of the OpenCL runtime. Look at `AsyncWindow`.
+     *
+     *  \param[in] ptrI guidance array of `width*height` `cl_float` elements.
+     *  \param[in] ptrP input array of `width*height` `cl_float` elements.
+     *  \param[in] callback function called with the mapping of the output array.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::submit (const void *ptrI, const void *ptrP, AsyncWindow::Callback callback)
+    {
+        AsyncWindow::Slot &slot = async.acquire (queue0, 2 * bufferSize, bufferSize);
+        cl_float *in = (cl_float *) slot.hPtrIn;
+        std::copy ((const cl_float *) ptrI, (const cl_float *) ptrI + width * height, in);
+        std::copy ((const cl_float *) ptrP, (const cl_float *) ptrP + width * height, in + width * height);
+
+        std::vector<cl::Event> writeEvents (2), runEvents (1);
+        queue0.enqueueWriteBuffer (dBufferInI, CL_FALSE, 0, bufferSize, in, async.previous (), &writeEvents[0]);
+        queue0.enqueueWriteBuffer (dBufferInP, CL_FALSE, 0, bufferSize, in + width * height, nullptr, &writeEvents[1]);
+        run (&writeEvents, &runEvents[0]);
+        queue0.enqueueReadBuffer (dBufferOut, CL_FALSE, 0, bufferSize, slot.hPtrOut, &runEvents, &slot.event);
+        for (unsigned int i = 1; i < 4; ++i)
+            env.getQueue (info.ctxIdx, info.qIdx[i]).flush ();
+
+        async.commit (slot, callback);
+    }
+
+
+    /*! \details Like `submit` with a callback, but the output is copied to `out`.
+     *
+     *  \param[in] ptrI guidance array of `width*height` `cl_float` elements.
+     *  \param[in] ptrP input array of `width*height` `cl_float` elements.
+     *  \param[out] out array of `width*height` `cl_float` elements that receives the output.
+     *  \return A future that becomes ready when `out` has been filled in.
+     */
+    std::future<void> GuidedFilter<GuidedFilterConfig::I_NEQ_P>::submit (const void *ptrI, const void *ptrP, void *out)
+    {
+        std::future<void> future;
+        submit (ptrI, ptrP, AsyncWindow::deliver (out, bufferSize, future));
+        return future;
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the filter window radius.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setRadius (int _radius)
+    {
+        graph.clear ();
+        radius = _radius;
+
+        if (satReady)
+        {
+            mean_I.setRadius (radius);
+            mean_p.setRadius (radius);
+            corr_I.setRadius (radius);
+            corr_Ip.setRadius (radius);
+            mean_a.setRadius (radius);
+            mean_b.setRadius (radius);
+        }
+
+        initEngine ();
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setEps (float _eps)
+    {
+        graph.clear ();
+        eps = _eps;
+        ab.setArg (6, eps);
+        fused.setArg (5, eps);
+    }
+
+
+    /*! \return The scaling factor applied internally to `BoxFilterSAT`.
+     */
+    float GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getBoxScaling ()
+    {
+        return boxScaling;
+    }
+
+
+    /*! \details Updates the kernel argument for internal scaling 
+     *           of the array elements in `BoxFilterSAT`.
+     *
+     *  \param[in] _scaling scaling factor for `BoxFilterSAT`.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setBoxScaling (float _boxScaling)
+    {
+        graph.clear ();
+        boxScaling = _boxScaling;
+
+        if (satReady)
+        {
+            mean_I.setScaling (boxScaling);
+            mean_p.setScaling (boxScaling);
+            corr_I.setScaling (boxScaling);
+            corr_Ip.setScaling (boxScaling);
+            mean_a.setScaling (boxScaling);
+            mean_b.setScaling (boxScaling);
+        }
+    }
+
+
+    /*! \return The `zero_out` flag.
+     */
+    int GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getZeroing ()
+    {
+        return zero_out;
+    }
+
+
+    /*! \details Updates the kernel argument for the `zero_out` flag.
+     *
+     *  \param[in] _zero_out `zero_out` flag.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setZeroing (int _zero_out)
+    {
+        graph.clear ();
+        zero_out = _zero_out;
+        q.setArg (4, zero_out);
+        fused.setArg (6, zero_out);
+    }
+
+
+    /*! \return The engine that executes the pipeline.
+     */
+    GuidedFilterEngine GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getEngine ()
+    {
+        return engine;
+    }
+
+
+    /*! \details Overrides the automatic selection of the engine. If called after 
+     *           `init`, the engine is set up immediately. Otherwise, it's set up 
+     *           by `init`.
+     *
+     *  \param[in] _engine engine that executes the pipeline.
+     */
+    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setEngine (GuidedFilterEngine _engine)
+    {
+        graph.clear ();
+        engine = _engine;
+        autoEngine = false;
+
+        if ((width != 0) && (height != 0))
+            initEngine ();
+    }
+
+
+    /*! \details Creates the `GuidedFilter` instance of a band, and configures 
+     *           it for the band height, halos included.
+     *
+     *  \param[in] band the band to configure.
+     */
+    template <>
+    void GuidedFilterMultiDevice<GuidedFilterConfig::I_EQ_P>::initBand (Band &band)
+    {
+        band.gf.reset (new GuidedFilter<GuidedFilterConfig::I_EQ_P> (env, band.info));
+        band.gf->counters.setParent (counters);
+        band.gf->init (width, band.top + band.rows + band.bottom, radius, eps, 
+                       zero_out, boxScaling, 1.f, Staging::NONE);
+    }
+
+
+    /*! \details Creates the `GuidedFilter` instance of a band, and configures 
+     *           it for the band height, halos included.
+     *
+     *  \param[in] band the band to configure.
+     */
+    template <>
+    void GuidedFilterMultiDevice<GuidedFilterConfig::I_NEQ_P>::initBand (Band &band)
+    {
+        band.gf.reset (new GuidedFilter<GuidedFilterConfig::I_NEQ_P> (env, band.info));
+        band.gf->counters.setParent (counters);
+        band.gf->init (width, band.top + band.rows + band.bottom, radius, eps, 
+                       zero_out, boxScaling, Staging::NONE);
+    }
+
+
+    /*! \details The band rows are contiguous in the staging buffer, so the 
+     *           transfer is a single write.
+     *
+     *  \param[in] band the band to transfer.
+     */
+    template <>
+    void GuidedFilterMultiDevice<GuidedFilterConfig::I_EQ_P>::writeBand (Band &band)
+    {
+        typedef GuidedFilter<GuidedFilterConfig::I_EQ_P> GF;
+        size_t offset = (band.row - band.top) * width;
+        size_t size = (band.top + band.rows + band.bottom) * width * sizeof (cl_float);
+
+        band.writeEvents.resize (1);
+        band.queue.enqueueWriteBuffer ((cl::Buffer&) band.gf->get (GF::Memory::D_IN), CL_FALSE, 
+                                       0, size, hPtrInP + offset, nullptr, &band.writeEvents[0]);
+    }
+
+
+    /*! \details The band rows are contiguous in the staging buffers, so the 
+     *           transfer is a single write per image.
+     *
+     *  \param[in] band the band to transfer.
+     */
+    template <>
+    void GuidedFilterMultiDevice<GuidedFilterConfig::I_NEQ_P>::writeBand (Band &band)
+    {
+        typedef GuidedFilter<GuidedFilterConfig::I_NEQ_P> GF;
+        size_t offset = (band.row - band.top) * width;
+        size_t size = (band.top + band.rows + band.bottom) * width * sizeof (cl_float);
+
+        band.writeEvents.resize (2);
+        band.queue.enqueueWriteBuffer ((cl::Buffer&) band.gf->get (GF::Memory::D_IN_I), CL_FALSE, 
+                                       0, size, hPtrInI + offset, nullptr, &band.writeEvents[0]);
+        band.queue.enqueueWriteBuffer ((cl::Buffer&) band.gf->get (GF::Memory::D_IN_P), CL_FALSE, 
+                                       0, size, hPtrInP + offset, nullptr, &band.writeEvents[1]);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configurations, one per device. Each specifies the context, 
+     *                   queues, etc, to be used by the `GuidedFilter` instance on a device.
+     */
+    template <GuidedFilterConfig Ip>
+    GuidedFilterMultiDevice<Ip>::GuidedFilterMultiDevice (
+        clutils::CLEnv &_env, std::vector<clutils::CLEnvInfo<2>> _info) : 
+        counters ("GuidedFilterMultiDevice"), env (_env), width (0), height (0)
+    {
+        try
+        {
+            if (_info.empty ())
+                throw "At least one device has to be specified";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterMultiDevice]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        context = env.getContext (_info[0].pIdx);
+        queue = MeteredQueue (env.getQueue (_info[0].ctxIdx, _info[0].qIdx[0]), counters);
+
+        bands.resize (_info.size ());
+        throughput.resize (_info.size ());
+        for (size_t i = 0; i < bands.size (); ++i)
+        {
+            Band &band = bands[i];
+            band.info = _info[i];
+            band.queue = MeteredQueue (env.getQueue (band.info.ctxIdx, band.info.qIdx[0]), counters);
+            band.profiling = true;
+            for (unsigned int qIdx : _info[i].qIdx)
+            {
+                cl::CommandQueue &q = env.getQueue (_info[i].ctxIdx, qIdx);
+                if (!(q.getInfo<CL_QUEUE_PROPERTIES> () & CL_QUEUE_PROFILING_ENABLE))
+                    band.profiling = false;
+            }
+
+            // Initial estimate of the throughput
+            cl::Device &device = env.devices[_info[i].pIdx][_info[i].dIdx];
+            throughput[i] = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS> () * 
+                            (double) device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY> ();
+            if (throughput[i] <= 0.0) throughput[i] = 1.0;
+        }
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    template <GuidedFilterConfig Ip>
+    cl::Memory& GuidedFilterMultiDevice<Ip>::get (GuidedFilterMultiDevice::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedFilterMultiDevice::Memory::H_IN_I:
+                return hBufferInI;
+            case GuidedFilterMultiDevice::Memory::H_IN_P:
+                return hBufferInP;
+            case GuidedFilterMultiDevice::Memory::H_OUT:
+                return hBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up the staging buffers, partitions the image, and 
+     *           configures a `GuidedFilter` instance on each device.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *
+     *  \param[in] _width width of the guidance and input images.
+     *  \param[in] _height height of the guidance and input images.
+     *  \param[in] _radius radius of the square filter window.
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     *  \param[in] _zero_out flag to indicate whether to zero out the output pixels 
+     *                       where the input pixels are zero.
+     *  \param[in] _boxScaling factor by which to scale the arrays before the `BoxFilterSAT`.
+     */
+    template <GuidedFilterConfig Ip>
+    void GuidedFilterMultiDevice<Ip>::init (unsigned int _width, unsigned int _height, 
+        int _radius, float _eps, int _zero_out, float _boxScaling)
+    {
+        width = _width; height = _height;
+        bufferSize = width * height * sizeof (cl_float);
+        radius = _radius; eps = _eps;
+        zero_out = _zero_out;
+        boxScaling = _boxScaling;
+
+        //* The message outlives the try block, so the pointer is valid in the catch
+        std::string message;
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            if (height % rowAlign != 0)
+            {
+                std::ostringstream ss;
+                ss << "The image height has to be a multiple of " << rowAlign;
+                message = ss.str ();
+                throw message.c_str ();
+            }
+
+            if (bands.size () > height / rowAlign)
+            {
+                std::ostringstream ss;
+                ss << "There can be at most " << height / rowAlign << " devices for this image";
+                message = ss.str ();
+                throw message.c_str ();
+            }
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterMultiDevice]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        if (hBufferInI () == nullptr)
+            hBufferInI = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+        hPtrInI = (cl_float *) queue.enqueueMapBuffer (
+            hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+        queue.enqueueUnmapMemObject (hBufferInI, hPtrInI);
+
+        if (Ip == GuidedFilterConfig::I_NEQ_P)
+        {
+            if (hBufferInP () == nullptr)
+                hBufferInP = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+            hPtrInP = (cl_float *) queue.enqueueMapBuffer (
+                hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+            queue.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+        }
+        else
+        {
+            hBufferInP = hBufferInI;
+            hPtrInP = hPtrInI;
+        }
+
+        if (hBufferOut () == nullptr)
+            hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+        hPtrOut = (cl_float *) queue.enqueueMapBuffer (
+            hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+        queue.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+        queue.finish ();
+
+        partition ();
+        for (Band &band : bands)
+            initBand (band);
+    }
+
+
+    /*! \details Assigns to each band at least one block of `rowAlign` rows, and 
+     *           distributes the rest of the blocks so that the devices finish together 
+     *           (largest remainder first). Then, it sets the halos.
+     *  \note The throughput is measured on the rows a device processes, halos 
+     *        included, so the halos of a band are part of its cost. With the rows 
+     *        \f$ r_i \f$, halo rows \f$ h_i \f$, and throughput \f$ t_i \f$ of the devices, 
+     *        the times \f$ (r_i + h_i) / t_i \f$ are equal for 
+     *        \f$ r_i = t_i (height + \sum_j h_j) / \sum_j t_j - h_i \f$.
+     */
+    template <GuidedFilterConfig Ip>
+    void GuidedFilterMultiDevice<Ip>::partition ()
+    {
+        unsigned int nBlocks = height / rowAlign;
+        size_t n = bands.size ();
+
+        // The halo is rounded up to a multiple of rowAlign
+        unsigned int halo = ((2 * radius + rowAlign - 1) / rowAlign) * rowAlign;
+
+        //* The bands at the ends of the image have a single halo
+        std::vector<double> haloRows (n);
+        double total = 0.0, rows = height;
+        for (size_t i = 0; i < n; ++i)
+        {
+            haloRows[i] = halo * ((i > 0) + (i + 1 < n));
+            total += throughput[i];
+            rows += haloRows[i];
+        }
+
+        std::vector<double> ideal (n);
+        std::vector<unsigned int> blocks (n);
+        unsigned int assigned = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            ideal[i] = std::max ((rows * throughput[i] / total - haloRows[i]) / rowAlign, 0.0);
+            blocks[i] = std::max (1u, (unsigned int) ideal[i]);
+            assigned += blocks[i];
+        }
+
+        while (assigned < nBlocks)
+        {
+            size_t k = 0;
+            for (size_t i = 1; i < n; ++i)
+                if (ideal[i] - blocks[i] > ideal[k] - blocks[k]) k = i;
+            blocks[k]++; assigned++;
+        }
+
+        while (assigned > nBlocks)
+        {
+            size_t k = n;
+            for (size_t i = 0; i < n; ++i)
+                if ((blocks[i] > 1) && ((k == n) || (ideal[i] - blocks[i] < ideal[k] - blocks[k]))) k = i;
+            blocks[k]--; assigned--;
+        }
+
+        unsigned int row = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            Band &band = bands[i];
+            band.row = row;
+            band.rows = blocks[i] * rowAlign;
+            row += band.rows;
+
+            band.top = std::min (halo, band.row);
+            band.bottom = std::min (halo, height - row);
+        }
+    }
+
+
+    /*! \details The transfers are non-blocking, and they are handled 
+     *           by the first command queue of each device.
+     *
+     *  \param[in] ptrI a pointer to an array holding the guidance image. If not NULL, 
+     *                  the data from `ptrI` will be copied to the associated staging buffer.
+     *  \param[in] ptrP a pointer to an array holding the input image. If not NULL, 
+     *                  the data from `ptrP` will be copied to the associated staging buffer.
+     *                  It's ignored when \f$ I == p \f$.
+     */
+    template <GuidedFilterConfig Ip>
+    void GuidedFilterMultiDevice<Ip>::write (void *ptrI, void *ptrP)
+    {
+        if (ptrI != nullptr)
+            std::copy ((cl_float *) ptrI, (cl_float *) ptrI + width * height, hPtrInI);
+        if ((Ip == GuidedFilterConfig::I_NEQ_P) && (ptrP != nullptr))
+            std::copy ((cl_float *) ptrP, (cl_float *) ptrP + width * height, hPtrInP);
+
+        for (Band &band : bands)
+            writeBand (band);
+    }
+
+
+    /*! \details The function call is non-blocking. The halo rows are dropped 
+     *           during the gathering. Call `read` to wait for the output.
+     */
+    template <GuidedFilterConfig Ip>
+    void GuidedFilterMultiDevice<Ip>::run ()
+    {
+        frameStart = std::chrono::steady_clock::now ();
+
+        for (Band &band : bands)
+        {
+            band.gf->run (&band.writeEvents, &band.runEvent);
+
+            std::vector<cl::Event> waitList = { band.runEvent };
+            band.queue.enqueueReadBuffer ((cl::Buffer&) band.gf->get (GuidedFilter<Ip>::Memory::D_OUT), 
+                CL_FALSE, band.top * width * sizeof (cl_float), band.rows * width * sizeof (cl_float), 
+                hPtrOut + band.row * width, &waitList, &band.readEvent);
+            band.queue.flush ();
+        }
+    }
+
+
+    /*! \details The function call is blocking. When all command queues have profiling 
+     *           enabled, the throughput of each device is updated, and if the devices 
+     *           finished more than `10%` apart, the image is partitioned again.
+     *
+     *  \return A pointer to the output staging buffer.
+     */
+    template <GuidedFilterConfig Ip>
+    void* GuidedFilterMultiDevice<Ip>::read ()
+    {
+        bool profiling = true;
+        for (Band &band : bands)
+        {
+            band.readEvent.wait ();
+            profiling &= band.profiling;
+        }
+
+        // The bands run on their own queues, so the frame spans from run to here
+        counters.add (Counters::Counter::FRAMES, 1);
+        counters.add (Counters::Counter::WALL_TIME, std::chrono::duration_cast<std::chrono::nanoseconds> (
+            std::chrono::steady_clock::now () - frameStart).count ());
+
+        if (profiling)
+        {
+            double tMin = std::numeric_limits<double>::max (), tMax = 0.0;
+            for (size_t i = 0; i < bands.size (); ++i)
+            {
+                Band &band = bands[i];
+                cl::Event &first = band.writeEvents[0], &last = band.readEvent;
+                cl_ulong start = first.getProfilingInfo<CL_PROFILING_COMMAND_START> ();
+                cl_ulong end = last.getProfilingInfo<CL_PROFILING_COMMAND_END> ();
+                double t = std::max ((end - start) * 1e-6, 1e-6);  // ms
+
+                tMin = std::min (tMin, t);
+                tMax = std::max (tMax, t);
+                throughput[i] = (band.top + band.rows + band.bottom) / t;
+            }
+
+            if (tMax > rebalanceThreshold * tMin)
+                setThroughput (throughput);
+        }
+
+        return hPtrOut;
+    }
+
+
+    /*! \return The filter window radius.
+     */
+    template <GuidedFilterConfig Ip>
+    int GuidedFilterMultiDevice<Ip>::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    template <GuidedFilterConfig Ip>
+    float GuidedFilterMultiDevice<Ip>::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the parameter on all the devices.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    template <GuidedFilterConfig Ip>
+    void GuidedFilterMultiDevice<Ip>::setEps (float _eps)
+    {
+        eps = _eps;
+        for (Band &band : bands)
+            if (band.gf) band.gf->setEps (eps);
+    }
+
+
+    /*! \return The number of rows (halos excluded) assigned to each device.
+     */
+    template <GuidedFilterConfig Ip>
+    std::vector<unsigned int> GuidedFilterMultiDevice<Ip>::getBandHeights ()
+    {
+        std::vector<unsigned int> heights;
+        for (Band &band : bands)
+            heights.push_back (band.rows);
+        return heights;
+    }
+
+
+    /*! \return The throughput (rows per ms) of each device. Before the first 
+     *          measurement, it's an estimate in arbitrary units.
+     */
+    template <GuidedFilterConfig Ip>
+    std::vector<double> GuidedFilterMultiDevice<Ip>::getThroughput ()
+    {
+        return throughput;
+    }
+
+
+    /*! \details The image is partitioned again, and the bands 
+     *           that changed get new `GuidedFilter` instances.
+     *  \note Don't call it while there is a `run` in flight.
+     *
+     *  \param[in] _throughput throughput (rows per ms, or in any consistent units) of each device.
+     */
+    template <GuidedFilterConfig Ip>
+    void GuidedFilterMultiDevice<Ip>::setThroughput (const std::vector<double> &_throughput)
+    {
+        try
+        {
+            if (_throughput.size () != bands.size ())
+                throw "There has to be one throughput value per device";
+
+            for (double t : _throughput)
+                if (!(t > 0.0))
+                    throw "The throughput values have to be positive";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterMultiDevice]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        throughput = _throughput;
+        if ((width == 0) || (height == 0)) return;
+
+        std::vector<unsigned int> row, rows, top, bottom;
+        for (Band &band : bands)
+        {
+            row.push_back (band.row); rows.push_back (band.rows);
+            top.push_back (band.top); bottom.push_back (band.bottom);
+        }
+
+        partition ();
+
+        for (size_t i = 0; i < bands.size (); ++i)
+        {
+            Band &band = bands[i];
+            if ((band.row != row[i]) || (band.rows != rows[i]) || 
+                (band.top != top[i]) || (band.bottom != bottom[i]))
+                initBand (band);
+        }
+    }
+
+
+    template class GuidedFilterMultiDevice<GuidedFilterConfig::I_EQ_P>;
+    template class GuidedFilterMultiDevice<GuidedFilterConfig::I_NEQ_P>;
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    GuidedUpsampling::GuidedUpsampling (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("GuidedUpsampling"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        gf (env, info), 
+        down (env.getProgram (info.pgIdx), "gf_downsample"), 
+        up (env.getProgram (info.pgIdx), "gf_q_upsample"), 
+        waitList (1)
+    {
+        gf.counters.setParent (counters);
+        gf.setEngine (GuidedFilterEngine::SAT);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedUpsampling::get (GuidedUpsampling::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedUpsampling::Memory::H_IN_I:
+                return hBufferInI;
+            case GuidedUpsampling::Memory::H_IN_P:
+                return hBufferInP;
+            case GuidedUpsampling::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedUpsampling::Memory::D_IN_I:
+                return dBufferInI;
+            case GuidedUpsampling::Memory::D_IN_P:
+                return dBufferInP;
+            case GuidedUpsampling::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the guidance image (and of the output).
+     *  \param[in] _height height of the guidance image (and of the output).
+     *  \param[in] _factor upsampling factor. The input image is 
+     *                     \f$ (width/factor) \times (height/factor) \f$.
+     *  \param[in] _radius radius of the square filter window (in high-resolution pixels).
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] _zero_out flag to indicate whether or not to zero out the output 
+     *                       pixels whose nearest input pixel is zero.
+     *  \param[in] _boxScaling scaling factor applied internally to `BoxFilterSAT`.
+     *  \param[in] _outputScaling factor by which to scale the pixel values in the output array.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedUpsampling::init (unsigned int _width, unsigned int _height, unsigned int _factor, 
+                                 int _radius, float _eps, int _zero_out, float _boxScaling, 
+                                 float _outputScaling, Staging _staging)
+    {
+        width = _width; height = _height; factor = _factor;
+        radius = _radius; eps = _eps;
+        zero_out = _zero_out;
+        outputScaling = _outputScaling;
+        staging = _staging;
+
+        try
+        {
+            if ((factor == 0) || (width % factor != 0) || (height % factor != 0))
+                throw "The image dimensions have to be multiples of the upsampling factor";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedUpsampling]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        unsigned int lWidth = width / factor, lHeight = height / factor;
+        bufferSize = width * height * sizeof (cl_float);
+        bufferLowSize = lWidth * lHeight * sizeof (cl_float);
+
+        // Set workspaces
+        globalLow = cl::NDRange (lWidth, lHeight);
+        globalHigh = cl::NDRange (width, height);
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrInI = nullptr;
+                hPtrInP = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferInI () == nullptr)
+                    hBufferInI = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferInP () == nullptr)
+                    hBufferInP = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferLowSize);
+
+                hPtrInI = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                hPtrInP = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, bufferLowSize);
+                queue0.enqueueUnmapMemObject (hBufferInI, hPtrInI);
+                queue0.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) { hPtrInI = nullptr; hPtrInP = nullptr; }
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferInI () == nullptr)
+            dBufferInI = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferInP () == nullptr)
+            dBufferInP = counters.allocate (context, CL_MEM_READ_ONLY, bufferLowSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        // Low resolution pipeline
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_I) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, bufferLowSize);
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_P) = dBufferInP;
+        gf.init (lWidth, lHeight, lowRadius (radius), eps, 0, _boxScaling, Staging::NONE);
+
+        // Set kernel arguments
+        down.setArg (0, dBufferInI);
+        down.setArg (1, gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_I));
+        down.setArg (2, factor);
+
+        up.setArg (0, dBufferInI);
+        up.setArg (1, gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_MEAN_A));
+        up.setArg (2, gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_MEAN_B));
+        up.setArg (3, dBufferInP);
+        up.setArg (4, dBufferOut);
+        up.setArg (5, factor);
+        up.setArg (6, zero_out);
+        up.setArg (7, outputScaling);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void GuidedUpsampling::write (GuidedUpsampling::Memory mem, void *ptr, bool block, 
+                                  const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedUpsampling::Memory::D_IN_I:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInI);
+                    queue0.enqueueWriteBuffer (dBufferInI, block, 0, bufferSize, hPtrInI, events, event);
+                    break;
+                case GuidedUpsampling::Memory::D_IN_P:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + bufferLowSize / sizeof (cl_float), hPtrInP);
+                    queue0.enqueueWriteBuffer (dBufferInP, block, 0, bufferLowSize, hPtrInP, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* GuidedUpsampling::read (GuidedUpsampling::Memory mem, bool block, 
+                                  const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedUpsampling::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedUpsampling::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        queue0.enqueueNDRangeKernel (down, cl::NullRange, globalLow, cl::NullRange, events, &dEvent);
+        waitList[0] = dEvent;
+        gf.run (&waitList);
+        queue0.enqueueNDRangeKernel (up, cl::NullRange, globalHigh, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedUpsampling::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<CommandGraph::Node> depsGF (1);
+        graph.add (queue0, down, cl::NullRange, globalLow, cl::NullRange, deps, &depsGF[0]);
+        gf.record (graph, &depsGF);
+        graph.add (queue0, up, cl::NullRange, globalHigh, cl::NullRange, nullptr, node);
+    }
+
+
+    /*! \return The radius of the square filter window (in high-resolution pixels).
+     */
+    int GuidedUpsampling::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the radius of the low-resolution pipeline.
+     *
+     *  \param[in] _radius radius of the square filter window (in high-resolution pixels).
+     */
+    void GuidedUpsampling::setRadius (int _radius)
+    {
+        radius = _radius;
+        gf.setRadius (lowRadius (radius));
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedUpsampling::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedUpsampling::setEps (float _eps)
+    {
+        eps = _eps;
+        gf.setEps (eps);
+    }
+
+
+    /*! \return The scaling factor of the output.
+     */
+    float GuidedUpsampling::getOutputScaling ()
+    {
+        return outputScaling;
+    }
+
+
+    /*! \details Updates the kernel argument for the scaling factor of the output.
+     *
+     *  \param[in] _outputScaling scaling factor of the output.
+     */
+    void GuidedUpsampling::setOutputScaling (float _outputScaling)
+    {
+        outputScaling = _outputScaling;
+        up.setArg (7, outputScaling);
+    }
+
+
+    /*! \param[in] _radius radius of the square filter window (in high-resolution pixels).
+     *  \return The radius of the square filter window at the low resolution.
+     */
+    int GuidedUpsampling::lowRadius (int _radius)
+    {
+        return std::max (_radius / (int) factor, 1);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    GuidedFilterIterated::GuidedFilterIterated (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("GuidedFilterIterated"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        gf (env, info), 
+        seed (env.getProgram (info.pgIdx), "gf_feedback"), 
+        feedback (env.getProgram (info.pgIdx), "gf_feedback"), 
+        relay (env.getProgram (info.pgIdx), "gf_feedback"), 
+        iterations (0), executed (0), hPtrResiduals (nullptr), 
+        waitList (1)
+    {
+        gf.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedFilterIterated::get (GuidedFilterIterated::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedFilterIterated::Memory::H_IN_I:
+                return hBufferInI;
+            case GuidedFilterIterated::Memory::H_IN_P:
+                return hBufferInP;
+            case GuidedFilterIterated::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedFilterIterated::Memory::D_IN_I:
+                return dBufferInI;
+            case GuidedFilterIterated::Memory::D_IN_P:
+                return dBufferInP;
+            case GuidedFilterIterated::Memory::D_OUT:
+                return dBufferOut;
+            case GuidedFilterIterated::Memory::D_GUIDE:
+                return dBufferGuide;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the input array to be processed.
+     *  \param[in] _height height of the input array to be processed.
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] _iterations (maximum) number of iterations.
+     *  \param[in] _tolerance tolerance on the change of the guide, \f$ max |I^{t+1} - I^t| \f$. 
+     *                        If it's positive, the iterations stop once the change drops to 
+     *                        or below it. Otherwise, all the iterations are executed.
+     *  \param[in] _boxScaling scaling factor applied internally to `BoxFilterSAT`.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedFilterIterated::init (unsigned int _width, unsigned int _height, int _radius, float _eps, 
+                                     unsigned int _iterations, float _tolerance, float _boxScaling, 
+                                     Staging _staging)
+    {
+        width = _width; height = _height;
+        radius = _radius; eps = _eps;
+        iterations = _iterations; executed = 0;
+        tolerance = _tolerance;
+        bufferSize = width * height * sizeof (cl_float);
+        staging = _staging;
+
+        try
+        {
+            if (iterations == 0)
+                throw "The number of iterations has to be positive";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterIterated]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Set workspaces
+        size_t wgSize = std::min (feedback.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (
+            env.devices[info.pIdx][info.dIdx]), (size_t) 256);
+        size_t wgS = 1;
+        while (2 * wgS <= wgSize) wgS <<= 1;
+        unsigned int n = width * height / 4;
+        global = cl::NDRange ((n + wgS - 1) / wgS * wgS);
+        local = cl::NDRange (wgS);
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrInI = nullptr;
+                hPtrInP = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferInI () == nullptr)
+                    hBufferInI = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferInP () == nullptr)
+                    hBufferInP = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrInI = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                hPtrInP = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferInI, hPtrInI);
+                queue0.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) { hPtrInI = nullptr; hPtrInP = nullptr; }
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferInI () == nullptr)
+            dBufferInI = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferInP () == nullptr)
+            dBufferInP = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        if (dBufferGuide () == nullptr)
+            dBufferGuide = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        initResiduals ();
+
+        // The filter is set up once, and reads the guide the iterations feed back
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_I) = dBufferGuide;
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_P) = dBufferInP;
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_OUT) = dBufferOut;
+        gf.init (width, height, radius, eps, 0, _boxScaling, Staging::NONE);
+
+        // Set kernel arguments
+        seed.setArg (0, dBufferInI);
+        seed.setArg (1, dBufferGuide);
+        seed.setArg (2, dBufferResiduals);
+        seed.setArg (3, 0);
+        seed.setArg (4, iterations + 1);
+        seed.setArg (5, 0.f);
+        seed.setArg (6, n);
+        seed.setArg (7, cl::Local (local[0] * sizeof (cl_float)));
+
+        feedback.setArg (0, dBufferOut);
+        feedback.setArg (1, dBufferGuide);
+        feedback.setArg (2, dBufferResiduals);
+        feedback.setArg (3, 1);
+        feedback.setArg (4, iterations + 1);
+        feedback.setArg (5, tolerance);
+        feedback.setArg (6, n);
+        feedback.setArg (7, cl::Local (local[0] * sizeof (cl_float)));
+
+        // The feedback that's recorded (and profiled) never stops the iterations
+        relay.setArg (0, dBufferOut);
+        relay.setArg (1, dBufferGuide);
+        relay.setArg (2, dBufferResiduals);
+        relay.setArg (3, 1);
+        relay.setArg (4, iterations + 1);
+        relay.setArg (5, 0.f);
+        relay.setArg (6, n);
+        relay.setArg (7, cl::Local (local[0] * sizeof (cl_float)));
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void GuidedFilterIterated::write (GuidedFilterIterated::Memory mem, void *ptr, bool block, 
+                                      const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilterIterated::Memory::D_IN_I:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInI);
+                    queue0.enqueueWriteBuffer (dBufferInI, block, 0, bufferSize, hPtrInI, events, event);
+                    break;
+                case GuidedFilterIterated::Memory::D_IN_P:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + width * height, hPtrInP);
+                    queue0.enqueueWriteBuffer (dBufferInP, block, 0, bufferSize, hPtrInP, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* GuidedFilterIterated::read (GuidedFilterIterated::Memory mem, bool block, 
+                                      const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilterIterated::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details Every iteration runs the filter, and feeds its output back as the guide. 
+     *           When a tolerance is set, `gf_feedback` stops the iterations on the device, 
+     *           and the changes of the guide are read back once, after the last iteration.
+     *  \note The function call is non-blocking. `getExecuted` and `getResidual` 
+     *        wait for the changes to be read back.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilterIterated::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+
+        queue0.enqueueWriteBuffer (dBufferResiduals, CL_FALSE, 0, zeros.size () * sizeof (cl_uint), zeros.data (), events);
+        queue0.enqueueNDRangeKernel (seed, cl::NullRange, global, local, nullptr, &waitList[0]);
+
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            gf.run (&waitList);
+
+            feedback.setArg (3, i + 1);
+            queue0.enqueueNDRangeKernel (feedback, cl::NullRange, global, local, nullptr, 
+                                         (i + 1 == iterations) ? event : &waitList[0]);
+        }
+
+        executed = iterations;
+        if (tolerance > 0.f)
+            queue0.enqueueReadBuffer (dBufferResiduals, CL_FALSE, 0, zeros.size () * sizeof (cl_uint), 
+                                      hPtrResiduals, nullptr, &readEvent);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them, 
+     *           for all the iterations. The tolerance is ignored, 
+     *           and the changes of the guide aren't tracked.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedFilterIterated::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<CommandGraph::Node> depsGF (1);
+        graph.add (queue0, seed, cl::NullRange, global, local, deps, &depsGF[0]);
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            gf.record (graph, &depsGF);
+            graph.add (queue0, relay, cl::NullRange, global, local, nullptr, 
+                       (i + 1 == iterations) ? node : &depsGF[0]);
+        }
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int GuidedFilterIterated::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the radius of the filter.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void GuidedFilterIterated::setRadius (int _radius)
+    {
+        radius = _radius;
+        gf.setRadius (radius);
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedFilterIterated::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the regularization parameter \f$\epsilon\f$ of the filter.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedFilterIterated::setEps (float _eps)
+    {
+        eps = _eps;
+        gf.setEps (eps);
+    }
+
+
+    /*! \return The (maximum) number of iterations.
+     */
+    unsigned int GuidedFilterIterated::getIterations ()
+    {
+        return iterations;
+    }
+
+
+    /*! \details Recreates the buffers of the changes of the guide.
+     *
+     *  \param[in] _iterations (maximum) number of iterations.
+     */
+    void GuidedFilterIterated::setIterations (unsigned int _iterations)
+    {
+        try
+        {
+            if (_iterations == 0)
+                throw "The number of iterations has to be positive";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterIterated]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        iterations = _iterations; executed = 0;
+        initResiduals ();
+        for (cl::Kernel *k : { &seed, &feedback, &relay })
+        {
+            k->setArg (2, dBufferResiduals);
+            k->setArg (4, iterations + 1);
+        }
+    }
+
+
+    /*! \return The tolerance on the change of the guide.
+     */
+    float GuidedFilterIterated::getTolerance ()
+    {
+        return tolerance;
+    }
+
+
+    /*! \param[in] _tolerance tolerance on the change of the guide. 
+     *                        If it's not positive, all the iterations are executed.
+     */
+    void GuidedFilterIterated::setTolerance (float _tolerance)
+    {
+        tolerance = _tolerance;
+        feedback.setArg (5, tolerance);
+    }
+
+
+    /*! \details The iterations past the converged one, which `gf_feedback` 
+     *           skipped, aren't counted.
+     *  \note When a tolerance is set, the call blocks until 
+     *        the changes of the last `run` have been read back.
+     *
+     *  \return The number of iterations executed by the last `run`.
+     */
+    unsigned int GuidedFilterIterated::getExecuted ()
+    {
+        if (tolerance > 0.f && readEvent () != nullptr)
+        {
+            readEvent.wait ();
+            readEvent = cl::Event ();
+
+            // The `done` element keeps the slot of the first skipped iteration
+            cl_uint done = hPtrResiduals[iterations + 1];
+            if (done != 0) executed = done - 1;
+        }
+
+        return executed;
+    }
+
+
+    /*! \note The changes are only read back when a tolerance is set. 
+     *        The call blocks until the changes of the last `run` are available.
+     *
+     *  \param[in] iteration index of the iteration (0-based).
+     *  \return The change of the guide, \f$ max |I^{t+1} - I^t| \f$, in the iteration.
+     */
+    float GuidedFilterIterated::getResidual (unsigned int iteration)
+    {
+        if (tolerance <= 0.f || iteration >= getExecuted ()) return 0.f;
+        return residualAt (iteration + 1);
+    }
+
+
+    /*! \details The changes are kept as `float` bit patterns in an array of `iterations + 2` 
+     *           elements. The first element belongs to the copy of the first guide, and 
+     *           the last one is the `done` element of `gf_feedback`.
+     */
+    void GuidedFilterIterated::initResiduals ()
+    {
+        size_t size = (iterations + 2) * sizeof (cl_uint);
+
+        zeros.assign (iterations + 2, 0);
+        readEvent = cl::Event ();
+        dBufferResiduals = counters.allocate (context, CL_MEM_READ_WRITE, size);
+        hBufferResiduals = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, size);
+        hPtrResiduals = (cl_uint *) queue0.enqueueMapBuffer (
+            hBufferResiduals, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, size);
+        queue0.enqueueUnmapMemObject (hBufferResiduals, hPtrResiduals);
+        queue0.finish ();
+    }
+
+
+    /*! \param[in] slot index of the element of the residuals array.
+     *  \return The change of the guide, reinterpreted from its bit pattern.
+     */
+    float GuidedFilterIterated::residualAt (unsigned int slot)
+    {
+        float residual;
+        std::memcpy (&residual, hPtrResiduals + slot, sizeof (float));
+        return residual;
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    DetailEnhancement::DetailEnhancement (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("DetailEnhancement"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        lum (env.getProgram (info.pgIdx), "gf_logLuminance"), 
+        combine (env.getProgram (info.pgIdx), "gf_detailCombine"), 
+        width (0), height (0), eps (0.f), boxScaling (1e-4f), 
+        compression (1.f), anchor (1.f), exposure (1.f), gamma (1.f), 
+        waitListCorr (1)
+    {
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& DetailEnhancement::get (DetailEnhancement::Memory mem)
+    {
+        switch (mem)
+        {
+            case DetailEnhancement::Memory::H_IN:
+                return hBufferIn;
+            case DetailEnhancement::Memory::H_OUT:
+                return hBufferOut;
+            case DetailEnhancement::Memory::D_IN:
+                return dBufferIn;
+            case DetailEnhancement::Memory::D_OUT:
+                return dBufferOut;
+            case DetailEnhancement::Memory::D_LUM:
+                return dBufferLum;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces. 
+     *           Every scale gets its own `BoxFilterSAT` instances for \f$ l, l^2, a, b \f$. 
+     *           Those of the first scale compute the summed area tables of \f$ l, l^2 \f$, 
+     *           and those of the other scales use them.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note The boost factors are reset to \f$ 1 \f$. The compression, anchor, exposure, 
+     *        and gamma are maintained (they default to \f$ 1 \f$, i.e. no compression, 
+     *        and a linear output).
+     *  \note The image dimensions have to be multiples of 4.
+     *
+     *  \param[in] _width width of the input image.
+     *  \param[in] _height height of the input image.
+     *  \param[in] _radii radii of the square filter windows of the scales (normally, in increasing order).
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$ (on the normalized log-luminance).
+     *  \param[in] _boxScaling factor by which to scale the arrays before the `BoxFilterSAT` summations.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void DetailEnhancement::init (unsigned int _width, unsigned int _height, const std::vector<int> &_radii, 
+                                  float _eps, float _boxScaling, Staging _staging)
+    {
+        width = _width; height = _height;
+        eps = _eps; boxScaling = _boxScaling;
+        bufferSize = width * height * sizeof (cl_float);
+        bufferSizeIn = 3 * width * height * sizeof (cl_float);
+        bufferSizeOut = 3 * width * height * sizeof (cl_uchar);
+        staging = _staging;
+
+        try
+        {
+            if (_radii.empty () || (_radii.size () > maxScales))
+                throw "The number of scales has to be between 1 and 4";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[DetailEnhancement]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSizeIn);
+
+                hPtrIn = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSizeIn);
+                queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSizeOut);
+
+                hPtrOut = (cl_uchar *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSizeOut);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSizeIn);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSizeOut);
+        if (dBufferLum () == nullptr)
+            dBufferLum = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        if (dBufferLum2 () == nullptr)
+            dBufferLum2 = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+
+        // Set up the scales
+        scales.clear ();
+        scales.resize (_radii.size ());
+        for (size_t k = 0; k < scales.size (); ++k)
+        {
+            Scale &scale = scales[k];
+            scale.radius = _radii[k];
+            scale.boost = 1.f;
+            scale.mean_l.reset (new BoxFilterSAT (env, info.getCLEnvInfo (0)));
+            scale.corr_l.reset (new BoxFilterSAT (env, info.getCLEnvInfo (1)));
+            scale.mean_a.reset (new BoxFilterSAT (env, info.getCLEnvInfo (0)));
+            scale.mean_b.reset (new BoxFilterSAT (env, info.getCLEnvInfo (1)));
+            scale.mean_l->counters.setParent (counters);
+            scale.corr_l->counters.setParent (counters);
+            scale.mean_a->counters.setParent (counters);
+            scale.mean_b->counters.setParent (counters);
+
+            // The summed area tables of l, l^2 are computed by the first scale
+            if (k == 0)
+            {
+                scale.mean_l->get (BoxFilterSAT::Memory::D_IN) = dBufferLum;
+                scale.corr_l->get (BoxFilterSAT::Memory::D_IN) = dBufferLum2;
+            }
+            else
+            {
+                scale.mean_l->get (BoxFilterSAT::Memory::D_SAT) = scales[0].mean_l->get (BoxFilterSAT::Memory::D_SAT);
+                scale.corr_l->get (BoxFilterSAT::Memory::D_SAT) = scales[0].corr_l->get (BoxFilterSAT::Memory::D_SAT);
+            }
+            scale.mean_l->get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            scale.mean_l->init (width, height, scale.radius, boxScaling, Staging::NONE);
+            scale.corr_l->get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            scale.corr_l->init (width, height, scale.radius, boxScaling, Staging::NONE);
+
+            cl::Buffer dBufferA = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            cl::Buffer dBufferB = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            scale.ab = cl::Kernel (env.getProgram (info.pgIdx), "gf_ab");
+            scale.ab.setArg (0, scale.mean_l->get (BoxFilterSAT::Memory::D_OUT));
+            scale.ab.setArg (1, scale.corr_l->get (BoxFilterSAT::Memory::D_OUT));
+            scale.ab.setArg (2, dBufferA);
+            scale.ab.setArg (3, dBufferB);
+            scale.ab.setArg (4, eps);
+
+            scale.mean_a->get (BoxFilterSAT::Memory::D_IN) = dBufferA;
+            scale.mean_a->get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            scale.mean_a->init (width, height, scale.radius, boxScaling, Staging::NONE);
+            scale.mean_b->get (BoxFilterSAT::Memory::D_IN) = dBufferB;
+            scale.mean_b->get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            scale.mean_b->init (width, height, scale.radius, boxScaling, Staging::NONE);
+
+            scale.waitListAB.resize (1);
+            scale.waitListMB.resize (1);
+        }
+        waitListCombine.assign (scales.size (), cl::Event ());
+
+        // Set workspaces
+        global = cl::NDRange (width * height);
+        globalAB = cl::NDRange (width * height / 4);
+
+        // Set kernel arguments
+        lum.setArg (0, dBufferIn);
+        lum.setArg (1, dBufferLum);
+        lum.setArg (2, dBufferLum2);
+
+        //* The coefficients of unused scales are bound to those of the first scale
+        combine.setArg (0, dBufferIn);
+        combine.setArg (1, dBufferLum);
+        for (unsigned int k = 0; k < maxScales; ++k)
+        {
+            Scale &scale = scales[(k < scales.size ()) ? k : 0];
+            combine.setArg (2 + 2 * k, scale.mean_a->get (BoxFilterSAT::Memory::D_OUT));
+            combine.setArg (3 + 2 * k, scale.mean_b->get (BoxFilterSAT::Memory::D_OUT));
+        }
+        combine.setArg (10, dBufferOut);
+        combine.setArg (11, (cl_uint) scales.size ());
+        setBoosts ();
+        combine.setArg (13, compression);
+        combine.setArg (14, anchor);
+        combine.setArg (15, exposure);
+        combine.setArg (16, 1.f / gamma);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void DetailEnhancement::write (DetailEnhancement::Memory mem, void *ptr, bool block, 
+                                   const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case DetailEnhancement::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + 3 * width * height, hPtrIn);
+                    queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferSizeIn, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* DetailEnhancement::read (DetailEnhancement::Memory mem, bool block, 
+                                   const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case DetailEnhancement::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSizeOut, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The summed area tables of \f$ l \f$ and \f$ l^2 \f$ are computed on 
+     *           the first and second command queue, respectively, followed by the means 
+     *           of every scale. Then, the coefficients of every scale are computed and 
+     *           averaged (\f$ \bar{a} \f$ on the first, \f$ \bar{b} \f$ on the second 
+     *           command queue), and the combining kernel waits for all of them.
+     *  \note The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void DetailEnhancement::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+
+        queue0.enqueueNDRangeKernel (lum, cl::NullRange, global, cl::NullRange, events, &lumEvent);
+        waitListCorr[0] = lumEvent;
+
+        for (size_t k = 0; k < scales.size (); ++k)
+        {
+            Scale &scale = scales[k];
+            scale.mean_l->run ();
+            scale.corr_l->run ((k == 0) ? &waitListCorr : nullptr, &scale.corrEvent);
+            scale.waitListAB[0] = scale.corrEvent;
+        }
+
+        for (size_t k = 0; k < scales.size (); ++k)
+        {
+            Scale &scale = scales[k];
+            queue0.enqueueNDRangeKernel (scale.ab, cl::NullRange, globalAB, cl::NullRange, 
+                                         &scale.waitListAB, &scale.abEvent);
+            scale.mean_a->run ();
+            scale.waitListMB[0] = scale.abEvent;
+            scale.mean_b->run (&scale.waitListMB, &scale.mbEvent);
+            waitListCombine[k] = scale.mbEvent;
+        }
+
+        queue0.enqueueNDRangeKernel (combine, cl::NullRange, global, cl::NullRange, &waitListCombine, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void DetailEnhancement::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<CommandGraph::Node> depsCorr (1), depsCombine (scales.size ());
+        std::vector<std::vector<CommandGraph::Node>> depsAB (scales.size (), std::vector<CommandGraph::Node> (1));
+        std::vector<std::vector<CommandGraph::Node>> depsMB (scales.size (), std::vector<CommandGraph::Node> (1));
+
+        graph.add (queue0, lum, cl::NullRange, global, cl::NullRange, deps, &depsCorr[0]);
+        for (size_t k = 0; k < scales.size (); ++k)
+        {
+            scales[k].mean_l->record (graph);
+            scales[k].corr_l->record (graph, (k == 0) ? &depsCorr : nullptr, &depsAB[k][0]);
+        }
+
+        for (size_t k = 0; k < scales.size (); ++k)
+        {
+            graph.add (queue0, scales[k].ab, cl::NullRange, globalAB, cl::NullRange, &depsAB[k], &depsMB[k][0]);
+            scales[k].mean_a->record (graph);
+            scales[k].mean_b->record (graph, &depsMB[k], &depsCombine[k]);
+        }
+
+        graph.add (queue0, combine, cl::NullRange, global, cl::NullRange, &depsCombine, node);
+    }
+
+
+    /*! \return The number of scales.
+     */
+    unsigned int DetailEnhancement::getScales ()
+    {
+        return scales.size ();
+    }
+
+
+    /*! \param[in] scale index of the scale.
+     *  \return The radius of the square filter window of the scale.
+     */
+    int DetailEnhancement::getRadius (unsigned int scale)
+    {
+        return scales[scale].radius;
+    }
+
+
+    /*! \details Updates the radius of the `BoxFilterSAT` instances of the scale.
+     *
+     *  \param[in] scale index of the scale.
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void DetailEnhancement::setRadius (unsigned int scale, int _radius)
+    {
+        Scale &s = scales[scale];
+        s.radius = _radius;
+        s.mean_l->setRadius (s.radius);
+        s.corr_l->setRadius (s.radius);
+        s.mean_a->setRadius (s.radius);
+        s.mean_b->setRadius (s.radius);
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float DetailEnhancement::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$ 
+     *           of all scales.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void DetailEnhancement::setEps (float _eps)
+    {
+        eps = _eps;
+        for (Scale &scale : scales)
+            scale.ab.setArg (4, eps);
+    }
+
+
+    /*! \param[in] scale index of the scale.
+     *  \return The boost factor of the detail layer of the scale.
+     */
+    float DetailEnhancement::getBoost (unsigned int scale)
+    {
+        return scales[scale].boost;
+    }
+
+
+    /*! \details Updates the kernel argument for the boost factors.
+     *
+     *  \param[in] scale index of the scale.
+     *  \param[in] _boost boost factor of the detail layer of the scale. 
+     *                    \f$ 1 \f$ leaves the detail unchanged.
+     */
+    void DetailEnhancement::setBoost (unsigned int scale, float _boost)
+    {
+        scales[scale].boost = _boost;
+        setBoosts ();
+    }
+
+
+    /*! \return The compression factor of the base layer.
+     */
+    float DetailEnhancement::getCompression ()
+    {
+        return compression;
+    }
+
+
+    /*! \details Updates the kernel argument for the compression factor.
+     *
+     *  \param[in] _compression factor by which to scale the (coarsest) base layer, 
+     *                          around the anchor. Values below \f$ 1 \f$ reduce the contrast.
+     */
+    void DetailEnhancement::setCompression (float _compression)
+    {
+        compression = _compression;
+        combine.setArg (13, compression);
+    }
+
+
+    /*! \return The log-luminance that the compression maps to itself.
+     */
+    float DetailEnhancement::getAnchor ()
+    {
+        return anchor;
+    }
+
+
+    /*! \details Updates the kernel argument for the anchor.
+     *
+     *  \param[in] _anchor normalized log-luminance that the compression maps to itself. 
+     *                     \f$ 1 \f$ corresponds to white (\f$ Y = 1 \f$), and 
+     *                     \f$ 0 \f$ to black.
+     */
+    void DetailEnhancement::setAnchor (float _anchor)
+    {
+        anchor = _anchor;
+        combine.setArg (14, anchor);
+    }
+
+
+    /*! \return The exposure factor.
+     */
+    float DetailEnhancement::getExposure ()
+    {
+        return exposure;
+    }
+
+
+    /*! \details Updates the kernel argument for the exposure factor.
+     *
+     *  \param[in] _exposure factor by which to scale the colors before the encoding.
+     */
+    void DetailEnhancement::setExposure (float _exposure)
+    {
+        exposure = _exposure;
+        combine.setArg (15, exposure);
+    }
+
+
+    /*! \return The gamma of the output encoding.
+     */
+    float DetailEnhancement::getGamma ()
+    {
+        return gamma;
+    }
+
+
+    /*! \details Updates the kernel argument for the gamma.
+     *
+     *  \param[in] _gamma gamma \f$ \gamma \f$ of the output encoding, 
+     *                    \f$ out = 255 * v^{1/\gamma} \f$.
+     */
+    void DetailEnhancement::setGamma (float _gamma)
+    {
+        gamma = _gamma;
+        combine.setArg (16, 1.f / gamma);
+    }
+
+
+    /*! \details The boost factors of unused scales are ignored by the kernel.
+     */
+    void DetailEnhancement::setBoosts ()
+    {
+        cl_float4 boost = {{ 1.f, 1.f, 1.f, 1.f }};
+        for (size_t k = 0; k < scales.size (); ++k)
+            boost.s[k] = scales[k].boost;
+        combine.setArg (12, boost);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    Dehazing::Dehazing (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("Dehazing"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        dark (env, info.getCLEnvInfo (0)), trans (env, info.getCLEnvInfo (0)), 
+        gf (env, info), 
+        prepare (env.getProgram (info.pgIdx), "gf_dehazePrepare"), 
+        histogram (env.getProgram (info.pgIdx), "gf_dehazeHistogram"), 
+        lightSums (env.getProgram (info.pgIdx), "gf_dehazeLightSums"), 
+        light (env.getProgram (info.pgIdx), "gf_dehazeLight"), 
+        transmission (env.getProgram (info.pgIdx), "gf_dehazeTransmission"), 
+        recover (env.getProgram (info.pgIdx), "gf_dehazeRecover"), 
+        width (0), height (0), 
+        waitListGF (1), waitListRecover (1)
+    {
+        dark.counters.setParent (counters);
+        trans.counters.setParent (counters);
+        gf.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& Dehazing::get (Dehazing::Memory mem)
+    {
+        switch (mem)
+        {
+            case Dehazing::Memory::H_IN:
+                return hBufferIn;
+            case Dehazing::Memory::H_OUT:
+                return hBufferOut;
+            case Dehazing::Memory::D_IN:
+                return dBufferIn;
+            case Dehazing::Memory::D_OUT:
+                return dBufferOut;
+            case Dehazing::Memory::D_DARK:
+                return dark.get (MinFilter::Memory::D_OUT);
+            case Dehazing::Memory::D_TRANSMISSION:
+                return gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_OUT);
+            case Dehazing::Memory::D_LIGHT:
+                return dBufferLight;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note The atmospheric light is estimated from the haziest \f$ 0.1\% \f$ of the pixels.
+     *
+     *  \param[in] _width width of the input image.
+     *  \param[in] _height height of the input image.
+     *  \param[in] _darkRadius radius of the dark channel window.
+     *  \param[in] _radius radius of the filter window of the transmission refinement.
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$ of the transmission refinement.
+     *  \param[in] _omega fraction of the haze to remove, \f$ \omega \f$.
+     *  \param[in] _t0 lower bound of the transmission, \f$ t_0 \f$.
+     *  \param[in] _boxScaling factor by which to scale the arrays before the `BoxFilterSAT` summations.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void Dehazing::init (unsigned int _width, unsigned int _height, int _darkRadius, int _radius, float _eps, 
+                         float _omega, float _t0, float _boxScaling, Staging _staging)
+    {
+        width = _width; height = _height;
+        darkRadius = _darkRadius; radius = _radius; eps = _eps;
+        omega = _omega; t0 = _t0;
+        bufferSize = width * height * sizeof (cl_float);
+        bufferSizeRGB = 3 * width * height * sizeof (cl_float);
+        staging = _staging;
+
+        // Set workspaces
+        //* The reductions use the largest power of 2 work-groups (up to 256) the kernels allow
+        cl::Device &device = env.devices[info.pIdx][info.dIdx];
+        size_t wgSize = std::min ({ histogram.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device), 
+                                    lightSums.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device), 
+                                    light.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE> (device), 
+                                    (size_t) 256 });
+        size_t wgS = 1;
+        while (2 * wgS <= wgSize) wgS <<= 1;
+        unsigned int n = width * height;
+        unsigned int groups = (n + wgS - 1) / wgS;
+        global = cl::NDRange (n);
+        globalRed = cl::NDRange (groups * wgS);
+        localRed = cl::NDRange (wgS);
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSizeRGB);
+
+                hPtrIn = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSizeRGB);
+                queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSizeRGB);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSizeRGB);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSizeRGB);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSizeRGB);
+        dBufferMin = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferGray = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferRaw = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferSums = counters.allocate (context, CL_MEM_READ_WRITE, groups * sizeof (cl_float4));
+        dBufferLight = counters.allocate (context, CL_MEM_READ_WRITE, sizeof (cl_float4));
+
+        //* The histogram is zeroed here, and then by `gf_dehazeLight` after every use
+        std::vector<cl_uint> zeros (histBins, 0);
+        dBufferHist = counters.allocate (context, CL_MEM_READ_WRITE, histBins * sizeof (cl_uint));
+        queue0.enqueueWriteBuffer (dBufferHist, CL_TRUE, 0, histBins * sizeof (cl_uint), zeros.data ());
+
+        // Set up the filters
+        dark.get (MinFilter::Memory::D_IN) = dBufferMin;
+        dark.init (width, height, darkRadius, Staging::NONE);
+
+        trans.get (MaxFilter::Memory::D_IN) = dBufferRaw;
+        trans.init (width, height, darkRadius, Staging::NONE);
+
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_I) = dBufferGray;
+        gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_P) = trans.get (MaxFilter::Memory::D_OUT);
+        gf.init (width, height, radius, eps, 0, _boxScaling, Staging::NONE);
+
+        // Set kernel arguments
+        prepare.setArg (0, dBufferIn);
+        prepare.setArg (1, dBufferMin);
+        prepare.setArg (2, dBufferGray);
+
+        histogram.setArg (0, dark.get (MinFilter::Memory::D_OUT));
+        histogram.setArg (1, dBufferHist);
+        histogram.setArg (2, n);
+        histogram.setArg (3, cl::Local (histBins * sizeof (cl_uint)));
+
+        lightSums.setArg (0, dBufferIn);
+        lightSums.setArg (1, dark.get (MinFilter::Memory::D_OUT));
+        lightSums.setArg (2, dBufferHist);
+        lightSums.setArg (3, dBufferSums);
+        lightSums.setArg (4, n);
+        lightSums.setArg (5, std::max (n / 1000, 1u));
+        lightSums.setArg (6, cl::Local (wgS * sizeof (cl_float4)));
+
+        light.setArg (0, dBufferSums);
+        light.setArg (1, groups);
+        light.setArg (2, dBufferLight);
+        light.setArg (3, dBufferHist);
+        light.setArg (4, cl::Local (wgS * sizeof (cl_float4)));
+
+        transmission.setArg (0, dBufferIn);
+        transmission.setArg (1, dBufferLight);
+        transmission.setArg (2, dBufferRaw);
+        transmission.setArg (3, omega);
+
+        recover.setArg (0, dBufferIn);
+        recover.setArg (1, dBufferLight);
+        recover.setArg (2, gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_OUT));
+        recover.setArg (3, dBufferOut);
+        recover.setArg (4, t0);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void Dehazing::write (Dehazing::Memory mem, void *ptr, bool block, 
+                          const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case Dehazing::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + 3 * width * height, hPtrIn);
+                    queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferSizeRGB, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* Dehazing::read (Dehazing::Memory mem, bool block, 
+                          const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case Dehazing::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSizeRGB, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details All the kernels, but those of the guided filter, execute on the first 
+     *           command queue. The guided filter waits for the transmission estimate, 
+     *           and the recovery waits for the guided filter.
+     *  \note The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void Dehazing::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+
+        queue0.enqueueNDRangeKernel (prepare, cl::NullRange, global, cl::NullRange, events);
+        dark.run ();
+        queue0.enqueueNDRangeKernel (histogram, cl::NullRange, globalRed, localRed);
+        queue0.enqueueNDRangeKernel (lightSums, cl::NullRange, globalRed, localRed);
+        queue0.enqueueNDRangeKernel (light, cl::NullRange, localRed, localRed);
+        queue0.enqueueNDRangeKernel (transmission, cl::NullRange, global, cl::NullRange);
+        trans.run (nullptr, &tEvent); waitListGF[0] = tEvent;
+        gf.run (&waitListGF, &gfEvent); waitListRecover[0] = gfEvent;
+        queue0.enqueueNDRangeKernel (recover, cl::NullRange, global, cl::NullRange, &waitListRecover, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void Dehazing::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<CommandGraph::Node> depsGF (1), depsRecover (1);
+        graph.add (queue0, prepare, cl::NullRange, global, cl::NullRange, deps);
+        dark.record (graph);
+        graph.add (queue0, histogram, cl::NullRange, globalRed, localRed);
+        graph.add (queue0, lightSums, cl::NullRange, globalRed, localRed);
+        graph.add (queue0, light, cl::NullRange, localRed, localRed);
+        graph.add (queue0, transmission, cl::NullRange, global, cl::NullRange);
+        trans.record (graph, nullptr, &depsGF[0]);
+        gf.record (graph, &depsGF, &depsRecover[0]);
+        graph.add (queue0, recover, cl::NullRange, global, cl::NullRange, &depsRecover, node);
+    }
+
+
+    /*! \details The call blocks until the atmospheric light is read back.
+     *
+     *  \return The atmospheric light \f$ A \f$, \f$ (R, G, B, 0) \f$.
+     */
+    cl_float4 Dehazing::getAtmosphericLight ()
+    {
+        cl_float4 A;
+        queue0.enqueueReadBuffer (dBufferLight, CL_TRUE, 0, sizeof (cl_float4), &A);
+        return A;
+    }
+
+
+    /*! \return The radius of the dark channel window.
+     */
+    int Dehazing::getDarkRadius ()
+    {
+        return darkRadius;
+    }
+
+
+    /*! \details Updates the radius of the min and max filters.
+     *
+     *  \param[in] _darkRadius radius of the dark channel window.
+     */
+    void Dehazing::setDarkRadius (int _darkRadius)
+    {
+        darkRadius = _darkRadius;
+        dark.setRadius (darkRadius);
+        trans.setRadius (darkRadius);
+    }
+
+
+    /*! \return The radius of the filter window of the transmission refinement.
+     */
+    int Dehazing::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the radius of the guided filter.
+     *
+     *  \param[in] _radius radius of the filter window of the transmission refinement.
+     */
+    void Dehazing::setRadius (int _radius)
+    {
+        radius = _radius;
+        gf.setRadius (radius);
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float Dehazing::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the regularization parameter \f$\epsilon\f$ of the guided filter.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void Dehazing::setEps (float _eps)
+    {
+        eps = _eps;
+        gf.setEps (eps);
+    }
+
+
+    /*! \return The fraction of the haze to remove, \f$ \omega \f$.
+     */
+    float Dehazing::getOmega ()
+    {
+        return omega;
+    }
+
+
+    /*! \details Updates the kernel argument for \f$ \omega \f$.
+     *
+     *  \param[in] _omega fraction of the haze to remove, \f$ \omega \f$. 
+     *                    Values below \f$ 1 \f$ keep some haze for the perception of depth.
+     */
+    void Dehazing::setOmega (float _omega)
+    {
+        omega = _omega;
+        transmission.setArg (3, omega);
+    }
+
+
+    /*! \return The lower bound of the transmission, \f$ t_0 \f$.
+     */
+    float Dehazing::getMinTransmission ()
+    {
+        return t0;
+    }
+
+
+    /*! \details Updates the kernel argument for \f$ t_0 \f$.
+     *
+     *  \param[in] _t0 lower bound of the transmission, \f$ t_0 \f$. 
+     *                 It limits the amplification of the noise in dense haze.
+     */
+    void Dehazing::setMinTransmission (float _t0)
+    {
+        t0 = _t0;
+        recover.setArg (4, t0);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    GuidedFilter3D::GuidedFilter3D (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("GuidedFilter3D"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        mean_I  (env, info.getCLEnvInfo (0)), mean_p  (env, info.getCLEnvInfo (1)), 
+        corr_I  (env, info.getCLEnvInfo (0)), corr_Ip (env, info.getCLEnvInfo (1)), 
+        mean_a  (env, info.getCLEnvInfo (0)), mean_b  (env, info.getCLEnvInfo (1)), 
+        mult_II (env, info.getCLEnvInfo (0)), mult_Ip (env, info.getCLEnvInfo (1)), 
+        var (env.getProgram (info.pgIdx), "gf_var_Ip"), 
+        ab (env.getProgram (info.pgIdx), "gf_ab_Ip"), 
+        q (env.getProgram (info.pgIdx), "gf_q"), 
+        waitListVar (1), waitListMB (1), waitListQ (1)
+    {
+        mean_I.counters.setParent (counters);
+        mean_p.counters.setParent (counters);
+        corr_I.counters.setParent (counters);
+        corr_Ip.counters.setParent (counters);
+        mean_a.counters.setParent (counters);
+        mean_b.counters.setParent (counters);
+        mult_II.counters.setParent (counters);
+        mult_Ip.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedFilter3D::get (GuidedFilter3D::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedFilter3D::Memory::H_IN_I:
+                return hBufferInI;
+            case GuidedFilter3D::Memory::H_IN_P:
+                return hBufferInP;
+            case GuidedFilter3D::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedFilter3D::Memory::D_IN_I:
+                return dBufferInI;
+            case GuidedFilter3D::Memory::D_IN_P:
+                return dBufferInP;
+            case GuidedFilter3D::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *  \note In the `CAUSAL` case, the windows span the last \f$ depth \f$ frames, 
+     *        and `_radiusZ` is not used.
+     *        
+     *  \param[in] _width width of the slices (frames).
+     *  \param[in] _height height of the slices (frames).
+     *  \param[in] _depth number of slices in the volumes (`CENTERED`), or 
+     *                    number of frames in the windows (`CAUSAL`).
+     *  \param[in] _radius radius of the window in a slice.
+     *  \param[in] _radiusZ radius of the window across the slices.
+     *  \param[in] _eps regularization parameter of the algorithm.
+     *  \param[in] _window kind of window across the slices.
+     *  \param[in] _boxScaling factor by which the `BoxFilterSAT3D` scales the elements before processing.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedFilter3D::init (unsigned int _width, unsigned int _height, unsigned int _depth, 
+                               int _radius, int _radiusZ, float _eps, Window3D _window, 
+                               float _boxScaling, Staging _staging)
+    {
+        width = _width; height = _height; depth = _depth;
+        radius = _radius; radiusZ = _radiusZ; eps = _eps;
+        window = _window;
+        boxScaling = _boxScaling;
+        staging = _staging;
+
+        unsigned int slices = (window == Window3D::CENTERED) ? depth : 1;
+        bufferSize = width * height * slices * sizeof (cl_float);
+
+        try
+        {
+            if ((width == 0) || (height == 0) || (depth == 0))
+                throw "The volume cannot have zeroed dimensions";
+
+            if ((width % 4) || (height % 4))
+                throw "The width and height of the slices have to be multiples of 4";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilter3D]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrInI = nullptr;
+                hPtrInP = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferInI () == nullptr)
+                    hBufferInI = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferInP () == nullptr)
+                    hBufferInP = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrInI = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                hPtrInP = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferInI, hPtrInI);
+                queue0.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) { hPtrInI = nullptr; hPtrInP = nullptr; }
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferInI () == nullptr)
+            dBufferInI = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferInP () == nullptr)
+            dBufferInP = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        mean_I.get (BoxFilterSAT3D::Memory::D_IN) = dBufferInI;
+        mean_I.get (BoxFilterSAT3D::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_I.init (width, height, depth, radius, radiusZ, window, boxScaling, Staging::NONE);
+
+        mean_p.get (BoxFilterSAT3D::Memory::D_IN) = dBufferInP;
+        mean_p.get (BoxFilterSAT3D::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_p.init (width, height, depth, radius, radiusZ, window, boxScaling, Staging::NONE);
+
+        mult_II.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
+        mult_II.get (Math::Mult::Memory::D_IN_B) = dBufferInI;
+        mult_II.get (Math::Mult::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mult_II.init (width, height * slices, Staging::NONE);
+
+        mult_Ip.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
+        mult_Ip.get (Math::Mult::Memory::D_IN_B) = dBufferInP;
+        mult_Ip.get (Math::Mult::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mult_Ip.init (width, height * slices, Staging::NONE);
+
+        corr_I.get (BoxFilterSAT3D::Memory::D_IN) = mult_II.get (Math::Mult::Memory::D_OUT);
+        corr_I.get (BoxFilterSAT3D::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        corr_I.init (width, height, depth, radius, radiusZ, window, boxScaling, Staging::NONE);
+
+        corr_Ip.get (BoxFilterSAT3D::Memory::D_IN) = mult_Ip.get (Math::Mult::Memory::D_OUT);
+        corr_Ip.get (BoxFilterSAT3D::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        corr_Ip.init (width, height, depth, radius, radiusZ, window, boxScaling, Staging::NONE);
+
+        dBufferVarI = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferCovIp = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        var.setArg (0, corr_I.get (BoxFilterSAT3D::Memory::D_OUT));
+        var.setArg (1, corr_Ip.get (BoxFilterSAT3D::Memory::D_OUT));
+        var.setArg (2, mean_I.get (BoxFilterSAT3D::Memory::D_OUT));
+        var.setArg (3, mean_p.get (BoxFilterSAT3D::Memory::D_OUT));
+        var.setArg (4, dBufferVarI);
+        var.setArg (5, dBufferCovIp);
+
+        dBufferA = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferB = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        ab.setArg (0, dBufferVarI);
+        ab.setArg (1, dBufferCovIp);
+        ab.setArg (2, mean_I.get (BoxFilterSAT3D::Memory::D_OUT));
+        ab.setArg (3, mean_p.get (BoxFilterSAT3D::Memory::D_OUT));
+        ab.setArg (4, dBufferA);
+        ab.setArg (5, dBufferB);
+        ab.setArg (6, eps);
+
+        mean_a.get (BoxFilterSAT3D::Memory::D_IN) = dBufferA;
+        mean_a.get (BoxFilterSAT3D::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_a.init (width, height, depth, radius, radiusZ, window, boxScaling, Staging::NONE);
+
+        mean_b.get (BoxFilterSAT3D::Memory::D_IN) = dBufferB;
+        mean_b.get (BoxFilterSAT3D::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_b.init (width, height, depth, radius, radiusZ, window, boxScaling, Staging::NONE);
+
+        q.setArg (0, dBufferInI);
+        q.setArg (1, mean_a.get (BoxFilterSAT3D::Memory::D_OUT));
+        q.setArg (2, mean_b.get (BoxFilterSAT3D::Memory::D_OUT));
+        q.setArg (3, dBufferOut);
+        q.setArg (4, 0);
+        q.setArg (5, 1.f);
+
+        // Set workspaces (common to all own kernels: var, ab, q)
+        global = cl::NDRange (width * height * slices / 4);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void GuidedFilter3D::write (GuidedFilter3D::Memory mem, void *ptr, bool block, 
+                                const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            size_t n = bufferSize / sizeof (cl_float);
+            switch (mem)
+            {
+                case GuidedFilter3D::Memory::D_IN_I:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + n, hPtrInI);
+                    queue0.enqueueWriteBuffer (dBufferInI, block, 0, bufferSize, hPtrInI, events, event);
+                    break;
+                case GuidedFilter3D::Memory::D_IN_P:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + n, hPtrInP);
+                    queue0.enqueueWriteBuffer (dBufferInP, block, 0, bufferSize, hPtrInP, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* GuidedFilter3D::read (GuidedFilter3D::Memory mem, bool block, 
+                                const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilter3D::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details In the `CAUSAL` case, every call filters the frames in `D_IN_I` and `D_IN_P`, 
+     *           and pushes them in the rings.
+     *  \note The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilter3D::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+
+        //* The queues are in order, so the last event of the second queue covers its branches
+        mean_I.run (events);
+        mult_II.run (events);
+        corr_I.run ();
+        mean_p.run (events);
+        mult_Ip.run (events);
+        corr_Ip.run (nullptr, &corrIpEvent); waitListVar[0] = corrIpEvent;
+
+        queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, &waitListVar);
+        queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange, nullptr, &abEvent);
+        mean_a.run ();
+        waitListMB[0] = abEvent;
+        mean_b.run (&waitListMB, &mbEvent); waitListQ[0] = mbEvent;
+        queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, &waitListQ, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedFilter3D::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<CommandGraph::Node> depsVar (1), depsMB (1), depsQ (1);
+        mean_I.record (graph, deps);
+        mult_II.record (graph, deps);
+        corr_I.record (graph);
+        mean_p.record (graph, deps);
+        mult_Ip.record (graph, deps);
+        corr_Ip.record (graph, nullptr, &depsVar[0]);
+
+        graph.add (queue0, var, cl::NullRange, global, cl::NullRange, &depsVar);
+        graph.add (queue0, ab, cl::NullRange, global, cl::NullRange, nullptr, &depsMB[0]);
+        mean_a.record (graph);
+        mean_b.record (graph, &depsMB, &depsQ[0]);
+        graph.add (queue0, q, cl::NullRange, global, cl::NullRange, &depsQ, node);
+    }
+
+
+    /*! \details Empties the rings of frames, so the next frame starts a new stream. 
+     *           The call is blocking. It has no effect in the `CENTERED` case.
+     */
+    void GuidedFilter3D::reset ()
+    {
+        mean_I.reset (); mean_p.reset ();
+        corr_I.reset (); corr_Ip.reset ();
+        mean_a.reset (); mean_b.reset ();
+    }
+
+
+    /*! \return The kind of window across the slices.
+     */
+    Window3D GuidedFilter3D::getWindow ()
+    {
+        return window;
+    }
+
+
+    /*! \return The radius of the window in a slice.
+     */
+    int GuidedFilter3D::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the radius of the windows of all the `BoxFilterSAT3D` instances.
+     *
+     *  \param[in] _radius radius of the window in a slice.
+     */
+    void GuidedFilter3D::setRadius (int _radius)
+    {
+        radius = _radius;
+        mean_I.setRadius (radius); mean_p.setRadius (radius);
+        corr_I.setRadius (radius); corr_Ip.setRadius (radius);
+        mean_a.setRadius (radius); mean_b.setRadius (radius);
+    }
+
+
+    /*! \return The radius of the window across the slices.
+     */
+    int GuidedFilter3D::getRadiusZ ()
+    {
+        return radiusZ;
+    }
+
+
+    /*! \details Updates the radius of the windows of all the `BoxFilterSAT3D` instances.
+     *
+     *  \param[in] _radiusZ radius of the window across the slices.
+     */
+    void GuidedFilter3D::setRadiusZ (int _radiusZ)
+    {
+        radiusZ = _radiusZ;
+        mean_I.setRadiusZ (radiusZ); mean_p.setRadiusZ (radiusZ);
+        corr_I.setRadiusZ (radiusZ); corr_Ip.setRadiusZ (radiusZ);
+        mean_a.setRadiusZ (radiusZ); mean_b.setRadiusZ (radiusZ);
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedFilter3D::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedFilter3D::setEps (float _eps)
+    {
+        eps = _eps;
+        ab.setArg (6, eps);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     */
+    GuidedFilterShared::GuidedFilterShared (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("GuidedFilterShared"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        mean_I (env, info.getCLEnvInfo (0)), corr_I (env, info.getCLEnvInfo (0)), 
+        mean_a (env, info.getCLEnvInfo (0)), mean_b (env, info.getCLEnvInfo (0)), 
+        mult_II (env, info.getCLEnvInfo (0)), 
+        var (env.getProgram (info.pgIdx), "gf_var_I")
+    {
+        mean_I.counters.setParent (counters);
+        corr_I.counters.setParent (counters);
+        mean_a.counters.setParent (counters);
+        mean_b.counters.setParent (counters);
+        mult_II.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *  \note For `D_IN_P` and `D_OUT`, the placeholders of channels 
+     *        beyond the current ones are created on demand.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \param[in] channel channel of the requested memory object (only for `D_IN_P` and `D_OUT`).
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedFilterShared::get (GuidedFilterShared::Memory mem, unsigned int channel)
+    {
+        switch (mem)
+        {
+            case GuidedFilterShared::Memory::H_IN_I:
+                return hBufferInI;
+            case GuidedFilterShared::Memory::H_IN_P:
+                return hBufferInP;
+            case GuidedFilterShared::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedFilterShared::Memory::D_IN_I:
+                return dBufferInI;
+            case GuidedFilterShared::Memory::D_IN_P:
+                if (channel >= dBufferInP.size ()) dBufferInP.resize (channel + 1);
+                return dBufferInP[channel];
+            case GuidedFilterShared::Memory::D_OUT:
+                if (channel >= dBufferOut.size ()) dBufferOut.resize (channel + 1);
+                return dBufferOut[channel];
+            case GuidedFilterShared::Memory::D_MEAN_I:
+                return dBufferMeanI;
+            case GuidedFilterShared::Memory::D_VAR_I:
+                return dBufferVarI;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the images.
+     *  \param[in] _height height of the images.
+     *  \param[in] _channels number of inputs \f$ p \f$ filtered with the guide.
+     *  \param[in] _radius radius of the square filter window.
+     *  \param[in] _eps regularization parameter of the algorithm.
+     *  \param[in] _boxScaling factor by which the `BoxFilterSAT` scales the elements before processing.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedFilterShared::init (unsigned int _width, unsigned int _height, unsigned int _channels, 
+                                   int _radius, float _eps, float _boxScaling, Staging _staging)
+    {
+        width = _width; height = _height;
+        radius = _radius; eps = _eps;
+        boxScaling = _boxScaling;
+        bufferSize = width * height * sizeof (cl_float);
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            if ((width % 4) || (height % 4))
+                throw "The width and height of the images have to be multiples of 4";
+
+            if (_channels == 0)
+                throw "There has to be at least one channel";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterShared]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrInI = nullptr;
+                hPtrInP = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferInI () == nullptr)
+                    hBufferInI = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                if (hBufferInP () == nullptr)
+                    hBufferInP = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, _channels * bufferSize);
+
+                hPtrInI = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInI, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                hPtrInP = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferInP, CL_FALSE, CL_MAP_WRITE, 0, _channels * bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferInI, hPtrInI);
+                queue0.enqueueUnmapMemObject (hBufferInP, hPtrInP);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, _channels * bufferSize);
+
+                hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, _channels * bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) { hPtrInI = nullptr; hPtrInP = nullptr; }
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferInI () == nullptr)
+            dBufferInI = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferMeanI () == nullptr)
+            dBufferMeanI = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        if (dBufferVarI () == nullptr)
+            dBufferVarI = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferInP.resize (_channels);
+        dBufferOut.resize (_channels);
+        for (unsigned int c = 0; c < _channels; ++c)
+        {
+            if (dBufferInP[c] () == nullptr)
+                dBufferInP[c] = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+            if (dBufferOut[c] () == nullptr)
+                dBufferOut[c] = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+        }
+
+        // Set up the guide statistics
+        mean_I.get (BoxFilterSAT::Memory::D_IN) = dBufferInI;
+        mean_I.get (BoxFilterSAT::Memory::D_OUT) = dBufferMeanI;
+        mean_I.init (width, height, radius, boxScaling, Staging::NONE);
+
+        mult_II.get (Math::Mult::Memory::D_IN_A) = dBufferInI;
+        mult_II.get (Math::Mult::Memory::D_IN_B) = dBufferInI;
+        mult_II.get (Math::Mult::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mult_II.init (width, height, Staging::NONE);
+
+        corr_I.get (BoxFilterSAT::Memory::D_IN) = mult_II.get (Math::Mult::Memory::D_OUT);
+        corr_I.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        corr_I.init (width, height, radius, boxScaling, Staging::NONE);
+
+        var.setArg (0, corr_I.get (BoxFilterSAT::Memory::D_OUT));
+        var.setArg (1, dBufferMeanI);
+        var.setArg (2, dBufferVarI);
+        var.setArg (3, eps);
+
+        //* The coefficients and their means are shared by the channels, 
+        //* since they are computed in order on the first command queue
+        dBufferA = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        dBufferB = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+
+        mean_a.get (BoxFilterSAT::Memory::D_IN) = dBufferA;
+        mean_a.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_a.init (width, height, radius, boxScaling, Staging::NONE);
+
+        mean_b.get (BoxFilterSAT::Memory::D_IN) = dBufferB;
+        mean_b.get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+        mean_b.init (width, height, radius, boxScaling, Staging::NONE);
+
+        // Set up the channels
+        channels.clear ();
+        channels.resize (_channels);
+        for (unsigned int c = 0; c < _channels; ++c)
+        {
+            Channel &channel = channels[c];
+            channel.mult_Ip.reset (new Math::Mult (env, info.getCLEnvInfo (1)));
+            channel.mean_p.reset (new BoxFilterSAT (env, info.getCLEnvInfo (1)));
+            channel.corr_Ip.reset (new BoxFilterSAT (env, info.getCLEnvInfo (1)));
+            channel.mult_Ip->counters.setParent (counters);
+            channel.mean_p->counters.setParent (counters);
+            channel.corr_Ip->counters.setParent (counters);
+
+            channel.mean_p->get (BoxFilterSAT::Memory::D_IN) = dBufferInP[c];
+            channel.mean_p->get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            channel.mean_p->init (width, height, radius, boxScaling, Staging::NONE);
+
+            channel.mult_Ip->get (Math::Mult::Memory::D_IN_A) = dBufferInI;
+            channel.mult_Ip->get (Math::Mult::Memory::D_IN_B) = dBufferInP[c];
+            channel.mult_Ip->get (Math::Mult::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            channel.mult_Ip->init (width, height, Staging::NONE);
+
+            channel.corr_Ip->get (BoxFilterSAT::Memory::D_IN) = channel.mult_Ip->get (Math::Mult::Memory::D_OUT);
+            channel.corr_Ip->get (BoxFilterSAT::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferSize);
+            channel.corr_Ip->init (width, height, radius, boxScaling, Staging::NONE);
+
+            channel.ab = cl::Kernel (env.getProgram (info.pgIdx), "gf_ab_shared");
+            channel.ab.setArg (0, dBufferVarI);
+            channel.ab.setArg (1, channel.corr_Ip->get (BoxFilterSAT::Memory::D_OUT));
+            channel.ab.setArg (2, dBufferMeanI);
+            channel.ab.setArg (3, channel.mean_p->get (BoxFilterSAT::Memory::D_OUT));
+            channel.ab.setArg (4, dBufferA);
+            channel.ab.setArg (5, dBufferB);
+
+            channel.q = cl::Kernel (env.getProgram (info.pgIdx), "gf_q");
+            channel.q.setArg (0, dBufferInI);
+            channel.q.setArg (1, mean_a.get (BoxFilterSAT::Memory::D_OUT));
+            channel.q.setArg (2, mean_b.get (BoxFilterSAT::Memory::D_OUT));
+            channel.q.setArg (3, dBufferOut[c]);
+            channel.q.setArg (4, 0);
+            channel.q.setArg (5, 1.f);
+
+            channel.waitListAB.resize (1);
+        }
+
+        // Set workspaces (common to all own kernels: var, ab, q)
+        global = cl::NDRange (width * height / 4);
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer. `D_IN_P` transfers 
+     *           all the planes, from consecutive regions of the staging buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the (last) write operation to the device buffer(s).
+     */
+    void GuidedFilterShared::write (GuidedFilterShared::Memory mem, void *ptr, bool block, 
+                                    const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            size_t n = width * height;
+            switch (mem)
+            {
+                case GuidedFilterShared::Memory::D_IN_I:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + n, hPtrInI);
+                    queue0.enqueueWriteBuffer (dBufferInI, block, 0, bufferSize, hPtrInI, events, event);
+                    break;
+                case GuidedFilterShared::Memory::D_IN_P:
+                    if (ptr != nullptr)
+                        std::copy ((cl_float *) ptr, (cl_float *) ptr + channels.size () * n, hPtrInP);
+                    for (size_t c = 0; c < channels.size (); ++c)
+                        queue0.enqueueWriteBuffer (dBufferInP[c], block, 0, bufferSize, hPtrInP + c * n, 
+                                                   events, (c + 1 == channels.size ()) ? event : nullptr);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host. `H_OUT` receives 
+     *           all the planes, in consecutive regions of the staging buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the (last) read operation to the staging buffer.
+     */
+    void* GuidedFilterShared::read (GuidedFilterShared::Memory mem, bool block, 
+                                    const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            size_t n = width * height;
+            switch (mem)
+            {
+                case GuidedFilterShared::Memory::H_OUT:
+                    for (size_t c = 0; c < channels.size (); ++c)
+                        queue0.enqueueReadBuffer (dBufferOut[c], block, 0, bufferSize, hPtrOut + c * n, 
+                                                  events, (c + 1 == channels.size ()) ? event : nullptr);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details Computes \f$ \bar{I} \f$ and \f$ \sigma_I^2+\epsilon \f$ on the first 
+     *           command queue. It has to be called after the guide is written, and 
+     *           again whenever the guide, the radius, or \f$ \epsilon \f$ change. 
+     *           The calls to `run` that follow (on the first command queue) see the 
+     *           statistics, since the command queues are in order.
+     *  \note The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilterShared::prepare (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        mean_I.run (events);
+        mult_II.run (events);
+        corr_I.run ();
+        queue0.enqueueNDRangeKernel (var, cl::NullRange, global, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \details Transfers \f$ \bar{I} \f$ and \f$ \sigma_I^2+\epsilon \f$ to `D_MEAN_I` 
+     *           and `D_VAR_I`, in place of `prepare`. The statistics have to be computed 
+     *           for the guide in `D_IN_I`, with the same radius and \f$ \epsilon \f$.
+     *  \note The transfers are handled by the first command queue, directly 
+     *        from `mean` and `var`. For a non-blocking operation, the arrays 
+     *        have to stay valid until the transfers complete.
+     *
+     *  \param[in] mean array of average \f$ I \f$ values, \f$ \bar{I} \f$.
+     *  \param[in] var array of regularized variance values of the guide, \f$ \sigma_I^2+\epsilon \f$.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last write operation.
+     */
+    void GuidedFilterShared::writeStatistics (const cl_float *mean, const cl_float *var, bool block, 
+                                              const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        queue0.enqueueWriteBuffer (dBufferMeanI, block, 0, bufferSize, mean, events);
+        queue0.enqueueWriteBuffer (dBufferVarI, block, 0, bufferSize, var, events, event);
+    }
+
+
+    /*! \details Transfers \f$ \bar{I} \f$ and \f$ \sigma_I^2+\epsilon \f$ from `D_MEAN_I` 
+     *           and `D_VAR_I`, e.g. after `prepare`, in order to keep them for later.
+     *  \note The transfers are handled by the first command queue, directly to `mean` and `var`.
+     *
+     *  \param[out] mean array of average \f$ I \f$ values, \f$ \bar{I} \f$.
+     *  \param[out] var array of regularized variance values of the guide, \f$ \sigma_I^2+\epsilon \f$.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last read operation.
+     */
+    void GuidedFilterShared::readStatistics (cl_float *mean, cl_float *var, bool block, 
+                                             const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        queue0.enqueueReadBuffer (dBufferMeanI, block, 0, bufferSize, mean, events);
+        queue0.enqueueReadBuffer (dBufferVarI, block, 0, bufferSize, var, events, event);
+    }
+
+
+    /*! \details The means \f$ \bar{p} \f$, \f$ \overline{Ip} \f$ of all the channels are 
+     *           computed on the second command queue. Meanwhile, the first command queue 
+     *           computes the coefficients, their means, and the output of every channel, 
+     *           as soon as the means of the channel are available.
+     *  \note The second command queue reads `D_IN_I`. If the guide was written on 
+     *        the first command queue, then `events` has to include that write 
+     *        (or the write has to be blocking).
+     *  \note The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilterShared::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+
+        //* The second queue is in order, so only the first channel waits for the events
+        for (size_t c = 0; c < channels.size (); ++c)
+        {
+            Channel &channel = channels[c];
+            channel.mult_Ip->run ((c == 0) ? events : nullptr);
+            channel.mean_p->run ((c == 0) ? events : nullptr);
+            channel.corr_Ip->run (nullptr, &channel.corrIpEvent);
+            channel.waitListAB[0] = channel.corrIpEvent;
+        }
+
+        for (size_t c = 0; c < channels.size (); ++c)
+        {
+            Channel &channel = channels[c];
+            queue0.enqueueNDRangeKernel (channel.ab, cl::NullRange, global, cl::NullRange, &channel.waitListAB);
+            mean_a.run ();
+            mean_b.run ();
+            queue0.enqueueNDRangeKernel (channel.q, cl::NullRange, global, cl::NullRange, nullptr, 
+                                         (c + 1 == channels.size ()) ? event : nullptr);
+        }
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them. The guide 
+     *           statistics are not part of the graph, since they are computed 
+     *           only once per guide, with `prepare`.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedFilterShared::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<std::vector<CommandGraph::Node>> depsAB (channels.size (), std::vector<CommandGraph::Node> (1));
+
+        for (size_t c = 0; c < channels.size (); ++c)
+        {
+            Channel &channel = channels[c];
+            channel.mult_Ip->record (graph, (c == 0) ? deps : nullptr);
+            channel.mean_p->record (graph, (c == 0) ? deps : nullptr);
+            channel.corr_Ip->record (graph, nullptr, &depsAB[c][0]);
+        }
+
+        for (size_t c = 0; c < channels.size (); ++c)
+        {
+            Channel &channel = channels[c];
+            graph.add (queue0, channel.ab, cl::NullRange, global, cl::NullRange, &depsAB[c]);
+            mean_a.record (graph);
+            mean_b.record (graph);
+            graph.add (queue0, channel.q, cl::NullRange, global, cl::NullRange, nullptr, 
+                       (c + 1 == channels.size ()) ? node : nullptr);
+        }
+    }
+
+
+    /*! \return The number of channels.
+     */
+    unsigned int GuidedFilterShared::getChannels ()
+    {
+        return channels.size ();
+    }
+
+
+    /*! \return The radius of the filter window.
+     */
+    int GuidedFilterShared::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the radius of the windows of all the `BoxFilterSAT` instances.
+     *  \note The guide statistics have to be prepared again.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void GuidedFilterShared::setRadius (int _radius)
+    {
+        radius = _radius;
+        mean_I.setRadius (radius); corr_I.setRadius (radius);
+        mean_a.setRadius (radius); mean_b.setRadius (radius);
+        for (Channel &channel : channels)
+        {
+            channel.mean_p->setRadius (radius);
+            channel.corr_Ip->setRadius (radius);
+        }
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedFilterShared::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+     *  \note The guide statistics have to be prepared again.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedFilterShared::setEps (float _eps)
+    {
+        eps = _eps;
+        var.setArg (3, eps);
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *                   The class requires **two** `(2)` **command queues** (on the same device).
+     *                   The program has to contain the `imageSupport` kernels.
+     */
+    GuidedFilterYUV::GuidedFilterYUV (clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+        counters ("GuidedFilterYUV"), env (_env), info (_info), 
+        context (env.getContext (info.pIdx)), 
+        queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+        gfY (env, info), gfU (env, info), gfV (env, info), 
+        lumaIn (env.getProgram (info.pgIdx), "yuvLuma_Uchar2Float"), 
+        lumaOut (env.getProgram (info.pgIdx), "yuvLuma_Float2Uchar"), 
+        copy (env.getProgram (info.pgIdx), "copyUchar4"), 
+        chromaIn (env.getProgram (info.pgIdx), "yuvChroma_Uchar2Float"), 
+        chromaOut (env.getProgram (info.pgIdx), "yuvChroma_Float2Uchar"), 
+        waitListL (1), waitListC (1)
+    {
+        gfY.counters.setParent (counters);
+        gfU.counters.setParent (counters);
+        gfV.counters.setParent (counters);
+    }
+
+
+    /*! \details This interface exists to allow CL memory sharing between different kernels.
+     *
+     *  \param[in] mem enumeration value specifying the requested memory object.
+     *  \return A reference to the requested memory object.
+     */
+    cl::Memory& GuidedFilterYUV::get (GuidedFilterYUV::Memory mem)
+    {
+        switch (mem)
+        {
+            case GuidedFilterYUV::Memory::H_IN:
+                return hBufferIn;
+            case GuidedFilterYUV::Memory::H_OUT:
+                return hBufferOut;
+            case GuidedFilterYUV::Memory::D_IN:
+                return dBufferIn;
+            case GuidedFilterYUV::Memory::D_Y:
+                return dBufferY;
+            case GuidedFilterYUV::Memory::D_OUT:
+                return dBufferOut;
+        }
+    }
+
+
+    /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+     *  \note If you have assigned a memory object to one member variable of the class 
+     *        before the call to `init`, then that memory will be maintained. Otherwise, 
+     *        a new memory object will be created.
+     *        
+     *  \param[in] _width width of the image (and of the luma plane).
+     *  \param[in] _height height of the image (and of the luma plane).
+     *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+     *                     The chroma planes are filtered with a radius of \f$ max (radius / 2, 1) \f$.
+     *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] _layout layout of the input (and output) image.
+     *  \param[in] _filterChroma flag to indicate whether to filter the chroma planes 
+     *                           too, or pass them through unchanged.
+     *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+     */
+    void GuidedFilterYUV::init (unsigned int _width, unsigned int _height, int _radius, float _eps, 
+                                YUVLayout _layout, bool _filterChroma, Staging _staging)
+    {
+        graph.clear ();
+        width = _width; height = _height; radius = _radius; eps = _eps;
+        layout = _layout;
+        filterChroma = _filterChroma;
+        staging = _staging;
+
+        try
+        {
+            if ((width == 0) || (height == 0))
+                throw "The image cannot have zeroed dimensions";
+
+            if ((width % 2 != 0) || (height % 2 != 0) || ((width * height) % 16 != 0))
+                throw "The image dimensions have to be even, and the number of pixels a multiple of 16";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[GuidedFilterYUV]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+
+        unsigned int cWidth = width / 2, cHeight = height / 2;
+        bufferSize = 3 * width * height / 2 * sizeof (cl_uchar);
+        bufferLumaSize = width * height * sizeof (cl_float);
+        bufferChromaSize = cWidth * cHeight * sizeof (cl_float);
+
+        // Set workspaces
+        globalLuma = cl::NDRange (width * height / 4);
+        offsetChroma = cl::NDRange (width * height / 4);
+        globalChroma = cl::NDRange (width * height / 8);
+        globalChroma2D = cl::NDRange (cWidth, cHeight);
+
+        // Create staging buffers
+        bool io = false;
+        switch (staging)
+        {
+            case Staging::NONE:
+                hPtrIn = nullptr;
+                hPtrOut = nullptr;
+                break;
+
+            case Staging::IO:
+                io = true;
+
+            case Staging::I:
+                if (hBufferIn () == nullptr)
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrIn = (cl_uchar *) queue0.enqueueMapBuffer (
+                    hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                if (!io)
+                {
+                    queue0.finish ();
+                    hPtrOut = nullptr;
+                    break;
+                }
+
+            case Staging::O:
+                if (hBufferOut () == nullptr)
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+
+                hPtrOut = (cl_uchar *) queue0.enqueueMapBuffer (
+                    hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
+                queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                queue0.finish ();
+
+                if (!io) hPtrIn = nullptr;
+                break;
+        }
+        
+        // Create device buffers
+        if (dBufferIn () == nullptr)
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
+        if (dBufferY () == nullptr)
+            dBufferY = counters.allocate (context, CL_MEM_READ_WRITE, bufferLumaSize);
+        if (dBufferOut () == nullptr)
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
+
+        // Luma pipeline
+        gfY.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+            counters.allocate (context, CL_MEM_READ_WRITE, bufferLumaSize);
+        gfY.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferY;
+        gfY.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+
+        lumaIn.setArg (0, dBufferIn);
+        lumaIn.setArg (1, gfY.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN));
+
+        lumaOut.setArg (0, dBufferY);
+        lumaOut.setArg (1, dBufferOut);
+
+        copy.setArg (0, dBufferIn);
+        copy.setArg (1, dBufferOut);
+
+        // Chroma pipeline
+        if (filterChroma)
+        {
+            typedef GuidedFilter<GuidedFilterConfig::I_NEQ_P> GF;
+
+            // The guide is shared by the two chroma filters
+            cl::Buffer dBufferGuide = counters.allocate (context, CL_MEM_READ_WRITE, bufferChromaSize);
+            for (GF *gf : { &gfU, &gfV })
+            {
+                gf->get (GF::Memory::D_IN_I) = dBufferGuide;
+                gf->get (GF::Memory::D_IN_P) = counters.allocate (context, CL_MEM_READ_WRITE, bufferChromaSize);
+                gf->get (GF::Memory::D_OUT) = counters.allocate (context, CL_MEM_READ_WRITE, bufferChromaSize);
+                gf->init (cWidth, cHeight, chromaRadius (radius), eps, 0, 1e-4f, Staging::NONE);
+            }
+
+            chromaIn.setArg (0, dBufferIn);
+            chromaIn.setArg (1, gfU.get (GF::Memory::D_IN_I));
+            chromaIn.setArg (2, gfU.get (GF::Memory::D_IN_P));
+            chromaIn.setArg (3, gfV.get (GF::Memory::D_IN_P));
+            chromaIn.setArg (4, (cl_int) (layout == YUVLayout::NV12));
+
+            chromaOut.setArg (0, gfU.get (GF::Memory::D_OUT));
+            chromaOut.setArg (1, gfV.get (GF::Memory::D_OUT));
+            chromaOut.setArg (2, dBufferOut);
+            chromaOut.setArg (3, (cl_int) (layout == YUVLayout::NV12));
+        }
+    }
+
+
+    /*! \details The transfer happens from a staging buffer on the host to the 
+     *           associated (specified) device buffer.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an input device buffer.
+     *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+     *                 data from `ptr` will be copied to the associated staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the write operation to the device buffer.
+     */
+    void GuidedFilterYUV::write (GuidedFilterYUV::Memory mem, void *ptr, bool block, 
+                                 const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::I || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilterYUV::Memory::D_IN:
+                    if (ptr != nullptr)
+                        std::copy ((cl_uchar *) ptr, (cl_uchar *) ptr + bufferSize, hPtrIn);
+                    queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferSize, hPtrIn, events, event);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    /*! \details The transfer happens from a device buffer to the associated 
+     *           (specified) staging buffer on the host.
+     *  \note The transfer is handled by the first command queue.
+     *  
+     *  \param[in] mem enumeration value specifying an output staging buffer.
+     *  \param[in] block a flag to indicate whether to perform a blocking 
+     *                   or a non-blocking operation.
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the read operation to the staging buffer.
+     */
+    void* GuidedFilterYUV::read (GuidedFilterYUV::Memory mem, bool block, 
+                                 const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (staging == Staging::O || staging == Staging::IO)
+        {
+            switch (mem)
+            {
+                case GuidedFilterYUV::Memory::H_OUT:
+                    queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferSize, hPtrOut, events, event);
+                    return hPtrOut;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    /*! \details The chroma planes are handled first, so that the last command, 
+     *           which completes after all the others, is on the luma plane.
+     *           The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the kernel execution.
+     */
+    void GuidedFilterYUV::run (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (filterChroma)
+        {
+            queue0.enqueueNDRangeKernel (chromaIn, cl::NullRange, globalChroma2D, cl::NullRange, events, &cEvent);
+            waitListC[0] = cEvent;
+            gfU.run (&waitListC);
+            gfV.run (&waitListC);
+            queue0.enqueueNDRangeKernel (chromaOut, cl::NullRange, globalChroma2D, cl::NullRange);
+        }
+        else
+            queue0.enqueueNDRangeKernel (copy, offsetChroma, globalChroma, cl::NullRange, events);
+
+        queue0.enqueueNDRangeKernel (lumaIn, cl::NullRange, globalLuma, cl::NullRange, events, &lEvent);
+        waitListL[0] = lEvent;
+        gfY.run (&waitListL);
+        queue0.enqueueNDRangeKernel (lumaOut, cl::NullRange, globalLuma, cl::NullRange, nullptr, event);
+    }
+
+
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void GuidedFilterYUV::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        std::vector<CommandGraph::Node> depsC (1), depsL (1);
+        if (filterChroma)
+        {
+            graph.add (queue0, chromaIn, cl::NullRange, globalChroma2D, cl::NullRange, deps, &depsC[0]);
+            gfU.record (graph, &depsC);
+            gfV.record (graph, &depsC);
+            graph.add (queue0, chromaOut, cl::NullRange, globalChroma2D, cl::NullRange);
+        }
+        else
+            graph.add (queue0, copy, offsetChroma, globalChroma, cl::NullRange, deps);
+
+        graph.add (queue0, lumaIn, cl::NullRange, globalLuma, cl::NullRange, deps, &depsL[0]);
+        gfY.record (graph, &depsL);
+        graph.add (queue0, lumaOut, cl::NullRange, globalLuma, cl::NullRange, nullptr, node);
+    }
+
+
+    /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+     *           for replay. It's called by `replay` when there is no recording, and the 
+     *           recording is dropped whenever a parameter changes.
+     */
+    void GuidedFilterYUV::capture ()
+    {
+        graph.clear ();
+        record (graph);
+        graph.finalize ();
+    }
+
+
+    /*! \details Executes the same kernels as `run`, with less host overhead. 
+     *           The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last kernel execution.
+     */
+    void GuidedFilterYUV::replay (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        Counters::Frame frame (counters, event);
+        if (graph.empty ()) capture ();
+        counters.add (Counters::Counter::KERNELS, graph.size ());
+        graph.replay (events, event);
+    }
+
+
+    /*! \return The radius of the square filter window.
+     */
+    int GuidedFilterYUV::getRadius ()
+    {
+        return radius;
+    }
+
+
+    /*! \details Updates the kernel argument for the filter window radius.
+     *
+     *  \param[in] _radius radius of the square filter window.
+     */
+    void GuidedFilterYUV::setRadius (int _radius)
+    {
+        graph.clear ();
+        radius = _radius;
+        gfY.setRadius (radius);
+        if (filterChroma)
+        {
+            gfU.setRadius (chromaRadius (radius));
+            gfV.setRadius (chromaRadius (radius));
+        }
+    }
+
+
+    /*! \return The regularization parameter \f$\epsilon\f$.
+     */
+    float GuidedFilterYUV::getEps ()
+    {
+        return eps;
+    }
+
+
+    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+     *
+     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+     */
+    void GuidedFilterYUV::setEps (float _eps)
+    {
+        graph.clear ();
+        eps = _eps;
+        gfY.setEps (eps);
+        if (filterChroma)
+        {
+            gfU.setEps (eps);
+            gfV.setEps (eps);
+        }
+    }
+
+
+    /*! \param[in] _radius radius of the square filter window (in luma pixels).
+     *  \return The radius of the square filter window at the chroma resolution.
+     */
+    int GuidedFilterYUV::chromaRadius (int _radius)
+    {
+        return std::max (_radius / 2, 1);
+    }
+
+
+    namespace Kinect
+    {
+
+        /*! \param[in] _env opencl environment.
+         *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+         *                   The class requires **two** `(2)` **command queues** (on the same device).
+         */
+        GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::GuidedFilterRGB (
+            clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+            counters ("GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>"), env (_env), info (_info), 
+            context (env.getContext (info.pIdx)), 
+            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+            sRGB  (env, info.getCLEnvInfo (0)), 
+            gfR (env, info), gfG (env, info), gfB (env, info), 
+            waitList (1)
+        {
+            sRGB.counters.setParent (counters);
+            gfR.counters.setParent (counters);
+            gfG.counters.setParent (counters);
+            gfB.counters.setParent (counters);
+        }
+
+
+        /*! \details This interface exists to allow CL memory sharing between different kernels.
+         *
+         *  \param[in] mem enumeration value specifying the requested memory object.
+         *  \return A reference to the requested memory object.
+         */
+        cl::Memory& GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::get (GuidedFilterRGB::Memory mem)
+        {
+            switch (mem)
+            {
+                case GuidedFilterRGB::Memory::H_IN:
+                    return hBufferIn;
+                case GuidedFilterRGB::Memory::H_OUT_R:
+                    return hBufferOutR;
+                case GuidedFilterRGB::Memory::H_OUT_G:
+                    return hBufferOutG;
+                case GuidedFilterRGB::Memory::H_OUT_B:
+                    return hBufferOutB;
+                case GuidedFilterRGB::Memory::D_INTR_R:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
+                case GuidedFilterRGB::Memory::D_INTR_G:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
+                case GuidedFilterRGB::Memory::D_INTR_B:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
+                case GuidedFilterRGB::Memory::D_IN:
+                    return dBufferIn;
+                case GuidedFilterRGB::Memory::D_OUT_R:
+                    return dBufferOutR;
+                case GuidedFilterRGB::Memory::D_OUT_G:
+                    return dBufferOutG;
+                case GuidedFilterRGB::Memory::D_OUT_B:
+                    return dBufferOutB;
+            }
+        }
+
+
+        /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+         *  \note If you have assigned a memory object to one member variable of the class 
+         *        before the call to `init`, then that memory will be maintained. Otherwise, 
+         *        a new memory object will be created.
+         *        
+         *  \param[in] _width width of the input array to be processed.
+         *  \param[in] _height height of the input array to be processed.
+         *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+         *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+         *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::init (
+            unsigned int _width, unsigned int _height, int _radius, float _eps, Staging _staging)
+        {
+            graph.clear ();
+            width = _width; height = _height; radius = _radius; eps = _eps;
+            bufferInSize = 3 * width * height * sizeof (cl_uchar);
+            bufferOutSize = width * height * sizeof (cl_float);
+            staging = _staging;
+
+            // Create staging buffers
+            bool io = false;
+            switch (staging)
+            {
+                case Staging::NONE:
+                    hPtrIn = nullptr;
+                    hPtrOutR = nullptr;
+                    hPtrOutG = nullptr;
+                    hPtrOutB = nullptr;
+                    break;
+
+                case Staging::IO:
+                    io = true;
+
+                case Staging::I:
+                    if (hBufferIn () == nullptr)
+                        hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+
+                    hPtrIn = (cl_uchar *) queue0.enqueueMapBuffer (
+                        hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                    queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                    if (!io)
+                    {
+                        queue0.finish ();
+                        hPtrOutR = nullptr;
+                        hPtrOutG = nullptr;
+                        hPtrOutB = nullptr;
+                        break;
+                    }
+
+                case Staging::O:
+                    if (hBufferOutR () == nullptr)
+                        hBufferOutR = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    if (hBufferOutG () == nullptr)
+                        hBufferOutG = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    if (hBufferOutB () == nullptr)
+                        hBufferOutB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+
+                    hPtrOutR = (cl_float *) queue0.enqueueMapBuffer (
+                        hBufferOutR, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                    hPtrOutG = (cl_float *) queue0.enqueueMapBuffer (
+                        hBufferOutG, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                    hPtrOutB = (cl_float *) queue0.enqueueMapBuffer (
+                        hBufferOutB, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                    queue0.enqueueUnmapMemObject (hBufferOutR, hPtrOutR);
+                    queue0.enqueueUnmapMemObject (hBufferOutG, hPtrOutG);
+                    queue0.enqueueUnmapMemObject (hBufferOutB, hPtrOutB);
+                    queue0.finish ();
+
+                    if (!io) hPtrIn = nullptr;
+                    break;
+            }
+            
+            // Create device buffers
+            if (dBufferIn () == nullptr)
+                dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+            if (dBufferOutR () == nullptr)
+                dBufferOutR = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            if (dBufferOutG () == nullptr)
+                dBufferOutG = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            if (dBufferOutB () == nullptr)
+                dBufferOutB = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_IN) = dBufferIn;
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            sRGB.init (width, height, Staging::NONE);
+
+            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
+            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOutR;
+            gfR.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+
+            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
+            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOutG;
+            gfG.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+
+            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
+            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOutB;
+            gfB.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+        }
+
+
+        /*! \details The transfer happens from a staging buffer on the host to the 
+         *           associated (specified) device buffer.
+         *  \note The transfer is handled by the first command queue.
+         *  
+         *  \param[in] mem enumeration value specifying an input device buffer.
+         *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+         *                 data from `ptr` will be copied to the associated staging buffer.
+         *  \param[in] block a flag to indicate whether to perform a blocking 
+         *                   or a non-blocking operation.
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the write operation to the device buffer.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::write (
+            GuidedFilterRGB::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            if (staging == Staging::I || staging == Staging::IO)
+            {
+                switch (mem)
+                {
+                    case GuidedFilterRGB::Memory::D_IN:
+                        if (ptr != nullptr)
+                            std::copy ((cl_uchar *) ptr, (cl_uchar *) ptr + 3 * width * height, hPtrIn);
+                        queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+
+        /*! \details The transfer happens from a device buffer to the associated 
+         *           (specified) staging buffer on the host.
+         *  \note The transfer is handled by the first command queue.
+         *  
+         *  \param[in] mem enumeration value specifying an output staging buffer.
+         *  \param[in] block a flag to indicate whether to perform a blocking 
+         *                   or a non-blocking operation.
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the read operation to the staging buffer.
+         */
+        void* GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::read (
+            GuidedFilterRGB::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            if (staging == Staging::O || staging == Staging::IO)
+            {
+                switch (mem)
+                {
+                    case GuidedFilterRGB::Memory::H_OUT_R:
+                        queue0.enqueueReadBuffer (dBufferOutR, block, 0, bufferOutSize, hPtrOutR, events, event);
+                        return hPtrOutR;
+                    case GuidedFilterRGB::Memory::H_OUT_G:
+                        queue0.enqueueReadBuffer (dBufferOutG, block, 0, bufferOutSize, hPtrOutG, events, event);
+                        return hPtrOutG;
+                    case GuidedFilterRGB::Memory::H_OUT_B:
+                        queue0.enqueueReadBuffer (dBufferOutB, block, 0, bufferOutSize, hPtrOutB, events, event);
+                        return hPtrOutB;
+                    default:
+                        return nullptr;
+                }
+            }
+            return nullptr;
+        }
+
+
+        /*! \details The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::run (
+            const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            sRGB.run (events, &sEvent); waitList[0] = sEvent;
+            gfR.run (&waitList);
+            gfG.run ();
+            gfB.run (nullptr, event);
+        }
+
+
+        /*! \details The kernels are recorded as `run` would enqueue them.
+         *
+         *  \param[in] graph graph in which to record the kernels.
+         *  \param[in] deps nodes that have to complete before the kernels execute.
+         *  \param[out] node node associated with the last kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::record (
+            CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+        {
+            std::vector<CommandGraph::Node> depsGF (1);
+            sRGB.record (graph, deps, &depsGF[0]);
+            gfR.record (graph, &depsGF);
+            gfG.record (graph);
+            gfB.record (graph, nullptr, node);
+        }
+
+
+        /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+         *           for replay. It's called by `replay` when there is no recording, and the 
+         *           recording is dropped whenever a parameter changes.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::capture ()
+        {
+            graph.clear ();
+            record (graph);
+            graph.finalize ();
+        }
+
+
+        /*! \details Executes the same kernels as `run`, with less host overhead. 
+         *           The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the last kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::replay (const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            if (graph.empty ()) capture ();
+            counters.add (Counters::Counter::KERNELS, graph.size ());
+            graph.replay (events, event);
+        }
+
+
+        /*! \details The input is copied to the input staging buffer of an `AsyncWindow` slot, 
+         *           and the transfers and kernel executions are enqueued without blocking. 
+         *           The call blocks only while the submission window is full.
+         *  \note The staging buffers of `async` are used, so `submit` works with any `Staging` 
+         *        configuration. Don't call `write`, `run` or `read` while submissions are in flight.
+         *  \note The callback is invoked on a thread of the OpenCL runtime. Look at `AsyncWindow`.
+         *
+         *  \param[in] ptr input array of `3*width*height` `cl_uchar` elements.
+         *  \param[in] callback function called with the mapping of the output array, 
+         *                      which holds the R, G and B channels one after the other.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::submit (const void *ptr, AsyncWindow::Callback callback)
+        {
+            AsyncWindow::Slot &slot = async.acquire (queue0, bufferInSize, 3 * bufferOutSize);
+            std::copy ((const cl_uchar *) ptr, (const cl_uchar *) ptr + 3 * width * height, (cl_uchar *) slot.hPtrIn);
+
+            cl_float *out = (cl_float *) slot.hPtrOut;
+            std::vector<cl::Event> writeEvents (1), runEvents (1);
+            queue0.enqueueWriteBuffer (dBufferIn, CL_FALSE, 0, bufferInSize, slot.hPtrIn, async.previous (), &writeEvents[0]);
+            run (&writeEvents, &runEvents[0]);
+            queue0.enqueueReadBuffer (dBufferOutR, CL_FALSE, 0, bufferOutSize, out, &runEvents);
+            queue0.enqueueReadBuffer (dBufferOutG, CL_FALSE, 0, bufferOutSize, out + width * height);
+            queue0.enqueueReadBuffer (dBufferOutB, CL_FALSE, 0, bufferOutSize, out + 2 * width * height, nullptr, &slot.event);
+            env.getQueue (info.ctxIdx, info.qIdx[1]).flush ();
+
+            async.commit (slot, callback);
+        }
+
+
+        /*! \details Like `submit` with a callback, but the output is copied to `out`.
+         *
+         *  \param[in] ptr input array of `3*width*height` `cl_uchar` elements.
+         *  \param[out] out array of `3*width*height` `cl_float` elements that receives 
+         *                  the R, G and B channels one after the other.
+         *  \return A future that becomes ready when `out` has been filled in.
+         */
+        std::future<void> GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::submit (const void *ptr, void *out)
+        {
+            std::future<void> future;
+            submit (ptr, AsyncWindow::deliver (out, 3 * bufferOutSize, future));
+            return future;
+        }
+
+
+        /*! \return The radius of the square filter window.
+         */
+        int GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::getRadius ()
+        {
+            return radius;
+        }
+
+
+        /*! \details Updates the kernel argument for the filter window radius.
+         *
+         *  \param[in] _radius radius of the square filter window.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::setRadius (int _radius)
+        {
+            graph.clear ();
+            radius = _radius;
+            gfR.setRadius (radius);
+            gfG.setRadius (radius);
+            gfB.setRadius (radius);
+        }
+
+
+        /*! \return The regularization parameter \f$\epsilon\f$.
+         */
+        float GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::getEps ()
+        {
+            return eps;
+        }
+
+
+        /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+         *
+         *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::setEps (float _eps)
+        {
+            graph.clear ();
+            eps = _eps;
+            gfR.setEps (eps);
+            gfG.setEps (eps);
+            gfB.setEps (eps);
+        }
+
+
+        /*! \param[in] _env opencl environment.
+         *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+         *                   The class requires **two** `(2)` **command queues** (on the same device).
+         */
+        GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::GuidedFilterRGB (
+            clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
+            counters ("GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>"), env (_env), info (_info), 
+            context (env.getContext (info.pIdx)), 
+            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+            sRGB  (env, info.getCLEnvInfo (0)), 
+            gfR (env, info), gfG (env, info), gfB (env, info), 
+            cRGB  (env, info.getCLEnvInfo (0)), 
+            waitList (1)
+        {
+            sRGB.counters.setParent (counters);
+            gfR.counters.setParent (counters);
+            gfG.counters.setParent (counters);
+            gfB.counters.setParent (counters);
+            cRGB.counters.setParent (counters);
+        }
+
+
+        /*! \details This interface exists to allow CL memory sharing between different kernels.
+         *
+         *  \param[in] mem enumeration value specifying the requested memory object.
+         *  \return A reference to the requested memory object.
+         */
+        cl::Memory& GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::get (GuidedFilterRGB::Memory mem)
+        {
+            switch (mem)
+            {
+                case GuidedFilterRGB::Memory::H_IN:
+                    return hBufferIn;
+                case GuidedFilterRGB::Memory::H_OUT:
+                    return hBufferOut;
+                case GuidedFilterRGB::Memory::D_INTR_R:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
+                case GuidedFilterRGB::Memory::D_INTR_G:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
+                case GuidedFilterRGB::Memory::D_INTR_B:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
+                case GuidedFilterRGB::Memory::D_IN:
+                    return dBufferIn;
+                case GuidedFilterRGB::Memory::D_OUT:
+                    return dBufferOut;
+            }
+        }
+
+
+        /*! \details Sets up memory objects as necessary, and defines the kernel workspaces.
+         *  \note If you have assigned a memory object to one member variable of the class 
+         *        before the call to `init`, then that memory will be maintained. Otherwise, 
+         *        a new memory object will be created.
+         *        
+         *  \param[in] _width width of the input array to be processed.
+         *  \param[in] _height height of the input array to be processed.
+         *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
+         *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+         *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::init (
+            unsigned int _width, unsigned int _height, int _radius, float _eps, Staging _staging)
+        {
+            graph.clear ();
+            width = _width; height = _height; radius = _radius; eps = _eps;
+            bufferInSize = 3 * width * height * sizeof (cl_uchar);
+            bufferOutSize = 3 * width * height * sizeof (cl_float);
+            staging = _staging;
+
+            // Create staging buffers
+            bool io = false;
+            switch (staging)
+            {
+                case Staging::NONE:
+                    hPtrIn = nullptr;
+                    hPtrOut = nullptr;
+                    break;
+
+                case Staging::IO:
+                    io = true;
+
+                case Staging::I:
+                    if (hBufferIn () == nullptr)
+                        hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+
+                    hPtrIn = (cl_uchar *) queue0.enqueueMapBuffer (
+                        hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
+                    queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+
+                    if (!io)
+                    {
+                        queue0.finish ();
+                        hPtrOut = nullptr;
+                        break;
+                    }
+
+                case Staging::O:
+                    if (hBufferOut () == nullptr)
+                        hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+
+                    hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
+                        hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                    queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
+                    queue0.finish ();
+
+                    if (!io) hPtrIn = nullptr;
+                    break;
+            }
+            
+            // Create device buffers
+            if (dBufferIn () == nullptr)
+                dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+            if (dBufferOut () == nullptr)
+                dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_IN) = dBufferIn;
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
+            sRGB.init (width, height, Staging::NONE);
+
+            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
+            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
+            gfR.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+
+            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
+            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
+            gfG.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+
+            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
+            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
+            gfB.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+
+            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_IN_R) = 
+                gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT);
+            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_IN_G) = 
+                gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT);
+            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_IN_B) = 
+                gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT);
+            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_OUT) = dBufferOut;
+            cRGB.init (width, height, Staging::NONE);
+        }
+
+
+        /*! \details The transfer happens from a staging buffer on the host to the 
+         *           associated (specified) device buffer.
+         *  \note The transfer is handled by the first command queue.
+         *  
+         *  \param[in] mem enumeration value specifying an input device buffer.
+         *  \param[in] ptr a pointer to an array holding input data. If not NULL, the 
+         *                 data from `ptr` will be copied to the associated staging buffer.
+         *  \param[in] block a flag to indicate whether to perform a blocking 
+         *                   or a non-blocking operation.
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the write operation to the device buffer.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::write (
+            GuidedFilterRGB::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            if (staging == Staging::I || staging == Staging::IO)
+            {
+                switch (mem)
+                {
+                    case GuidedFilterRGB::Memory::D_IN:
+                        if (ptr != nullptr)
+                            std::copy ((cl_uchar *) ptr, (cl_uchar *) ptr + 3 * width * height, hPtrIn);
+                        queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+
+        /*! \details The transfer happens from a device buffer to the associated 
+         *           (specified) staging buffer on the host.
+         *  \note The transfer is handled by the first command queue.
+         *  
+         *  \param[in] mem enumeration value specifying an output staging buffer.
+         *  \param[in] block a flag to indicate whether to perform a blocking 
+         *                   or a non-blocking operation.
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the read operation to the staging buffer.
+         */
+        void* GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::read (
+            GuidedFilterRGB::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            if (staging == Staging::O || staging == Staging::IO)
+            {
+                switch (mem)
+                {
+                    case GuidedFilterRGB::Memory::H_OUT:
+                        queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
+                        return hPtrOut;
+                    default:
+                        return nullptr;
+                }
+            }
+            return nullptr;
+        }
+
+
+        /*! \details The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::run (
+            const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            sRGB.run (events, &sEvent); waitList[0] = sEvent;
+            gfR.run (&waitList);
+            gfG.run ();
+            gfB.run ();
+            cRGB.run (nullptr, event);
+        }
+
+
+        /*! \details The kernels are recorded as `run` would enqueue them.
+         *
+         *  \param[in] graph graph in which to record the kernels.
+         *  \param[in] deps nodes that have to complete before the kernels execute.
+         *  \param[out] node node associated with the last kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::record (
+            CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+        {
+            std::vector<CommandGraph::Node> depsGF (1);
+            sRGB.record (graph, deps, &depsGF[0]);
+            gfR.record (graph, &depsGF);
+            gfG.record (graph);
+            gfB.record (graph);
+            cRGB.record (graph, nullptr, node);
+        }
+
+
+        /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+         *           for replay. It's called by `replay` when there is no recording, and the 
+         *           recording is dropped whenever a parameter changes.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::capture ()
+        {
+            graph.clear ();
+            record (graph);
+            graph.finalize ();
+        }
 
 
-    /*! \details Updates the kernel argument for the filter window radius.
-     *
-     *  \param[in] _radius radius of the square filter window.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setRadius (int _radius)
-    {
-        radius = _radius;
-        mean_I.setRadius (radius);
-        mean_p.setRadius (radius);
-        corr_I.setRadius (radius);
-        corr_Ip.setRadius (radius);
-        mean_a.setRadius (radius);
-        mean_b.setRadius (radius);
-    }
+        /*! \details Executes the same kernels as `run`, with less host overhead. 
+         *           The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the last kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::replay (const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            if (graph.empty ()) capture ();
+            counters.add (Counters::Counter::KERNELS, graph.size ());
+            graph.replay (events, event);
+        }
 
 
-    /*! \return The regularization parameter \f$\epsilon\f$.
-     */
-    float GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getEps ()
-    {
-        return eps;
-    }
+        /*! \details The input is copied to the input staging buffer of an `AsyncWindow` slot, 
+         *           and the transfers and kernel executions are enqueued without blocking. 
+         *           The call blocks only while the submission window is full.
+         *  \note The staging buffers of `async` are used, so `submit` works with any `Staging` 
+         *        configuration. Don't call `write`, `run` or `read` while submissions are in flight.
+         *  \note The callback is invoked on a thread of the OpenCL runtime. Look at `AsyncWindow`.
+         *
+         *  \param[in] ptr input array of `3*width*height` `cl_uchar` elements.
+         *  \param[in] callback function called with the mapping of the output array.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::submit (const void *ptr, AsyncWindow::Callback callback)
+        {
+            AsyncWindow::Slot &slot = async.acquire (queue0, bufferInSize, bufferOutSize);
+            std::copy ((const cl_uchar *) ptr, (const cl_uchar *) ptr + 3 * width * height, (cl_uchar *) slot.hPtrIn);
 
+            std::vector<cl::Event> writeEvents (1), runEvents (1);
+            queue0.enqueueWriteBuffer (dBufferIn, CL_FALSE, 0, bufferInSize, slot.hPtrIn, async.previous (), &writeEvents[0]);
+            run (&writeEvents, &runEvents[0]);
+            queue0.enqueueReadBuffer (dBufferOut, CL_FALSE, 0, bufferOutSize, slot.hPtrOut, &runEvents, &slot.event);
+            env.getQueue (info.ctxIdx, info.qIdx[1]).flush ();
 
-    /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
-     *
-     *  \param[in] _eps regularization parameter \f$\epsilon\f$.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setEps (float _eps)
-    {
-        eps = _eps;
-        ab.setArg (6, eps);
-    }
+            async.commit (slot, callback);
+        }
 
 
-    /*! \return The scaling factor applied internally to `BoxFilterSAT`.
-     */
-    float GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getBoxScaling ()
-    {
-        return boxScaling;
-    }
+        /*! \details Like `submit` with a callback, but the output is copied to `out`.
+         *
+         *  \param[in] ptr input array of `3*width*height` `cl_uchar` elements.
+         *  \param[out] out array of `3*width*height` `cl_float` elements that receives the output.
+         *  \return A future that becomes ready when `out` has been filled in.
+         */
+        std::future<void> GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::submit (const void *ptr, void *out)
+        {
+            std::future<void> future;
+            submit (ptr, AsyncWindow::deliver (out, bufferOutSize, future));
+            return future;
+        }
 
 
-    /*! \details Updates the kernel argument for internal scaling 
-     *           of the array elements in `BoxFilterSAT`.
-     *
-     *  \param[in] _scaling scaling factor for `BoxFilterSAT`.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setBoxScaling (float _boxScaling)
-    {
-        boxScaling = _boxScaling;
-        mean_I.setScaling (boxScaling);
-        mean_p.setScaling (boxScaling);
-        corr_I.setScaling (boxScaling);
-        corr_Ip.setScaling (boxScaling);
-        mean_a.setScaling (boxScaling);
-        mean_b.setScaling (boxScaling);
-    }
+        /*! \return The radius of the square filter window.
+         */
+        int GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::getRadius ()
+        {
+            return radius;
+        }
 
 
-    /*! \return The `zero_out` flag.
-     */
-    int GuidedFilter<GuidedFilterConfig::I_NEQ_P>::getZeroing ()
-    {
-        return zero_out;
-    }
+        /*! \details Updates the kernel argument for the filter window radius.
+         *
+         *  \param[in] _radius radius of the square filter window.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::setRadius (int _radius)
+        {
+            graph.clear ();
+            radius = _radius;
+            gfR.setRadius (radius);
+            gfG.setRadius (radius);
+            gfB.setRadius (radius);
+        }
 
 
-    /*! \details Updates the kernel argument for the `zero_out` flag.
-     *
-     *  \param[in] _zero_out `zero_out` flag.
-     */
-    void GuidedFilter<GuidedFilterConfig::I_NEQ_P>::setZeroing (int _zero_out)
-    {
-        zero_out = _zero_out;
-        q.setArg (4, zero_out);
-    }
+        /*! \return The regularization parameter \f$\epsilon\f$.
+         */
+        float GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::getEps ()
+        {
+            return eps;
+        }
 
 
-    namespace Kinect
-    {
+        /*! \details Updates the kernel argument for the regularization parameter \f$\epsilon\f$.
+         *
+         *  \param[in] _eps regularization parameter \f$\epsilon\f$.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::setEps (float _eps)
+        {
+            graph.clear ();
+            eps = _eps;
+            gfR.setEps (eps);
+            gfG.setEps (eps);
+            gfB.setEps (eps);
+        }
+
 
         /*! \param[in] _env opencl environment.
          *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
-         *                   The class requires **two** `(2)` **command queues** (on the same device).
+         *                   The class takes **two** `(2)` **command queues** (on the same device), 
+         *                   like the other `GuidedFilterRGB` classes, but it only uses the first.
          */
-        GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::GuidedFilterRGB (
+        GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::GuidedFilterRGB (
             clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
-            env (_env), info (_info), 
+            counters ("GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>"), env (_env), info (_info), 
             context (env.getContext (info.pIdx)), 
-            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-            sRGB  (env, info.getCLEnvInfo (0)), 
-            gfR (env, info), gfG (env, info), gfB (env, info), 
-            waitList (1)
+            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+            rowSums (env.getProgram (info.pgIdx), "gf_rowSums_Ushort"), 
+            ab (env.getProgram (info.pgIdx), "gf_ab_Ushort"), 
+            rowSumsAB (env.getProgram (info.pgIdx), "gf_rowSums_ab"), 
+            q (env.getProgram (info.pgIdx), "gf_q_Ushort")
         {
         }
 
@@ -4206,32 +11781,26 @@ namespace GF
          *  \param[in] mem enumeration value specifying the requested memory object.
          *  \return A reference to the requested memory object.
          */
-        cl::Memory& GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::get (GuidedFilterRGB::Memory mem)
+        cl::Memory& GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::get (GuidedFilterRGB::Memory mem)
         {
             switch (mem)
             {
                 case GuidedFilterRGB::Memory::H_IN:
                     return hBufferIn;
-                case GuidedFilterRGB::Memory::H_OUT_R:
-                    return hBufferOutR;
-                case GuidedFilterRGB::Memory::H_OUT_G:
-                    return hBufferOutG;
-                case GuidedFilterRGB::Memory::H_OUT_B:
-                    return hBufferOutB;
-                case GuidedFilterRGB::Memory::D_INTR_R:
-                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
-                case GuidedFilterRGB::Memory::D_INTR_G:
-                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
-                case GuidedFilterRGB::Memory::D_INTR_B:
-                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
+                case GuidedFilterRGB::Memory::H_OUT:
+                    return hBufferOut;
                 case GuidedFilterRGB::Memory::D_IN:
                     return dBufferIn;
-                case GuidedFilterRGB::Memory::D_OUT_R:
-                    return dBufferOutR;
-                case GuidedFilterRGB::Memory::D_OUT_G:
-                    return dBufferOutG;
-                case GuidedFilterRGB::Memory::D_OUT_B:
-                    return dBufferOutB;
+                case GuidedFilterRGB::Memory::D_SUM:
+                    return dBufferSum;
+                case GuidedFilterRGB::Memory::D_SUM2:
+                    return dBufferSum2;
+                case GuidedFilterRGB::Memory::D_A:
+                    return dBufferA;
+                case GuidedFilterRGB::Memory::D_B:
+                    return dBufferB;
+                case GuidedFilterRGB::Memory::D_OUT:
+                    return dBufferOut;
             }
         }
 
@@ -4240,30 +11809,47 @@ namespace GF
          *  \note If you have assigned a memory object to one member variable of the class 
          *        before the call to `init`, then that memory will be maintained. Otherwise, 
          *        a new memory object will be created.
+         *  \note The row sums of the coefficients reuse the buffers of the row sums 
+         *        of the moments, which aren't needed by then.
          *        
          *  \param[in] _width width of the input array to be processed.
          *  \param[in] _height height of the input array to be processed.
          *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
-         *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+         *                     It can be at most `maxRadius`.
+         *  \param[in] _eps regularization parameter \f$ \epsilon \f$, for values normalized to one.
          *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::init (
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::init (
             unsigned int _width, unsigned int _height, int _radius, float _eps, Staging _staging)
         {
+            graph.clear ();
             width = _width; height = _height; radius = _radius; eps = _eps;
-            bufferInSize = 3 * width * height * sizeof (cl_uchar);
-            bufferOutSize = width * height * sizeof (cl_float);
+            bufferInSize = 3 * width * height * sizeof (cl_ushort);
+            bufferOutSize = 3 * width * height * sizeof (cl_ushort);
             staging = _staging;
 
+            try
+            {
+                if (width == 0 || height == 0)
+                    throw "The image cannot have zeroed dimensions";
+            }
+            catch (const char *error)
+            {
+                std::cerr << "Error[GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>]: " << error << std::endl;
+                exit (EXIT_FAILURE);
+            }
+            checkRadius (radius);
+
+            // Set workspaces
+            global = cl::NDRange (width, height);
+
             // Create staging buffers
             bool io = false;
             switch (staging)
             {
                 case Staging::NONE:
                     hPtrIn = nullptr;
-                    hPtrOutR = nullptr;
-                    hPtrOutG = nullptr;
-                    hPtrOutB = nullptr;
+                    hPtrOut = nullptr;
                     break;
 
                 case Staging::IO:
@@ -4271,38 +11857,26 @@ namespace GF
 
                 case Staging::I:
                     if (hBufferIn () == nullptr)
-                        hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                        hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
-                    hPtrIn = (cl_uchar *) queue0.enqueueMapBuffer (
+                    hPtrIn = (cl_ushort *) queue0.enqueueMapBuffer (
                         hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
                     queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
                     if (!io)
                     {
                         queue0.finish ();
-                        hPtrOutR = nullptr;
-                        hPtrOutG = nullptr;
-                        hPtrOutB = nullptr;
+                        hPtrOut = nullptr;
                         break;
                     }
 
                 case Staging::O:
-                    if (hBufferOutR () == nullptr)
-                        hBufferOutR = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
-                    if (hBufferOutG () == nullptr)
-                        hBufferOutG = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
-                    if (hBufferOutB () == nullptr)
-                        hBufferOutB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                    if (hBufferOut () == nullptr)
+                        hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
-                    hPtrOutR = (cl_float *) queue0.enqueueMapBuffer (
-                        hBufferOutR, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
-                    hPtrOutG = (cl_float *) queue0.enqueueMapBuffer (
-                        hBufferOutG, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
-                    hPtrOutB = (cl_float *) queue0.enqueueMapBuffer (
-                        hBufferOutB, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
-                    queue0.enqueueUnmapMemObject (hBufferOutR, hPtrOutR);
-                    queue0.enqueueUnmapMemObject (hBufferOutG, hPtrOutG);
-                    queue0.enqueueUnmapMemObject (hBufferOutB, hPtrOutB);
+                    hPtrOut = (cl_ushort *) queue0.enqueueMapBuffer (
+                        hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
+                    queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                     queue0.finish ();
 
                     if (!io) hPtrIn = nullptr;
@@ -4311,37 +11885,59 @@ namespace GF
             
             // Create device buffers
             if (dBufferIn () == nullptr)
-                dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
-            if (dBufferOutR () == nullptr)
-                dBufferOutR = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
-            if (dBufferOutG () == nullptr)
-                dBufferOutG = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
-            if (dBufferOutB () == nullptr)
-                dBufferOutB = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
-
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_IN) = dBufferIn;
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize);
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize);
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize);
-            sRGB.init (width, height, Staging::NONE);
-
-            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
-                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
-            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOutR;
-            gfR.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
-
-            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
-                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
-            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOutG;
-            gfG.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
-
-            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
-                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
-            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOutB;
-            gfB.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+                dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
+            if (dBufferOut () == nullptr)
+                dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+            if (dBufferSum () == nullptr)
+                dBufferSum = counters.allocate (context, CL_MEM_READ_WRITE, width * height * sizeof (cl_uint4));
+            if (dBufferSum2 () == nullptr)
+                dBufferSum2 = counters.allocate (context, CL_MEM_READ_WRITE, width * height * sizeof (cl_ulong4));
+            if (dBufferA () == nullptr)
+                dBufferA = counters.allocate (context, CL_MEM_READ_WRITE, width * height * sizeof (cl_uint4));
+            if (dBufferB () == nullptr)
+                dBufferB = counters.allocate (context, CL_MEM_READ_WRITE, width * height * sizeof (cl_uint4));
+
+            // Set kernel arguments
+            rowSums.setArg (0, dBufferIn);
+            rowSums.setArg (1, dBufferSum);
+            rowSums.setArg (2, dBufferSum2);
+            rowSums.setArg (3, radius);
+
+            ab.setArg (0, dBufferSum);
+            ab.setArg (1, dBufferSum2);
+            ab.setArg (2, dBufferA);
+            ab.setArg (3, dBufferB);
+            ab.setArg (4, radius);
+            ab.setArg (5, eps);
+
+            rowSumsAB.setArg (0, dBufferA);
+            rowSumsAB.setArg (1, dBufferB);
+            rowSumsAB.setArg (2, dBufferSum);
+            rowSumsAB.setArg (3, dBufferSum2);
+            rowSumsAB.setArg (4, radius);
+
+            q.setArg (0, dBufferIn);
+            q.setArg (1, dBufferSum);
+            q.setArg (2, dBufferSum2);
+            q.setArg (3, dBufferOut);
+            q.setArg (4, radius);
+        }
+
+
+        /*! \param[in] _radius radius of the square filter window.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::checkRadius (int _radius)
+        {
+            try
+            {
+                if (_radius < 1 || _radius > maxRadius)
+                    throw "The radius has to be between 1 and 127 (maxRadius)";
+            }
+            catch (const char *error)
+            {
+                std::cerr << "Error[GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>]: " << error << std::endl;
+                exit (EXIT_FAILURE);
+            }
         }
 
 
@@ -4357,7 +11953,7 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the write operation to the device buffer.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::write (
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::write (
             GuidedFilterRGB::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
         {
             if (staging == Staging::I || staging == Staging::IO)
@@ -4366,7 +11962,7 @@ namespace GF
                 {
                     case GuidedFilterRGB::Memory::D_IN:
                         if (ptr != nullptr)
-                            std::copy ((cl_uchar *) ptr, (cl_uchar *) ptr + 3 * width * height, hPtrIn);
+                            std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + 3 * width * height, hPtrIn);
                         queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
                         break;
                     default:
@@ -4386,22 +11982,16 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the read operation to the staging buffer.
          */
-        void* GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::read (
+        void* GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::read (
             GuidedFilterRGB::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
         {
             if (staging == Staging::O || staging == Staging::IO)
             {
                 switch (mem)
                 {
-                    case GuidedFilterRGB::Memory::H_OUT_R:
-                        queue0.enqueueReadBuffer (dBufferOutR, block, 0, bufferOutSize, hPtrOutR, events, event);
-                        return hPtrOutR;
-                    case GuidedFilterRGB::Memory::H_OUT_G:
-                        queue0.enqueueReadBuffer (dBufferOutG, block, 0, bufferOutSize, hPtrOutG, events, event);
-                        return hPtrOutG;
-                    case GuidedFilterRGB::Memory::H_OUT_B:
-                        queue0.enqueueReadBuffer (dBufferOutB, block, 0, bufferOutSize, hPtrOutB, events, event);
-                        return hPtrOutB;
+                    case GuidedFilterRGB::Memory::H_OUT:
+                        queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
+                        return hPtrOut;
                     default:
                         return nullptr;
                 }
@@ -4415,19 +12005,101 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the kernel execution.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::run (
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::run (
             const std::vector<cl::Event> *events, cl::Event *event)
         {
-            sRGB.run (events, &sEvent); waitList[0] = sEvent;
-            gfR.run (&waitList);
-            gfG.run ();
-            gfB.run (nullptr, event);
+            Counters::Frame frame (counters, event);
+            queue0.enqueueNDRangeKernel (rowSums, cl::NullRange, global, cl::NullRange, events);
+            queue0.enqueueNDRangeKernel (ab, cl::NullRange, global, cl::NullRange);
+            queue0.enqueueNDRangeKernel (rowSumsAB, cl::NullRange, global, cl::NullRange);
+            queue0.enqueueNDRangeKernel (q, cl::NullRange, global, cl::NullRange, nullptr, event);
+        }
+
+
+        /*! \details The kernels are recorded as `run` would enqueue them.
+         *
+         *  \param[in] graph graph in which to record the kernels.
+         *  \param[in] deps nodes that have to complete before the kernels execute.
+         *  \param[out] node node associated with the last kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::record (
+            CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+        {
+            graph.add (queue0, rowSums, cl::NullRange, global, cl::NullRange, deps);
+            graph.add (queue0, ab, cl::NullRange, global, cl::NullRange);
+            graph.add (queue0, rowSumsAB, cl::NullRange, global, cl::NullRange);
+            graph.add (queue0, q, cl::NullRange, global, cl::NullRange, nullptr, node);
+        }
+
+
+        /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+         *           for replay. It's called by `replay` when there is no recording, and the 
+         *           recording is dropped whenever a parameter changes.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::capture ()
+        {
+            graph.clear ();
+            record (graph);
+            graph.finalize ();
+        }
+
+
+        /*! \details Executes the same kernels as `run`, with less host overhead. 
+         *           The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the last kernel execution.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::replay (const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            if (graph.empty ()) capture ();
+            counters.add (Counters::Counter::KERNELS, graph.size ());
+            graph.replay (events, event);
+        }
+
+
+        /*! \details The input is copied to the input staging buffer of an `AsyncWindow` slot, 
+         *           and the transfers and kernel executions are enqueued without blocking. 
+         *           The call blocks only while the submission window is full.
+         *  \note The staging buffers of `async` are used, so `submit` works with any `Staging` 
+         *        configuration. Don't call `write`, `run` or `read` while submissions are in flight.
+         *  \note The callback is invoked on a thread of the OpenCL runtime. Look at `AsyncWindow`.
+         *
+         *  \param[in] ptr input array of `3*width*height` `cl_ushort` elements.
+         *  \param[in] callback function called with the mapping of the output array.
+         */
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::submit (const void *ptr, AsyncWindow::Callback callback)
+        {
+            AsyncWindow::Slot &slot = async.acquire (queue0, bufferInSize, bufferOutSize);
+            std::copy ((const cl_ushort *) ptr, (const cl_ushort *) ptr + 3 * width * height, (cl_ushort *) slot.hPtrIn);
+
+            std::vector<cl::Event> writeEvents (1), runEvents (1);
+            queue0.enqueueWriteBuffer (dBufferIn, CL_FALSE, 0, bufferInSize, slot.hPtrIn, async.previous (), &writeEvents[0]);
+            run (&writeEvents, &runEvents[0]);
+            queue0.enqueueReadBuffer (dBufferOut, CL_FALSE, 0, bufferOutSize, slot.hPtrOut, &runEvents, &slot.event);
+
+            async.commit (slot, callback);
+        }
+
+
+        /*! \details Like `submit` with a callback, but the output is copied to `out`.
+         *
+         *  \param[in] ptr input array of `3*width*height` `cl_ushort` elements.
+         *  \param[out] out array of `3*width*height` `cl_ushort` elements that receives the output.
+         *  \return A future that becomes ready when `out` has been filled in.
+         */
+        std::future<void> GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::submit (const void *ptr, void *out)
+        {
+            std::future<void> future;
+            submit (ptr, AsyncWindow::deliver (out, bufferOutSize, future));
+            return future;
         }
 
 
         /*! \return The radius of the square filter window.
          */
-        int GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::getRadius ()
+        int GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::getRadius ()
         {
             return radius;
         }
@@ -4437,18 +12109,21 @@ namespace GF
          *
          *  \param[in] _radius radius of the square filter window.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::setRadius (int _radius)
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::setRadius (int _radius)
         {
+            checkRadius (_radius);
+            graph.clear ();
             radius = _radius;
-            gfR.setRadius (radius);
-            gfG.setRadius (radius);
-            gfB.setRadius (radius);
+            rowSums.setArg (3, radius);
+            ab.setArg (4, radius);
+            rowSumsAB.setArg (4, radius);
+            q.setArg (4, radius);
         }
 
 
         /*! \return The regularization parameter \f$\epsilon\f$.
          */
-        float GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::getEps ()
+        float GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::getEps ()
         {
             return eps;
         }
@@ -4458,12 +12133,11 @@ namespace GF
          *
          *  \param[in] _eps regularization parameter \f$\epsilon\f$.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::SEPARATED>::setEps (float _eps)
+        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>::setEps (float _eps)
         {
+            graph.clear ();
             eps = _eps;
-            gfR.setEps (eps);
-            gfG.setEps (eps);
-            gfB.setEps (eps);
+            ab.setArg (5, eps);
         }
 
 
@@ -4471,16 +12145,16 @@ namespace GF
          *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
          *                   The class requires **two** `(2)` **command queues** (on the same device).
          */
-        GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::GuidedFilterRGB (
+        GuidedFilterDepth::GuidedFilterDepth (
             clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
-            env (_env), info (_info), 
+            counters ("GuidedFilterDepth"), env (_env), info (_info), 
             context (env.getContext (info.pIdx)), 
-            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-            sRGB  (env, info.getCLEnvInfo (0)), 
-            gfR (env, info), gfG (env, info), gfB (env, info), 
-            cRGB  (env, info.getCLEnvInfo (0)), 
+            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+            depth  (env, info.getCLEnvInfo (0)), gf (env, info), 
             waitList (1)
         {
+            depth.counters.setParent (counters);
+            gf.counters.setParent (counters);
         }
 
 
@@ -4489,23 +12163,17 @@ namespace GF
          *  \param[in] mem enumeration value specifying the requested memory object.
          *  \return A reference to the requested memory object.
          */
-        cl::Memory& GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::get (GuidedFilterRGB::Memory mem)
+        cl::Memory& GuidedFilterDepth::get (GuidedFilterDepth::Memory mem)
         {
             switch (mem)
             {
-                case GuidedFilterRGB::Memory::H_IN:
+                case GuidedFilterDepth::Memory::H_IN:
                     return hBufferIn;
-                case GuidedFilterRGB::Memory::H_OUT:
+                case GuidedFilterDepth::Memory::H_OUT:
                     return hBufferOut;
-                case GuidedFilterRGB::Memory::D_INTR_R:
-                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
-                case GuidedFilterRGB::Memory::D_INTR_G:
-                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
-                case GuidedFilterRGB::Memory::D_INTR_B:
-                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
-                case GuidedFilterRGB::Memory::D_IN:
+                case GuidedFilterDepth::Memory::D_IN:
                     return dBufferIn;
-                case GuidedFilterRGB::Memory::D_OUT:
+                case GuidedFilterDepth::Memory::D_OUT:
                     return dBufferOut;
             }
         }
@@ -4520,14 +12188,20 @@ namespace GF
          *  \param[in] _height height of the input array to be processed.
          *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
          *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
+         *  \param[in] _dScaling factor by which to scale the depth values. It's independent from the 
+         *                       scaling applied in `BoxFilterSAT`. This is another level of scaling 
+         *                       (internal to the algorithm) applied to the input array before the 
+         *                       processing by `GuidedFilter`.
          *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::init (
-            unsigned int _width, unsigned int _height, int _radius, float _eps, Staging _staging)
+        void GuidedFilterDepth::init (
+            unsigned int _width, unsigned int _height, int _radius, float _eps, float _dScaling, Staging _staging)
         {
+            graph.clear ();
             width = _width; height = _height; radius = _radius; eps = _eps;
-            bufferInSize = 3 * width * height * sizeof (cl_uchar);
-            bufferOutSize = 3 * width * height * sizeof (cl_float);
+            bufferInSize = width * height * sizeof (cl_ushort);
+            bufferOutSize = width * height * sizeof (cl_float);
+            dScaling = _dScaling;
             staging = _staging;
 
             // Create staging buffers
@@ -4544,9 +12218,9 @@ namespace GF
 
                 case Staging::I:
                     if (hBufferIn () == nullptr)
-                        hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
+                        hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
 
-                    hPtrIn = (cl_uchar *) queue0.enqueueMapBuffer (
+                    hPtrIn = (cl_ushort *) queue0.enqueueMapBuffer (
                         hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
                     queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
 
@@ -4559,7 +12233,7 @@ namespace GF
 
                 case Staging::O:
                     if (hBufferOut () == nullptr)
-                        hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                        hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
                     hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
                         hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
@@ -4572,45 +12246,19 @@ namespace GF
             
             // Create device buffers
             if (dBufferIn () == nullptr)
-                dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+                dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferInSize);
             if (dBufferOut () == nullptr)
-                dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
-
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_IN) = dBufferIn;
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
-            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
-            sRGB.init (width, height, Staging::NONE);
-
-            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
-                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
-            gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
-            gfR.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
-
-            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
-                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
-            gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
-            gfG.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+                dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
 
-            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
-                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
-            gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize / 3);
-            gfB.init (width, height, radius, eps, 0, 1e-4f, 1.f, Staging::NONE);
+            depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_IN) = dBufferIn;
+            depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_OUT) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            depth.init (width, height, dScaling, Staging::NONE);
 
-            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_IN_R) = 
-                gfR.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT);
-            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_IN_G) = 
-                gfG.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT);
-            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_IN_B) = 
-                gfB.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT);
-            cRGB.get (CombineRGB<CombineRGBConfig::FLOAT_FLOAT>::Memory::D_OUT) = dBufferOut;
-            cRGB.init (width, height, Staging::NONE);
+            gf.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+                depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_OUT);
+            gf.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOut;
+            gf.init (width, height, radius, eps, 1, 1e-6f, 1.f / dScaling, Staging::NONE);
         }
 
 
@@ -4626,16 +12274,16 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the write operation to the device buffer.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::write (
-            GuidedFilterRGB::Memory mem, void *ptr, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+        void GuidedFilterDepth::write (GuidedFilterDepth::Memory mem, void *ptr, bool block, 
+            const std::vector<cl::Event> *events, cl::Event *event)
         {
             if (staging == Staging::I || staging == Staging::IO)
             {
                 switch (mem)
                 {
-                    case GuidedFilterRGB::Memory::D_IN:
+                    case GuidedFilterDepth::Memory::D_IN:
                         if (ptr != nullptr)
-                            std::copy ((cl_uchar *) ptr, (cl_uchar *) ptr + 3 * width * height, hPtrIn);
+                            std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + width * height, hPtrIn);
                         queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
                         break;
                     default:
@@ -4655,14 +12303,14 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the read operation to the staging buffer.
          */
-        void* GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::read (
-            GuidedFilterRGB::Memory mem, bool block, const std::vector<cl::Event> *events, cl::Event *event)
+        void* GuidedFilterDepth::read (GuidedFilterDepth::Memory mem, bool block, 
+            const std::vector<cl::Event> *events, cl::Event *event)
         {
             if (staging == Staging::O || staging == Staging::IO)
             {
                 switch (mem)
                 {
-                    case GuidedFilterRGB::Memory::H_OUT:
+                    case GuidedFilterDepth::Memory::H_OUT:
                         queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
                         return hPtrOut;
                     default:
@@ -4678,20 +12326,98 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the kernel execution.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::run (
-            const std::vector<cl::Event> *events, cl::Event *event)
+        void GuidedFilterDepth::run (const std::vector<cl::Event> *events, cl::Event *event)
         {
-            sRGB.run (events, &sEvent); waitList[0] = sEvent;
-            gfR.run (&waitList);
-            gfG.run ();
-            gfB.run ();
-            cRGB.run (nullptr, event);
+            Counters::Frame frame (counters, event);
+            depth.run (events, &dEvent); waitList[0] = dEvent;
+            gf.run (&waitList, event);
+        }
+
+
+        /*! \details The kernels are recorded as `run` would enqueue them.
+         *
+         *  \param[in] graph graph in which to record the kernels.
+         *  \param[in] deps nodes that have to complete before the kernels execute.
+         *  \param[out] node node associated with the last kernel execution.
+         */
+        void GuidedFilterDepth::record (
+            CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+        {
+            std::vector<CommandGraph::Node> depsGF (1);
+            depth.record (graph, deps, &depsGF[0]);
+            gf.record (graph, &depsGF, node);
+        }
+
+
+        /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+         *           for replay. It's called by `replay` when there is no recording, and the 
+         *           recording is dropped whenever a parameter changes.
+         */
+        void GuidedFilterDepth::capture ()
+        {
+            graph.clear ();
+            record (graph);
+            graph.finalize ();
+        }
+
+
+        /*! \details Executes the same kernels as `run`, with less host overhead. 
+         *           The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the last kernel execution.
+         */
+        void GuidedFilterDepth::replay (const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            if (graph.empty ()) capture ();
+            counters.add (Counters::Counter::KERNELS, graph.size ());
+            graph.replay (events, event);
+        }
+
+
+        /*! \details The input is copied to the input staging buffer of an `AsyncWindow` slot, 
+         *           and the transfers and kernel executions are enqueued without blocking. 
+         *           The call blocks only while the submission window is full.
+         *  \note The staging buffers of `async` are used, so `submit` works with any `Staging` 
+         *        configuration. Don't call `write`, `run` or `read` while submissions are in flight.
+         *  \note The callback is invoked on a thread of the OpenCL runtime. Look at `AsyncWindow`.
+         *
+         *  \param[in] ptr input array of `width*height` `cl_ushort` elements.
+         *  \param[in] callback function called with the mapping of the output array.
+         */
+        void GuidedFilterDepth::submit (const void *ptr, AsyncWindow::Callback callback)
+        {
+            AsyncWindow::Slot &slot = async.acquire (queue0, bufferInSize, bufferOutSize);
+            std::copy ((const cl_ushort *) ptr, (const cl_ushort *) ptr + width * height, (cl_ushort *) slot.hPtrIn);
+
+            std::vector<cl::Event> writeEvents (1), runEvents (1);
+            queue0.enqueueWriteBuffer (dBufferIn, CL_FALSE, 0, bufferInSize, slot.hPtrIn, async.previous (), &writeEvents[0]);
+            run (&writeEvents, &runEvents[0]);
+            queue0.enqueueReadBuffer (dBufferOut, CL_FALSE, 0, bufferOutSize, slot.hPtrOut, &runEvents, &slot.event);
+            env.getQueue (info.ctxIdx, info.qIdx[1]).flush ();
+
+            async.commit (slot, callback);
+        }
+
+
+        /*! \details Like `submit` with a callback, but the output is copied to `out`.
+         *
+         *  \param[in] ptr input array of `width*height` `cl_ushort` elements.
+         *  \param[out] out array of `width*height` `cl_float` elements that receives the output.
+         *  \return A future that becomes ready when `out` has been filled in.
+         */
+        std::future<void> GuidedFilterDepth::submit (const void *ptr, void *out)
+        {
+            std::future<void> future;
+            submit (ptr, AsyncWindow::deliver (out, bufferOutSize, future));
+            return future;
         }
 
 
         /*! \return The radius of the square filter window.
          */
-        int GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::getRadius ()
+        int GuidedFilterDepth::getRadius ()
         {
             return radius;
         }
@@ -4701,18 +12427,17 @@ namespace GF
          *
          *  \param[in] _radius radius of the square filter window.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::setRadius (int _radius)
+        void GuidedFilterDepth::setRadius (int _radius)
         {
+            graph.clear ();
             radius = _radius;
-            gfR.setRadius (radius);
-            gfG.setRadius (radius);
-            gfB.setRadius (radius);
+            gf.setRadius (radius);
         }
 
 
         /*! \return The regularization parameter \f$\epsilon\f$.
          */
-        float GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::getEps ()
+        float GuidedFilterDepth::getEps ()
         {
             return eps;
         }
@@ -4722,12 +12447,32 @@ namespace GF
          *
          *  \param[in] _eps regularization parameter \f$\epsilon\f$.
          */
-        void GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_FLOAT>::setEps (float _eps)
+        void GuidedFilterDepth::setEps (float _eps)
         {
+            graph.clear ();
             eps = _eps;
-            gfR.setEps (eps);
-            gfG.setEps (eps);
-            gfB.setEps (eps);
+            gf.setEps (eps);
+        }
+
+
+        /*! \return The depth scaling factor.
+         */
+        float GuidedFilterDepth::getDScaling ()
+        {
+            return dScaling;
+        }
+
+
+        /*! \details Updates the kernel argument for the depth scaling factor.
+         *
+         *  \param[in] _dScaling  depth scaling factor.
+         */
+        void GuidedFilterDepth::setDScaling (float _dScaling)
+        {
+            graph.clear ();
+            dScaling = _dScaling;
+            depth.setScaling (dScaling);
+            gf.setOutputScaling (1.f / dScaling);
         }
 
 
@@ -4735,14 +12480,19 @@ namespace GF
          *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
          *                   The class requires **two** `(2)` **command queues** (on the same device).
          */
-        GuidedFilterDepth::GuidedFilterDepth (
+        GuidedFilterRGBD::GuidedFilterRGBD (
             clutils::CLEnv &_env, clutils::CLEnvInfo<2> _info) : 
-            env (_env), info (_info), 
+            counters ("GuidedFilterRGBD"), env (_env), info (_info), 
             context (env.getContext (info.pIdx)), 
-            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0])), 
-            depth  (env, info.getCLEnvInfo (0)), gf (env, info), 
+            queue0 (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
+            sRGB (env, info.getCLEnvInfo (0)), depth (env, info.getCLEnvInfo (0)), gf (env, info), 
+            gray (env.getProgram (info.pgIdx), "rgbToGray"), 
+            mask (env.getProgram (info.pgIdx), "maskZeros"), 
             waitList (1)
         {
+            sRGB.counters.setParent (counters);
+            depth.counters.setParent (counters);
+            gf.counters.setParent (counters);
         }
 
 
@@ -4751,17 +12501,29 @@ namespace GF
          *  \param[in] mem enumeration value specifying the requested memory object.
          *  \return A reference to the requested memory object.
          */
-        cl::Memory& GuidedFilterDepth::get (GuidedFilterDepth::Memory mem)
+        cl::Memory& GuidedFilterRGBD::get (GuidedFilterRGBD::Memory mem)
         {
             switch (mem)
             {
-                case GuidedFilterDepth::Memory::H_IN:
-                    return hBufferIn;
-                case GuidedFilterDepth::Memory::H_OUT:
+                case GuidedFilterRGBD::Memory::H_IN_RGB:
+                    return hBufferInRGB;
+                case GuidedFilterRGBD::Memory::H_IN_D:
+                    return hBufferInD;
+                case GuidedFilterRGBD::Memory::H_OUT:
                     return hBufferOut;
-                case GuidedFilterDepth::Memory::D_IN:
-                    return dBufferIn;
-                case GuidedFilterDepth::Memory::D_OUT:
+                case GuidedFilterRGBD::Memory::D_IN_RGB:
+                    return dBufferInRGB;
+                case GuidedFilterRGBD::Memory::D_IN_D:
+                    return dBufferInD;
+                case GuidedFilterRGBD::Memory::D_OUT_R:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R);
+                case GuidedFilterRGBD::Memory::D_OUT_G:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G);
+                case GuidedFilterRGBD::Memory::D_OUT_B:
+                    return sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B);
+                case GuidedFilterRGBD::Memory::D_GUIDE:
+                    return dBufferGuide;
+                case GuidedFilterRGBD::Memory::D_OUT:
                     return dBufferOut;
             }
         }
@@ -4772,31 +12534,46 @@ namespace GF
          *        before the call to `init`, then that memory will be maintained. Otherwise, 
          *        a new memory object will be created.
          *        
-         *  \param[in] _width width of the input array to be processed.
-         *  \param[in] _height height of the input array to be processed.
+         *  \param[in] _width width of the input arrays to be processed.
+         *  \param[in] _height height of the input arrays to be processed.
          *  \param[in] _radius radius of the square filter window, i.e. \f$\ radius=filter\_width/2-1\f$.
          *  \param[in] _eps regularization parameter \f$ \epsilon \f$.
-         *  \param[in] _dScaling factor by which to scale the depth values. It's independent from the 
-         *                       scaling applied in `BoxFilterSAT`. This is another level of scaling 
-         *                       (internal to the algorithm) applied to the input array before the 
-         *                       processing by `GuidedFilter`.
+         *  \param[in] _dScaling factor by which to scale the depth values before the processing 
+         *                       by `GuidedFilter`. The output is scaled back by \f$ 1/dScaling \f$.
          *  \param[in] _staging flag to indicate whether or not to instantiate the staging buffers.
          */
-        void GuidedFilterDepth::init (
+        void GuidedFilterRGBD::init (
             unsigned int _width, unsigned int _height, int _radius, float _eps, float _dScaling, Staging _staging)
         {
+            graph.clear ();
             width = _width; height = _height; radius = _radius; eps = _eps;
-            bufferInSize = width * height * sizeof (cl_ushort);
+            bufferInRGBSize = 3 * width * height * sizeof (cl_uchar);
+            bufferInDSize = width * height * sizeof (cl_ushort);
             bufferOutSize = width * height * sizeof (cl_float);
             dScaling = _dScaling;
             staging = _staging;
 
+            try
+            {
+                if ((width * height) % 4 != 0)
+                    throw "The number of elements in the arrays has to be a multiple of 4";
+            }
+            catch (const char *error)
+            {
+                std::cerr << "Error[GuidedFilterRGBD]: " << error << std::endl;
+                exit (EXIT_FAILURE);
+            }
+
+            // Set workspaces
+            global = cl::NDRange (width * height / 4);
+
             // Create staging buffers
             bool io = false;
             switch (staging)
             {
                 case Staging::NONE:
-                    hPtrIn = nullptr;
+                    hPtrInRGB = nullptr;
+                    hPtrInD = nullptr;
                     hPtrOut = nullptr;
                     break;
 
@@ -4804,12 +12581,17 @@ namespace GF
                     io = true;
 
                 case Staging::I:
-                    if (hBufferIn () == nullptr)
-                        hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferInSize);
-
-                    hPtrIn = (cl_ushort *) queue0.enqueueMapBuffer (
-                        hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferInSize);
-                    queue0.enqueueUnmapMemObject (hBufferIn, hPtrIn);
+                    if (hBufferInRGB () == nullptr)
+                        hBufferInRGB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInRGBSize);
+                    if (hBufferInD () == nullptr)
+                        hBufferInD = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferInDSize);
+
+                    hPtrInRGB = (cl_uchar *) queue0.enqueueMapBuffer (
+                        hBufferInRGB, CL_FALSE, CL_MAP_WRITE, 0, bufferInRGBSize);
+                    hPtrInD = (cl_ushort *) queue0.enqueueMapBuffer (
+                        hBufferInD, CL_FALSE, CL_MAP_WRITE, 0, bufferInDSize);
+                    queue0.enqueueUnmapMemObject (hBufferInRGB, hPtrInRGB);
+                    queue0.enqueueUnmapMemObject (hBufferInD, hPtrInD);
 
                     if (!io)
                     {
@@ -4820,32 +12602,64 @@ namespace GF
 
                 case Staging::O:
                     if (hBufferOut () == nullptr)
-                        hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
+                        hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferOutSize);
 
                     hPtrOut = (cl_float *) queue0.enqueueMapBuffer (
                         hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferOutSize);
                     queue0.enqueueUnmapMemObject (hBufferOut, hPtrOut);
                     queue0.finish ();
 
-                    if (!io) hPtrIn = nullptr;
+                    if (!io) { hPtrInRGB = nullptr; hPtrInD = nullptr; }
                     break;
             }
             
             // Create device buffers
-            if (dBufferIn () == nullptr)
-                dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferInSize);
+            if (dBufferInRGB () == nullptr)
+                dBufferInRGB = counters.allocate (context, CL_MEM_READ_ONLY, bufferInRGBSize);
+            if (dBufferInD () == nullptr)
+                dBufferInD = counters.allocate (context, CL_MEM_READ_ONLY, bufferInDSize);
+            if (dBufferGuide () == nullptr)
+                dBufferGuide = counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
             if (dBufferOut () == nullptr)
-                dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+                dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferOutSize);
+
+            // Guide: luminance of the RGB image
+            sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_IN) = dBufferInRGB;
+            if (sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R) () == nullptr)
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R) = 
+                    counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            if (sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G) () == nullptr)
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G) = 
+                    counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            if (sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B) () == nullptr)
+                sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B) = 
+                    counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            sRGB.init (width, height, Staging::NONE);
 
-            depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_IN) = dBufferIn;
+            gray.setArg (0, sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_R));
+            gray.setArg (1, sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_G));
+            gray.setArg (2, sRGB.get (SeparateRGB<SeparateRGBConfig::UCHAR_FLOAT>::Memory::D_OUT_B));
+            gray.setArg (3, dBufferGuide);
+
+            // Input: scaled depth
+            depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_IN) = dBufferInD;
             depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_OUT) = 
-                cl::Buffer (context, CL_MEM_READ_WRITE, bufferOutSize);
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
             depth.init (width, height, dScaling, Staging::NONE);
 
-            gf.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_IN) = 
+            gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_I) = dBufferGuide;
+            gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_IN_P) = 
                 depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_OUT);
-            gf.get (GuidedFilter<GuidedFilterConfig::I_EQ_P>::Memory::D_OUT) = dBufferOut;
-            gf.init (width, height, radius, eps, 1, 1e-6f, 1.f / dScaling, Staging::NONE);
+            gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_OUT) = 
+                counters.allocate (context, CL_MEM_READ_WRITE, bufferOutSize);
+            gf.init (width, height, radius, eps, 0, 1e-6f, Staging::NONE);
+
+            // The zero_out flag of GuidedFilter<I_NEQ_P> refers to the guide,
+            // so the holes of the depth image are zeroed out separately
+            mask.setArg (0, depth.get (Depth<DepthConfig::USHORT_FLOAT>::Memory::D_OUT));
+            mask.setArg (1, gf.get (GuidedFilter<GuidedFilterConfig::I_NEQ_P>::Memory::D_OUT));
+            mask.setArg (2, dBufferOut);
+            mask.setArg (3, 1.f / dScaling);
         }
 
 
@@ -4861,17 +12675,22 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the write operation to the device buffer.
          */
-        void GuidedFilterDepth::write (GuidedFilterDepth::Memory mem, void *ptr, bool block, 
+        void GuidedFilterRGBD::write (GuidedFilterRGBD::Memory mem, void *ptr, bool block, 
             const std::vector<cl::Event> *events, cl::Event *event)
         {
             if (staging == Staging::I || staging == Staging::IO)
             {
                 switch (mem)
                 {
-                    case GuidedFilterDepth::Memory::D_IN:
+                    case GuidedFilterRGBD::Memory::D_IN_RGB:
                         if (ptr != nullptr)
-                            std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + width * height, hPtrIn);
-                        queue0.enqueueWriteBuffer (dBufferIn, block, 0, bufferInSize, hPtrIn, events, event);
+                            std::copy ((cl_uchar *) ptr, (cl_uchar *) ptr + 3 * width * height, hPtrInRGB);
+                        queue0.enqueueWriteBuffer (dBufferInRGB, block, 0, bufferInRGBSize, hPtrInRGB, events, event);
+                        break;
+                    case GuidedFilterRGBD::Memory::D_IN_D:
+                        if (ptr != nullptr)
+                            std::copy ((cl_ushort *) ptr, (cl_ushort *) ptr + width * height, hPtrInD);
+                        queue0.enqueueWriteBuffer (dBufferInD, block, 0, bufferInDSize, hPtrInD, events, event);
                         break;
                     default:
                         break;
@@ -4890,14 +12709,14 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the read operation to the staging buffer.
          */
-        void* GuidedFilterDepth::read (GuidedFilterDepth::Memory mem, bool block, 
+        void* GuidedFilterRGBD::read (GuidedFilterRGBD::Memory mem, bool block, 
             const std::vector<cl::Event> *events, cl::Event *event)
         {
             if (staging == Staging::O || staging == Staging::IO)
             {
                 switch (mem)
                 {
-                    case GuidedFilterDepth::Memory::H_OUT:
+                    case GuidedFilterRGBD::Memory::H_OUT:
                         queue0.enqueueReadBuffer (dBufferOut, block, 0, bufferOutSize, hPtrOut, events, event);
                         return hPtrOut;
                     default:
@@ -4913,16 +12732,65 @@ namespace GF
          *  \param[in] events a wait-list of events.
          *  \param[out] event event associated with the kernel execution.
          */
-        void GuidedFilterDepth::run (const std::vector<cl::Event> *events, cl::Event *event)
+        void GuidedFilterRGBD::run (const std::vector<cl::Event> *events, cl::Event *event)
         {
-            depth.run (events, &dEvent); waitList[0] = dEvent;
-            gf.run (&waitList, event);
+            Counters::Frame frame (counters, event);
+            sRGB.run (events);
+            queue0.enqueueNDRangeKernel (gray, cl::NullRange, global, cl::NullRange);
+            depth.run (events, &gEvent); waitList[0] = gEvent;
+            gf.run (&waitList);
+            queue0.enqueueNDRangeKernel (mask, cl::NullRange, global, cl::NullRange, nullptr, event);
+        }
+
+
+        /*! \details The kernels are recorded as `run` would enqueue them.
+         *
+         *  \param[in] graph graph in which to record the kernels.
+         *  \param[in] deps nodes that have to complete before the kernels execute.
+         *  \param[out] node node associated with the last kernel execution.
+         */
+        void GuidedFilterRGBD::record (
+            CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+        {
+            std::vector<CommandGraph::Node> depsGF (1);
+            sRGB.record (graph, deps);
+            graph.add (queue0, gray, cl::NullRange, global, cl::NullRange);
+            depth.record (graph, deps, &depsGF[0]);
+            gf.record (graph, &depsGF);
+            graph.add (queue0, mask, cl::NullRange, global, cl::NullRange, nullptr, node);
+        }
+
+
+        /*! \details Records the kernels in the internal `CommandGraph`, and prepares it 
+         *           for replay. It's called by `replay` when there is no recording, and the 
+         *           recording is dropped whenever a parameter changes.
+         */
+        void GuidedFilterRGBD::capture ()
+        {
+            graph.clear ();
+            record (graph);
+            graph.finalize ();
+        }
+
+
+        /*! \details Executes the same kernels as `run`, with less host overhead. 
+         *           The function call is non-blocking.
+         *
+         *  \param[in] events a wait-list of events.
+         *  \param[out] event event associated with the last kernel execution.
+         */
+        void GuidedFilterRGBD::replay (const std::vector<cl::Event> *events, cl::Event *event)
+        {
+            Counters::Frame frame (counters, event);
+            if (graph.empty ()) capture ();
+            counters.add (Counters::Counter::KERNELS, graph.size ());
+            graph.replay (events, event);
         }
 
 
         /*! \return The radius of the square filter window.
          */
-        int GuidedFilterDepth::getRadius ()
+        int GuidedFilterRGBD::getRadius ()
         {
             return radius;
         }
@@ -4932,8 +12800,9 @@ namespace GF
          *
          *  \param[in] _radius radius of the square filter window.
          */
-        void GuidedFilterDepth::setRadius (int _radius)
+        void GuidedFilterRGBD::setRadius (int _radius)
         {
+            graph.clear ();
             radius = _radius;
             gf.setRadius (radius);
         }
@@ -4941,7 +12810,7 @@ namespace GF
 
         /*! \return The regularization parameter \f$\epsilon\f$.
          */
-        float GuidedFilterDepth::getEps ()
+        float GuidedFilterRGBD::getEps ()
         {
             return eps;
         }
@@ -4951,8 +12820,9 @@ namespace GF
          *
          *  \param[in] _eps regularization parameter \f$\epsilon\f$.
          */
-        void GuidedFilterDepth::setEps (float _eps)
+        void GuidedFilterRGBD::setEps (float _eps)
         {
+            graph.clear ();
             eps = _eps;
             gf.setEps (eps);
         }
@@ -4960,21 +12830,22 @@ namespace GF
 
         /*! \return The depth scaling factor.
          */
-        float GuidedFilterDepth::getDScaling ()
+        float GuidedFilterRGBD::getDScaling ()
         {
             return dScaling;
         }
 
 
-        /*! \details Updates the kernel argument for the depth scaling factor.
+        /*! \details Updates the kernel arguments for the depth scaling factor.
          *
-         *  \param[in] _dScaling  depth scaling factor.
+         *  \param[in] _dScaling depth scaling factor.
          */
-        void GuidedFilterDepth::setDScaling (float _dScaling)
+        void GuidedFilterRGBD::setDScaling (float _dScaling)
         {
+            graph.clear ();
             dScaling = _dScaling;
             depth.setScaling (dScaling);
-            gf.setOutputScaling (1.f / dScaling);
+            mask.setArg (3, 1.f / dScaling);
         }
 
     }
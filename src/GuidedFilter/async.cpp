@@ -0,0 +1,281 @@
+/*! \file async.cpp
+ *  \brief Defines a class that manages a bounded window of
+ *         asynchronous submissions to a filter.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <CLUtils.hpp>
+#include <GuidedFilter/async.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    /*! \param[in] _window maximum number of submissions in flight.
+     */
+    AsyncWindow::AsyncWindow (unsigned int _window) :
+        window (std::max (_window, 1u)), next (0), inSize (0), outSize (0), nPending (0)
+    {
+    }
+
+
+    AsyncWindow::AsyncWindow (const AsyncWindow &other) :
+        window (other.window), next (0), inSize (0), outSize (0), nPending (0)
+    {
+    }
+
+
+    AsyncWindow& AsyncWindow::operator= (const AsyncWindow &other)
+    {
+        drain ();
+        release ();
+        window = other.window;
+        return *this;
+    }
+
+
+    AsyncWindow::~AsyncWindow ()
+    {
+        drain ();
+        release ();
+    }
+
+
+    /*! \return The maximum number of submissions in flight.
+     */
+    unsigned int AsyncWindow::getWindow ()
+    {
+        return window;
+    }
+
+
+    /*! \details Waits for the submissions in flight, and releases the slots.
+     *           The new slots are created on the next `acquire`.
+     *
+     *  \param[in] _window maximum number of submissions in flight.
+     */
+    void AsyncWindow::setWindow (unsigned int _window)
+    {
+        drain ();
+        release ();
+        window = std::max (_window, 1u);
+    }
+
+
+    /*! \details The slots are used in a round-robin fashion. When the next slot is
+     *           still in flight, the call blocks until its callback has returned.
+     *           The slots are (re)created when the sizes or the command queue change.
+     *
+     *  \param[in] _queue command queue on which the transfers are enqueued.
+     *  \param[in] _inSize size of the input staging buffer in bytes.
+     *  \param[in] _outSize size of the output staging buffer in bytes.
+     *  \return A reference to the slot.
+     */
+    AsyncWindow::Slot& AsyncWindow::acquire (cl::CommandQueue &_queue, size_t _inSize, size_t _outSize)
+    {
+        if (slots.empty () || _inSize != inSize || _outSize != outSize || _queue () != queue ())
+        {
+            drain ();
+            release ();
+            allocate (_queue, _inSize, _outSize);
+        }
+
+        std::unique_lock<std::mutex> lock (mtx);
+        Slot &slot = slots[next];
+        cv.wait (lock, [&slot] { return !slot.busy; });
+        next = (next + 1) % slots.size ();
+
+        return slot;
+    }
+
+
+    /*! \details Consecutive submissions to the same filter share its device buffers.
+     *           The first transfer of a submission has to wait for the last command
+     *           of the previous one.
+     *
+     *  \return A wait-list with the last event committed, or `nullptr` if there is none.
+     */
+    const std::vector<cl::Event>* AsyncWindow::previous ()
+    {
+        return waitList.empty () ? nullptr : &waitList;
+    }
+
+
+    /*! \details `slot.event` has to be the event of the last command of the submission
+     *           (normally, the read to `slot.hPtrOut`). The callback is registered on
+     *           that event, and the command queue is flushed.
+     *
+     *  \param[in] slot slot returned by the last call to `acquire`.
+     *  \param[in] callback function called when the submission completes.
+     */
+    void AsyncWindow::commit (Slot &slot, Callback callback)
+    {
+        slot.callback = callback;
+        waitList.assign (1, slot.event);
+
+        {
+            std::lock_guard<std::mutex> lock (mtx);
+            slot.busy = true;
+            nPending++;
+        }
+
+        slot.event.setCallback (CL_COMPLETE, &AsyncWindow::complete, &slot);
+        queue.flush ();
+    }
+
+
+    void AsyncWindow::drain ()
+    {
+        std::unique_lock<std::mutex> lock (mtx);
+        cv.wait (lock, [this] { return nPending == 0; });
+    }
+
+
+    /*! \return The number of submissions whose callbacks haven't returned yet.
+     */
+    unsigned int AsyncWindow::pending ()
+    {
+        std::lock_guard<std::mutex> lock (mtx);
+        return nPending;
+    }
+
+
+    /*! \details Adapts the callback interface to a future. The output is copied
+     *           out of the slot, so that the slot can be reused.
+     *
+     *  \param[out] out array that receives the output.
+     *  \param[in] size size of the output in bytes.
+     *  \param[out] future future that becomes ready when `out` has been filled in.
+     *                     If the submission failed, it holds a `std::runtime_error`.
+     *  \return The callback to pass to `commit`.
+     */
+    AsyncWindow::Callback AsyncWindow::deliver (void *out, size_t size, std::future<void> &future)
+    {
+        std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>> ();
+        future = promise->get_future ();
+
+        return [out, size, promise] (void *slotOut)
+        {
+            if (slotOut == nullptr)
+            {
+                promise->set_exception (std::make_exception_ptr (
+                    std::runtime_error ("AsyncWindow: The submission failed")));
+                return;
+            }
+
+            std::memcpy (out, slotOut, size);
+            promise->set_value ();
+        };
+    }
+
+
+    /*! \details The staging buffers are allocated in host accessible memory,
+     *           and stay mapped until the slots are released.
+     *
+     *  \param[in] _queue command queue on which the buffers are mapped.
+     *  \param[in] _inSize size of the input staging buffer in bytes.
+     *  \param[in] _outSize size of the output staging buffer in bytes.
+     */
+    void AsyncWindow::allocate (cl::CommandQueue &_queue, size_t _inSize, size_t _outSize)
+    {
+        queue = _queue; inSize = _inSize; outSize = _outSize;
+        cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT> ();
+
+        slots.resize (window);
+        for (Slot &slot : slots)
+        {
+            slot.hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, inSize);
+            slot.hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, outSize);
+            slot.hPtrIn = queue.enqueueMapBuffer (slot.hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, inSize);
+            slot.hPtrOut = queue.enqueueMapBuffer (slot.hBufferOut, CL_FALSE, CL_MAP_READ, 0, outSize);
+            slot.owner = this;
+            slot.busy = false;
+        }
+        queue.finish ();
+        next = 0;
+    }
+
+
+    /*! \note Call only when there are no submissions in flight.
+     */
+    void AsyncWindow::release ()
+    {
+        if (slots.empty ()) return;
+
+        for (Slot &slot : slots)
+        {
+            queue.enqueueUnmapMemObject (slot.hBufferIn, slot.hPtrIn);
+            queue.enqueueUnmapMemObject (slot.hBufferOut, slot.hPtrOut);
+        }
+        queue.finish ();
+
+        slots.clear ();
+        waitList.clear ();
+        next = 0;
+    }
+
+
+    /*! \details Invokes the callback of the slot, and frees the slot.
+     *  \note The event isn't needed; the slot holds its own reference to it.
+     *
+     *  \param[in] status execution status of the command. Negative on failure.
+     *  \param[in] data the slot.
+     */
+    void CL_CALLBACK AsyncWindow::complete (cl_event /* event */, cl_int status, void *data)
+    {
+        Slot &slot = *(Slot *) data;
+        AsyncWindow &owner = *slot.owner;
+
+        try
+        {
+            slot.callback ((status == CL_COMPLETE) ? slot.hPtrOut : nullptr);
+        }
+        catch (const std::exception &error)
+        {
+            std::cerr << "Error[AsyncWindow]: The submission callback threw: " << error.what () << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Error[AsyncWindow]: The submission callback threw an exception" << std::endl;
+        }
+        slot.callback = nullptr;
+
+        // Notify under the lock, so that the owner can't be destroyed in between
+        std::lock_guard<std::mutex> lock (owner.mtx);
+        slot.busy = false;
+        owner.nPending--;
+        owner.cv.notify_all ();
+    }
+
+}
+}
@@ -0,0 +1,468 @@
+/*! \file cache.cpp
+ *  \brief Defines a persistent cache of the guide statistics of the `Guided Filter`.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <GuidedFilter/cache.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    namespace
+    {
+        /*! \brief The header of an entry file, followed by \f$ \bar{I} \f$ and \f$ \sigma_I^2+\epsilon \f$. */
+        struct Header
+        {
+            char magic[8];
+            uint64_t hash;
+            uint32_t width, height;
+            int32_t radius;
+            float eps;
+            uint64_t reserved[4];
+        };
+
+        static_assert (sizeof (Header) == 64, "Unexpected Header layout");
+
+        const char magic[8] = { 'G', 'F', 'G', 'U', 'I', 'D', 'E', '1' };
+        const std::string suffix = ".gfc";
+        const std::string tmpInfix = suffix + ".tmp-";
+
+        /*! \brief Age (in seconds) after which a temporary file is taken to be left over by a failed store. */
+        const int64_t staleAge = 10 * 60;
+
+        /*! \brief Throws a `std::runtime_error` with the description of `errno`. */
+        void fail (const std::string &what)
+        {
+            throw std::runtime_error ("GuideCache: " + what + ": " + std::strerror (errno));
+        }
+
+        /*! \brief Scrambles the bits of a word (the finalizer of MurmurHash3). */
+        uint64_t mix (uint64_t v)
+        {
+            v ^= v >> 33; v *= 0xff51afd7ed558ccdull;
+            v ^= v >> 33; v *= 0xc4ceb9fe1a85ec53ull;
+            v ^= v >> 33;
+            return v;
+        }
+
+        /*! \brief Returns the size of the entry file of a key. */
+        size_t entrySize (const GuideCache::Key &key)
+        {
+            return sizeof (Header) + 2 * (size_t) key.width * key.height * sizeof (float);
+        }
+
+        /*! \brief Checks whether an entry file belongs to a key. */
+        bool matches (const Header &header, const GuideCache::Key &key)
+        {
+            return std::memcmp (header.magic, magic, sizeof (magic)) == 0 && 
+                   header.hash == key.hash && header.width == key.width && 
+                   header.height == key.height && header.radius == key.radius && 
+                   std::memcmp (&header.eps, &key.eps, sizeof (float)) == 0;
+        }
+
+        /*! \brief Writes a whole array to a file. */
+        bool writeAll (int fd, const void *buf, size_t n)
+        {
+            const char *p = (const char *) buf;
+            while (n > 0)
+            {
+                ssize_t k = ::write (fd, p, n);
+                if (k < 0 && errno == EINTR) continue;
+                if (k <= 0) return false;
+                p += k; n -= k;
+            }
+            return true;
+        }
+    }
+
+
+    GuideCache::Entry::Entry () : ptr (nullptr), size (0), n (0)
+    {
+    }
+
+
+    GuideCache::Entry::~Entry ()
+    {
+        if (ptr != nullptr) munmap (ptr, size);
+    }
+
+
+    GuideCache::Entry::Entry (Entry &&other) : ptr (other.ptr), size (other.size), n (other.n)
+    {
+        other.ptr = nullptr;
+    }
+
+
+    GuideCache::Entry& GuideCache::Entry::operator= (Entry &&other)
+    {
+        if (this != &other)
+        {
+            if (ptr != nullptr) munmap (ptr, size);
+            ptr = other.ptr; size = other.size; n = other.n;
+            other.ptr = nullptr;
+        }
+        return *this;
+    }
+
+
+    const float* GuideCache::Entry::mean () const
+    {
+        return (const float *) ((const char *) ptr + sizeof (Header));
+    }
+
+
+    const float* GuideCache::Entry::var () const
+    {
+        return mean () + n;
+    }
+
+
+    /*! \details The directory is created, if it doesn't exist (its parent has to).
+     *  \note Throws a `std::runtime_error`, if the directory can't be created.
+     *
+     *  \param[in] _directory directory of the entry files.
+     *  \param[in] _maxBytes size limit of the cache in bytes.
+     *  \param[in] _eviction eviction policy.
+     */
+    GuideCache::GuideCache (const std::string &_directory, size_t _maxBytes, GuideCacheEviction _eviction) : 
+        directory (_directory), maxBytes (_maxBytes), eviction (_eviction)
+    {
+        struct stat st;
+        if (mkdir (directory.c_str (), 0755) != 0 && errno != EEXIST) fail ("mkdir " + directory);
+        if (stat (directory.c_str (), &st) != 0) fail ("stat " + directory);
+        if (!S_ISDIR (st.st_mode))
+            throw std::runtime_error ("GuideCache: " + directory + " is not a directory");
+    }
+
+
+    /*! \details The contents are hashed eight bytes at a time, 
+     *           which costs much less than the statistics themselves.
+     *
+     *  \param[in] guide guidance image.
+     *  \param[in] width width of the guidance image.
+     *  \param[in] height height of the guidance image.
+     *  \param[in] radius radius of the filter window.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \return The key of the guide.
+     */
+    GuideCache::Key GuideCache::key (const float *guide, unsigned int width, unsigned int height, 
+                                     int radius, float eps)
+    {
+        const unsigned char *bytes = (const unsigned char *) guide;
+        size_t n = (size_t) width * height * sizeof (float);
+
+        uint64_t h = mix (n), v;
+        size_t i = 0;
+        for (; i + sizeof (v) <= n; i += sizeof (v))
+        {
+            std::memcpy (&v, bytes + i, sizeof (v));
+            h = (h ^ mix (v)) * 0x100000001b3ull;
+        }
+        v = 0;
+        std::memcpy (&v, bytes + i, n - i);
+
+        Key key;
+        key.hash = mix (h ^ mix (v));
+        key.width = width; key.height = height;
+        key.radius = radius; key.eps = eps;
+        return key;
+    }
+
+
+    /*! \details On a hit, the entry file is mapped (read-only) in `entry`, 
+     *           and, with `LRU`, its modification time is updated.
+     *
+     *  \param[in] key key of the guide.
+     *  \param[out] entry mapping of the statistics of the guide (on a hit).
+     *  \return Whether the statistics of the guide were found.
+     */
+    bool GuideCache::lookup (const Key &key, Entry &entry)
+    {
+        int fd = open (path (key).c_str (), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        size_t size = entrySize (key);
+        if (fstat (fd, &st) != 0 || (size_t) st.st_size != size)
+        {
+            close (fd);
+            return false;
+        }
+
+        void *ptr = mmap (nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED && eviction == GuideCacheEviction::LRU)
+            futimens (fd, nullptr);
+        close (fd);
+        if (ptr == MAP_FAILED) return false;
+
+        if (!matches (*(const Header *) ptr, key))
+        {
+            munmap (ptr, size);
+            return false;
+        }
+
+        Entry hit;
+        hit.ptr = ptr; hit.size = size;
+        hit.n = (size_t) key.width * key.height;
+        entry = std::move (hit);
+
+        return true;
+    }
+
+
+    /*! \details The entry is written to a temporary file, which is renamed into place. 
+     *           Then, other entries are evicted, if the cache exceeds `maxBytes`.
+     *  \note A failure to store (e.g. a full disk) isn't an error for the caller. 
+     *        The statistics just aren't cached.
+     *
+     *  \param[in] key key of the guide.
+     *  \param[in] mean average \f$ I \f$ values, \f$ \bar{I} \f$.
+     *  \param[in] var regularized variance of the guide, \f$ \sigma_I^2+\epsilon \f$.
+     *  \return Whether the entry was stored. It isn't, if it's larger than `maxBytes`, 
+     *          or if the cache is full and the eviction policy is `NONE`.
+     */
+    bool GuideCache::store (const Key &key, const float *mean, const float *var)
+    {
+        size_t size = entrySize (key);
+        if (size > maxBytes) return false;
+        if (eviction == GuideCacheEviction::NONE && this->size () + size > maxBytes) return false;
+
+        static std::atomic<unsigned int> counter (0);
+        std::string file = path (key);
+        std::ostringstream ss;
+        ss << file << ".tmp-" << getpid () << "-" << counter++;
+        std::string tmp = ss.str ();
+
+        int fd = open (tmp.c_str (), O_CREAT | O_EXCL | O_WRONLY, 0644);
+        if (fd < 0) return false;
+
+        Header header;
+        std::memset (&header, 0, sizeof (header));
+        std::memcpy (header.magic, magic, sizeof (magic));
+        header.hash = key.hash;
+        header.width = key.width; header.height = key.height;
+        header.radius = key.radius; header.eps = key.eps;
+
+        size_t n = (size_t) key.width * key.height;
+        bool ok = writeAll (fd, &header, sizeof (header)) && 
+                  writeAll (fd, mean, n * sizeof (float)) && 
+                  writeAll (fd, var, n * sizeof (float));
+        ok = (close (fd) == 0) && ok;
+        if (!ok || rename (tmp.c_str (), file.c_str ()) != 0)
+        {
+            unlink (tmp.c_str ());
+            return false;
+        }
+
+        trim (file);
+
+        return true;
+    }
+
+
+    /*! \details It has no effect with the `NONE` policy.
+     */
+    void GuideCache::evict ()
+    {
+        trim (std::string ());
+    }
+
+
+    /*! \details Entries mapped by processes stay valid until they are unmapped.
+     */
+    void GuideCache::clear ()
+    {
+        for (const File &file : list ())
+            unlink (file.path.c_str ());
+    }
+
+
+    /*! \return The total size of the entries in bytes.
+     */
+    size_t GuideCache::size ()
+    {
+        size_t total = 0;
+        for (const File &file : list ())
+            total += file.size;
+        return total;
+    }
+
+
+    /*! \return The number of entries.
+     */
+    size_t GuideCache::entries ()
+    {
+        return list ().size ();
+    }
+
+
+    /*! \return The size limit in bytes.
+     */
+    size_t GuideCache::getMaxBytes ()
+    {
+        return maxBytes;
+    }
+
+
+    /*! \details The limit is applied on the next store, or by `evict`.
+     *
+     *  \param[in] _maxBytes size limit in bytes.
+     */
+    void GuideCache::setMaxBytes (size_t _maxBytes)
+    {
+        maxBytes = _maxBytes;
+    }
+
+
+    /*! \return The eviction policy.
+     */
+    GuideCacheEviction GuideCache::getEviction ()
+    {
+        return eviction;
+    }
+
+
+    /*! \param[in] _eviction eviction policy.
+     */
+    void GuideCache::setEviction (GuideCacheEviction _eviction)
+    {
+        eviction = _eviction;
+    }
+
+
+    /*! \details The name holds the whole key, so different 
+     *           parameters of the same guide are different entries.
+     *
+     *  \param[in] key key of a guide.
+     *  \return The path of the entry file.
+     */
+    std::string GuideCache::path (const Key &key)
+    {
+        uint32_t eps;
+        std::memcpy (&eps, &key.eps, sizeof (eps));
+
+        std::ostringstream ss;
+        ss << directory << "/" << std::hex << std::setfill ('0') << std::setw (16) << key.hash 
+           << std::dec << "-" << key.width << "x" << key.height << "-r" << key.radius 
+           << "-e" << std::hex << std::setw (8) << eps << suffix;
+        return ss.str ();
+    }
+
+
+    /*! \details Files that disappear during the listing (evicted by 
+     *           other processes) are skipped.
+     *  \details Temporary files of stores aren't entries. The ones that haven't been 
+     *           modified for `staleAge` seconds were left over by stores that didn't 
+     *           finish (e.g. the process was killed), and are removed. The rest 
+     *           belong to stores in progress, and are left alone.
+     *
+     *  \return The entry files, by increasing modification time.
+     */
+    std::vector<GuideCache::File> GuideCache::list ()
+    {
+        std::vector<File> files;
+
+        DIR *dir = opendir (directory.c_str ());
+        if (dir == nullptr) return files;
+
+        int64_t now = (int64_t) std::time (nullptr);
+        while (dirent *de = readdir (dir))
+        {
+            std::string name = de->d_name;
+            bool tmp = name.find (tmpInfix) != std::string::npos;
+            if (!tmp && (name.size () <= suffix.size () || 
+                name.compare (name.size () - suffix.size (), suffix.size (), suffix) != 0))
+                continue;
+
+            File file;
+            struct stat st;
+            file.path = directory + "/" + name;
+            if (stat (file.path.c_str (), &st) != 0) continue;
+            if (tmp)
+            {
+                if (now - (int64_t) st.st_mtime > staleAge) unlink (file.path.c_str ());
+                continue;
+            }
+            file.size = st.st_size;
+#if defined(__APPLE__) || defined(__MACOSX)
+            file.time = (int64_t) st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+            file.time = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+            files.push_back (file);
+        }
+        closedir (dir);
+
+        std::sort (files.begin (), files.end (), 
+                   [] (const File &a, const File &b) { return a.time < b.time; });
+
+        return files;
+    }
+
+
+    /*! \details Removes the oldest (by modification time) entries, until the 
+     *           cache is within `maxBytes`. With `LRU`, the modification time 
+     *           is the time of the last hit, and with `FIFO`, of the store.
+     *
+     *  \param[in] keep path of an entry that isn't evicted (the one just stored).
+     */
+    void GuideCache::trim (const std::string &keep)
+    {
+        if (eviction == GuideCacheEviction::NONE) return;
+
+        std::vector<File> files = list ();
+        size_t total = 0;
+        for (const File &file : files)
+            total += file.size;
+
+        for (const File &file : files)
+        {
+            if (total <= maxBytes) break;
+            if (file.path == keep) continue;
+            if (unlink (file.path.c_str ()) == 0 || errno == ENOENT)
+                total -= file.size;
+        }
+    }
+
+}
+}
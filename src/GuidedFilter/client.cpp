@@ -0,0 +1,221 @@
+/*! \file client.cpp
+ *  \brief Defines a client for the local `Guided Filter` service.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <sstream>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <GuidedFilter/service.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    namespace
+    {
+        /*! \brief Throws a `std::runtime_error` with the description of `errno`. */
+        void fail (const std::string &what)
+        {
+            throw std::runtime_error ("GuidedFilterClient: " + what + ": " + std::strerror (errno));
+        }
+
+        /*! \brief Writes a whole message to a stream socket. */
+        void sendAll (int fd, const void *buf, size_t n)
+        {
+            const char *p = (const char *) buf;
+            while (n > 0)
+            {
+                ssize_t k = ::send (fd, p, n, MSG_NOSIGNAL);
+                if (k < 0 && errno == EINTR) continue;
+                if (k <= 0) fail ("send");
+                p += k; n -= k;
+            }
+        }
+
+        /*! \brief Reads a whole message from a stream socket. */
+        void recvAll (int fd, void *buf, size_t n)
+        {
+            char *p = (char *) buf;
+            while (n > 0)
+            {
+                ssize_t k = ::recv (fd, p, n, 0);
+                if (k < 0 && errno == EINTR) continue;
+                if (k == 0) throw std::runtime_error ("GuidedFilterClient: The service closed the connection");
+                if (k < 0) fail ("recv");
+                p += k; n -= k;
+            }
+        }
+    }
+
+
+    /*! \details The segment is created with a unique name, and is unlinked right after
+     *           the service has mapped it, so it disappears with the last mapping.
+     *  \note Throws a `std::runtime_error`, if the service can't be reached,
+     *        or if it fails to map the segment.
+     *
+     *  \param[in] _size size of the shared segment in bytes.
+     *  \param[in] socketPath path of the control socket of the service.
+     */
+    GuidedFilterClient::GuidedFilterClient (size_t _size, const std::string &socketPath) :
+        fd (-1), ptr (nullptr), segmentSize (_size), nextId (0)
+    {
+        static std::atomic<unsigned int> counter (0);
+        std::ostringstream ss;
+        ss << "/gf-" << getpid () << "-" << counter++;
+        std::string name = ss.str ();
+
+        // Create the segment
+        int shm = shm_open (name.c_str (), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (shm < 0) fail ("shm_open");
+        if (ftruncate (shm, segmentSize) != 0)
+        {
+            close (shm); shm_unlink (name.c_str ());
+            fail ("ftruncate");
+        }
+        ptr = mmap (nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+        close (shm);
+        if (ptr == MAP_FAILED)
+        {
+            ptr = nullptr; shm_unlink (name.c_str ());
+            fail ("mmap");
+        }
+
+        try
+        {
+            // Connect to the service
+            sockaddr_un addr;
+            std::memset (&addr, 0, sizeof (addr));
+            addr.sun_family = AF_UNIX;
+            if (socketPath.size () >= sizeof (addr.sun_path))
+                throw std::runtime_error ("GuidedFilterClient: The socket path is too long");
+            std::strcpy (addr.sun_path, socketPath.c_str ());
+
+            fd = socket (AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) fail ("socket");
+            if (connect (fd, (sockaddr *) &addr, sizeof (addr)) != 0) fail ("connect to " + socketPath);
+
+            // Attach the segment
+            ServiceRequest req;
+            std::memset (&req, 0, sizeof (req));
+            req.op = (uint32_t) ServiceOp::ATTACH;
+            req.id = nextId++;
+            req.size = segmentSize;
+            std::strncpy (req.name, name.c_str (), sizeof (req.name) - 1);
+            sendAll (fd, &req, sizeof (req));
+
+            ServiceReply reply;
+            recvAll (fd, &reply, sizeof (reply));
+            if (reply.status != (uint32_t) ServiceStatus::OK)
+                throw std::runtime_error ("GuidedFilterClient: The service couldn't map the segment");
+        }
+        catch (...)
+        {
+            shm_unlink (name.c_str ());
+            munmap (ptr, segmentSize);
+            if (fd >= 0) close (fd);
+            throw;
+        }
+
+        shm_unlink (name.c_str ());
+    }
+
+
+    GuidedFilterClient::~GuidedFilterClient ()
+    {
+        close (fd);
+        munmap (ptr, segmentSize);
+    }
+
+
+    void* GuidedFilterClient::data ()
+    {
+        return ptr;
+    }
+
+
+    size_t GuidedFilterClient::size ()
+    {
+        return segmentSize;
+    }
+
+
+    /*! \details The input has to be in place before the call, and neither the input
+     *           nor the output should be touched until the reply has been received.
+     *
+     *  \param[in] width width of the frame (a multiple of `serviceAlignment`).
+     *  \param[in] height height of the frame (a multiple of `serviceAlignment`).
+     *  \param[in] radius radius of the filter window.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \param[in] inOffset offset of the `width*height` `float` input in the segment, in bytes.
+     *  \param[in] outOffset offset of the `width*height` `float` output in the segment, in bytes.
+     *  \return The identifier of the request, which the reply carries.
+     */
+    uint32_t GuidedFilterClient::send (unsigned int width, unsigned int height, int radius, float eps,
+                                       size_t inOffset, size_t outOffset)
+    {
+        ServiceRequest req;
+        std::memset (&req, 0, sizeof (req));
+        req.op = (uint32_t) ServiceOp::FILTER;
+        req.id = nextId++;
+        req.width = width; req.height = height;
+        req.radius = radius; req.eps = eps;
+        req.inOffset = inOffset; req.outOffset = outOffset;
+        sendAll (fd, &req, sizeof (req));
+
+        return req.id;
+    }
+
+
+    ServiceReply GuidedFilterClient::receive ()
+    {
+        ServiceReply reply;
+        recvAll (fd, &reply, sizeof (reply));
+        return reply;
+    }
+
+
+    /*! \note Don't mix with `send`/`receive` while requests are in flight,
+     *        since the next reply would be returned.
+     */
+    ServiceReply GuidedFilterClient::filter (unsigned int width, unsigned int height, int radius, float eps,
+                                             size_t inOffset, size_t outOffset)
+    {
+        send (width, height, radius, eps, inOffset, outOffset);
+        return receive ();
+    }
+
+}
+}
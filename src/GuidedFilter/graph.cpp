@@ -0,0 +1,355 @@
+/*! \file graph.cpp
+ *  \brief Defines a class that records a sequence of kernel executions 
+ *         once, and replays it many times.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <CLUtils.hpp>
+#include <GuidedFilter/graph.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+#ifdef cl_khr_command_buffer
+
+    /*! \brief Holds the `cl_khr_command_buffer` entry points and handle. */
+    struct CommandGraph::Native
+    {
+        clCreateCommandBufferKHR_fn create;
+        clCommandNDRangeKernelKHR_fn command;
+        clFinalizeCommandBufferKHR_fn finalize;
+        clEnqueueCommandBufferKHR_fn enqueue;
+        clReleaseCommandBufferKHR_fn release;
+        cl_command_buffer_khr buffer;
+    };
+
+#else
+
+    struct CommandGraph::Native {};
+
+#endif
+
+
+    CommandGraph::CommandGraph () : finalized (false), native (nullptr)
+    {
+    }
+
+
+    CommandGraph::CommandGraph (const CommandGraph&) : finalized (false), native (nullptr)
+    {
+    }
+
+
+    CommandGraph& CommandGraph::operator= (const CommandGraph&)
+    {
+        clear ();
+        return *this;
+    }
+
+
+    CommandGraph::~CommandGraph ()
+    {
+        clear ();
+    }
+
+
+    /*! \details The arguments mirror those of `cl::CommandQueue::enqueueNDRangeKernel`.
+     *
+     *  \param[in] queue command queue on which the kernel executes.
+     *  \param[in] kernel the kernel to execute.
+     *  \param[in] offset global workspace offset.
+     *  \param[in] global global workspace.
+     *  \param[in] local local workspace.
+     *  \param[in] deps nodes (on any command queue) that have to complete before this one.
+     *  \param[out] node handle of the recorded node.
+     */
+    void CommandGraph::add (cl::CommandQueue &queue, cl::Kernel &kernel, 
+                            const cl::NDRange &offset, const cl::NDRange &global, const cl::NDRange &local, 
+                            const std::vector<Node> *deps, Node *node)
+    {
+        if (finalized)
+        {
+            releaseNative ();
+            finalized = false;
+        }
+
+        Command c;
+        c.queue = queue;
+        c.kernel = kernel;
+        c.dims = global.dimensions ();
+        c.hasOffset = offset.dimensions () != 0;
+        c.hasLocal = local.dimensions () != 0;
+        for (cl_uint i = 0; i < 3; ++i)
+        {
+            c.offset[i] = (i < offset.dimensions ()) ? ((const size_t *) offset)[i] : 0;
+            c.global[i] = (i < global.dimensions ()) ? ((const size_t *) global)[i] : 1;
+            c.local[i] = (i < local.dimensions ()) ? ((const size_t *) local)[i] : 1;
+        }
+        if (deps != nullptr) c.deps = *deps;
+
+        commands.push_back (c);
+        if (node != nullptr) *node = commands.size () - 1;
+    }
+
+
+    /*! \details Works out, for every node, which of its dependencies need 
+     *           an event, and builds the `cl_khr_command_buffer`, if possible.
+     */
+    void CommandGraph::finalize ()
+    {
+        if (finalized) return;
+
+        size_t n = commands.size ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            Command &c = commands[i];
+            c.first = true;
+            c.signal = (i == n - 1);  // The last node provides the output event
+            c.waitNodes.clear ();
+            for (size_t j = 0; j < i; ++j)
+                if (commands[j].queue () == c.queue ()) { c.first = false; break; }
+        }
+
+        // Dependencies on the same command queue are satisfied by the in-order execution
+        for (size_t i = 0; i < n; ++i)
+        {
+            Command &c = commands[i];
+            for (Node d : c.deps)
+            {
+                if (commands[d].queue () == c.queue ()) continue;
+                commands[d].signal = true;
+                c.waitNodes.push_back (d);
+            }
+        }
+
+        events.assign (n, nullptr);
+        finalized = true;
+
+        buildNative ();
+    }
+
+
+    /*! \details The first node on each command queue waits on `events`. 
+     *           The function call is non-blocking.
+     *
+     *  \param[in] events a wait-list of events.
+     *  \param[out] event event associated with the last recorded node.
+     */
+    void CommandGraph::replay (const std::vector<cl::Event> *events, cl::Event *event)
+    {
+        if (!finalized) finalize ();
+        if (commands.empty ()) return;
+
+        size_t nEvents = (events != nullptr) ? events->size () : 0;
+
+#ifdef cl_khr_command_buffer
+        if (native != nullptr)
+        {
+            std::vector<cl_event> waitList (nEvents);
+            for (size_t e = 0; e < nEvents; ++e)
+                waitList[e] = (*events)[e] ();
+
+            cl_event out = nullptr;
+            cl_int err = native->enqueue (0, nullptr, native->buffer, (cl_uint) nEvents, 
+                                          nEvents ? waitList.data () : nullptr, 
+                                          (event != nullptr) ? &out : nullptr);
+            if (err != CL_SUCCESS)
+                throw cl::Error (err, "clEnqueueCommandBufferKHR");
+
+            if (event != nullptr) *event = cl::Event (out);
+            return;
+        }
+#endif
+
+        size_t n = commands.size ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            Command &c = commands[i];
+
+            c.waitList.clear ();
+            if (c.first)
+                for (size_t e = 0; e < nEvents; ++e)
+                    c.waitList.push_back ((*events)[e] ());
+            for (Node d : c.waitNodes)
+                c.waitList.push_back (this->events[d]);
+
+            cl_int err = clEnqueueNDRangeKernel (
+                c.queue (), c.kernel (), c.dims, c.hasOffset ? c.offset : nullptr, c.global, 
+                c.hasLocal ? c.local : nullptr, (cl_uint) c.waitList.size (), 
+                c.waitList.empty () ? nullptr : c.waitList.data (), c.signal ? &this->events[i] : nullptr);
+            if (err != CL_SUCCESS)
+                throw cl::Error (err, "clEnqueueNDRangeKernel");
+        }
+
+        // The output event is handed over, and the rest are released
+        if (event != nullptr)
+        {
+            *event = cl::Event (this->events[n - 1]);
+            this->events[n - 1] = nullptr;
+        }
+
+        for (cl_event &e : this->events)
+        {
+            if (e != nullptr) clReleaseEvent (e);
+            e = nullptr;
+        }
+    }
+
+
+    /*! \details Releases the `cl_khr_command_buffer`, if there is one.
+     */
+    void CommandGraph::clear ()
+    {
+        releaseNative ();
+        commands.clear ();
+        events.clear ();
+        finalized = false;
+    }
+
+
+    /*! \return Whether the graph has no nodes.
+     */
+    bool CommandGraph::empty ()
+    {
+        return commands.empty ();
+    }
+
+
+    /*! \return The number of nodes.
+     */
+    size_t CommandGraph::size ()
+    {
+        return commands.size ();
+    }
+
+
+    /*! \return Whether the graph replays through a `cl_khr_command_buffer`.
+     */
+    bool CommandGraph::isNative ()
+    {
+        return native != nullptr;
+    }
+
+
+    /*! \details All nodes are recorded on the command-buffer of the first command queue. 
+     *           The order of the nodes on each command queue, and the dependencies 
+     *           between command queues, are expressed with sync-points, so independent 
+     *           branches can still overlap. On any failure, the pre-built enqueue list is used.
+     *
+     *  \return Whether the command-buffer was built.
+     */
+    bool CommandGraph::buildNative ()
+    {
+#ifdef cl_khr_command_buffer
+        if (commands.empty ()) return false;
+
+        cl::Device device = commands[0].queue.getInfo<CL_QUEUE_DEVICE> ();
+        if (device.getInfo<CL_DEVICE_EXTENSIONS> ().find ("cl_khr_command_buffer") == std::string::npos)
+            return false;
+
+        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM> ();
+        Native *nat = new Native;
+        nat->create = (clCreateCommandBufferKHR_fn) 
+            clGetExtensionFunctionAddressForPlatform (platform, "clCreateCommandBufferKHR");
+        nat->command = (clCommandNDRangeKernelKHR_fn) 
+            clGetExtensionFunctionAddressForPlatform (platform, "clCommandNDRangeKernelKHR");
+        nat->finalize = (clFinalizeCommandBufferKHR_fn) 
+            clGetExtensionFunctionAddressForPlatform (platform, "clFinalizeCommandBufferKHR");
+        nat->enqueue = (clEnqueueCommandBufferKHR_fn) 
+            clGetExtensionFunctionAddressForPlatform (platform, "clEnqueueCommandBufferKHR");
+        nat->release = (clReleaseCommandBufferKHR_fn) 
+            clGetExtensionFunctionAddressForPlatform (platform, "clReleaseCommandBufferKHR");
+
+        if (!nat->create || !nat->command || !nat->finalize || !nat->enqueue || !nat->release)
+        {
+            delete nat;
+            return false;
+        }
+
+        cl_int err;
+        cl_command_queue queue = commands[0].queue ();
+        nat->buffer = nat->create (1, &queue, nullptr, &err);
+        if (err != CL_SUCCESS)
+        {
+            delete nat;
+            return false;
+        }
+
+        size_t n = commands.size ();
+        std::vector<cl_sync_point_khr> syncPoints (n);
+        for (size_t i = 0; i < n && err == CL_SUCCESS; ++i)
+        {
+            Command &c = commands[i];
+
+            std::vector<cl_sync_point_khr> waitList;
+            for (size_t j = i; j-- > 0; )
+                if (commands[j].queue () == c.queue ()) { waitList.push_back (syncPoints[j]); break; }
+            for (Node d : c.waitNodes)
+                waitList.push_back (syncPoints[d]);
+
+            err = nat->command (nat->buffer, nullptr, nullptr, c.kernel (), c.dims, 
+                                c.hasOffset ? c.offset : nullptr, c.global, c.hasLocal ? c.local : nullptr, 
+                                (cl_uint) waitList.size (), waitList.empty () ? nullptr : waitList.data (), 
+                                &syncPoints[i], nullptr);
+        }
+
+        if (err == CL_SUCCESS)
+            err = nat->finalize (nat->buffer);
+
+        if (err != CL_SUCCESS)
+        {
+            nat->release (nat->buffer);
+            delete nat;
+            return false;
+        }
+
+        native = nat;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+
+    void CommandGraph::releaseNative ()
+    {
+#ifdef cl_khr_command_buffer
+        if (native != nullptr)
+        {
+            native->release (native->buffer);
+            delete native;
+        }
+#endif
+        native = nullptr;
+    }
+
+}
+}
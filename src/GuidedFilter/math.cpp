@@ -54,9 +54,9 @@ namespace Math
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
     Mult::Mult (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+        counters ("Mult"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
         kernel (env.getProgram (info.pgIdx), "mult")
     {
     }
@@ -133,9 +133,9 @@ namespace Math
 
             case Staging::I:
                 if (hBufferInA () == nullptr)
-                    hBufferInA = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferInA = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
                 if (hBufferInB () == nullptr)
-                    hBufferInB = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferInB = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrInA = (cl_float *) queue.enqueueMapBuffer (
                     hBufferInA, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
@@ -153,7 +153,7 @@ namespace Math
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
@@ -170,11 +170,11 @@ namespace Math
         
         // Create device buffers
         if (dBufferInA () == nullptr)
-            dBufferInA = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+            dBufferInA = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferInB () == nullptr)
-            dBufferInB = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+            dBufferInB = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferInA);
@@ -252,17 +252,31 @@ namespace Math
      */
     void Mult::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void Mult::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernel, cl::NullRange, global, cl::NullRange, deps, node);
+    }
+
+
     /*! \param[in] _env opencl environment.
      *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
      */
     Pown::Pown (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info) : 
-        env (_env), info (_info), 
+        counters ("Pown"), env (_env), info (_info), 
         context (env.getContext (info.pIdx)), 
-        queue (env.getQueue (info.ctxIdx, info.qIdx[0])), 
+        queue (env.getQueue (info.ctxIdx, info.qIdx[0]), counters), 
         kernel (env.getProgram (info.pgIdx), "pown_")
     {
     }
@@ -335,7 +349,7 @@ namespace Math
 
             case Staging::I:
                 if (hBufferIn () == nullptr)
-                    hBufferIn = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferIn = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrIn = (cl_float *) queue.enqueueMapBuffer (
                     hBufferIn, CL_FALSE, CL_MAP_WRITE, 0, bufferSize);
@@ -350,7 +364,7 @@ namespace Math
 
             case Staging::O:
                 if (hBufferOut () == nullptr)
-                    hBufferOut = cl::Buffer (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
+                    hBufferOut = counters.allocate (context, CL_MEM_ALLOC_HOST_PTR, bufferSize);
 
                 hPtrOut = (cl_float *) queue.enqueueMapBuffer (
                     hBufferOut, CL_FALSE, CL_MAP_READ, 0, bufferSize);
@@ -366,9 +380,9 @@ namespace Math
         
         // Create device buffers
         if (dBufferIn () == nullptr)
-            dBufferIn = cl::Buffer (context, CL_MEM_READ_ONLY, bufferSize);
+            dBufferIn = counters.allocate (context, CL_MEM_READ_ONLY, bufferSize);
         if (dBufferOut () == nullptr)
-            dBufferOut = cl::Buffer (context, CL_MEM_WRITE_ONLY, bufferSize);
+            dBufferOut = counters.allocate (context, CL_MEM_WRITE_ONLY, bufferSize);
 
         // Set kernel arguments
         kernel.setArg (0, dBufferIn);
@@ -441,10 +455,24 @@ namespace Math
      */
     void Pown::run (const std::vector<cl::Event> *events, cl::Event *event)
     {
+        Counters::Frame frame (counters, event);
         queue.enqueueNDRangeKernel (kernel, cl::NullRange, global, cl::NullRange, events, event);
     }
 
 
+    /*! \details The kernels are recorded as `run` would enqueue them.
+     *
+     *  \param[in] graph graph in which to record the kernels.
+     *  \param[in] deps nodes that have to complete before the kernels execute.
+     *  \param[out] node node associated with the last kernel execution.
+     */
+    void Pown::record (
+        CommandGraph &graph, const std::vector<CommandGraph::Node> *deps, CommandGraph::Node *node)
+    {
+        graph.add (queue, kernel, cl::NullRange, global, cl::NullRange, deps, node);
+    }
+
+
     /*! \return The power.
      */
     int Pown::getPower ()
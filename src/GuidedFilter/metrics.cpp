@@ -0,0 +1,498 @@
+/*! \file metrics.cpp
+ *  \brief Defines the runtime counters of the `cl_algo::GF` classes.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <algorithm>
+#include <GuidedFilter/metrics.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    typedef Counters::Counter Counter;
+
+    struct Counters::Block
+    {
+        Block (const std::string &_name, std::shared_ptr<Block> _parent);
+        ~Block ();
+        /*! \brief Adds to a counter of the block and of its ancestors. */
+        void add (Counter counter, uint64_t value, bool self = true);
+        /*! \brief Returns the block of the top-level instance that contains this one. */
+        Block* top ();
+
+        std::string name;
+        unsigned int id;
+        std::shared_ptr<Block> parent;
+        std::atomic<uint64_t> values[(size_t) Counter::COUNT];
+        std::atomic<uint64_t> ownDeviceMemory, ownHostMemory;
+        std::atomic<unsigned int> timingPeriod;  // Of a top-level instance
+        std::atomic<uint64_t> nFrames;
+        std::atomic<int> timing;  // 0: frame not timed, 1: timed, 2: timed and kernels seen
+    };
+
+
+    namespace
+    {
+        std::mutex& registryMutex ()
+        {
+            static std::mutex mtx;
+            return mtx;
+        }
+
+        /*! \brief The live blocks, for `dump`. */
+        std::vector<Counters::Block *>& registry ()
+        {
+            static std::vector<Counters::Block *> blocks;
+            return blocks;
+        }
+
+        /*! \brief Describes a counter in the exposition format. */
+        struct Metric
+        {
+            Counter counter;
+            const char *name, *type, *help;
+            double scale;
+        };
+
+        const Metric metrics[] = {
+            { Counter::KERNELS, "gf_kernels_total", "counter", "Kernels enqueued.", 0.0 },
+            { Counter::WRITES, "gf_writes_total", "counter", "Host to device transfers.", 0.0 },
+            { Counter::WRITE_BYTES, "gf_write_bytes_total", "counter", "Bytes transferred from the host to the device.", 0.0 },
+            { Counter::READS, "gf_reads_total", "counter", "Device to host transfers.", 0.0 },
+            { Counter::READ_BYTES, "gf_read_bytes_total", "counter", "Bytes transferred from the device to the host.", 0.0 },
+            { Counter::MAPS, "gf_maps_total", "counter", "Buffer mappings.", 0.0 },
+            { Counter::UNMAPS, "gf_unmaps_total", "counter", "Buffer unmappings.", 0.0 },
+            { Counter::DEVICE_MEMORY, "gf_device_memory_bytes", "gauge", "Device buffer memory allocated.", 0.0 },
+            { Counter::HOST_MEMORY, "gf_host_memory_bytes", "gauge", "Host buffer memory allocated.", 0.0 },
+            { Counter::FRAMES, "gf_frames_total", "counter", "Completed frames.", 0.0 },
+            { Counter::WALL_TIME, "gf_frame_wall_seconds_total", "counter", "Wall time of the completed frames.", 1e-9 },
+            { Counter::DEVICE_TIME, "gf_device_seconds_total", "counter", "Kernel execution time of the timed frames (profiling queues only).", 1e-9 },
+            { Counter::TIMED_FRAMES, "gf_timed_frames_total", "counter", "Frames whose kernels were timed.", 0.0 }
+        };
+
+        /*! \brief Holds what a frame callback needs. */
+        struct FrameRecord
+        {
+            std::shared_ptr<Counters::Block> block;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        void CL_CALLBACK frameComplete (cl_event event, cl_int status, void *data)
+        {
+            std::unique_ptr<FrameRecord> record ((FrameRecord *) data);
+            if (status == CL_COMPLETE)
+            {
+                auto wall = std::chrono::steady_clock::now () - record->start;
+                record->block->add (Counter::FRAMES, 1);
+                record->block->add (Counter::WALL_TIME,
+                    std::chrono::duration_cast<std::chrono::nanoseconds> (wall).count ());
+            }
+            clReleaseEvent (event);
+        }
+
+        void CL_CALLBACK kernelComplete (cl_event event, cl_int status, void *data)
+        {
+            std::unique_ptr<std::shared_ptr<Counters::Block>> block ((std::shared_ptr<Counters::Block> *) data);
+            cl_ulong start, end;
+            if (status == CL_COMPLETE &&
+                clGetEventProfilingInfo (event, CL_PROFILING_COMMAND_START, sizeof (start), &start, nullptr) == CL_SUCCESS &&
+                clGetEventProfilingInfo (event, CL_PROFILING_COMMAND_END, sizeof (end), &end, nullptr) == CL_SUCCESS &&
+                end > start)
+                (*block)->add (Counter::DEVICE_TIME, end - start);
+            clReleaseEvent (event);
+        }
+
+        /*! \brief Holds what a buffer destructor callback needs. */
+        struct BufferRecord
+        {
+            std::shared_ptr<Counters::Block> block;
+            size_t size;
+            bool host;
+        };
+
+        void CL_CALLBACK bufferReleased (cl_mem /* memobj */, void *data)
+        {
+            std::unique_ptr<BufferRecord> record ((BufferRecord *) data);
+            record->block->add (record->host ? Counter::HOST_MEMORY : Counter::DEVICE_MEMORY, -record->size);
+            (record->host ? record->block->ownHostMemory : record->block->ownDeviceMemory) -= record->size;
+        }
+
+        /*! \brief Registers a completion callback, and keeps the event alive until it runs.
+         *  \return false, if the callback couldn't be registered.
+         */
+        bool onComplete (const cl::Event &event, void (CL_CALLBACK *callback) (cl_event, cl_int, void *), void *data)
+        {
+            if (event () == nullptr || clRetainEvent (event ()) != CL_SUCCESS) return false;
+            if (clSetEventCallback (event (), CL_COMPLETE, callback, data) != CL_SUCCESS)
+            {
+                clReleaseEvent (event ());
+                return false;
+            }
+            return true;
+        }
+    }
+
+
+    Counters::Block::Block (const std::string &_name, std::shared_ptr<Block> _parent) :
+        name (_name), parent (_parent), ownDeviceMemory (0), ownHostMemory (0), 
+        timingPeriod (Counters::defaultTimingPeriod), nFrames (0), timing (0)
+    {
+        static std::atomic<unsigned int> nextId (0);
+        id = nextId++;
+        for (auto &value : values) value.store (0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock (registryMutex ());
+        registry ().push_back (this);
+    }
+
+
+    /*! \details The buffers of the instance subtract their memory when they are freed. 
+     *           Whatever is left (the buffers whose destructor callback couldn't be 
+     *           registered) is released with the instance, so it's subtracted from 
+     *           the ancestors.
+     */
+    Counters::Block::~Block ()
+    {
+        add (Counter::DEVICE_MEMORY, -ownDeviceMemory.load (), false);
+        add (Counter::HOST_MEMORY, -ownHostMemory.load (), false);
+
+        std::lock_guard<std::mutex> lock (registryMutex ());
+        std::vector<Block *> &blocks = registry ();
+        blocks.erase (std::remove (blocks.begin (), blocks.end (), this), blocks.end ());
+    }
+
+
+    /*! \param[in] counter the counter to update.
+     *  \param[in] value value to add (gauges are decreased with the two's complement).
+     *  \param[in] self whether to update this block too, or only its ancestors.
+     */
+    void Counters::Block::add (Counter counter, uint64_t value, bool self)
+    {
+        for (Block *b = self ? this : parent.get (); b != nullptr; b = b->parent.get ())
+            b->values[(size_t) counter].fetch_add (value, std::memory_order_relaxed);
+    }
+
+
+    /*! \details The blocks of the process and of the top-level instances are their own top.
+     */
+    Counters::Block* Counters::Block::top ()
+    {
+        Block *b = this;
+        while (b->parent && b->parent->parent) b = b->parent.get ();
+        return b;
+    }
+
+
+    /*! \param[in] _name name of the class of the instance. */
+    Counters::Counters (const char *_name) :
+        block (std::make_shared<Block> (_name, global ().block))
+    {
+    }
+
+
+    Counters::Counters (Root) :
+        block (std::make_shared<Block> ("", nullptr))
+    {
+    }
+
+
+    Counters::~Counters ()
+    {
+    }
+
+
+    /*! \details The memory gauges move to the new ancestors. The other counters
+     *           aren't moved, so call it before the instance is used (the classes
+     *           adopt their components in their constructors).
+     *
+     *  \param[in] parent counters of the instance that contains this one.
+     */
+    void Counters::setParent (Counters &parent)
+    {
+        uint64_t device = get (Counter::DEVICE_MEMORY);
+        uint64_t host = get (Counter::HOST_MEMORY);
+        block->add (Counter::DEVICE_MEMORY, -device, false);
+        block->add (Counter::HOST_MEMORY, -host, false);
+
+        block->parent = parent.block;
+
+        block->add (Counter::DEVICE_MEMORY, device, false);
+        block->add (Counter::HOST_MEMORY, host, false);
+    }
+
+
+    /*! \param[in] counter the counter to read.
+     *  \return The value of the counter. Times are in ns, and memory in bytes.
+     */
+    uint64_t Counters::get (Counter counter) const
+    {
+        return block->values[(size_t) counter].load (std::memory_order_relaxed);
+    }
+
+
+    /*! \param[in] counter the counter to update.
+     *  \param[in] value value to add.
+     */
+    void Counters::add (Counter counter, uint64_t value)
+    {
+        block->add (counter, value);
+    }
+
+
+    /*! \details Buffers with `CL_MEM_ALLOC_HOST_PTR` count as host memory. 
+     *           A destructor callback on the buffer subtracts its memory when the 
+     *           buffer is freed, e.g. when a reallocation (`init`, or a setter) 
+     *           drops it, so the memory counters stay gauges over the lifetime 
+     *           of the instance.
+     *
+     *  \param[in] context the context of the buffer.
+     *  \param[in] flags memory flags of the buffer.
+     *  \param[in] size size of the buffer in bytes.
+     *  \return The buffer.
+     */
+    cl::Buffer Counters::allocate (const cl::Context &context, cl_mem_flags flags, size_t size)
+    {
+        cl::Buffer buffer (context, flags, size);
+
+        bool host = (flags & CL_MEM_ALLOC_HOST_PTR) != 0;
+        block->add (host ? Counter::HOST_MEMORY : Counter::DEVICE_MEMORY, size);
+        (host ? block->ownHostMemory : block->ownDeviceMemory) += size;
+
+        BufferRecord *record = new BufferRecord { block, size, host };
+        if (clSetMemObjectDestructorCallback (buffer (), bufferReleased, record) != CL_SUCCESS)
+            delete record;
+
+        return buffer;
+    }
+
+
+    /*! \details The kernels of the first frame, and of every `period`-th frame after it, 
+     *           are timed on the profiling queues. It applies to a top-level instance, and 
+     *           covers its components. The default is `defaultTimingPeriod`.
+     *
+     *  \param[in] period `1` times every frame, and `0` none.
+     */
+    void Counters::setTimingPeriod (unsigned int period)
+    {
+        block->timingPeriod = period;
+    }
+
+
+    const std::string& Counters::getName () const
+    {
+        return block->name;
+    }
+
+
+    unsigned int Counters::getId () const
+    {
+        return block->id;
+    }
+
+
+    Counters& Counters::global ()
+    {
+        static Counters root ((Root ()));
+        return root;
+    }
+
+
+    /*! \details The process counters are labeled with `scope="process"`, and the ones
+     *           of the top-level instances with `scope="instance"`, and their class and id.
+     *           The components of an instance are included in its counters.
+     *
+     *  \param[out] os the stream to write to.
+     */
+    void Counters::dump (std::ostream &os)
+    {
+        Block *root = global ().block.get ();
+        std::lock_guard<std::mutex> lock (registryMutex ());
+
+        for (const Metric &metric : metrics)
+        {
+            os << "# HELP " << metric.name << " " << metric.help << "\n";
+            os << "# TYPE " << metric.name << " " << metric.type << "\n";
+
+            for (Block *b : registry ())
+            {
+                if (b != root && b->parent.get () != root) continue;
+
+                os << metric.name;
+                if (b == root)
+                    os << "{scope=\"process\"} ";
+                else
+                    os << "{scope=\"instance\",class=\"" << b->name << "\",id=\"" << b->id << "\"} ";
+
+                uint64_t value = b->values[(size_t) metric.counter].load (std::memory_order_relaxed);
+                if (metric.scale != 0.0)
+                    os << std::setprecision (9) << value * metric.scale << "\n";
+                else if (std::string (metric.type) == "gauge")
+                    os << (int64_t) value << "\n";
+                else
+                    os << value << "\n";
+            }
+        }
+    }
+
+
+    std::string Counters::dump ()
+    {
+        std::ostringstream ss;
+        dump (ss);
+        return ss.str ();
+    }
+
+
+    /*! \details Frames are only accounted by top-level instances,
+     *           since the frames of their components are part of theirs.
+     *
+     *  \param[in] counters the counters of the instance.
+     *  \param[in,out] event the output event of the method. If it's `nullptr`, it's
+     *                       pointed at an internal event, for the duration of the method.
+     */
+    Counters::Frame::Frame (Counters &counters, cl::Event *&_event) : event (nullptr)
+    {
+        if (counters.block->parent != global ().block) return;
+
+        block = counters.block;
+        start = std::chrono::steady_clock::now ();
+        if (_event == nullptr) _event = &local;
+        event = _event;
+
+        unsigned int period = block->timingPeriod;
+        block->timing = (period != 0 && block->nFrames++ % period == 0) ? 1 : 0;
+    }
+
+
+    Counters::Frame::~Frame ()
+    {
+        if (!block) return;
+
+        if (block->timing.exchange (0) == 2) block->add (Counter::TIMED_FRAMES, 1);
+        FrameRecord *record = new FrameRecord { block, start };
+        if (!onComplete (*event, frameComplete, record)) delete record;
+    }
+
+
+    MeteredQueue::MeteredQueue () : profiling (false)
+    {
+    }
+
+
+    /*! \param[in] queue the command queue to enqueue the commands on.
+     *  \param[in] counters the counters to update.
+     */
+    MeteredQueue::MeteredQueue (const cl::CommandQueue &queue, Counters &counters) :
+        cl::CommandQueue (queue), block (counters.block),
+        profiling (queue.getInfo<CL_QUEUE_PROPERTIES> () & CL_QUEUE_PROFILING_ENABLE)
+    {
+    }
+
+
+    /*! \details On a profiling queue, during a timed frame, the execution time 
+     *           of the kernel is added to the device time, when it completes.
+     */
+    cl_int MeteredQueue::enqueueNDRangeKernel (const cl::Kernel &kernel, const cl::NDRange &offset,
+                                               const cl::NDRange &global, const cl::NDRange &local,
+                                               const std::vector<cl::Event> *events, cl::Event *event) const
+    {
+        Counters::Block *top = (profiling && block) ? block->top () : nullptr;
+        bool timed = top != nullptr && top->timing != 0;
+
+        cl::Event profilingEvent;
+        if (timed && event == nullptr) event = &profilingEvent;
+
+        cl_int err = cl::CommandQueue::enqueueNDRangeKernel (kernel, offset, global, local, events, event);
+        if (!block) return err;
+
+        block->add (Counter::KERNELS, 1);
+        if (timed && err == CL_SUCCESS)
+        {
+            auto data = new std::shared_ptr<Counters::Block> (block);
+            if (!onComplete (*event, kernelComplete, data)) delete data;
+            else top->timing = 2;
+        }
+
+        return err;
+    }
+
+
+    cl_int MeteredQueue::enqueueWriteBuffer (const cl::Buffer &buffer, cl_bool blocking, size_t offset, size_t size,
+                                             const void *ptr, const std::vector<cl::Event> *events, cl::Event *event) const
+    {
+        cl_int err = cl::CommandQueue::enqueueWriteBuffer (buffer, blocking, offset, size, ptr, events, event);
+        if (block)
+        {
+            block->add (Counter::WRITES, 1);
+            block->add (Counter::WRITE_BYTES, size);
+        }
+
+        return err;
+    }
+
+
+    cl_int MeteredQueue::enqueueReadBuffer (const cl::Buffer &buffer, cl_bool blocking, size_t offset, size_t size,
+                                            void *ptr, const std::vector<cl::Event> *events, cl::Event *event) const
+    {
+        cl_int err = cl::CommandQueue::enqueueReadBuffer (buffer, blocking, offset, size, ptr, events, event);
+        if (block)
+        {
+            block->add (Counter::READS, 1);
+            block->add (Counter::READ_BYTES, size);
+        }
+
+        return err;
+    }
+
+
+    void* MeteredQueue::enqueueMapBuffer (const cl::Buffer &buffer, cl_bool blocking, cl_map_flags flags,
+                                          size_t offset, size_t size, const std::vector<cl::Event> *events,
+                                          cl::Event *event, cl_int *err) const
+    {
+        void *ptr = cl::CommandQueue::enqueueMapBuffer (buffer, blocking, flags, offset, size, events, event, err);
+        if (block) block->add (Counter::MAPS, 1);
+
+        return ptr;
+    }
+
+
+    cl_int MeteredQueue::enqueueUnmapMemObject (const cl::Memory &memory, void *ptr,
+                                                const std::vector<cl::Event> *events, cl::Event *event) const
+    {
+        cl_int err = cl::CommandQueue::enqueueUnmapMemObject (memory, ptr, events, event);
+        if (block) block->add (Counter::UNMAPS, 1);
+
+        return err;
+    }
+
+}
+}
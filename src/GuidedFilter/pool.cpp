@@ -0,0 +1,495 @@
+/*! \file pool.cpp
+ *  \brief Defines a pool of `GuidedFilter` instances that
+ *         serves many concurrent host threads.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <CLUtils.hpp>
+#include <GuidedFilter/pool.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    GuidedFilterPool::Lease::Lease () : pool (nullptr), entry (nullptr)
+    {
+    }
+
+
+    GuidedFilterPool::Lease::Lease (GuidedFilterPool *_pool, Entry *_entry) : pool (_pool), entry (_entry)
+    {
+    }
+
+
+    GuidedFilterPool::Lease::Lease (Lease &&other) : pool (other.pool), entry (other.entry)
+    {
+        other.entry = nullptr;
+    }
+
+
+    GuidedFilterPool::Lease& GuidedFilterPool::Lease::operator= (Lease &&other)
+    {
+        if (this != &other)
+        {
+            release ();
+            pool = other.pool; entry = other.entry;
+            other.entry = nullptr;
+        }
+        return *this;
+    }
+
+
+    GuidedFilterPool::Lease::~Lease ()
+    {
+        release ();
+    }
+
+
+    /*! \details The instance shouldn't have any work in flight
+     *           (e.g., call `async.drain` after `submit`).
+     */
+    void GuidedFilterPool::Lease::release ()
+    {
+        if (entry == nullptr) return;
+        pool->checkin (entry);
+        entry = nullptr;
+    }
+
+
+    /*! \details The first queue is the one on which the instance enqueues its transfers, 
+     *           so commands enqueued on it are ordered with respect to `write`/`run`/`read`.
+     *
+     *  \param[in] idx index of the queue (`0` or `1`).
+     *  \return A reference to the command queue.
+     */
+    cl::CommandQueue& GuidedFilterPool::Lease::queue (unsigned int idx)
+    {
+        return pool->env.getQueue (0, 2 * entry->pair + idx);
+    }
+
+
+    /*! \param[in] kernel_files the kernel files required by `GuidedFilter<GuidedFilterConfig::I_EQ_P>`.
+     *  \param[in] _maxInstances maximum number of instances, over all keys.
+     *                           Two command queues are created for each.
+     *  \param[in] pIdx index of the platform.
+     *  \param[in] dIdx index of the device on the platform.
+     */
+    GuidedFilterPool::GuidedFilterPool (const std::vector<std::string> &kernel_files,
+                                        unsigned int _maxInstances, unsigned int pIdx, unsigned int dIdx) :
+        device (dIdx), maxInstances (std::max (_maxInstances, 1u)),
+        nInstances (0), nLeased (0), nWaiting (0),
+        idleTimeout (std::chrono::duration_cast<std::chrono::steady_clock::duration> (
+            std::chrono::seconds (10)).count ()),
+        lastTrim (std::chrono::steady_clock::now ().time_since_epoch ().count ())
+    {
+        for (auto &bucket : buckets) bucket.store (nullptr);
+
+        env.addContext (pIdx);
+        for (unsigned int i = 0; i < 2 * maxInstances; ++i)
+            env.addQueue (0, dIdx);
+        env.addProgram (0, kernel_files);
+
+        for (unsigned int i = maxInstances; i > 0; --i)
+            freePairs.push_back (i - 1);
+    }
+
+
+    /*! \note All the leases have to be released before the pool is destroyed.
+     */
+    GuidedFilterPool::~GuidedFilterPool ()
+    {
+        for (auto &b : buckets)
+        {
+            Bucket *bucket = b.exchange (nullptr);
+            if (bucket == nullptr) break;
+
+            for (unsigned int i = 0; i < maxInstances; ++i)
+                delete bucket->idle[i].exchange (nullptr);
+            delete bucket;
+        }
+    }
+
+
+    /*! \details An idle instance of the key is taken without locking. Otherwise, a new
+     *           instance is created, if the pool hasn't reached `maxInstances`. Otherwise,
+     *           an idle instance of another key is recycled. Otherwise, the call blocks
+     *           until an instance is returned.
+     *  \note The instance is initialized with `Staging::IO`, so both `write`/`run`/`read`,
+     *        and `submit` can be used on it.
+     *  \note If a new instance can't be set up, the `cl::Error` is passed on 
+     *        to the caller, and the pool is left as it was.
+     *  \note If the pool can't hold another key (all `maxKeys` keys have leased 
+     *        instances), the returned `Lease` is empty.
+     *
+     *  \param[in] width width of the images to be processed.
+     *  \param[in] height height of the images to be processed.
+     *  \param[in] radius radius of the square filter window.
+     *  \param[in] eps regularization parameter \f$ \epsilon \f$.
+     *  \return A lease on an instance, which is returned to the pool when the lease is destroyed.
+     */
+    GuidedFilterPool::Lease GuidedFilterPool::checkout (unsigned int width, unsigned int height, int radius, float eps)
+    {
+        Bucket *bucket = find (width, height, radius, eps);
+        if (bucket == nullptr) return Lease ();
+
+        Entry *entry = take (bucket);
+        if (entry != nullptr)
+        {
+            if (entry->width == width && entry->height == height && 
+                entry->radius == radius && entry->eps == eps)
+            {
+                nLeased++;
+                return Lease (this, entry);
+            }
+
+            // The bucket has been given to another key since it was found
+            give (entry);
+            entry = nullptr;
+        }
+
+        std::unique_lock<std::mutex> lock (mtx);
+        nWaiting++;
+        try
+        {
+            while (true)
+            {
+                // The bucket may be given to another key while the lock isn't held
+                if (!holds (bucket, width, height, radius, eps) && 
+                    (bucket = findLocked (width, height, radius, eps)) == nullptr) break;
+
+                if ((entry = take (bucket)) != nullptr) break;
+
+                if (!freePairs.empty ())
+                {
+                    entry = create (bucket);
+                    break;
+                }
+
+                for (auto &b : buckets)
+                {
+                    Bucket *other = b.load ();
+                    if (other == nullptr) break;
+                    if ((entry = take (other)) != nullptr) break;
+                }
+                if (entry != nullptr)
+                {
+                    destroy (entry);
+                    entry = create (bucket);
+                    break;
+                }
+
+                cv.wait (lock);
+            }
+        }
+        catch (...)
+        {
+            nWaiting--;
+            throw;
+        }
+        nWaiting--;
+
+        if (entry == nullptr) return Lease ();
+
+        nLeased++;
+        return Lease (this, entry);
+    }
+
+
+    /*! \details The instances are taken out of their idle slots one at a time,
+     *           so that the pool stays usable during the call. A thread may find 
+     *           a slot empty while its instance is examined, so waiting threads 
+     *           are notified of the instances that are put back.
+     *
+     *  \param[in] idle idle time after which an instance is released.
+     *  \return The number of instances released.
+     */
+    unsigned int GuidedFilterPool::trim (std::chrono::milliseconds idle)
+    {
+        unsigned int released = 0, kept = 0;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+
+        for (auto &b : buckets)
+        {
+            Bucket *bucket = b.load ();
+            if (bucket == nullptr) break;
+
+            for (unsigned int i = 0; i < maxInstances; ++i)
+            {
+                Entry *entry = bucket->idle[i].exchange (nullptr);
+                if (entry == nullptr) continue;
+
+                if (now - entry->lastUse >= idle)
+                {
+                    std::lock_guard<std::mutex> lock (mtx);
+                    destroy (entry);
+                    released++;
+                    if (nWaiting > 0) cv.notify_all ();
+                }
+                else
+                {
+                    give (entry);
+                    kept++;
+                }
+            }
+        }
+
+        if (kept > 0 && nWaiting > 0)
+        {
+            std::lock_guard<std::mutex> lock (mtx);
+            cv.notify_all ();
+        }
+
+        return released;
+    }
+
+
+    /*! \details A returned instance is released, when it isn't checked out again
+     *           within `_idleTimeout`. The check happens at most once per timeout
+     *           period, when an instance is returned. The default is `10 s`.
+     *
+     *  \param[in] _idleTimeout idle time after which an instance is released.
+     */
+    void GuidedFilterPool::setIdleTimeout (std::chrono::milliseconds _idleTimeout)
+    {
+        idleTimeout = std::chrono::duration_cast<std::chrono::steady_clock::duration> (_idleTimeout).count ();
+    }
+
+
+    unsigned int GuidedFilterPool::size ()
+    {
+        return nInstances;
+    }
+
+
+    unsigned int GuidedFilterPool::leased ()
+    {
+        return nLeased;
+    }
+
+
+    /*! \details The environment has a single context (index `0`) and
+     *           program (index `0`). It can be used to create more
+     *           kernel objects on the same context.
+     */
+    clutils::CLEnv& GuidedFilterPool::getEnv ()
+    {
+        return env;
+    }
+
+
+    /*! \details The buckets are looked up without locking. 
+     *           A new bucket is added under the lock.
+     *
+     *  \return The bucket of the key, or `nullptr` if the pool can't hold another key.
+     */
+    GuidedFilterPool::Bucket* GuidedFilterPool::find (unsigned int width, unsigned int height, int radius, float eps)
+    {
+        for (auto &b : buckets)
+        {
+            Bucket *bucket = b.load ();
+            if (bucket == nullptr) break;
+            if (holds (bucket, width, height, radius, eps)) return bucket;
+        }
+
+        std::lock_guard<std::mutex> lock (mtx);
+        return findLocked (width, height, radius, eps);
+    }
+
+
+    /*! \details The buckets are only ever appended, and never freed until the pool is 
+     *           destroyed. Once there are `maxKeys` of them, a bucket without instances 
+     *           is given to the new key. If there is none, the idle instances of a bucket 
+     *           without leased ones are released first.
+     *
+     *  \return The bucket of the key, or `nullptr` if all the buckets have leased instances.
+     */
+    GuidedFilterPool::Bucket* GuidedFilterPool::findLocked (unsigned int width, unsigned int height, int radius, float eps)
+    {
+        unsigned int idx = 0;
+        for (; idx < maxKeys; ++idx)
+        {
+            Bucket *bucket = buckets[idx].load ();
+            if (bucket == nullptr) break;
+            if (holds (bucket, width, height, radius, eps)) return bucket;
+        }
+
+        Bucket *bucket = nullptr;
+        if (idx < maxKeys)
+        {
+            bucket = new Bucket;
+            bucket->nEntries = 0;
+            bucket->idle.reset (new std::atomic<Entry *>[maxInstances]);
+            for (unsigned int i = 0; i < maxInstances; ++i)
+                bucket->idle[i].store (nullptr);
+        }
+        else
+        {
+            for (auto &b : buckets)
+            {
+                if (b.load ()->nEntries == 0)
+                {
+                    bucket = b.load ();
+                    break;
+                }
+            }
+
+            for (unsigned int i = 0; bucket == nullptr && i < maxKeys; ++i)
+            {
+                Bucket *other = buckets[i].load ();
+
+                unsigned int nIdle = 0;
+                for (unsigned int k = 0; k < maxInstances; ++k)
+                    if (other->idle[k].load () != nullptr) nIdle++;
+                if (nIdle < other->nEntries) continue;
+
+                Entry *entry;
+                while ((entry = take (other)) != nullptr)
+                    destroy (entry);
+                if (nWaiting > 0) cv.notify_all ();
+                if (other->nEntries == 0) bucket = other;
+            }
+
+            if (bucket == nullptr) return nullptr;
+        }
+
+        bucket->width = width; bucket->height = height;
+        bucket->radius = radius; bucket->eps = eps;
+        if (idx < maxKeys) buckets[idx].store (bucket);
+
+        return bucket;
+    }
+
+
+    bool GuidedFilterPool::holds (Bucket *bucket, unsigned int width, unsigned int height, int radius, float eps)
+    {
+        return bucket->width == width && bucket->height == height && 
+               bucket->radius == radius && bucket->eps == eps;
+    }
+
+
+    /*! \return An idle instance of the bucket, or `nullptr` if there is none.
+     */
+    GuidedFilterPool::Entry* GuidedFilterPool::take (Bucket *bucket)
+    {
+        for (unsigned int i = 0; i < maxInstances; ++i)
+        {
+            if (bucket->idle[i].load () == nullptr) continue;
+
+            Entry *entry = bucket->idle[i].exchange (nullptr);
+            if (entry != nullptr) return entry;
+        }
+
+        return nullptr;
+    }
+
+
+    /*! \details There are as many idle slots in a bucket as instances
+     *           in the pool, so a free slot is always found.
+     */
+    void GuidedFilterPool::give (Entry *entry)
+    {
+        Bucket *bucket = entry->bucket;
+        while (true)
+        {
+            for (unsigned int i = 0; i < maxInstances; ++i)
+            {
+                Entry *expected = nullptr;
+                if (bucket->idle[i].compare_exchange_strong (expected, entry)) return;
+            }
+        }
+    }
+
+
+    GuidedFilterPool::Entry* GuidedFilterPool::create (Bucket *bucket)
+    {
+        unsigned int pair = freePairs.back ();
+        freePairs.pop_back ();
+
+        clutils::CLEnvInfo<2> info (0, device, 0, { 2 * pair, 2 * pair + 1 }, 0);
+
+        std::unique_ptr<Entry> entry (new Entry);
+        try
+        {
+            entry->filter.reset (new GuidedFilter<GuidedFilterConfig::I_EQ_P> (env, info));
+            entry->filter->init (bucket->width, bucket->height, bucket->radius, bucket->eps);
+        }
+        catch (...)
+        {
+            freePairs.push_back (pair);
+            throw;
+        }
+        entry->pair = pair;
+        entry->bucket = bucket;
+        entry->width = bucket->width; entry->height = bucket->height;
+        entry->radius = bucket->radius; entry->eps = bucket->eps;
+        bucket->nEntries++;
+        nInstances++;
+
+        return entry.release ();
+    }
+
+
+    void GuidedFilterPool::destroy (Entry *entry)
+    {
+        freePairs.push_back (entry->pair);
+        entry->bucket->nEntries--;
+        delete entry;
+        nInstances--;
+    }
+
+
+    /*! \details The instance goes back to an idle slot of its bucket without locking.
+     *           Waiting threads are only notified when there are any. At most once
+     *           per idle timeout period, the instances that have been idle longer
+     *           than the timeout are released.
+     */
+    void GuidedFilterPool::checkin (Entry *entry)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+        entry->lastUse = now;
+        give (entry);
+        nLeased--;
+
+        if (nWaiting > 0)
+        {
+            std::lock_guard<std::mutex> lock (mtx);
+            cv.notify_all ();
+            return;
+        }
+
+        int64_t timeout = idleTimeout;
+        int64_t ticks = now.time_since_epoch ().count ();
+        int64_t last = lastTrim;
+        if (ticks - last > timeout && lastTrim.compare_exchange_strong (last, ticks))
+            trim (std::chrono::duration_cast<std::chrono::milliseconds> (
+                std::chrono::steady_clock::duration (timeout)));
+    }
+
+}
+}
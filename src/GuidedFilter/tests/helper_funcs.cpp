@@ -44,6 +44,7 @@ namespace GF
         std::default_random_engine generator { seed };
         std::uniform_int_distribution<unsigned char> distribution1 { 0, 255 };
         std::uniform_int_distribution<unsigned short> distribution2 { 0, 10000 };
+        std::uniform_int_distribution<unsigned short> distribution3 { 0, 65535 };
         std::uniform_real_distribution<float> distributionR1 { 0.f, 1.f };
         std::uniform_real_distribution<float> distributionR2 { 1e-6f, 255 * 1e-6f };
     }
@@ -52,6 +53,8 @@ namespace GF
     std::function<unsigned char ()> rNum_0_255 = std::bind (distribution1, generator);
     /*! \brief Uniform number generator in the range \f$[0, 10000]\f$. */
     std::function<unsigned short ()> rNum_0_10000 = std::bind (distribution2, generator);
+    /*! \brief Uniform number generator in the range \f$[0, 65535]\f$. */
+    std::function<unsigned short ()> rNum_0_65535 = std::bind (distribution3, generator);
     /*! \brief Uniform number generator in the range \f$[0.0, 1.0)\f$. */
     std::function<float ()> rNum_R_0_1 = std::bind (distributionR1, generator);
     /*! \brief Uniform number generator in the range \f$[1e-6, 255*1e-6)\f$. */
@@ -0,0 +1,381 @@
+/*! \file tuning.cpp
+ *  \brief Defines classes that measure, and persist, the best 
+ *         work-group configurations of the kernels on a device.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <CLUtils.hpp>
+#include <GuidedFilter/tuning.hpp>
+#include <GuidedFilter/algorithms.hpp>
+
+
+namespace cl_algo
+{
+namespace GF
+{
+
+    TuningProfile::TuningProfile () : loaded (false)
+    {
+        const char *env = std::getenv ("GF_TUNING_PROFILE");
+        path = (env != nullptr) ? env : "guided_filter.tuning";
+    }
+
+
+    /*! \return A reference to the process-wide profile.
+     */
+    TuningProfile& TuningProfile::instance ()
+    {
+        static TuningProfile profile;
+        return profile;
+    }
+
+
+    /*! \details The key is made from the device name and the driver version, 
+     *           with whitespace replaced by underscores.
+     *
+     *  \param[in] device the device to identify.
+     *  \return The device key.
+     */
+    std::string TuningProfile::deviceKey (cl::Device &device)
+    {
+        std::string key = device.getInfo<CL_DEVICE_NAME> () + "@" + 
+                          device.getInfo<CL_DRIVER_VERSION> ();
+
+        key.erase (std::remove (key.begin (), key.end (), '\0'), key.end ());
+        for (char &c : key)
+            if (std::isspace (static_cast<unsigned char> (c))) c = '_';
+
+        return key;
+    }
+
+
+    std::string TuningProfile::key (cl::Device &device, const std::string &name, 
+                                    unsigned int width, unsigned int height)
+    {
+        std::ostringstream ss;
+        ss << deviceKey (device) << " " << name << " " << width << "x" << height;
+        return ss.str ();
+    }
+
+
+    /*! \details The profile file is loaded on the first call.
+     *
+     *  \param[in] device the device on which the class executes.
+     *  \param[in] name the name of the class.
+     *  \param[in] width width of the array processed by the class.
+     *  \param[in] height height of the array processed by the class.
+     *  \param[out] params the parameters of the entry.
+     *  \return Whether an entry was found.
+     */
+    bool TuningProfile::lookup (cl::Device &device, const std::string &name, 
+                                unsigned int width, unsigned int height, std::vector<unsigned int> &params)
+    {
+        std::string k = key (device, name, width, height);
+
+        std::lock_guard<std::mutex> lock (mtx);
+        if (!loaded) loadUnlocked (path);
+
+        auto it = entries.find (k);
+        if (it == entries.end ()) return false;
+
+        params = it->second;
+        return true;
+    }
+
+
+    /*! \details An existing entry is replaced. The profile file is not updated 
+     *           until a call to `save`.
+     *
+     *  \param[in] device the device on which the class executes.
+     *  \param[in] name the name of the class.
+     *  \param[in] width width of the array processed by the class.
+     *  \param[in] height height of the array processed by the class.
+     *  \param[in] params the parameters of the entry.
+     */
+    void TuningProfile::store (cl::Device &device, const std::string &name, 
+                               unsigned int width, unsigned int height, const std::vector<unsigned int> &params)
+    {
+        std::string k = key (device, name, width, height);
+
+        std::lock_guard<std::mutex> lock (mtx);
+        if (!loaded) loadUnlocked (path);
+
+        entries[k] = params;
+    }
+
+
+    /*! \details The entries in the file are merged into the profile, and 
+     *           the path becomes the default path for `save`.
+     *
+     *  \param[in] _path path of the profile file.
+     *  \return Whether the file was read.
+     */
+    bool TuningProfile::load (const std::string &_path)
+    {
+        std::lock_guard<std::mutex> lock (mtx);
+        path = _path;
+        return loadUnlocked (path);
+    }
+
+
+    bool TuningProfile::loadUnlocked (const std::string &_path)
+    {
+        loaded = true;
+
+        std::ifstream f (_path);
+        if (!f.is_open ()) return false;
+
+        std::string line;
+        while (std::getline (f, line))
+        {
+            if (line.empty () || line[0] == '#') continue;
+
+            std::istringstream ss (line);
+            std::string device, name, dims;
+            if (!(ss >> device >> name >> dims)) continue;
+
+            std::vector<unsigned int> params;
+            unsigned int p;
+            while (ss >> p) params.push_back (p);
+            if (params.empty ()) continue;
+
+            entries[device + " " + name + " " + dims] = params;
+        }
+
+        return true;
+    }
+
+
+    /*! \param[in] _path path of the profile file. If empty, the path from which 
+     *                   the profile was loaded is used.
+     *  \return Whether the file was written.
+     */
+    bool TuningProfile::save (const std::string &_path)
+    {
+        std::lock_guard<std::mutex> lock (mtx);
+
+        std::ofstream f (_path.empty () ? path : _path);
+        if (!f.is_open ()) return false;
+
+        f << "# <device> <class> <width>x<height> <param>..." << std::endl;
+        for (auto &entry : entries)
+        {
+            f << entry.first;
+            for (unsigned int p : entry.second)
+                f << " " << p;
+            f << std::endl;
+        }
+
+        return f.good ();
+    }
+
+
+    void TuningProfile::clear ()
+    {
+        std::lock_guard<std::mutex> lock (mtx);
+        loaded = true;
+        entries.clear ();
+    }
+
+
+    /*! \return The path of the profile file.
+     */
+    std::string TuningProfile::getPath ()
+    {
+        std::lock_guard<std::mutex> lock (mtx);
+        return path;
+    }
+
+
+    /*! \param[in] _env opencl environment.
+     *  \param[in] _info opencl configuration. Specifies the context, queue, etc, to be used.
+     *  \param[in] _nRepeat number of timed executions per configuration.
+     */
+    Tuner::Tuner (clutils::CLEnv &_env, clutils::CLEnvInfo<1> _info, unsigned int _nRepeat) : 
+        env (_env), info (_info), device (env.devices[info.pIdx][info.dIdx]), 
+        nRepeat (std::max (_nRepeat, 1u))
+    {
+        try
+        {
+            cl::CommandQueue &queue = env.getQueue (info.ctxIdx, info.qIdx[0]);
+            if (!(queue.getInfo<CL_QUEUE_PROPERTIES> () & CL_QUEUE_PROFILING_ENABLE))
+                throw "The command queue has to be created with profiling enabled";
+        }
+        catch (const char *error)
+        {
+            std::cerr << "Error[Tuner]: " << error << std::endl;
+            exit (EXIT_FAILURE);
+        }
+    }
+
+
+    /*! \details Tunes the classes involved in a `BoxFilterSAT` on a `width x height` 
+     *           image, i.e. `Scan` and `Transpose` on both the image and its 
+     *           transpose, and `BoxFilterSAT` itself. The profile is then saved.
+     *
+     *  \param[in] width width of the image.
+     *  \param[in] height height of the image.
+     *  \param[in] radius radius of the filter window.
+     */
+    void Tuner::tune (unsigned int width, unsigned int height, int radius)
+    {
+        tuneScan (width, height);
+        tuneTranspose (width, height);
+        tuneScan (height, width);
+        tuneTranspose (height, width);
+        tuneBoxFilterSAT (width, height, radius);
+
+        TuningProfile::instance ().save ();
+    }
+
+
+    /*! \param[in] width width of the input array.
+     *  \param[in] height height of the input array.
+     *  \return The execution time (in ms) of the best configuration, 
+     *          or a negative number if there is no valid configuration.
+     */
+    double Tuner::tuneScan (unsigned int width, unsigned int height)
+    {
+        Scan scan (env, info);
+        std::vector<std::vector<unsigned int>> candidates;
+        for (unsigned int lX = 16; lX <= 1024; lX <<= 1)
+            if (scan.validConfig (width, height, { lX }))
+                candidates.push_back ({ lX });
+
+        return search ("Scan", width, height, candidates, [&] () {
+            Scan algo (env, info);
+            algo.init (width, height, 1.f, Staging::NONE);
+            return measure (algo);
+        });
+    }
+
+
+    /*! \param[in] width width of the input array.
+     *  \param[in] height height of the input array.
+     *  \return The execution time (in ms) of the best configuration, 
+     *          or a negative number if there is no valid configuration.
+     */
+    double Tuner::tuneTranspose (unsigned int width, unsigned int height)
+    {
+        Transpose transpose (env, info);
+        std::vector<std::vector<unsigned int>> candidates;
+        for (unsigned int lSide = 1; lSide <= 32; lSide <<= 1)
+            if (transpose.validConfig (width, height, { lSide }))
+                candidates.push_back ({ lSide });
+
+        return search ("Transpose", width, height, candidates, [&] () {
+            Transpose algo (env, info);
+            algo.init (width, height, Staging::NONE);
+            return measure (algo);
+        });
+    }
+
+
+    /*! \param[in] width width of the image.
+     *  \param[in] height height of the image.
+     *  \param[in] radius radius of the filter window.
+     *  \return The execution time (in ms) of the best configuration, 
+     *          or a negative number if there is no valid configuration.
+     */
+    double Tuner::tuneBoxFilterSAT (unsigned int width, unsigned int height, int radius)
+    {
+        BoxFilterSAT boxFilter (env, info);
+        std::vector<std::vector<unsigned int>> candidates;
+        for (unsigned int lX = 4; lX <= 64; lX <<= 1)
+            for (unsigned int lY = 4; lY <= 64; lY <<= 1)
+                if (boxFilter.validConfig (width, height, { lX, lY }))
+                    candidates.push_back ({ lX, lY });
+
+        return search ("BoxFilterSAT", width, height, candidates, [&] () {
+            BoxFilterSAT algo (env, info);
+            algo.init (width, height, radius, 1e-4f, Staging::NONE);
+            return measure (algo);
+        });
+    }
+
+
+    /*! \details The first execution is a warm-up, and it's not timed.
+     *
+     *  \param[in] algo an initialized class instance.
+     *  \return The minimum execution time (in ms).
+     */
+    template <typename T>
+    double Tuner::measure (T &algo)
+    {
+        clutils::GPUTimer<std::milli> timer (device);
+
+        algo.run ();
+        double best = std::numeric_limits<double>::max ();
+        for (unsigned int i = 0; i < nRepeat; ++i)
+            best = std::min (best, algo.run (timer));
+
+        return best;
+    }
+
+
+    /*! \details Each candidate is placed in the profile before `bench` is called, 
+     *           so that a new class instance picks it up in `init`. At the end, 
+     *           the fastest candidate is stored.
+     *
+     *  \param[in] name the name of the class.
+     *  \param[in] width width of the array processed by the class.
+     *  \param[in] height height of the array processed by the class.
+     *  \param[in] candidates the configurations to compare.
+     *  \param[in] bench function that times the class with the configuration in the profile.
+     *  \return The execution time (in ms) of the best configuration, 
+     *          or a negative number if there are no candidates.
+     */
+    double Tuner::search (const std::string &name, unsigned int width, unsigned int height, 
+                          const std::vector<std::vector<unsigned int>> &candidates, 
+                          const std::function<double ()> &bench)
+    {
+        if (candidates.empty ()) return -1.0;
+
+        TuningProfile &profile = TuningProfile::instance ();
+        double bestTime = std::numeric_limits<double>::max ();
+        std::vector<unsigned int> best;
+
+        for (auto &params : candidates)
+        {
+            profile.store (device, name, width, height, params);
+            double t = bench ();
+            if (t < bestTime) { bestTime = t; best = params; }
+        }
+
+        profile.store (device, name, width, height, best);
+
+        return bestTime;
+    }
+
+}
+}
@@ -41,6 +41,7 @@
 #include <gtest/gtest.h>
 #include <CLUtils.hpp>
 #include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/tuning.hpp>
 #include <GuidedFilter/tests/helper_funcs.hpp>
 
 
@@ -392,6 +393,226 @@ TEST (BoxFilter, boxFilterSAT)
 }
 
 
+/*! \brief Tests the **boxFilterSAT** kernel with tuned work-group configurations.
+ *  \details The image dimensions are not multiples of 16, so the default 
+ *           configuration of `BoxFilterSAT` doesn't apply.
+ */
+TEST (BoxFilter, boxFilterSATTuned)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box };
+        const unsigned int width = 200, height = 120;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int filterRadius = 3;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+
+        // Tune the classes in memory (the profile file is not touched)
+        cl_algo::GF::TuningProfile &profile = cl_algo::GF::TuningProfile::instance ();
+        profile.clear ();
+
+        cl_algo::GF::Tuner tuner (clEnv, info, 3);
+        ASSERT_GE (tuner.tuneScan (width, height), 0.0);
+        ASSERT_GE (tuner.tuneTranspose (width, height), 0.0);
+        ASSERT_GE (tuner.tuneScan (height, width), 0.0);
+        ASSERT_GE (tuner.tuneTranspose (height, width), 0.0);
+        ASSERT_GE (tuner.tuneBoxFilterSAT (width, height, filterRadius), 0.0);
+
+        std::vector<unsigned int> params;
+        ASSERT_TRUE (profile.lookup (clEnv.devices[0][0], "BoxFilterSAT", width, height, params));
+        ASSERT_EQ (params.size (), 2u);
+        ASSERT_EQ (height % params[0], 0u);
+        ASSERT_EQ (width % params[1], 0u);
+
+        // Configure kernel execution parameters
+        cl_algo::GF::BoxFilterSAT box (clEnv, info);
+        box.init (width, height, filterRadius);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (box.hPtrIn, box.hPtrIn + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        box.write ();  // Copy data to device
+
+        box.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) box.read ();  // Copy results to host
+
+        // Produce reference blurred array
+        cl_float refBox[width * height];
+        GF::cpuBoxFilter (box.hPtrIn, refBox, width, height, filterRadius);
+
+        // Verify blurred output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                ASSERT_LT (std::abs (refBox[row * width + col] - results[row * width + col]), eps);
+
+        profile.clear ();
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **boxFilterSAT3D** kernel.
+ *  \details The operation is a mean filtering on a volume, using a summed volume table.
+ */
+TEST (BoxFilter, boxFilterSAT3D)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box };
+        const unsigned int width = 128, height = 64, depth = 16;
+        const unsigned int n = width * height * depth;
+        const int filterRadius = 3, filterRadiusZ = 2;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::BoxFilterSAT3D box (clEnv, info);
+        box.init (width, height, depth, filterRadius, filterRadiusZ);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (box.hPtrIn, box.hPtrIn + n, GF::rNum_R_0_1);
+
+        box.write ();  // Copy data to device
+
+        box.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) box.read ();  // Copy results to host
+
+        // Produce reference blurred volume
+        std::vector<cl_float> refBox (n);
+        GF::cpuBoxFilter3D (box.hPtrIn, refBox.data (), width, height, depth, filterRadius, filterRadiusZ);
+
+        // Verify blurred output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint i = 0; i < n; ++i)
+            ASSERT_LT (std::abs (refBox[i] - results[i]), eps);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuBoxFilter3D (box.hPtrIn, refBox.data (), width, height, depth, filterRadius, filterRadiusZ);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = box.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "BoxFilterSAT3D");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **ringUpdate** kernel.
+ *  \details A stream of frames is filtered with a window that spans the last frames. 
+ *           The stream is longer than two turns of the ring, so both the incremental 
+ *           updates and the periodic summations are exercised. After a `reset`, 
+ *           the window spans the new frame alone.
+ */
+TEST (BoxFilter, boxFilterSAT3DCausal)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box };
+        const unsigned int width = 128, height = 64, frames = 4, nFrames = 11;
+        const unsigned int pixels = width * height;
+        const int filterRadius = 3;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::BoxFilterSAT3D box (clEnv, info);
+        box.init (width, height, frames, filterRadius, 0, cl_algo::GF::Window3D::CAUSAL);
+
+        // Produce the stream, and the reference blurred frames
+        std::vector<cl_float> stream (pixels * nFrames), refBox (pixels * nFrames);
+        std::generate (stream.begin (), stream.end (), GF::rNum_R_0_1);
+        GF::cpuBoxFilter3D (stream.data (), refBox.data (), width, height, nFrames, filterRadius, 0, frames);
+
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint t = 0; t < nFrames; ++t)
+        {
+            box.write (cl_algo::GF::BoxFilterSAT3D::Memory::D_IN, stream.data () + t * pixels);
+            box.run ();
+            cl_float *results = (cl_float *) box.read ();
+
+            for (uint i = 0; i < pixels; ++i)
+                ASSERT_LT (std::abs (refBox[t * pixels + i] - results[i]), eps);
+        }
+
+        // A new stream starts with the last frame
+        box.reset ();
+        box.write (cl_algo::GF::BoxFilterSAT3D::Memory::D_IN, stream.data () + (nFrames - 1) * pixels);
+        box.run ();
+        cl_float *results = (cl_float *) box.read ();
+
+        std::vector<cl_float> refFrame (pixels);
+        GF::cpuBoxFilter (stream.data () + (nFrames - 1) * pixels, refFrame.data (), width, height, filterRadius);
+        for (uint i = 0; i < pixels; ++i)
+            ASSERT_LT (std::abs (refFrame[i] - results[i]), eps);
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
 /*! \brief Tests the **boxFilter** kernel.
  *  \details The operation is a blurring effect (mean filtering) on an image.
  */
@@ -471,6 +692,166 @@ TEST (BoxFilter, boxFilter)
     }
 }
 
+/*! \brief Tests the **minFilter** kernel.
+ *  \details Performs min filtering with a van Herk/Gil-Werman scheme, 
+ *           one horizontal and one vertical pass.
+ */
+TEST (BoxFilter, minFilter)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int filterRadius = 7;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_filename_box);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::MinFilter filter (clEnv, info);
+        filter.init (width, height, filterRadius);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (filter.hPtrIn, filter.hPtrIn + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        // GF::printBufferF ("Original:", filter.hPtrIn, width, height, 3);
+
+        filter.write ();  // Copy data to device
+
+        filter.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) filter.read ();  // Copy results to host
+        // GF::printBufferF ("Received:", results, width, height, 5);
+
+        // Produce reference array
+        cl_float *refOut = new cl_float[width * height];
+        GF::cpuMinFilter (filter.hPtrIn, refOut, width, height, filterRadius);
+        // GF::printBufferF ("Expected:", refOut, width, height, 5);
+
+        // Verify output (the filter only selects values, so they match exactly)
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                ASSERT_EQ (refOut[row * width + col], results[row * width + col]);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuMinFilter (filter.hPtrIn, refOut, width, height, filterRadius);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = filter.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "MinFilter");
+        }
+
+        delete[] refOut;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+/*! \brief Tests the **maxFilter** kernel.
+ *  \details Performs max filtering with a van Herk/Gil-Werman scheme, 
+ *           one horizontal and one vertical pass.
+ */
+TEST (BoxFilter, maxFilter)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int filterRadius = 7;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_filename_box);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::MaxFilter filter (clEnv, info);
+        filter.init (width, height, filterRadius);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (filter.hPtrIn, filter.hPtrIn + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        // GF::printBufferF ("Original:", filter.hPtrIn, width, height, 3);
+
+        filter.write ();  // Copy data to device
+
+        filter.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) filter.read ();  // Copy results to host
+        // GF::printBufferF ("Received:", results, width, height, 5);
+
+        // Produce reference array
+        cl_float *refOut = new cl_float[width * height];
+        GF::cpuMaxFilter (filter.hPtrIn, refOut, width, height, filterRadius);
+        // GF::printBufferF ("Expected:", refOut, width, height, 5);
+
+        // Verify output (the filter only selects values, so they match exactly)
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                ASSERT_EQ (refOut[row * width + col], results[row * width + col]);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuMaxFilter (filter.hPtrIn, refOut, width, height, filterRadius);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = filter.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "MaxFilter");
+        }
+
+        delete[] refOut;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
 
 int main (int argc, char **argv)
 {
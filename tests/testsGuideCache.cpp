@@ -0,0 +1,308 @@
+/*! \file testsGuideCache.cpp
+ *  \brief Google Test Unit Tests for the cache of guide statistics.
+ *  \note Use the `--profiling` flag to enable profiling of the kernels.
+ *  \author Nick Lamprianidis
+ *  \version 1.2.0
+ *  \date 2015
+ *  \copyright The MIT License (MIT)
+ *  \par
+ *  Copyright (c) 2015 Nick Lamprianidis
+ *  \par
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  \par
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  \par
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <utime.h>
+#include <gtest/gtest.h>
+#include <CLUtils.hpp>
+#include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/cache.hpp>
+#include <GuidedFilter/tests/helper_funcs.hpp>
+
+
+// Kernel filenames
+const std::string kernel_filename_scan { "kernels/scan_kernels.cl"         };
+const std::string kernel_filename_tr   { "kernels/transpose_kernels.cl"    };
+const std::string kernel_filename_box  { "kernels/boxFilter_kernels.cl"    };
+const std::string kernel_filename_math { "kernels/math_kernels.cl"         };
+const std::string kernel_filename_gf   { "kernels/guidedFilter_kernels.cl" };
+
+namespace GF
+{
+    // Uniform random number generators
+    extern std::function<unsigned char ()> rNum_0_255;
+    extern std::function<unsigned short ()> rNum_0_10000;
+    extern std::function<float ()> rNum_R_0_1;
+}
+
+bool profiling;  // Flag to enable profiling of the kernels
+
+
+/*! \brief Returns a new, empty directory for a cache. */
+std::string tempDirectory ()
+{
+    char path[] = "/tmp/gf-cache-XXXXXX";
+    if (mkdtemp (path) == nullptr)
+        throw std::runtime_error ("Failed to create a temporary directory");
+    return path;
+}
+
+
+/*! \brief Tests the eviction policies of the cache.
+ *  \details The cache fits two entries. With `LRU`, a hit protects an entry 
+ *           from the eviction. With `FIFO`, it doesn't. With `NONE`, 
+ *           the third entry is rejected.
+ */
+TEST (GuideCache, eviction)
+{
+    const unsigned int width = 64, height = 32;
+    const unsigned int n = width * height;
+    const int radius = 3;
+    const float eps = 0.01f;
+
+    const std::string directory = tempDirectory ();
+    cl_algo::GF::GuideCache probe (directory);
+    std::vector<float> guide (n), mean (n), var (n);
+
+    // Measure the size of an entry
+    std::vector<cl_algo::GF::GuideCache::Key> keys;
+    for (int k = 0; k < 3; ++k)
+    {
+        std::generate (guide.begin (), guide.end (), GF::rNum_R_0_1);
+        keys.push_back (cl_algo::GF::GuideCache::key (guide.data (), width, height, radius, eps));
+    }
+    ASSERT_TRUE (probe.store (keys[0], mean.data (), var.data ()));
+    const size_t entrySize = probe.size ();
+    probe.clear ();
+
+    const cl_algo::GF::GuideCacheEviction policies[] = { 
+        cl_algo::GF::GuideCacheEviction::LRU, 
+        cl_algo::GF::GuideCacheEviction::FIFO, 
+        cl_algo::GF::GuideCacheEviction::NONE };
+
+    for (cl_algo::GF::GuideCacheEviction policy : policies)
+    {
+        cl_algo::GF::GuideCache cache (directory, 2 * entrySize, policy);
+        cl_algo::GF::GuideCache::Entry entry;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            std::fill (mean.begin (), mean.end (), (float) k);
+            std::fill (var.begin (), var.end (), (float) -k);
+
+            ASSERT_FALSE (cache.lookup (keys[k], entry));
+            bool stored = cache.store (keys[k], mean.data (), var.data ());
+            ASSERT_EQ (stored, (policy != cl_algo::GF::GuideCacheEviction::NONE) || (k < 2));
+
+            // Hit the first entry, after the second has been stored
+            usleep (10000);
+            if (k == 1)
+            {
+                ASSERT_TRUE (cache.lookup (keys[0], entry));
+                usleep (10000);
+            }
+        }
+
+        ASSERT_EQ (cache.entries (), 2u);
+        ASSERT_LE (cache.size (), cache.getMaxBytes ());
+
+        switch (policy)
+        {
+            case cl_algo::GF::GuideCacheEviction::LRU:
+                ASSERT_TRUE (cache.lookup (keys[0], entry));
+                ASSERT_FALSE (cache.lookup (keys[1], entry));
+                ASSERT_TRUE (cache.lookup (keys[2], entry));
+                break;
+            case cl_algo::GF::GuideCacheEviction::FIFO:
+                ASSERT_FALSE (cache.lookup (keys[0], entry));
+                ASSERT_TRUE (cache.lookup (keys[1], entry));
+                ASSERT_TRUE (cache.lookup (keys[2], entry));
+                break;
+            case cl_algo::GF::GuideCacheEviction::NONE:
+                ASSERT_TRUE (cache.lookup (keys[0], entry));
+                ASSERT_TRUE (cache.lookup (keys[1], entry));
+                ASSERT_FALSE (cache.lookup (keys[2], entry));
+                break;
+        }
+
+        // The entry holds the stored statistics
+        ASSERT_TRUE (cache.lookup (keys[1], entry));
+        for (uint i = 0; i < n; ++i)
+        {
+            ASSERT_EQ (entry.mean ()[i], 1.f);
+            ASSERT_EQ (entry.var ()[i], -1.f);
+        }
+
+        // Other parameters of the same guide are other entries
+        keys.push_back (cl_algo::GF::GuideCache::key (guide.data (), width, height, radius + 1, eps));
+        ASSERT_FALSE (cache.lookup (keys.back (), entry));
+        keys.pop_back ();
+
+        cache.clear ();
+        ASSERT_EQ (cache.entries (), 0u);
+    }
+
+    rmdir (directory.c_str ());
+}
+
+
+/*! \brief Tests the removal of the temporary files left over by stores that didn't finish.
+ *  \details Old temporary files are removed when the cache lists its entries. 
+ *           Recent ones (of stores in progress) are kept, and neither is an entry.
+ */
+TEST (GuideCache, staleTemporaryFiles)
+{
+    const std::string directory = tempDirectory ();
+    cl_algo::GF::GuideCache cache (directory);
+
+    const std::string stale = directory + "/0123456789abcdef-64x32-r3-e3c23d70a.gfc.tmp-1-0";
+    const std::string recent = directory + "/0123456789abcdef-64x32-r3-e3c23d70a.gfc.tmp-1-1";
+    std::ofstream (stale) << "partial";
+    std::ofstream (recent) << "partial";
+
+    // Backdate the stale file by an hour
+    struct utimbuf times;
+    times.actime = times.modtime = std::time (nullptr) - 3600;
+    ASSERT_EQ (utime (stale.c_str (), &times), 0);
+
+    ASSERT_EQ (cache.entries (), 0u);
+    ASSERT_EQ (cache.size (), 0u);
+    ASSERT_NE (access (stale.c_str (), F_OK), 0);
+    ASSERT_EQ (access (recent.c_str (), F_OK), 0);
+
+    unlink (recent.c_str ());
+    rmdir (directory.c_str ());
+}
+
+
+/*! \brief Tests the **Guided Filter** with shared guide statistics, through the cache.
+ *  \details The first instance computes the statistics of the guide, and stores 
+ *           them. The second instance (e.g. in another process) finds them, and 
+ *           skips the computation. Both outputs are compared with a CPU reference.
+ */
+TEST (GuideCache, guidedFilterShared)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240, channels = 2;
+        const unsigned int n = width * height;
+        const int gfRadius = 5;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        const std::string directory = tempDirectory ();
+        cl_algo::GF::GuideCache cache (directory);
+
+        std::vector<cl_float> guide (n), p (channels * n);
+        std::generate (guide.begin (), guide.end (), GF::rNum_R_0_1);
+        std::generate (p.begin (), p.end (), GF::rNum_R_0_1);
+
+        // Produce reference filtered planes
+        std::vector<cl_float> refGF (channels * n);
+        for (uint c = 0; c < channels; ++c)
+            GF::cpuGuidedFilter (guide.data (), p.data () + c * n, refGF.data () + c * n, 
+                                 width, height, gfRadius, gfEps);
+
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        for (int k = 0; k < 2; ++k)
+        {
+            cl_algo::GF::GuidedFilterShared gf (clEnv, info);
+            gf.init (width, height, channels, gfRadius, gfEps);
+
+            gf.write (cl_algo::GF::GuidedFilterShared::Memory::D_IN_I, guide.data (), CL_TRUE);
+            bool hit = cl_algo::GF::prepareGuide (gf, cache, guide.data (), width, height);
+            ASSERT_EQ (hit, k == 1);
+
+            gf.write (cl_algo::GF::GuidedFilterShared::Memory::D_IN_P, p.data (), CL_TRUE);
+            gf.run ();  // Execute kernels
+
+            cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+            // Verify filtered planes
+            for (uint i = 0; i < channels * n; ++i)
+                ASSERT_LT (std::abs (refGF[i] - results[i]), eps);
+
+            // Profiling ===========================================================
+            if (profiling && hit)
+            {
+                const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+                // Computed statistics
+                clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+                clutils::ProfilingInfo<nRepeat> pPrepare ("GPU (prepare)");
+                for (int i = 0; i < nRepeat; ++i)
+                    pPrepare[i] = gf.prepare (gTimer);
+
+                // Cached statistics
+                clutils::CPUTimer<double, std::milli> cTimer;
+                clutils::ProfilingInfo<nRepeat> pCache ("Cache (lookup + transfer)");
+                for (int i = 0; i < nRepeat; ++i)
+                {
+                    cTimer.start ();
+                    cl_algo::GF::prepareGuide (gf, cache, guide.data (), width, height);
+                    pCache[i] = cTimer.stop ();
+                }
+
+                // Benchmark
+                pCache.print (pPrepare, "GuideCache");
+            }
+        }
+
+        cache.clear ();
+        rmdir (directory.c_str ());
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+int main (int argc, char **argv)
+{
+    profiling = GF::setProfilingFlag (argc, argv);
+
+    ::testing::InitGoogleTest (&argc, argv);
+    
+    return RUN_ALL_TESTS ();
+}
@@ -38,9 +38,13 @@
 #include <random>
 #include <limits>
 #include <cmath>
+#include <atomic>
+#include <future>
+#include <thread>
 #include <gtest/gtest.h>
 #include <CLUtils.hpp>
 #include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/pool.hpp>
 #include <GuidedFilter/tests/helper_funcs.hpp>
 
 
@@ -57,6 +61,7 @@ namespace GF
     // Uniform random number generators
     extern std::function<unsigned char ()> rNum_0_255;
     extern std::function<unsigned short ()> rNum_0_10000;
+    extern std::function<unsigned short ()> rNum_0_65535;
     extern std::function<float ()> rNum_R_0_1;
 }
 
@@ -150,6 +155,299 @@ TEST (GuidedFilter, guidedFilter)
 }
 
 
+/*! \brief Tests the asynchronous interface of the **Guided Filter** algorithm.
+ *  \details Several frames are submitted through a bounded window, 
+ *           half with futures and half with callbacks, and every 
+ *           output is compared with the reference of its own input.
+ */
+TEST (GuidedFilter, guidedFilterAsync)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480;
+        const unsigned int nFrames = 8, window = 3;
+        const unsigned int gfRadius = 4;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0);
+        clEnv.addQueue (0, 0);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_EQ_P> gf (clEnv, info);
+        gf.init (width, height, gfRadius, gfEps, 0, 1e-4f, 1.f, cl_algo::GF::Staging::NONE);
+        gf.async.setWindow (window);
+
+        // Initialize data
+        std::vector<std::vector<cl_float>> frames (nFrames, std::vector<cl_float> (width * height));
+        std::vector<std::vector<cl_float>> results (nFrames, std::vector<cl_float> (width * height));
+        for (auto &frame : frames)
+            std::generate (frame.begin (), frame.end (), GF::rNum_R_0_1);
+
+        // Submit the frames
+        std::vector<std::future<void>> futures;
+        std::atomic<unsigned int> nCallbacks (0);
+        for (unsigned int i = 0; i < nFrames; ++i)
+        {
+            ASSERT_LE (gf.async.pending (), window);
+
+            if (i % 2 == 0)
+                futures.push_back (gf.submit (frames[i].data (), results[i].data ()));
+            else
+                gf.submit (frames[i].data (), [&results, &nCallbacks, i, width, height] (void *out)
+                {
+                    if (out == nullptr) return;
+                    std::copy ((cl_float *) out, (cl_float *) out + width * height, results[i].data ());
+                    nCallbacks++;
+                });
+        }
+
+        for (auto &future : futures) future.get ();
+        gf.async.drain ();
+        ASSERT_EQ (nFrames / 2, nCallbacks.load ());
+        ASSERT_EQ (0u, gf.async.pending ());
+
+        // Verify filtered outputs
+        std::vector<cl_float> refGF (width * height);
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();
+        for (unsigned int i = 0; i < nFrames; ++i)
+        {
+            GF::cpuGuidedFilter (frames[i].data (), refGF.data (), width, height, gfRadius, gfEps);
+            for (uint j = 0; j < width * height; ++j)
+                ASSERT_LT (std::abs (refGF[j] - results[i][j]), eps);
+        }
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the asynchronous submissions of the `GuidedFilter<GuidedFilterConfig::I_NEQ_P>`.
+ *  \details Pairs of frames are submitted, some with futures and some with callbacks, 
+ *           and the outputs are verified against the CPU reference.
+ */
+TEST (GuidedFilter, guidedFilterIpAsync)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480;
+        const unsigned int nFrames = 8, window = 3;
+        const unsigned int gfRadius = 4;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0);
+        clEnv.addQueue (0, 0);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_NEQ_P> gf (clEnv, info);
+        gf.init (width, height, gfRadius, gfEps, 0, 1e-4f, cl_algo::GF::Staging::NONE);
+        gf.async.setWindow (window);
+
+        // Initialize data
+        std::vector<std::vector<cl_float>> framesI (nFrames, std::vector<cl_float> (width * height));
+        std::vector<std::vector<cl_float>> framesP (nFrames, std::vector<cl_float> (width * height));
+        std::vector<std::vector<cl_float>> results (nFrames, std::vector<cl_float> (width * height));
+        for (unsigned int i = 0; i < nFrames; ++i)
+        {
+            std::generate (framesI[i].begin (), framesI[i].end (), GF::rNum_R_0_1);
+            std::generate (framesP[i].begin (), framesP[i].end (), GF::rNum_R_0_1);
+        }
+
+        // Submit the frames
+        std::vector<std::future<void>> futures;
+        std::atomic<unsigned int> nCallbacks (0);
+        for (unsigned int i = 0; i < nFrames; ++i)
+        {
+            ASSERT_LE (gf.async.pending (), window);
+
+            if (i % 2 == 0)
+                futures.push_back (gf.submit (framesI[i].data (), framesP[i].data (), results[i].data ()));
+            else
+                gf.submit (framesI[i].data (), framesP[i].data (), 
+                           [&results, &nCallbacks, i, width, height] (void *out)
+                {
+                    if (out == nullptr) return;
+                    std::copy ((cl_float *) out, (cl_float *) out + width * height, results[i].data ());
+                    nCallbacks++;
+                });
+        }
+
+        for (auto &future : futures) future.get ();
+        gf.async.drain ();
+        ASSERT_EQ (nFrames / 2, nCallbacks.load ());
+        ASSERT_EQ (0u, gf.async.pending ());
+
+        // Verify filtered outputs
+        std::vector<cl_float> refGF (width * height);
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();
+        for (unsigned int i = 0; i < nFrames; ++i)
+        {
+            GF::cpuGuidedFilter (framesI[i].data (), framesP[i].data (), refGF.data (), 
+                                 width, height, gfRadius, gfEps);
+            for (uint j = 0; j < width * height; ++j)
+                ASSERT_LT (std::abs (refGF[j] - results[i][j]), eps);
+        }
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the `GuidedFilterPool` under concurrent host threads.
+ *  \details Several threads check out instances for two different 
+ *           resolutions, filter a frame, and verify the output.
+ */
+TEST (GuidedFilter, guidedFilterPool)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int widths[] = { 640, 320 }, heights[] = { 480, 240 };
+        const unsigned int nThreads = 6, nIterations = 4, maxInstances = 4;
+        const unsigned int gfRadius = 4;
+        const float gfEps = std::pow (0.1, 2);
+
+        cl_algo::GF::GuidedFilterPool pool (kernel_files, maxInstances);
+
+        std::atomic<unsigned int> nFailures (0);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < nThreads; ++t)
+            threads.emplace_back ([&, t] ()
+            {
+                const unsigned int width = widths[t % 2], height = heights[t % 2];
+                std::vector<cl_float> frame (width * height), refGF (width * height);
+                float eps = 42000 * std::numeric_limits<float>::epsilon ();
+
+                for (unsigned int i = 0; i < nIterations; ++i)
+                {
+                    std::mt19937 gen (t * nIterations + i);
+                    std::uniform_real_distribution<float> dist (0.f, 1.f);
+                    std::generate (frame.begin (), frame.end (), [&] { return dist (gen); });
+
+                    cl_algo::GF::GuidedFilterPool::Lease gf = pool.checkout (width, height, gfRadius, gfEps);
+                    if (pool.size () > maxInstances) nFailures++;
+
+                    gf->write (cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_EQ_P>::Memory::D_IN, 
+                               frame.data ());
+                    gf->run ();
+                    cl_float *results = (cl_float *) gf->read ();
+
+                    GF::cpuGuidedFilter (frame.data (), refGF.data (), width, height, gfRadius, gfEps);
+                    for (unsigned int j = 0; j < width * height; ++j)
+                        if (std::abs (refGF[j] - results[j]) >= eps) { nFailures++; break; }
+                }
+            });
+
+        for (auto &thread : threads) thread.join ();
+
+        ASSERT_EQ (0u, nFailures.load ());
+        ASSERT_EQ (0u, pool.leased ());
+        ASSERT_LE (pool.size (), maxInstances);
+
+        // Shrink the pool
+        unsigned int size = pool.size ();
+        ASSERT_EQ (size, pool.trim (std::chrono::milliseconds (0)));
+        ASSERT_EQ (0u, pool.size ());
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests that the `GuidedFilterPool` serves more parameter sets than it has keys.
+ *  \details Every checkout asks for a new \f$ \epsilon \f$. The keys of released 
+ *           instances are replaced, so every checkout succeeds, and the instance 
+ *           is set up for the requested parameters.
+ */
+TEST (GuidedFilter, guidedFilterPoolKeys)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 64, height = 64;
+        const unsigned int nKeys = 100, maxInstances = 2;
+        const unsigned int gfRadius = 2;
+
+        cl_algo::GF::GuidedFilterPool pool (kernel_files, maxInstances);
+
+        std::vector<cl_float> frame (width * height), refGF (width * height);
+        std::generate (frame.begin (), frame.end (), GF::rNum_R_0_1);
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();
+
+        for (unsigned int k = 0; k < nKeys; ++k)
+        {
+            const float gfEps = 0.001f * (k + 1);
+            cl_algo::GF::GuidedFilterPool::Lease gf = pool.checkout (width, height, gfRadius, gfEps);
+            ASSERT_TRUE ((bool) gf);
+            ASSERT_EQ (gfEps, gf->getEps ());
+            ASSERT_LE (pool.size (), maxInstances);
+
+            // Verify the output of some of the parameter sets
+            if (k % 25 != 24) continue;
+            gf->write (cl_algo::GF::GuidedFilter<cl_algo::GF::GuidedFilterConfig::I_EQ_P>::Memory::D_IN, 
+                       frame.data ());
+            gf->run ();
+            cl_float *results = (cl_float *) gf->read ();
+
+            GF::cpuGuidedFilter (frame.data (), refGF.data (), width, height, gfRadius, gfEps);
+            for (unsigned int j = 0; j < width * height; ++j)
+                ASSERT_LT (std::abs (refGF[j] - results[j]), eps);
+        }
+
+        ASSERT_EQ (0u, pool.leased ());
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
 /*! \brief Tests the **Guided Filter** algorithm for the general case \f$\ I \neq p \f$.
  *  \details There are many applications for this algorithm, one which 
  *           is an edge preserving smoothing effect on an image.
@@ -244,6 +542,1397 @@ TEST (GuidedFilter, guidedFilterIp)
 }
 
 
+/*! \brief Tests the **Guided Filter** algorithm for the general case \f$\ I \neq p \f$, 
+ *         with the independent branches of the pipeline submitted on four command queues.
+ *  \details The operation is an edge preserving smoothing effect on an image.
+ */
+TEST (GuidedFilter, guidedFilterIpConcurrent)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int gfRadius = 5;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        for (int i = 0; i < 4; ++i)
+            clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<4> info (0, 0, 0, { 0, 1, 2, 3 }, 0);
+        const cl_algo::GF::GuidedFilterConfig Ip = cl_algo::GF::GuidedFilterConfig::I_NEQ_P;
+        cl_algo::GF::GuidedFilter<Ip> gf (clEnv, info);
+        gf.setEngine (cl_algo::GF::GuidedFilterEngine::SAT);  // The fused engine uses a single queue
+        gf.init (width, height, gfRadius, gfEps);
+        ASSERT_EQ (cl_algo::GF::GuidedFilterEngine::SAT, gf.getEngine ());
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrInI, gf.hPtrInI + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        std::generate (gf.hPtrInP, gf.hPtrInP + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        // Copy data to device
+        gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_I);
+        gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_P);
+
+        gf.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+        // Produce reference filtered array
+        cl_float *refGF = new cl_float[width * height];
+        GF::cpuGuidedFilter (gf.hPtrInI, gf.hPtrInP, refGF, width, height, gfRadius, gfEps);
+
+        // Verify filtered output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                ASSERT_LT (std::abs (refGF[row * width + col] - results[row * width + col]), eps);
+
+        delete[] refGF;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the replay of a recorded **Guided Filter** pipeline.
+ *  \details The pipeline is spread over four command queues, so the recording 
+ *           has dependencies between queues. The replayed output is verified 
+ *           against the reference implementation. With profiling enabled, the 
+ *           host time spent enqueuing a frame is compared between `run` and `replay`.
+ */
+TEST (GuidedFilter, guidedFilterIpReplay)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_img, 
+                                                        kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int gfRadius = 12;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        for (int i = 0; i < 4; ++i)
+            clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<4> info (0, 0, 0, { 0, 1, 2, 3 }, 0);
+        const cl_algo::GF::GuidedFilterConfig Ip = cl_algo::GF::GuidedFilterConfig::I_NEQ_P;
+        cl_algo::GF::GuidedFilter<Ip> gf (clEnv, info);
+        gf.init (width, height, gfRadius, gfEps);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrInI, gf.hPtrInI + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        std::generate (gf.hPtrInP, gf.hPtrInP + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        // Copy data to device
+        gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_I);
+        gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_P);
+
+        gf.capture ();  // Record kernels
+        gf.replay ();  // Execute recorded kernels
+        
+        cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+        // Produce reference filtered array
+        cl_float *refGF = new cl_float[width * height];
+        GF::cpuGuidedFilter (gf.hPtrInI, gf.hPtrInP, refGF, width, height, gfRadius, gfEps);
+
+        // Verify filtered output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                ASSERT_LT (std::abs (refGF[row * width + col] - results[row * width + col]), eps);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 100;  /* Number of times to perform the tests. */
+
+            cl::CommandQueue &queue = clEnv.getQueue (0, 0);
+            clutils::CPUTimer<double, std::milli> cTimer;
+
+            // Host time for enqueuing the kernels one by one
+            clutils::ProfilingInfo<nRepeat> pRun ("Run");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                gf.run ();
+                pRun[i] = cTimer.stop ();
+                gf.read ();
+            }
+
+            // Host time for replaying the recording
+            clutils::ProfilingInfo<nRepeat> pReplay ("Replay");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                gf.replay ();
+                pReplay[i] = cTimer.stop ();
+                gf.read ();
+            }
+            queue.finish ();
+
+            // Benchmark
+            pReplay.print (pRun, "GuidedFilter<GuidedFilterConfig::I_NEQ_P> (host enqueue time)");
+        }
+
+        delete[] refGF;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the runtime counters of the **Guided Filter** algorithm.
+ *  \details The transfers are counted in bytes, the kernels of the component 
+ *           classes add up to the counters of the filter, and frames are counted
+ *           for both `run` and `replay`. Only the kernels of the sampled frames 
+ *           are timed, unless every frame is asked for.
+ */
+TEST (GuidedFilter, guidedFilterIpCounters)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_img, 
+                                                        kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int gfRadius = 5;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        for (int i = 0; i < 4; ++i)
+            clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<4> info (0, 0, 0, { 0, 1, 2, 3 }, 0);
+        const cl_algo::GF::GuidedFilterConfig Ip = cl_algo::GF::GuidedFilterConfig::I_NEQ_P;
+        typedef cl_algo::GF::Counters::Counter Counter;
+        cl_algo::GF::Counters &global = cl_algo::GF::Counters::global ();
+        const uint64_t globalFrames = global.get (Counter::FRAMES);
+
+        cl_algo::GF::GuidedFilter<Ip> gf (clEnv, info);
+        gf.init (width, height, gfRadius, gfEps);
+        ASSERT_GE (gf.counters.get (Counter::DEVICE_MEMORY), 3 * bufferSize);
+        ASSERT_GE (gf.counters.get (Counter::HOST_MEMORY), 3 * bufferSize);
+        ASSERT_EQ (gf.counters.get (Counter::KERNELS), 0);
+
+        std::generate (gf.hPtrInI, gf.hPtrInI + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        std::generate (gf.hPtrInP, gf.hPtrInP + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        const int nFrames = 4;
+        for (int i = 0; i < nFrames; ++i)
+        {
+            gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_I);
+            gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_P);
+            if (i % 2) gf.replay (); else gf.run ();
+            gf.read ();
+        }
+
+        ASSERT_EQ (gf.counters.get (Counter::WRITES), 2 * nFrames);
+        ASSERT_EQ (gf.counters.get (Counter::WRITE_BYTES), 2 * nFrames * bufferSize);
+        ASSERT_EQ (gf.counters.get (Counter::READS), nFrames);
+        ASSERT_EQ (gf.counters.get (Counter::READ_BYTES), nFrames * bufferSize);
+        ASSERT_GT (gf.counters.get (Counter::KERNELS), 0);
+
+        // Frames are accounted by event callbacks, after the commands complete
+        for (int i = 0; i < 1000 && gf.counters.get (Counter::FRAMES) < nFrames; ++i)
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        ASSERT_EQ (gf.counters.get (Counter::FRAMES), nFrames);
+        ASSERT_GT (gf.counters.get (Counter::WALL_TIME), 0);
+        ASSERT_GT (gf.counters.get (Counter::DEVICE_TIME), 0);
+        ASSERT_EQ (gf.counters.get (Counter::TIMED_FRAMES), 1);  // The first of 4 < defaultTimingPeriod
+        ASSERT_GE (global.get (Counter::FRAMES), globalFrames + nFrames);
+
+        // Time the kernels of every frame
+        gf.counters.setTimingPeriod (1);
+        for (int i = 0; i < nFrames; ++i)
+        {
+            gf.run ();
+            gf.read ();
+        }
+        ASSERT_EQ (gf.counters.get (Counter::TIMED_FRAMES), 1 + nFrames);
+
+        // Reallocations replace the memory, rather than add to it
+        const uint64_t deviceMemory = gf.counters.get (Counter::DEVICE_MEMORY);
+        const uint64_t hostMemory = gf.counters.get (Counter::HOST_MEMORY);
+        gf.init (width, height, gfRadius, gfEps);
+        for (int i = 0; i < 1000 && gf.counters.get (Counter::DEVICE_MEMORY) > deviceMemory; ++i)
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        ASSERT_EQ (gf.counters.get (Counter::DEVICE_MEMORY), deviceMemory);
+        ASSERT_EQ (gf.counters.get (Counter::HOST_MEMORY), hostMemory);
+
+        std::string text = cl_algo::GF::Counters::dump ();
+        ASSERT_NE (text.find ("gf_kernels_total{scope=\"process\"}"), std::string::npos);
+        ASSERT_NE (text.find ("class=\"GuidedFilter<GuidedFilterConfig::I_NEQ_P>\""), std::string::npos);
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the multi-device driver of the **Guided Filter** algorithm.
+ *  \details Two `GuidedFilter` instances on the same device stand in for two devices. 
+ *           The output is verified for an even and an uneven split of the image.
+ */
+TEST (GuidedFilter, guidedFilterIpMultiDevice)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const unsigned int gfRadius = 10;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        for (int i = 0; i < 4; ++i)
+            clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        std::vector<clutils::CLEnvInfo<2>> info = { clutils::CLEnvInfo<2> (0, 0, 0, { 0, 1 }, 0), 
+                                                    clutils::CLEnvInfo<2> (0, 0, 0, { 2, 3 }, 0) };
+        const cl_algo::GF::GuidedFilterConfig Ip = cl_algo::GF::GuidedFilterConfig::I_NEQ_P;
+        cl_algo::GF::GuidedFilterMultiDevice<Ip> gf (clEnv, info);
+        gf.init (width, height, gfRadius, gfEps);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrInI, gf.hPtrInI + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        std::generate (gf.hPtrInP, gf.hPtrInP + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        // Produce reference filtered array
+        cl_float *refGF = new cl_float[width * height];
+        GF::cpuGuidedFilter (gf.hPtrInI, gf.hPtrInP, refGF, width, height, gfRadius, gfEps);
+
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (const std::vector<double> &throughput : { std::vector<double> { 1.0, 1.0 }, 
+                                                       std::vector<double> { 3.0, 1.0 } })
+        {
+            gf.setThroughput (throughput);
+            
+            // The times of the bands, halos included, are within a block of rows
+            const double halo = 32, block = 16;
+            std::vector<unsigned int> bandHeights = gf.getBandHeights ();
+            ASSERT_EQ (bandHeights[0] + bandHeights[1], height);
+            ASSERT_LE (std::abs ((bandHeights[0] + halo) / throughput[0] - 
+                                 (bandHeights[1] + halo) / throughput[1]), block);
+
+            gf.write ();  // Copy data to devices
+
+            gf.run ();  // Execute kernels
+
+            cl_float *results = (cl_float *) gf.read ();  // Gather results on host
+
+            // Verify filtered output
+            for (uint row = 0; row < height; ++row)
+                for (uint col = 0; col < width; ++col)
+                    ASSERT_LT (std::abs (refGF[row * width + col] - results[row * width + col]), eps);
+        }
+
+        delete[] refGF;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the engines of the **Guided Filter** algorithm, for the special case \f$\ I = p \f$.
+ *  \details Checks that the fused engine is selected for small radii and that the 
+ *           `BoxFilterSAT` based one is selected otherwise. Both engines are 
+ *           verified against the reference implementation.
+ */
+TEST (GuidedFilter, guidedFilterEngines)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const float gfEps = std::pow (0.2, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        const cl_algo::GF::GuidedFilterConfig Ip = cl_algo::GF::GuidedFilterConfig::I_EQ_P;
+        cl_algo::GF::GuidedFilter<Ip> gf (clEnv, info);
+        gf.init (width, height, 3, gfEps);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrIn, gf.hPtrIn + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        // Copy data to device
+        gf.write ();
+
+        cl_float *refGF = new cl_float[width * height];
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+
+        struct { int radius; bool setSAT; cl_algo::GF::GuidedFilterEngine engine; } cases[] = {
+            { 3,  false, cl_algo::GF::GuidedFilterEngine::FUSED },
+            { 12, false, cl_algo::GF::GuidedFilterEngine::SAT   },
+            { 3,  true,  cl_algo::GF::GuidedFilterEngine::SAT   }
+        };
+
+        for (auto &c : cases)
+        {
+            if (c.setSAT) gf.setEngine (cl_algo::GF::GuidedFilterEngine::SAT);
+            gf.setRadius (c.radius);
+            ASSERT_EQ (c.engine, gf.getEngine ());
+
+            gf.run ();  // Execute kernels
+            
+            cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+            // Produce reference filtered array
+            GF::cpuGuidedFilter (gf.hPtrIn, refGF, width, height, c.radius, gfEps);
+
+            // Verify filtered output
+            for (uint row = 0; row < height; ++row)
+                for (uint col = 0; col < width; ++col)
+                    ASSERT_LT (std::abs (refGF[row * width + col] - results[row * width + col]), eps);
+        }
+
+        delete[] refGF;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the engines of the **Guided Filter** algorithm, for the general case \f$\ I \neq p \f$.
+ *  \details Checks that the fused engine is selected for small radii and that the 
+ *           `BoxFilterSAT` based one is selected otherwise. Both engines are 
+ *           verified against the reference implementation.
+ */
+TEST (GuidedFilter, guidedFilterIpEngines)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240;
+        const unsigned int bufferSize = width * height * sizeof (cl_float);
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        const cl_algo::GF::GuidedFilterConfig Ip = cl_algo::GF::GuidedFilterConfig::I_NEQ_P;
+        cl_algo::GF::GuidedFilter<Ip> gf (clEnv, info);
+        gf.init (width, height, 5, gfEps);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrInI, gf.hPtrInI + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+        std::generate (gf.hPtrInP, gf.hPtrInP + bufferSize / sizeof (cl_float), GF::rNum_R_0_1);
+
+        // Copy data to device
+        gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_I);
+        gf.write (cl_algo::GF::GuidedFilter<Ip>::Memory::D_IN_P);
+
+        cl_float *refGF = new cl_float[width * height];
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+
+        struct { int radius; bool setSAT; cl_algo::GF::GuidedFilterEngine engine; } cases[] = {
+            { 5,  false, cl_algo::GF::GuidedFilterEngine::FUSED },
+            { 3,  false, cl_algo::GF::GuidedFilterEngine::FUSED },
+            { 12, false, cl_algo::GF::GuidedFilterEngine::SAT   },
+            { 5,  true,  cl_algo::GF::GuidedFilterEngine::SAT   }
+        };
+
+        for (auto &c : cases)
+        {
+            if (c.setSAT) gf.setEngine (cl_algo::GF::GuidedFilterEngine::SAT);
+            gf.setRadius (c.radius);
+            ASSERT_EQ (c.engine, gf.getEngine ());
+
+            gf.run ();  // Execute kernels
+            
+            cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+            // Produce reference filtered array
+            GF::cpuGuidedFilter (gf.hPtrInI, gf.hPtrInP, refGF, width, height, c.radius, gfEps);
+
+            // Verify filtered output
+            for (uint row = 0; row < height; ++row)
+                for (uint col = 0; col < width; ++col)
+                    ASSERT_LT (std::abs (refGF[row * width + col] - results[row * width + col]), eps);
+        }
+
+        delete[] refGF;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests **guided upsampling**.
+ *  \details A low-resolution array is upsampled to the resolution of the guidance array, 
+ *           with the coefficients computed at the low resolution.
+ */
+TEST (GuidedFilter, guidedUpsampling)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480, factor = 4;
+        const unsigned int pixels = width * height, lPixels = pixels / (factor * factor);
+        const int gfRadius = 16;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedUpsampling gu (clEnv, info);
+        gu.init (width, height, factor, gfRadius, gfEps, 1);
+
+        // Initialize data (writes on staging buffer directly)
+        // About a tenth of the input pixels are zero (invalid)
+        std::generate (gu.hPtrInI, gu.hPtrInI + pixels, GF::rNum_R_0_1);
+        std::generate (gu.hPtrInP, gu.hPtrInP + lPixels, GF::rNum_R_0_1);
+        for (uint k = 0; k < lPixels; ++k)
+            if (gu.hPtrInP[k] < 0.1f) gu.hPtrInP[k] = 0.f;
+
+        // Copy data to device
+        gu.write (cl_algo::GF::GuidedUpsampling::Memory::D_IN_I);
+        gu.write (cl_algo::GF::GuidedUpsampling::Memory::D_IN_P);
+
+        gu.run ();  // Execute kernels
+
+        cl_float *results = (cl_float *) gu.read ();  // Copy results to host
+
+        // Produce reference upsampled array
+        cl_float *refGU = new cl_float[pixels];
+        GF::cpuGuidedUpsampling (gu.hPtrInI, gu.hPtrInP, refGU, width, height, 
+                                 factor, gfRadius / factor, gfEps, true);
+
+        // Verify upsampled output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                ASSERT_LT (std::abs (refGU[row * width + col] - results[row * width + col]), eps);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuGuidedUpsampling (gu.hPtrInI, gu.hPtrInP, refGU, width, height, 
+                                         factor, gfRadius / factor, gfEps, true);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = gu.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "GuidedUpsampling");
+        }
+
+        delete[] refGU;
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the iterated **Guided Filter** algorithm (rolling guidance).
+ *  \details The output of every iteration is the guide of the next one. 
+ *           The output is compared with the CPU filter applied iteratively, 
+ *           first for a fixed number of iterations, and then with a tolerance 
+ *           that stops the iterations early.
+ */
+TEST (GuidedFilter, guidedFilterIterated)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480;
+        const unsigned int pixels = width * height;
+        const unsigned int gfRadius = 5;
+        const float gfEps = std::pow (0.1, 2);
+        const unsigned int nIterations = 4;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilterIterated gfi (clEnv, info);
+        gfi.init (width, height, gfRadius, gfEps, nIterations);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gfi.hPtrInI, gfi.hPtrInI + pixels, GF::rNum_R_0_1);
+        std::generate (gfi.hPtrInP, gfi.hPtrInP + pixels, GF::rNum_R_0_1);
+
+        // Copy data to device
+        gfi.write (cl_algo::GF::GuidedFilterIterated::Memory::D_IN_I);
+        gfi.write (cl_algo::GF::GuidedFilterIterated::Memory::D_IN_P);
+
+        gfi.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) gfi.read ();  // Copy results to host
+        ASSERT_EQ (nIterations, gfi.getExecuted ());
+
+        // Produce reference filtered arrays for every number of iterations
+        std::vector<std::vector<cl_float>> refGF (nIterations + 1, std::vector<cl_float> (pixels));
+        std::copy (gfi.hPtrInI, gfi.hPtrInI + pixels, refGF[0].begin ());
+        for (unsigned int i = 0; i < nIterations; ++i)
+            GF::cpuGuidedFilter (refGF[i].data (), gfi.hPtrInP, refGF[i + 1].data (), width, height, gfRadius, gfEps);
+
+        // Verify filtered output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint i = 0; i < pixels; ++i)
+            ASSERT_LT (std::abs (refGF[nIterations][i] - results[i]), eps);
+
+        // Stop early, once the guide changes by less than the change in the second iteration
+        float change = 0.f;
+        for (uint i = 0; i < pixels; ++i)
+            change = std::max (change, std::abs (refGF[2][i] - refGF[1][i]));
+        gfi.setTolerance (change + eps);
+        gfi.run ();
+        results = (cl_float *) gfi.read ();
+
+        // The iterations stop on the device, right after the converged one
+        unsigned int executed = gfi.getExecuted ();
+        ASSERT_EQ (2u, executed);
+        ASSERT_LE (gfi.getResidual (1), change + eps);
+        ASSERT_EQ (0.f, gfi.getResidual (2));
+        for (uint i = 0; i < pixels; ++i)
+            ASSERT_LT (std::abs (refGF[executed][i] - results[i]), eps);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                for (unsigned int k = 0; k < nIterations; ++k)
+                    GF::cpuGuidedFilter (refGF[k].data (), gfi.hPtrInP, refGF[k + 1].data (), 
+                                         width, height, gfRadius, gfEps);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = gfi.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "GuidedFilterIterated");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the multi-scale detail enhancement pipeline.
+ *  \details Two scales share the summed area tables of the log-luminance. 
+ *           The `uchar` output is compared with a CPU reference that filters 
+ *           every scale from scratch.
+ */
+TEST (GuidedFilter, detailEnhancement)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 256, height = 256;
+        const unsigned int pixels = width * height;
+        const std::vector<int> radii = { 2, 8 };
+        const std::vector<float> boost = { 2.f, 1.5f };
+        const float gfEps = std::pow (0.1, 2);
+        const float compression = 0.5f, anchor = 1.f, exposure = 1.f, gamma = 2.2f;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::DetailEnhancement de (clEnv, info);
+        de.init (width, height, radii, gfEps);
+        for (unsigned int k = 0; k < radii.size (); ++k)
+            de.setBoost (k, boost[k]);
+        de.setCompression (compression);
+        de.setAnchor (anchor);
+        de.setExposure (exposure);
+        de.setGamma (gamma);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (de.hPtrIn, de.hPtrIn + 3 * pixels, GF::rNum_R_0_1);
+
+        de.write ();  // Copy data to device
+
+        de.run ();  // Execute kernels
+        
+        cl_uchar *results = (cl_uchar *) de.read ();  // Copy results to host
+
+        // Produce reference enhanced image
+        std::vector<cl_uchar> refDE (3 * pixels);
+        GF::cpuDetailEnhancement (de.hPtrIn, refDE.data (), width, height, radii.data (), boost.data (), 
+                                  radii.size (), gfEps, compression, anchor, exposure, gamma);
+
+        // Verify enhanced image
+        //* The summations on the device are in single precision, so a few pixels 
+        //* may differ by more than a level, but the differences have to be rare
+        int maxDiff = 0; double meanDiff = 0.0;
+        for (uint i = 0; i < 3 * pixels; ++i)
+        {
+            int diff = std::abs ((int) refDE[i] - (int) results[i]);
+            maxDiff = std::max (maxDiff, diff);
+            meanDiff += diff;
+        }
+        meanDiff /= 3 * pixels;
+        ASSERT_LE (maxDiff, 8);
+        ASSERT_LT (meanDiff, 0.5);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuDetailEnhancement (de.hPtrIn, refDE.data (), width, height, radii.data (), boost.data (), 
+                                          radii.size (), gfEps, compression, anchor, exposure, gamma);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = de.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "DetailEnhancement");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+/*! \brief Tests the dehazing pipeline.
+ *  \details A synthetic hazy image, \f$ I = J t + A (1 - t) \f$, is dehazed. 
+ *           The dark channel, the atmospheric light, and the refined transmission 
+ *           are compared with a CPU reference, and the output with the recovery 
+ *           from the transmission and light that were estimated on the device.
+ */
+TEST (GuidedFilter, dehazing)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480;
+        const unsigned int pixels = width * height;
+        const unsigned int bufferSize = pixels * sizeof (cl_float);
+        const int darkRadius = 7, gfRadius = 20;
+        const float gfEps = 1e-3f, omega = 0.95f, t0 = 0.1f;
+        const float A[3] = { 0.9f, 0.85f, 0.8f };
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::Dehazing dh (clEnv, info);
+        dh.init (width, height, darkRadius, gfRadius, gfEps, omega, t0);
+
+        // Initialize data (writes on staging buffer directly)
+        //* The haze thickens from left to right
+        for (uint row = 0; row < height; ++row)
+        {
+            for (uint col = 0; col < width; ++col)
+            {
+                float t = 0.2f + 0.7f * col / width;
+                cl_float *I = dh.hPtrIn + 3 * (row * width + col);
+                for (int c = 0; c < 3; ++c)
+                    I[c] = GF::rNum_R_0_1 () * t + A[c] * (1 - t);
+            }
+        }
+
+        dh.write ();  // Copy data to device
+
+        dh.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) dh.read ();  // Copy results to host
+        cl_float4 light = dh.getAtmosphericLight ();
+
+        std::vector<cl_float> dark (pixels), trans (pixels);
+        cl::CommandQueue &queue = clEnv.getQueue (0, 0);
+        queue.enqueueReadBuffer ((cl::Buffer &) dh.get (cl_algo::GF::Dehazing::Memory::D_DARK), 
+                                 CL_TRUE, 0, bufferSize, dark.data ());
+        queue.enqueueReadBuffer ((cl::Buffer &) dh.get (cl_algo::GF::Dehazing::Memory::D_TRANSMISSION), 
+                                 CL_TRUE, 0, bufferSize, trans.data ());
+
+        // Produce reference estimates
+        std::vector<cl_float> refDark (pixels), refTrans (pixels);
+        cl_float refLight[3];
+        GF::cpuDehazing (dh.hPtrIn, refDark.data (), refLight, refTrans.data (), 
+                         width, height, darkRadius, gfRadius, gfEps, omega);
+
+        // Verify dark channel (the filter only selects values, so they match exactly)
+        for (uint i = 0; i < pixels; ++i)
+            ASSERT_EQ (refDark[i], dark[i]);
+
+        // Verify atmospheric light
+        ASSERT_LT (std::abs (refLight[0] - light.s[0]), 1e-4f);
+        ASSERT_LT (std::abs (refLight[1] - light.s[1]), 1e-4f);
+        ASSERT_LT (std::abs (refLight[2] - light.s[2]), 1e-4f);
+
+        // Verify refined transmission
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint i = 0; i < pixels; ++i)
+            ASSERT_LT (std::abs (refTrans[i] - trans[i]), eps);
+
+        // Verify recovered image
+        for (uint i = 0; i < pixels; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                float I = dh.hPtrIn[3 * i + c];
+                float J = (I - light.s[c]) / std::max (trans[i], t0) + light.s[c];
+                J = std::min (std::max (J, 0.f), 1.f);
+                ASSERT_LT (std::abs (J - results[3 * i + c]), 1e-4f);
+            }
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuDehazing (dh.hPtrIn, refDark.data (), refLight, refTrans.data (), 
+                                 width, height, darkRadius, gfRadius, gfEps, omega);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = dh.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "Dehazing");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+/*! \brief Tests the **Guided Filter** algorithm on volumes.
+ *  \details The windows extend across the slices of the volumes.
+ */
+TEST (GuidedFilter, guidedFilter3D)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 128, height = 64, depth = 16;
+        const unsigned int n = width * height * depth;
+        const int gfRadius = 3, gfRadiusZ = 2;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilter3D gf (clEnv, info);
+        gf.init (width, height, depth, gfRadius, gfRadiusZ, gfEps);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrInI, gf.hPtrInI + n, GF::rNum_R_0_1);
+        std::generate (gf.hPtrInP, gf.hPtrInP + n, GF::rNum_R_0_1);
+
+        gf.write (cl_algo::GF::GuidedFilter3D::Memory::D_IN_I);  // Copy data to device
+        gf.write (cl_algo::GF::GuidedFilter3D::Memory::D_IN_P, nullptr, CL_TRUE);
+
+        gf.run ();  // Execute kernels
+        
+        cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+        // Produce reference filtered volume
+        std::vector<cl_float> refGF (n);
+        GF::cpuGuidedFilter3D (gf.hPtrInI, gf.hPtrInP, refGF.data (), 
+                               width, height, depth, gfRadius, gfRadiusZ, gfEps);
+
+        // Verify filtered output
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint i = 0; i < n; ++i)
+            ASSERT_LT (std::abs (refGF[i] - results[i]), eps);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuGuidedFilter3D (gf.hPtrInI, gf.hPtrInP, refGF.data (), 
+                                       width, height, depth, gfRadius, gfRadiusZ, gfEps);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = gf.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "GuidedFilter3D");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **Guided Filter** algorithm on a video stream.
+ *  \details The windows span the last frames of the stream, and 
+ *           every frame is compared with a causal CPU reference.
+ */
+TEST (GuidedFilter, guidedFilter3DCausal)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 128, height = 64, frames = 4, nFrames = 10;
+        const unsigned int pixels = width * height;
+        const int gfRadius = 3;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilter3D gf (clEnv, info);
+        gf.init (width, height, frames, gfRadius, 0, gfEps, cl_algo::GF::Window3D::CAUSAL);
+
+        // Produce the streams, and the reference filtered frames
+        std::vector<cl_float> streamI (pixels * nFrames), streamP (pixels * nFrames);
+        std::vector<cl_float> refGF (pixels * nFrames);
+        std::generate (streamI.begin (), streamI.end (), GF::rNum_R_0_1);
+        std::generate (streamP.begin (), streamP.end (), GF::rNum_R_0_1);
+        GF::cpuGuidedFilter3D (streamI.data (), streamP.data (), refGF.data (), 
+                               width, height, nFrames, gfRadius, 0, gfEps, frames);
+
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        for (uint t = 0; t < nFrames; ++t)
+        {
+            gf.write (cl_algo::GF::GuidedFilter3D::Memory::D_IN_I, streamI.data () + t * pixels);
+            gf.write (cl_algo::GF::GuidedFilter3D::Memory::D_IN_P, streamP.data () + t * pixels, CL_TRUE);
+            gf.run ();
+            cl_float *results = (cl_float *) gf.read ();
+
+            for (uint i = 0; i < pixels; ++i)
+                ASSERT_LT (std::abs (refGF[t * pixels + i] - results[i]), eps);
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **Guided Filter** algorithm on many inputs with a shared guide.
+ *  \details The guide is prepared once, and two sets of input planes are filtered 
+ *           against it. Every plane is compared with a CPU reference.
+ */
+TEST (GuidedFilter, guidedFilterShared)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 320, height = 240, channels = 3;
+        const unsigned int n = width * height;
+        const int gfRadius = 5;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilterShared gf (clEnv, info);
+        gf.init (width, height, channels, gfRadius, gfEps);
+
+        // Prepare the guide once
+        std::generate (gf.hPtrInI, gf.hPtrInI + n, GF::rNum_R_0_1);
+        gf.write (cl_algo::GF::GuidedFilterShared::Memory::D_IN_I, nullptr, CL_TRUE);
+        gf.prepare ();
+
+        float eps = 42000 * std::numeric_limits<float>::epsilon ();  // 0.00500679
+        std::vector<cl_float> refGF (n);
+        for (int k = 0; k < 2; ++k)
+        {
+            // Initialize data (writes on staging buffer directly)
+            std::generate (gf.hPtrInP, gf.hPtrInP + channels * n, GF::rNum_R_0_1);
+            gf.write (cl_algo::GF::GuidedFilterShared::Memory::D_IN_P, nullptr, CL_TRUE);
+
+            gf.run ();  // Execute kernels
+            
+            cl_float *results = (cl_float *) gf.read ();  // Copy results to host
+
+            // Verify filtered planes
+            for (uint c = 0; c < channels; ++c)
+            {
+                GF::cpuGuidedFilter (gf.hPtrInI, gf.hPtrInP + c * n, refGF.data (), 
+                                     width, height, gfRadius, gfEps);
+                for (uint i = 0; i < n; ++i)
+                    ASSERT_LT (std::abs (refGF[i] - results[c * n + i]), eps);
+            }
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                for (uint c = 0; c < channels; ++c)
+                    GF::cpuGuidedFilter (gf.hPtrInI, gf.hPtrInP + c * n, refGF.data (), 
+                                         width, height, gfRadius, gfEps);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = gf.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "GuidedFilterShared (3 channels, prepared guide)");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the `YUV 4:2:0` pipeline of the **Guided Filter** algorithm.
+ *  \details An NV12 image is filtered with the chroma planes passed through, 
+ *           and an I420 image with the chroma planes filtered too. The outputs 
+ *           are compared with references computed on the normalized planes.
+ */
+TEST (GuidedFilter, guidedFilterYUV)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_img, 
+                                                        kernel_filename_scan, 
+                                                        kernel_filename_tr, 
+                                                        kernel_filename_box,
+                                                        kernel_filename_math, 
+                                                        kernel_filename_gf };
+        const unsigned int width = 640, height = 480;
+        const unsigned int pixels = width * height, cPixels = pixels / 4;
+        const unsigned int cWidth = width / 2, cHeight = height / 2;
+        const int gfRadius = 6;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        cl_algo::GF::GuidedFilterYUV gf (clEnv, info);
+
+        std::vector<cl_float> y (pixels), refY (pixels);
+        std::vector<cl_float> yc (cPixels), u (cPixels), v (cPixels), refU (cPixels), refV (cPixels);
+
+        // NV12, with the chroma planes passed through =========================
+        gf.init (width, height, gfRadius, gfEps, cl_algo::GF::YUVLayout::NV12);
+        std::generate (gf.hPtrIn, gf.hPtrIn + 3 * pixels / 2, GF::rNum_0_255);
+
+        gf.write ();
+        gf.run ();
+        cl_uchar *results = (cl_uchar *) gf.read ();
+
+        for (uint k = 0; k < pixels; ++k) y[k] = gf.hPtrIn[k] / 255.f;
+        GF::cpuGuidedFilter (y.data (), refY.data (), width, height, gfRadius, gfEps);
+
+        // Verify the luma plane (rounding, and the float errors of the filter, allow 2 levels)
+        for (uint k = 0; k < pixels; ++k)
+            ASSERT_LE (std::abs (std::min (std::max (refY[k] * 255.f, 0.f), 255.f) - results[k]), 2.f);
+
+        // Verify the chroma plane
+        for (uint k = pixels; k < 3 * pixels / 2; ++k)
+            ASSERT_EQ (gf.hPtrIn[k], results[k]);
+
+        // I420, with the chroma planes filtered too ===========================
+        gf.init (width, height, gfRadius, gfEps, cl_algo::GF::YUVLayout::I420, true);
+        std::generate (gf.hPtrIn, gf.hPtrIn + 3 * pixels / 2, GF::rNum_0_255);
+
+        gf.write ();
+        gf.replay ();
+        results = (cl_uchar *) gf.read ();
+
+        // The guide of the chroma planes is the mean of every 2x2 luma block
+        for (uint row = 0; row < cHeight; ++row)
+            for (uint col = 0; col < cWidth; ++col)
+            {
+                const cl_uchar *l = gf.hPtrIn + 2 * (row * width + col);
+                yc[row * cWidth + col] = (l[0] + l[1] + l[width] + l[width + 1]) / (4 * 255.f);
+            }
+        for (uint k = 0; k < cPixels; ++k)
+        {
+            u[k] = gf.hPtrIn[pixels + k] / 255.f;
+            v[k] = gf.hPtrIn[pixels + cPixels + k] / 255.f;
+        }
+        GF::cpuGuidedFilter (yc.data (), u.data (), refU.data (), cWidth, cHeight, gfRadius / 2, gfEps);
+        GF::cpuGuidedFilter (yc.data (), v.data (), refV.data (), cWidth, cHeight, gfRadius / 2, gfEps);
+
+        for (uint k = 0; k < cPixels; ++k)
+        {
+            ASSERT_LE (std::abs (std::min (std::max (refU[k] * 255.f, 0.f), 255.f) - results[pixels + k]), 2.f);
+            ASSERT_LE (std::abs (std::min (std::max (refV[k] * 255.f, 0.f), 255.f) - results[pixels + cPixels + k]), 2.f);
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuGuidedFilter (y.data (), refY.data (), width, height, gfRadius, gfEps);
+                GF::cpuGuidedFilter (yc.data (), u.data (), refU.data (), cWidth, cHeight, gfRadius / 2, gfEps);
+                GF::cpuGuidedFilter (yc.data (), v.data (), refV.data (), cWidth, cHeight, gfRadius / 2, gfEps);
+                pCPU[i] = cTimer.stop ();
+            }
+
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = gf.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "GuidedFilterYUV (I420, chroma filtered)");
+        }
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **Guided Filter** algorithm on a 16-bit `RGB` image.
+ *  \details The moments are accumulated exactly, so every channel of the `ushort` 
+ *           output is within 1 LSB of a `double` reference, rounded the same way.
+ */
+TEST (GuidedFilter, guidedFilterRGBUshort)
+{
+    try
+    {
+        const std::vector<std::string> kernel_files = { kernel_filename_gf };
+        const unsigned int width = 320, height = 240;
+        const unsigned int pixels = width * height;
+        const float gfEps = std::pow (0.1, 2);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<2> info (0, 0, 0, { 0, 1 }, 0);
+        const cl_algo::GF::Kinect::GuidedFilterRGBConfig C = cl_algo::GF::Kinect::GuidedFilterRGBConfig::INTERLEAVED_USHORT;
+        cl_algo::GF::Kinect::GuidedFilterRGB<C> gf (clEnv, info);
+        gf.init (width, height, 4, gfEps);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (gf.hPtrIn, gf.hPtrIn + 3 * pixels, GF::rNum_0_65535);
+        gf.write ();  // Copy data to device
+
+        std::vector<double> p (pixels), refGF (pixels);
+        for (int radius : { 4, 16 })
+        {
+            gf.setRadius (radius);
+            gf.run ();  // Execute kernels
+
+            cl_ushort *results = (cl_ushort *) gf.read ();  // Copy results to host
+
+            // Verify every channel against the reference
+            for (uint c = 0; c < 3; ++c)
+            {
+                for (uint k = 0; k < pixels; ++k) p[k] = gf.hPtrIn[3 * k + c] / 65535.0;
+                GF::cpuGuidedFilter (p.data (), refGF.data (), width, height, radius, gfEps);
+
+                for (uint k = 0; k < pixels; ++k)
+                {
+                    double ref = std::min (std::max (std::nearbyint (refGF[k] * 65535.0), 0.0), 65535.0);
+                    ASSERT_LE (std::abs (ref - results[3 * k + c]), 1.0);
+                }
+            }
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                for (uint c = 0; c < 3; ++c)
+                    GF::cpuGuidedFilter (p.data (), refGF.data (), width, height, gf.getRadius (), gfEps);
+                pCPU[i] = cTimer.stop ();
+            }
+
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = gf.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "GuidedFilterRGB<GuidedFilterRGBConfig::INTERLEAVED_USHORT>");
+        }
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
 int main (int argc, char **argv)
 {
     profiling = GF::setProfilingFlag (argc, argv);
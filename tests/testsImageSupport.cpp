@@ -39,20 +39,25 @@
 #include <random>
 #include <limits>
 #include <cmath>
+#include <thread>
 #include <gtest/gtest.h>
 #include <CLUtils.hpp>
 #include <GuidedFilter/algorithms.hpp>
+#include <GuidedFilter/tripleBuffer.hpp>
 #include <GuidedFilter/tests/helper_funcs.hpp>
 
 
 // Kernel filenames
-const std::string kernel_filename_img { "kernels/imageSupport_kernels.cl" };
+const std::string kernel_filename_img  { "kernels/imageSupport_kernels.cl" };
+const std::string kernel_filename_scan { "kernels/scan_kernels.cl"         };
+const std::string kernel_filename_tr   { "kernels/transpose_kernels.cl"    };
 
 namespace GF
 {
     // Uniform random number generators
     extern std::function<unsigned char ()> rNum_0_255;
     extern std::function<unsigned short ()> rNum_0_10000;
+    extern std::function<unsigned short ()> rNum_0_65535;
     extern std::function<float ()> rNum_R_0_1;
 }
 
@@ -246,6 +251,92 @@ TEST (ImageSupport, separateRGBChannels_Uchar2Float)
 }
 
 
+/*! \brief Tests the **separateRGBChannels_Ushort2Float** kernel.
+ *  \details The operation is a matrix transposition.
+ */
+TEST (ImageSupport, separateRGBChannels_Ushort2Float)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int pixels = width * height;
+        const unsigned int bufferInSize = 3 * pixels * sizeof (cl_ushort);
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_filename_img);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        const cl_algo::GF::SeparateRGBConfig C = cl_algo::GF::SeparateRGBConfig::USHORT_FLOAT;
+        cl_algo::GF::SeparateRGB<C> sRGB (clEnv, info);
+        sRGB.init (width, height);
+
+        // Initialize data (writes on staging buffer directly)
+        std::generate (sRGB.hPtrIn, sRGB.hPtrIn + bufferInSize / sizeof (cl_ushort), GF::rNum_0_65535);
+        
+        sRGB.write ();  // Copy data to device
+
+        sRGB.run ();  // Execute kernels
+        
+        // Copy results to host
+        cl_float *R = (cl_float *) sRGB.read (cl_algo::GF::SeparateRGB<C>::Memory::H_OUT_R, CL_FALSE);
+        cl_float *G = (cl_float *) sRGB.read (cl_algo::GF::SeparateRGB<C>::Memory::H_OUT_G, CL_FALSE);
+        cl_float *B = (cl_float *) sRGB.read (cl_algo::GF::SeparateRGB<C>::Memory::H_OUT_B);
+
+        // Produce reference transposed image
+        cl_float *refR = new float[pixels];
+        cl_float *refG = new float[pixels];
+        cl_float *refB = new float[pixels];
+        GF::cpuSeparateRGB_N_Norm (sRGB.hPtrIn, refR, refG, refB, pixels);
+
+        // Verify the **transposed** array
+        float eps = 42 * std::numeric_limits<float>::epsilon ();  // 5.00679e-06
+        for (uint i = 0; i < pixels; ++i)
+        {
+            ASSERT_LT (std::abs (refR[i] - R[i]), eps);
+            ASSERT_LT (std::abs (refG[i] - G[i]), eps);
+            ASSERT_LT (std::abs (refB[i] - B[i]), eps);
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuSeparateRGB_N_Norm (sRGB.hPtrIn, refR, refG, refB, pixels);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = sRGB.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "SeparateRGB<SeparateRGBConfig::USHORT_FLOAT>");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
 /*! \brief Tests the **combineRGBChannels_Float2Float** kernel.
  *  \details The operation is a matrix transposition.
  */
@@ -428,6 +519,93 @@ TEST (ImageSupport, combineRGBChannels_Float2Uchar)
 }
 
 
+/*! \brief Tests the **combineRGBChannels_Float2Ushort** kernel.
+ *  \details The operation is a matrix transposition. The values 
+ *           out of \f$[0, 1]\f$ have to be saturated.
+ */
+TEST (ImageSupport, combineRGBChannels_Float2Ushort)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int pixels = width * height;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_filename_img);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        const cl_algo::GF::CombineRGBConfig C = cl_algo::GF::CombineRGBConfig::FLOAT_USHORT;
+        cl_algo::GF::CombineRGB<C> cRGB (clEnv, info);
+        cRGB.init (width, height);
+
+        // Initialize data (writes on staging buffer directly)
+        // Values in [-0.1, 1.1) exercise the saturation
+        auto rNum = [] { return 1.2f * GF::rNum_R_0_1 () - 0.1f; };
+        std::generate (cRGB.hPtrInR, cRGB.hPtrInR + pixels, rNum);
+        std::generate (cRGB.hPtrInG, cRGB.hPtrInG + pixels, rNum);
+        std::generate (cRGB.hPtrInB, cRGB.hPtrInB + pixels, rNum);
+        
+        // Copy data to device
+        cRGB.write (cl_algo::GF::CombineRGB<C>::Memory::D_IN_R);
+        cRGB.write (cl_algo::GF::CombineRGB<C>::Memory::D_IN_G);
+        cRGB.write (cl_algo::GF::CombineRGB<C>::Memory::D_IN_B);
+
+        cRGB.run ();  // Execute kernels
+        
+        cl_ushort *results = (cl_ushort *) cRGB.read ();  // Copy results to host
+
+        // Produce reference transposed image
+        cl_ushort *refCombRGB = new cl_ushort[3 * pixels];
+        GF::cpuTranspose_N_Scale (cRGB.hPtrInR, cRGB.hPtrInG, cRGB.hPtrInB, refCombRGB, pixels);
+
+        // Verify the **transposed** array
+        for (uint i = 0; i < pixels; ++i)
+        {
+            ASSERT_EQ (refCombRGB[i * 3],     results[i * 3]);
+            ASSERT_EQ (refCombRGB[i * 3 + 1], results[i * 3 + 1]);
+            ASSERT_EQ (refCombRGB[i * 3 + 2], results[i * 3 + 2]);
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuTranspose_N_Scale (cRGB.hPtrInR, cRGB.hPtrInG, cRGB.hPtrInB, refCombRGB, pixels);
+                pCPU[i] = cTimer.stop ();
+            }
+            
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = cRGB.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "CombineRGB<CombineRGBConfig::FLOAT_USHORT>");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
 /*! \brief Tests the **depth_Ushort2Float** kernel.
  *  \details The operation is a type promotion from `ushort` to `float`.
  */
@@ -507,6 +685,83 @@ TEST (ImageSupport, depth_Ushort2Float)
 }
 
 
+/*! \brief Tests the **depth_Float2Ushort** kernel.
+ *  \details The operation is a scaling, and a type demotion 
+ *           from `float` to `ushort`, with rounding and saturation.
+ */
+TEST (ImageSupport, depth_Float2Ushort)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int length = width * height;
+
+        // Setup the OpenCL environment
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_filename_img);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::Depth<cl_algo::GF::DepthConfig::FLOAT_USHORT> df (clEnv, info);
+        df.init (width, height, 65535.f);
+        
+        // Initialize data (writes on staging buffer directly)
+        // Values in [-0.1, 1.1) exercise the saturation
+        std::generate (df.hPtrIn, df.hPtrIn + length, [] { return 1.2f * GF::rNum_R_0_1 () - 0.1f; });
+        
+        df.write ();  // Copy data to device
+
+        df.run ();  // Execute kernels
+        
+        // Copy results to host
+        cl_ushort *results = (cl_ushort *) df.read ();
+
+        // Produce reference image
+        std::vector<cl_ushort> refDepth (length);
+        for (uint i = 0; i < length; ++i) refDepth[i] = GF::cpuScaleUshort (df.hPtrIn[i]);
+
+        // Verify image
+        for (uint i = 0; i < length; ++i)
+            ASSERT_EQ (refDepth[i], results[i]);
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                for (uint i = 0; i < length; ++i) refDepth[i] = GF::cpuScaleUshort (df.hPtrIn[i]);
+                pCPU[i] = cTimer.stop ();
+            }
+
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = df.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "Depth<DepthConfig::FLOAT_USHORT>");
+        }
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
 /*! \brief Tests the **depthTo3D** kernel.
  *  \details The operation is a transformation from the image plane 
  *           to the world coordinates (w.r.t. camera frame).
@@ -973,6 +1228,328 @@ TEST (ImageSupport, splitPC8D)
 }
 
 
+/*! \brief Tests the **CompactPC** class.
+ *  \details The operation removes the points with zero depth from a point cloud.
+ */
+TEST (ImageSupport, compactPC)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int points = width * height;
+
+        // Setup the OpenCL environment
+        const std::vector<std::string> kernel_files = { kernel_filename_img, 
+                                                        kernel_filename_scan };
+
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::CompactPC<cl_algo::GF::CompactPCConfig::PC4D> cpc (clEnv, info);
+        cpc.init (width, height);
+
+        // Initialize data (writes on staging buffer directly)
+        // About a third of the points are invalid
+        cl_float *pc = (cl_float *) cpc.hPtrIn;
+        std::generate (pc, pc + 4 * points, GF::rNum_R_0_1);
+        for (uint k = 0; k < points; ++k)
+            if (pc[(k << 2) + 2] < 0.33f) pc[(k << 2) + 2] = 0.f;
+
+        cpc.write ();  // Copy data to device
+
+        cpc.run ();  // Execute kernels
+
+        // Copy results to host
+        cl_float4 *results = (cl_float4 *) cpc.read ();
+        cl_uint count = *cpc.hPtrCount;
+
+        // Produce reference point cloud
+        cl_float4 *refPC = new cl_float4[points];
+        cl_uint refCount = GF::cpuCompactPC (cpc.hPtrIn, refPC, points);
+
+        // Verify point cloud
+        ASSERT_EQ (refCount, count);
+        for (uint k = 0; k < count; ++k)
+        {
+            cl_float *dValue = (cl_float *) &results[k];
+            cl_float *hValue = (cl_float *) &refPC[k];
+
+            for (uint j = 0; j < 4; ++j)
+                ASSERT_EQ (hValue[j], dValue[j]);
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuCompactPC (cpc.hPtrIn, refPC, points);
+                pCPU[i] = cTimer.stop ();
+            }
+
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = cpc.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "CompactPC<CompactPCConfig::PC4D>");
+        }
+
+        delete[] refPC;
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **splitPC8D_Compact** kernel.
+ *  \details An 8-D point cloud is compacted by `CompactPC` and 
+ *           then split into 4-D geometry points and RGBA color points.
+ */
+TEST (ImageSupport, splitPC8D_Compact)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int points = width * height;
+
+        // Setup the OpenCL environment
+        const std::vector<std::string> kernel_files = { kernel_filename_img, 
+                                                        kernel_filename_scan };
+
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::CompactPC<cl_algo::GF::CompactPCConfig::PC8D> cpc (clEnv, info);
+        cpc.get (cl_algo::GF::CompactPC<cl_algo::GF::CompactPCConfig::PC8D>::Memory::D_OUT) = 
+            cl::Buffer (clEnv.getContext (0), CL_MEM_READ_WRITE, points * sizeof (cl_float8));
+        cpc.init (width, height, cl_algo::GF::Staging::I);
+
+        cl_algo::GF::SplitPC8D sp8D (clEnv, info);
+        sp8D.get (cl_algo::GF::SplitPC8D::Memory::D_IN) = 
+            cpc.get (cl_algo::GF::CompactPC<cl_algo::GF::CompactPCConfig::PC8D>::Memory::D_OUT);
+        sp8D.get (cl_algo::GF::SplitPC8D::Memory::D_COUNT) = 
+            cpc.get (cl_algo::GF::CompactPC<cl_algo::GF::CompactPCConfig::PC8D>::Memory::D_COUNT);
+        sp8D.init (points, 0, cl_algo::GF::Staging::O);
+
+        // Initialize data (writes on staging buffer directly)
+        // About half of the points are invalid
+        cl_float *pc = (cl_float *) cpc.hPtrIn;
+        std::generate (pc, pc + 8 * points, GF::rNum_R_0_1);
+        for (uint k = 0; k < points; ++k)
+            if (pc[(k << 3) + 2] < 0.5f) pc[(k << 3) + 2] = 0.f;
+
+        cpc.write ();  // Copy data to device
+
+        // Execute kernels
+        cpc.run ();
+        sp8D.run ();
+
+        // Copy results to host
+        cl_float *pc4d = (cl_float *) sp8D.read (cl_algo::GF::SplitPC8D::Memory::H_OUT_PC4D, CL_FALSE);
+        cl_float *rgba = (cl_float *) sp8D.read (cl_algo::GF::SplitPC8D::Memory::H_OUT_RGBA);
+
+        // Produce reference point clouds
+        cl_float8 *refPC8D = new cl_float8[points];
+        cl_uint count = GF::cpuCompactPC (cpc.hPtrIn, refPC8D, points);
+
+        cl_float *refPC4D = (cl_float *) new cl_float4[points];
+        cl_float *refRGBA = (cl_float *) new cl_float4[points];
+        GF::cpuSplitPC8D ((cl_float *) refPC8D, refPC4D, refRGBA, count);
+
+        // Verify the sets of points
+        for (uint k = 0; k < 4 * count; ++k)
+        {
+            ASSERT_EQ (refPC4D[k], pc4d[k]);
+            ASSERT_EQ (refRGBA[k], rgba[k]);
+        }
+
+        delete[] refPC8D;
+        delete[] refPC4D;
+        delete[] refRGBA;
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the **Normals** class.
+ *  \details A smooth synthetic surface, with scattered holes, is 
+ *           turned into a point cloud and its normals get estimated.
+ */
+TEST (ImageSupport, normals)
+{
+    try
+    {
+        const unsigned int width = 640, height = 480;
+        const unsigned int points = width * height;
+        const int radius = 5;
+        const float f = 595.f;
+
+        // Setup the OpenCL environment
+        const std::vector<std::string> kernel_files = { kernel_filename_img, 
+                                                        kernel_filename_scan, 
+                                                        kernel_filename_tr };
+
+        clutils::CLEnv clEnv;
+        clEnv.addContext (0);
+        clEnv.addQueue (0, 0, CL_QUEUE_PROFILING_ENABLE);
+        clEnv.addProgram (0, kernel_files);
+
+        // Configure kernel execution parameters
+        clutils::CLEnvInfo<1> info (0, 0, 0, { 0 }, 0);
+        cl_algo::GF::Normals nrm (clEnv, info);
+        nrm.init (width, height, radius);
+
+        // Initialize data (writes on staging buffer directly)
+        std::vector<cl_ushort> depth (points);
+        for (uint row = 0; row < height; ++row)
+            for (uint col = 0; col < width; ++col)
+                depth[row * width + col] = 2000 + 300 * std::sin (col / 40.f) * std::cos (row / 50.f);
+        for (uint k = 0; k < points; k += 37)
+            depth[k] = 0;
+        GF::cpuDepthTo3D (depth.data (), nrm.hPtrIn, width, height, f);
+
+        nrm.write ();  // Copy data to device
+
+        nrm.run ();  // Execute kernels
+
+        // Copy results to host
+        cl_float4 *results = (cl_float4 *) nrm.read ();
+
+        // Produce reference normals
+        cl_float4 *refNormals = new cl_float4[points];
+        GF::cpuNormals (nrm.hPtrIn, refNormals, width, height, radius);
+
+        // Verify normals
+        for (uint k = 0; k < points; ++k)
+        {
+            cl_float *dValue = (cl_float *) &results[k];
+            cl_float *hValue = (cl_float *) &refNormals[k];
+
+            if (depth[k] == 0)
+            {
+                for (uint j = 0; j < 4; ++j)
+                    ASSERT_EQ (0.f, dValue[j]);
+                continue;
+            }
+
+            float dp = hValue[0] * dValue[0] + hValue[1] * dValue[1] + hValue[2] * dValue[2];
+            ASSERT_GT (dp, 0.99f);
+            ASSERT_NEAR (hValue[3], dValue[3], 1e-3f);
+        }
+
+        // Profiling ===========================================================
+        if (profiling)
+        {
+            const int nRepeat = 1;  /* Number of times to perform the tests. */
+
+            // CPU
+            clutils::CPUTimer<double, std::milli> cTimer;
+            clutils::ProfilingInfo<nRepeat> pCPU ("CPU");
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                cTimer.start ();
+                GF::cpuNormals (nrm.hPtrIn, refNormals, width, height, radius);
+                pCPU[i] = cTimer.stop ();
+            }
+
+            // GPU
+            clutils::GPUTimer<std::milli> gTimer (clEnv.devices[0][0]);
+            clutils::ProfilingInfo<nRepeat> pGPU ("GPU");
+            for (int i = 0; i < nRepeat; ++i)
+                pGPU[i] = nrm.run (gTimer);
+
+            // Benchmark
+            pGPU.print (pCPU, "Normals");
+        }
+
+        delete[] refNormals;
+
+    }
+    catch (const cl::Error &error)
+    {
+        std::cerr << error.what ()
+                  << " (" << clutils::getOpenCLErrorCodeString (error.err ()) 
+                  << ")"  << std::endl;
+        exit (EXIT_FAILURE);
+    }
+}
+
+
+/*! \brief Tests the handoff of frames through a `TripleBuffer`.
+ *  \details A producer thread fills every frame with its sequence number. 
+ *           The consumer checks that the frames it acquires are complete, 
+ *           arrive in order, and that every frame was either acquired 
+ *           or counted as dropped.
+ */
+TEST (ImageSupport, tripleBuffer)
+{
+    const unsigned int frameSize = 1 << 14;
+    const unsigned int nFrames = 20000;
+
+    std::vector<cl_uint> slots (3 * frameSize);
+    cl_algo::GF::TripleBuffer<cl_uint> frames (&slots[0], &slots[frameSize], &slots[2 * frameSize]);
+
+    std::thread producer ([&] {
+        for (cl_uint i = 1; i <= nFrames; ++i)
+        {
+            std::fill (frames.back (), frames.back () + frameSize, i);
+            frames.publish (i);
+        }
+    });
+
+    cl_uint last = 0; unsigned int acquired = 0;
+    while (last < nFrames)
+    {
+        cl_uint *frame = frames.acquire ();
+        if (frame == nullptr) continue;
+
+        ASSERT_GT (frame[0], last);
+        ASSERT_EQ (frame[0], frames.frontStamp ());
+        for (unsigned int j = 0; j < frameSize; ++j)
+            ASSERT_EQ (frame[0], frame[j]);
+
+        last = frame[0];
+        acquired++;
+    }
+
+    producer.join ();
+
+    EXPECT_EQ (nFrames, frames.published ());
+    EXPECT_EQ (nFrames, acquired + frames.dropped ());
+    EXPECT_EQ (nullptr, frames.acquire ());
+}
+
+
 int main (int argc, char **argv)
 {
     profiling = GF::setProfilingFlag (argc, argv);